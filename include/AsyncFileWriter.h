@@ -0,0 +1,241 @@
+﻿//-----------------------------------------------------------------------------
+// File : AsyncFileWriter.h
+// Desc : Asynchronous File Writer.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncFileWriterDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct AsyncFileWriterDesc
+{
+    uint32_t    QueueDepth;         //!< 同時に発行する書き込み数. 0 の場合は既定値.
+    uint32_t    ThreadCount;        //!< io_uring が使えない場合の書き込みスレッド数. 0 の場合は既定値.
+    uint32_t    ChunkSize;          //!< 1回の書き込みサイズ[byte] (4096 の倍数に切り上げ). 0 の場合は既定値.
+    uint64_t    MaxPendingBytes;    //!< 未完了の書き込みの上限[byte]. 超えると Append() が待ちます. 0 の場合は既定値.
+    bool        DirectIO;           //!< O_DIRECT で書き込む (io_uring 使用時のみ有効).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncFileWriterStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct AsyncFileWriterStats
+{
+    uint64_t    FileCount;          //!< 閉じたファイル数.
+    uint64_t    FailCount;          //!< 書き込みに失敗したファイル数.
+    uint64_t    WriteCount;         //!< 完了した書き込み数.
+    uint64_t    WriteBytes;         //!< 書き込んだバイト数.
+    uint32_t    QueueDepth;         //!< 未完了の書き込み数.
+    uint32_t    MaxQueueDepth;      //!< 未完了の書き込み数の最大値.
+    double      LatencySec;         //!< 書き込みを発行してから完了するまでの合計時間[sec].
+    double      MaxLatencySec;      //!< 書き込みを発行してから完了するまでの最大時間[sec].
+    uint64_t    StallCount;         //!< 未完了の書き込みが上限を超えて待った回数.
+    double      StallSec;           //!< 未完了の書き込みが上限を超えて待った合計時間[sec].
+    bool        UseIoUring;         //!< io_uring で書き込んでいる.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncFileWriter class
+///////////////////////////////////////////////////////////////////////////////
+class AsyncFileWriter
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    static const uint32_t INVALID_HANDLE = ~0u;
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    AsyncFileWriter() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~AsyncFileWriter();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @note       Linux では io_uring を使い, 使えない場合 (カーネルやサンドボックスの制限)
+    //!             や他のプラットフォームでは書き込みスレッドで処理します.
+    //! @param[in]      desc        構成設定.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const AsyncFileWriterDesc& desc);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //!
+    //! @note       未完了の書き込みを全て待ってから終了します.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      書き込み用にファイルを開きます.
+    //!
+    //! @param[in]      path        ファイルパス.
+    //! @return     ファイルハンドルを返却します. 失敗した場合は INVALID_HANDLE を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Open(const char* path);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルの末尾にデータを追加します.
+    //!
+    //! @note       データはチャンクにコピーされるので, 戻った後はバッファを再利用できます.
+    //!             チャンクが埋まるごとに書き込みを発行します.
+    //!             同じハンドルに対しては1つのスレッドから呼び出してください.
+    //! @param[in]      handle      ファイルハンドル.
+    //! @param[in]      pData       データ.
+    //! @param[in]      size        データサイズ.
+    //! @retval true    追加に成功.
+    //! @retval false   既に書き込みに失敗しています.
+    //-------------------------------------------------------------------------
+    bool Append(uint32_t handle, const void* pData, size_t size);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルを閉じます.
+    //!
+    //! @note       残りのデータを書き込んだ後に閉じます. 呼び出し後はハンドルを使えません.
+    //!             callback は書き込みスレッドから呼び出されます.
+    //! @param[in]      handle      ファイルハンドル.
+    //! @param[in]      callback    閉じた後に成否を受け取るコールバック (nullptr 可).
+    //-------------------------------------------------------------------------
+    void Close(uint32_t handle, std::function<void(bool)> callback = nullptr);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルを書き出します.
+    //!
+    //! @note       Open(), Append(), Close() をまとめて行います.
+    //! @param[in]      path        ファイルパス.
+    //! @param[in]      pData       データ.
+    //! @param[in]      size        データサイズ.
+    //! @param[in]      callback    閉じた後に成否を受け取るコールバック (nullptr 可).
+    //! @retval true    書き込みの発行に成功.
+    //! @retval false   書き込みの発行に失敗 (callback は呼び出されません).
+    //-------------------------------------------------------------------------
+    bool WriteFile(const char* path, const void* pData, size_t size, std::function<void(bool)> callback = nullptr);
+
+    //-------------------------------------------------------------------------
+    //! @brief      閉じたファイルの書き込みが全て完了するまで待ちます.
+    //!
+    //! @retval true    前回の呼び出し以降, 全てのファイルの書き込みに成功.
+    //! @retval false   書き込みに失敗したファイルがあります.
+    //-------------------------------------------------------------------------
+    bool Flush();
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計情報を取得します.
+    //-------------------------------------------------------------------------
+    AsyncFileWriterStats GetStats() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Op structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Op;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Chunk structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Chunk
+    {
+        uint8_t*    pData   = nullptr;
+        size_t      Size    = 0;        //!< 書き込むバイト数.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // File structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct File
+    {
+        std::string                 Path;
+        FILE*                       pFile       = nullptr;  //!< 書き込みスレッドで使用.
+        int                         Fd          = -1;       //!< io_uring で使用.
+        bool                        Direct      = false;    //!< O_DIRECT で開いた.
+        bool                        InUse       = false;
+        bool                        Failed      = false;
+        bool                        Closing     = false;    //!< Close() を呼び出した.
+        uint64_t                    Offset      = 0;        //!< 次のチャンクの書き込み位置.
+        uint64_t                    Size        = 0;        //!< 追加したバイト数.
+        uint32_t                    Inflight    = 0;        //!< 未完了の書き込み数.
+        Chunk*                      pChunk      = nullptr;  //!< 追加中のチャンク.
+        Op*                         pCloseOp    = nullptr;  //!< 書き込みスレッドが受け取った閉じる処理.
+        std::function<void(bool)>   Callback;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Ring structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Ring;
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    mutable std::mutex          m_Mutex;
+    std::condition_variable     m_OpCond;           //!< 書き込みの発行の通知.
+    std::condition_variable     m_DoneCond;         //!< 書き込みの完了の通知.
+    std::vector<std::thread>    m_Threads;
+    std::vector<std::deque<Op*>> m_Queues;          //!< スレッドごとの書き込み待ち (m_Mutex で保護).
+    std::vector<File>           m_Files;            //!< ファイルハンドルの実体 (m_Mutex で保護).
+    std::vector<uint32_t>       m_FreeFiles;
+    std::vector<Chunk*>         m_FreeChunks;
+    std::vector<Chunk*>         m_Chunks;           //!< 確保した全てのチャンク.
+    Ring*                       m_pRing             = nullptr;
+    uint32_t                    m_QueueDepth        = 0;
+    uint32_t                    m_ChunkSize         = 0;
+    uint64_t                    m_MaxPendingBytes   = 0;
+    uint64_t                    m_PendingBytes      = 0;    //!< 未完了の書き込みのバイト数.
+    uint32_t                    m_PendingOps        = 0;    //!< 未完了の書き込みと閉じる処理の数.
+    bool                        m_DirectIO          = false;
+    bool                        m_FlushFailed       = false;
+    bool                        m_Quit              = false;
+    AsyncFileWriterStats        m_Stats             = {};
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    AsyncFileWriter (const AsyncFileWriter&) = delete;
+    void operator = (const AsyncFileWriter&) = delete;
+
+    Chunk*  AllocChunk      ();
+    bool    IsValidHandle   (uint32_t handle) const;
+    void    Submit          (std::unique_lock<std::mutex>& lock, uint32_t handle, Chunk* pChunk);
+    void    CompleteWrite   (Op* pOp, bool success, bool reuseChunk = true);
+    void    RequestClose    (Op* pOp);
+    void    CloseFile       (uint32_t handle);
+    void    RunThread       (uint32_t index);
+    void    RunIoUring      ();
+    bool    WriteSync       (int fd, Op* pOp);
+};
+
+} // namespace r3d
@@ -0,0 +1,198 @@
+﻿//-----------------------------------------------------------------------------
+// File : BudgetScheduler.h
+// Desc : Convergence Driven Frame Time Scheduler.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// BudgetSchedulerDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct BudgetSchedulerDesc
+{
+    uint32_t    FrameCount;     //!< 総フレーム数.
+    double      MinScale;       //!< 均等に割り振った時間に対する1フレームの下限の比率 (0 なら既定値).
+    double      MaxScale;       //!< 均等に割り振った時間に対する1フレームの上限の比率 (0 なら既定値).
+    double      MinFrameSec;    //!< 1フレームに割り振る最低限の時間[sec]. 後に残すフレームの分も確保します.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BudgetSchedulerStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct BudgetSchedulerStats
+{
+    uint32_t    EstimateCount;  //!< 事前パスで難しさを推定したフレーム数.
+    uint32_t    ReportCount;    //!< 描画結果から難しさを計測したフレーム数.
+    double      Calibration;    //!< 描画結果と事前パスの難しさの比.
+    double      MinFrameSec;    //!< 割り振った描画時間の最小値[sec].
+    double      MaxFrameSec;    //!< 割り振った描画時間の最大値[sec].
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BudgetScheduler class
+///////////////////////////////////////////////////////////////////////////////
+class BudgetScheduler
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    BudgetScheduler() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      desc        構成設定.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const BudgetSchedulerDesc& desc);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      事前パスで計測したノイズを設定します.
+    //!
+    //! @note       難しさは (ノイズの分散) x (描画時間) で, 同じ時間を掛けたときの誤差に比例します.
+    //!             推定していないフレームは前後の推定値から補間します.
+    //! @param[in]      frameIndex      フレーム番号.
+    //! @param[in]      noiseVariance   ノイズの分散 (EstimateNoiseVariance() の結果).
+    //! @param[in]      renderSec       計測した画像の描画に掛かった時間[sec].
+    //-------------------------------------------------------------------------
+    void SetEstimate(uint32_t frameIndex, double noiseVariance, double renderSec);
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームの描画が終わったことを設定します.
+    //!
+    //! @param[in]      frameIndex  フレーム番号.
+    //! @param[in]      renderSec   描画に掛かった時間[sec]. 以前のセッションで完了したフレームは 0.
+    //-------------------------------------------------------------------------
+    void SetDone(uint32_t frameIndex, double renderSec);
+
+    //-------------------------------------------------------------------------
+    //! @brief      描画が終わったフレームのノイズを報告します.
+    //!
+    //! @note       SetDone() の後に呼び出します. 事前パスとの比を補正してから
+    //!             近くの未完了のフレームの推定に使います.
+    //!             複数のスレッドから同時に呼び出せます.
+    //! @param[in]      frameIndex      フレーム番号.
+    //! @param[in]      noiseVariance   ノイズの分散 (EstimateNoiseVariance() の結果).
+    //-------------------------------------------------------------------------
+    void Report(uint32_t frameIndex, double noiseVariance);
+
+    //-------------------------------------------------------------------------
+    //! @brief      1回の描画 (1サンプル) に掛かった時間を設定します.
+    //!
+    //! @note       移動平均を取り, MinFrameSec より長ければ最低限の時間として使います.
+    //!             どのフレームも最低1回は描画するので, これを下回る時間を割り振ると
+    //!             使い過ぎた分が後のフレームから削られて締め切りに間に合わなくなります.
+    //! @param[in]      sampleSec   描画に掛かった時間[sec].
+    //-------------------------------------------------------------------------
+    void SetSampleSec(double sampleSec);
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームの描画時間を計算します.
+    //!
+    //! @note       残り時間を未完了のフレームの難しさに比例して割り振り, 予測される誤差を揃えます.
+    //!             均等に割り振った時間の MinScale ～ MaxScale 倍に制限し, 後に残すフレームの
+    //!             最低限の時間も確保します. 推定値が無い場合は均等に割り振ります.
+    //!             返却した時間は超えないように, 次の描画で超える時点で出力してください.
+    //! @param[in]      frameIndex  次に描画するフレーム番号.
+    //! @param[in]      deadlineSec 締め切り[sec].
+    //! @param[in]      elapsedSec  経過時間[sec].
+    //! @return     描画時間[sec]を返却します. 未完了のフレームが無い場合は残り時間です.
+    //-------------------------------------------------------------------------
+    double GetFrameTime(uint32_t frameIndex, double deadlineSec, double elapsedSec);
+
+    //-------------------------------------------------------------------------
+    //! @brief      推定した難しさを取得します.
+    //-------------------------------------------------------------------------
+    double GetDifficulty(uint32_t frameIndex) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      未完了のフレーム数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetPendingCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計情報を取得します.
+    //-------------------------------------------------------------------------
+    BudgetSchedulerStats GetStats() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    mutable std::mutex      m_Mutex;
+    uint32_t                m_FrameCount        = 0;
+    double                  m_MinScale          = 0.0;
+    double                  m_MaxScale          = 0.0;
+    double                  m_MinFrameSec       = 0.0;
+    double                  m_SampleSec         = 0.0;  //!< 1回の描画時間の移動平均.
+    std::vector<double>     m_Priors;               //!< 事前パスの難しさ (0 なら未推定).
+    std::vector<double>     m_Measured;             //!< 描画結果の難しさ (事前パスの尺度に補正済み. 0 なら未計測).
+    std::vector<double>     m_RenderSec;            //!< 描画に掛かった時間.
+    std::vector<uint8_t>    m_Done;                 //!< 描画が終わったフレーム.
+    double                  m_LogCalibration    = 0.0;  //!< log(描画結果 / 事前パス) の移動平均.
+    BudgetSchedulerStats    m_Stats             = {};
+    std::vector<double>     m_Difficulties;         //!< 作業領域.
+    std::vector<uint32_t>   m_Pending;              //!< 作業領域.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    BudgetScheduler (const BudgetScheduler&) = delete;
+    void operator = (const BudgetScheduler&) = delete;
+
+    double Interpolate   (uint32_t frameIndex, bool priorOnly) const;
+    double CalcDifficulty(uint32_t frameIndex) const;
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      画像のノイズの分散を推定します.
+//!
+//! @note       輝度に 3x3 のラプラシアンの差分 (Immerkær 1996) を掛けた絶対値の平均から
+//!             標準偏差を求めます. 細かいテクスチャもノイズとして数えるので,
+//!             同じシーンの中での相対的な比較に使います.
+//! @param[in]      pPixels     画素データ (RGBA8).
+//! @param[in]      width       横幅[px].
+//! @param[in]      height      縦幅[px].
+//! @param[in]      pitch       1行のバイト数.
+//! @param[in]      rowStep     計測する行の間隔 (1 なら全ての行).
+//! @return     輝度 [0, 1] のノイズの分散を返却します.
+//-----------------------------------------------------------------------------
+double EstimateNoiseVariance(
+    const uint8_t*  pPixels,
+    uint32_t        width,
+    uint32_t        height,
+    uint32_t        pitch,
+    uint32_t        rowStep);
+
+} // namespace r3d
@@ -0,0 +1,193 @@
+﻿//-----------------------------------------------------------------------------
+// File : BufferArena.h
+// Desc : TLSF Sub-Allocator for Large Buffer Blocks.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// ArenaAllocation structure
+///////////////////////////////////////////////////////////////////////////////
+struct ArenaAllocation
+{
+    uint32_t    Block   = UINT32_MAX;   //!< ブロック番号.
+    uint32_t    Node    = UINT32_MAX;   //!< 解放時に使う内部ハンドル.
+    uint64_t    Offset  = 0;            //!< ブロック先頭からのオフセット.
+    uint64_t    Size    = 0;            //!< アライメント後のサイズ.
+
+    //-------------------------------------------------------------------------
+    //! @brief      有効な割り当てかどうか?
+    //-------------------------------------------------------------------------
+    bool IsValid() const
+    { return Node != UINT32_MAX; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ArenaStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct ArenaStats
+{
+    uint32_t    BlockCount          = 0;    //!< ブロック数.
+    uint32_t    DedicatedCount      = 0;    //!< 専用ブロック数.
+    uint32_t    AllocationCount     = 0;    //!< 割り当て数.
+    uint32_t    FreeRangeCount      = 0;    //!< 空き領域数.
+    uint64_t    Capacity            = 0;    //!< 全ブロックの合計サイズ.
+    uint64_t    UsedSize            = 0;    //!< 割り当て済みサイズ.
+    uint64_t    FreeSize            = 0;    //!< 空きサイズ.
+    uint64_t    LargestFreeRange    = 0;    //!< 最大の空き領域サイズ.
+
+    //-------------------------------------------------------------------------
+    //! @brief      断片化率を求めます.
+    //!
+    //! @return     空きサイズのうち最大の空き領域に入らない割合 [0, 1] を返却します.
+    //-------------------------------------------------------------------------
+    float GetFragmentation() const
+    {
+        if (FreeSize == 0)
+        { return 0.0f; }
+
+        return float(1.0 - double(LargestFreeRange) / double(FreeSize));
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BufferArena class
+///////////////////////////////////////////////////////////////////////////////
+class BufferArena
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @note       ブロックは必要になった時点で追加されます.
+    //!             ブロックサイズを超える要求はその要求専用のブロックに割り当てます.
+    //! @param[in]      blockSize   ブロックサイズ.
+    //! @param[in]      alignment   オフセットとサイズのアライメント (2の累乗).
+    //! @retval true    初期化に成功.
+    //! @retval false   引数が不正です.
+    //-------------------------------------------------------------------------
+    bool Init(uint64_t blockSize, uint64_t alignment);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      領域を割り当てます.
+    //!
+    //! @note       既存ブロックの空き領域から Good-Fit で探索し，
+    //!             見つからない場合にブロックを追加します.
+    //!             result.Block が GetBlockCount() の直前の値以上であれば
+    //!             新しいブロックが追加されています.
+    //! @param[in]      size        サイズ.
+    //! @param[out]     result      割り当て結果.
+    //! @retval true    割り当てに成功.
+    //! @retval false   割り当てに失敗.
+    //-------------------------------------------------------------------------
+    bool Alloc(uint64_t size, ArenaAllocation& result);
+
+    //-------------------------------------------------------------------------
+    //! @brief      領域を解放します.
+    //!
+    //! @note       隣接する空き領域とは結合されます. ブロック自体は解放しません.
+    //! @param[in]      allocation  Alloc() で割り当てた領域.
+    //-------------------------------------------------------------------------
+    void Free(const ArenaAllocation& allocation);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ブロック数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetBlockCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ブロックサイズを取得します.
+    //!
+    //! @param[in]      index       ブロック番号.
+    //-------------------------------------------------------------------------
+    uint64_t GetBlockSize(uint32_t index) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計情報を取得します.
+    //-------------------------------------------------------------------------
+    ArenaStats GetStats() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Node structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Node
+    {
+        uint64_t    Offset;         //!< オフセット (アライメント単位).
+        uint64_t    Size;           //!< サイズ (アライメント単位).
+        uint32_t    Block;          //!< ブロック番号.
+        uint32_t    PrevPhys;       //!< ブロック内で直前の領域.
+        uint32_t    NextPhys;       //!< ブロック内で直後の領域.
+        uint32_t    PrevFree;       //!< 同じビンの前の空き領域.
+        uint32_t    NextFree;       //!< 同じビンの次の空き領域.
+        bool        Free;           //!< 空き領域かどうか.
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Block structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Block
+    {
+        uint64_t    Size;           //!< サイズ (アライメント単位).
+        bool        Dedicated;      //!< 専用ブロックかどうか.
+    };
+
+    static const uint32_t SL_BITS  = 4;
+    static const uint32_t SL_COUNT = 1u << SL_BITS;
+    static const uint32_t FL_COUNT = 64;
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    uint64_t                m_BlockUnits    = 0;
+    uint32_t                m_AlignShift    = 0;
+    std::vector<Node>       m_Nodes;
+    std::vector<uint32_t>   m_UnusedNodes;
+    std::vector<Block>      m_Blocks;
+    uint64_t                m_FlBitmap      = 0;
+    uint32_t                m_SlBitmap[FL_COUNT]            = {};
+    uint32_t                m_FreeHeads[FL_COUNT][SL_COUNT] = {};
+    uint64_t                m_UsedUnits     = 0;
+    uint32_t                m_AllocCount    = 0;
+    uint32_t                m_FreeCount     = 0;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    uint32_t NewNode        ();
+    void     DeleteNode     (uint32_t index);
+    void     InsertFree     (uint32_t index);
+    void     RemoveFree     (uint32_t index);
+    uint32_t FindFree       (uint64_t units) const;
+    uint32_t AddBlock       (uint64_t units, bool dedicated);
+};
+
+} // namespace r3d
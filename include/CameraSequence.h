@@ -9,10 +9,8 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <fnd/asdxMath.h>
-
-#if !CAMP_RELEASE
+#include <CameraTrack.h>
 #include <vector>
-#endif
 
 
 namespace r3d {
@@ -39,85 +37,68 @@ public:
     bool Init(const char* path, float aspectRatio);
     void Term();
 
-    const asdx::Matrix&  GetCurrView () const { return m_CurrView; }
-    const asdx::Matrix&  GetPrevView () const { return m_PrevView; }
-    const asdx::Matrix&  GetCurrProj () const { return m_CurrProj; }
-    const asdx::Matrix&  GetPrevProj () const { return m_PrevProj; }
-    asdx::Vector3        GetPosition () const;
-    float                GetFovY     () const;
-    float                GetNearClip () const;
-    float                GetFarlip   () const;
-    asdx::Vector3        GetCameraDir() const;
-
+    const asdx::Matrix&  GetCurrView   () const { return m_Views   [m_CurrFrame]; }
+    const asdx::Matrix&  GetPrevView   () const { return m_Views   [m_PrevFrame]; }
+    const asdx::Matrix&  GetCurrProj   () const { return m_Projs   [m_CurrFrame]; }
+    const asdx::Matrix&  GetPrevProj   () const { return m_Projs   [m_PrevFrame]; }
+    const asdx::Matrix&  GetCurrInvView() const { return m_InvViews[m_CurrFrame]; }
+    const asdx::Matrix&  GetPrevInvView() const { return m_InvViews[m_PrevFrame]; }
+    const asdx::Matrix&  GetCurrInvProj() const { return m_InvProjs[m_CurrFrame]; }
+    const asdx::Matrix&  GetPrevInvProj() const { return m_InvProjs[m_PrevFrame]; }
+    asdx::Vector3        GetPosition   () const;
+    float                GetFovY       () const;
+    float                GetNearClip   () const;
+    float                GetFarlip     () const;
+    asdx::Vector3        GetCameraDir  () const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定フレームのカメラに切り替えます.
+    //!
+    //! @note       全フレームの行列は Init() で計算済みなので，
+    //!             アスペクト比が変わらない限り参照先を切り替えるだけです.
+    //!             範囲外のフレームは先頭・末尾のフレームに固定されます.
+    //! @retval true    カメラが更新されました.
+    //! @retval false   直前と同じフレームなので更新していません.
+    //-------------------------------------------------------------------------
     bool Update(uint32_t frameIndex, float aspectRatio);
 
-private:
-    //=========================================================================
-    // private variables.
-    //=========================================================================
-    void*           m_pBinary       = nullptr;
-    uint32_t        m_ParamIndex    = 0;
-    uint32_t        m_FrameIndex    = 0;
-    asdx::Matrix    m_CurrView;
-    asdx::Matrix    m_PrevView;
-    asdx::Matrix    m_CurrProj;
-    asdx::Matrix    m_PrevProj;
-
-    //=========================================================================
-    // private methods.
-    //=========================================================================
-    /* NOTHING */
-};
-
-#if !CAMP_RELEASE
-///////////////////////////////////////////////////////////////////////////////
-// CameraParam structure
-///////////////////////////////////////////////////////////////////////////////
-struct CameraParam
-{
-    uint32_t        FrameIndex;
-    asdx::Vector3   Position;
-    asdx::Vector3   Target;
-    asdx::Vector3   Upward;
-    float           FieldOfView;
-    float           NearClip;
-    float           FarClip;
-};
-
-///////////////////////////////////////////////////////////////////////////////
-// CameraSequenceExporter class
-///////////////////////////////////////////////////////////////////////////////
-class CameraSequenceExporter
-{
-    //=========================================================================
-    // list of friend classes and methods.
-    //=========================================================================
-    /* NOTHING */
-
-public:
-    //=========================================================================
-    // public variables.
-    //=========================================================================
-    /* NOTHING */
-
-    //=========================================================================
-    // public methods.
-    //=========================================================================
-    bool LoadFromTXT(const char* path, std::string& exportPath);
-    bool Export(const char* path);
-    void Reset();
+    //-------------------------------------------------------------------------
+    //! @brief      指定時刻のカメラ行列を求めます.
+    //!
+    //! @note       現在のカメラは変更しません. モーションブラー用に
+    //!             フレーム内の時刻を評価する場合に使います.
+    //! @param[in]      time        時刻 (フレーム単位, 小数可).
+    //! @param[in]      aspectRatio アスペクト比.
+    //! @param[out]     view        ビュー行列.
+    //! @param[out]     proj        射影行列.
+    //-------------------------------------------------------------------------
+    void Evaluate(double time, float aspectRatio, asdx::Matrix& view, asdx::Matrix& proj) const;
 
 private:
     //=========================================================================
     // private variables.
     //=========================================================================
-    std::vector<CameraParam>    m_Params;
+    CameraTrack                 m_Track;
+    float                       m_AspectRatio   = 0.0f;
+    uint32_t                    m_FirstFrame    = 0;    //!< テーブル先頭のフレーム番号.
+    uint32_t                    m_CurrFrame     = 0;    //!< 現在のテーブル番号.
+    uint32_t                    m_PrevFrame     = 0;    //!< 前回のテーブル番号.
+
+    // フレーム毎の計算済みテーブル.
+    std::vector<asdx::Matrix>   m_Views;
+    std::vector<asdx::Matrix>   m_Projs;
+    std::vector<asdx::Matrix>   m_InvViews;
+    std::vector<asdx::Matrix>   m_InvProjs;
+    std::vector<asdx::Vector3>  m_Positions;
+    std::vector<float>          m_FovY;
+    std::vector<float>          m_NearClip;
+    std::vector<float>          m_FarClip;
 
     //=========================================================================
     // private methods.
     //=========================================================================
-    /* NOTHING */
+    void ToMatrix  (const CameraPose& pose, float aspectRatio, asdx::Matrix& view, asdx::Matrix& proj) const;
+    void BuildTable(float aspectRatio);
 };
-#endif
 
 } // namespace r3d
\ No newline at end of file
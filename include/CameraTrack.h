@@ -0,0 +1,150 @@
+﻿//-----------------------------------------------------------------------------
+// File : CameraTrack.h
+// Desc : Keyframe Camera Track.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// Float3 structure
+///////////////////////////////////////////////////////////////////////////////
+struct Float3
+{
+    float   x;
+    float   y;
+    float   z;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CameraKey structure
+///////////////////////////////////////////////////////////////////////////////
+struct CameraKey
+{
+    float   Time;           //!< 時刻 (フレーム単位).
+    Float3  Position;       //!< 位置座標.
+    Float3  Target;         //!< 注視点.
+    Float3  Upward;         //!< 上向きベクトル.
+    float   FieldOfView;    //!< 垂直画角 (radian).
+    float   NearClip;       //!< ニアクリップ平面.
+    float   FarClip;        //!< ファークリップ平面.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CameraPose structure
+///////////////////////////////////////////////////////////////////////////////
+struct CameraPose
+{
+    Float3  Position;       //!< 位置座標.
+    Float3  Forward;        //!< 視線方向 (正規化済み).
+    Float3  Upward;         //!< 上向きベクトル (正規化済み, 視線方向と直交).
+    float   FieldOfView;    //!< 垂直画角 (radian).
+    float   NearClip;       //!< ニアクリップ平面.
+    float   FarClip;        //!< ファークリップ平面.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CameraTrack class
+///////////////////////////////////////////////////////////////////////////////
+class CameraTrack
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @note       キーは疎で構いません. キー間の位置は Catmull-Rom 接線の
+    //!             エルミート補間, 向きは球面線形補間, 画角とクリップ平面は
+    //!             線形補間で求めます.
+    //! @param[in]      pKeys       キー配列 (時刻の昇順).
+    //! @param[in]      count       キー数.
+    //! @retval true    初期化に成功.
+    //! @retval false   キーが無いか, 時刻が昇順になっていません.
+    //-------------------------------------------------------------------------
+    bool Init(const CameraKey* pKeys, size_t count);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定時刻のカメラを求めます.
+    //!
+    //! @note       任意の時刻に直接シークでき, 小数のフレームも評価できます.
+    //!             範囲外の時刻は先頭・末尾のキーに固定されます.
+    //! @param[in]      time        時刻 (フレーム単位).
+    //! @return     カメラ姿勢を返却します.
+    //-------------------------------------------------------------------------
+    CameraPose Evaluate(double time) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定時刻を含む区間の先頭キー番号を二分探索で求めます.
+    //-------------------------------------------------------------------------
+    size_t FindSegment(double time) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      キー数を取得します.
+    //-------------------------------------------------------------------------
+    size_t GetKeyCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      先頭キーの時刻を取得します.
+    //-------------------------------------------------------------------------
+    double GetBeginTime() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      末尾キーの時刻を取得します.
+    //-------------------------------------------------------------------------
+    double GetEndTime() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Key structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Key
+    {
+        double  Time;           //!< 時刻.
+        Float3  Position;       //!< 位置座標.
+        Float3  Tangent;        //!< 位置の接線 (1フレームあたり).
+        float   Rotation[4];    //!< 向き (クォータニオン x, y, z, w).
+        float   FieldOfView;    //!< 垂直画角.
+        float   NearClip;       //!< ニアクリップ平面.
+        float   FarClip;        //!< ファークリップ平面.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<Key>    m_Keys;
+    std::vector<double> m_Times;    //!< 二分探索用に詰めたキー時刻.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    /* NOTHING */
+};
+
+} // namespace r3d
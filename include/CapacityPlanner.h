@@ -0,0 +1,87 @@
+﻿//-----------------------------------------------------------------------------
+// File : CapacityPlanner.h
+// Desc : Chunked Capacity Planner.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// CapacityPlanner class
+///////////////////////////////////////////////////////////////////////////////
+class CapacityPlanner
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      chunkCount  容量の増減単位となる要素数.
+    //! @param[in]      maxCount    最大要素数.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint32_t chunkCount, uint32_t maxCount);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      必要な要素数を収める容量を求めます.
+    //!
+    //! @note       足りない場合は現在の容量の1.5倍と必要数の大きい方を
+    //!             チャンク単位に切り上げます. 収まる場合は現在の容量を返します.
+    //! @param[in]      capacity        現在の容量.
+    //! @param[in]      requiredCount   必要な要素数.
+    //! @param[out]     result          新しい容量.
+    //! @retval true    容量が求まりました.
+    //! @retval false   最大要素数を超えています.
+    //-------------------------------------------------------------------------
+    bool Plan(uint32_t capacity, uint64_t requiredCount, uint32_t& result) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      チャンクの要素数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetChunkCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      最大要素数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetMaxCount() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    uint32_t    m_ChunkCount = 0;
+    uint32_t    m_MaxCount   = 0;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    /* NOTHING */
+};
+
+} // namespace r3d
@@ -0,0 +1,252 @@
+﻿//-----------------------------------------------------------------------------
+// File : CaptureJournal.h
+// Desc : Capture Checkpoint Journal.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// CaptureJournalDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct CaptureJournalDesc
+{
+    const char* Path;           //!< ジャーナルファイルパス. nullptr の場合はファイルに記録しません.
+    uint64_t    SequenceHash;   //!< 出力設定のハッシュ. 一致しないジャーナルは破棄して最初から描画します.
+    uint32_t    FrameCount;     //!< 総フレーム数.
+    uint32_t    OutputCount;    //!< 1フレームあたりの出力ファイル数 (1 ～ 8).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CaptureState structure
+///////////////////////////////////////////////////////////////////////////////
+struct CaptureState
+{
+    double      ElapsedSec;         //!< 全てのセッションを通した経過時間[sec].
+    double      FrameTimeSec;       //!< 1フレームあたりの描画時間[sec].
+    uint32_t    CaptureIndex;       //!< 次にキャプチャするフレーム番号.
+    uint32_t    RenderFrameCount;   //!< 描画したフレーム数 (乱数のシードに使用).
+    uint32_t    JitterIndex;        //!< テンポラルジッターの番号.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CaptureJournalStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct CaptureJournalStats
+{
+    uint32_t    ResumedCount;       //!< 以前のセッションで完了していたフレーム数.
+    uint32_t    RejectedCount;      //!< 記録はあるが検証に失敗したフレーム数.
+    uint32_t    CompletedCount;     //!< 完了したフレーム数 (以前のセッションの分を含む).
+    uint32_t    FailCount;          //!< ジャーナルの書き込みに失敗した回数.
+    double      VerifySec;          //!< 再開時の検証に掛かった時間[sec].
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CaptureJournal class
+///////////////////////////////////////////////////////////////////////////////
+class CaptureJournal
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    CaptureJournal() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~CaptureJournal();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @note       ジャーナルが既にあれば読み込み, 記録された出力ファイルのサイズと
+    //!             ハッシュを検証します. 全ての出力ファイルを確認できたフレームだけを
+    //!             完了済みとし, 有効な記録だけでジャーナルを書き直してから追記を始めます.
+    //!             末尾の書きかけの記録はチェックサムで検出して捨てます.
+    //! @param[in]      desc        構成設定.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const CaptureJournalDesc& desc);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //!
+    //! @note       全てのフレームが完了していればジャーナルファイルを削除します.
+    //!             次の実行は再開せずに最初から描画します.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      以前のセッションの状態を引き継いだかどうか.
+    //-------------------------------------------------------------------------
+    bool IsResumed() const
+    { return m_Resumed; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      以前のセッションで最後に記録した状態を取得します.
+    //!
+    //! @note       IsResumed() が false の場合は全て 0 です.
+    //-------------------------------------------------------------------------
+    const CaptureState& GetResumeState() const
+    { return m_ResumeState; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      総フレーム数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetFrameCount() const
+    { return m_FrameCount; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      全ての出力ファイルを書き終えたフレームかどうか.
+    //-------------------------------------------------------------------------
+    bool IsCompleted(uint32_t frameIndex) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      未完了のフレームを検索します.
+    //!
+    //! @param[in]      frameIndex  検索を開始するフレーム番号.
+    //! @return     frameIndex 以降で最初の未完了のフレーム番号を返却します.
+    //!             見つからない場合は総フレーム数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t FindPending(uint32_t frameIndex) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      未完了のフレーム数を数えます.
+    //!
+    //! @param[in]      frameIndex  数え始めるフレーム番号.
+    //! @return     frameIndex 以降の未完了のフレーム数を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t CountPending(uint32_t frameIndex) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      出力ファイルの書き込みが完了したことを記録します.
+    //!
+    //! @note       フレームの全ての出力ファイルが揃った時点で完了済みになります.
+    //!             記録はファイルに同期してから戻ります. 複数のスレッドから同時に呼び出せます.
+    //! @param[in]      frameIndex  フレーム番号.
+    //! @param[in]      slot        出力ファイルの番号 (0 ～ OutputCount - 1).
+    //! @param[in]      path        ファイルパス.
+    //! @param[in]      size        ファイルサイズ[byte].
+    //! @param[in]      hash        ファイルの内容の XXH3 ハッシュ.
+    //! @retval true    記録に成功.
+    //! @retval false   記録に失敗.
+    //-------------------------------------------------------------------------
+    bool AddOutput(uint32_t frameIndex, uint32_t slot, const char* path, uint64_t size, uint64_t hash);
+
+    //-------------------------------------------------------------------------
+    //! @brief      書き込み済みのファイルを読み込んで記録します.
+    //!
+    //! @note       ハードリンクやコピーで作成したファイルのように, 内容が手元に無い場合に使います.
+    //! @param[in]      frameIndex  フレーム番号.
+    //! @param[in]      slot        出力ファイルの番号 (0 ～ OutputCount - 1).
+    //! @param[in]      path        ファイルパス.
+    //! @retval true    記録に成功.
+    //! @retval false   ファイルの読み込みまたは記録に失敗.
+    //-------------------------------------------------------------------------
+    bool AddOutputFile(uint32_t frameIndex, uint32_t slot, const char* path);
+
+    //-------------------------------------------------------------------------
+    //! @brief      描画の状態を記録します.
+    //!
+    //! @note       再開時には最後に記録した状態を GetResumeState() で取得できます.
+    //! @param[in]      state       描画の状態.
+    //! @retval true    記録に成功.
+    //! @retval false   記録に失敗.
+    //-------------------------------------------------------------------------
+    bool SaveState(const CaptureState& state);
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計情報を取得します.
+    //-------------------------------------------------------------------------
+    CaptureJournalStats GetStats() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Output structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Output
+    {
+        uint32_t    FrameIndex;
+        uint32_t    Slot;
+        uint64_t    Size;
+        uint64_t    Hash;
+        std::string Path;
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    mutable std::mutex      m_Mutex;
+    FILE*                   m_pFile         = nullptr;  //!< 追記中のジャーナル (m_Mutex で保護).
+    std::string             m_Path;                     //!< ジャーナルファイルパス.
+    uint32_t                m_FrameCount    = 0;
+    uint32_t                m_OutputCount   = 0;
+    uint8_t                 m_CompleteMask  = 0;        //!< 全ての出力ファイルが揃ったときのマスク.
+    std::vector<uint8_t>    m_OutputMasks;              //!< フレームごとの書き込み済みの出力ファイル (m_Mutex で保護).
+    bool                    m_Resumed       = false;
+    CaptureState            m_ResumeState   = {};
+    CaptureJournalStats     m_Stats         = {};       //!< 統計情報 (m_Mutex で保護).
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    CaptureJournal  (const CaptureJournal&) = delete;
+    void operator = (const CaptureJournal&) = delete;
+
+    bool Load   (const char* path, uint64_t sequenceHash, std::vector<Output>& outputs);
+    bool Rewrite(const char* path, uint64_t sequenceHash, const std::vector<Output>& outputs);
+    bool Append (uint32_t type, const std::vector<uint8_t>& payload);
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      描画の締め切りを計算します.
+//!
+//! @note       締め切りは全てのセッションを通した経過時間で表します.
+//!             再開時に残り時間が足りない場合でも, 未完了のフレームごとに
+//!             minFrameSec を確保して描き切れるようにします.
+//! @param[in]      totalSec        全体の描画時間[sec].
+//! @param[in]      elapsedSec      経過時間[sec].
+//! @param[in]      pendingCount    未完了のフレーム数.
+//! @param[in]      minFrameSec     1フレームあたりに確保する最低限の時間[sec].
+//! @return     締め切り[sec]を返却します.
+//-----------------------------------------------------------------------------
+double CalcRenderDeadline(double totalSec, double elapsedSec, uint32_t pendingCount, double minFrameSec);
+
+//-----------------------------------------------------------------------------
+//! @brief      残り時間を未完了のフレームに割り振ります.
+//!
+//! @param[in]      deadlineSec     締め切り[sec].
+//! @param[in]      elapsedSec      経過時間[sec].
+//! @param[in]      pendingCount    未完了のフレーム数.
+//! @return     1フレームあたりの描画時間[sec]を返却します. 未完了のフレームが無い場合は残り時間です.
+//-----------------------------------------------------------------------------
+double CalcFrameTimeBudget(double deadlineSec, double elapsedSec, uint32_t pendingCount);
+
+} // namespace r3d
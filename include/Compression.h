@@ -0,0 +1,48 @@
+﻿//-----------------------------------------------------------------------------
+// File : Compression.h
+// Desc : Block Compression.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// COMPRESSION_CODEC enum
+///////////////////////////////////////////////////////////////////////////////
+enum COMPRESSION_CODEC
+{
+    COMPRESSION_CODEC_NONE  = 0,    //!< 無圧縮.
+    COMPRESSION_CODEC_LZ4   = 1,    //!< LZ4 ブロック形式.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      LZ4 ブロック形式で圧縮します.
+//!
+//! @param[in]      src         圧縮するデータ.
+//! @param[in]      srcSize     圧縮するデータのバイト数.
+//! @param[out]     result      圧縮データの格納先.
+//-----------------------------------------------------------------------------
+void CompressLZ4(const uint8_t* src, size_t srcSize, std::vector<uint8_t>& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      LZ4 ブロック形式のデータを展開します.
+//!
+//! @param[in]      src         圧縮データ.
+//! @param[in]      srcSize     圧縮データのバイト数.
+//! @param[out]     dst         展開先.
+//! @param[in]      dstSize     展開後のバイト数.
+//! @retval true    展開に成功.
+//! @retval false   データが壊れています.
+//-----------------------------------------------------------------------------
+bool DecompressLZ4(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+
+} // namespace r3d
@@ -0,0 +1,111 @@
+﻿//-----------------------------------------------------------------------------
+// File : Deflate.h
+// Desc : Fast Deflate Compressor / Decompressor.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//! @brief      符号化テーブルを初期化します.
+//!
+//! @note       ワーカースレッドを起動する前に呼び出しておくと，初回の圧縮で待たされません.
+//-----------------------------------------------------------------------------
+void InitDeflate();
+
+//-----------------------------------------------------------------------------
+//! @brief      Adler-32 を更新します.
+//!
+//! @param[in]      adler       これまでの値 (初期値は 1).
+//! @param[in]      pData       データ.
+//! @param[in]      size        データサイズ.
+//! @return     更新した Adler-32 を返却します.
+//-----------------------------------------------------------------------------
+uint32_t UpdateAdler32(uint32_t adler, const uint8_t* pData, size_t size);
+
+//-----------------------------------------------------------------------------
+//! @brief      連続する2つのデータの Adler-32 を結合します.
+//!
+//! @param[in]      adler1      前半の Adler-32.
+//! @param[in]      adler2      後半の Adler-32.
+//! @param[in]      size2       後半のデータサイズ.
+//! @return     連結したデータの Adler-32 を返却します.
+//-----------------------------------------------------------------------------
+uint32_t CombineAdler32(uint32_t adler1, uint32_t adler2, uint64_t size2);
+
+//-----------------------------------------------------------------------------
+//! @brief      Deflate ブロックに圧縮して追加します.
+//!
+//! @note       stride バイトごとに区切った行の中で，matchDist バイト前との一致だけを探します.
+//!             動的ハフマン符号より小さくなる場合は無圧縮ブロックで出力します.
+//!             final が false の場合は空の無圧縮ブロックでバイト境界に揃えるので，
+//!             別々に圧縮したブロックをそのまま連結できます.
+//! @param[in]      pSrc        圧縮するデータ.
+//! @param[in]      size        データサイズ.
+//! @param[in]      stride      一致を探す範囲の区切り[byte].
+//! @param[in]      matchDist   一致を探す距離[byte] (1 ～ 32768).
+//! @param[in]      final       ストリームの最後のブロックなら true.
+//! @param[out]     result      圧縮データの追加先.
+//-----------------------------------------------------------------------------
+void Deflate(
+    const uint8_t*          pSrc,
+    uint32_t                size,
+    uint32_t                stride,
+    uint32_t                matchDist,
+    bool                    final,
+    std::vector<uint8_t>&   result);
+
+//-----------------------------------------------------------------------------
+//! @brief      zlib 形式で圧縮します.
+//!
+//! @param[in]      pSrc        圧縮するデータ.
+//! @param[in]      size        データサイズ.
+//! @param[in]      matchDist   一致を探す距離[byte] (1 ～ 32768).
+//! @param[out]     result      zlib ストリーム.
+//-----------------------------------------------------------------------------
+void CompressZlib(
+    const uint8_t*          pSrc,
+    uint32_t                size,
+    uint32_t                matchDist,
+    std::vector<uint8_t>&   result);
+
+//-----------------------------------------------------------------------------
+//! @brief      Deflate ストリームを展開します.
+//!
+//! @note       壊れたデータでも入力の範囲外は読み込みません.
+//! @param[in]      pSrc        Deflate ストリーム.
+//! @param[in]      size        データサイズ.
+//! @param[out]     result      展開したデータ.
+//! @retval true    展開に成功.
+//! @retval false   データが壊れています.
+//-----------------------------------------------------------------------------
+bool Inflate(
+    const uint8_t*          pSrc,
+    size_t                  size,
+    std::vector<uint8_t>&   result);
+
+//-----------------------------------------------------------------------------
+//! @brief      zlib 形式を展開します.
+//!
+//! @note       ヘッダーと Adler-32 も検証します.
+//! @param[in]      pSrc        zlib ストリーム.
+//! @param[in]      size        データサイズ.
+//! @param[out]     result      展開したデータ.
+//! @retval true    展開に成功.
+//! @retval false   データが壊れています.
+//-----------------------------------------------------------------------------
+bool DecompressZlib(
+    const uint8_t*          pSrc,
+    size_t                  size,
+    std::vector<uint8_t>&   result);
+
+} // namespace r3d
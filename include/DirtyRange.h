@@ -0,0 +1,114 @@
+﻿//-----------------------------------------------------------------------------
+// File : DirtyRange.h
+// Desc : Dirty Range Tracker for Multi-Buffered Resources.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// DirtyRange structure
+///////////////////////////////////////////////////////////////////////////////
+struct DirtyRange
+{
+    uint32_t    Offset;     //!< 先頭の要素番号.
+    uint32_t    Count;      //!< 要素数.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DirtyRangeTracker class
+///////////////////////////////////////////////////////////////////////////////
+class DirtyRangeTracker
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      slotCount   バッファの面数.
+    //! @param[in]      mergeGap    この要素数以下の隙間は結合して1つの範囲にします.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint32_t slotCount, uint32_t mergeGap);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      全ての面に対して変更を記録します.
+    //!
+    //! @note       同じ要素を何度記録しても範囲は増えません.
+    //! @param[in]      offset      先頭の要素番号.
+    //! @param[in]      count       要素数.
+    //-------------------------------------------------------------------------
+    void Mark(uint32_t offset, uint32_t count = 1);
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定面の変更範囲を結合して取り出します.
+    //!
+    //! @note       取り出した範囲はその面から消去されます.
+    //!             結果は要素番号の昇順で，互いに重なりません.
+    //! @param[in]      slot        面番号.
+    //! @param[out]     result      変更範囲.
+    //-------------------------------------------------------------------------
+    void Flush(uint32_t slot, std::vector<DirtyRange>& result);
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定面に変更があるかどうか?
+    //-------------------------------------------------------------------------
+    bool IsDirty(uint32_t slot) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      面数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetSlotCount() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Slot structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Slot
+    {
+        std::vector<uint64_t>   Bits;       //!< 要素ごとの変更フラグ.
+        size_t                  BeginWord;  //!< 変更のある先頭ワード.
+        size_t                  EndWord;    //!< 変更のある終端ワード.
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<Slot>   m_Slots;
+    uint32_t            m_MergeGap = 0;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    /* NOTHING */
+};
+
+} // namespace r3d
@@ -0,0 +1,293 @@
+﻿//-----------------------------------------------------------------------------
+// File : EncoderPool.h
+// Desc : Persistent Frame Encoder Worker Pool.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// BoundedQueue class
+///////////////////////////////////////////////////////////////////////////////
+class BoundedQueue
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      capacity    格納できる最大要素数.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint32_t capacity);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //!
+    //! @note       待機中のスレッドが無い状態で呼び出してください.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      末尾に追加します.
+    //!
+    //! @note       満杯の場合は空きができるまで待ちます. 複数スレッドから呼び出せます.
+    //! @retval true    追加に成功.
+    //! @retval false   閉じられているため追加できませんでした.
+    //-------------------------------------------------------------------------
+    bool Push(uint32_t value);
+
+    //-------------------------------------------------------------------------
+    //! @brief      先頭から取り出します.
+    //!
+    //! @note       空の場合は追加されるまで待ちます.
+    //! @retval true    取り出しに成功.
+    //! @retval false   閉じられていて空のため取り出せませんでした.
+    //-------------------------------------------------------------------------
+    bool Pop(uint32_t& value);
+
+    //-------------------------------------------------------------------------
+    //! @brief      待たずに先頭から取り出します.
+    //!
+    //! @retval true    取り出しに成功.
+    //! @retval false   空でした.
+    //-------------------------------------------------------------------------
+    bool TryPop(uint32_t& value);
+
+    //-------------------------------------------------------------------------
+    //! @brief      キューを閉じて待機中のスレッドを全て起こします.
+    //!
+    //! @note       閉じた後も残っている要素は Pop() で取り出せます.
+    //-------------------------------------------------------------------------
+    void Close();
+
+    //-------------------------------------------------------------------------
+    //! @brief      要素数が指定数以上になるまで待ちます.
+    //-------------------------------------------------------------------------
+    void WaitCount(uint32_t count);
+
+    //-------------------------------------------------------------------------
+    //! @brief      要素数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      最大要素数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetCapacity() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    mutable std::mutex          m_Mutex;
+    std::condition_variable     m_NotEmpty;
+    std::condition_variable     m_NotFull;
+    std::vector<uint32_t>       m_Items;        //!< リングバッファ.
+    uint32_t                    m_Head      = 0;
+    uint32_t                    m_Count     = 0;
+    bool                        m_Closed    = false;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    /* NOTHING */
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CaptureFrame structure
+///////////////////////////////////////////////////////////////////////////////
+struct CaptureFrame
+{
+    std::vector<uint8_t>    Pixels;         //!< 画素データ (RGBA8).
+    uint32_t                FrameIndex;     //!< フレーム番号.
+    uint32_t                Width;          //!< 横幅[px].
+    uint32_t                Height;         //!< 縦幅[px].
+    uint32_t                Pitch;          //!< 1行のバイト数.
+    uint32_t                SourceIndex;    //!< 同じ内容を出力済みのフレーム番号. 重複していない場合は FrameIndex と同じ.
+    std::vector<uint8_t>    HdrPixels;      //!< 線形放射輝度 (RGBA16F). HDR キャプチャが無効な場合は空.
+    uint32_t                HdrWidth;       //!< HDR の横幅[px].
+    uint32_t                HdrHeight;      //!< HDR の縦幅[px].
+    uint32_t                HdrPitch;       //!< HDR の1行のバイト数.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// IEncodeHandler interface
+///////////////////////////////////////////////////////////////////////////////
+struct IEncodeHandler
+{
+    virtual ~IEncodeHandler() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームをエンコードして出力します.
+    //!
+    //! @note       ワーカースレッドから並列に呼び出されます.
+    //!             同じワーカー番号で同時に呼び出されることはないので，
+    //!             作業用メモリはワーカー番号ごとに持てば排他は不要です.
+    //! @param[in]      workerIndex     ワーカー番号.
+    //! @param[in]      frame           キャプチャーしたフレーム.
+    //! @retval true    出力に成功.
+    //! @retval false   出力に失敗.
+    //-------------------------------------------------------------------------
+    virtual bool Encode(uint32_t workerIndex, const CaptureFrame& frame) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// EncoderPoolDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct EncoderPoolDesc
+{
+    uint32_t            WorkerCount;    //!< ワーカースレッド数. 0 の場合はハードウェアスレッド数.
+    uint32_t            BufferCount;    //!< 同時に処理できるフレーム数. 0 の場合はワーカー数の2倍.
+    uint64_t            BufferSize;     //!< 1フレームのバッファサイズ[byte].
+    uint64_t            HdrBufferSize;  //!< 1フレームの HDR バッファサイズ[byte]. 0 の場合は確保しない.
+    IEncodeHandler*     pHandler;       //!< エンコード処理.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// EncoderPoolStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct EncoderPoolStats
+{
+    uint64_t    SubmitCount;        //!< 投入したフレーム数.
+    uint64_t    CompleteCount;      //!< 出力に成功したフレーム数.
+    uint64_t    FailCount;          //!< 出力に失敗したフレーム数.
+    uint64_t    StallCount;         //!< 空きバッファを待った回数.
+    double      StallSec;           //!< 空きバッファを待った合計時間[sec].
+    double      MaxStallSec;        //!< 空きバッファを待った最大時間[sec].
+    double      EncodeSec;          //!< エンコードに掛かった合計時間[sec].
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// EncoderPool class
+///////////////////////////////////////////////////////////////////////////////
+class EncoderPool
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    EncoderPool() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~EncoderPool();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @note       バッファは全てここで確保され，以降は再利用されます.
+    //! @param[in]      desc        構成設定.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const EncoderPoolDesc& desc);
+
+    //-------------------------------------------------------------------------
+    //! @brief      投入済みのフレームを全て出力してから終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      書き込み用のフレームを取得します.
+    //!
+    //! @note       全てのバッファが処理中の場合は空くまで待ちます (バックプレッシャー).
+    //!             待った時間は統計情報に記録されます.
+    //!             取得したフレームは Submit() か Discard() で必ず返却してください.
+    //! @return     フレームを返却します. 初期化されていない場合は nullptr.
+    //-------------------------------------------------------------------------
+    CaptureFrame* Acquire();
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームのエンコードを依頼します.
+    //-------------------------------------------------------------------------
+    void Submit(CaptureFrame* pFrame);
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームを出力せずに返却します.
+    //-------------------------------------------------------------------------
+    void Discard(CaptureFrame* pFrame);
+
+    //-------------------------------------------------------------------------
+    //! @brief      投入済みのフレームが全て出力されるまで待ちます.
+    //-------------------------------------------------------------------------
+    void Drain();
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計情報を取得します.
+    //-------------------------------------------------------------------------
+    EncoderPoolStats GetStats() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ワーカースレッド数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetWorkerCount() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      バッファ数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetBufferCount() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<CaptureFrame>   m_Frames;
+    std::vector<std::thread>    m_Workers;
+    BoundedQueue                m_FreeList;     //!< 空きバッファ番号. ワーカーが返却し，描画スレッドが取り出す.
+    BoundedQueue                m_Jobs;         //!< エンコード待ちのバッファ番号.
+    IEncodeHandler*             m_pHandler  = nullptr;
+    mutable std::mutex          m_StatsMutex;
+    EncoderPoolStats            m_Stats     = {};
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    EncoderPool     (const EncoderPool&) = delete;
+    void operator = (const EncoderPool&) = delete;
+
+    uint32_t GetIndex(const CaptureFrame* pFrame) const;
+    void     Run     (uint32_t workerIndex);
+};
+
+} // namespace r3d
@@ -0,0 +1,159 @@
+﻿//-----------------------------------------------------------------------------
+// File : ExrEncoder.h
+// Desc : Block Parallel OpenEXR Encoder.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// EXR_COMPRESSION enum
+///////////////////////////////////////////////////////////////////////////////
+enum EXR_COMPRESSION
+{
+    EXR_COMPRESSION_NONE    = 0,    //!< 無圧縮 (1行ごとのブロック).
+    EXR_COMPRESSION_ZIP     = 3,    //!< zlib (16行ごとのブロック).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ExrEncoder class
+///////////////////////////////////////////////////////////////////////////////
+class ExrEncoder
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    ExrEncoder() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~ExrEncoder();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      threadCount     ワーカースレッド数. 0 の場合はハードウェアスレッド数.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint32_t threadCount = 0);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      RGBA16F の画像をスキャンライン形式の OpenEXR にエンコードします.
+    //!
+    //! @note       R, G, B を half のチャンネルとして出力します (A は出力しません).
+    //!             スキャンラインのブロックごとに圧縮をワーカースレッドで行います.
+    //!             呼び出しスレッドも完了を待つ間はブロックの処理を手伝います.
+    //!             複数のスレッドから同時に呼び出せます.
+    //! @param[in]      pPixels     画素データ (RGBA16F).
+    //! @param[in]      width       横幅[px].
+    //! @param[in]      height      縦幅[px].
+    //! @param[in]      pitch       1行のバイト数.
+    //! @param[in]      compression 圧縮方式.
+    //! @param[out]     result      EXR ファイルのデータ.
+    //! @retval true    エンコードに成功.
+    //! @retval false   エンコードに失敗.
+    //-------------------------------------------------------------------------
+    bool Encode(
+        const uint8_t*          pPixels,
+        uint32_t                width,
+        uint32_t                height,
+        uint32_t                pitch,
+        EXR_COMPRESSION         compression,
+        std::vector<uint8_t>&   result);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ワーカースレッド数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetThreadCount() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Job structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Job;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Task structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Task
+    {
+        Job*        pJob;
+        uint32_t    BeginBlock;
+        uint32_t    EndBlock;
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<std::thread>    m_Threads;
+    std::mutex                  m_Mutex;
+    std::condition_variable     m_TaskCond;     //!< タスク追加の通知.
+    std::condition_variable     m_DoneCond;     //!< ジョブ完了の通知.
+    std::deque<Task>            m_Tasks;        //!< 未処理のブロック (m_Mutex で保護).
+    bool                        m_Quit = false;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    ExrEncoder      (const ExrEncoder&) = delete;
+    void operator = (const ExrEncoder&) = delete;
+
+    void Run    ();
+    void Execute(const Task& task);
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      OpenEXR をデコードします.
+//!
+//! @note       シングルパートのスキャンライン画像で, 無圧縮, ZIPS, ZIP に対応します.
+//!             R, G, B, A (無ければ 1), または Y だけの画像をグレーとして読み込みます.
+//! @param[in]      pData       ファイルのデータ.
+//! @param[in]      size        データサイズ.
+//! @param[out]     pixels      画素データ (RGBA32F, 行間無し).
+//! @param[out]     width       横幅[px].
+//! @param[out]     height      縦幅[px].
+//! @retval true    デコードに成功.
+//! @retval false   デコードに失敗.
+//-----------------------------------------------------------------------------
+bool DecodeExr(
+    const uint8_t*          pData,
+    size_t                  size,
+    std::vector<float>&     pixels,
+    uint32_t&               width,
+    uint32_t&               height);
+
+} // namespace r3d
@@ -0,0 +1,146 @@
+﻿//-----------------------------------------------------------------------------
+// File : FrameDedup.h
+// Desc : Duplicate Capture Frame Detection.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// FrameDedupDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct FrameDedupDesc
+{
+    uint32_t    Width;          //!< 横幅[px].
+    uint32_t    Height;         //!< 縦幅[px].
+    uint32_t    Tolerance;      //!< チャンネルごとの許容差. 0 の場合はビット単位で一致したものだけを重複とする.
+    uint32_t    TileSize;       //!< 許容差ありで比較するタイルサイズ[px]. 0 の場合は既定値.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// FrameDedupStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct FrameDedupStats
+{
+    uint64_t    CheckCount;         //!< 判定したフレーム数.
+    uint64_t    DuplicateCount;     //!< 重複と判定したフレーム数.
+    uint64_t    CompareTileCount;   //!< ハッシュが一致せず画素を比較したタイル数.
+    uint64_t    WrittenCount;       //!< 出力が完了した出力元のフレーム数.
+    double      CheckSec;           //!< 判定に掛かった合計時間[sec].
+    double      EncodeSec;          //!< 出力元のフレームのエンコードに掛かった合計時間[sec].
+    double      SavedSec;           //!< 重複フレームのエンコードを省略して削減した時間の見積もり[sec].
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// FrameDedup class
+///////////////////////////////////////////////////////////////////////////////
+class FrameDedup
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      desc        構成設定.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const FrameDedupDesc& desc);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      直前に出力したフレームと同じ内容かどうか判定します.
+    //!
+    //! @note       フレーム番号の順に1つのスレッドから呼び出してください.
+    //!             許容差が 0 の場合はフレーム全体の XXH3 を比較します.
+    //!             許容差がある場合はタイルごとの XXH3 を比較し, 一致しないタイルだけ
+    //!             画素の差を調べます. 比較対象は最後に重複でないと判定したフレームなので,
+    //!             少しずつ変化する場合でも差が蓄積して見逃すことはありません.
+    //! @param[in]      frameIndex  フレーム番号.
+    //! @param[in]      pPixels     画素データ (RGBA8).
+    //! @param[in]      pitch       1行のバイト数.
+    //! @return     同じ内容の出力元のフレーム番号を返却します. 重複していない場合は frameIndex を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Check(uint32_t frameIndex, const uint8_t* pPixels, uint32_t pitch);
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームの出力が完了したことを通知します.
+    //!
+    //! @note       Check() で重複でないと判定したフレームは, 成否に関わらず必ず呼び出してください.
+    //!             複数のスレッドから同時に呼び出せます.
+    //! @param[in]      frameIndex  フレーム番号.
+    //! @param[in]      success     出力に成功した場合は true.
+    //! @param[in]      encodeSec   エンコードに掛かった時間[sec] (削減時間の見積もりに使用).
+    //-------------------------------------------------------------------------
+    void MarkWritten(uint32_t frameIndex, bool success, double encodeSec);
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームの出力が完了するまで待ちます.
+    //!
+    //! @param[in]      frameIndex  Check() が返却した出力元のフレーム番号.
+    //! @retval true    出力に成功しています.
+    //! @retval false   出力に失敗しています.
+    //-------------------------------------------------------------------------
+    bool WaitWritten(uint32_t frameIndex);
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計情報を取得します.
+    //-------------------------------------------------------------------------
+    FrameDedupStats GetStats() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    uint32_t                    m_Width         = 0;
+    uint32_t                    m_Height        = 0;
+    uint32_t                    m_Tolerance     = 0;
+    uint32_t                    m_TileSize      = 0;
+    uint32_t                    m_SourceIndex   = 0;        //!< 最後に重複でないと判定したフレーム番号.
+    bool                        m_HasSource     = false;
+    uint64_t                    m_SourceHash    = 0;        //!< 出力元のフレーム全体のハッシュ.
+    std::vector<uint64_t>       m_TileHashes;               //!< 出力元のタイルごとのハッシュ.
+    std::vector<uint64_t>       m_CurrHashes;               //!< 判定中のタイルごとのハッシュ.
+    std::vector<uint8_t>        m_Source;                   //!< 出力元の画素データ (許容差ありの場合のみ).
+
+    mutable std::mutex          m_Mutex;
+    std::condition_variable     m_WrittenCond;              //!< 出力完了の通知.
+    std::vector<uint8_t>        m_Status;                   //!< フレームごとの出力状態 (m_Mutex で保護).
+    FrameDedupStats             m_Stats         = {};       //!< 統計情報 (m_Mutex で保護).
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    bool IsSimilar(const uint8_t* pPixels, uint32_t pitch, uint64_t& compareCount);
+    void SetSource(uint32_t frameIndex, const uint8_t* pPixels, uint32_t pitch);
+    void CalcTileHashes(const uint8_t* pPixels, uint32_t pitch, std::vector<uint64_t>& result) const;
+};
+
+} // namespace r3d
@@ -0,0 +1,95 @@
+﻿//-----------------------------------------------------------------------------
+// File : ImageCompare.h
+// Desc : Image Comparison Metrics.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// CompareImage structure
+///////////////////////////////////////////////////////////////////////////////
+struct CompareImage
+{
+    uint32_t            Width   = 0;
+    uint32_t            Height  = 0;
+    std::vector<float>  Pixels;     //!< 表示値 [0, 1] の R, G, B を平面ごとに並べたデータ (行間無し).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CompareResult structure
+///////////////////////////////////////////////////////////////////////////////
+struct CompareResult
+{
+    double              Mse;            //!< 平均二乗誤差 (RGB, 表示値).
+    double              Psnr;           //!< PSNR[dB]. 一致する場合は無限大.
+    double              Ssim;           //!< 輝度の SSIM (8x8 窓, 4px 間隔).
+    double              Flip;           //!< FLIP 相当の知覚誤差の平均 [0, 1].
+    double              MaxTileError;   //!< タイルごとの知覚誤差の平均の最大値.
+    uint32_t            MaxTileX;       //!< 最大誤差のタイルの左上座標[px].
+    uint32_t            MaxTileY;       //!< 最大誤差のタイルの左上座標[px].
+    uint32_t            TileSize;       //!< タイルサイズ[px].
+    uint32_t            TileCountX;     //!< 横方向のタイル数.
+    uint32_t            TileCountY;     //!< 縦方向のタイル数.
+    std::vector<float>  TileErrors;     //!< タイルごとの知覚誤差の平均.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      比較用に画像ファイルを読み込みます.
+//!
+//! @note       PNG, QOI, OpenEXR に対応し, 拡張子ではなく先頭のシグネチャで判別します.
+//!             OpenEXR はリニアな値を x / (1 + x) でトーンマップしてから sRGB で
+//!             エンコードするので, 1 を超える領域の差も誤差として現れます.
+//! @param[in]      path        ファイルパス.
+//! @param[out]     result      読み込んだ画像.
+//! @retval true    読み込みに成功.
+//! @retval false   読み込みに失敗.
+//-----------------------------------------------------------------------------
+bool LoadCompareImage(const char* path, CompareImage& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      2つの画像を比較します.
+//!
+//! @note       知覚誤差は FLIP の色差 (空間フィルタ後の HyAB) とエッジの差を組み合わせた
+//!             近似です. CSF は1つの Gaussian で, エッジは Sobel で近似し, 点特徴の検出は省略しています.
+//!             AVX2 (FMA) が使える場合は 8 画素, SSE2 の場合は 4 画素単位で処理します.
+//!             作業領域はスレッドごとに確保するので, 複数のスレッドから同時に呼び出せます.
+//! @param[in]      reference   基準画像.
+//! @param[in]      test        比較する画像.
+//! @param[in]      tileSize    誤差を集計するタイルサイズ[px]. 0 の場合は既定値.
+//! @param[out]     result      比較結果.
+//! @retval true    比較に成功.
+//! @retval false   画像サイズが一致しません.
+//-----------------------------------------------------------------------------
+bool CompareImages(
+    const CompareImage& reference,
+    const CompareImage& test,
+    uint32_t            tileSize,
+    CompareResult&      result);
+
+//-----------------------------------------------------------------------------
+//! @brief      タイルごとの誤差をヒートマップ画像にします.
+//!
+//! @note       誤差 0 を黒, scale 以上を白として, 赤と黄を経由するカラーマップで塗ります.
+//! @param[in]      result      比較結果.
+//! @param[in]      width       画像の横幅[px].
+//! @param[in]      height      画像の縦幅[px].
+//! @param[in]      scale       白になる誤差.
+//! @param[out]     pixels      画素データ (RGBA8, 行間無し).
+//-----------------------------------------------------------------------------
+void CreateHeatmap(
+    const CompareResult&    result,
+    uint32_t                width,
+    uint32_t                height,
+    float                   scale,
+    std::vector<uint8_t>&   pixels);
+
+} // namespace r3d
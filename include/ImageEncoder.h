@@ -0,0 +1,59 @@
+﻿//-----------------------------------------------------------------------------
+// File : ImageEncoder.h
+// Desc : Image Encoder Interface.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// IMAGE_FORMAT enum
+///////////////////////////////////////////////////////////////////////////////
+enum IMAGE_FORMAT
+{
+    IMAGE_FORMAT_PNG,       //!< PNG (帯分割の並列エンコード).
+    IMAGE_FORMAT_QOI,       //!< QOI (高速な可逆圧縮).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// IImageEncoder interface
+///////////////////////////////////////////////////////////////////////////////
+struct IImageEncoder
+{
+    virtual ~IImageEncoder() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      RGBA8 の画像をエンコードします.
+    //!
+    //! @note       複数のスレッドから同時に呼び出せる必要があります.
+    //! @param[in]      pPixels     画素データ.
+    //! @param[in]      width       横幅[px].
+    //! @param[in]      height      縦幅[px].
+    //! @param[in]      pitch       1行のバイト数.
+    //! @param[out]     result      ファイルのデータ.
+    //! @retval true    エンコードに成功.
+    //! @retval false   エンコードに失敗.
+    //-------------------------------------------------------------------------
+    virtual bool Encode(
+        const uint8_t*          pPixels,
+        uint32_t                width,
+        uint32_t                height,
+        uint32_t                pitch,
+        std::vector<uint8_t>&   result) = 0;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルの拡張子を取得します (ドット無し).
+    //-------------------------------------------------------------------------
+    virtual const char* GetExtension() const = 0;
+};
+
+} // namespace r3d
@@ -0,0 +1,127 @@
+﻿//-----------------------------------------------------------------------------
+// File : MappedFile.h
+// Desc : Memory Mapped File.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstddef>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// MAPPED_FILE_HINT enum
+///////////////////////////////////////////////////////////////////////////////
+enum MAPPED_FILE_HINT
+{
+    MAPPED_FILE_HINT_NORMAL,        //!< 特になし.
+    MAPPED_FILE_HINT_SEQUENTIAL,    //!< 先頭から順にアクセスする.
+    MAPPED_FILE_HINT_RANDOM,        //!< ランダムにアクセスする.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MappedFile class
+///////////////////////////////////////////////////////////////////////////////
+class MappedFile
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    MappedFile() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~MappedFile();
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルを読み取り専用でメモリにマッピングします.
+    //!
+    //! @param[in]      path        ファイルパス.
+    //! @param[in]      hint        アクセスパターンのヒント.
+    //! @retval true    マッピングに成功.
+    //! @retval false   マッピングに失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const char* path, MAPPED_FILE_HINT hint = MAPPED_FILE_HINT_SEQUENTIAL);
+
+    //-------------------------------------------------------------------------
+    //! @brief      マッピングを解除します.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定範囲の先読みを要求します.
+    //!
+    //! @note       非同期に読み込みが開始されるだけで，完了は待ちません.
+    //! @param[in]      ptr         マッピング内の先頭アドレス.
+    //! @param[in]      size        バイト数.
+    //-------------------------------------------------------------------------
+    void Prefetch(const void* ptr, size_t size) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定範囲の物理ページを解放します.
+    //!
+    //! @note       範囲に完全に含まれるページのみが対象です.
+    //!             解放後にアクセスした場合はファイルから再度読み込まれます.
+    //! @param[in]      ptr         マッピング内の先頭アドレス.
+    //! @param[in]      size        バイト数.
+    //-------------------------------------------------------------------------
+    void Release(const void* ptr, size_t size) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      マッピングされたデータを取得します.
+    //-------------------------------------------------------------------------
+    const uint8_t* GetData() const
+    { return m_pData; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルサイズを取得します.
+    //-------------------------------------------------------------------------
+    size_t GetSize() const
+    { return m_Size; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      マッピング済みかどうか?
+    //-------------------------------------------------------------------------
+    bool IsValid() const
+    { return m_pData != nullptr; }
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    const uint8_t*  m_pData     = nullptr;
+    size_t          m_Size      = 0;
+    void*           m_hFile     = nullptr;  //!< Windows のみ使用.
+    void*           m_hMapping  = nullptr;  //!< Windows のみ使用.
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    MappedFile      (const MappedFile&) = delete;
+    void operator = (const MappedFile&) = delete;
+
+    bool GetPageRange(const void* ptr, size_t size, bool inner, uintptr_t& begin, uintptr_t& end) const;
+};
+
+} // namespace r3d
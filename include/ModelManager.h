@@ -13,24 +13,19 @@
 #include <gfx/asdxRayTracing.h>
 #include <gfx/asdxCommandList.h>
 #include <gfx/asdxTexture.h>
-#include <generated/scene_format.h>
+#include <SceneCommon.h>
+#include <BufferArena.h>
+#include <UploadHeap.h>
+#include <DirtyRange.h>
+#include <CapacityPlanner.h>
 
 
 namespace r3d {
 
-static constexpr uint32_t INVALID_MATERIAL_MAP = UINT32_MAX;
-
-
-///////////////////////////////////////////////////////////////////////////////
-// Mesh structure
-///////////////////////////////////////////////////////////////////////////////
-struct Mesh
-{
-    uint32_t      VertexCount;
-    uint32_t      IndexCount;
-    ResVertex*    Vertices;
-    uint32_t*     Indices;
-};
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr uint32_t FRAME_SLOT_COUNT = 3;    // 毎フレーム書き換えるバッファの面数.
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -100,7 +95,6 @@ struct CpuInstance
 struct InstanceHandle
 {
     uint32_t                    InstanceId; //!< インスタンスID.
-    D3D12_GPU_VIRTUAL_ADDRESS   AddressTB;  //!< トランスフォームバッファのGPU仮想アドレスです.
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -119,8 +113,8 @@ public:
     ///////////////////////////////////////////////////////////////////////////
     struct MeshBuffer
     {
-        asdx::RefPtr<ID3D12Resource>            VB;
-        asdx::RefPtr<ID3D12Resource>            IB;
+        ArenaAllocation                         Allocation;     //!< 頂点とインデックスをまとめた領域.
+        uint64_t                                OffsetIB;       //!< 領域先頭からインデックスまでのオフセット.
         asdx::RefPtr<asdx::IShaderResourceView> VB_SRV;
         asdx::RefPtr<asdx::IShaderResourceView> IB_SRV;
         uint32_t                                VertexCount;
@@ -149,59 +143,125 @@ public:
     //-------------------------------------------------------------------------
     //! @brief      初期化処理を行います.
     //! 
-    //! @param[in]      maxInstanceCount    最大インスタンス数です.
-    //! @param[in]      maxMaterialCount    最大マテリアル数です.
+    //! @note       インスタンス・マテリアルのバッファは指定数から確保し，
+    //!             登録時に足りなくなればチャンク単位で拡張します.
+    //! @param[in]      pUploadHeap         メッシュのコピーに使うアップロードヒープです.
+    //! @param[in]      instanceCount       初期容量とするインスタンス数です.
+    //! @param[in]      materialCount       初期容量とするマテリアル数です.
     //! @retval true    初期化に成功.
     //! @retval false   初期化に失敗.
     //-------------------------------------------------------------------------
     bool Init(
         ID3D12GraphicsCommandList6* pCmdList,
-        uint32_t maxInstanceCount,
-        uint32_t maxMaterialCount);
+        UploadHeap* pUploadHeap,
+        uint32_t instanceCount,
+        uint32_t materialCount);
 
     //-------------------------------------------------------------------------
     //! @brief      終了処理を行います.
     //-------------------------------------------------------------------------
     void Term();
 
-    //-------------------------------------------------------------------------
-    //! @brief      メモリマッピングを解除します.
-    //-------------------------------------------------------------------------
-    void Fixed();
-
     //-------------------------------------------------------------------------
     //! @brief      メッシュを登録します.
     //! 
+    //! @note       頂点とインデックスはアップロードヒープ経由で
+    //!             デフォルトヒープのブロックにコピーされます.
+    //!             FlushMeshes() を呼び出すまでGPUから参照できません.
+    //! @param[in]      pCmdList    コピーコマンドを積むコマンドリスト.
     //! @param[in]      mesh        登録するメッシュ.
     //! @return     ジオメトリハンドルを返却します.
     //-------------------------------------------------------------------------
-    GeometryHandle AddMesh(const Mesh& mesh);
+    GeometryHandle AddMesh(ID3D12GraphicsCommandList6* pCmdList, const Mesh& mesh);
 
     //-------------------------------------------------------------------------
     //! @brief      インスタンスを登録します.
     //! 
+    //! @note       容量を拡張してもインスタンスIDは変わりません.
     //! @param[in]      instance        インスタンスデータ.
-    //! @param[in]      transform       変換行列.
-    //! @return     インスタンスハンドルを返却します.
+    //! @return     インスタンスハンドルを返却します. 失敗時の InstanceId は UINT32_MAX です.
     //-------------------------------------------------------------------------
     InstanceHandle AddInstance(const CpuInstance& instance);
 
     //-------------------------------------------------------------------------
     //! @brief      マテリアルを登録します.
     //! 
+    //! @note       容量を拡張するとバッファが作り直されるため，
+    //!             返却したアドレスは次の拡張まで有効です.
     //! @param[in]      ptr     マテリアルデータ.
     //! @param[in]      count   マテリアル数.
-    //! @return     GPU仮想アドレスを返却します.
+    //! @return     GPU仮想アドレスを返却します. 失敗時は 0 を返却します.
     //-------------------------------------------------------------------------
     D3D12_GPU_VIRTUAL_ADDRESS AddMaterials(const Material* ptr, uint32_t count);
 
     //-------------------------------------------------------------------------
-    //! @brief      インスタンスバッファのシェーダリソースビューを取得します.
+    //! @brief      登録済みメッシュの頂点・インデックスを書き換えます.
+    //! 
+    //! @note       頂点数とインデックス数は登録時と同じである必要があります.
+    //!             FlushMeshes() を呼び出すまでGPUから参照できません.
+    //! @param[in]      pCmdList    コピーコマンドを積むコマンドリスト.
+    //! @param[in]      index       メッシュ番号.
+    //! @param[in]      mesh        メッシュ.
+    //! @retval true    更新に成功.
+    //! @retval false   更新に失敗.
+    //-------------------------------------------------------------------------
+    bool UpdateMesh(ID3D12GraphicsCommandList6* pCmdList, uint32_t index, const Mesh& mesh);
+
+    //-------------------------------------------------------------------------
+    //! @brief      コピー先になったメッシュバッファをまとめて読み取りステートに戻します.
+    //! 
+    //! @param[in]      pCmdList    コマンドリスト.
+    //-------------------------------------------------------------------------
+    void FlushMeshes(ID3D12GraphicsCommandList6* pCmdList);
+
+    //-------------------------------------------------------------------------
+    //! @brief      登録済みインスタンスの変換行列とマテリアルを書き換えます.
+    //! 
+    //! @note       変更は BeginFrame() で各面のバッファに反映されます.
+    //! @param[in]      instanceId  インスタンスID.
+    //! @param[in]      instance    インスタンスデータ (MeshId は変更できません).
+    //-------------------------------------------------------------------------
+    void UpdateInstance(uint32_t instanceId, const CpuInstance& instance);
+
+    //-------------------------------------------------------------------------
+    //! @brief      登録済みインスタンスの変換行列を書き換えます.
+    //! 
+    //! @note       変更は BeginFrame() で各面のバッファに反映されます.
+    //! @param[in]      instanceId  インスタンスID.
+    //! @param[in]      transform   変換行列.
+    //-------------------------------------------------------------------------
+    void SetTransform(uint32_t instanceId, const asdx::Transform3x4& transform);
+
+    //-------------------------------------------------------------------------
+    //! @brief      次の面に切り替えて，溜まっている変更を書き込みます.
+    //! 
+    //! @note       書き込む面は FRAME_SLOT_COUNT - 1 フレーム前に使われた面なので，
+    //!             実行中のフレームが参照しているバッファとは重なりません.
+    //! @param[out]     dirtyRanges     書き込んだインスタンスIDの範囲.
+    //-------------------------------------------------------------------------
+    void BeginFrame(std::vector<DirtyRange>& dirtyRanges);
+
+    //-------------------------------------------------------------------------
+    //! @brief      現在の面番号を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetFrameSlot() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      登録済みマテリアルを書き換えます.
+    //! 
+    //! @param[in]      offset  先頭のマテリアル番号.
+    //! @param[in]      ptr     マテリアルデータ.
+    //! @param[in]      count   マテリアル数.
+    //-------------------------------------------------------------------------
+    void UpdateMaterials(uint32_t offset, const Material* ptr, uint32_t count);
+
+    //-------------------------------------------------------------------------
+    //! @brief      現在の面のインスタンスバッファのシェーダリソースビューを取得します.
     //-------------------------------------------------------------------------
     asdx::IShaderResourceView* GetIB() const;
 
     //-------------------------------------------------------------------------
-    //! @brief      トランスフォームバッファのシェーダリソースビューを取得します.
+    //! @brief      現在の面のトランスフォームバッファのシェーダリソースビューを取得します.
     //-------------------------------------------------------------------------
     asdx::IShaderResourceView* GetTB() const;
 
@@ -211,12 +271,12 @@ public:
     asdx::IShaderResourceView* GetMB() const;
 
     //--------------------------------------------------------------------------
-    //! @brief      インスタンスバッファのGPU仮想アドレスを取得します.
+    //! @brief      現在の面のインスタンスバッファのGPU仮想アドレスを取得します.
     //--------------------------------------------------------------------------
     D3D12_GPU_VIRTUAL_ADDRESS GetAddressIB() const;
 
     //--------------------------------------------------------------------------
-    //! @brief      トランスフォームバッファのGPU仮想アドレスを取得します.
+    //! @brief      現在の面のトランスフォームバッファのGPU仮想アドレスを取得します.
     //--------------------------------------------------------------------------
     D3D12_GPU_VIRTUAL_ADDRESS GetAddressTB() const;
 
@@ -245,6 +305,11 @@ public:
     //-------------------------------------------------------------------------
     const MeshBuffer& GetMesh(size_t index) const;
 
+    //-------------------------------------------------------------------------
+    //! @brief      メッシュバッファの統計情報を取得します.
+    //-------------------------------------------------------------------------
+    ArenaStats GetMeshStats() const;
+
     //-------------------------------------------------------------------------
     //! @brief      メッシュ数を取得します.
     //-------------------------------------------------------------------------
@@ -290,33 +355,51 @@ private:
         uint32_t        MaterialId;     //!< マテリアルID.
     };
 
+    ///////////////////////////////////////////////////////////////////////////////
+    // MeshBlock structure
+    ///////////////////////////////////////////////////////////////////////////////
+    struct MeshBlock
+    {
+        asdx::RefPtr<ID3D12Resource>    Resource;   //!< デフォルトヒープのバッファ.
+        D3D12_RESOURCE_STATES           State;      //!< 現在のリソースステート.
+    };
+
     //=========================================================================
     // private variables.
     //=========================================================================
-    asdx::RefPtr<ID3D12Resource>    m_IB;   //!< インスタンスバッファ.
-    asdx::RefPtr<ID3D12Resource>    m_TB;   //!< トランスフォームバッファ.
-    asdx::RefPtr<ID3D12Resource>    m_MB;   //!< マテリアルバッファ.
+    asdx::RefPtr<ID3D12Resource>    m_IB[FRAME_SLOT_COUNT];     //!< インスタンスバッファ.
+    asdx::RefPtr<ID3D12Resource>    m_TB[FRAME_SLOT_COUNT];     //!< トランスフォームバッファ.
+    asdx::RefPtr<ID3D12Resource>    m_MB;                       //!< マテリアルバッファ.
 
-    asdx::RefPtr<asdx::IShaderResourceView> m_IB_SRV;
-    asdx::RefPtr<asdx::IShaderResourceView> m_TB_SRV;
+    asdx::RefPtr<asdx::IShaderResourceView> m_IB_SRV[FRAME_SLOT_COUNT];
+    asdx::RefPtr<asdx::IShaderResourceView> m_TB_SRV[FRAME_SLOT_COUNT];
     asdx::RefPtr<asdx::IShaderResourceView> m_MB_SRV;
 
     std::vector<MeshBuffer>     m_Meshes;
+    std::vector<MeshBlock>      m_MeshBlocks;
+    BufferArena                 m_MeshArena;
+    UploadHeap*                 m_pUploadHeap = nullptr;
 
     uint32_t    m_OffsetInstance = 0;
     uint32_t    m_OffsetMaterial = 0;
 
-    uint32_t    m_MaxInstanceCount;
-    uint32_t    m_MaxMaterialCount;
+    uint32_t    m_InstanceCapacity = 0;
+    uint32_t    m_MaterialCapacity = 0;
+
+    CapacityPlanner m_InstancePlanner;
+    CapacityPlanner m_MaterialPlanner;
 
-    GpuInstance*            m_pInstances    = nullptr;
-    asdx::Transform3x4*     m_pTransforms   = nullptr;
+    GpuInstance*            m_pInstances [FRAME_SLOT_COUNT] = {};
+    asdx::Transform3x4*     m_pTransforms[FRAME_SLOT_COUNT] = {};
     Material*               m_pMaterials    = nullptr;
 
-    D3D12_GPU_VIRTUAL_ADDRESS m_AddressIB = 0;
-    D3D12_GPU_VIRTUAL_ADDRESS m_AddressTB = 0;
+    D3D12_GPU_VIRTUAL_ADDRESS m_AddressIB[FRAME_SLOT_COUNT] = {};
+    D3D12_GPU_VIRTUAL_ADDRESS m_AddressTB[FRAME_SLOT_COUNT] = {};
     D3D12_GPU_VIRTUAL_ADDRESS m_AddressMB = 0;
 
+    uint32_t            m_FrameSlot = 0;
+    DirtyRangeTracker   m_DirtyInstances;
+
     asdx::Texture   m_DefaultBaseColor;
     asdx::Texture   m_DefaultNormal;
     asdx::Texture   m_DefaultORM;
@@ -325,6 +408,7 @@ private:
     std::vector<GeometryHandle> m_GeometryHandles;
     std::vector<InstanceHandle> m_InstanceHandles;
     std::vector<CpuInstance>    m_CpuInstances;
+    std::vector<Material>       m_CpuMaterials;
 
     //=========================================================================
     // private methods.
@@ -334,6 +418,12 @@ private:
     uint32_t GetOrm         (uint32_t handle);
     uint32_t GetEmissive    (uint32_t handle);
     uint32_t GetMask        (uint32_t handle);
+    GpuInstance ToGpuInstance(const CpuInstance& instance) const;
+    void     WriteMaterials (uint32_t offset, const Material* ptr, uint32_t count);
+    bool     ReserveInstances(uint64_t count);
+    bool     ReserveMaterials(uint64_t count);
+    bool     AddMeshBlock   (uint32_t index);
+    bool     CopyMesh       (ID3D12GraphicsCommandList6* pCmdList, const MeshBuffer& item, const Mesh& mesh);
 };
 
 } // namespace r3d
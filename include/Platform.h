@@ -0,0 +1,171 @@
+﻿//-----------------------------------------------------------------------------
+// File : Platform.h
+// Desc : Platform Abstraction.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+//-----------------------------------------------------------------------------
+// Logging Macros.
+//-----------------------------------------------------------------------------
+// asdxLogger.h が先にインクルードされている場合はそちらを優先します.
+#ifndef ELOGA
+#define ELOGA(fmt, ...)     r3d::PrintLog(stderr, fmt, ##__VA_ARGS__)
+#endif
+#ifndef ELOG
+#define ELOG(fmt, ...)      r3d::PrintLog(stderr, fmt, ##__VA_ARGS__)
+#endif
+#ifndef ILOGA
+#define ILOGA(fmt, ...)     r3d::PrintLog(stdout, fmt, ##__VA_ARGS__)
+#endif
+#ifndef ILOG
+#define ILOG(fmt, ...)      r3d::PrintLog(stdout, fmt, ##__VA_ARGS__)
+#endif
+#ifndef DLOGA
+#define DLOGA(fmt, ...)     r3d::PrintLog(stdout, fmt, ##__VA_ARGS__)
+#endif
+#ifndef DLOG
+#define DLOG(fmt, ...)      r3d::PrintLog(stdout, fmt, ##__VA_ARGS__)
+#endif
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//! @brief      ログを出力します.
+//!
+//! @param[in]      stream      出力先.
+//! @param[in]      format      書式.
+//-----------------------------------------------------------------------------
+void PrintLog(FILE* stream, const char* format, ...);
+
+//-----------------------------------------------------------------------------
+//! @brief      大文字小文字を区別せずに文字列を比較します.
+//!
+//! @param[in]      lhs     比較する文字列.
+//! @param[in]      rhs     比較する文字列.
+//! @return     strcmp() と同じ規則で比較結果を返却します.
+//-----------------------------------------------------------------------------
+int StrICmp(const char* lhs, const char* rhs);
+
+//-----------------------------------------------------------------------------
+//! @brief      ファイルを開きます.
+//!
+//! @param[in]      path        ファイルパス.
+//! @param[in]      mode        オープンモード.
+//! @return     ファイルポインタを返却します. 失敗した場合は nullptr を返却します.
+//-----------------------------------------------------------------------------
+FILE* OpenFile(const char* path, const char* mode);
+
+//-----------------------------------------------------------------------------
+//! @brief      現在時刻のタイムスタンプ文字列を取得します.
+//!
+//! @return     "YYYYMMDD_hhmmss" 形式の文字列を返却します.
+//-----------------------------------------------------------------------------
+std::string GetTimeStamp();
+
+//-----------------------------------------------------------------------------
+//! @brief      パス区切り文字を実行環境のものに揃えます.
+//!
+//! @param[in]      path        ファイルパス.
+//! @return     正規化したパスを返却します.
+//-----------------------------------------------------------------------------
+std::string NormalizePath(const char* path);
+
+//-----------------------------------------------------------------------------
+//! @brief      ディレクトリパスを取得します.
+//!
+//! @param[in]      path        ファイルパス.
+//! @return     ディレクトリパスを返却します. ディレクトリを含まない場合は "." を返却します.
+//-----------------------------------------------------------------------------
+std::string GetDirectoryPath(const char* path);
+
+//-----------------------------------------------------------------------------
+//! @brief      ディレクトリパスを取り除いたファイル名を取得します.
+//!
+//! @param[in]      path        ファイルパス.
+//! @return     ファイル名を返却します.
+//-----------------------------------------------------------------------------
+std::string RemoveDirectoryPath(const char* path);
+
+//-----------------------------------------------------------------------------
+//! @brief      拡張子を取り除いたパスを取得します.
+//!
+//! @param[in]      path        ファイルパス.
+//! @return     拡張子を取り除いたパスを返却します.
+//-----------------------------------------------------------------------------
+std::string GetPathWithoutExt(const char* path);
+
+//-----------------------------------------------------------------------------
+//! @brief      拡張子を取得します.
+//!
+//! @param[in]      path        ファイルパス.
+//! @return     ドットを含まない小文字の拡張子を返却します.
+//-----------------------------------------------------------------------------
+std::string GetExt(const char* path);
+
+//-----------------------------------------------------------------------------
+//! @brief      ファイルが存在するかどうかチェックします.
+//!
+//! @param[in]      path        ファイルパス.
+//! @retval true    存在します.
+//! @retval false   存在しません.
+//-----------------------------------------------------------------------------
+bool IsExistFile(const char* path);
+
+//-----------------------------------------------------------------------------
+//! @brief      ファイルのハードリンクを作成します.
+//!
+//! @note       ハードリンクを作成できない場合 (別ボリュームなど) はコピーします.
+//!             dst が既に存在する場合は置き換えます.
+//! @param[in]      src         リンク元のファイルパス.
+//! @param[in]      dst         作成するファイルパス.
+//! @retval true    作成に成功.
+//! @retval false   作成に失敗.
+//-----------------------------------------------------------------------------
+bool LinkOrCopyFile(const char* src, const char* dst);
+
+//-----------------------------------------------------------------------------
+//! @brief      ディレクトリ直下のファイル名を取得します.
+//!
+//! @note       サブディレクトリは含みません. ファイル名の昇順に並べます.
+//! @param[in]      directory   ディレクトリパス.
+//! @param[out]     result      ファイル名 (ディレクトリパスを含まない) の格納先.
+//! @retval true    取得に成功.
+//! @retval false   ディレクトリを開けませんでした.
+//-----------------------------------------------------------------------------
+bool GetFileList(const char* directory, std::vector<std::string>& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      ファイル検索用のディレクトリを追加します.
+//!
+//! @note       スレッドセーフではありません. ワーカースレッド起動前に設定してください.
+//! @param[in]      directory   ディレクトリパス.
+//-----------------------------------------------------------------------------
+void AddSearchDirectory(const char* directory);
+
+//-----------------------------------------------------------------------------
+//! @brief      ファイル検索用のディレクトリをクリアします.
+//-----------------------------------------------------------------------------
+void ClearSearchDirectories();
+
+//-----------------------------------------------------------------------------
+//! @brief      ファイルパスを検索します.
+//!
+//! @param[in]      path        検索するファイルパス.
+//! @param[out]     result      見つかったファイルパスの格納先.
+//! @retval true    ファイルが見つかりました.
+//! @retval false   ファイルが見つかりませんでした.
+//-----------------------------------------------------------------------------
+bool SearchFilePath(const char* path, std::string& result);
+
+} // namespace r3d
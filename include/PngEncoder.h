@@ -0,0 +1,152 @@
+﻿//-----------------------------------------------------------------------------
+// File : PngEncoder.h
+// Desc : Strip Parallel PNG Encoder.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ImageEncoder.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// PngEncoder class
+///////////////////////////////////////////////////////////////////////////////
+class PngEncoder : public IImageEncoder
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    PngEncoder() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~PngEncoder();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      threadCount     ワーカースレッド数. 0 の場合はハードウェアスレッド数.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint32_t threadCount = 0);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      RGBA8 の画像を PNG にエンコードします.
+    //!
+    //! @note       画像を水平な帯に分割し，帯ごとにフィルタと圧縮をワーカースレッドで行います.
+    //!             帯はそれぞれ独立した IDAT チャンクになり，1つの zlib ストリームとして連結されます.
+    //!             呼び出しスレッドも完了を待つ間は帯の処理を手伝います.
+    //!             複数のスレッドから同時に呼び出せます.
+    //! @param[in]      pPixels     画素データ.
+    //! @param[in]      width       横幅[px].
+    //! @param[in]      height      縦幅[px].
+    //! @param[in]      pitch       1行のバイト数.
+    //! @param[out]     result      PNG ファイルのデータ.
+    //! @retval true    エンコードに成功.
+    //! @retval false   エンコードに失敗.
+    //-------------------------------------------------------------------------
+    bool Encode(
+        const uint8_t*          pPixels,
+        uint32_t                width,
+        uint32_t                height,
+        uint32_t                pitch,
+        std::vector<uint8_t>&   result) override;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルの拡張子を取得します.
+    //-------------------------------------------------------------------------
+    const char* GetExtension() const override
+    { return "png"; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      ワーカースレッド数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetThreadCount() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Job structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Job;
+
+    ///////////////////////////////////////////////////////////////////////////
+    // Task structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Task
+    {
+        Job*        pJob;
+        uint32_t    Strip;
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<std::thread>    m_Threads;
+    std::mutex                  m_Mutex;
+    std::condition_variable     m_TaskCond;     //!< タスク追加の通知.
+    std::condition_variable     m_DoneCond;     //!< ジョブ完了の通知.
+    std::deque<Task>            m_Tasks;        //!< 未処理の帯 (m_Mutex で保護).
+    bool                        m_Quit = false;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    PngEncoder      (const PngEncoder&) = delete;
+    void operator = (const PngEncoder&) = delete;
+
+    void Run    ();
+    void Execute(const Task& task);
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      PNG をデコードします.
+//!
+//! @note       8/16bit のグレー, RGB, パレット, グレー+α, RGBA に対応します (インターレースは非対応).
+//!             16bit の場合は上位バイトを使います.
+//! @param[in]      pData       ファイルのデータ.
+//! @param[in]      size        データサイズ.
+//! @param[out]     pixels      画素データ (RGBA8, 行間無し).
+//! @param[out]     width       横幅[px].
+//! @param[out]     height      縦幅[px].
+//! @retval true    デコードに成功.
+//! @retval false   デコードに失敗.
+//-----------------------------------------------------------------------------
+bool DecodePng(
+    const uint8_t*          pData,
+    size_t                  size,
+    std::vector<uint8_t>&   pixels,
+    uint32_t&               width,
+    uint32_t&               height);
+
+} // namespace r3d
@@ -0,0 +1,81 @@
+﻿//-----------------------------------------------------------------------------
+// File : QoiEncoder.h
+// Desc : QOI Image Encoder.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ImageEncoder.h>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// QoiEncoder class
+///////////////////////////////////////////////////////////////////////////////
+class QoiEncoder : public IImageEncoder
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      RGBA8 の画像を QOI にエンコードします.
+    //!
+    //! @note       画素間の差分・ハッシュ・連続判定は SIMD で行単位にまとめて求め,
+    //!             逐次的な部分 (カラーテーブルとランの管理) だけをスカラーで処理します.
+    //! @param[in]      pPixels     画素データ.
+    //! @param[in]      width       横幅[px].
+    //! @param[in]      height      縦幅[px].
+    //! @param[in]      pitch       1行のバイト数.
+    //! @param[out]     result      QOI ファイルのデータ.
+    //! @retval true    エンコードに成功.
+    //! @retval false   エンコードに失敗.
+    //-------------------------------------------------------------------------
+    bool Encode(
+        const uint8_t*          pPixels,
+        uint32_t                width,
+        uint32_t                height,
+        uint32_t                pitch,
+        std::vector<uint8_t>&   result) override;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルの拡張子を取得します.
+    //-------------------------------------------------------------------------
+    const char* GetExtension() const override
+    { return "qoi"; }
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      QOI をデコードします.
+//!
+//! @param[in]      pData       ファイルのデータ.
+//! @param[in]      size        データサイズ.
+//! @param[out]     pixels      画素データ (RGBA8, 行間無し).
+//! @param[out]     width       横幅[px].
+//! @param[out]     height      縦幅[px].
+//! @retval true    デコードに成功.
+//! @retval false   デコードに失敗.
+//-----------------------------------------------------------------------------
+bool DecodeQoi(
+    const uint8_t*          pData,
+    size_t                  size,
+    std::vector<uint8_t>&   pixels,
+    uint32_t&               width,
+    uint32_t&               height);
+
+} // namespace r3d
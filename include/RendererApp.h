@@ -27,6 +27,15 @@
 #include <ModelManager.h>
 #include <Scene.h>
 #include <CameraSequence.h>
+#include <AsyncFileWriter.h>
+#include <BudgetScheduler.h>
+#include <CaptureJournal.h>
+#include <EncoderPool.h>
+#include <ExrEncoder.h>
+#include <FrameDedup.h>
+#include <PngEncoder.h>
+#include <QoiEncoder.h>
+#include <VideoStream.h>
 #include <fnd/asdxStopWatch.h>
 
 #if RTC_TARGET == RTC_DEVELOP
@@ -55,6 +64,17 @@ struct SceneDesc
     double      AnimationTimeSec;   // 総アニメーション時間.
     const char* SceneFilePath;      // シーンファイルパス.
     const char* CameraFilePath;     // カメラファイルパス.
+    uint64_t    UploadHeapSize;     // アップロードヒープサイズ[byte] (0 なら既定値).
+    uint32_t    EncoderThreadCount; // 画像出力スレッド数 (0 ならハードウェアスレッド数).
+    uint32_t    EncoderBufferCount; // 画像出力の同時処理フレーム数 (0 ならスレッド数の2倍).
+    IMAGE_FORMAT OutputFormat;      // 出力画像フォーマット.
+    bool        CaptureHdr;         // 蓄積した線形放射輝度も OpenEXR (RGB half) で出力する.
+    const char* StreamPath;         // 動画ストリームの出力先 (nullptr なら連番画像. '|' で始まる場合はコマンドにパイプ).
+    STREAM_FORMAT StreamFormat;     // 動画ストリームのフォーマット.
+    bool        SkipDuplicate;      // 直前と同じ内容のフレームはエンコードせずにリンクする (連番画像のみ).
+    uint32_t    DuplicateTolerance; // 重複とみなすチャンネルごとの許容差 (0 ならビット単位で一致した場合のみ).
+    bool        DirectIO;           // 出力ファイルを O_DIRECT で書き込む (io_uring が使える場合のみ).
+    const char* JournalPath;        // 中断から再開するためのジャーナルファイル (nullptr なら記録しない. 連番画像のみ).
 };
 
 
@@ -63,6 +83,7 @@ struct SceneDesc
 ///////////////////////////////////////////////////////////////////////////////
 class Renderer 
     : public asdx::Application
+    , public IEncodeHandler
 #if RTC_TARGET == RTC_TARGET_DEVELOP
     , public asdx::IFileUpdateListener
 #endif
@@ -78,12 +99,8 @@ public:
     //////////////////////////////////////////////////////////////////////////
     struct ExportData
     {
-        std::vector<uint8_t>    Converted;
-        uint32_t                FrameIndex;
-        uint32_t                Width;
-        uint32_t                Height;
-        ID3D12Resource*         pResources;
-        bool                    Processed;
+        std::vector<uint8_t>    Converted;      // エンコード結果.
+        std::vector<uint8_t>    Hdr;            // HDR のエンコード結果.
     };
 
     //=========================================================================
@@ -128,6 +145,7 @@ private:
     RayTracingPipe                  m_RtPipe;
     asdx::PipelineState             m_ModelPipe;
     asdx::PipelineState             m_TonemapPipe;
+    asdx::PipelineState             m_ResolveRadiancePipe;
     asdx::PipelineState             m_TaaPipe;
     asdx::PipelineState             m_CopyPipe;
     asdx::PipelineState             m_PreBlurPipe;
@@ -149,6 +167,7 @@ private:
     asdx::ComputeTarget             m_Tonemapped;                   // トーンマップ適用済み.
     asdx::ComputeTarget             m_ColorHistory[2];              // カラーヒストリーバッファ.
     asdx::ComputeTarget             m_CaptureTarget;                // キャプチャー用.
+    asdx::ComputeTarget             m_HdrCaptureTarget;             // HDR キャプチャー用 (RGBA16F, 描画内部解像度).
     asdx::ComputeTarget             m_HitDistance;                  // プライマリーヒットからセカンダリ―ヒットまでの距離.
     asdx::ComputeTarget             m_AccumulationCount;            // アキュムレーション数ヒストリー.
     asdx::ComputeTarget             m_AccumulationColorHistory[2];  // アキュムレーションカラーヒストリー.
@@ -162,8 +181,28 @@ private:
 
     asdx::RefPtr<ID3D12Resource>    m_ReadBackTexture[3];
     uint32_t                        m_ReadBackPitch         = 0;
-    std::vector<ExportData>         m_ExportData;
-    size_t                          m_ExportIndex           = 0;
+    asdx::RefPtr<ID3D12Resource>    m_HdrReadBackTexture[3];
+    uint32_t                        m_HdrReadBackPitch      = 0;
+    std::vector<ExportData>         m_ExportData;                   // ワーカー毎の作業領域.
+    PngEncoder                      m_PngEncoder;
+    QoiEncoder                      m_QoiEncoder;
+    IImageEncoder*                  m_pImageEncoder         = nullptr;  // 出力フォーマットのエンコーダ.
+    VideoStream                     m_VideoStream;                  // 連番画像の代わりに出力する動画ストリーム.
+    FrameDedup                      m_FrameDedup;                   // 重複フレームの検出.
+    bool                            m_SkipDuplicate         = false;
+    ExrEncoder                      m_ExrEncoder;
+    EncoderPool                     m_EncoderPool;
+    AsyncFileWriter                 m_FileWriter;                   // 出力ファイルの非同期書き込み.
+    CaptureJournal                  m_Journal;                      // 完了したフレームの記録.
+    BudgetScheduler                 m_BudgetScheduler;              // 収束具合に応じた描画時間の割り振り.
+    std::vector<uint32_t>           m_ProbeFrames;                  // 事前パスで難しさを推定するフレーム.
+    uint32_t                        m_ProbeIndex            = 0;
+    uint32_t                        m_ProbeRenderCount      = 0;    // 推定中のフレームを描画した回数.
+    double                          m_ProbeElapsedSec       = 0;    // 推定中のフレームの描画時間.
+    double                          m_ProbeBeginSec         = 0;
+    double                          m_ProbeLimitSec         = 0;    // 事前パスに使える時間.
+    bool                            m_WaitSceneLoad         = false;    // シーンの読み込みを待っているか.
+    bool                            m_RequestReset          = false;    // 同じカメラでも蓄積をやり直す.
     uint32_t                        m_CaptureIndex          = 0;
     uint32_t                        m_ReadBackTargetIndex   = 1;
     uint32_t                        m_CaptureTargetIndex    = 0;
@@ -171,6 +210,9 @@ private:
 
     double                          m_AnimationOneFrameTime = 0;
     double                          m_AnimationElapsedTime  = 0;
+    double                          m_RenderDeadlineSec     = 0;    // 全てのセッションを通した締め切り.
+    double                          m_ElapsedOffsetSec      = 0;    // 以前のセッションの経過時間.
+    uint32_t                        m_FrameIndexOffset      = 0;    // 以前のセッションで描画したフレーム数.
     float                           m_AnimationTime         = 0.0f;
 
     asdx::StopWatch     m_RenderingTimer;
@@ -252,7 +294,11 @@ private:
     void DispatchRays   (ID3D12GraphicsCommandList6* pCmd);
 
     void ChangeFrame    (uint32_t index);
-    void CaptureScreen  (ID3D12Resource* pResource);
+    void CaptureScreen  (ID3D12Resource* pResource, ID3D12Resource* pHdrResource);
+    void UpdateProbe    (double elapsedTime);
+
+    // 画像出力コールバック.
+    bool Encode(uint32_t workerIndex, const CaptureFrame& frame) override;
 
 #if RTC_TARGET == RTC_DEVELOP
     bool BuildTestScene ();
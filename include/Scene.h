@@ -11,22 +11,18 @@
 #include <fnd/asdxMath.h>
 #include <gfx/asdxBuffer.h>
 #include <gfx/asdxCommandList.h>
+#include <memory>
 #include <vector>
-#include <map>
+#include <SceneCommon.h>
 #include <ModelManager.h>
+#include <SceneStreamer.h>
+#include <SceneDiff.h>
+#include <TagTable.h>
+#include <UploadHeap.h>
 
 
 namespace r3d {
 
-///////////////////////////////////////////////////////////////////////////////
-// LIGHT_TYPE enum
-///////////////////////////////////////////////////////////////////////////////
-enum LIGHT_TYPE
-{
-    LIGHT_TYPE_POINT        = 1,
-    LIGHT_TYPE_DIRECTIONAL  = 2,
-};
-
 ///////////////////////////////////////////////////////////////////////////////
 // Light structure
 ///////////////////////////////////////////////////////////////////////////////
@@ -53,24 +49,6 @@ struct PinholeCamera
     float               FarClip;
 };
 
-//-----------------------------------------------------------------------------
-//! @brief      ハッシュタグを計算します.
-//! 
-//! @param[in]      name            文字列
-//! @param[in]      nameLength      文字列の長さ.
-//! @return     ハッシュ値を返却します.
-//-----------------------------------------------------------------------------
-uint32_t CalcHashTag(const char* name, size_t nameLength);
-
-//-----------------------------------------------------------------------------
-//! @brief      ハッシュタグを計算します.
-//! 
-//! @param[in]      name            文字列
-//! @return     ハッシュ値を返却します.
-//-----------------------------------------------------------------------------
-uint32_t CalcHashTag(const std::string& name);
-
-
 ///////////////////////////////////////////////////////////////////////////////
 // SceneTexture class
 ///////////////////////////////////////////////////////////////////////////////
@@ -93,9 +71,13 @@ public:
 
     //-------------------------------------------------------------------------
     //! @brief      初期化処理を行います.
+    //!
+    //! @note       コピー後のリソースバリアは heap に溜められます.
+    //!             UploadHeap::FlushBarriers() を呼び出すまで参照できません.
     //-------------------------------------------------------------------------
     bool Init(
         ID3D12GraphicsCommandList6* pCmdList,
+        UploadHeap&                 heap,
         const void*                 resTexture,
         uint32_t                    componentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING);
 
@@ -124,7 +106,7 @@ private:
 ///////////////////////////////////////////////////////////////////////////////
 // Scene class
 ///////////////////////////////////////////////////////////////////////////////
-class Scene
+class Scene : private ISceneUploader
 {
     //=========================================================================
     // list of friend classes and methods.
@@ -143,6 +125,15 @@ public:
     bool Init(const char* path, ID3D12GraphicsCommandList6* pCmdList);
     void Term();
 
+    bool                BeginLoad      (const char* path, ID3D12GraphicsCommandList6* pCmdList);
+    SCENE_STREAM_STATE  UpdateLoad     (ID3D12GraphicsCommandList6* pCmdList, uint64_t budget);
+    bool                UpdateStream   (ID3D12GraphicsCommandList6* pCmdList);
+    bool                IsLoaded       () const;
+    bool                IsDrawable     () const;
+    float               GetLoadProgress() const;
+    void                SetUploadHeapSize(uint64_t size);
+    void                Submit         (const asdx::WaitPoint& waitPoint);
+
     asdx::IConstantBufferView* GetParamCBV  () const;
     asdx::IShaderResourceView* GetIB        () const;
     asdx::IShaderResourceView* GetTB        () const;
@@ -152,10 +143,12 @@ public:
     ID3D12Resource*            GetTLAS      () const;
     uint32_t                   GetLightCount() const;
 
-    void Draw(ID3D12GraphicsCommandList6* pCmdList);
+    void Update(ID3D12GraphicsCommandList6* pCmdList);
+    void Draw  (ID3D12GraphicsCommandList6* pCmdList);
 
     uint32_t FindLightIndex   (uint32_t hashTag) const;
     uint32_t FindInstanceIndex(uint32_t hashTag) const;
+    void     SetInstanceTransform(uint32_t index, const asdx::Transform3x4& transform);
 
 #if !CAMP_RELEASE
     void Reload(const char* path);
@@ -186,97 +179,60 @@ private:
         uint32_t                    MaterialId;
     };
 
+    ///////////////////////////////////////////////////////////////////////////
+    // SceneMesh structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct SceneMesh
+    {
+        uint32_t    VertexCount;
+        uint32_t    IndexCount;
+    };
+
     //=========================================================================
     // private variables.
     //=========================================================================
-    void*                                   m_pBinary = nullptr;
     std::vector<DrawCall>                   m_DrawCalls;
     std::vector<SceneInstance>              m_Instances;
     std::vector<asdx::Blas>                 m_BLAS;
-    asdx::Tlas                              m_TLAS;
+    asdx::Tlas                              m_TLAS[FRAME_SLOT_COUNT];
+    std::vector<DirtyRange>                 m_DirtyRanges;
     SceneTexture                            m_IBL;
     ModelMgr                                m_ModelMgr;
     std::vector<SceneTexture>               m_Textures;
     asdx::ConstantBuffer                    m_Param;
-    asdx::StructuredBuffer                  m_LB;
-    std::map<uint32_t, uint32_t>            m_LightDict;
-    std::map<uint32_t, uint32_t>            m_InstanceDict;
+    asdx::RefPtr<ID3D12Resource>            m_LB;
+    asdx::RefPtr<asdx::IShaderResourceView> m_LB_SRV;
+    ResLight*                               m_pLights = nullptr;
+    TagTable                                m_LightTags;
+    TagTable                                m_InstanceTags;
+    std::unique_ptr<uint8_t[]>              m_LightSection;         // m_LightTags が参照するセクション.
+    std::unique_ptr<uint8_t[]>              m_InstanceSection;      // m_InstanceTags が参照するセクション.
+    uint32_t                                m_LightCount = 0;
+    std::vector<SceneMesh>                  m_Meshes;
+    SceneStreamer                           m_Streamer;
+    ID3D12GraphicsCommandList6*             m_pUploadCmdList = nullptr;
+    UploadHeap                              m_UploadHeap;
+    uint64_t                                m_UploadHeapSize = 0;
 
 #if !CAMP_RELEASE
     bool                                    m_RequestTerm = false;
     uint8_t                                 m_WaitCount   = 0;
     std::string                             m_ReloadPath;
+    SceneDigest                             m_Digest;
 #endif
 
     //=========================================================================
     // private methods.
     //=========================================================================
     uint32_t GetTextureHandle(uint32_t index);
-};
+    bool     Upload(const SceneSection& section) override;
+    Material ConvertMaterial(const ResMaterial* srcMaterial);
+    bool     BuildTLAS(ID3D12GraphicsCommandList6* pCmdList);
+    void     WriteInstanceDesc(uint32_t index, D3D12_RAYTRACING_INSTANCE_DESC& desc) const;
 
 #if !CAMP_RELEASE
-///////////////////////////////////////////////////////////////////////////////
-// SceneExporter class
-///////////////////////////////////////////////////////////////////////////////
-class SceneExporter
-{
-    //=========================================================================
-    // list of friend classes and methods.
-    //=========================================================================
-    /* NOTHING */
-
-public:
-    //=========================================================================
-    // public variables.
-    //=========================================================================
-    /* NOTHING */
-
-    //=========================================================================
-    // public methods.
-    //=========================================================================
-    bool LoadFromTXT(const char* path, std::string& exportPath);
-    bool Export(const char* path);
-    void Reset();
-
-    void AddLight       (const Light& value);
-    void AddMesh        (const Mesh& value);
-    void AddMeshes      (const std::vector<Mesh>& values);
-    void AddMaterial    (const Material& value);
-    void AddInstance    (const CpuInstance& value);
-    void AddInstances   (const std::vector<CpuInstance>& values);
-    void AddTexture     (const char* path);
-    void SetIBL         (const char* path);
-
-private:
-    //=========================================================================
-    // private variables.
-    //=========================================================================
-    std::vector<Light>          m_Lights;
-    std::vector<Mesh>           m_Meshes;
-    std::vector<Material>       m_Materials;
-    std::vector<CpuInstance>    m_Instances;
-    std::vector<std::string>    m_Textures;
-    std::string                 m_IBL;
-};
-
-///////////////////////////////////////////////////////////////////////////////
-// MeshInfo structure
-///////////////////////////////////////////////////////////////////////////////
-struct MeshInfo
-{
-    std::string     MeshName;
-    std::string     MaterialName;
-};
-
-//-----------------------------------------------------------------------------
-//! @brief      メッシュをロードします.
-//! 
-//! @param[in]      path        ファイルパスです.
-//! @param[out]     result      メッシュの格納先です.
-//! @retval true    ロードに成功.
-//! @retval false   ロードに失敗.
-//-----------------------------------------------------------------------------
-bool LoadMesh(const char* path, std::vector<Mesh>& result, std::vector<MeshInfo>& infos);
+    bool     Patch(const char* path, ID3D12GraphicsCommandList6* pCmdList);
 #endif
+};
 
 } // namespace r3d
@@ -0,0 +1,141 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneCommon.h
+// Desc : Scene Common Definitions.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <string>
+#include <xxhash.h>
+#include <generated/scene_format.h>
+
+
+namespace r3d {
+
+static constexpr uint32_t INVALID_MATERIAL_MAP = UINT32_MAX;
+
+///////////////////////////////////////////////////////////////////////////////
+// LIGHT_TYPE enum
+///////////////////////////////////////////////////////////////////////////////
+enum LIGHT_TYPE
+{
+    LIGHT_TYPE_POINT        = 1,
+    LIGHT_TYPE_DIRECTIONAL  = 2,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Mesh structure
+///////////////////////////////////////////////////////////////////////////////
+struct Mesh
+{
+    uint32_t      VertexCount;
+    uint32_t      IndexCount;
+    ResVertex*    Vertices;
+    uint32_t*     Indices;
+};
+
+static constexpr uint32_t HASH_TAG_SEED = 12345;
+
+static constexpr uint32_t XXH32_PRIME1 = 0x9E3779B1u;
+static constexpr uint32_t XXH32_PRIME2 = 0x85EBCA77u;
+static constexpr uint32_t XXH32_PRIME3 = 0xC2B2AE3Du;
+static constexpr uint32_t XXH32_PRIME4 = 0x27D4EB2Fu;
+static constexpr uint32_t XXH32_PRIME5 = 0x165667B1u;
+
+constexpr uint32_t ConstXXH32Rotl(uint32_t x, int r)
+{ return (x << r) | (x >> (32 - r)); }
+
+constexpr uint32_t ConstXXH32Read(const char* p)
+{
+    return uint32_t(uint8_t(p[0]))
+        | (uint32_t(uint8_t(p[1])) << 8)
+        | (uint32_t(uint8_t(p[2])) << 16)
+        | (uint32_t(uint8_t(p[3])) << 24);
+}
+
+constexpr uint32_t ConstXXH32Round(uint32_t acc, uint32_t input)
+{ return ConstXXH32Rotl(acc + input * XXH32_PRIME2, 13) * XXH32_PRIME1; }
+
+//-----------------------------------------------------------------------------
+//! @brief      XXH32 をコンパイル時に計算します.
+//!
+//! @note       XXH32() と同じ値を返却します. 実行時にも使えますが，
+//!             長いデータには XXH32() の方が高速です.
+//! @param[in]      data            データ.
+//! @param[in]      length          データのバイト数.
+//! @param[in]      seed            シード値.
+//! @return     ハッシュ値を返却します.
+//-----------------------------------------------------------------------------
+constexpr uint32_t ConstXXH32(const char* data, size_t length, uint32_t seed)
+{
+    size_t   pos  = 0;
+    uint32_t hash = seed + XXH32_PRIME5;
+
+    if (length >= 16)
+    {
+        uint32_t v1 = seed + XXH32_PRIME1 + XXH32_PRIME2;
+        uint32_t v2 = seed + XXH32_PRIME2;
+        uint32_t v3 = seed;
+        uint32_t v4 = seed - XXH32_PRIME1;
+
+        for(; pos + 16 <= length; pos += 16)
+        {
+            v1 = ConstXXH32Round(v1, ConstXXH32Read(data + pos +  0));
+            v2 = ConstXXH32Round(v2, ConstXXH32Read(data + pos +  4));
+            v3 = ConstXXH32Round(v3, ConstXXH32Read(data + pos +  8));
+            v4 = ConstXXH32Round(v4, ConstXXH32Read(data + pos + 12));
+        }
+
+        hash = ConstXXH32Rotl(v1, 1) + ConstXXH32Rotl(v2, 7) + ConstXXH32Rotl(v3, 12) + ConstXXH32Rotl(v4, 18);
+    }
+
+    hash += uint32_t(length);
+
+    for(; pos + 4 <= length; pos += 4)
+    { hash = ConstXXH32Rotl(hash + ConstXXH32Read(data + pos) * XXH32_PRIME3, 17) * XXH32_PRIME4; }
+
+    for(; pos < length; ++pos)
+    { hash = ConstXXH32Rotl(hash + uint32_t(uint8_t(data[pos])) * XXH32_PRIME5, 11) * XXH32_PRIME1; }
+
+    hash ^= hash >> 15;
+    hash *= XXH32_PRIME2;
+    hash ^= hash >> 13;
+    hash *= XXH32_PRIME3;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+//! @brief      ハッシュタグを計算します.
+//!
+//! @param[in]      name            文字列
+//! @param[in]      nameLength      文字列の長さ.
+//! @return     ハッシュ値を返却します.
+//-----------------------------------------------------------------------------
+inline uint32_t CalcHashTag(const char* name, size_t nameLength)
+{ return XXH32(name, nameLength, HASH_TAG_SEED); }
+
+//-----------------------------------------------------------------------------
+//! @brief      ハッシュタグを計算します.
+//!
+//! @param[in]      name            文字列
+//! @return     ハッシュ値を返却します.
+//-----------------------------------------------------------------------------
+inline uint32_t CalcHashTag(const std::string& name)
+{ return CalcHashTag(name.c_str(), name.length()); }
+
+//-----------------------------------------------------------------------------
+//! @brief      文字列リテラルのハッシュタグをコンパイル時に計算します.
+//!
+//! @note       constexpr auto tag = "Light0"_tag; のように使います.
+//!             CalcHashTag() と同じ値を返却します.
+//-----------------------------------------------------------------------------
+constexpr uint32_t operator"" _tag(const char* name, size_t length)
+{ return ConstXXH32(name, length, HASH_TAG_SEED); }
+
+} // namespace r3d
@@ -0,0 +1,224 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneContainer.h
+// Desc : Sectioned Scene Container.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <SceneCommon.h>
+#include <MappedFile.h>
+
+
+namespace r3d {
+
+static constexpr uint32_t SCENE_CONTAINER_MAGIC     = 0x53443352;   // 'R', '3', 'D', 'S'
+static constexpr uint32_t SCENE_CONTAINER_VERSION   = 2;
+static constexpr uint32_t SCENE_BLOB_MAGIC          = 0x42443352;   // 'R', '3', 'D', 'B'
+static constexpr uint32_t SCENE_BLOB_VERSION        = 1;
+static constexpr uint64_t SCENE_SECTION_ALIGNMENT   = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+// SCENE_SECTION_TYPE enum
+///////////////////////////////////////////////////////////////////////////////
+enum SCENE_SECTION_TYPE
+{
+    SCENE_SECTION_TYPE_IBL,         //!< IBLテクスチャ.
+    SCENE_SECTION_TYPE_TEXTURES,    //!< マテリアル用テクスチャ.
+    SCENE_SECTION_TYPE_MESHES,      //!< メッシュ.
+    SCENE_SECTION_TYPE_MATERIALS,   //!< マテリアル.
+    SCENE_SECTION_TYPE_INSTANCES,   //!< インスタンスとハッシュタグ.
+    SCENE_SECTION_TYPE_LIGHTS,      //!< ライトとハッシュタグ.
+    SCENE_SECTION_TYPE_SCENE,       //!< 全データ (セクション化前の形式).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneContainerHeader structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneContainerHeader
+{
+    uint32_t    Magic;          //!< SCENE_CONTAINER_MAGIC.
+    uint32_t    Version;        //!< SCENE_CONTAINER_VERSION.
+    uint32_t    SectionCount;   //!< セクション数.
+    uint32_t    BlobCount;      //!< 参照するブロブファイル数.
+    uint32_t    MeshCount;      //!< シーン全体のメッシュ数.
+    uint32_t    InstanceCount;  //!< シーン全体のインスタンス数.
+    uint32_t    TextureCount;   //!< シーン全体のテクスチャ数.
+    uint32_t    MaterialCount;  //!< シーン全体のマテリアル数.
+    uint32_t    LightCount;     //!< シーン全体のライト数.
+    uint32_t    Reserved1[3];
+    uint64_t    TableChecksum;  //!< セクションテーブルの XXH3 ハッシュ.
+    uint64_t    BundleId;       //!< ブロブファイルとの対応を確認する識別子.
+};
+static_assert(sizeof(SceneContainerHeader) == 64, "SceneContainerHeader size not matched!");
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneSectionEntry structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneSectionEntry
+{
+    uint32_t    Type;           //!< SCENE_SECTION_TYPE.
+    uint32_t    Codec;          //!< COMPRESSION_CODEC.
+    uint32_t    FirstIndex;     //!< 格納されている最初の要素番号.
+    uint32_t    Count;          //!< 格納されている要素数.
+    uint64_t    Offset;         //!< 格納ファイル先頭からのオフセット.
+    uint64_t    StoredSize;     //!< ファイル上のバイト数.
+    uint64_t    RawSize;        //!< 展開後のバイト数.
+    uint64_t    Checksum;       //!< 展開後データの XXH3 ハッシュ.
+    uint32_t    File;           //!< 格納ファイル番号 (0: ルートファイル, 1以降: ブロブファイル).
+    uint32_t    Reserved0;
+    uint64_t    Reserved1;
+};
+static_assert(sizeof(SceneSectionEntry) == 64, "SceneSectionEntry size not matched!");
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneBlobHeader structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneBlobHeader
+{
+    uint32_t    Magic;          //!< SCENE_BLOB_MAGIC.
+    uint32_t    Version;        //!< SCENE_BLOB_VERSION.
+    uint32_t    File;           //!< ファイル番号.
+    uint32_t    Reserved0;
+    uint64_t    BundleId;       //!< ルートファイルの BundleId.
+    uint64_t    Reserved1[5];
+};
+static_assert(sizeof(SceneBlobHeader) == 64, "SceneBlobHeader size not matched!");
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneSection structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneSection
+{
+    uint32_t            Index;          //!< セクション番号.
+    SCENE_SECTION_TYPE  Type;           //!< セクションタイプ.
+    uint32_t            FirstIndex;     //!< 格納されている最初の要素番号.
+    uint32_t            Count;          //!< 格納されている要素数.
+    const ResScene*     pScene;         //!< セクションに含まれるフィールドのみを持つシーンデータ.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      ブロブファイルのパスを取得します.
+//!
+//! @param[in]      path        ルートファイルのパス.
+//! @param[in]      file        ファイル番号 (1以降).
+//! @return     "<拡張子を除いたルートファイルのパス>_<3桁の番号>.scb" を返却します.
+//-----------------------------------------------------------------------------
+std::string GetSceneBlobPath(const char* path, uint32_t file);
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneContainer class
+///////////////////////////////////////////////////////////////////////////////
+class SceneContainer
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    using Callback = std::function<bool(const SceneSection&)>;
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    SceneContainer() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~SceneContainer();
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルを開いてセクションテーブルを検証します.
+    //!
+    //! @note       セクション化前の .scn は単一の SCENE セクションとして扱います.
+    //!             ブロブファイルを参照している場合は全てマッピングして先読みを開始します.
+    //! @param[in]      path        ファイルパス.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const char* path);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      全セクションを並列に展開します.
+    //!
+    //! @note       展開とチェックサム検証はワーカースレッドで行い，
+    //!             コールバックは展開が完了した順に呼び出しスレッド上で実行されます.
+    //!             コールバックが false を返した場合は残りの展開を打ち切ります.
+    //! @param[in]      threadCount     ワーカースレッド数. 0 の場合はハードウェアスレッド数.
+    //! @param[in]      callback        セクション毎に呼び出されるコールバック.
+    //! @retval true    全セクションの処理に成功.
+    //! @retval false   展開・検証またはコールバックが失敗.
+    //-------------------------------------------------------------------------
+    bool Decode(uint32_t threadCount, const Callback& callback);
+
+    //-------------------------------------------------------------------------
+    //! @brief      展開済みのセクションのメモリを解放します.
+    //!
+    //! @param[in]      index       セクション番号.
+    //-------------------------------------------------------------------------
+    void ReleaseSection(uint32_t index);
+
+    //-------------------------------------------------------------------------
+    //! @brief      展開済みのセクションのメモリを引き取ります.
+    //!
+    //! @note       無圧縮のセクションはファイルのマッピングを指しているのでコピーを返します.
+    //!             引き取ったメモリは ReleaseSection() や Term() の後も有効です.
+    //! @param[in]      index       セクション番号.
+    //! @return     セクションのメモリを返却します. 失敗した場合は nullptr を返却します.
+    //-------------------------------------------------------------------------
+    std::unique_ptr<uint8_t[]> DetachSection(uint32_t index);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ヘッダを取得します.
+    //-------------------------------------------------------------------------
+    const SceneContainerHeader& GetHeader() const
+    { return m_Header; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      セクションテーブルを取得します.
+    //-------------------------------------------------------------------------
+    const std::vector<SceneSectionEntry>& GetEntries() const
+    { return m_Entries; }
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<std::unique_ptr<MappedFile>>    m_Files;        //!< [0] がルートファイル, 以降がブロブファイル.
+    SceneContainerHeader                        m_Header = {};
+    std::vector<SceneSectionEntry>              m_Entries;
+    std::vector<std::unique_ptr<uint8_t[]>>     m_Buffers;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    SceneContainer  (const SceneContainer&) = delete;
+    void operator = (const SceneContainer&) = delete;
+
+    bool InitLegacy();
+    bool InitBlobs(const char* path);
+    bool DecodeSection(uint32_t index, const uint8_t*& pData);
+};
+
+} // namespace r3d
@@ -0,0 +1,132 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneDiff.h
+// Desc : Scene Difference Detection.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+#include <SceneContainer.h>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneMeshDigest structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneMeshDigest
+{
+    uint32_t    VertexCount;    //!< 頂点数.
+    uint32_t    IndexCount;     //!< インデックス数.
+    uint64_t    Hash;           //!< 頂点とインデックスのハッシュ.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneInstanceDigest structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneInstanceDigest
+{
+    uint32_t    HashTag;        //!< ハッシュタグ.
+    uint32_t    MeshIndex;      //!< メッシュ番号.
+    uint32_t    MaterialIndex;  //!< マテリアル番号.
+    uint64_t    Hash;           //!< 変換行列のハッシュ.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneLightDigest structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneLightDigest
+{
+    uint32_t    HashTag;        //!< ハッシュタグ.
+    uint64_t    Hash;           //!< ライトデータのハッシュ.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneDigest structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneDigest
+{
+    uint64_t                            IblHash = 0;    //!< IBLテクスチャのハッシュ (無い場合は0).
+    std::vector<uint64_t>               Textures;       //!< テクスチャ毎のハッシュ.
+    std::vector<SceneMeshDigest>        Meshes;
+    std::vector<uint64_t>               Materials;      //!< マテリアル毎のハッシュ.
+    std::vector<SceneInstanceDigest>    Instances;
+    std::vector<SceneLightDigest>       Lights;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ヘッダの要素数で初期化します.
+    //-------------------------------------------------------------------------
+    void Reset(const SceneContainerHeader& header);
+
+    //-------------------------------------------------------------------------
+    //! @brief      セクションに含まれる要素のハッシュを記録します.
+    //!
+    //! @param[in]      section     展開済みのセクション.
+    //! @retval true    記録に成功.
+    //! @retval false   要素番号がヘッダの要素数を超えています.
+    //-------------------------------------------------------------------------
+    bool Append(const SceneSection& section);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneRange structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneRange
+{
+    uint32_t    Index;          //!< 読み込み済みシーンでの先頭番号.
+    uint32_t    NewIndex;       //!< 新しいシーンでの先頭番号.
+    uint32_t    Count;          //!< 要素数.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneDiff structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneDiff
+{
+    bool                        Rebuild = false;        //!< 差分更新できない変更があります.
+    const char*                 Reason  = nullptr;      //!< 再構築が必要な理由.
+    std::vector<uint32_t>       Meshes;                 //!< 頂点・インデックスが変わったメッシュ番号.
+    std::vector<SceneRange>     Materials;              //!< 変更されたマテリアル.
+    std::vector<SceneRange>     Instances;              //!< 変換行列またはマテリアルが変わったインスタンス.
+    std::vector<SceneRange>     Lights;                 //!< 変更されたライト.
+
+    //-------------------------------------------------------------------------
+    //! @brief      変更が無いかどうか?
+    //-------------------------------------------------------------------------
+    bool IsEmpty() const
+    {
+        return !Rebuild
+            && Meshes   .empty()
+            && Materials.empty()
+            && Instances.empty()
+            && Lights   .empty();
+    }
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      シーンファイルを展開してダイジェストを作成します.
+//!
+//! @param[in]      path        ファイルパス.
+//! @param[out]     result      ダイジェスト.
+//! @retval true    作成に成功.
+//! @retval false   作成に失敗.
+//-----------------------------------------------------------------------------
+bool LoadSceneDigest(const char* path, SceneDigest& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      2つのシーンの差分を求めます.
+//!
+//! @note       インスタンスとライトはハッシュタグ，それ以外は要素番号で対応付けます.
+//!             要素数・テクスチャ・IBL・メッシュのサイズやインスタンスの参照メッシュが
+//!             変わった場合は SceneDiff::Rebuild を立てます.
+//! @param[in]      prev        読み込み済みシーンのダイジェスト.
+//! @param[in]      next        新しいシーンのダイジェスト.
+//! @param[out]     result      差分.
+//-----------------------------------------------------------------------------
+void DiffScene(const SceneDigest& prev, const SceneDigest& next, SceneDiff& result);
+
+} // namespace r3d
@@ -0,0 +1,190 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneStreamer.h
+// Desc : Asynchronous Scene Streamer.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <SceneContainer.h>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// SCENE_STREAM_STATE enum
+///////////////////////////////////////////////////////////////////////////////
+enum SCENE_STREAM_STATE
+{
+    SCENE_STREAM_STATE_IDLE,        //!< 未開始.
+    SCENE_STREAM_STATE_LOADING,     //!< 読み込み中.
+    SCENE_STREAM_STATE_COMPLETED,   //!< 全セクションのアップロード完了.
+    SCENE_STREAM_STATE_FAILED,      //!< 失敗.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneStreamProgress structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneStreamProgress
+{
+    uint32_t    SectionCount;       //!< 総セクション数.
+    uint32_t    DecodedCount;       //!< 展開済みセクション数.
+    uint32_t    UploadedCount;      //!< アップロード済みセクション数.
+    uint64_t    TotalBytes;         //!< 総バイト数 (展開後).
+    uint64_t    UploadedBytes;      //!< アップロード済みバイト数 (展開後).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ISceneUploader interface
+///////////////////////////////////////////////////////////////////////////////
+struct ISceneUploader
+{
+    virtual ~ISceneUploader() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      セクションをアップロードします.
+    //!
+    //! @note       SceneStreamer::Update() を呼び出したスレッドで実行されます.
+    //!             メッシュは番号順，マテリアルは全テクスチャの後，
+    //!             インスタンスは全メッシュの後に呼び出されることが保証されます.
+    //!             インスタンスはマテリアルより先に届くことがあるので，
+    //!             マテリアルは仮の値で埋めておいて後から書き換えます.
+    //!             呼び出しから戻った後はセクションのメモリは解放されます.
+    //!             残しておく場合は SceneStreamer::DetachSection() で引き取ります.
+    //! @param[in]      section     展開済みのセクション.
+    //! @retval true    アップロードに成功.
+    //! @retval false   アップロードに失敗.
+    //-------------------------------------------------------------------------
+    virtual bool Upload(const SceneSection& section) = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneStreamer class
+///////////////////////////////////////////////////////////////////////////////
+class SceneStreamer
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    SceneStreamer() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~SceneStreamer();
+
+    //-------------------------------------------------------------------------
+    //! @brief      読み込みを開始します.
+    //!
+    //! @note       ヘッダの検証までは呼び出しスレッドで行い，
+    //!             セクションの展開は読み込みスレッドとワーカースレッドで行います.
+    //! @param[in]      path            ファイルパス.
+    //! @param[in]      threadCount     展開用ワーカースレッド数. 0 の場合はハードウェアスレッド数.
+    //! @retval true    開始に成功.
+    //! @retval false   開始に失敗.
+    //-------------------------------------------------------------------------
+    bool Start(const char* path, uint32_t threadCount = 0);
+
+    //-------------------------------------------------------------------------
+    //! @brief      読み込みを中断して終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      展開済みのセクションをアップロードします.
+    //!
+    //! @note       アップロードしたバイト数が budget を超えた時点で打ち切ります.
+    //!             ただし毎回少なくとも1セクションは処理します.
+    //! @param[in]      pUploader   アップロード処理.
+    //! @param[in]      budget      1回の呼び出しでアップロードする最大バイト数 (展開後).
+    //! @param[in]      wait        true の場合はアップロードできるセクションが揃うまで待ちます.
+    //! @return     読み込み状態を返却します.
+    //-------------------------------------------------------------------------
+    SCENE_STREAM_STATE Update(ISceneUploader* pUploader, uint64_t budget, bool wait = false);
+
+    //-------------------------------------------------------------------------
+    //! @brief      読み込み状態を取得します.
+    //-------------------------------------------------------------------------
+    SCENE_STREAM_STATE GetState() const
+    { return m_State; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      進捗を取得します.
+    //-------------------------------------------------------------------------
+    SceneStreamProgress GetProgress() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      ヘッダを取得します.
+    //-------------------------------------------------------------------------
+    const SceneContainerHeader& GetHeader() const
+    { return m_Header; }
+
+    //-------------------------------------------------------------------------
+    //! @brief      アップロード中のセクションのメモリを引き取ります.
+    //!
+    //! @note       ISceneUploader::Upload() の中でだけ呼び出せます.
+    //! @param[in]      index       セクション番号.
+    //! @return     セクションのメモリを返却します. 失敗した場合は nullptr を返却します.
+    //-------------------------------------------------------------------------
+    std::unique_ptr<uint8_t[]> DetachSection(uint32_t index)
+    { return m_Container.DetachSection(index); }
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    SceneContainer              m_Container;        //!< 読み込みが終わったら閉じる (ホットリロードで上書きできるように).
+    SceneContainerHeader        m_Header        = {};
+    uint32_t                    m_SectionCount  = 0;
+    std::thread                 m_Thread;
+    mutable std::mutex          m_Mutex;
+    std::condition_variable     m_Cond;
+    std::vector<SceneSection>   m_Decoded;          //!< 展開済みで未受け取りのセクション (m_Mutex で保護).
+    bool                        m_DecodeDone    = false;
+    bool                        m_DecodeFailed  = false;
+    std::atomic<bool>           m_Cancel        = { false };
+
+    std::vector<SceneSection>   m_Pending;          //!< 受け取り済みで未アップロードのセクション.
+    SCENE_STREAM_STATE          m_State         = SCENE_STREAM_STATE_IDLE;
+    uint32_t                    m_DecodedCount  = 0;
+    uint32_t                    m_UploadedCount = 0;
+    uint64_t                    m_TotalBytes    = 0;
+    uint64_t                    m_UploadedBytes = 0;
+    uint32_t                    m_NextMesh      = 0;
+    uint32_t                    m_TextureCount  = 0;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    SceneStreamer   (const SceneStreamer&) = delete;
+    void operator = (const SceneStreamer&) = delete;
+
+    bool   IsUploadable(const SceneSection& section) const;
+    size_t FindNext() const;
+    void   OnUploaded(const SceneSection& section);
+    void   Close();
+};
+
+} // namespace r3d
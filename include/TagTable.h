@@ -0,0 +1,105 @@
+﻿//-----------------------------------------------------------------------------
+// File : TagTable.h
+// Desc : Minimal Perfect Hash Table for Hash Tags.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+#include <SceneCommon.h>
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//! @brief      ハッシュタグの最小完全ハッシュ表を構築します.
+//!
+//! @note       バケット毎にシードを探索する hash-and-displace 法です.
+//!             seeds[i] が負の場合は (-seeds[i] - 1) が直接スロット番号を表します.
+//!             slots[k].Index() は tags 上の要素番号です.
+//! @param[in]      tags        ハッシュタグ.
+//! @param[in]      count       ハッシュタグ数.
+//! @param[out]     seeds       バケット毎のシード.
+//! @param[out]     slots       スロット毎のハッシュタグと要素番号.
+//! @retval true    構築に成功.
+//! @retval false   ハッシュタグが重複しています.
+//-----------------------------------------------------------------------------
+bool BuildTagTable
+(
+    const uint32_t*             tags,
+    uint32_t                    count,
+    std::vector<int32_t>&       seeds,
+    std::vector<ResTagSlot>&    slots
+);
+
+///////////////////////////////////////////////////////////////////////////////
+// TagTable class
+///////////////////////////////////////////////////////////////////////////////
+class TagTable
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      シーンファイルに格納された表を参照します.
+    //!
+    //! @note       表はコピーしないので, Term() を呼び出すまでメモリを保持してください.
+    //! @param[in]      seeds       バケット毎のシード.
+    //! @param[in]      slots       スロット毎のハッシュタグと要素番号.
+    //! @retval true    初期化に成功.
+    //! @retval false   表が不正です.
+    //-------------------------------------------------------------------------
+    bool Init(const flatbuffers::Vector<int32_t>* seeds, const flatbuffers::Vector<const ResTagSlot*>* slots);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ハッシュタグから表を構築します.
+    //!
+    //! @note       表を持たない古いシーンファイル用です.
+    //! @param[in]      tags        ハッシュタグ.
+    //! @param[in]      count       ハッシュタグ数.
+    //! @retval true    構築に成功.
+    //! @retval false   ハッシュタグが重複しています.
+    //-------------------------------------------------------------------------
+    bool Init(const uint32_t* tags, uint32_t count);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      ハッシュタグに対応する要素番号を検索します.
+    //!
+    //! @param[in]      hashTag     ハッシュタグ.
+    //! @return     要素番号を返却します. 見つからない場合は UINT32_MAX を返却します.
+    //-------------------------------------------------------------------------
+    uint32_t Find(uint32_t hashTag) const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    const int32_t*              m_pSeeds    = nullptr;
+    const ResTagSlot*           m_pSlots    = nullptr;
+    uint32_t                    m_Count     = 0;
+    std::vector<int32_t>        m_Seeds;                //!< 表を持たないシーンファイル用に構築した表.
+    std::vector<ResTagSlot>     m_Slots;
+};
+
+} // namespace r3d
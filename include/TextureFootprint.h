@@ -0,0 +1,99 @@
+﻿//-----------------------------------------------------------------------------
+// File : TextureFootprint.h
+// Desc : Texture Upload Footprint.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+
+
+namespace r3d {
+
+static constexpr uint32_t TEXTURE_DATA_PITCH_ALIGNMENT      = 256;  // D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+static constexpr uint32_t TEXTURE_DATA_PLACEMENT_ALIGNMENT  = 512;  // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+///////////////////////////////////////////////////////////////////////////////
+// TEXTURE_OPTION enum
+///////////////////////////////////////////////////////////////////////////////
+enum TEXTURE_OPTION
+{
+    //! Resources[0] にアップロードバッファの配置そのままで全サブリソースが格納されている.
+    TEXTURE_OPTION_PLACED_FOOTPRINT = 0x1,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureFootprint structure
+///////////////////////////////////////////////////////////////////////////////
+struct TextureFootprint
+{
+    uint64_t    Offset;         //!< バッファ先頭からのオフセット.
+    uint32_t    Width;          //!< 横幅 (ブロック圧縮の場合はブロック境界に切り上げ).
+    uint32_t    Height;         //!< 縦幅 (ブロック圧縮の場合はブロック境界に切り上げ).
+    uint32_t    Depth;          //!< 奥行.
+    uint32_t    RowPitch;       //!< 1行あたりのバイト数 (アラインメント込み).
+    uint32_t    RowCount;       //!< 1スライスあたりの行数.
+    uint32_t    RowSize;        //!< 1行あたりの有効なバイト数.
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      DXGI_FORMAT のビット数を取得します.
+//!
+//! @param[in]      format      DXGI_FORMAT の値.
+//! @return     1ピクセルあたりのビット数を返却します. 未対応の場合は0を返却します.
+//-----------------------------------------------------------------------------
+uint32_t GetBitsPerPixel(uint32_t format);
+
+//-----------------------------------------------------------------------------
+//! @brief      DXGI_FORMAT の名前を取得します.
+//!
+//! @param[in]      format      DXGI_FORMAT の値.
+//! @return     "DXGI_FORMAT_" を除いた名前を返却します. 未知の値の場合は "UNKNOWN" を返却します.
+//-----------------------------------------------------------------------------
+const char* GetFormatName(uint32_t format);
+
+//-----------------------------------------------------------------------------
+//! @brief      ブロック圧縮フォーマットかどうかチェックします.
+//!
+//! @param[in]      format      DXGI_FORMAT の値.
+//! @retval true    ブロック圧縮フォーマットです.
+//! @retval false   非圧縮フォーマットです.
+//-----------------------------------------------------------------------------
+bool IsBlockCompressed(uint32_t format);
+
+//-----------------------------------------------------------------------------
+//! @brief      アップロードバッファ上のサブリソース配置を計算します.
+//!
+//! @note       ID3D12Device::GetCopyableFootprints() と同じ規則で計算するので，
+//!             デバイス無しで出力データのレイアウトを決められます.
+//!             サブリソースの並びは D3D12 のサブリソース番号順 (サーフェイス毎にミップ) です.
+//! @param[in]      dimension       テクスチャの次元 (TEXTURE_DIMENSION の値).
+//! @param[in]      width           横幅.
+//! @param[in]      height          縦幅.
+//! @param[in]      depth           奥行 (3Dテクスチャ以外は1).
+//! @param[in]      format          DXGI_FORMAT の値.
+//! @param[in]      mipLevels       ミップレベル数.
+//! @param[in]      surfaceCount    サーフェイス数.
+//! @param[out]     result          サブリソース毎の配置.
+//! @param[out]     totalSize       必要なバッファサイズ.
+//! @retval true    計算に成功.
+//! @retval false   未対応のフォーマットまたは不正なサイズ.
+//-----------------------------------------------------------------------------
+bool CalcTextureFootprints
+(
+    uint32_t                        dimension,
+    uint32_t                        width,
+    uint32_t                        height,
+    uint32_t                        depth,
+    uint32_t                        format,
+    uint32_t                        mipLevels,
+    uint32_t                        surfaceCount,
+    std::vector<TextureFootprint>&  result,
+    uint64_t&                       totalSize
+);
+
+} // namespace r3d
@@ -0,0 +1,124 @@
+﻿//-----------------------------------------------------------------------------
+// File : UploadHeap.h
+// Desc : Persistent Upload Heap.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <d3d12.h>
+#include <vector>
+#include <gfx/asdxCommandQueue.h>
+#include <UploadRing.h>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadRegion structure
+///////////////////////////////////////////////////////////////////////////////
+struct UploadRegion
+{
+    ID3D12Resource*     pResource   = nullptr;  //!< コピー元リソース.
+    uint64_t            Offset      = 0;        //!< リソース先頭からのオフセット.
+    uint8_t*            pData       = nullptr;  //!< 書き込み先.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadHeap class
+///////////////////////////////////////////////////////////////////////////////
+class UploadHeap
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      size        リングバッファのサイズ.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint64_t size);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      アップロード領域を割り当てます.
+    //!
+    //! @note       リングバッファに空きが無い場合はサブミット済みのコピーの完了を待ちます.
+    //!             待っても収まらない場合は単発のアップロードバッファを生成し，
+    //!             次のフレーム以降に破棄します.
+    //! @param[in]      size        サイズ.
+    //! @param[in]      alignment   アライメント (2の累乗).
+    //! @param[out]     result      割り当てた領域.
+    //! @retval true    割り当てに成功.
+    //! @retval false   割り当てに失敗.
+    //-------------------------------------------------------------------------
+    bool Alloc(uint64_t size, uint64_t alignment, UploadRegion& result);
+
+    //-------------------------------------------------------------------------
+    //! @brief      コピー完了後に発行するリソースバリアを追加します.
+    //-------------------------------------------------------------------------
+    void AddBarrier(const D3D12_RESOURCE_BARRIER& barrier);
+
+    //-------------------------------------------------------------------------
+    //! @brief      溜めたリソースバリアをまとめて発行します.
+    //!
+    //! @param[in]      pCmdList    コマンドリスト.
+    //-------------------------------------------------------------------------
+    void FlushBarriers(ID3D12GraphicsCommandList6* pCmdList);
+
+    //-------------------------------------------------------------------------
+    //! @brief      コピーコマンドを含むサブミットの待機点を設定します.
+    //!
+    //! @note       完了済みのサブミットの領域もここで回収されます.
+    //! @param[in]      waitPoint   ExecuteCommandLists() 直後に発行した待機点.
+    //-------------------------------------------------------------------------
+    void Submit(const asdx::WaitPoint& waitPoint);
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計情報を取得します.
+    //-------------------------------------------------------------------------
+    const UploadRingStats& GetStats() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      単発バッファにフォールバックした回数を取得します.
+    //-------------------------------------------------------------------------
+    uint64_t GetFallbackCount() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    UploadRing                              m_Ring;
+    ID3D12Resource*                         m_pBuffer       = nullptr;
+    uint8_t*                                m_pData         = nullptr;
+    ID3D12Fence*                            m_pFence        = nullptr;
+    uint64_t                                m_FallbackCount = 0;
+    std::vector<D3D12_RESOURCE_BARRIER>     m_Barriers;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    bool AllocFallback(uint64_t size, UploadRegion& result);
+};
+
+} // namespace r3d
@@ -0,0 +1,151 @@
+﻿//-----------------------------------------------------------------------------
+// File : UploadRing.h
+// Desc : Fence Tracked Ring Allocator.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <deque>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadRingStats structure
+///////////////////////////////////////////////////////////////////////////////
+struct UploadRingStats
+{
+    uint64_t    AllocCount      = 0;    //!< 割り当て回数.
+    uint64_t    AllocSize       = 0;    //!< 割り当てた合計サイズ.
+    uint64_t    PaddingSize     = 0;    //!< アライメントと折り返しで捨てた合計サイズ.
+    uint64_t    WrapCount       = 0;    //!< 折り返し回数.
+    uint64_t    FullCount       = 0;    //!< 空きが足りずに失敗した回数.
+    uint64_t    OversizeCount   = 0;    //!< 容量を超える要求で失敗した回数.
+    uint64_t    StallCount      = 0;    //!< 空きを作るためにフェンスを待った回数.
+    uint64_t    RetireCount     = 0;    //!< 回収したサブミット数.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadRing class
+///////////////////////////////////////////////////////////////////////////////
+class UploadRing
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @param[in]      capacity    容量.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(uint64_t capacity);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      領域を割り当てます.
+    //!
+    //! @note       末尾に収まらない場合は先頭に折り返します.
+    //! @param[in]      size        サイズ.
+    //! @param[in]      alignment   アライメント (2の累乗).
+    //! @param[out]     offset      バッファ先頭からのオフセット.
+    //! @retval true    割り当てに成功.
+    //! @retval false   空きが足りないか容量を超えています.
+    //-------------------------------------------------------------------------
+    bool Alloc(uint64_t size, uint64_t alignment, uint64_t& offset);
+
+    //-------------------------------------------------------------------------
+    //! @brief      前回のサブミット以降の割り当てをフェンス値に紐づけます.
+    //!
+    //! @param[in]      fenceValue  コピーコマンドを含むサブミットのフェンス値.
+    //-------------------------------------------------------------------------
+    void Submit(uint64_t fenceValue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      完了したサブミットの領域を回収します.
+    //!
+    //! @param[in]      completedValue  GPUが完了したフェンス値.
+    //-------------------------------------------------------------------------
+    void Retire(uint64_t completedValue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      フェンスを待った後に領域を回収します.
+    //!
+    //! @param[in]      fenceValue  CPUで待ったフェンス値.
+    //-------------------------------------------------------------------------
+    void Stall(uint64_t fenceValue);
+
+    //-------------------------------------------------------------------------
+    //! @brief      指定サイズを割り当てるために待つべきフェンス値を求めます.
+    //!
+    //! @param[in]      size        サイズ.
+    //! @param[in]      alignment   アライメント (2の累乗).
+    //! @param[out]     fenceValue  待つべきフェンス値.
+    //! @retval true    待てば割り当てられます.
+    //! @retval false   サブミット前の割り当てが残っているため待っても割り当てられません.
+    //-------------------------------------------------------------------------
+    bool FindStallFence(uint64_t size, uint64_t alignment, uint64_t& fenceValue) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      容量を取得します.
+    //-------------------------------------------------------------------------
+    uint64_t GetCapacity() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      使用中のサイズを取得します.
+    //-------------------------------------------------------------------------
+    uint64_t GetUsedSize() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      統計情報を取得します.
+    //-------------------------------------------------------------------------
+    const UploadRingStats& GetStats() const;
+
+private:
+    ///////////////////////////////////////////////////////////////////////////
+    // Submission structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Submission
+    {
+        uint64_t    FenceValue;     //!< フェンス値.
+        uint64_t    End;            //!< 割り当ての終端 (通算位置).
+    };
+
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    uint64_t                m_Capacity  = 0;
+    uint64_t                m_Head      = 0;    //!< 次に割り当てる通算位置.
+    uint64_t                m_Tail      = 0;    //!< 回収されていない先頭の通算位置.
+    uint64_t                m_Submitted = 0;    //!< サブミット済みの通算位置.
+    std::deque<Submission>  m_Submissions;
+    UploadRingStats         m_Stats;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    bool Place(uint64_t tail, uint64_t size, uint64_t alignment, uint64_t& begin) const;
+};
+
+} // namespace r3d
@@ -0,0 +1,188 @@
+﻿//-----------------------------------------------------------------------------
+// File : VideoStream.h
+// Desc : Ordered Raw Video Stream Writer.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// STREAM_FORMAT enum
+///////////////////////////////////////////////////////////////////////////////
+enum STREAM_FORMAT
+{
+    STREAM_FORMAT_Y4M_420,      //!< YUV4MPEG2 (BT.709 limited, 4:2:0).
+    STREAM_FORMAT_Y4M_444,      //!< YUV4MPEG2 (BT.709 limited, 4:4:4).
+    STREAM_FORMAT_RAW_RGBA,     //!< ヘッダ無しの RGBA8 (行間無し).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// VideoStreamDesc structure
+///////////////////////////////////////////////////////////////////////////////
+struct VideoStreamDesc
+{
+    const char*     Path;           //!< 出力先. '|' で始まる場合は残りをコマンドとして起動し標準入力に流す.
+    STREAM_FORMAT   Format;         //!< 出力フォーマット.
+    uint32_t        Width;          //!< 横幅[px].
+    uint32_t        Height;         //!< 縦幅[px].
+    double          FrameRate;      //!< フレームレート (y4m のヘッダに記録).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// VideoStream class
+///////////////////////////////////////////////////////////////////////////////
+class VideoStream
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      コンストラクタです.
+    //-------------------------------------------------------------------------
+    VideoStream() = default;
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~VideoStream();
+
+    //-------------------------------------------------------------------------
+    //! @brief      初期化処理を行います.
+    //!
+    //! @note       出力先を開き, ストリームのヘッダを書き出します.
+    //! @param[in]      desc        構成設定.
+    //! @retval true    初期化に成功.
+    //! @retval false   初期化に失敗.
+    //-------------------------------------------------------------------------
+    bool Init(const VideoStreamDesc& desc);
+
+    //-------------------------------------------------------------------------
+    //! @brief      終了処理を行います.
+    //!
+    //! @note       パイプの場合は起動したコマンドの終了を待ちます.
+    //-------------------------------------------------------------------------
+    void Term();
+
+    //-------------------------------------------------------------------------
+    //! @brief      RGBA8 の画像を1フレーム分のストリームデータに変換します.
+    //!
+    //! @note       複数のスレッドから同時に呼び出せます.
+    //! @param[in]      pPixels     画素データ (RGBA8, Init() で指定したサイズ).
+    //! @param[in]      pitch       1行のバイト数.
+    //! @param[out]     result      変換結果 (y4m の場合は FRAME ヘッダを含む).
+    //-------------------------------------------------------------------------
+    void Convert(const uint8_t* pPixels, uint32_t pitch, std::vector<uint8_t>& result) const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      フレームを書き出します.
+    //!
+    //! @note       0 から連番のフレーム番号の順に書き出します. 前のフレームが
+    //!             書き出されるまで呼び出しスレッドを待たせるので, 後続のフレームを
+    //!             持つワーカーがエンコードプールのバッファを保持したままになり,
+    //!             並べ替え待ちのフレーム数はプールのバッファ数で抑えられます.
+    //!             書き込みに失敗した場合も順番は進めるので, 後続のフレームは待ち続けません.
+    //! @param[in]      frameIndex  フレーム番号.
+    //! @param[in]      data        Convert() の変換結果.
+    //! @retval true    書き出しに成功.
+    //! @retval false   書き出しに失敗.
+    //-------------------------------------------------------------------------
+    bool Write(uint32_t frameIndex, const std::vector<uint8_t>& data);
+
+    //-------------------------------------------------------------------------
+    //! @brief      出力先が開かれているかどうかチェックします.
+    //-------------------------------------------------------------------------
+    bool IsOpen() const;
+
+    //-------------------------------------------------------------------------
+    //! @brief      書き出したフレーム数を取得します.
+    //-------------------------------------------------------------------------
+    uint32_t GetWrittenCount() const;
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    FILE*                       m_pFile         = nullptr;
+    bool                        m_IsPipe        = false;
+    STREAM_FORMAT               m_Format        = STREAM_FORMAT_Y4M_420;
+    uint32_t                    m_Width         = 0;
+    uint32_t                    m_Height        = 0;
+    mutable std::mutex          m_Mutex;
+    std::condition_variable     m_TurnCond;                 //!< 書き出し順番の通知.
+    uint32_t                    m_NextIndex     = 0;        //!< 次に書き出すフレーム番号 (m_Mutex で保護).
+    uint32_t                    m_WrittenCount  = 0;        //!< 書き出したフレーム数 (m_Mutex で保護).
+    bool                        m_Failed        = false;    //!< 書き込みエラーが発生した (m_Mutex で保護).
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    VideoStream     (const VideoStream&) = delete;
+    void operator = (const VideoStream&) = delete;
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      RGBA8 を BT.709 limited range の YUV 4:2:0 (planar) に変換します.
+//!
+//! @note       色差は 2x2 画素の平均から求めます (y4m の C420jpeg と同じ配置).
+//!             奇数サイズの場合, 端の色差は残りの画素で平均します.
+//! @param[in]      pPixels     画素データ (RGBA8).
+//! @param[in]      width       横幅[px].
+//! @param[in]      height      縦幅[px].
+//! @param[in]      pitch       1行のバイト数.
+//! @param[out]     pY          輝度 (width * height).
+//! @param[out]     pU          色差 Cb (((width + 1) / 2) * ((height + 1) / 2)).
+//! @param[out]     pV          色差 Cr (pU と同じサイズ).
+//-----------------------------------------------------------------------------
+void ConvertToYuv420(
+    const uint8_t*  pPixels,
+    uint32_t        width,
+    uint32_t        height,
+    uint32_t        pitch,
+    uint8_t*        pY,
+    uint8_t*        pU,
+    uint8_t*        pV);
+
+//-----------------------------------------------------------------------------
+//! @brief      RGBA8 を BT.709 limited range の YUV 4:4:4 (planar) に変換します.
+//!
+//! @param[in]      pPixels     画素データ (RGBA8).
+//! @param[in]      width       横幅[px].
+//! @param[in]      height      縦幅[px].
+//! @param[in]      pitch       1行のバイト数.
+//! @param[out]     pY          輝度 (width * height).
+//! @param[out]     pU          色差 Cb (width * height).
+//! @param[out]     pV          色差 Cr (width * height).
+//-----------------------------------------------------------------------------
+void ConvertToYuv444(
+    const uint8_t*  pPixels,
+    uint32_t        width,
+    uint32_t        height,
+    uint32_t        pitch,
+    uint8_t*        pY,
+    uint8_t*        pU,
+    uint8_t*        pV);
+
+} // namespace r3d
@@ -33,6 +33,8 @@ struct ResInstance;
 
 struct ResLight;
 
+struct ResTagSlot;
+
 struct ResScene;
 struct ResSceneBuilder;
 
@@ -322,6 +324,29 @@ FLATBUFFERS_MANUALLY_ALIGNED_STRUCT(4) ResLight FLATBUFFERS_FINAL_CLASS {
 };
 FLATBUFFERS_STRUCT_END(ResLight, 32);
 
+FLATBUFFERS_MANUALLY_ALIGNED_STRUCT(4) ResTagSlot FLATBUFFERS_FINAL_CLASS {
+ private:
+  uint32_t Tag_;
+  uint32_t Index_;
+
+ public:
+  ResTagSlot()
+      : Tag_(0),
+        Index_(0) {
+  }
+  ResTagSlot(uint32_t _Tag, uint32_t _Index)
+      : Tag_(flatbuffers::EndianScalar(_Tag)),
+        Index_(flatbuffers::EndianScalar(_Index)) {
+  }
+  uint32_t Tag() const {
+    return flatbuffers::EndianScalar(Tag_);
+  }
+  uint32_t Index() const {
+    return flatbuffers::EndianScalar(Index_);
+  }
+};
+FLATBUFFERS_STRUCT_END(ResTagSlot, 8);
+
 struct SubResource FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   typedef SubResourceBuilder Builder;
   enum FlatBuffersVTableOffset FLATBUFFERS_VTABLE_UNDERLYING_TYPE {
@@ -685,7 +710,11 @@ struct ResScene FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
     VT_MATERIALS = 22,
     VT_LIGHTS = 24,
     VT_INSTANCETAGS = 26,
-    VT_LIGHTTAGS = 28
+    VT_LIGHTTAGS = 28,
+    VT_INSTANCETAGSEEDS = 30,
+    VT_INSTANCETAGSLOTS = 32,
+    VT_LIGHTTAGSEEDS = 34,
+    VT_LIGHTTAGSLOTS = 36
   };
   uint32_t MeshCount() const {
     return GetField<uint32_t>(VT_MESHCOUNT, 0);
@@ -726,6 +755,18 @@ struct ResScene FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
   const flatbuffers::Vector<uint32_t> *LightTags() const {
     return GetPointer<const flatbuffers::Vector<uint32_t> *>(VT_LIGHTTAGS);
   }
+  const flatbuffers::Vector<int32_t> *InstanceTagSeeds() const {
+    return GetPointer<const flatbuffers::Vector<int32_t> *>(VT_INSTANCETAGSEEDS);
+  }
+  const flatbuffers::Vector<const r3d::ResTagSlot *> *InstanceTagSlots() const {
+    return GetPointer<const flatbuffers::Vector<const r3d::ResTagSlot *> *>(VT_INSTANCETAGSLOTS);
+  }
+  const flatbuffers::Vector<int32_t> *LightTagSeeds() const {
+    return GetPointer<const flatbuffers::Vector<int32_t> *>(VT_LIGHTTAGSEEDS);
+  }
+  const flatbuffers::Vector<const r3d::ResTagSlot *> *LightTagSlots() const {
+    return GetPointer<const flatbuffers::Vector<const r3d::ResTagSlot *> *>(VT_LIGHTTAGSLOTS);
+  }
   bool Verify(flatbuffers::Verifier &verifier) const {
     return VerifyTableStart(verifier) &&
            VerifyField<uint32_t>(verifier, VT_MESHCOUNT) &&
@@ -751,6 +792,14 @@ struct ResScene FLATBUFFERS_FINAL_CLASS : private flatbuffers::Table {
            verifier.VerifyVector(InstanceTags()) &&
            VerifyOffset(verifier, VT_LIGHTTAGS) &&
            verifier.VerifyVector(LightTags()) &&
+           VerifyOffset(verifier, VT_INSTANCETAGSEEDS) &&
+           verifier.VerifyVector(InstanceTagSeeds()) &&
+           VerifyOffset(verifier, VT_INSTANCETAGSLOTS) &&
+           verifier.VerifyVector(InstanceTagSlots()) &&
+           VerifyOffset(verifier, VT_LIGHTTAGSEEDS) &&
+           verifier.VerifyVector(LightTagSeeds()) &&
+           VerifyOffset(verifier, VT_LIGHTTAGSLOTS) &&
+           verifier.VerifyVector(LightTagSlots()) &&
            verifier.EndTable();
   }
 };
@@ -798,6 +847,18 @@ struct ResSceneBuilder {
   void add_LightTags(flatbuffers::Offset<flatbuffers::Vector<uint32_t>> LightTags) {
     fbb_.AddOffset(ResScene::VT_LIGHTTAGS, LightTags);
   }
+  void add_InstanceTagSeeds(flatbuffers::Offset<flatbuffers::Vector<int32_t>> InstanceTagSeeds) {
+    fbb_.AddOffset(ResScene::VT_INSTANCETAGSEEDS, InstanceTagSeeds);
+  }
+  void add_InstanceTagSlots(flatbuffers::Offset<flatbuffers::Vector<const r3d::ResTagSlot *>> InstanceTagSlots) {
+    fbb_.AddOffset(ResScene::VT_INSTANCETAGSLOTS, InstanceTagSlots);
+  }
+  void add_LightTagSeeds(flatbuffers::Offset<flatbuffers::Vector<int32_t>> LightTagSeeds) {
+    fbb_.AddOffset(ResScene::VT_LIGHTTAGSEEDS, LightTagSeeds);
+  }
+  void add_LightTagSlots(flatbuffers::Offset<flatbuffers::Vector<const r3d::ResTagSlot *>> LightTagSlots) {
+    fbb_.AddOffset(ResScene::VT_LIGHTTAGSLOTS, LightTagSlots);
+  }
   explicit ResSceneBuilder(flatbuffers::FlatBufferBuilder &_fbb)
         : fbb_(_fbb) {
     start_ = fbb_.StartTable();
@@ -823,8 +884,16 @@ inline flatbuffers::Offset<ResScene> CreateResScene(
     flatbuffers::Offset<flatbuffers::Vector<const r3d::ResMaterial *>> Materials = 0,
     flatbuffers::Offset<flatbuffers::Vector<const r3d::ResLight *>> Lights = 0,
     flatbuffers::Offset<flatbuffers::Vector<uint32_t>> InstanceTags = 0,
-    flatbuffers::Offset<flatbuffers::Vector<uint32_t>> LightTags = 0) {
+    flatbuffers::Offset<flatbuffers::Vector<uint32_t>> LightTags = 0,
+    flatbuffers::Offset<flatbuffers::Vector<int32_t>> InstanceTagSeeds = 0,
+    flatbuffers::Offset<flatbuffers::Vector<const r3d::ResTagSlot *>> InstanceTagSlots = 0,
+    flatbuffers::Offset<flatbuffers::Vector<int32_t>> LightTagSeeds = 0,
+    flatbuffers::Offset<flatbuffers::Vector<const r3d::ResTagSlot *>> LightTagSlots = 0) {
   ResSceneBuilder builder_(_fbb);
+  builder_.add_LightTagSlots(LightTagSlots);
+  builder_.add_LightTagSeeds(LightTagSeeds);
+  builder_.add_InstanceTagSlots(InstanceTagSlots);
+  builder_.add_InstanceTagSeeds(InstanceTagSeeds);
   builder_.add_LightTags(LightTags);
   builder_.add_InstanceTags(InstanceTags);
   builder_.add_Lights(Lights);
@@ -855,7 +924,11 @@ inline flatbuffers::Offset<ResScene> CreateResSceneDirect(
     const std::vector<r3d::ResMaterial> *Materials = nullptr,
     const std::vector<r3d::ResLight> *Lights = nullptr,
     const std::vector<uint32_t> *InstanceTags = nullptr,
-    const std::vector<uint32_t> *LightTags = nullptr) {
+    const std::vector<uint32_t> *LightTags = nullptr,
+    const std::vector<int32_t> *InstanceTagSeeds = nullptr,
+    const std::vector<r3d::ResTagSlot> *InstanceTagSlots = nullptr,
+    const std::vector<int32_t> *LightTagSeeds = nullptr,
+    const std::vector<r3d::ResTagSlot> *LightTagSlots = nullptr) {
   auto Meshes__ = Meshes ? _fbb.CreateVector<flatbuffers::Offset<r3d::ResMesh>>(*Meshes) : 0;
   auto Instances__ = Instances ? _fbb.CreateVectorOfStructs<r3d::ResInstance>(*Instances) : 0;
   auto Textures__ = Textures ? _fbb.CreateVector<flatbuffers::Offset<r3d::ResTexture>>(*Textures) : 0;
@@ -863,6 +936,10 @@ inline flatbuffers::Offset<ResScene> CreateResSceneDirect(
   auto Lights__ = Lights ? _fbb.CreateVectorOfStructs<r3d::ResLight>(*Lights) : 0;
   auto InstanceTags__ = InstanceTags ? _fbb.CreateVector<uint32_t>(*InstanceTags) : 0;
   auto LightTags__ = LightTags ? _fbb.CreateVector<uint32_t>(*LightTags) : 0;
+  auto InstanceTagSeeds__ = InstanceTagSeeds ? _fbb.CreateVector<int32_t>(*InstanceTagSeeds) : 0;
+  auto InstanceTagSlots__ = InstanceTagSlots ? _fbb.CreateVectorOfStructs<r3d::ResTagSlot>(*InstanceTagSlots) : 0;
+  auto LightTagSeeds__ = LightTagSeeds ? _fbb.CreateVector<int32_t>(*LightTagSeeds) : 0;
+  auto LightTagSlots__ = LightTagSlots ? _fbb.CreateVectorOfStructs<r3d::ResTagSlot>(*LightTagSlots) : 0;
   return r3d::CreateResScene(
       _fbb,
       MeshCount,
@@ -877,7 +954,11 @@ inline flatbuffers::Offset<ResScene> CreateResSceneDirect(
       Materials__,
       Lights__,
       InstanceTags__,
-      LightTags__);
+      LightTags__,
+      InstanceTagSeeds__,
+      InstanceTagSlots__,
+      LightTagSeeds__,
+      LightTagSlots__);
 }
 
 inline const r3d::ResScene *GetResScene(const void *buf) {
@@ -0,0 +1,89 @@
+﻿//-----------------------------------------------------------------------------
+// File : CameraSequenceExporter.h
+// Desc : Camera Sequence Exporter.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <offline/VectorMath.h>
+
+
+namespace r3d {
+namespace offline {
+
+///////////////////////////////////////////////////////////////////////////////
+// CameraParam structure
+///////////////////////////////////////////////////////////////////////////////
+struct CameraParam
+{
+    uint32_t        FrameIndex;
+    Vector3         Position;
+    Vector3         Target;
+    Vector3         Upward;
+    float           FieldOfView;
+    float           NearClip;
+    float           FarClip;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CameraSequenceExporter class
+///////////////////////////////////////////////////////////////////////////////
+class CameraSequenceExporter
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      テキストファイルからデータをロードし，出力します.
+    //!
+    //! @param[in]      path        カメラ設定ファイルパス.
+    //! @param[out]     exportPath  出力ファイルパス.
+    //! @retval true    出力に成功.
+    //! @retval false   出力に失敗.
+    //-------------------------------------------------------------------------
+    bool LoadFromTXT(const char* path, std::string& exportPath);
+
+    //-------------------------------------------------------------------------
+    //! @brief      テキストファイルからデータをロードします.
+    //!
+    //! @param[in]      path        カメラ設定ファイルパス.
+    //! @param[out]     exportPath  export ブロックに記述された出力パス. 記述が無い場合は空文字.
+    //! @retval true    ロードに成功.
+    //! @retval false   ロードに失敗.
+    //-------------------------------------------------------------------------
+    bool Parse(const char* path, std::string& exportPath);
+
+    bool Export(const char* path);
+    void Reset();
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<CameraParam>    m_Params;
+
+    //=========================================================================
+    // private methods.
+    //=========================================================================
+    /* NOTHING */
+};
+
+} // namespace offline
+} // namespace r3d
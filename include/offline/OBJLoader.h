@@ -8,10 +8,14 @@
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
+#include <string>
 #include <vector>
-#include <fnd/asdxMath.h>
+#include <offline/VectorMath.h>
 
 
+namespace r3d {
+namespace offline {
+
 ///////////////////////////////////////////////////////////////////////////////
 // SubsetOBJ structure
 ///////////////////////////////////////////////////////////////////////////////
@@ -39,10 +43,10 @@ struct IndexOBJ
 struct MaterialOBJ
 {
     std::string     Name;       //!< マテリアル名.
-    asdx::Vector3   Ka;         //!< アンビエント.
-    asdx::Vector3   Kd;         //!< ディフューズ.
-    asdx::Vector3   Ks;         //!< スペキュラー.
-    asdx::Vector3   Ke;         //!< エミッシブ.
+    Vector3         Ka;         //!< アンビエント.
+    Vector3         Kd;         //!< ディフューズ.
+    Vector3         Ks;         //!< スペキュラー.
+    Vector3         Ke;         //!< エミッシブ.
     float           Tr;         //!< 透過度.
     float           Ns;         //!< シャイネス.
     std::string     map_Ka;     //!< アンビエントマップ.
@@ -59,10 +63,10 @@ struct MaterialOBJ
 ///////////////////////////////////////////////////////////////////////////////
 struct VertexOBJ
 {
-    asdx::Vector3   Position;
-    asdx::Vector3   Normal;
-    asdx::Vector3   Tangent;
-    asdx::Vector2   TexCoord;
+    Vector3   Position;
+    Vector3   Normal;
+    Vector3   Tangent;
+    Vector2   TexCoord;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -165,3 +169,6 @@ private:
     //-------------------------------------------------------------------------
     bool LoadMTL(const char* path, ModelOBJ& model);
 };
+
+} // namespace offline
+} // namespace r3d
@@ -0,0 +1,190 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneExporter.h
+// Desc : Scene Exporter.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <string>
+#include <vector>
+#include <SceneCommon.h>
+#include <offline/VectorMath.h>
+
+
+namespace r3d {
+namespace offline {
+
+///////////////////////////////////////////////////////////////////////////////
+// Light structure
+///////////////////////////////////////////////////////////////////////////////
+struct Light
+{
+    uint32_t        HashTag;
+    uint32_t        Type;
+    Vector3         Position;
+    Vector3         Intensity;
+    float           Radius;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Material structure
+///////////////////////////////////////////////////////////////////////////////
+struct Material
+{
+    uint32_t    BaseColorMap;
+    uint32_t    NormalMap;
+    uint32_t    OrmMap;
+    uint32_t    EmissiveMap;
+
+    Vector4     BaseColor;  // xyz: BaseColor, w: Alpha.
+    float       Occlusion;
+    float       Roughness;
+    float       Metalness;
+    float       Ior;
+    Vector4     Emissive;   // xyz: Color, w: Scale.
+
+    //-------------------------------------------------------------------------
+    //! @brief      デフォルト値を取得します.
+    //-------------------------------------------------------------------------
+    static Material Default()
+    {
+        Material mat = {};
+        mat.BaseColorMap = INVALID_MATERIAL_MAP;
+        mat.NormalMap    = INVALID_MATERIAL_MAP;
+        mat.OrmMap       = INVALID_MATERIAL_MAP;
+        mat.EmissiveMap  = INVALID_MATERIAL_MAP;
+
+        mat.BaseColor = Vector4(0.5f, 0.5f, 0.5f, 1.0f);
+        mat.Occlusion = 0.0f;
+        mat.Roughness = 1.0f;
+        mat.Metalness = 0.0f;
+        mat.Ior       = 0.0f;
+        mat.Emissive  = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+
+        return mat;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CpuInstance structure
+///////////////////////////////////////////////////////////////////////////////
+struct CpuInstance
+{
+    uint32_t            HashTag;        //!< ハッシュタグ.
+    uint32_t            MeshId;         //!< メッシュ番号.
+    uint32_t            MaterialId;     //!< マテリアル番号.
+    Transform3x4        Transform;      //!< 変換行列.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneExporter class
+///////////////////////////////////////////////////////////////////////////////
+class SceneExporter
+{
+    //=========================================================================
+    // list of friend classes and methods.
+    //=========================================================================
+    /* NOTHING */
+
+public:
+    //=========================================================================
+    // public variables.
+    //=========================================================================
+    /* NOTHING */
+
+    //=========================================================================
+    // public methods.
+    //=========================================================================
+
+    //-------------------------------------------------------------------------
+    //! @brief      デストラクタです.
+    //-------------------------------------------------------------------------
+    ~SceneExporter();
+
+    //-------------------------------------------------------------------------
+    //! @brief      テキストファイルからシーンを読み込み，出力します.
+    //!
+    //! @param[in]      path        シーン設定ファイルパス.
+    //! @param[out]     exportPath  出力ファイルパス.
+    //! @retval true    出力に成功.
+    //! @retval false   出力に失敗.
+    //-------------------------------------------------------------------------
+    bool LoadFromTXT(const char* path, std::string& exportPath);
+
+    //-------------------------------------------------------------------------
+    //! @brief      テキストファイルからシーンを読み込みます.
+    //!
+    //! @param[in]      path        シーン設定ファイルパス.
+    //! @param[out]     exportPath  export ブロックに記述された出力パス. 記述が無い場合は空文字.
+    //! @retval true    読み込みに成功.
+    //! @retval false   読み込みに失敗.
+    //-------------------------------------------------------------------------
+    bool Parse(const char* path, std::string& exportPath);
+
+    bool Export(const char* path);
+    void Reset();
+
+    void AddLight       (const Light& value);
+    void AddMesh        (const Mesh& value);
+    void AddMeshes      (const std::vector<Mesh>& values);
+    void AddMaterial    (const Material& value);
+    void AddInstance    (const CpuInstance& value);
+    void AddInstances   (const std::vector<CpuInstance>& values);
+    void AddTexture     (const char* path);
+    void SetIBL         (const char* path);
+
+    //-------------------------------------------------------------------------
+    //! @brief      テクスチャをアップロードバッファの配置で出力するかどうか設定します.
+    //!
+    //! @note       有効にすると行ピッチ・配置アラインメント込みで格納するので，
+    //!             読み込み時はサブリソース毎の行コピーが不要になります.
+    //-------------------------------------------------------------------------
+    void SetPlacedFootprint(bool value);
+
+    //-------------------------------------------------------------------------
+    //! @brief      ブロブファイル1つあたりの最大サイズを設定します.
+    //!
+    //! @note       0 以外を設定すると IBL・テクスチャ・メッシュをブロブファイルに分けて出力し，
+    //!             ルートファイルにはセクションテーブルと小さなセクションだけを残します.
+    //!             最大サイズを超えるセクションは単独のブロブファイルになります.
+    //-------------------------------------------------------------------------
+    void SetBlobSize(uint64_t value);
+
+private:
+    //=========================================================================
+    // private variables.
+    //=========================================================================
+    std::vector<Light>          m_Lights;
+    std::vector<Mesh>           m_Meshes;
+    std::vector<Material>       m_Materials;
+    std::vector<CpuInstance>    m_Instances;
+    std::vector<std::string>    m_Textures;
+    std::string                 m_IBL;
+    bool                        m_PlacedFootprint = false;
+    uint64_t                    m_BlobSize        = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MeshInfo structure
+///////////////////////////////////////////////////////////////////////////////
+struct MeshInfo
+{
+    std::string     MeshName;
+    std::string     MaterialName;
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      メッシュをロードします.
+//!
+//! @param[in]      path        ファイルパスです.
+//! @param[out]     result      メッシュの格納先です.
+//! @retval true    ロードに成功.
+//! @retval false   ロードに失敗.
+//-----------------------------------------------------------------------------
+bool LoadMesh(const char* path, std::vector<Mesh>& result, std::vector<MeshInfo>& infos);
+
+} // namespace offline
+} // namespace r3d
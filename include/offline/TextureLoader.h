@@ -0,0 +1,75 @@
+﻿//-----------------------------------------------------------------------------
+// File : TextureLoader.h
+// Desc : Portable Texture Loader for Offline Tools.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <vector>
+#include <TextureFootprint.h>
+
+
+namespace r3d {
+namespace offline {
+
+///////////////////////////////////////////////////////////////////////////////
+// TEXTURE_DIMENSION enum
+///////////////////////////////////////////////////////////////////////////////
+enum TEXTURE_DIMENSION
+{
+    TEXTURE_DIMENSION_UNKNOWN,
+    TEXTURE_DIMENSION_1D,
+    TEXTURE_DIMENSION_2D,
+    TEXTURE_DIMENSION_3D,
+    TEXTURE_DIMENSION_CUBE
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SurfaceData structure
+///////////////////////////////////////////////////////////////////////////////
+struct SurfaceData
+{
+    uint32_t                Width       = 0;    //!< 横幅.
+    uint32_t                Height      = 0;    //!< 縦幅.
+    uint32_t                MipIndex    = 0;    //!< ミップレベル.
+    uint32_t                Pitch       = 0;    //!< 1行あたりのバイト数.
+    uint32_t                SlicePitch  = 0;    //!< 1スライスあたりのバイト数.
+    std::vector<uint8_t>    Pixels;             //!< ピクセルデータ.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureData structure
+///////////////////////////////////////////////////////////////////////////////
+struct TextureData
+{
+    uint32_t                    Dimension       = TEXTURE_DIMENSION_UNKNOWN;
+    uint32_t                    Width           = 0;
+    uint32_t                    Height          = 0;
+    uint32_t                    Depth           = 0;
+    uint32_t                    Format          = 0;    //!< DXGI_FORMAT の値.
+    uint32_t                    MipMapCount     = 0;
+    uint32_t                    SurfaceCount    = 0;
+    std::vector<SurfaceData>    Resources;              //!< D3D12 のサブリソース順に格納.
+
+    //-------------------------------------------------------------------------
+    //! @brief      ファイルからロードします.
+    //!
+    //! @note       現在は DDS 形式のみサポートしています.
+    //! @param[in]      path        ファイルパス.
+    //! @retval true    ロードに成功.
+    //! @retval false   ロードに失敗.
+    //-------------------------------------------------------------------------
+    bool LoadFromFile(const char* path);
+
+    //-------------------------------------------------------------------------
+    //! @brief      メモリを解放します.
+    //-------------------------------------------------------------------------
+    void Dispose();
+};
+
+} // namespace offline
+} // namespace r3d
@@ -0,0 +1,249 @@
+﻿//-----------------------------------------------------------------------------
+// File : VectorMath.h
+// Desc : Portable Vector Math for Offline Tools.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cmath>
+#include <cstdint>
+
+
+namespace r3d {
+namespace offline {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static constexpr float F_PI = 3.1415926535897932384626433832795f;
+
+//-----------------------------------------------------------------------------
+//      度をラジアンに変換します.
+//-----------------------------------------------------------------------------
+inline float ToRadian(float degree)
+{ return degree * (F_PI / 180.0f); }
+
+//-----------------------------------------------------------------------------
+//      ラジアンを度に変換します.
+//-----------------------------------------------------------------------------
+inline float ToDegree(float radian)
+{ return radian * (180.0f / F_PI); }
+
+///////////////////////////////////////////////////////////////////////////////
+// Vector2 structure
+///////////////////////////////////////////////////////////////////////////////
+struct Vector2
+{
+    float x = 0.0f;
+    float y = 0.0f;
+
+    Vector2() = default;
+    Vector2(float nx, float ny)
+    : x(nx), y(ny)
+    { /* DO_NOTHING */ }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Vector3 structure
+///////////////////////////////////////////////////////////////////////////////
+struct Vector3
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+
+    Vector3() = default;
+    Vector3(float nx, float ny, float nz)
+    : x(nx), y(ny), z(nz)
+    { /* DO_NOTHING */ }
+
+    Vector3 operator + (const Vector3& value) const
+    { return Vector3(x + value.x, y + value.y, z + value.z); }
+
+    Vector3 operator - (const Vector3& value) const
+    { return Vector3(x - value.x, y - value.y, z - value.z); }
+
+    Vector3 operator * (float scalar) const
+    { return Vector3(x * scalar, y * scalar, z * scalar); }
+
+    Vector3& operator += (const Vector3& value)
+    {
+        x += value.x;
+        y += value.y;
+        z += value.z;
+        return *this;
+    }
+
+    float Length() const
+    { return sqrtf(x * x + y * y + z * z); }
+
+    static float Dot(const Vector3& a, const Vector3& b)
+    { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+    static Vector3 Cross(const Vector3& a, const Vector3& b)
+    {
+        return Vector3(
+            (a.y * b.z) - (a.z * b.y),
+            (a.z * b.x) - (a.x * b.z),
+            (a.x * b.y) - (a.y * b.x));
+    }
+
+    //-------------------------------------------------------------------------
+    //! @brief      正規化します. ゼロベクトルの場合は set を返却します.
+    //-------------------------------------------------------------------------
+    static Vector3 SafeNormalize(const Vector3& value, const Vector3& set)
+    {
+        auto mag = value.Length();
+        if (mag > 0.0f)
+        { return value * (1.0f / mag); }
+
+        return set;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Vector4 structure
+///////////////////////////////////////////////////////////////////////////////
+struct Vector4
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float w = 0.0f;
+
+    Vector4() = default;
+    Vector4(float nx, float ny, float nz, float nw)
+    : x(nx), y(ny), z(nz), w(nw)
+    { /* DO_NOTHING */ }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Matrix structure (行ベクトル形式, asdx::Matrix と同じ規約)
+///////////////////////////////////////////////////////////////////////////////
+struct Matrix
+{
+    float m[4][4] = {
+        { 1.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 1.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+        { 0.0f, 0.0f, 0.0f, 1.0f },
+    };
+
+    Matrix operator * (const Matrix& value) const
+    {
+        Matrix result;
+        for(auto r=0; r<4; ++r)
+        {
+            for(auto c=0; c<4; ++c)
+            {
+                result.m[r][c] = m[r][0] * value.m[0][c]
+                               + m[r][1] * value.m[1][c]
+                               + m[r][2] * value.m[2][c]
+                               + m[r][3] * value.m[3][c];
+            }
+        }
+        return result;
+    }
+
+    static Matrix CreateScale(const Vector3& scale)
+    {
+        Matrix result;
+        result.m[0][0] = scale.x;
+        result.m[1][1] = scale.y;
+        result.m[2][2] = scale.z;
+        return result;
+    }
+
+    static Matrix CreateTranslation(const Vector3& value)
+    {
+        Matrix result;
+        result.m[3][0] = value.x;
+        result.m[3][1] = value.y;
+        result.m[3][2] = value.z;
+        return result;
+    }
+
+    static Matrix CreateRotationX(float radian)
+    {
+        auto c = cosf(radian);
+        auto s = sinf(radian);
+
+        Matrix result;
+        result.m[1][1] =  c;
+        result.m[1][2] =  s;
+        result.m[2][1] = -s;
+        result.m[2][2] =  c;
+        return result;
+    }
+
+    static Matrix CreateRotationY(float radian)
+    {
+        auto c = cosf(radian);
+        auto s = sinf(radian);
+
+        Matrix result;
+        result.m[0][0] =  c;
+        result.m[0][2] = -s;
+        result.m[2][0] =  s;
+        result.m[2][2] =  c;
+        return result;
+    }
+
+    static Matrix CreateRotationZ(float radian)
+    {
+        auto c = cosf(radian);
+        auto s = sinf(radian);
+
+        Matrix result;
+        result.m[0][0] =  c;
+        result.m[0][1] =  s;
+        result.m[1][0] = -s;
+        result.m[1][1] =  c;
+        return result;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Transform3x4 structure
+///////////////////////////////////////////////////////////////////////////////
+struct Transform3x4
+{
+    float m[3][4] = {
+        { 1.0f, 0.0f, 0.0f, 0.0f },
+        { 0.0f, 1.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f, 0.0f },
+    };
+};
+
+//-----------------------------------------------------------------------------
+//      4x4行列から3x4変換行列に変換します (転置して平行移動を4列目に格納).
+//-----------------------------------------------------------------------------
+inline Transform3x4 FromMatrix(const Matrix& value)
+{
+    Transform3x4 result;
+    for(auto r=0; r<3; ++r)
+    {
+        for(auto c=0; c<4; ++c)
+        { result.m[r][c] = value.m[c][r]; }
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      正規直交基底を計算します.
+//-----------------------------------------------------------------------------
+inline void CalcONB(const Vector3& N, Vector3& T, Vector3& B)
+{
+    // [Duff 2017] "Building an Orthonormal Basis, Revisited", JCGT Vol.6, No.1.
+    auto s = copysignf(1.0f, N.z);
+    auto a = -1.0f / (s + N.z);
+    auto b = N.x * N.y * a;
+    T = Vector3(1.0f + s * N.x * N.x * a, s * b, -s * N.x);
+    B = Vector3(b, s + N.y * N.y * a, -N.y);
+}
+
+} // namespace offline
+} // namespace r3d
@@ -0,0 +1,32 @@
+﻿//-----------------------------------------------------------------------------
+// File : ResolveRadianceCS.hlsl
+// Desc : Compute Shader For Resolving Accumulated Radiance.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <SceneParam.hlsli>
+
+//-----------------------------------------------------------------------------
+// Resources
+//-----------------------------------------------------------------------------
+ConstantBuffer<SceneParameter>  SceneParam   : register(b0);
+Texture2D                       ColorBuffer  : register(t0);
+RWTexture2D<float4>             OutputBuffer : register(u0);
+
+//-----------------------------------------------------------------------------
+//      エントリーポイントです.
+//-----------------------------------------------------------------------------
+[numthreads(8, 8, 1)]
+void main(uint3 dispatchId : SV_DispatchThreadID)
+{
+    if (any(dispatchId.xy >= (uint2)SceneParam.Size.xy)) {
+        return;
+    }
+
+    // 蓄積した放射輝度をサンプル数で割って線形のまま出力する (露出・トーンマップは掛けない).
+    float4 color = ColorBuffer.Load(int3(dispatchId.xy, 0));
+    OutputBuffer[dispatchId.xy] = float4(color.rgb / SceneParam.AccumulatedFrames, 1.0f);
+}
@@ -0,0 +1,987 @@
+﻿//-----------------------------------------------------------------------------
+// File : AsyncFileWriter.cpp
+// Desc : Asynchronous File Writer.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <AsyncFileWriter.h>
+#include <Platform.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+#if defined(__linux__)
+#define WRITER_ENABLE_IO_URING  (1)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define WRITER_ENABLE_IO_URING  (0)
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t DEFAULT_QUEUE_DEPTH       = 16;
+static const uint32_t DEFAULT_THREAD_COUNT      = 2;
+static const uint32_t DEFAULT_CHUNK_SIZE        = 1024 * 1024;
+static const uint64_t DEFAULT_MAX_PENDING_BYTES = 256ull * 1024 * 1024;
+static const uint32_t DIRECT_IO_ALIGNMENT       = 4096;
+
+//-----------------------------------------------------------------------------
+//      経過時間を秒で取得します.
+//-----------------------------------------------------------------------------
+inline double GetElapsedSec(const std::chrono::steady_clock::time_point& begin)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+//-----------------------------------------------------------------------------
+//      アライメントに切り上げます.
+//-----------------------------------------------------------------------------
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{ return (value + alignment - 1) & ~(alignment - 1); }
+
+//-----------------------------------------------------------------------------
+//      アライメントに切り下げます.
+//-----------------------------------------------------------------------------
+inline uint64_t AlignDown(uint64_t value, uint64_t alignment)
+{ return value & ~(alignment - 1); }
+
+//-----------------------------------------------------------------------------
+//      部分書き込みの後に書き込みを再開する位置を求めます.
+//-----------------------------------------------------------------------------
+inline size_t GetResumeOffset(size_t written, size_t size, bool direct)
+{
+    // O_DIRECT はオフセットもアライメントが必要なので, 端数は書き直す.
+    if (direct && written < size)
+    { return size_t(AlignDown(written, DIRECT_IO_ALIGNMENT)); }
+
+    return written;
+}
+
+//-----------------------------------------------------------------------------
+//      O_DIRECT 用にアライメントしたメモリを確保します.
+//-----------------------------------------------------------------------------
+void* AllocAligned(size_t size)
+{
+#if defined(_WIN32)
+    return _aligned_malloc(size, DIRECT_IO_ALIGNMENT);
+#else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, DIRECT_IO_ALIGNMENT, size) != 0)
+    { return nullptr; }
+    return ptr;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      アライメントしたメモリを解放します.
+//-----------------------------------------------------------------------------
+void FreeAligned(void* ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+#if WRITER_ENABLE_IO_URING
+//-----------------------------------------------------------------------------
+//      io_uring_setup システムコールを呼び出します.
+//-----------------------------------------------------------------------------
+inline int IoUringSetup(unsigned entries, io_uring_params* pParams)
+{ return int(syscall(__NR_io_uring_setup, entries, pParams)); }
+
+//-----------------------------------------------------------------------------
+//      io_uring_enter システムコールを呼び出します.
+//-----------------------------------------------------------------------------
+inline int IoUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{ return int(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0)); }
+#endif
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncFileWriter::Op structure
+///////////////////////////////////////////////////////////////////////////////
+struct AsyncFileWriter::Op
+{
+    uint32_t    Handle  = INVALID_HANDLE;
+    Chunk*      pChunk  = nullptr;      //!< nullptr の場合はファイルを閉じる.
+    uint64_t    Offset  = 0;            //!< 書き込み位置.
+    size_t      Written = 0;            //!< 書き込み済みのバイト数 (io_uring の部分書き込み用).
+    std::chrono::steady_clock::time_point SubmitTime;
+#if WRITER_ENABLE_IO_URING
+    iovec       Iov     = {};
+    bool        Direct  = false;        //!< O_DIRECT で開いたファイルへの書き込み.
+#endif
+};
+
+#if WRITER_ENABLE_IO_URING
+///////////////////////////////////////////////////////////////////////////////
+// AsyncFileWriter::Ring structure
+///////////////////////////////////////////////////////////////////////////////
+struct AsyncFileWriter::Ring
+{
+    int             Fd          = -1;
+    void*           pSqRing     = nullptr;
+    void*           pCqRing     = nullptr;
+    io_uring_sqe*   pSqes       = nullptr;
+    size_t          SqRingSize  = 0;
+    size_t          CqRingSize  = 0;
+    size_t          SqesSize    = 0;
+    unsigned*       pSqTail     = nullptr;
+    unsigned*       pSqMask     = nullptr;
+    unsigned*       pSqArray    = nullptr;
+    unsigned*       pCqHead     = nullptr;
+    unsigned*       pCqTail     = nullptr;
+    unsigned*       pCqMask     = nullptr;
+    io_uring_cqe*   pCqes       = nullptr;
+    unsigned        Entries     = 0;
+
+    //-------------------------------------------------------------------------
+    //      初期化処理を行います.
+    //-------------------------------------------------------------------------
+    bool Init(uint32_t depth)
+    {
+        io_uring_params params = {};
+        Fd = IoUringSetup(depth, &params);
+        if (Fd < 0)
+        { return false; }
+
+        SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        CqRingSize = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+
+        auto singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap)
+        {
+            SqRingSize = std::max(SqRingSize, CqRingSize);
+            CqRingSize = SqRingSize;
+        }
+
+        auto ptr = mmap(nullptr, SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQ_RING);
+        if (ptr == MAP_FAILED)
+        {
+            Term();
+            return false;
+        }
+        pSqRing = ptr;
+
+        if (singleMap)
+        { pCqRing = pSqRing; }
+        else
+        {
+            ptr = mmap(nullptr, CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_CQ_RING);
+            if (ptr == MAP_FAILED)
+            {
+                Term();
+                return false;
+            }
+            pCqRing = ptr;
+        }
+
+        SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        ptr = mmap(nullptr, SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQES);
+        if (ptr == MAP_FAILED)
+        {
+            Term();
+            return false;
+        }
+        pSqes = static_cast<io_uring_sqe*>(ptr);
+
+        auto pSq = static_cast<uint8_t*>(pSqRing);
+        pSqTail  = reinterpret_cast<unsigned*>(pSq + params.sq_off.tail);
+        pSqMask  = reinterpret_cast<unsigned*>(pSq + params.sq_off.ring_mask);
+        pSqArray = reinterpret_cast<unsigned*>(pSq + params.sq_off.array);
+
+        auto pCq = static_cast<uint8_t*>(pCqRing);
+        pCqHead  = reinterpret_cast<unsigned*>(pCq + params.cq_off.head);
+        pCqTail  = reinterpret_cast<unsigned*>(pCq + params.cq_off.tail);
+        pCqMask  = reinterpret_cast<unsigned*>(pCq + params.cq_off.ring_mask);
+        pCqes    = reinterpret_cast<io_uring_cqe*>(pCq + params.cq_off.cqes);
+
+        Entries = params.sq_entries;
+        return true;
+    }
+
+    //-------------------------------------------------------------------------
+    //      終了処理を行います.
+    //-------------------------------------------------------------------------
+    void Term()
+    {
+        if (pSqes != nullptr)
+        { munmap(pSqes, SqesSize); }
+        if (pCqRing != nullptr && pCqRing != pSqRing)
+        { munmap(pCqRing, CqRingSize); }
+        if (pSqRing != nullptr)
+        { munmap(pSqRing, SqRingSize); }
+        if (Fd >= 0)
+        { close(Fd); }
+
+        Fd      = -1;
+        pSqRing = nullptr;
+        pCqRing = nullptr;
+        pSqes   = nullptr;
+    }
+
+    //-------------------------------------------------------------------------
+    //      書き込みを投入します.
+    //-------------------------------------------------------------------------
+    void PushWrite(int fd, Op* pOp)
+    {
+        pOp->Iov.iov_base = pOp->pChunk->pData + pOp->Written;
+        pOp->Iov.iov_len  = pOp->pChunk->Size  - pOp->Written;
+
+        // 投入するのは I/O スレッドだけなので, 末尾は自分で書いた値をそのまま読める.
+        auto tail  = *pSqTail;
+        auto index = tail & *pSqMask;
+
+        auto& sqe = pSqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode    = IORING_OP_WRITEV;
+        sqe.fd        = fd;
+        sqe.addr      = reinterpret_cast<uint64_t>(&pOp->Iov);
+        sqe.len       = 1;
+        sqe.off       = pOp->Offset + pOp->Written;
+        sqe.user_data = reinterpret_cast<uint64_t>(pOp);
+
+        pSqArray[index] = index;
+        __atomic_store_n(pSqTail, tail + 1, __ATOMIC_RELEASE);
+    }
+};
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// AsyncFileWriter class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+AsyncFileWriter::~AsyncFileWriter()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool AsyncFileWriter::Init(const AsyncFileWriterDesc& desc)
+{
+    Term();
+
+    m_QueueDepth      = (desc.QueueDepth > 0) ? desc.QueueDepth : DEFAULT_QUEUE_DEPTH;
+    m_ChunkSize       = uint32_t(AlignUp((desc.ChunkSize > 0) ? desc.ChunkSize : DEFAULT_CHUNK_SIZE, DIRECT_IO_ALIGNMENT));
+    m_MaxPendingBytes = (desc.MaxPendingBytes > 0) ? desc.MaxPendingBytes : DEFAULT_MAX_PENDING_BYTES;
+    m_PendingBytes    = 0;
+    m_PendingOps      = 0;
+    m_DirectIO        = false;
+    m_FlushFailed     = false;
+    m_Quit            = false;
+    m_Stats           = {};
+
+#if WRITER_ENABLE_IO_URING
+    auto pRing = new Ring();
+    if (pRing->Init(m_QueueDepth))
+    {
+        m_pRing            = pRing;
+        m_QueueDepth       = std::min(m_QueueDepth, pRing->Entries);
+        m_DirectIO         = desc.DirectIO;
+        m_Stats.UseIoUring = true;
+
+        m_Queues.resize(1);
+        m_Threads.emplace_back(&AsyncFileWriter::RunIoUring, this);
+        return true;
+    }
+
+    delete pRing;
+    ILOGA("Info : io_uring is not available, fallback to writer threads.");
+#endif
+
+    auto threadCount = (desc.ThreadCount > 0) ? desc.ThreadCount : DEFAULT_THREAD_COUNT;
+    m_Queues.resize(threadCount);
+    for(auto i=0u; i<threadCount; ++i)
+    { m_Threads.emplace_back(&AsyncFileWriter::RunThread, this, i); }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void AsyncFileWriter::Term()
+{
+    if (m_Threads.empty())
+    { return; }
+
+    // 閉じ忘れたファイルも書き出してから終了する.
+    std::vector<uint32_t> handles;
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        for(size_t i=0; i<m_Files.size(); ++i)
+        {
+            if (m_Files[i].InUse && !m_Files[i].Closing)
+            { handles.push_back(uint32_t(i)); }
+        }
+    }
+    for(auto handle : handles)
+    { Close(handle); }
+
+    Flush();
+
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        m_Quit = true;
+    }
+    m_OpCond.notify_all();
+
+    for(auto& thread : m_Threads)
+    { thread.join(); }
+    m_Threads.clear();
+
+#if WRITER_ENABLE_IO_URING
+    if (m_pRing != nullptr)
+    {
+        m_pRing->Term();
+        delete m_pRing;
+    }
+#endif
+    m_pRing = nullptr;
+
+    for(auto pChunk : m_Chunks)
+    {
+        FreeAligned(pChunk->pData);
+        delete pChunk;
+    }
+    m_Chunks    .clear();
+    m_FreeChunks.clear();
+    m_Files     .clear();
+    m_FreeFiles .clear();
+    m_Queues    .clear();
+}
+
+//-----------------------------------------------------------------------------
+//      書き込み用にファイルを開きます.
+//-----------------------------------------------------------------------------
+uint32_t AsyncFileWriter::Open(const char* path)
+{
+    if (path == nullptr || m_Threads.empty())
+    {
+        ELOGA("Error : Invalid Argument.");
+        return INVALID_HANDLE;
+    }
+
+    File file;
+    file.Path  = path;
+    file.InUse = true;
+
+#if WRITER_ENABLE_IO_URING
+    if (m_pRing != nullptr)
+    {
+        auto flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+        // O_DIRECT に対応していないファイルシステムでは通常のファイルとして開く.
+        if (m_DirectIO)
+        {
+            file.Fd     = open(path, flags | O_DIRECT, 0644);
+            file.Direct = (file.Fd >= 0);
+        }
+        if (file.Fd < 0)
+        { file.Fd = open(path, flags, 0644); }
+
+        if (file.Fd < 0)
+        {
+            ELOGA("Error : File Open Failed. path = %s", path);
+            return INVALID_HANDLE;
+        }
+    }
+    else
+#endif
+    {
+        file.pFile = OpenFile(path, "wb");
+        if (file.pFile == nullptr)
+        {
+            ELOGA("Error : File Open Failed. path = %s", path);
+            return INVALID_HANDLE;
+        }
+    }
+
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    uint32_t handle;
+    if (!m_FreeFiles.empty())
+    {
+        handle = m_FreeFiles.back();
+        m_FreeFiles.pop_back();
+        m_Files[handle] = std::move(file);
+    }
+    else
+    {
+        handle = uint32_t(m_Files.size());
+        m_Files.push_back(std::move(file));
+    }
+
+    return handle;
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルの末尾にデータを追加します.
+//-----------------------------------------------------------------------------
+bool AsyncFileWriter::Append(uint32_t handle, const void* pData, size_t size)
+{
+    auto pSrc = static_cast<const uint8_t*>(pData);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    if (!IsValidHandle(handle))
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    while (size > 0)
+    {
+        if (m_Files[handle].Failed)
+        { return false; }
+
+        auto pChunk = m_Files[handle].pChunk;
+        if (pChunk == nullptr)
+        {
+            pChunk = AllocChunk();
+            if (pChunk == nullptr)
+            {
+                ELOGA("Error : Out of Memory.");
+                m_Files[handle].Failed = true;
+                return false;
+            }
+            m_Files[handle].pChunk = pChunk;
+        }
+
+        // チャンクはこのハンドルを持つスレッドだけが触るので, コピー中はロックを外す.
+        auto count = std::min(size, size_t(m_ChunkSize) - pChunk->Size);
+        lock.unlock();
+        memcpy(pChunk->pData + pChunk->Size, pSrc, count);
+        lock.lock();
+
+        pChunk->Size           += count;
+        m_Files[handle].Size   += count;
+        pSrc += count;
+        size -= count;
+
+        if (pChunk->Size == m_ChunkSize)
+        {
+            m_Files[handle].pChunk = nullptr;
+            Submit(lock, handle, pChunk);
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルを閉じます.
+//-----------------------------------------------------------------------------
+void AsyncFileWriter::Close(uint32_t handle, std::function<void(bool)> callback)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    if (!IsValidHandle(handle))
+    {
+        ELOGA("Error : Invalid Argument.");
+        return;
+    }
+
+    // 以降の Append() を弾く.
+    m_Files[handle].Closing = true;
+
+    auto pChunk = m_Files[handle].pChunk;
+    m_Files[handle].pChunk = nullptr;
+    if (pChunk != nullptr && pChunk->Size > 0)
+    {
+        // O_DIRECT はサイズもアライメントが必要なので, 0 で埋めて書き込み閉じる時に切り詰める.
+        if (m_Files[handle].Direct)
+        {
+            auto size = size_t(AlignUp(pChunk->Size, DIRECT_IO_ALIGNMENT));
+            memset(pChunk->pData + pChunk->Size, 0, size - pChunk->Size);
+            pChunk->Size = size;
+        }
+        Submit(lock, handle, pChunk);
+    }
+    else if (pChunk != nullptr)
+    { m_FreeChunks.push_back(pChunk); }
+
+    auto pOp = new Op();
+    pOp->Handle     = handle;
+    pOp->SubmitTime = std::chrono::steady_clock::now();
+
+    m_Files[handle].Callback = std::move(callback);
+    m_PendingOps++;
+
+    auto queueIndex = (m_pRing != nullptr) ? 0 : handle % uint32_t(m_Queues.size());
+    m_Queues[queueIndex].push_back(pOp);
+    m_OpCond.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルを書き出します.
+//-----------------------------------------------------------------------------
+bool AsyncFileWriter::WriteFile
+(
+    const char*                 path,
+    const void*                 pData,
+    size_t                      size,
+    std::function<void(bool)>   callback
+)
+{
+    auto handle = Open(path);
+    if (handle == INVALID_HANDLE)
+    { return false; }
+
+    // 失敗した場合も Close() でハンドルを解放し, 結果はコールバックで受け取る.
+    Append(handle, pData, size);
+    Close(handle, std::move(callback));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      閉じたファイルの書き込みが全て完了するまで待ちます.
+//-----------------------------------------------------------------------------
+bool AsyncFileWriter::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_DoneCond.wait(lock, [&]() { return m_PendingOps == 0; });
+
+    auto result = !m_FlushFailed;
+    m_FlushFailed = false;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      統計情報を取得します.
+//-----------------------------------------------------------------------------
+AsyncFileWriterStats AsyncFileWriter::GetStats() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return m_Stats;
+}
+
+//-----------------------------------------------------------------------------
+//      チャンクを確保します (m_Mutex をロックして呼び出す).
+//-----------------------------------------------------------------------------
+AsyncFileWriter::Chunk* AsyncFileWriter::AllocChunk()
+{
+    if (!m_FreeChunks.empty())
+    {
+        auto pChunk = m_FreeChunks.back();
+        m_FreeChunks.pop_back();
+        pChunk->Size = 0;
+        return pChunk;
+    }
+
+    auto pData = static_cast<uint8_t*>(AllocAligned(m_ChunkSize));
+    if (pData == nullptr)
+    { return nullptr; }
+
+    auto pChunk = new Chunk();
+    pChunk->pData = pData;
+    m_Chunks.push_back(pChunk);
+    return pChunk;
+}
+
+//-----------------------------------------------------------------------------
+//      追加中のハンドルかどうかチェックします (m_Mutex をロックして呼び出す).
+//-----------------------------------------------------------------------------
+bool AsyncFileWriter::IsValidHandle(uint32_t handle) const
+{
+    return handle < m_Files.size()
+        && m_Files[handle].InUse
+        && !m_Files[handle].Closing;
+}
+
+//-----------------------------------------------------------------------------
+//      チャンクの書き込みを発行します (m_Mutex をロックして呼び出す).
+//-----------------------------------------------------------------------------
+void AsyncFileWriter::Submit
+(
+    std::unique_lock<std::mutex>&   lock,
+    uint32_t                        handle,
+    Chunk*                          pChunk
+)
+{
+    // 書き込みが追いつかない場合は, 未完了のバイト数が上限を下回るまで待つ.
+    // 何も書き込んでいない場合は上限より大きくても発行する.
+    auto size = uint64_t(pChunk->Size);
+    if (m_PendingBytes > 0 && m_PendingBytes + size > m_MaxPendingBytes)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        m_DoneCond.wait(lock, [&]()
+        { return m_PendingBytes == 0 || m_PendingBytes + size <= m_MaxPendingBytes; });
+
+        m_Stats.StallCount++;
+        m_Stats.StallSec += GetElapsedSec(begin);
+    }
+
+    auto& file = m_Files[handle];
+
+    auto pOp = new Op();
+    pOp->Handle     = handle;
+    pOp->pChunk     = pChunk;
+    pOp->Offset     = file.Offset;
+    pOp->SubmitTime = std::chrono::steady_clock::now();
+
+    file.Offset += size;
+    file.Inflight++;
+
+    m_PendingBytes += size;
+    m_PendingOps++;
+    m_Stats.QueueDepth++;
+    m_Stats.MaxQueueDepth = std::max(m_Stats.MaxQueueDepth, m_Stats.QueueDepth);
+
+    auto queueIndex = (m_pRing != nullptr) ? 0 : handle % uint32_t(m_Queues.size());
+    m_Queues[queueIndex].push_back(pOp);
+    m_OpCond.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+//      チャンクの書き込みの完了を処理します.
+//-----------------------------------------------------------------------------
+void AsyncFileWriter::CompleteWrite(Op* pOp, bool success, bool reuseChunk)
+{
+    auto handle = pOp->Handle;
+    auto ready  = false;
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        auto latency = GetElapsedSec(pOp->SubmitTime);
+        auto size    = uint64_t(pOp->pChunk->Size);
+
+        m_Stats.WriteCount++;
+        m_Stats.QueueDepth--;
+        m_Stats.LatencySec    += latency;
+        m_Stats.MaxLatencySec  = std::max(m_Stats.MaxLatencySec, latency);
+        if (success)
+        { m_Stats.WriteBytes += pOp->Written; }
+
+        m_PendingBytes -= size;
+        m_PendingOps--;
+
+        auto& file = m_Files[handle];
+        file.Inflight--;
+        if (!success)
+        { file.Failed = true; }
+        ready = (file.pCloseOp != nullptr && file.Inflight == 0);
+
+        // カーネルがまだ読んでいるかもしれないチャンクは再利用しない (Term() で解放).
+        if (reuseChunk)
+        {
+            pOp->pChunk->Size = 0;
+            m_FreeChunks.push_back(pOp->pChunk);
+        }
+    }
+    m_DoneCond.notify_all();
+    delete pOp;
+
+    if (ready)
+    { CloseFile(handle); }
+}
+
+//-----------------------------------------------------------------------------
+//      書き込み待ちのファイルを閉じる処理を受け付けます.
+//-----------------------------------------------------------------------------
+void AsyncFileWriter::RequestClose(Op* pOp)
+{
+    auto ready = false;
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        m_Files[pOp->Handle].pCloseOp = pOp;
+        ready = (m_Files[pOp->Handle].Inflight == 0);
+    }
+
+    // 書き込みが残っている場合は, 最後の書き込みの完了時に閉じる.
+    if (ready)
+    { CloseFile(pOp->Handle); }
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルを閉じてハンドルを解放します.
+//-----------------------------------------------------------------------------
+void AsyncFileWriter::CloseFile(uint32_t handle)
+{
+    File file;
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        file = std::move(m_Files[handle]);
+        m_Files[handle] = File();
+        m_Files[handle].InUse   = true;     // コールバックが終わるまで再利用させない.
+        m_Files[handle].Closing = true;
+    }
+
+    auto success = !file.Failed;
+    if (file.pFile != nullptr && fclose(file.pFile) != 0)
+    { success = false; }
+
+#if WRITER_ENABLE_IO_URING
+    if (file.Fd >= 0)
+    {
+        // O_DIRECT で埋めた分を切り詰める.
+        if (file.Direct && ftruncate(file.Fd, off_t(file.Size)) != 0)
+        { success = false; }
+        if (close(file.Fd) != 0)
+        { success = false; }
+    }
+#endif
+
+    if (!success)
+    { ELOGA("Error : File Write Failed. path = %s", file.Path.c_str()); }
+
+    if (file.Callback)
+    { file.Callback(success); }
+
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        m_Stats.FileCount++;
+        if (!success)
+        {
+            m_Stats.FailCount++;
+            m_FlushFailed = true;
+        }
+
+        m_Files[handle].InUse = false;
+        m_FreeFiles.push_back(handle);
+        m_PendingOps--;
+    }
+    m_DoneCond.notify_all();
+    delete file.pCloseOp;
+}
+
+//-----------------------------------------------------------------------------
+//      書き込みスレッドの処理です.
+//-----------------------------------------------------------------------------
+void AsyncFileWriter::RunThread(uint32_t index)
+{
+    // 同じハンドルは同じスレッドに割り当てるので, 書き込みと閉じる処理は発行順に処理される.
+    for(;;)
+    {
+        Op*   pOp    = nullptr;
+        FILE* pFile  = nullptr;
+        bool  failed = false;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_OpCond.wait(lock, [&]() { return m_Quit || !m_Queues[index].empty(); });
+            if (m_Queues[index].empty())
+            { break; }
+
+            pOp = m_Queues[index].front();
+            m_Queues[index].pop_front();
+
+            pFile  = m_Files[pOp->Handle].pFile;
+            failed = m_Files[pOp->Handle].Failed;
+        }
+
+        if (pOp->pChunk == nullptr)
+        {
+            RequestClose(pOp);
+            continue;
+        }
+
+        auto success = !failed && fwrite(pOp->pChunk->pData, pOp->pChunk->Size, 1, pFile) == 1;
+        if (success)
+        { pOp->Written = pOp->pChunk->Size; }
+        CompleteWrite(pOp, success);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      io_uring の I/O スレッドの処理です.
+//-----------------------------------------------------------------------------
+void AsyncFileWriter::RunIoUring()
+{
+#if WRITER_ENABLE_IO_URING
+    auto& ring = *m_pRing;
+
+    std::deque<Op*>  pending;       // キューから取り出して SQE に積む前の処理.
+    std::vector<Op*> inflight;      // SQE に積んで CQE を受け取っていない書き込み.
+    uint32_t unsubmitted = 0;       // SQE に積んでカーネルに渡していない書き込み数.
+    bool     aborted     = false;   // io_uring が使えなくなり, 同期書き込みに切り替えた.
+
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            if (inflight.empty() && pending.empty())
+            { m_OpCond.wait(lock, [&]() { return m_Quit || !m_Queues[0].empty(); }); }
+
+            auto& queue = m_Queues[0];
+            pending.insert(pending.end(), queue.begin(), queue.end());
+            queue.clear();
+
+            if (m_Quit && pending.empty() && inflight.empty())
+            { break; }
+        }
+
+        // キューの深さまで SQE に積む. 閉じる処理は書き込みの完了を待つだけなので SQE は使わない.
+        while (!pending.empty())
+        {
+            auto pOp = pending.front();
+            if (pOp->pChunk == nullptr)
+            {
+                pending.pop_front();
+                RequestClose(pOp);
+                continue;
+            }
+
+            if (inflight.size() >= m_QueueDepth)
+            { break; }
+            pending.pop_front();
+
+            int  fd     = -1;
+            bool failed = false;
+            {
+                std::lock_guard<std::mutex> locker(m_Mutex);
+                fd          = m_Files[pOp->Handle].Fd;
+                failed      = m_Files[pOp->Handle].Failed;
+                pOp->Direct = m_Files[pOp->Handle].Direct;
+            }
+
+            if (failed)
+            {
+                CompleteWrite(pOp, false);
+                continue;
+            }
+
+            if (aborted)
+            {
+                CompleteWrite(pOp, WriteSync(fd, pOp));
+                continue;
+            }
+
+            ring.PushWrite(fd, pOp);
+            inflight.push_back(pOp);
+            unsubmitted++;
+        }
+
+        if (inflight.empty())
+        { continue; }
+
+        // 発行と同時に少なくとも1つの完了を待つ.
+        auto ret = IoUringEnter(ring.Fd, unsubmitted, 1, IORING_ENTER_GETEVENTS);
+        if (ret >= 0)
+        { unsubmitted -= std::min(unsubmitted, uint32_t(ret)); }
+        else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            // 再試行しても回復しないので, 以降はこのスレッドで同期的に書き込む.
+            // 投入済みの書き込みは完了が分からないので失敗とし, チャンクも再利用しない.
+            ELOGA("Error : io_uring_enter() Failed. errno = %d, fallback to pwrite().", errno);
+            for(auto pOp : inflight)
+            { CompleteWrite(pOp, false, false); }
+
+            inflight.clear();
+            unsubmitted = 0;
+            aborted     = true;
+
+            std::lock_guard<std::mutex> locker(m_Mutex);
+            m_Stats.UseIoUring = false;
+            continue;
+        }
+
+        auto head = *ring.pCqHead;
+        auto tail = __atomic_load_n(ring.pCqTail, __ATOMIC_ACQUIRE);
+        while (head != tail)
+        {
+            auto& cqe = ring.pCqes[head & *ring.pCqMask];
+            auto pOp  = reinterpret_cast<Op*>(cqe.user_data);
+            auto res  = cqe.res;
+            head++;
+
+            auto itr = std::find(inflight.begin(), inflight.end(), pOp);
+            *itr = inflight.back();
+            inflight.pop_back();
+
+            if (res > 0)
+            {
+                auto size    = pOp->pChunk->Size;
+                auto written = GetResumeOffset(pOp->Written + size_t(res), size, pOp->Direct);
+
+                // 部分書き込みの場合は残りを発行し直す.
+                if (written < size)
+                {
+                    if (written > pOp->Written)
+                    {
+                        pOp->Written = written;
+                        pending.push_front(pOp);
+                        continue;
+                    }
+
+                    ELOGA("Error : Write Failed. Short write on O_DIRECT file. written = %d", res);
+                    CompleteWrite(pOp, false);
+                    continue;
+                }
+
+                pOp->Written = written;
+                CompleteWrite(pOp, true);
+            }
+            else
+            {
+                if (res < 0)
+                { ELOGA("Error : Write Failed. errno = %d", -res); }
+                CompleteWrite(pOp, false);
+            }
+        }
+        __atomic_store_n(ring.pCqHead, head, __ATOMIC_RELEASE);
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      io_uring を使わずに書き込みます.
+//-----------------------------------------------------------------------------
+bool AsyncFileWriter::WriteSync(int fd, Op* pOp)
+{
+#if WRITER_ENABLE_IO_URING
+    auto size = pOp->pChunk->Size;
+    while (pOp->Written < size)
+    {
+        auto ret = pwrite(fd, pOp->pChunk->pData + pOp->Written, size - pOp->Written, off_t(pOp->Offset + pOp->Written));
+        if (ret < 0 && errno == EINTR)
+        { continue; }
+
+        if (ret <= 0)
+        {
+            ELOGA("Error : Write Failed. errno = %d", (ret < 0) ? errno : 0);
+            return false;
+        }
+
+        auto written = GetResumeOffset(pOp->Written + size_t(ret), size, pOp->Direct);
+        if (written <= pOp->Written)
+        {
+            ELOGA("Error : Write Failed. Short write on O_DIRECT file. written = %d", int(ret));
+            return false;
+        }
+
+        pOp->Written = written;
+    }
+
+    return true;
+#else
+    (void)fd;
+    (void)pOp;
+    return false;
+#endif
+}
+
+} // namespace r3d
@@ -0,0 +1,387 @@
+﻿//-----------------------------------------------------------------------------
+// File : BudgetScheduler.cpp
+// Desc : Convergence Driven Frame Time Scheduler.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <BudgetScheduler.h>
+#include <Platform.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const double   DEFAULT_MIN_SCALE     = 0.5;
+static const double   DEFAULT_MAX_SCALE     = 2.0;
+static const double   VARIANCE_FLOOR        = 1e-8;     // 真っ平らな画像でも難しさが 0 にならないようにする.
+static const double   CALIBRATION_RATE      = 0.25;     // 描画結果と事前パスの比の移動平均の係数.
+static const double   SAMPLE_SEC_RATE       = 0.1;      // 1回の描画時間の移動平均の係数.
+static const uint32_t BISECTION_COUNT       = 48;
+static const double   PI                    = 3.14159265358979323846;
+
+//-----------------------------------------------------------------------------
+//      RGBA8 の1行を輝度 (x 256) に変換します.
+//-----------------------------------------------------------------------------
+void ConvertLuma(const uint8_t* pRow, uint32_t width, int32_t* pResult)
+{
+    for(auto x=0u; x<width; ++x)
+    {
+        auto pixel = pRow + size_t(x) * 4;
+        pResult[x] = int32_t(pixel[0]) * 54 + int32_t(pixel[1]) * 183 + int32_t(pixel[2]) * 19;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      横方向の2次差分を計算します.
+//-----------------------------------------------------------------------------
+inline int32_t Laplacian(const int32_t* pRow, uint32_t x)
+{ return pRow[x - 1] - 2 * pRow[x] + pRow[x + 1]; }
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// BudgetScheduler class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool BudgetScheduler::Init(const BudgetSchedulerDesc& desc)
+{
+    auto minScale = (desc.MinScale > 0.0) ? desc.MinScale : DEFAULT_MIN_SCALE;
+    auto maxScale = (desc.MaxScale > 0.0) ? desc.MaxScale : DEFAULT_MAX_SCALE;
+    if (desc.FrameCount == 0 || minScale > 1.0 || maxScale < 1.0 || desc.MinFrameSec < 0.0)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    Term();
+
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    m_FrameCount  = desc.FrameCount;
+    m_MinScale    = minScale;
+    m_MaxScale    = maxScale;
+    m_MinFrameSec = desc.MinFrameSec;
+
+    m_Priors   .resize(desc.FrameCount, 0.0);
+    m_Measured .resize(desc.FrameCount, 0.0);
+    m_RenderSec.resize(desc.FrameCount, 0.0);
+    m_Done     .resize(desc.FrameCount, 0);
+    m_Difficulties.reserve(desc.FrameCount);
+    m_Pending     .reserve(desc.FrameCount);
+
+    m_Stats.Calibration = 1.0;
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void BudgetScheduler::Term()
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    m_Priors      .clear();
+    m_Measured    .clear();
+    m_RenderSec   .clear();
+    m_Done        .clear();
+    m_Difficulties.clear();
+    m_Pending     .clear();
+
+    m_FrameCount     = 0;
+    m_MinScale       = 0.0;
+    m_MaxScale       = 0.0;
+    m_MinFrameSec    = 0.0;
+    m_SampleSec      = 0.0;
+    m_LogCalibration = 0.0;
+    m_Stats          = {};
+}
+
+//-----------------------------------------------------------------------------
+//      事前パスで計測したノイズを設定します.
+//-----------------------------------------------------------------------------
+void BudgetScheduler::SetEstimate(uint32_t frameIndex, double noiseVariance, double renderSec)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (frameIndex >= m_FrameCount || renderSec <= 0.0)
+    { return; }
+
+    if (m_Priors[frameIndex] == 0.0)
+    { m_Stats.EstimateCount++; }
+
+    m_Priors[frameIndex] = std::max(noiseVariance, VARIANCE_FLOOR) * renderSec;
+}
+
+//-----------------------------------------------------------------------------
+//      フレームの描画が終わったことを設定します.
+//-----------------------------------------------------------------------------
+void BudgetScheduler::SetDone(uint32_t frameIndex, double renderSec)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (frameIndex >= m_FrameCount)
+    { return; }
+
+    m_Done     [frameIndex] = 1;
+    m_RenderSec[frameIndex] = std::max(renderSec, 0.0);
+}
+
+//-----------------------------------------------------------------------------
+//      描画が終わったフレームのノイズを報告します.
+//-----------------------------------------------------------------------------
+void BudgetScheduler::Report(uint32_t frameIndex, double noiseVariance)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (frameIndex >= m_FrameCount || m_RenderSec[frameIndex] <= 0.0)
+    { return; }
+
+    auto difficulty = std::max(noiseVariance, VARIANCE_FLOOR) * m_RenderSec[frameIndex];
+
+    // 描画結果は蓄積とデノイズを経ているので事前パスと尺度が違う. 比の移動平均で事前パスの尺度に揃える.
+    auto prior = Interpolate(frameIndex, true);
+    if (prior > 0.0)
+    {
+        auto logRatio = std::log(difficulty / prior);
+        if (m_Stats.ReportCount == 0)
+        { m_LogCalibration = logRatio; }
+        else
+        { m_LogCalibration += (logRatio - m_LogCalibration) * CALIBRATION_RATE; }
+
+        difficulty /= std::exp(m_LogCalibration);
+        m_Stats.Calibration = std::exp(m_LogCalibration);
+    }
+
+    m_Measured[frameIndex] = difficulty;
+    m_Stats.ReportCount++;
+}
+
+//-----------------------------------------------------------------------------
+//      1回の描画に掛かった時間を設定します.
+//-----------------------------------------------------------------------------
+void BudgetScheduler::SetSampleSec(double sampleSec)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (sampleSec <= 0.0)
+    { return; }
+
+    if (m_SampleSec == 0.0)
+    { m_SampleSec = sampleSec; }
+    else
+    { m_SampleSec += (sampleSec - m_SampleSec) * SAMPLE_SEC_RATE; }
+}
+
+//-----------------------------------------------------------------------------
+//      フレームの描画時間を計算します.
+//-----------------------------------------------------------------------------
+double BudgetScheduler::GetFrameTime(uint32_t frameIndex, double deadlineSec, double elapsedSec)
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    auto remain = std::max(deadlineSec - elapsedSec, 0.0);
+    if (frameIndex >= m_FrameCount)
+    { return remain; }
+
+    // 次に描画するフレームと, まだ描画していないフレーム.
+    m_Pending.clear();
+    m_Difficulties.clear();
+    for(auto i=0u; i<m_FrameCount; ++i)
+    {
+        if (i != frameIndex && m_Done[i])
+        { continue; }
+
+        m_Pending     .push_back(i);
+        m_Difficulties.push_back(CalcDifficulty(i));
+    }
+
+    auto count  = uint32_t(m_Pending.size());
+    auto mean   = remain / double(count);
+    auto target = uint32_t(std::lower_bound(m_Pending.begin(), m_Pending.end(), frameIndex) - m_Pending.begin());
+
+    // 1回も描画できない時間を割り振ると使い過ぎた分が後のフレームから削られる.
+    // 全てのフレームに確保できない場合は均等に割り振る.
+    auto minSec = std::min(std::max(m_MinFrameSec, m_SampleSec), mean);
+
+    auto result = mean;
+    if (count > 1)
+    {
+        // 難しさに比例して割り振り, 上下限で切った分を他のフレームに回す.
+        // sum(clamp(scale * d, lo, hi)) = remain となる scale を二分法で求める.
+        auto lo = std::max(mean * m_MinScale, minSec);
+        auto hi = std::max(mean * m_MaxScale, lo);
+
+        auto minDifficulty = *std::min_element(m_Difficulties.begin(), m_Difficulties.end());
+        auto scaleMin = 0.0;
+        auto scaleMax = hi / minDifficulty;
+
+        for(auto n=0u; n<BISECTION_COUNT; ++n)
+        {
+            auto scale = (scaleMin + scaleMax) * 0.5;
+            auto total = 0.0;
+            for(auto d : m_Difficulties)
+            { total += std::min(std::max(scale * d, lo), hi); }
+
+            if (total < remain)
+            { scaleMin = scale; }
+            else
+            { scaleMax = scale; }
+        }
+
+        auto scale = (scaleMin + scaleMax) * 0.5;
+        result = std::min(std::max(scale * m_Difficulties[target], lo), hi);
+
+        // 後に残すフレームの最低限の時間は確保する.
+        auto reserve = double(count - 1) * minSec;
+        result = std::min(result, std::max(remain - reserve, minSec));
+    }
+
+    if (m_Stats.MinFrameSec == 0.0 || result < m_Stats.MinFrameSec)
+    { m_Stats.MinFrameSec = result; }
+    m_Stats.MaxFrameSec = std::max(m_Stats.MaxFrameSec, result);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      推定した難しさを取得します.
+//-----------------------------------------------------------------------------
+double BudgetScheduler::GetDifficulty(uint32_t frameIndex) const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (frameIndex >= m_FrameCount)
+    { return 0.0; }
+
+    return CalcDifficulty(frameIndex);
+}
+
+//-----------------------------------------------------------------------------
+//      未完了のフレーム数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t BudgetScheduler::GetPendingCount() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return uint32_t(std::count(m_Done.begin(), m_Done.end(), uint8_t(0)));
+}
+
+//-----------------------------------------------------------------------------
+//      統計情報を取得します.
+//-----------------------------------------------------------------------------
+BudgetSchedulerStats BudgetScheduler::GetStats() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return m_Stats;
+}
+
+//-----------------------------------------------------------------------------
+//      値のある前後のフレームから線形補間します (m_Mutex をロックして呼び出します).
+//-----------------------------------------------------------------------------
+double BudgetScheduler::Interpolate(uint32_t frameIndex, bool priorOnly) const
+{
+    // 描画結果があれば事前パスより優先する.
+    auto getValue = [&](uint32_t index)
+    { return (!priorOnly && m_Measured[index] > 0.0) ? m_Measured[index] : m_Priors[index]; };
+
+    auto value = getValue(frameIndex);
+    if (value > 0.0)
+    { return value; }
+
+    auto prev = frameIndex;
+    while(prev > 0 && getValue(prev - 1) <= 0.0)
+    { prev--; }
+
+    auto next = frameIndex + 1;
+    while(next < m_FrameCount && getValue(next) <= 0.0)
+    { next++; }
+
+    auto hasPrev = (prev > 0);
+    auto hasNext = (next < m_FrameCount);
+
+    if (hasPrev && hasNext)
+    {
+        auto v0 = getValue(prev - 1);
+        auto v1 = getValue(next);
+        auto t  = double(frameIndex - (prev - 1)) / double(next - (prev - 1));
+        return v0 + (v1 - v0) * t;
+    }
+    else if (hasPrev)
+    { return getValue(prev - 1); }
+    else if (hasNext)
+    { return getValue(next); }
+
+    return 0.0;
+}
+
+//-----------------------------------------------------------------------------
+//      難しさを推定します (m_Mutex をロックして呼び出します).
+//-----------------------------------------------------------------------------
+double BudgetScheduler::CalcDifficulty(uint32_t frameIndex) const
+{
+    // 推定値が無ければ均等に割り振る.
+    auto value = Interpolate(frameIndex, false);
+    return (value > 0.0) ? value : 1.0;
+}
+
+//-----------------------------------------------------------------------------
+//      画像のノイズの分散を推定します.
+//-----------------------------------------------------------------------------
+double EstimateNoiseVariance
+(
+    const uint8_t*  pPixels,
+    uint32_t        width,
+    uint32_t        height,
+    uint32_t        pitch,
+    uint32_t        rowStep
+)
+{
+    if (pPixels == nullptr || width < 3 || height < 3)
+    { return 0.0; }
+
+    rowStep = std::max(rowStep, 1u);
+
+    thread_local std::vector<int32_t> rows;
+    rows.resize(size_t(width) * 3);
+
+    auto pTop = rows.data();
+    auto pMid = pTop + width;
+    auto pBot = pMid + width;
+
+    uint64_t sum   = 0;
+    uint64_t count = 0;
+
+    for(auto y=1u; y+1<height; y+=rowStep)
+    {
+        ConvertLuma(pPixels + size_t(y - 1) * pitch, width, pTop);
+        ConvertLuma(pPixels + size_t(y    ) * pitch, width, pMid);
+        ConvertLuma(pPixels + size_t(y + 1) * pitch, width, pBot);
+
+        // [1 -2 1; -2 4 -2; 1 -2 1] は横方向と縦方向の2次差分の積.
+        for(auto x=1u; x+1<width; ++x)
+        {
+            auto v = Laplacian(pTop, x) - 2 * Laplacian(pMid, x) + Laplacian(pBot, x);
+            sum += uint64_t(std::abs(v));
+        }
+        count += width - 2;
+    }
+
+    if (count == 0)
+    { return 0.0; }
+
+    // sigma = sqrt(pi / 2) * mean(|I * N|) / 6.
+    auto sigma = std::sqrt(PI * 0.5) * (double(sum) / double(count)) / 6.0;
+    sigma /= 255.0 * 256.0;
+    return sigma * sigma;
+}
+
+} // namespace r3d
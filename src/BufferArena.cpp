@@ -0,0 +1,438 @@
+﻿//-----------------------------------------------------------------------------
+// File : BufferArena.cpp
+// Desc : TLSF Sub-Allocator for Large Buffer Blocks.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <BufferArena.h>
+#include <cassert>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t INVALID_NODE = UINT32_MAX;
+
+//-----------------------------------------------------------------------------
+//      最上位の立っているビット位置を求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t FindLastSet(uint64_t value)
+{
+    assert(value != 0);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return uint32_t(index);
+#else
+    return uint32_t(63 - __builtin_clzll(value));
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      最下位の立っているビット位置を求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t FindFirstSet(uint64_t value)
+{
+    assert(value != 0);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return uint32_t(index);
+#else
+    return uint32_t(__builtin_ctzll(value));
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      サイズからビン番号を求めます.
+//-----------------------------------------------------------------------------
+inline void MapBin(uint64_t units, uint32_t slBits, uint32_t& fl, uint32_t& sl)
+{
+    auto msb = FindLastSet(units);
+    if (msb < slBits)
+    {
+        // 小さい領域は第1階層0番に線形に並べる.
+        fl = 0;
+        sl = uint32_t(units);
+        return;
+    }
+
+    fl = msb - slBits + 1;
+    sl = uint32_t(units >> (msb - slBits)) - (1u << slBits);
+}
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// BufferArena class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool BufferArena::Init(uint64_t blockSize, uint64_t alignment)
+{
+    Term();
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    { return false; }
+
+    if (blockSize < alignment)
+    { return false; }
+
+    m_AlignShift = FindLastSet(alignment);
+    m_BlockUnits = blockSize >> m_AlignShift;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void BufferArena::Term()
+{
+    m_Nodes      .clear();
+    m_UnusedNodes.clear();
+    m_Blocks     .clear();
+
+    m_FlBitmap = 0;
+    for(auto fl=0u; fl<FL_COUNT; ++fl)
+    {
+        m_SlBitmap[fl] = 0;
+        for(auto sl=0u; sl<SL_COUNT; ++sl)
+        { m_FreeHeads[fl][sl] = INVALID_NODE; }
+    }
+
+    m_BlockUnits = 0;
+    m_AlignShift = 0;
+    m_UsedUnits  = 0;
+    m_AllocCount = 0;
+    m_FreeCount  = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      領域を割り当てます.
+//-----------------------------------------------------------------------------
+bool BufferArena::Alloc(uint64_t size, ArenaAllocation& result)
+{
+    result = ArenaAllocation();
+
+    if (size == 0 || m_BlockUnits == 0)
+    { return false; }
+
+    auto mask  = (uint64_t(1) << m_AlignShift) - 1;
+    auto units = (size >> m_AlignShift) + (((size & mask) != 0) ? 1 : 0);
+
+    auto index = FindFree(units);
+    if (index == INVALID_NODE)
+    {
+        // 収まらなければブロックを追加. ブロックより大きい要求は専用ブロックにする.
+        auto dedicated = (units > m_BlockUnits);
+        index = AddBlock(dedicated ? units : m_BlockUnits, dedicated);
+    }
+
+    RemoveFree(index);
+
+    // 余りを空き領域として切り出す.
+    if (m_Nodes[index].Size > units)
+    {
+        auto rest = NewNode();
+        auto& node = m_Nodes[index];
+        auto& tail = m_Nodes[rest];
+
+        tail.Offset   = node.Offset + units;
+        tail.Size     = node.Size - units;
+        tail.Block    = node.Block;
+        tail.PrevPhys = index;
+        tail.NextPhys = node.NextPhys;
+        tail.Free     = true;
+
+        if (node.NextPhys != INVALID_NODE)
+        { m_Nodes[node.NextPhys].PrevPhys = rest; }
+
+        node.NextPhys = rest;
+        node.Size     = units;
+
+        InsertFree(rest);
+    }
+
+    auto& node = m_Nodes[index];
+    node.Free = false;
+
+    m_UsedUnits += units;
+    m_AllocCount++;
+
+    result.Block  = node.Block;
+    result.Node   = index;
+    result.Offset = node.Offset << m_AlignShift;
+    result.Size   = units << m_AlignShift;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      領域を解放します.
+//-----------------------------------------------------------------------------
+void BufferArena::Free(const ArenaAllocation& allocation)
+{
+    if (!allocation.IsValid() || allocation.Node >= m_Nodes.size())
+    { return; }
+
+    auto index = allocation.Node;
+    assert(!m_Nodes[index].Free);
+    assert(m_Nodes[index].Block == allocation.Block);
+
+    m_UsedUnits -= m_Nodes[index].Size;
+    m_AllocCount--;
+    m_Nodes[index].Free = true;
+
+    // 直後の空き領域と結合.
+    auto next = m_Nodes[index].NextPhys;
+    if (next != INVALID_NODE && m_Nodes[next].Free)
+    {
+        RemoveFree(next);
+        m_Nodes[index].Size    += m_Nodes[next].Size;
+        m_Nodes[index].NextPhys = m_Nodes[next].NextPhys;
+        if (m_Nodes[index].NextPhys != INVALID_NODE)
+        { m_Nodes[m_Nodes[index].NextPhys].PrevPhys = index; }
+        DeleteNode(next);
+    }
+
+    // 直前の空き領域と結合.
+    auto prev = m_Nodes[index].PrevPhys;
+    if (prev != INVALID_NODE && m_Nodes[prev].Free)
+    {
+        RemoveFree(prev);
+        m_Nodes[prev].Size    += m_Nodes[index].Size;
+        m_Nodes[prev].NextPhys = m_Nodes[index].NextPhys;
+        if (m_Nodes[prev].NextPhys != INVALID_NODE)
+        { m_Nodes[m_Nodes[prev].NextPhys].PrevPhys = prev; }
+        DeleteNode(index);
+        index = prev;
+    }
+
+    InsertFree(index);
+}
+
+//-----------------------------------------------------------------------------
+//      ブロック数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t BufferArena::GetBlockCount() const
+{ return uint32_t(m_Blocks.size()); }
+
+//-----------------------------------------------------------------------------
+//      ブロックサイズを取得します.
+//-----------------------------------------------------------------------------
+uint64_t BufferArena::GetBlockSize(uint32_t index) const
+{
+    assert(index < m_Blocks.size());
+    return m_Blocks[index].Size << m_AlignShift;
+}
+
+//-----------------------------------------------------------------------------
+//      統計情報を取得します.
+//-----------------------------------------------------------------------------
+ArenaStats BufferArena::GetStats() const
+{
+    ArenaStats result;
+    result.BlockCount      = uint32_t(m_Blocks.size());
+    result.AllocationCount = m_AllocCount;
+    result.FreeRangeCount  = m_FreeCount;
+
+    uint64_t capacity = 0;
+    for(auto& block : m_Blocks)
+    {
+        capacity += block.Size;
+        if (block.Dedicated)
+        { result.DedicatedCount++; }
+    }
+
+    result.Capacity = capacity << m_AlignShift;
+    result.UsedSize = m_UsedUnits << m_AlignShift;
+    result.FreeSize = (capacity - m_UsedUnits) << m_AlignShift;
+
+    // 最大の空き領域は最上位のビンにある.
+    if (m_FlBitmap != 0)
+    {
+        auto fl = FindLastSet(m_FlBitmap);
+        auto sl = FindLastSet(m_SlBitmap[fl]);
+
+        uint64_t largest = 0;
+        for(auto i=m_FreeHeads[fl][sl]; i != INVALID_NODE; i = m_Nodes[i].NextFree)
+        {
+            if (m_Nodes[i].Size > largest)
+            { largest = m_Nodes[i].Size; }
+        }
+
+        result.LargestFreeRange = largest << m_AlignShift;
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ノードを確保します.
+//-----------------------------------------------------------------------------
+uint32_t BufferArena::NewNode()
+{
+    uint32_t index;
+    if (!m_UnusedNodes.empty())
+    {
+        index = m_UnusedNodes.back();
+        m_UnusedNodes.pop_back();
+    }
+    else
+    {
+        index = uint32_t(m_Nodes.size());
+        m_Nodes.emplace_back();
+    }
+
+    auto& node = m_Nodes[index];
+    node.Offset   = 0;
+    node.Size     = 0;
+    node.Block    = UINT32_MAX;
+    node.PrevPhys = INVALID_NODE;
+    node.NextPhys = INVALID_NODE;
+    node.PrevFree = INVALID_NODE;
+    node.NextFree = INVALID_NODE;
+    node.Free     = false;
+
+    return index;
+}
+
+//-----------------------------------------------------------------------------
+//      ノードを破棄します.
+//-----------------------------------------------------------------------------
+void BufferArena::DeleteNode(uint32_t index)
+{
+    m_Nodes[index].Block = UINT32_MAX;
+    m_UnusedNodes.push_back(index);
+}
+
+//-----------------------------------------------------------------------------
+//      空き領域をビンに登録します.
+//-----------------------------------------------------------------------------
+void BufferArena::InsertFree(uint32_t index)
+{
+    uint32_t fl, sl;
+    MapBin(m_Nodes[index].Size, SL_BITS, fl, sl);
+
+    auto& node = m_Nodes[index];
+    auto  head = m_FreeHeads[fl][sl];
+
+    node.Free     = true;
+    node.PrevFree = INVALID_NODE;
+    node.NextFree = head;
+    if (head != INVALID_NODE)
+    { m_Nodes[head].PrevFree = index; }
+
+    m_FreeHeads[fl][sl] = index;
+    m_SlBitmap[fl] |= (1u << sl);
+    m_FlBitmap     |= (uint64_t(1) << fl);
+    m_FreeCount++;
+}
+
+//-----------------------------------------------------------------------------
+//      空き領域をビンから外します.
+//-----------------------------------------------------------------------------
+void BufferArena::RemoveFree(uint32_t index)
+{
+    uint32_t fl, sl;
+    MapBin(m_Nodes[index].Size, SL_BITS, fl, sl);
+
+    auto& node = m_Nodes[index];
+    if (node.PrevFree != INVALID_NODE)
+    { m_Nodes[node.PrevFree].NextFree = node.NextFree; }
+    else
+    { m_FreeHeads[fl][sl] = node.NextFree; }
+
+    if (node.NextFree != INVALID_NODE)
+    { m_Nodes[node.NextFree].PrevFree = node.PrevFree; }
+
+    node.PrevFree = INVALID_NODE;
+    node.NextFree = INVALID_NODE;
+
+    if (m_FreeHeads[fl][sl] == INVALID_NODE)
+    {
+        m_SlBitmap[fl] &= ~(1u << sl);
+        if (m_SlBitmap[fl] == 0)
+        { m_FlBitmap &= ~(uint64_t(1) << fl); }
+    }
+
+    m_FreeCount--;
+}
+
+//-----------------------------------------------------------------------------
+//      指定サイズが収まる空き領域を探索します.
+//-----------------------------------------------------------------------------
+uint32_t BufferArena::FindFree(uint64_t units) const
+{
+    // 切り上げたビンの先頭なら必ず収まる.
+    auto rounded = units;
+    auto msb     = FindLastSet(units);
+    if (msb >= SL_BITS)
+    {
+        auto step = (uint64_t(1) << (msb - SL_BITS)) - 1;
+        if (units <= UINT64_MAX - step)
+        { rounded += step; }
+    }
+
+    uint32_t fl, sl;
+    MapBin(rounded, SL_BITS, fl, sl);
+
+    auto slMap = m_SlBitmap[fl] & (~0u << sl);
+    if (slMap == 0)
+    {
+        auto flMap = (fl + 1 < FL_COUNT) ? (m_FlBitmap & (~uint64_t(0) << (fl + 1))) : 0;
+        if (flMap != 0)
+        {
+            fl    = FindFirstSet(flMap);
+            slMap = m_SlBitmap[fl];
+        }
+    }
+
+    if (slMap != 0)
+    { return m_FreeHeads[fl][FindFirstSet(slMap)]; }
+
+    // ブロックを増やす前に同じビン内で収まる領域を探す.
+    MapBin(units, SL_BITS, fl, sl);
+    for(auto i=m_FreeHeads[fl][sl]; i != INVALID_NODE; i = m_Nodes[i].NextFree)
+    {
+        if (m_Nodes[i].Size >= units)
+        { return i; }
+    }
+
+    return INVALID_NODE;
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックを追加します.
+//-----------------------------------------------------------------------------
+uint32_t BufferArena::AddBlock(uint64_t units, bool dedicated)
+{
+    Block block = {};
+    block.Size      = units;
+    block.Dedicated = dedicated;
+
+    auto index = NewNode();
+    auto& node = m_Nodes[index];
+    node.Offset = 0;
+    node.Size   = units;
+    node.Block  = uint32_t(m_Blocks.size());
+
+    m_Blocks.push_back(block);
+    InsertFree(index);
+
+    return index;
+}
+
+} // namespace r3d
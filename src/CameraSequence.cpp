@@ -8,24 +8,26 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <CameraSequence.h>
+#include <MappedFile.h>
 #include <fnd/asdxLogger.h>
 #include <Windows.h>
 #include <generated/camera_format.h>
-
-#if !CAMP_RELEASE
-#include <fnd/asdxMisc.h>
-#include <fstream>
-#include <ctime>
-#endif//!CAMP_RELEASE
+#include <algorithm>
 
 
 namespace r3d {
 
+//-----------------------------------------------------------------------------
+//      トラック形式に変換します.
+//-----------------------------------------------------------------------------
+Float3 Convert(const r3d::Vector3& value)
+{ return Float3{ value.x(), value.y(), value.z() }; }
+
 //-----------------------------------------------------------------------------
 //      asdx形式に変換します.
 //-----------------------------------------------------------------------------
-asdx::Vector3 Convert(const r3d::Vector3& value)
-{ return asdx::Vector3(value.x(), value.y(), value.z()); }
+asdx::Vector3 Convert(const Float3& value)
+{ return asdx::Vector3(value.x, value.y, value.z); }
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -37,59 +39,54 @@ asdx::Vector3 Convert(const r3d::Vector3& value)
 //-----------------------------------------------------------------------------
 bool CameraSequence::Init(const char* path, float aspectRatio)
 {
-    // ファイル読み込み.
+    // ファイルマッピング. キーに変換したら不要になる.
+    MappedFile file;
+    if (!file.Init(path, MAPPED_FILE_HINT_SEQUENTIAL))
     {
-        auto hFile = CreateFileA(
-            path,
-            GENERIC_READ,
-            0,
-            NULL,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            NULL);
-        if (hFile == INVALID_HANDLE_VALUE)
-        {
-            ELOGA("Error : File Open Failed. path = %s");
-            return false;
-        }
-
-        auto size = GetFileSize(hFile, NULL);
-        m_pBinary = malloc(size);
-        DWORD readSize = 0;
-        auto ret = ReadFile(hFile, m_pBinary, size, &readSize, NULL);
-        if (!ret)
-        {
-            ELOGA("Error : Read Failed. path = %s", path);
-            free(m_pBinary);
-            CloseHandle(hFile);
-            return false;
-        }
-        CloseHandle(hFile);
+        ELOGA("Error : MappedFile::Init() Failed. path = %s", path);
+        return false;
+    }
+
+    auto resSequence = GetResCameraSequence(file.GetData());
+    auto resParams   = resSequence->params();
+    if (resParams == nullptr || resParams->size() == 0)
+    {
+        ELOGA("Error : Camera Key Not Found. path = %s", path);
+        return false;
     }
 
-    // インデックスをリセット.
-    m_FrameIndex = 0;
-    m_ParamIndex = 0;
+    std::vector<CameraKey> keys;
+    keys.resize(resParams->size());
 
-    auto resSequence = GetResCameraSequence(m_pBinary);
-    assert(resSequence->params()->size() > 0);
+    for(auto i=0u; i<resParams->size(); ++i)
+    {
+        auto param = resParams->Get(i);
+
+        auto& key = keys[i];
+        key.Time        = float(param->frameIndex());
+        key.Position    = Convert(param->position());
+        key.Target      = Convert(param->target());
+        key.Upward      = Convert(param->upward());
+        key.FieldOfView = param->fieldOfView();
+        key.NearClip    = param->nearClip();
+        key.FarClip     = param->farClip();
+    }
 
-    auto param = resSequence->params()->Get(0);
+    file.Term();
 
-    auto pos = Convert(param->position());
-    auto at  = Convert(param->target());
-    auto up  = Convert(param->upward());
+    if (!m_Track.Init(keys.data(), keys.size()))
+    {
+        ELOGA("Error : CameraTrack::Init() Failed. Frame indices must be ascending. path = %s", path);
+        return false;
+    }
 
-    m_CurrView = asdx::Matrix::CreateLookAt(pos, at, up);
-    m_PrevView = m_CurrView;
+    m_FirstFrame = uint32_t(m_Track.GetBeginTime());
+    BuildTable(aspectRatio);
 
-    m_CurrProj = asdx::Matrix::CreatePerspectiveFieldOfView(
-        param->fieldOfView(),
-        aspectRatio,
-        param->nearClip(),
-        param->farClip());
-    m_PrevProj = m_CurrProj;
+    m_CurrFrame = 0;
+    m_PrevFrame = 0;
 
+    ILOGA("Info : Camera Table Built. frames = %zu, keys = %zu", m_Views.size(), m_Track.GetKeyCount());
     return true;
 }
 
@@ -98,288 +95,141 @@ bool CameraSequence::Init(const char* path, float aspectRatio)
 //-----------------------------------------------------------------------------
 void CameraSequence::Term()
 {
-    if (m_pBinary != nullptr)
-    {
-        free(m_pBinary);
-        m_pBinary = nullptr;
-    }
+    m_Track.Term();
+
+    m_Views    .clear();
+    m_Projs    .clear();
+    m_InvViews .clear();
+    m_InvProjs .clear();
+    m_Positions.clear();
+    m_FovY     .clear();
+    m_NearClip .clear();
+    m_FarClip  .clear();
+
+    m_AspectRatio = 0.0f;
+    m_FirstFrame  = 0;
+    m_CurrFrame   = 0;
+    m_PrevFrame   = 0;
 }
 
 //-----------------------------------------------------------------------------
 //      位置座標を取得します.
 //-----------------------------------------------------------------------------
 asdx::Vector3 CameraSequence::GetPosition() const
-{
-    assert(m_pBinary != nullptr);
-    auto resSequence = GetResCameraSequence(m_pBinary);
-    auto& pos = resSequence->params()->Get(m_ParamIndex)->position();
-    return asdx::Vector3(pos.x(), pos.y(), pos.z());
-}
+{ return m_Positions[m_CurrFrame]; }
 
 //-----------------------------------------------------------------------------
 //      視野角(radian)を取得します.
 //-----------------------------------------------------------------------------
 float CameraSequence::GetFovY() const
-{
-    assert(m_pBinary != nullptr);
-    auto resSequence = GetResCameraSequence(m_pBinary);
-    return resSequence->params()->Get(m_ParamIndex)->fieldOfView();
-}
+{ return m_FovY[m_CurrFrame]; }
 
 //-----------------------------------------------------------------------------
 //      ニアクリップ平面を取得します.
 //-----------------------------------------------------------------------------
 float CameraSequence::GetNearClip() const
-{
-    assert(m_pBinary != nullptr);
-    auto resSequence = GetResCameraSequence(m_pBinary);
-    return resSequence->params()->Get(m_ParamIndex)->nearClip();
-}
+{ return m_NearClip[m_CurrFrame]; }
 
 //-----------------------------------------------------------------------------
 //      ファークリップ平面を取得します.
 //-----------------------------------------------------------------------------
 float CameraSequence::GetFarlip() const
-{
-    assert(m_pBinary != nullptr);
-    auto resSequence = GetResCameraSequence(m_pBinary);
-    return resSequence->params()->Get(m_ParamIndex)->farClip();
-}
+{ return m_FarClip[m_CurrFrame]; }
 
 //-----------------------------------------------------------------------------
 //      カメラの方向ベクトルを取得します.
 //-----------------------------------------------------------------------------
 asdx::Vector3 CameraSequence::GetCameraDir() const
-{ return asdx::Vector3(m_CurrView._13, m_CurrView._23, m_CurrView._33); }
+{
+    auto& view = m_Views[m_CurrFrame];
+    return asdx::Vector3(view._13, view._23, view._33);
+}
 
 //-----------------------------------------------------------------------------
 //      カメラ更新処理を行います.
 //-----------------------------------------------------------------------------
 bool CameraSequence::Update(uint32_t frameIndex, float aspectRatio)
 {
-    assert(m_pBinary != nullptr);
+    assert(!m_Views.empty());
 
-    // フレーム番号を更新.
-    m_FrameIndex = frameIndex;
+    // 解像度が変わった場合だけ作り直す.
+    if (aspectRatio != m_AspectRatio)
+    { BuildTable(aspectRatio); }
 
-    auto resSequence = GetResCameraSequence(m_pBinary);
-    auto maxIndex = resSequence->params()->size() - 1;
+    auto last  = uint32_t(m_Views.size() - 1);
+    auto index = (frameIndex > m_FirstFrame) ? std::min(frameIndex - m_FirstFrame, last) : 0u;
 
-    auto nextIndex = asdx::Clamp(m_ParamIndex + 1u, 0u, maxIndex);
-
-    // 更新フレームかどうかチェック.
-    auto param = resSequence->params()->Get(nextIndex);
-    bool changed = param->frameIndex() == m_FrameIndex;
-
-    if (!changed)
+    // 同じフレームを繰り返した場合は前フレームの行列を壊さない.
+    if (index == m_CurrFrame)
     { return false; }
 
-    m_ParamIndex = nextIndex;
-
-    auto position = Convert(param->position());
-    auto target   = Convert(param->target());
-    auto upward   = Convert(param->upward());
-
-    // ビュー行列を更新.
-    m_PrevView = m_CurrView;
-    m_CurrView = asdx::Matrix::CreateLookAt(position, target, upward);
-
-    // 射影行列を更新.
-    m_PrevProj = m_CurrProj;
-    m_CurrProj = asdx::Matrix::CreatePerspectiveFieldOfView(
-        param->fieldOfView(),
-        aspectRatio,
-        param->nearClip(),
-        param->farClip());
-
+    m_PrevFrame = m_CurrFrame;
+    m_CurrFrame = index;
     return true;
 }
 
-#if !CAMP_RELEASE
-///////////////////////////////////////////////////////////////////////////////
-// CameraSequenceExporter class
-///////////////////////////////////////////////////////////////////////////////
-
 //-----------------------------------------------------------------------------
-//      テキストファイルからデータをロードします.
+//      指定時刻のカメラ行列を求めます.
 //-----------------------------------------------------------------------------
-bool CameraSequenceExporter::LoadFromTXT(const char* path, std::string& exportPath)
+void CameraSequence::Evaluate(double time, float aspectRatio, asdx::Matrix& view, asdx::Matrix& proj) const
 {
-    std::string inputPath;
-    if (!asdx::SearchFilePathA(path, inputPath))
-    {
-        ELOGA("Error : File Not Found. path = %s", path);
-        return false;
-    }
-
-    std::ifstream stream;
-    stream.open(inputPath.c_str(), std::ios::in);
-
-    if (!stream.is_open())
-    {
-        ELOGA("Error : File Open Failed. path = %s", inputPath.c_str());
-        return false;
-    }
-
-    const uint32_t BUFFER_SIZE = 4096;
-    char buf[BUFFER_SIZE] = {};
-
-    for(;;)
-    {
-        stream >> buf;
-        if (!stream || stream.eof())
-        { break; }
-
-        if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-        { /* DO_NOTHING */ }
-        else if (0 == _stricmp(buf, "camera"))
-        {
-            CameraParam param = {};
-
-            for(;;)
-            {
-                stream >> buf;
-                if (!stream || stream.eof())
-                { break; }
-
-                if (0 == strcmp(buf, "};"))
-                { break; }
-                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-                { /* DO_NOTHING */ }
-                else if (0 == _stricmp(buf, "-FrameIndex:"))
-                { stream >> param.FrameIndex; }
-                else if (0 == _stricmp(buf, "-Position:"))
-                { stream >> param.Position.x >> param.Position.y >> param.Position.z; }
-                else if (0 == _stricmp(buf, "-Target:"))
-                { stream >> param.Target.x >> param.Target.y >> param.Target.z; }
-                else if (0 == _stricmp(buf, "-Upward:"))
-                { stream >> param.Upward.x >> param.Upward.y >> param.Upward.z; }
-                else if (0 == _stricmp(buf, "-FieldOfView:"))
-                {
-                    float fovYDeg = 0.0f;
-                    stream >> fovYDeg;
-                    param.FieldOfView = asdx::ToRadian(fovYDeg);
-                }
-                else if (0 == _stricmp(buf, "-NearClip:"))
-                { stream >> param.NearClip; }
-                else if (0 == _stricmp(buf, "-FarClip:"))
-                { stream >> param.FarClip; }
-
-                stream.ignore(BUFFER_SIZE, '\n');
-            }
-
-            m_Params.push_back(param);
-        }
-        else if (0 == _stricmp(buf, "export"))
-        {
-            for(;;)
-            {
-                stream >> buf;
-                if (!stream || stream.eof())
-                { break; }
-                if (0 == strcmp(buf, "};"))
-                { break; }
-                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-                { /* DO_NOTHING */ }
-                else if (0 == _stricmp(buf, "-Path:"))
-                { stream >> exportPath; }
-
-                stream.ignore(BUFFER_SIZE, '\n');
-            }
-        }
-
-        stream.ignore(BUFFER_SIZE, '\n');
-    }
-    stream.close();
-
-    // エクスポート名が無ければタイムスタンプを付ける
-    if (exportPath.empty())
-    {
-        tm local_time = {};
-        auto t   = time(nullptr);
-        auto err = localtime_s( &local_time, &t );
-
-        char timeStamp[256] = {};
-        sprintf_s(timeStamp, "%04d%02d%02d_%02d%02d%02d",
-            local_time.tm_year + 1900,
-            local_time.tm_mon + 1,
-            local_time.tm_mday,
-            local_time.tm_hour,
-            local_time.tm_min,
-            local_time.tm_sec);
-
-        exportPath = "../res/scene/camera_";
-        exportPath += timeStamp;
-        exportPath += ".cam";
-    }
-
-    if (!Export(exportPath.c_str()))
-    {
-        ELOG("Error : Camera Sequence Data Export Failed.");
-        return false;
-    }
-
-    ILOGA("Info : Camera Sequence Data Exported!! path = %s", exportPath.c_str());
-    return true;
+    assert(m_Track.GetKeyCount() > 0);
+    ToMatrix(m_Track.Evaluate(time), aspectRatio, view, proj);
 }
 
 //-----------------------------------------------------------------------------
-//      バイナリに出力します.
+//      全フレームの行列とパラメータを計算します.
 //-----------------------------------------------------------------------------
-bool CameraSequenceExporter::Export(const char* path)
+void CameraSequence::BuildTable(float aspectRatio)
 {
-    std::vector<r3d::ResCameraParam> params;
-    params.resize(m_Params.size());
-
-    // データ変換.
-    for(size_t i=0; i<m_Params.size(); ++i)
+    auto count = size_t(uint32_t(m_Track.GetEndTime()) - m_FirstFrame) + 1;
+
+    m_Views    .resize(count);
+    m_Projs    .resize(count);
+    m_InvViews .resize(count);
+    m_InvProjs .resize(count);
+    m_Positions.resize(count);
+    m_FovY     .resize(count);
+    m_NearClip .resize(count);
+    m_FarClip  .resize(count);
+
+    for(size_t i=0; i<count; ++i)
     {
-        r3d::Vector3 position(m_Params[i].Position.x, m_Params[i].Position.y, m_Params[i].Position.z);
-        r3d::Vector3 target(m_Params[i].Target.x, m_Params[i].Target.y, m_Params[i].Target.z);
-        r3d::Vector3 upward(m_Params[i].Upward.x, m_Params[i].Upward.y, m_Params[i].Upward.z);
-
-        params[i] = r3d::ResCameraParam(
-            m_Params[i].FrameIndex,
-            position,
-            target,
-            upward,
-            m_Params[i].FieldOfView,
-            m_Params[i].NearClip,
-            m_Params[i].FarClip);
+        auto pose = m_Track.Evaluate(double(m_FirstFrame + i));
+
+        ToMatrix(pose, aspectRatio, m_Views[i], m_Projs[i]);
+        m_InvViews [i] = asdx::Matrix::Invert(m_Views[i]);
+        m_InvProjs [i] = asdx::Matrix::Invert(m_Projs[i]);
+        m_Positions[i] = Convert(pose.Position);
+        m_FovY     [i] = pose.FieldOfView;
+        m_NearClip [i] = pose.NearClip;
+        m_FarClip  [i] = pose.FarClip;
     }
 
-    flatbuffers::FlatBufferBuilder builder(2048);
-    auto dstSequence = r3d::CreateResCameraSequenceDirect(
-        builder,
-        &params);
-
-    builder.Finish(dstSequence);
-
-    auto buffer = builder.GetBufferPointer();
-    auto size   = builder.GetSize();
-
-    FILE* fp = nullptr;
-    auto err = fopen_s(&fp, path, "wb");
-    if (err != 0)
-    {
-        ELOG("Error : File Open Failed. path = %s", path);
-        return false;
-    }
-
-    fwrite(buffer, size, 1, fp);
-    fclose(fp);
-
-    return true;
+    m_AspectRatio = aspectRatio;
 }
 
 //-----------------------------------------------------------------------------
-//      データをリセットします.
+//      カメラ姿勢から行列を求めます.
 //-----------------------------------------------------------------------------
-void CameraSequenceExporter::Reset()
+void CameraSequence::ToMatrix
+(
+    const CameraPose&   pose,
+    float               aspectRatio,
+    asdx::Matrix&       view,
+    asdx::Matrix&       proj
+) const
 {
-    m_Params.clear();
-    m_Params.shrink_to_fit();
+    auto position = Convert(pose.Position);
+    auto target   = position + Convert(pose.Forward);
+    auto upward   = Convert(pose.Upward);
+
+    view = asdx::Matrix::CreateLookAt(position, target, upward);
+    proj = asdx::Matrix::CreatePerspectiveFieldOfView(
+        pose.FieldOfView,
+        aspectRatio,
+        pose.NearClip,
+        pose.FarClip);
 }
-#endif
 
 } // namespace r3d
@@ -0,0 +1,315 @@
+﻿//-----------------------------------------------------------------------------
+// File : CameraTrack.cpp
+// Desc : Keyframe Camera Track.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <CameraTrack.h>
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const float SLERP_THRESHOLD = 0.9995f;   // これより近い向きは正規化線形補間で済ませる.
+static const float EPSILON_LENGTH  = 1e-6f;     // 長さ0とみなす閾値.
+
+//-----------------------------------------------------------------------------
+//      ベクトル演算.
+//-----------------------------------------------------------------------------
+inline r3d::Float3 Add(const r3d::Float3& a, const r3d::Float3& b)
+{ return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+
+inline r3d::Float3 Sub(const r3d::Float3& a, const r3d::Float3& b)
+{ return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+
+inline r3d::Float3 Mul(const r3d::Float3& a, float s)
+{ return { a.x * s, a.y * s, a.z * s }; }
+
+inline float Dot(const r3d::Float3& a, const r3d::Float3& b)
+{ return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+inline r3d::Float3 Cross(const r3d::Float3& a, const r3d::Float3& b)
+{ return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+//-----------------------------------------------------------------------------
+//      正規化します. 長さが0に近い場合は代替値を返します.
+//-----------------------------------------------------------------------------
+inline r3d::Float3 Normalize(const r3d::Float3& value, const r3d::Float3& fallback)
+{
+    auto len = std::sqrt(Dot(value, value));
+    return (len > EPSILON_LENGTH) ? Mul(value, 1.0f / len) : fallback;
+}
+
+//-----------------------------------------------------------------------------
+//      正規直交基底 (右, 上, 前) からクォータニオンを求めます.
+//-----------------------------------------------------------------------------
+void ToQuaternion(const r3d::Float3& r, const r3d::Float3& u, const r3d::Float3& f, float* q)
+{
+    // 各軸を列に持つ回転行列.
+    auto m00 = r.x; auto m01 = u.x; auto m02 = f.x;
+    auto m10 = r.y; auto m11 = u.y; auto m12 = f.y;
+    auto m20 = r.z; auto m21 = u.z; auto m22 = f.z;
+
+    auto trace = m00 + m11 + m22;
+    if (trace > 0.0f)
+    {
+        auto s = std::sqrt(trace + 1.0f) * 2.0f;
+        q[0] = (m21 - m12) / s;
+        q[1] = (m02 - m20) / s;
+        q[2] = (m10 - m01) / s;
+        q[3] = 0.25f * s;
+    }
+    else if (m00 > m11 && m00 > m22)
+    {
+        auto s = std::sqrt(1.0f + m00 - m11 - m22) * 2.0f;
+        q[0] = 0.25f * s;
+        q[1] = (m01 + m10) / s;
+        q[2] = (m02 + m20) / s;
+        q[3] = (m21 - m12) / s;
+    }
+    else if (m11 > m22)
+    {
+        auto s = std::sqrt(1.0f + m11 - m00 - m22) * 2.0f;
+        q[0] = (m01 + m10) / s;
+        q[1] = 0.25f * s;
+        q[2] = (m12 + m21) / s;
+        q[3] = (m02 - m20) / s;
+    }
+    else
+    {
+        auto s = std::sqrt(1.0f + m22 - m00 - m11) * 2.0f;
+        q[0] = (m02 + m20) / s;
+        q[1] = (m12 + m21) / s;
+        q[2] = 0.25f * s;
+        q[3] = (m10 - m01) / s;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      クォータニオンでベクトルを回転させます.
+//-----------------------------------------------------------------------------
+inline r3d::Float3 Rotate(const float* q, const r3d::Float3& v)
+{
+    r3d::Float3 axis = { q[0], q[1], q[2] };
+    auto t = Mul(Cross(axis, v), 2.0f);
+    return Add(Add(v, Mul(t, q[3])), Cross(axis, t));
+}
+
+//-----------------------------------------------------------------------------
+//      球面線形補間します.
+//-----------------------------------------------------------------------------
+void Slerp(const float* a, const float* b, float t, float* result)
+{
+    auto cosTheta = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+
+    // 符号は Init() で揃えてあるので常に近い側を回る.
+    float wa, wb;
+    if (cosTheta > SLERP_THRESHOLD)
+    {
+        wa = 1.0f - t;
+        wb = t;
+    }
+    else
+    {
+        auto theta    = std::acos(std::min(cosTheta, 1.0f));
+        auto sinTheta = std::sin(theta);
+        wa = std::sin((1.0f - t) * theta) / sinTheta;
+        wb = std::sin(t * theta) / sinTheta;
+    }
+
+    auto len = 0.0f;
+    for(auto i=0; i<4; ++i)
+    {
+        result[i] = wa * a[i] + wb * b[i];
+        len += result[i] * result[i];
+    }
+
+    len = 1.0f / std::sqrt(len);
+    for(auto i=0; i<4; ++i)
+    { result[i] *= len; }
+}
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// CameraTrack class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool CameraTrack::Init(const CameraKey* pKeys, size_t count)
+{
+    Term();
+
+    if (pKeys == nullptr || count == 0)
+    { return false; }
+
+    for(size_t i=1; i<count; ++i)
+    {
+        if (!(pKeys[i - 1].Time < pKeys[i].Time))
+        { return false; }
+    }
+
+    m_Keys .resize(count);
+    m_Times.resize(count);
+
+    for(size_t i=0; i<count; ++i)
+    {
+        auto& src = pKeys[i];
+        auto& dst = m_Keys[i];
+
+        // 注視点と上向きベクトルから正規直交基底を作る.
+        auto f = Normalize(Sub(src.Target, src.Position), Float3{ 0.0f, 0.0f, 1.0f });
+        auto r = Normalize(Cross(src.Upward, f), Float3{ 0.0f, 0.0f, 0.0f });
+        if (Dot(r, r) == 0.0f)
+        {
+            // 視線と上向きが平行な場合は別の軸を上とみなす.
+            Float3 up = (std::abs(f.y) < 0.999f) ? Float3{ 0.0f, 1.0f, 0.0f } : Float3{ 0.0f, 0.0f, 1.0f };
+            r = Normalize(Cross(up, f), Float3{ 1.0f, 0.0f, 0.0f });
+        }
+        auto u = Cross(f, r);
+
+        dst.Time        = src.Time;
+        dst.Position    = src.Position;
+        dst.Tangent     = Float3{ 0.0f, 0.0f, 0.0f };
+        dst.FieldOfView = src.FieldOfView;
+        dst.NearClip    = src.NearClip;
+        dst.FarClip     = src.FarClip;
+        ToQuaternion(r, u, f, dst.Rotation);
+
+        // 補間が遠回りしないように隣のキーと符号を揃える.
+        if (i > 0)
+        {
+            auto& prev = m_Keys[i - 1].Rotation;
+            auto  d    = prev[0] * dst.Rotation[0] + prev[1] * dst.Rotation[1]
+                       + prev[2] * dst.Rotation[2] + prev[3] * dst.Rotation[3];
+            if (d < 0.0f)
+            {
+                for(auto j=0; j<4; ++j)
+                { dst.Rotation[j] = -dst.Rotation[j]; }
+            }
+        }
+
+        m_Times[i] = src.Time;
+    }
+
+    // Catmull-Rom 接線. キー間隔が不均一でも速度が連続するよう時間で割る.
+    for(size_t i=0; i<count && count > 1; ++i)
+    {
+        auto prev = (i > 0)         ? i - 1 : i;
+        auto next = (i + 1 < count) ? i + 1 : i;
+
+        auto dt = float(m_Keys[next].Time - m_Keys[prev].Time);
+        m_Keys[i].Tangent = Mul(Sub(m_Keys[next].Position, m_Keys[prev].Position), 1.0f / dt);
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void CameraTrack::Term()
+{
+    m_Keys .clear();
+    m_Times.clear();
+}
+
+//-----------------------------------------------------------------------------
+//      指定時刻のカメラを求めます.
+//-----------------------------------------------------------------------------
+CameraPose CameraTrack::Evaluate(double time) const
+{
+    CameraPose result = {};
+    if (m_Keys.empty())
+    { return result; }
+
+    auto index = FindSegment(time);
+    auto& k0   = m_Keys[index];
+
+    // 範囲外とキーが1つの場合はそのキーに固定.
+    if (m_Keys.size() == 1 || time <= k0.Time || time >= m_Keys.back().Time)
+    {
+        auto& key = (time >= m_Keys.back().Time) ? m_Keys.back() : k0;
+        result.Position    = key.Position;
+        result.Forward     = Rotate(key.Rotation, Float3{ 0.0f, 0.0f, 1.0f });
+        result.Upward      = Rotate(key.Rotation, Float3{ 0.0f, 1.0f, 0.0f });
+        result.FieldOfView = key.FieldOfView;
+        result.NearClip    = key.NearClip;
+        result.FarClip     = key.FarClip;
+        return result;
+    }
+
+    auto& k1 = m_Keys[index + 1];
+    auto  h  = float(k1.Time - k0.Time);
+    auto  s  = float((time - k0.Time) / (k1.Time - k0.Time));
+    auto  s2 = s * s;
+    auto  s3 = s2 * s;
+
+    // 3次エルミート基底.
+    auto h00 =  2.0f * s3 - 3.0f * s2 + 1.0f;
+    auto h10 =         s3 - 2.0f * s2 + s;
+    auto h01 = -2.0f * s3 + 3.0f * s2;
+    auto h11 =         s3 -        s2;
+
+    result.Position = Add(
+        Add(Mul(k0.Position, h00), Mul(k0.Tangent, h10 * h)),
+        Add(Mul(k1.Position, h01), Mul(k1.Tangent, h11 * h)));
+
+    float rotation[4];
+    Slerp(k0.Rotation, k1.Rotation, s, rotation);
+    result.Forward = Rotate(rotation, Float3{ 0.0f, 0.0f, 1.0f });
+    result.Upward  = Rotate(rotation, Float3{ 0.0f, 1.0f, 0.0f });
+
+    result.FieldOfView = k0.FieldOfView + (k1.FieldOfView - k0.FieldOfView) * s;
+    result.NearClip    = k0.NearClip    + (k1.NearClip    - k0.NearClip)    * s;
+    result.FarClip     = k0.FarClip     + (k1.FarClip     - k0.FarClip)     * s;
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      指定時刻を含む区間の先頭キー番号を二分探索で求めます.
+//-----------------------------------------------------------------------------
+size_t CameraTrack::FindSegment(double time) const
+{
+    if (m_Times.size() <= 1)
+    { return 0; }
+
+    auto itr   = std::upper_bound(m_Times.begin(), m_Times.end(), time);
+    auto index = size_t(itr - m_Times.begin());
+
+    // 区間 [index - 1, index] に収める.
+    return std::min(std::max<size_t>(index, 1), m_Times.size() - 1) - 1;
+}
+
+//-----------------------------------------------------------------------------
+//      キー数を取得します.
+//-----------------------------------------------------------------------------
+size_t CameraTrack::GetKeyCount() const
+{ return m_Keys.size(); }
+
+//-----------------------------------------------------------------------------
+//      先頭キーの時刻を取得します.
+//-----------------------------------------------------------------------------
+double CameraTrack::GetBeginTime() const
+{ return m_Times.empty() ? 0.0 : m_Times.front(); }
+
+//-----------------------------------------------------------------------------
+//      末尾キーの時刻を取得します.
+//-----------------------------------------------------------------------------
+double CameraTrack::GetEndTime() const
+{ return m_Times.empty() ? 0.0 : m_Times.back(); }
+
+} // namespace r3d
@@ -0,0 +1,79 @@
+﻿//-----------------------------------------------------------------------------
+// File : CapacityPlanner.cpp
+// Desc : Chunked Capacity Planner.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <CapacityPlanner.h>
+#include <algorithm>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// CapacityPlanner class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool CapacityPlanner::Init(uint32_t chunkCount, uint32_t maxCount)
+{
+    Term();
+
+    if (chunkCount == 0 || maxCount < chunkCount)
+    { return false; }
+
+    m_ChunkCount = chunkCount;
+    m_MaxCount   = maxCount;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void CapacityPlanner::Term()
+{
+    m_ChunkCount = 0;
+    m_MaxCount   = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      必要な要素数を収める容量を求めます.
+//-----------------------------------------------------------------------------
+bool CapacityPlanner::Plan(uint32_t capacity, uint64_t requiredCount, uint32_t& result) const
+{
+    if (m_ChunkCount == 0 || requiredCount > m_MaxCount)
+    { return false; }
+
+    if (requiredCount <= capacity)
+    {
+        result = capacity;
+        return true;
+    }
+
+    // 1.5倍ずつ伸ばしてコピーの総量を要素数に比例させる.
+    auto grown  = uint64_t(capacity) + capacity / 2;
+    auto target = std::max(grown, requiredCount);
+    target = (target + m_ChunkCount - 1) / m_ChunkCount * m_ChunkCount;
+
+    result = uint32_t(std::min<uint64_t>(target, m_MaxCount));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      チャンクの要素数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t CapacityPlanner::GetChunkCount() const
+{ return m_ChunkCount; }
+
+//-----------------------------------------------------------------------------
+//      最大要素数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t CapacityPlanner::GetMaxCount() const
+{ return m_MaxCount; }
+
+} // namespace r3d
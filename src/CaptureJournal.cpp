@@ -0,0 +1,661 @@
+﻿//-----------------------------------------------------------------------------
+// File : CaptureJournal.cpp
+// Desc : Capture Checkpoint Journal.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <CaptureJournal.h>
+#include <Platform.h>
+#include <xxhash.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t JOURNAL_MAGIC         = 0x4A443352;   // 'R3DJ'
+static const uint32_t JOURNAL_VERSION       = 1;
+static const uint32_t RECORD_OUTPUT         = 1;
+static const uint32_t RECORD_STATE          = 2;
+static const uint32_t MAX_OUTPUT_COUNT      = 8;
+static const uint32_t MAX_PAYLOAD_SIZE      = 64 * 1024;
+static const size_t   OUTPUT_FIXED_SIZE     = 24;
+static const size_t   STATE_PAYLOAD_SIZE    = 32;
+static const size_t   HASH_BUFFER_SIZE      = 1024 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+// JournalHeader structure
+///////////////////////////////////////////////////////////////////////////////
+struct JournalHeader
+{
+    uint32_t    Magic;
+    uint32_t    Version;
+    uint64_t    SequenceHash;
+    uint32_t    FrameCount;
+    uint32_t    OutputCount;
+    uint64_t    Checksum;       //!< 先頭から Checksum の直前までの XXH3.
+};
+static_assert(sizeof(JournalHeader) == 32, "JournalHeader Size Not Matched.");
+
+///////////////////////////////////////////////////////////////////////////////
+// RecordHeader structure
+///////////////////////////////////////////////////////////////////////////////
+struct RecordHeader
+{
+    uint32_t    Type;
+    uint32_t    Size;           //!< 後に続くペイロードのサイズ. ペイロードの後に XXH3 (8byte) が続きます.
+};
+
+//-----------------------------------------------------------------------------
+//      経過時間を秒で取得します.
+//-----------------------------------------------------------------------------
+inline double GetElapsedSec(const std::chrono::steady_clock::time_point& begin)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+//-----------------------------------------------------------------------------
+//      値をバッファに追加します.
+//-----------------------------------------------------------------------------
+template<typename T>
+inline void PushValue(std::vector<uint8_t>& buffer, const T& value)
+{
+    auto offset = buffer.size();
+    buffer.resize(offset + sizeof(T));
+    memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+//-----------------------------------------------------------------------------
+//      値をバッファから読み込みます.
+//-----------------------------------------------------------------------------
+template<typename T>
+inline T ReadValue(const uint8_t* pData, size_t offset)
+{
+    T value;
+    memcpy(&value, pData + offset, sizeof(T));
+    return value;
+}
+
+//-----------------------------------------------------------------------------
+//      レコードのチェックサムを計算します.
+//-----------------------------------------------------------------------------
+uint64_t CalcRecordChecksum(const RecordHeader& header, const uint8_t* pPayload)
+{
+    auto hash = XXH3_64bits(&header, sizeof(header));
+    return XXH3_64bits_withSeed(pPayload, header.Size, hash);
+}
+
+//-----------------------------------------------------------------------------
+//      書き込んだ内容をストレージまで同期します.
+//-----------------------------------------------------------------------------
+bool SyncFile(FILE* pFile)
+{
+    if (fflush(pFile) != 0)
+    { return false; }
+
+#if defined(_WIN32)
+    return _commit(_fileno(pFile)) == 0;
+#else
+    return fsync(fileno(pFile)) == 0;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      レコードを書き込みます.
+//-----------------------------------------------------------------------------
+bool WriteRecord(FILE* pFile, uint32_t type, const std::vector<uint8_t>& payload)
+{
+    RecordHeader header = {};
+    header.Type = type;
+    header.Size = uint32_t(payload.size());
+
+    auto checksum = CalcRecordChecksum(header, payload.data());
+
+    // 途中で中断されても末尾のレコードが壊れるだけになるように1回で書き込む.
+    std::vector<uint8_t> record;
+    record.reserve(sizeof(header) + payload.size() + sizeof(checksum));
+    PushValue(record, header);
+    record.insert(record.end(), payload.begin(), payload.end());
+    PushValue(record, checksum);
+
+    return fwrite(record.data(), 1, record.size(), pFile) == record.size();
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルのサイズとハッシュを計算します.
+//-----------------------------------------------------------------------------
+bool CalcFileHash(const char* path, uint64_t& size, uint64_t& hash)
+{
+    auto pFile = r3d::OpenFile(path, "rb");
+    if (pFile == nullptr)
+    { return false; }
+
+    auto state = XXH3_createState();
+    if (state == nullptr)
+    {
+        fclose(pFile);
+        return false;
+    }
+
+    XXH3_64bits_reset(state);
+
+    std::vector<uint8_t> buffer(HASH_BUFFER_SIZE);
+    size = 0;
+
+    auto result = true;
+    for(;;)
+    {
+        auto readSize = fread(buffer.data(), 1, buffer.size(), pFile);
+        if (readSize > 0)
+        {
+            XXH3_64bits_update(state, buffer.data(), readSize);
+            size += readSize;
+        }
+
+        if (readSize < buffer.size())
+        {
+            result = (ferror(pFile) == 0);
+            break;
+        }
+    }
+
+    hash = XXH3_64bits_digest(state);
+
+    XXH3_freeState(state);
+    fclose(pFile);
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ジャーナルヘッダを作成します.
+//-----------------------------------------------------------------------------
+JournalHeader CreateHeader(uint64_t sequenceHash, uint32_t frameCount, uint32_t outputCount)
+{
+    JournalHeader header = {};
+    header.Magic        = JOURNAL_MAGIC;
+    header.Version      = JOURNAL_VERSION;
+    header.SequenceHash = sequenceHash;
+    header.FrameCount   = frameCount;
+    header.OutputCount  = outputCount;
+    header.Checksum     = XXH3_64bits(&header, offsetof(JournalHeader, Checksum));
+    return header;
+}
+
+//-----------------------------------------------------------------------------
+//      状態のペイロードを作成します.
+//-----------------------------------------------------------------------------
+std::vector<uint8_t> CreateStatePayload(const r3d::CaptureState& state)
+{
+    std::vector<uint8_t> payload;
+    payload.reserve(STATE_PAYLOAD_SIZE);
+    PushValue(payload, state.ElapsedSec);
+    PushValue(payload, state.FrameTimeSec);
+    PushValue(payload, state.CaptureIndex);
+    PushValue(payload, state.RenderFrameCount);
+    PushValue(payload, state.JitterIndex);
+    PushValue(payload, uint32_t(0));
+    return payload;
+}
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// CaptureJournal class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+CaptureJournal::~CaptureJournal()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool CaptureJournal::Init(const CaptureJournalDesc& desc)
+{
+    if (desc.FrameCount == 0 || desc.OutputCount == 0 || desc.OutputCount > MAX_OUTPUT_COUNT)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    Term();
+
+    m_FrameCount   = desc.FrameCount;
+    m_OutputCount  = desc.OutputCount;
+    m_CompleteMask = uint8_t((1u << desc.OutputCount) - 1);
+    m_OutputMasks.resize(desc.FrameCount, 0);
+
+    if (desc.Path == nullptr)
+    { return true; }
+
+    auto begin = std::chrono::steady_clock::now();
+
+    // 以前のセッションの記録を読み込み, 出力ファイルを検証.
+    std::vector<Output> outputs;
+    if (Load(desc.Path, desc.SequenceHash, outputs))
+    {
+        std::vector<uint8_t> recorded(desc.FrameCount, 0);
+        std::vector<Output>  verified;
+
+        for(auto& output : outputs)
+        {
+            auto bit = uint8_t(1u << output.Slot);
+            recorded[output.FrameIndex] |= bit;
+
+            uint64_t size = 0;
+            uint64_t hash = 0;
+            if (!CalcFileHash(output.Path.c_str(), size, hash) || size != output.Size || hash != output.Hash)
+            {
+                ILOGA("Info : Journal output mismatch. frame = %u, path = %s", output.FrameIndex, output.Path.c_str());
+                continue;
+            }
+
+            // 同じ出力を上書きした場合は後の記録を採用する.
+            auto itr = std::find_if(verified.begin(), verified.end(), [&](const Output& item)
+                { return item.FrameIndex == output.FrameIndex && item.Slot == output.Slot; });
+            if (itr != verified.end())
+            { verified.erase(itr); }
+
+            verified.push_back(output);
+            m_OutputMasks[output.FrameIndex] |= bit;
+        }
+
+        for(auto i=0u; i<desc.FrameCount; ++i)
+        {
+            if (m_OutputMasks[i] == m_CompleteMask)
+            { m_Stats.ResumedCount++; }
+            else if (recorded[i] == m_CompleteMask)
+            { m_Stats.RejectedCount++; }
+        }
+        m_Stats.CompletedCount = m_Stats.ResumedCount;
+
+        outputs.swap(verified);
+    }
+    else
+    {
+        outputs.clear();
+        m_Resumed     = false;
+        m_ResumeState = {};
+    }
+
+    // 有効な記録だけでジャーナルを書き直してから追記を始める.
+    if (!Rewrite(desc.Path, desc.SequenceHash, outputs))
+    {
+        ELOGA("Error : Journal Rewrite Failed. path = %s", desc.Path);
+        Term();
+        return false;
+    }
+
+    m_pFile = OpenFile(desc.Path, "ab");
+    if (m_pFile == nullptr)
+    {
+        ELOGA("Error : Journal Open Failed. path = %s", desc.Path);
+        Term();
+        return false;
+    }
+
+    m_Path = desc.Path;
+
+    m_Stats.VerifySec = GetElapsedSec(begin);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void CaptureJournal::Term()
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    if (m_pFile != nullptr)
+    {
+        fclose(m_pFile);
+        m_pFile = nullptr;
+
+        // 描き終えたシーケンスの記録を残すと, 次の実行が何も描かずに終了してしまう.
+        if (m_FrameCount > 0 && m_Stats.CompletedCount == m_FrameCount)
+        {
+            if (remove(m_Path.c_str()) == 0)
+            { ILOGA("Info : All frames completed, journal removed. path = %s", m_Path.c_str()); }
+            else
+            { ELOGA("Error : Journal Remove Failed. path = %s", m_Path.c_str()); }
+        }
+    }
+
+    m_Path.clear();
+    m_OutputMasks.clear();
+    m_OutputMasks.shrink_to_fit();
+
+    m_FrameCount   = 0;
+    m_OutputCount  = 0;
+    m_CompleteMask = 0;
+    m_Resumed      = false;
+    m_ResumeState  = {};
+    m_Stats        = {};
+}
+
+//-----------------------------------------------------------------------------
+//      全ての出力ファイルを書き終えたフレームかどうか.
+//-----------------------------------------------------------------------------
+bool CaptureJournal::IsCompleted(uint32_t frameIndex) const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (frameIndex >= m_FrameCount)
+    { return false; }
+
+    return m_OutputMasks[frameIndex] == m_CompleteMask;
+}
+
+//-----------------------------------------------------------------------------
+//      未完了のフレームを検索します.
+//-----------------------------------------------------------------------------
+uint32_t CaptureJournal::FindPending(uint32_t frameIndex) const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    auto i = frameIndex;
+    for(; i<m_FrameCount; ++i)
+    {
+        if (m_OutputMasks[i] != m_CompleteMask)
+        { break; }
+    }
+    return std::min(i, m_FrameCount);
+}
+
+//-----------------------------------------------------------------------------
+//      未完了のフレーム数を数えます.
+//-----------------------------------------------------------------------------
+uint32_t CaptureJournal::CountPending(uint32_t frameIndex) const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    auto count = 0u;
+    for(auto i=frameIndex; i<m_FrameCount; ++i)
+    {
+        if (m_OutputMasks[i] != m_CompleteMask)
+        { count++; }
+    }
+    return count;
+}
+
+//-----------------------------------------------------------------------------
+//      出力ファイルの書き込みが完了したことを記録します.
+//-----------------------------------------------------------------------------
+bool CaptureJournal::AddOutput
+(
+    uint32_t    frameIndex,
+    uint32_t    slot,
+    const char* path,
+    uint64_t    size,
+    uint64_t    hash
+)
+{
+    if (path == nullptr || frameIndex >= m_FrameCount || slot >= m_OutputCount)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    auto pathLength = strlen(path);
+    if (OUTPUT_FIXED_SIZE + pathLength > MAX_PAYLOAD_SIZE)
+    {
+        ELOGA("Error : Path Too Long. path = %s", path);
+        return false;
+    }
+
+    std::vector<uint8_t> payload;
+    payload.reserve(OUTPUT_FIXED_SIZE + pathLength);
+    PushValue(payload, frameIndex);
+    PushValue(payload, slot);
+    PushValue(payload, size);
+    PushValue(payload, hash);
+    payload.insert(payload.end(), path, path + pathLength);
+
+    std::lock_guard<std::mutex> locker(m_Mutex);
+
+    // ファイルに記録してから完了扱いにする.
+    if (!Append(RECORD_OUTPUT, payload))
+    { return false; }
+
+    auto prev = m_OutputMasks[frameIndex];
+    m_OutputMasks[frameIndex] |= uint8_t(1u << slot);
+    if (prev != m_CompleteMask && m_OutputMasks[frameIndex] == m_CompleteMask)
+    { m_Stats.CompletedCount++; }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      書き込み済みのファイルを読み込んで記録します.
+//-----------------------------------------------------------------------------
+bool CaptureJournal::AddOutputFile(uint32_t frameIndex, uint32_t slot, const char* path)
+{
+    if (path == nullptr)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    uint64_t size = 0;
+    uint64_t hash = 0;
+    if (!CalcFileHash(path, size, hash))
+    {
+        ELOGA("Error : File Read Failed. path = %s", path);
+        return false;
+    }
+
+    return AddOutput(frameIndex, slot, path, size, hash);
+}
+
+//-----------------------------------------------------------------------------
+//      描画の状態を記録します.
+//-----------------------------------------------------------------------------
+bool CaptureJournal::SaveState(const CaptureState& state)
+{
+    auto payload = CreateStatePayload(state);
+
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return Append(RECORD_STATE, payload);
+}
+
+//-----------------------------------------------------------------------------
+//      統計情報を取得します.
+//-----------------------------------------------------------------------------
+CaptureJournalStats CaptureJournal::GetStats() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return m_Stats;
+}
+
+//-----------------------------------------------------------------------------
+//      ジャーナルを読み込みます.
+//-----------------------------------------------------------------------------
+bool CaptureJournal::Load(const char* path, uint64_t sequenceHash, std::vector<Output>& outputs)
+{
+    auto pFile = OpenFile(path, "rb");
+    if (pFile == nullptr)
+    { return false; }
+
+    JournalHeader header = {};
+    auto expected = CreateHeader(sequenceHash, m_FrameCount, m_OutputCount);
+    if (fread(&header, sizeof(header), 1, pFile) != 1 || memcmp(&header, &expected, sizeof(header)) != 0)
+    {
+        ILOGA("Info : Journal does not match current settings, started from the beginning. path = %s", path);
+        fclose(pFile);
+        return false;
+    }
+
+    std::vector<uint8_t> payload;
+    auto recordCount = 0u;
+
+    for(;;)
+    {
+        RecordHeader record = {};
+        if (fread(&record, sizeof(record), 1, pFile) != 1)
+        { break; }
+
+        if (record.Size > MAX_PAYLOAD_SIZE)
+        { break; }
+
+        payload.resize(record.Size);
+        uint64_t checksum = 0;
+        if (record.Size > 0 && fread(payload.data(), record.Size, 1, pFile) != 1)
+        { break; }
+        if (fread(&checksum, sizeof(checksum), 1, pFile) != 1)
+        { break; }
+
+        // 書きかけのレコード以降は捨てる.
+        if (checksum != CalcRecordChecksum(record, payload.data()))
+        { break; }
+
+        if (record.Type == RECORD_OUTPUT && record.Size >= OUTPUT_FIXED_SIZE)
+        {
+            Output output;
+            output.FrameIndex = ReadValue<uint32_t>(payload.data(), 0);
+            output.Slot       = ReadValue<uint32_t>(payload.data(), 4);
+            output.Size       = ReadValue<uint64_t>(payload.data(), 8);
+            output.Hash       = ReadValue<uint64_t>(payload.data(), 16);
+            output.Path.assign(
+                reinterpret_cast<const char*>(payload.data()) + OUTPUT_FIXED_SIZE,
+                record.Size - OUTPUT_FIXED_SIZE);
+
+            if (output.FrameIndex < m_FrameCount && output.Slot < m_OutputCount)
+            { outputs.push_back(output); }
+        }
+        else if (record.Type == RECORD_STATE && record.Size == STATE_PAYLOAD_SIZE)
+        {
+            m_ResumeState.ElapsedSec       = ReadValue<double>  (payload.data(), 0);
+            m_ResumeState.FrameTimeSec     = ReadValue<double>  (payload.data(), 8);
+            m_ResumeState.CaptureIndex     = ReadValue<uint32_t>(payload.data(), 16);
+            m_ResumeState.RenderFrameCount = ReadValue<uint32_t>(payload.data(), 20);
+            m_ResumeState.JitterIndex      = ReadValue<uint32_t>(payload.data(), 24);
+            m_Resumed = true;
+        }
+
+        recordCount++;
+    }
+
+    fclose(pFile);
+
+    ILOGA("Info : Journal loaded. path = %s, records = %u", path, recordCount);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      有効な記録だけでジャーナルを書き直します.
+//-----------------------------------------------------------------------------
+bool CaptureJournal::Rewrite(const char* path, uint64_t sequenceHash, const std::vector<Output>& outputs)
+{
+    std::string tempPath = path;
+    tempPath += ".tmp";
+
+    auto pFile = OpenFile(tempPath.c_str(), "wb");
+    if (pFile == nullptr)
+    { return false; }
+
+    auto header = CreateHeader(sequenceHash, m_FrameCount, m_OutputCount);
+    auto result = fwrite(&header, sizeof(header), 1, pFile) == 1;
+
+    for(auto& output : outputs)
+    {
+        if (!result)
+        { break; }
+
+        std::vector<uint8_t> payload;
+        payload.reserve(OUTPUT_FIXED_SIZE + output.Path.size());
+        PushValue(payload, output.FrameIndex);
+        PushValue(payload, output.Slot);
+        PushValue(payload, output.Size);
+        PushValue(payload, output.Hash);
+        payload.insert(payload.end(), output.Path.begin(), output.Path.end());
+
+        result = WriteRecord(pFile, RECORD_OUTPUT, payload);
+    }
+
+    if (result && m_Resumed)
+    { result = WriteRecord(pFile, RECORD_STATE, CreateStatePayload(m_ResumeState)); }
+
+    if (result)
+    { result = SyncFile(pFile); }
+
+    fclose(pFile);
+
+    if (!result)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+
+#if defined(_WIN32)
+    // Windows の rename は既存のファイルを置き換えないので先に削除する.
+    remove(path);
+#endif
+    if (rename(tempPath.c_str(), path) != 0)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      レコードを追記します (m_Mutex をロックして呼び出します).
+//-----------------------------------------------------------------------------
+bool CaptureJournal::Append(uint32_t type, const std::vector<uint8_t>& payload)
+{
+    if (m_pFile == nullptr)
+    { return true; }
+
+    if (!WriteRecord(m_pFile, type, payload) || !SyncFile(m_pFile))
+    {
+        m_Stats.FailCount++;
+        ELOGA("Error : Journal Write Failed.");
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      描画の締め切りを計算します.
+//-----------------------------------------------------------------------------
+double CalcRenderDeadline(double totalSec, double elapsedSec, uint32_t pendingCount, double minFrameSec)
+{
+    auto required = elapsedSec + double(pendingCount) * std::max(minFrameSec, 0.0);
+    return std::max(totalSec, required);
+}
+
+//-----------------------------------------------------------------------------
+//      残り時間を未完了のフレームに割り振ります.
+//-----------------------------------------------------------------------------
+double CalcFrameTimeBudget(double deadlineSec, double elapsedSec, uint32_t pendingCount)
+{
+    auto remain = std::max(deadlineSec - elapsedSec, 0.0);
+    if (pendingCount == 0)
+    { return remain; }
+
+    return remain / double(pendingCount);
+}
+
+} // namespace r3d
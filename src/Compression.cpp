@@ -0,0 +1,236 @@
+﻿//-----------------------------------------------------------------------------
+// File : Compression.cpp
+// Desc : Block Compression.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <Compression.h>
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const size_t     LZ4_MIN_MATCH       = 4;
+static const size_t     LZ4_LAST_LITERALS   = 5;    // 末尾5バイトは必ずリテラル.
+static const size_t     LZ4_MF_LIMIT        = 12;   // 最後のマッチは末尾から12バイト以上前に開始する.
+static const size_t     LZ4_MAX_OFFSET      = 65535;
+static const uint32_t   LZ4_HASH_LOG        = 16;
+static const uint32_t   LZ4_SKIP_TRIGGER    = 6;
+
+//-----------------------------------------------------------------------------
+//      32bit値を読み込みます.
+//-----------------------------------------------------------------------------
+inline uint32_t Read32(const uint8_t* ptr)
+{
+    uint32_t result;
+    memcpy(&result, ptr, sizeof(result));
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ハッシュ値を計算します.
+//-----------------------------------------------------------------------------
+inline uint32_t HashLZ4(uint32_t value)
+{ return (value * 2654435761u) >> (32 - LZ4_HASH_LOG); }
+
+//-----------------------------------------------------------------------------
+//      長さを出力します.
+//-----------------------------------------------------------------------------
+inline void WriteLength(std::vector<uint8_t>& result, size_t length)
+{
+    while(length >= 255)
+    {
+        result.push_back(255);
+        length -= 255;
+    }
+    result.push_back(uint8_t(length));
+}
+
+//-----------------------------------------------------------------------------
+//      シーケンスを出力します. matchLength が 0 の場合は最終シーケンスです.
+//-----------------------------------------------------------------------------
+void WriteSequence
+(
+    std::vector<uint8_t>&   result,
+    const uint8_t*          literals,
+    size_t                  literalLength,
+    size_t                  offset,
+    size_t                  matchLength
+)
+{
+    auto token = uint8_t(std::min<size_t>(literalLength, 15) << 4);
+    if (matchLength > 0)
+    { token |= uint8_t(std::min<size_t>(matchLength - LZ4_MIN_MATCH, 15)); }
+
+    result.push_back(token);
+
+    if (literalLength >= 15)
+    { WriteLength(result, literalLength - 15); }
+
+    result.insert(result.end(), literals, literals + literalLength);
+
+    if (matchLength == 0)
+    { return; }
+
+    result.push_back(uint8_t(offset & 0xff));
+    result.push_back(uint8_t(offset >> 8));
+
+    if (matchLength - LZ4_MIN_MATCH >= 15)
+    { WriteLength(result, matchLength - LZ4_MIN_MATCH - 15); }
+}
+
+//-----------------------------------------------------------------------------
+//      可変長の長さを読み込みます.
+//-----------------------------------------------------------------------------
+inline bool ReadLength(const uint8_t*& ptr, const uint8_t* end, size_t& length)
+{
+    uint8_t value = 0;
+    do
+    {
+        if (ptr >= end)
+        { return false; }
+
+        value   = *ptr++;
+        length += value;
+    }
+    while(value == 255);
+
+    return true;
+}
+
+} // namespace
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//      LZ4 ブロック形式で圧縮します.
+//-----------------------------------------------------------------------------
+void CompressLZ4(const uint8_t* src, size_t srcSize, std::vector<uint8_t>& result)
+{
+    result.clear();
+    result.reserve(srcSize + srcSize / 255 + 16);
+
+    if (srcSize <= LZ4_MF_LIMIT)
+    {
+        WriteSequence(result, src, srcSize, 0, 0);
+        return;
+    }
+
+    std::vector<uint32_t> table(size_t(1) << LZ4_HASH_LOG, UINT32_MAX);
+
+    auto matchLimit = srcSize - LZ4_LAST_LITERALS;
+    auto mfLimit    = srcSize - LZ4_MF_LIMIT;
+
+    size_t anchor = 0;
+    size_t pos    = 0;
+    uint32_t searchCount = 1u << LZ4_SKIP_TRIGGER;
+
+    while(pos <= mfLimit)
+    {
+        auto sequence = Read32(src + pos);
+        auto hash     = HashLZ4(sequence);
+        auto candidate = table[hash];
+        table[hash] = uint32_t(pos);
+
+        if (candidate == UINT32_MAX
+         || pos - candidate > LZ4_MAX_OFFSET
+         || Read32(src + candidate) != sequence)
+        {
+            // マッチしない区間が続く場合は探索間隔を広げる.
+            pos += (searchCount++ >> LZ4_SKIP_TRIGGER);
+            continue;
+        }
+
+        size_t match  = candidate;
+        size_t length = LZ4_MIN_MATCH;
+        while(pos + length < matchLimit && src[match + length] == src[pos + length])
+        { length++; }
+
+        // 後方に延長.
+        while(pos > anchor && match > 0 && src[pos - 1] == src[match - 1])
+        {
+            pos--;
+            match--;
+            length++;
+        }
+
+        WriteSequence(result, src + anchor, pos - anchor, pos - match, length);
+
+        pos   += length;
+        anchor = pos;
+        searchCount = 1u << LZ4_SKIP_TRIGGER;
+    }
+
+    WriteSequence(result, src + anchor, srcSize - anchor, 0, 0);
+}
+
+//-----------------------------------------------------------------------------
+//      LZ4 ブロック形式のデータを展開します.
+//-----------------------------------------------------------------------------
+bool DecompressLZ4(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    auto ip   = src;
+    auto iend = src + srcSize;
+    auto op   = dst;
+    auto oend = dst + dstSize;
+
+    for(;;)
+    {
+        if (ip >= iend)
+        { return false; }
+
+        auto token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(ip, iend, literalLength))
+        { return false; }
+
+        if (literalLength > size_t(iend - ip) || literalLength > size_t(oend - op))
+        { return false; }
+
+        memcpy(op, ip, literalLength);
+        op += literalLength;
+        ip += literalLength;
+
+        // 最終シーケンス.
+        if (ip == iend)
+        { return op == oend; }
+
+        if (iend - ip < 2)
+        { return false; }
+
+        auto offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+        ip += 2;
+
+        if (offset == 0 || offset > size_t(op - dst))
+        { return false; }
+
+        size_t matchLength = token & 0xf;
+        if (matchLength == 15 && !ReadLength(ip, iend, matchLength))
+        { return false; }
+
+        matchLength += LZ4_MIN_MATCH;
+        if (matchLength > size_t(oend - op))
+        { return false; }
+
+        // 重なりがある場合は周期分ずつ倍々にコピーする.
+        auto match = op - offset;
+        while(matchLength > 0)
+        {
+            auto count = std::min(size_t(op - match), matchLength);
+            memcpy(op, match, count);
+            op          += count;
+            matchLength -= count;
+        }
+    }
+}
+
+} // namespace r3d
@@ -0,0 +1,1128 @@
+﻿//-----------------------------------------------------------------------------
+// File : Deflate.cpp
+// Desc : Fast Deflate Compressor / Decompressor.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <Deflate.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t MIN_MATCH         = 4;
+static const uint32_t MAX_MATCH         = 258;
+static const uint32_t MAX_STORED        = 65535;
+static const uint32_t LITLEN_COUNT      = 286;
+static const uint32_t DIST_COUNT        = 30;
+static const uint32_t CODELEN_COUNT     = 19;
+static const uint32_t MAX_CODE_BITS     = 15;
+static const uint32_t MAX_CODELEN_BITS  = 7;
+static const uint32_t END_OF_BLOCK      = 256;
+static const uint32_t ADLER_BASE        = 65521;
+static const uint32_t MAX_MATCH_DIST    = 32768;
+static const uint32_t FIXED_LITLEN_COUNT= 288;
+static const uint32_t FAST_BITS         = 10;       // 復号テーブルで一度に引くビット数.
+static const uint32_t MAX_COPY_SLACK    = 8;        // 一致のコピーで一度に書き込むバイト数.
+
+static const uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static const uint8_t CODELEN_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Tables structure
+///////////////////////////////////////////////////////////////////////////////
+struct Tables
+{
+    uint8_t     LengthCode[256];        //!< 一致長 - 3 から長さ符号 - 257.
+    uint8_t     DistCodeSmall[256];     //!< 距離 - 1 (256 未満) から距離符号.
+    uint8_t     DistCodeLarge[256];     //!< (距離 - 1) >> 7 から距離符号.
+
+    Tables()
+    {
+        // 258 は符号 284 でも表せるが，規格上は符号 285 を使うので後から上書きする.
+        for(auto code=0u; code<29; ++code)
+        {
+            auto count = 1u << LENGTH_EXTRA[code];
+            for(auto i=0u; i<count && LENGTH_BASE[code] + i <= MAX_MATCH; ++i)
+            { LengthCode[LENGTH_BASE[code] + i - 3] = uint8_t(code); }
+        }
+
+        for(auto code=0u; code<30; ++code)
+        {
+            auto count = 1u << DIST_EXTRA[code];
+            for(auto i=0u; i<count; ++i)
+            {
+                auto dist = DIST_BASE[code] + i - 1;
+                if (dist < 256)
+                { DistCodeSmall[dist] = uint8_t(code); }
+                else
+                { DistCodeLarge[dist >> 7] = uint8_t(code); }
+            }
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+//      テーブルを取得します.
+//-----------------------------------------------------------------------------
+const Tables& GetTables()
+{
+    static const Tables s_Tables;
+    return s_Tables;
+}
+
+//-----------------------------------------------------------------------------
+//      距離符号を求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t GetDistCode(const Tables& tables, uint32_t dist)
+{
+    auto d = dist - 1;
+    return (d < 256) ? tables.DistCodeSmall[d] : tables.DistCodeLarge[d >> 7];
+}
+
+//-----------------------------------------------------------------------------
+//      32bit値を読み込みます.
+//-----------------------------------------------------------------------------
+inline uint32_t Load32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+//-----------------------------------------------------------------------------
+//      一致長を求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t MatchLength(const uint8_t* a, const uint8_t* b, uint32_t maxLength)
+{
+    uint32_t length = 0;
+    while(length + 8 <= maxLength)
+    {
+        uint64_t x, y;
+        memcpy(&x, a + length, sizeof(x));
+        memcpy(&y, b + length, sizeof(y));
+        auto diff = x ^ y;
+        if (diff != 0)
+        {
+        #if defined(_MSC_VER)
+            unsigned long index = 0;
+            _BitScanForward64(&index, diff);
+            return length + uint32_t(index >> 3);
+        #else
+            return length + uint32_t(__builtin_ctzll(diff) >> 3);
+        #endif
+        }
+        length += 8;
+    }
+
+    while(length < maxLength && a[length] == b[length])
+    { length++; }
+
+    return length;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SymbolFreq structure
+///////////////////////////////////////////////////////////////////////////////
+struct SymbolFreq
+{
+    uint32_t    Key;        //!< 頻度. 計算後は符号長.
+    uint32_t    Symbol;
+};
+
+//-----------------------------------------------------------------------------
+//      最大符号長に制限したハフマン符号長を求めます.
+//-----------------------------------------------------------------------------
+void BuildCodeLengths(const uint32_t* pFreq, uint32_t count, uint32_t maxBits, uint8_t* pLengths)
+{
+    SymbolFreq syms[LITLEN_COUNT];
+    uint32_t   used = 0;
+
+    memset(pLengths, 0, count);
+    for(auto i=0u; i<count; ++i)
+    {
+        if (pFreq[i] != 0)
+        { syms[used++] = { pFreq[i], i }; }
+    }
+
+    // 符号が1つ以下だと完全な符号にならないので補う.
+    for(auto i=0u; used < 2 && i < count; ++i)
+    {
+        if (pFreq[i] == 0)
+        { syms[used++] = { 1, i }; }
+    }
+
+    std::sort(syms, syms + used, [](const SymbolFreq& lhs, const SymbolFreq& rhs)
+    { return lhs.Key < rhs.Key; });
+
+    // [Moffat 1995] In-Place Calculation of Minimum-Redundancy Codes.
+    {
+        auto A = syms;
+        auto n = int(used);
+        A[0].Key += A[1].Key;
+        int root = 0;
+        int leaf = 2;
+        for(auto next=1; next<n - 1; ++next)
+        {
+            if (leaf >= n || A[root].Key < A[leaf].Key)
+            { A[next].Key = A[root].Key; A[root++].Key = uint32_t(next); }
+            else
+            { A[next].Key = A[leaf++].Key; }
+
+            if (leaf >= n || (root < next && A[root].Key < A[leaf].Key))
+            { A[next].Key += A[root].Key; A[root++].Key = uint32_t(next); }
+            else
+            { A[next].Key += A[leaf++].Key; }
+        }
+
+        A[n - 2].Key = 0;
+        for(auto next=n - 3; next>=0; --next)
+        { A[next].Key = A[A[next].Key].Key + 1; }
+
+        int avbl = 1;
+        int busy = 0;
+        int dpth = 0;
+        root = n - 2;
+        auto next = n - 1;
+        while(avbl > 0)
+        {
+            while(root >= 0 && int(A[root].Key) == dpth)
+            { busy++; root--; }
+            while(avbl > busy)
+            { A[next--].Key = uint32_t(dpth); avbl--; }
+            avbl = 2 * busy;
+            dpth++;
+            busy = 0;
+        }
+    }
+
+    // 最大符号長を超えた分をクラフトの不等式を満たすように詰め直す.
+    uint32_t numCodes[33] = {};
+    for(auto i=0u; i<used; ++i)
+    { numCodes[std::min(syms[i].Key, 32u)]++; }
+
+    for(auto i=maxBits + 1; i<=32; ++i)
+    { numCodes[maxBits] += numCodes[i]; }
+
+    uint32_t total = 0;
+    for(auto i=maxBits; i>0; --i)
+    { total += numCodes[i] << (maxBits - i); }
+
+    while(total != (1u << maxBits))
+    {
+        numCodes[maxBits]--;
+        for(auto i=maxBits - 1; i>0; --i)
+        {
+            if (numCodes[i] != 0)
+            {
+                numCodes[i]--;
+                numCodes[i + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    // 頻度の高い記号から短い符号を割り当てる.
+    auto j = used;
+    for(auto bits=1u; bits<=maxBits; ++bits)
+    {
+        for(auto k=numCodes[bits]; k>0; --k)
+        { pLengths[syms[--j].Symbol] = uint8_t(bits); }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      符号長から正規ハフマン符号を求めます (ビット反転済み).
+//-----------------------------------------------------------------------------
+void BuildCodes(const uint8_t* pLengths, uint32_t count, uint16_t* pCodes)
+{
+    uint32_t numCodes[MAX_CODE_BITS + 1] = {};
+    for(auto i=0u; i<count; ++i)
+    { numCodes[pLengths[i]]++; }
+    numCodes[0] = 0;
+
+    uint32_t nextCode[MAX_CODE_BITS + 1] = {};
+    for(auto bits=1u; bits<=MAX_CODE_BITS; ++bits)
+    { nextCode[bits] = (nextCode[bits - 1] + numCodes[bits - 1]) << 1; }
+
+    for(auto i=0u; i<count; ++i)
+    {
+        auto length = pLengths[i];
+        if (length == 0)
+        { pCodes[i] = 0; continue; }
+
+        // Deflate は下位ビットから詰めるので反転しておく.
+        auto code     = nextCode[length]++;
+        uint32_t rev  = 0;
+        for(auto k=0u; k<length; ++k)
+        { rev = (rev << 1) | ((code >> k) & 1); }
+        pCodes[i] = uint16_t(rev);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// BitWriter structure
+///////////////////////////////////////////////////////////////////////////////
+struct BitWriter
+{
+    uint8_t*    pDst;
+    uint64_t    Bits;
+    uint32_t    Count;
+
+    void Put(uint32_t value, uint32_t count)
+    {
+        Bits  |= uint64_t(value) << Count;
+        Count += count;
+        if (Count >= 32)
+        {
+            pDst[0] = uint8_t(Bits);
+            pDst[1] = uint8_t(Bits >> 8);
+            pDst[2] = uint8_t(Bits >> 16);
+            pDst[3] = uint8_t(Bits >> 24);
+            pDst  += 4;
+            Bits  >>= 32;
+            Count -= 32;
+        }
+    }
+
+    void Align()
+    {
+        while(Count > 0)
+        {
+            *pDst++ = uint8_t(Bits);
+            Bits  >>= 8;
+            Count   = (Count > 8) ? Count - 8 : 0;
+        }
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Match structure
+///////////////////////////////////////////////////////////////////////////////
+struct Match
+{
+    uint32_t    Pos;        //!< 一致の開始位置.
+    uint32_t    Length;     //!< 一致長.
+};
+
+//-----------------------------------------------------------------------------
+//      スレッドごとの一致の一覧を取得します.
+//-----------------------------------------------------------------------------
+std::vector<Match>& GetMatches()
+{
+    static thread_local std::vector<Match> s_Matches;
+    return s_Matches;
+}
+
+//-----------------------------------------------------------------------------
+//      リテラルを出力します.
+//-----------------------------------------------------------------------------
+inline void PutLiterals
+(
+    BitWriter&      writer,
+    const uint8_t*  pSrc,
+    uint32_t        count,
+    const uint16_t* pCodes,
+    const uint8_t*  pLengths
+)
+{
+    // 符号長は最大15bitなので2つずつまとめて書き込める.
+    for(; count >= 2; count -= 2, pSrc += 2)
+    {
+        auto l0 = pLengths[pSrc[0]];
+        auto l1 = pLengths[pSrc[1]];
+        writer.Put(pCodes[pSrc[0]] | (uint32_t(pCodes[pSrc[1]]) << l0), l0 + l1);
+    }
+
+    if (count > 0)
+    { writer.Put(pCodes[pSrc[0]], pLengths[pSrc[0]]); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// BitReader structure
+///////////////////////////////////////////////////////////////////////////////
+struct BitReader
+{
+    const uint8_t*  pCur;
+    const uint8_t*  pEnd;
+    uint64_t        Bits;
+    uint32_t        Count;
+    uint32_t        Overrun;    //!< 終端を超えて 0 で補ったバイト数.
+
+    void Refill()
+    {
+        while(Count <= 56)
+        {
+            uint64_t value = 0;
+            if (pCur < pEnd)
+            { value = *pCur++; }
+            else
+            { Overrun++; }
+
+            Bits  |= value << Count;
+            Count += 8;
+        }
+    }
+
+    uint32_t Peek(uint32_t count)
+    {
+        if (Count < count)
+        { Refill(); }
+        return uint32_t(Bits & ((uint64_t(1) << count) - 1));
+    }
+
+    void Skip(uint32_t count)
+    {
+        Bits  >>= count;
+        Count -= count;
+    }
+
+    uint32_t Get(uint32_t count)
+    {
+        if (count == 0)
+        { return 0; }
+
+        auto value = Peek(count);
+        Skip(count);
+        return value;
+    }
+
+    // バイト境界に揃え, 先読みしたバイトを戻します.
+    void Rewind()
+    {
+        Skip(Count & 7);
+
+        auto bytes = Count / 8;
+        auto back  = (bytes > Overrun) ? bytes - Overrun : 0;
+        Overrun    = (bytes > Overrun) ? 0 : Overrun - bytes;
+        pCur      -= back;
+        Bits       = 0;
+        Count      = 0;
+    }
+
+    // 0 で補ったビットを消費していれば true.
+    bool IsOverrun() const
+    { return Overrun * 8 > Count; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Decoder structure
+///////////////////////////////////////////////////////////////////////////////
+struct Decoder
+{
+    uint16_t    Fast[1 << FAST_BITS];           //!< 先頭 FAST_BITS ビットから (シンボル << 4) | 符号長. 0 は長い符号.
+    uint16_t    Count[MAX_CODE_BITS + 1];       //!< 符号長ごとのシンボル数.
+    uint16_t    Symbol[FIXED_LITLEN_COUNT];     //!< 正規符号順のシンボル.
+};
+
+//-----------------------------------------------------------------------------
+//      符号長から復号テーブルを構築します.
+//-----------------------------------------------------------------------------
+bool BuildDecoder(const uint8_t* pLengths, uint32_t count, Decoder& decoder)
+{
+    memset(decoder.Count, 0, sizeof(decoder.Count));
+    for(auto i=0u; i<count; ++i)
+    { decoder.Count[pLengths[i]]++; }
+    decoder.Count[0] = 0;
+
+    // 符号が多すぎる場合は不正. 足りない場合は距離符号が1つだけの場合などがあるので許容する.
+    auto left = 1;
+    for(auto len=1u; len<=MAX_CODE_BITS; ++len)
+    {
+        left = (left << 1) - decoder.Count[len];
+        if (left < 0)
+        { return false; }
+    }
+
+    uint16_t offsets[MAX_CODE_BITS + 1] = {};
+    uint32_t nextCode[MAX_CODE_BITS + 1] = {};
+    for(auto len=1u; len<MAX_CODE_BITS; ++len)
+    {
+        offsets [len + 1] = uint16_t(offsets[len] + decoder.Count[len]);
+        nextCode[len + 1] = (nextCode[len] + decoder.Count[len]) << 1;
+    }
+
+    memset(decoder.Fast, 0, sizeof(decoder.Fast));
+    for(auto i=0u; i<count; ++i)
+    {
+        auto len = pLengths[i];
+        if (len == 0)
+        { continue; }
+
+        decoder.Symbol[offsets[len]++] = uint16_t(i);
+
+        auto code = nextCode[len]++;
+        if (len > FAST_BITS)
+        { continue; }
+
+        // ビット列は LSB から並ぶので符号を反転して引く.
+        auto rev = 0u;
+        for(auto k=0u; k<len; ++k)
+        { rev = (rev << 1) | ((code >> k) & 1); }
+
+        for(auto j=rev; j<(1u << FAST_BITS); j+=(1u << len))
+        { decoder.Fast[j] = uint16_t((i << 4) | len); }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      シンボルを1つ復号します.
+//-----------------------------------------------------------------------------
+inline int DecodeSymbol(BitReader& reader, const Decoder& decoder)
+{
+    auto entry = decoder.Fast[reader.Peek(FAST_BITS)];
+    if (entry != 0)
+    {
+        reader.Skip(entry & 0xF);
+        return entry >> 4;
+    }
+
+    // 長い符号は1ビットずつ正規符号を辿る.
+    auto code  = 0;
+    auto first = 0;
+    auto index = 0;
+    for(auto len=1u; len<=MAX_CODE_BITS; ++len)
+    {
+        code |= int(reader.Get(1));
+        auto count = int(decoder.Count[len]);
+        if (code - count < first)
+        { return decoder.Symbol[index + (code - first)]; }
+
+        index += count;
+        first  = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+//-----------------------------------------------------------------------------
+//      固定ハフマン符号の復号テーブルを取得します.
+//-----------------------------------------------------------------------------
+void GetFixedDecoders(const Decoder*& pLitLen, const Decoder*& pDist)
+{
+    struct FixedDecoders
+    {
+        Decoder LitLen;
+        Decoder Dist;
+
+        FixedDecoders()
+        {
+            uint8_t lengths[FIXED_LITLEN_COUNT];
+            for(auto i=0u; i<FIXED_LITLEN_COUNT; ++i)
+            { lengths[i] = (i < 144) ? 8 : (i < 256) ? 9 : (i < 280) ? 7 : 8; }
+            BuildDecoder(lengths, FIXED_LITLEN_COUNT, LitLen);
+
+            for(auto i=0u; i<DIST_COUNT; ++i)
+            { lengths[i] = 5; }
+            BuildDecoder(lengths, DIST_COUNT, Dist);
+        }
+    };
+
+    static const FixedDecoders s_Fixed;
+    pLitLen = &s_Fixed.LitLen;
+    pDist   = &s_Fixed.Dist;
+}
+
+//-----------------------------------------------------------------------------
+//      動的ハフマン符号の符号長を読み込み, 復号テーブルを構築します.
+//-----------------------------------------------------------------------------
+bool ReadDynamicDecoders(BitReader& reader, Decoder& litlen, Decoder& dist)
+{
+    auto litlenCount  = reader.Get(5) + 257;
+    auto distCount    = reader.Get(5) + 1;
+    auto codelenCount = reader.Get(4) + 4;
+    if (litlenCount > LITLEN_COUNT || distCount > DIST_COUNT)
+    { return false; }
+
+    uint8_t codelenLengths[CODELEN_COUNT] = {};
+    for(auto i=0u; i<codelenCount; ++i)
+    { codelenLengths[CODELEN_ORDER[i]] = uint8_t(reader.Get(3)); }
+
+    Decoder codelen;
+    if (!BuildDecoder(codelenLengths, CODELEN_COUNT, codelen))
+    { return false; }
+
+    uint8_t lengths[LITLEN_COUNT + DIST_COUNT] = {};
+    auto total = litlenCount + distCount;
+    for(auto i=0u; i<total;)
+    {
+        auto symbol = DecodeSymbol(reader, codelen);
+        if (symbol < 0)
+        { return false; }
+
+        if (symbol < 16)
+        {
+            lengths[i++] = uint8_t(symbol);
+            continue;
+        }
+
+        auto value  = uint8_t(0);
+        auto repeat = 0u;
+        if (symbol == 16)
+        {
+            if (i == 0)
+            { return false; }
+            value  = lengths[i - 1];
+            repeat = 3 + reader.Get(2);
+        }
+        else if (symbol == 17)
+        { repeat = 3 + reader.Get(3); }
+        else
+        { repeat = 11 + reader.Get(7); }
+
+        if (i + repeat > total)
+        { return false; }
+
+        for(auto k=0u; k<repeat; ++k)
+        { lengths[i++] = value; }
+    }
+
+    // ブロックの終端符号が無ければ終われない.
+    if (lengths[END_OF_BLOCK] == 0)
+    { return false; }
+
+    return BuildDecoder(lengths, litlenCount, litlen)
+        && BuildDecoder(lengths + litlenCount, distCount, dist)
+        && !reader.IsOverrun();
+}
+
+//-----------------------------------------------------------------------------
+//      Deflate ストリームを展開します.
+//-----------------------------------------------------------------------------
+bool InflateStream
+(
+    const uint8_t*          pSrc,
+    size_t                  size,
+    std::vector<uint8_t>&   result,
+    size_t&                 consumed
+)
+{
+    BitReader reader = { pSrc, pSrc + size, 0, 0, 0 };
+
+    auto pos = result.size();
+    if (result.size() < pos + MAX_MATCH + MAX_COPY_SLACK)
+    { result.resize(std::max(size * 4, pos + MAX_MATCH + MAX_COPY_SLACK)); }
+
+    Decoder dynamicLitLen;
+    Decoder dynamicDist;
+
+    auto final = false;
+    while(!final)
+    {
+        final = reader.Get(1) != 0;
+        auto type = reader.Get(2);
+
+        if (type == 0)
+        {
+            // 無圧縮ブロック.
+            reader.Rewind();
+            if (reader.Overrun > 0 || size_t(reader.pEnd - reader.pCur) < 4)
+            { return false; }
+
+            auto len  = uint32_t(reader.pCur[0]) | (uint32_t(reader.pCur[1]) << 8);
+            auto nlen = uint32_t(reader.pCur[2]) | (uint32_t(reader.pCur[3]) << 8);
+            reader.pCur += 4;
+            if ((len ^ 0xFFFF) != nlen || size_t(reader.pEnd - reader.pCur) < len)
+            { return false; }
+
+            if (result.size() < pos + len + MAX_MATCH + MAX_COPY_SLACK)
+            { result.resize(std::max(result.size() * 2, pos + len + MAX_MATCH + MAX_COPY_SLACK)); }
+
+            memcpy(result.data() + pos, reader.pCur, len);
+            reader.pCur += len;
+            pos         += len;
+            continue;
+        }
+
+        const Decoder* pLitLen = nullptr;
+        const Decoder* pDist   = nullptr;
+        if (type == 1)
+        { GetFixedDecoders(pLitLen, pDist); }
+        else if (type == 2)
+        {
+            if (!ReadDynamicDecoders(reader, dynamicLitLen, dynamicDist))
+            { return false; }
+            pLitLen = &dynamicLitLen;
+            pDist   = &dynamicDist;
+        }
+        else
+        { return false; }
+
+        for(;;)
+        {
+            // 壊れたデータで補った 0 を延々と復号しないように確認する.
+            if (reader.IsOverrun())
+            { return false; }
+
+            if (result.size() < pos + MAX_MATCH + MAX_COPY_SLACK)
+            { result.resize(result.size() * 2); }
+
+            auto symbol = DecodeSymbol(reader, *pLitLen);
+            if (symbol < 0)
+            { return false; }
+
+            if (symbol < int(END_OF_BLOCK))
+            {
+                result[pos++] = uint8_t(symbol);
+                continue;
+            }
+
+            if (symbol == int(END_OF_BLOCK))
+            { break; }
+
+            symbol -= END_OF_BLOCK + 1;
+            if (symbol >= 29)
+            { return false; }
+
+            auto length = LENGTH_BASE[symbol] + reader.Get(LENGTH_EXTRA[symbol]);
+
+            auto distSymbol = DecodeSymbol(reader, *pDist);
+            if (distSymbol < 0 || distSymbol >= int(DIST_COUNT))
+            { return false; }
+
+            auto dist = DIST_BASE[distSymbol] + reader.Get(DIST_EXTRA[distSymbol]);
+            if (dist > pos)
+            { return false; }
+
+            auto pDst = result.data() + pos;
+            auto pRef = pDst - dist;
+            if (dist >= MAX_COPY_SLACK)
+            {
+                // 8 バイト単位でも未書き込みの位置を参照しない.
+                for(auto i=0u; i<length; i+=MAX_COPY_SLACK)
+                { memcpy(pDst + i, pRef + i, MAX_COPY_SLACK); }
+            }
+            else
+            {
+                for(auto i=0u; i<length; ++i)
+                { pDst[i] = pRef[i]; }
+            }
+            pos += length;
+        }
+    }
+
+    if (reader.IsOverrun())
+    { return false; }
+
+    reader.Rewind();
+    consumed = size_t(reader.pCur - pSrc);
+    result.resize(pos);
+    return true;
+}
+
+} // namespace
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//      Adler-32 を更新します.
+//-----------------------------------------------------------------------------
+uint32_t UpdateAdler32(uint32_t adler, const uint8_t* pData, size_t size)
+{
+    uint32_t s1 = adler & 0xFFFF;
+    uint32_t s2 = adler >> 16;
+
+    // 5552 バイトまでは剰余を取らなくても 32bit に収まる.
+    while(size > 0)
+    {
+        auto count = std::min<size_t>(size, 5552);
+        size -= count;
+
+        while(count >= 8)
+        {
+            s1 += pData[0]; s2 += s1;
+            s1 += pData[1]; s2 += s1;
+            s1 += pData[2]; s2 += s1;
+            s1 += pData[3]; s2 += s1;
+            s1 += pData[4]; s2 += s1;
+            s1 += pData[5]; s2 += s1;
+            s1 += pData[6]; s2 += s1;
+            s1 += pData[7]; s2 += s1;
+            pData += 8;
+            count -= 8;
+        }
+        while(count-- > 0)
+        { s1 += *pData++; s2 += s1; }
+
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+    }
+
+    return (s2 << 16) | s1;
+}
+
+//-----------------------------------------------------------------------------
+//      連続する2つのデータの Adler-32 を結合します.
+//-----------------------------------------------------------------------------
+uint32_t CombineAdler32(uint32_t adler1, uint32_t adler2, uint64_t size2)
+{
+    // zlib の adler32_combine() と同じ計算.
+    auto rem  = uint32_t(size2 % ADLER_BASE);
+    auto sum1 = adler1 & 0xFFFF;
+    auto sum2 = uint32_t((uint64_t(rem) * sum1) % ADLER_BASE);
+
+    sum1 += (adler2 & 0xFFFF) + ADLER_BASE - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + ADLER_BASE - rem;
+
+    if (sum1 >= ADLER_BASE) { sum1 -= ADLER_BASE; }
+    if (sum1 >= ADLER_BASE) { sum1 -= ADLER_BASE; }
+    if (sum2 >= (ADLER_BASE << 1)) { sum2 -= (ADLER_BASE << 1); }
+    if (sum2 >= ADLER_BASE) { sum2 -= ADLER_BASE; }
+
+    return (sum2 << 16) | sum1;
+}
+
+//-----------------------------------------------------------------------------
+//      テーブルを初期化します.
+//-----------------------------------------------------------------------------
+void InitDeflate()
+{ GetTables(); }
+
+//-----------------------------------------------------------------------------
+//      Deflate ブロックに圧縮して追加します.
+//-----------------------------------------------------------------------------
+void Deflate
+(
+    const uint8_t*          pSrc,
+    uint32_t                size,
+    uint32_t                stride,
+    uint32_t                matchDist,
+    bool                    final,
+    std::vector<uint8_t>&   result
+)
+{
+    assert(1 <= matchDist && matchDist <= MAX_MATCH_DIST);
+
+    auto& tables  = GetTables();
+    auto& matches = GetMatches();
+    matches.clear();
+
+    uint32_t litFreq [LITLEN_COUNT] = {};
+    uint32_t distFreq[DIST_COUNT]   = {};
+    uint64_t extraBits = 0;
+
+    // 予測後の平坦な領域やグラデーションは同じ値の繰り返しになるので，
+    // 一定距離前との一致だけを行内で探す. ハッシュで候補を探すより大幅に速い.
+    const auto distCode = GetDistCode(tables, matchDist);
+    for(auto rowBegin=0u; rowBegin<size; rowBegin+=stride)
+    {
+        auto pos = rowBegin;
+        auto end = std::min(rowBegin + stride, size);
+
+        // 行の先頭は比較対象が無い.
+        for(auto i=0u; i<matchDist && pos<end; ++i)
+        { litFreq[pSrc[pos++]]++; }
+
+        while(pos + MIN_MATCH <= end)
+        {
+            if (Load32(pSrc + pos) != Load32(pSrc + pos - matchDist))
+            {
+                litFreq[pSrc[pos + 0]]++;
+                litFreq[pSrc[pos + 1]]++;
+                litFreq[pSrc[pos + 2]]++;
+                litFreq[pSrc[pos + 3]]++;
+                pos += 4;
+                continue;
+            }
+
+            auto maxLength = std::min(MAX_MATCH, end - pos);
+            auto length    = MIN_MATCH + MatchLength(
+                pSrc + pos + MIN_MATCH,
+                pSrc + pos + MIN_MATCH - matchDist,
+                maxLength - MIN_MATCH);
+
+            auto lengthCode = tables.LengthCode[length - 3];
+            litFreq [257 + lengthCode]++;
+            distFreq[distCode]++;
+            extraBits += LENGTH_EXTRA[lengthCode] + DIST_EXTRA[distCode];
+
+            matches.push_back({ pos, length });
+            pos += length;
+        }
+
+        while(pos < end)
+        { litFreq[pSrc[pos++]]++; }
+    }
+    litFreq[END_OF_BLOCK] = 1;
+
+    // 動的ハフマン符号を構築.
+    uint8_t  litLengths [LITLEN_COUNT];
+    uint8_t  distLengths[DIST_COUNT];
+    uint16_t litCodes   [LITLEN_COUNT];
+    uint16_t distCodes  [DIST_COUNT];
+    BuildCodeLengths(litFreq,  LITLEN_COUNT, MAX_CODE_BITS, litLengths);
+    BuildCodeLengths(distFreq, DIST_COUNT,   MAX_CODE_BITS, distLengths);
+    BuildCodes(litLengths,  LITLEN_COUNT, litCodes);
+    BuildCodes(distLengths, DIST_COUNT,   distCodes);
+
+    uint32_t litCount = LITLEN_COUNT;
+    while(litCount > 257 && litLengths[litCount - 1] == 0)
+    { litCount--; }
+
+    uint32_t distCount = DIST_COUNT;
+    while(distCount > 1 && distLengths[distCount - 1] == 0)
+    { distCount--; }
+
+    // 符号長の列をランレングス符号化.
+    uint8_t lengths[LITLEN_COUNT + DIST_COUNT];
+    memcpy(lengths, litLengths, litCount);
+    memcpy(lengths + litCount, distLengths, distCount);
+
+    uint16_t rle[LITLEN_COUNT + DIST_COUNT];   // 下位8bitが記号, 上位8bitが追加ビット.
+    uint32_t rleCount = 0;
+    uint32_t codeLenFreq[CODELEN_COUNT] = {};
+    {
+        auto total = litCount + distCount;
+        auto i     = 0u;
+        while(i < total)
+        {
+            auto curr = lengths[i];
+            auto run  = 1u;
+            while(i + run < total && lengths[i + run] == curr)
+            { run++; }
+            i += run;
+
+            if (curr == 0)
+            {
+                while(run >= 11)
+                {
+                    auto n = std::min(run, 138u);
+                    rle[rleCount++] = uint16_t(18 | ((n - 11) << 8));
+                    codeLenFreq[18]++;
+                    run -= n;
+                }
+                if (run >= 3)
+                {
+                    rle[rleCount++] = uint16_t(17 | ((run - 3) << 8));
+                    codeLenFreq[17]++;
+                    run = 0;
+                }
+            }
+            else
+            {
+                rle[rleCount++] = curr;
+                codeLenFreq[curr]++;
+                run--;
+
+                while(run >= 3)
+                {
+                    auto n = std::min(run, 6u);
+                    rle[rleCount++] = uint16_t(16 | ((n - 3) << 8));
+                    codeLenFreq[16]++;
+                    run -= n;
+                }
+            }
+
+            for(; run>0; --run)
+            {
+                rle[rleCount++] = curr;
+                codeLenFreq[curr]++;
+            }
+        }
+    }
+
+    uint8_t  codeLenLengths[CODELEN_COUNT];
+    uint16_t codeLenCodes  [CODELEN_COUNT];
+    BuildCodeLengths(codeLenFreq, CODELEN_COUNT, MAX_CODELEN_BITS, codeLenLengths);
+    BuildCodes(codeLenLengths, CODELEN_COUNT, codeLenCodes);
+
+    uint32_t codeLenCount = CODELEN_COUNT;
+    while(codeLenCount > 4 && codeLenLengths[CODELEN_ORDER[codeLenCount - 1]] == 0)
+    { codeLenCount--; }
+
+    // 出力サイズを求めて，無圧縮の方が小さければそちらにする.
+    uint64_t bits = 3 + 5 + 5 + 4 + 3 * codeLenCount;
+    for(auto i=0u; i<rleCount; ++i)
+    {
+        auto sym = rle[i] & 0xFF;
+        bits += codeLenLengths[sym];
+        bits += (sym == 16) ? 2 : (sym == 17) ? 3 : (sym == 18) ? 7 : 0;
+    }
+    for(auto i=0u; i<LITLEN_COUNT; ++i)
+    { bits += uint64_t(litFreq[i]) * litLengths[i]; }
+    for(auto i=0u; i<DIST_COUNT; ++i)
+    { bits += uint64_t(distFreq[i]) * distLengths[i]; }
+    bits += extraBits;
+
+    // 途中の帯は空の無圧縮ブロックでバイト境界に揃える.
+    auto dynamicSize = final ? (bits + 7) / 8 : (bits + 3 + 7) / 8 + 4;
+    auto storedCount = std::max<uint64_t>((size + MAX_STORED - 1) / MAX_STORED, 1);
+    auto storedSize  = uint64_t(size) + storedCount * 5;
+
+    auto offset = result.size();
+    if (storedSize <= dynamicSize)
+    {
+        result.resize(offset + size_t(storedSize));
+        auto pDst = result.data() + offset;
+        auto rest = size;
+        for(auto i=0u; i<storedCount; ++i)
+        {
+            auto count = std::min(rest, MAX_STORED);
+            auto last  = (i + 1 == storedCount);
+            *pDst++ = (final && last) ? 1 : 0;
+            *pDst++ = uint8_t(count);
+            *pDst++ = uint8_t(count >> 8);
+            *pDst++ = uint8_t(~count);
+            *pDst++ = uint8_t(~count >> 8);
+            memcpy(pDst, pSrc + (size - rest), count);
+            pDst += count;
+            rest -= count;
+        }
+        return;
+    }
+
+    // BitWriter は4バイト単位で書き込むので余裕を持たせる.
+    result.resize(offset + size_t(dynamicSize) + 8);
+
+    BitWriter writer = { result.data() + offset, 0, 0 };
+    writer.Put(final ? 1 : 0, 1);
+    writer.Put(2, 2);
+    writer.Put(litCount  - 257, 5);
+    writer.Put(distCount - 1,   5);
+    writer.Put(codeLenCount - 4, 4);
+    for(auto i=0u; i<codeLenCount; ++i)
+    { writer.Put(codeLenLengths[CODELEN_ORDER[i]], 3); }
+
+    for(auto i=0u; i<rleCount; ++i)
+    {
+        auto sym   = rle[i] & 0xFF;
+        auto extra = rle[i] >> 8;
+        writer.Put(codeLenCodes[sym], codeLenLengths[sym]);
+        if (sym == 16)      { writer.Put(extra, 2); }
+        else if (sym == 17) { writer.Put(extra, 3); }
+        else if (sym == 18) { writer.Put(extra, 7); }
+    }
+
+    uint32_t pos = 0;
+    for(auto& match : matches)
+    {
+        PutLiterals(writer, pSrc + pos, match.Pos - pos, litCodes, litLengths);
+
+        auto lengthCode = tables.LengthCode[match.Length - 3];
+        writer.Put(litCodes[257 + lengthCode], litLengths[257 + lengthCode]);
+        writer.Put(match.Length - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+        writer.Put(distCodes[distCode], distLengths[distCode]);
+        writer.Put(matchDist - DIST_BASE[distCode], DIST_EXTRA[distCode]);
+        pos = match.Pos + match.Length;
+    }
+    PutLiterals(writer, pSrc + pos, size - pos, litCodes, litLengths);
+
+    writer.Put(litCodes[END_OF_BLOCK], litLengths[END_OF_BLOCK]);
+
+    if (!final)
+    {
+        writer.Put(0, 3);
+        writer.Align();
+        *writer.pDst++ = 0x00;
+        *writer.pDst++ = 0x00;
+        *writer.pDst++ = 0xFF;
+        *writer.pDst++ = 0xFF;
+    }
+    else
+    {
+        writer.Align();
+    }
+
+    assert(size_t(writer.pDst - result.data()) == offset + dynamicSize);
+    result.resize(offset + size_t(dynamicSize));
+}
+
+//-----------------------------------------------------------------------------
+//      zlib 形式で圧縮します.
+//-----------------------------------------------------------------------------
+void CompressZlib
+(
+    const uint8_t*          pSrc,
+    uint32_t                size,
+    uint32_t                matchDist,
+    std::vector<uint8_t>&   result
+)
+{
+    result.clear();
+    result.reserve(size_t(size) + size_t(size) / 8 + 64);
+
+    // zlib ヘッダー (Deflate, 32KB 窓, 圧縮レベル最速).
+    result.push_back(0x78);
+    result.push_back(0x01);
+
+    Deflate(pSrc, size, size, matchDist, true, result);
+
+    auto adler = UpdateAdler32(1, pSrc, size);
+    result.push_back(uint8_t(adler >> 24));
+    result.push_back(uint8_t(adler >> 16));
+    result.push_back(uint8_t(adler >> 8));
+    result.push_back(uint8_t(adler));
+}
+
+//-----------------------------------------------------------------------------
+//      Deflate ストリームを展開します.
+//-----------------------------------------------------------------------------
+bool Inflate(const uint8_t* pSrc, size_t size, std::vector<uint8_t>& result)
+{
+    result.clear();
+
+    size_t consumed = 0;
+    return InflateStream(pSrc, size, result, consumed);
+}
+
+//-----------------------------------------------------------------------------
+//      zlib 形式を展開します.
+//-----------------------------------------------------------------------------
+bool DecompressZlib(const uint8_t* pSrc, size_t size, std::vector<uint8_t>& result)
+{
+    result.clear();
+
+    // 圧縮方式は Deflate のみ, プリセット辞書は非対応.
+    if (size < 6
+     || (pSrc[0] & 0x0F) != 8
+     || (pSrc[0] >> 4) > 7
+     || ((uint32_t(pSrc[0]) << 8) | pSrc[1]) % 31 != 0
+     || (pSrc[1] & 0x20) != 0)
+    { return false; }
+
+    size_t consumed = 0;
+    if (!InflateStream(pSrc + 2, size - 2, result, consumed))
+    { return false; }
+
+    auto pAdler = pSrc + 2 + consumed;
+    if (size_t(pSrc + size - pAdler) < 4)
+    { return false; }
+
+    auto adler = (uint32_t(pAdler[0]) << 24)
+               | (uint32_t(pAdler[1]) << 16)
+               | (uint32_t(pAdler[2]) << 8)
+               |  uint32_t(pAdler[3]);
+    return adler == UpdateAdler32(1, result.data(), result.size());
+}
+
+} // namespace r3d
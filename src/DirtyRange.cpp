@@ -0,0 +1,190 @@
+﻿//-----------------------------------------------------------------------------
+// File : DirtyRange.cpp
+// Desc : Dirty Range Tracker for Multi-Buffered Resources.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <DirtyRange.h>
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t WORD_BITS = 64;
+
+//-----------------------------------------------------------------------------
+//      最下位のセットされたビット位置を求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t FindFirstSet(uint64_t value)
+{
+    assert(value != 0);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return uint32_t(index);
+#else
+    return uint32_t(__builtin_ctzll(value));
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      指定ビット以降の全ビットが立ったマスクを求めます.
+//-----------------------------------------------------------------------------
+inline uint64_t MaskFrom(uint32_t bit)
+{ return (bit >= WORD_BITS) ? 0 : (~uint64_t(0) << bit); }
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// DirtyRangeTracker class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool DirtyRangeTracker::Init(uint32_t slotCount, uint32_t mergeGap)
+{
+    Term();
+
+    if (slotCount == 0)
+    { return false; }
+
+    m_Slots.resize(slotCount);
+    for(auto& slot : m_Slots)
+    {
+        slot.BeginWord = 0;
+        slot.EndWord   = 0;
+    }
+
+    m_MergeGap = mergeGap;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void DirtyRangeTracker::Term()
+{
+    m_Slots.clear();
+    m_MergeGap = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      全ての面に対して変更を記録します.
+//-----------------------------------------------------------------------------
+void DirtyRangeTracker::Mark(uint32_t offset, uint32_t count)
+{
+    if (count == 0)
+    { return; }
+
+    auto end       = uint64_t(offset) + count;
+    auto beginWord = size_t(offset / WORD_BITS);
+    auto lastWord  = size_t((end - 1) / WORD_BITS);
+    auto headMask  = MaskFrom(offset % WORD_BITS);
+    auto tailMask  = ~MaskFrom(uint32_t((end - 1) % WORD_BITS) + 1);
+
+    for(auto& slot : m_Slots)
+    {
+        auto& bits = slot.Bits;
+        if (bits.size() <= lastWord)
+        { bits.resize(lastWord + 1, 0); }
+
+        // 範囲内のワードにビットを立てる.
+        if (beginWord == lastWord)
+        { bits[beginWord] |= headMask & tailMask; }
+        else
+        {
+            bits[beginWord] |= headMask;
+            for(auto i=beginWord + 1; i<lastWord; ++i)
+            { bits[i] = ~uint64_t(0); }
+            bits[lastWord] |= tailMask;
+        }
+
+        if (slot.BeginWord == slot.EndWord)
+        {
+            slot.BeginWord = beginWord;
+            slot.EndWord   = lastWord + 1;
+        }
+        else
+        {
+            if (beginWord < slot.BeginWord)
+            { slot.BeginWord = beginWord; }
+            if (lastWord + 1 > slot.EndWord)
+            { slot.EndWord = lastWord + 1; }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      指定面の変更範囲を結合して取り出します.
+//-----------------------------------------------------------------------------
+void DirtyRangeTracker::Flush(uint32_t slot, std::vector<DirtyRange>& result)
+{
+    assert(slot < m_Slots.size());
+    auto& item = m_Slots[slot];
+
+    result.clear();
+
+    // 変更のあったワードだけを走査して連続したビットを範囲にする.
+    for(auto i=item.BeginWord; i<item.EndWord; ++i)
+    {
+        auto word = item.Bits[i];
+        item.Bits[i] = 0;
+
+        while(word != 0)
+        {
+            auto first = FindFirstSet(word);
+            auto rest  = ~(word >> first);
+            auto run   = (rest == 0) ? WORD_BITS : FindFirstSet(rest);
+            auto begin = uint32_t(i * WORD_BITS + first);
+
+            // 直前の範囲との隙間が小さければ結合する.
+            if (!result.empty())
+            {
+                auto& last = result.back();
+                if (begin <= uint64_t(last.Offset) + last.Count + m_MergeGap)
+                { last.Count = begin + run - last.Offset; }
+                else
+                { result.push_back({ begin, run }); }
+            }
+            else
+            { result.push_back({ begin, run }); }
+
+            word &= MaskFrom(first + run);
+        }
+    }
+
+    item.BeginWord = 0;
+    item.EndWord   = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      指定面に変更があるかどうか?
+//-----------------------------------------------------------------------------
+bool DirtyRangeTracker::IsDirty(uint32_t slot) const
+{
+    assert(slot < m_Slots.size());
+    auto& item = m_Slots[slot];
+    return item.BeginWord != item.EndWord;
+}
+
+//-----------------------------------------------------------------------------
+//      面数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t DirtyRangeTracker::GetSlotCount() const
+{ return uint32_t(m_Slots.size()); }
+
+} // namespace r3d
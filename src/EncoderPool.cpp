@@ -0,0 +1,373 @@
+﻿//-----------------------------------------------------------------------------
+// File : EncoderPool.cpp
+// Desc : Persistent Frame Encoder Worker Pool.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <EncoderPool.h>
+#include <Platform.h>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      経過時間を秒単位で求めます.
+//-----------------------------------------------------------------------------
+inline double GetElapsedSec(const std::chrono::steady_clock::time_point& begin)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// BoundedQueue class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool BoundedQueue::Init(uint32_t capacity)
+{
+    Term();
+
+    if (capacity == 0)
+    { return false; }
+
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    m_Items.resize(capacity);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void BoundedQueue::Term()
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    m_Items.clear();
+    m_Head   = 0;
+    m_Count  = 0;
+    m_Closed = false;
+}
+
+//-----------------------------------------------------------------------------
+//      末尾に追加します.
+//-----------------------------------------------------------------------------
+bool BoundedQueue::Push(uint32_t value)
+{
+    {
+        std::unique_lock<std::mutex> locker(m_Mutex);
+        m_NotFull.wait(locker, [&]() { return m_Count < m_Items.size() || m_Closed; });
+
+        if (m_Closed)
+        { return false; }
+
+        auto capacity = uint32_t(m_Items.size());
+        m_Items[(m_Head + m_Count) % capacity] = value;
+        m_Count++;
+    }
+
+    // WaitCount() で待っているスレッドもいるので全て起こす.
+    m_NotEmpty.notify_all();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      先頭から取り出します.
+//-----------------------------------------------------------------------------
+bool BoundedQueue::Pop(uint32_t& value)
+{
+    {
+        std::unique_lock<std::mutex> locker(m_Mutex);
+        m_NotEmpty.wait(locker, [&]() { return m_Count > 0 || m_Closed; });
+
+        if (m_Count == 0)
+        { return false; }
+
+        value  = m_Items[m_Head];
+        m_Head = (m_Head + 1) % uint32_t(m_Items.size());
+        m_Count--;
+    }
+
+    m_NotFull.notify_one();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      待たずに先頭から取り出します.
+//-----------------------------------------------------------------------------
+bool BoundedQueue::TryPop(uint32_t& value)
+{
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        if (m_Count == 0)
+        { return false; }
+
+        value  = m_Items[m_Head];
+        m_Head = (m_Head + 1) % uint32_t(m_Items.size());
+        m_Count--;
+    }
+
+    m_NotFull.notify_one();
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      キューを閉じて待機中のスレッドを全て起こします.
+//-----------------------------------------------------------------------------
+void BoundedQueue::Close()
+{
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        m_Closed = true;
+    }
+
+    m_NotEmpty.notify_all();
+    m_NotFull .notify_all();
+}
+
+//-----------------------------------------------------------------------------
+//      要素数が指定数以上になるまで待ちます.
+//-----------------------------------------------------------------------------
+void BoundedQueue::WaitCount(uint32_t count)
+{
+    std::unique_lock<std::mutex> locker(m_Mutex);
+    m_NotEmpty.wait(locker, [&]() { return m_Count >= count || m_Closed; });
+}
+
+//-----------------------------------------------------------------------------
+//      要素数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t BoundedQueue::GetCount() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return m_Count;
+}
+
+//-----------------------------------------------------------------------------
+//      最大要素数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t BoundedQueue::GetCapacity() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return uint32_t(m_Items.size());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// EncoderPool class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+EncoderPool::~EncoderPool()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool EncoderPool::Init(const EncoderPoolDesc& desc)
+{
+    Term();
+
+    if (desc.pHandler == nullptr || desc.BufferSize == 0)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    auto workerCount = desc.WorkerCount;
+    if (workerCount == 0)
+    { workerCount = std::max(std::thread::hardware_concurrency(), 1u); }
+
+    auto bufferCount = desc.BufferCount;
+    if (bufferCount == 0)
+    { bufferCount = workerCount * 2; }
+
+    // バッファ数より多いワーカーは仕事が無い.
+    workerCount = std::min(workerCount, bufferCount);
+
+    if (!m_FreeList.Init(bufferCount) || !m_Jobs.Init(bufferCount))
+    {
+        ELOGA("Error : BoundedQueue::Init() Failed.");
+        return false;
+    }
+
+    m_Frames.resize(bufferCount);
+    for(auto i=0u; i<bufferCount; ++i)
+    {
+        auto& frame = m_Frames[i];
+        frame.Pixels.resize(size_t(desc.BufferSize));
+        frame.FrameIndex = 0;
+        frame.Width      = 0;
+        frame.Height     = 0;
+        frame.Pitch      = 0;
+        frame.SourceIndex = 0;
+        frame.HdrPixels.resize(size_t(desc.HdrBufferSize));
+        frame.HdrWidth   = 0;
+        frame.HdrHeight  = 0;
+        frame.HdrPitch   = 0;
+
+        m_FreeList.Push(i);
+    }
+
+    m_pHandler = desc.pHandler;
+
+    m_Workers.reserve(workerCount);
+    for(auto i=0u; i<workerCount; ++i)
+    { m_Workers.emplace_back(&EncoderPool::Run, this, i); }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      投入済みのフレームを全て出力してから終了処理を行います.
+//-----------------------------------------------------------------------------
+void EncoderPool::Term()
+{
+    // キューを閉じても残りのジョブはワーカーが処理してから抜ける.
+    m_Jobs.Close();
+    for(auto& worker : m_Workers)
+    {
+        if (worker.joinable())
+        { worker.join(); }
+    }
+    m_Workers.clear();
+
+    m_Jobs    .Term();
+    m_FreeList.Term();
+    m_Frames  .clear();
+    m_Frames  .shrink_to_fit();
+
+    m_pHandler = nullptr;
+    m_Stats    = EncoderPoolStats();
+}
+
+//-----------------------------------------------------------------------------
+//      書き込み用のフレームを取得します.
+//-----------------------------------------------------------------------------
+CaptureFrame* EncoderPool::Acquire()
+{
+    if (m_Frames.empty())
+    { return nullptr; }
+
+    uint32_t index = 0;
+    if (!m_FreeList.TryPop(index))
+    {
+        // エンコードが追いついていないので空くまで待つ.
+        auto begin = std::chrono::steady_clock::now();
+        if (!m_FreeList.Pop(index))
+        { return nullptr; }
+
+        auto sec = GetElapsedSec(begin);
+
+        std::lock_guard<std::mutex> locker(m_StatsMutex);
+        m_Stats.StallCount++;
+        m_Stats.StallSec   += sec;
+        m_Stats.MaxStallSec = std::max(m_Stats.MaxStallSec, sec);
+    }
+
+    return &m_Frames[index];
+}
+
+//-----------------------------------------------------------------------------
+//      フレームのエンコードを依頼します.
+//-----------------------------------------------------------------------------
+void EncoderPool::Submit(CaptureFrame* pFrame)
+{
+    auto index = GetIndex(pFrame);
+
+    {
+        std::lock_guard<std::mutex> locker(m_StatsMutex);
+        m_Stats.SubmitCount++;
+    }
+
+    // ジョブ数はバッファ数を超えないので待つことは無い.
+    m_Jobs.Push(index);
+}
+
+//-----------------------------------------------------------------------------
+//      フレームを出力せずに返却します.
+//-----------------------------------------------------------------------------
+void EncoderPool::Discard(CaptureFrame* pFrame)
+{ m_FreeList.Push(GetIndex(pFrame)); }
+
+//-----------------------------------------------------------------------------
+//      投入済みのフレームが全て出力されるまで待ちます.
+//-----------------------------------------------------------------------------
+void EncoderPool::Drain()
+{
+    if (m_Frames.empty())
+    { return; }
+
+    m_FreeList.WaitCount(uint32_t(m_Frames.size()));
+}
+
+//-----------------------------------------------------------------------------
+//      統計情報を取得します.
+//-----------------------------------------------------------------------------
+EncoderPoolStats EncoderPool::GetStats() const
+{
+    std::lock_guard<std::mutex> locker(m_StatsMutex);
+    return m_Stats;
+}
+
+//-----------------------------------------------------------------------------
+//      ワーカースレッド数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t EncoderPool::GetWorkerCount() const
+{ return uint32_t(m_Workers.size()); }
+
+//-----------------------------------------------------------------------------
+//      バッファ数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t EncoderPool::GetBufferCount() const
+{ return uint32_t(m_Frames.size()); }
+
+//-----------------------------------------------------------------------------
+//      フレームのバッファ番号を求めます.
+//-----------------------------------------------------------------------------
+uint32_t EncoderPool::GetIndex(const CaptureFrame* pFrame) const
+{
+    assert(pFrame >= m_Frames.data() && pFrame < m_Frames.data() + m_Frames.size());
+    return uint32_t(pFrame - m_Frames.data());
+}
+
+//-----------------------------------------------------------------------------
+//      ワーカースレッドの処理です.
+//-----------------------------------------------------------------------------
+void EncoderPool::Run(uint32_t workerIndex)
+{
+    uint32_t index = 0;
+    while(m_Jobs.Pop(index))
+    {
+        auto begin  = std::chrono::steady_clock::now();
+        auto result = m_pHandler->Encode(workerIndex, m_Frames[index]);
+        auto sec    = GetElapsedSec(begin);
+
+        {
+            std::lock_guard<std::mutex> locker(m_StatsMutex);
+            if (result)
+            { m_Stats.CompleteCount++; }
+            else
+            { m_Stats.FailCount++; }
+            m_Stats.EncodeSec += sec;
+        }
+
+        m_FreeList.Push(index);
+    }
+}
+
+} // namespace r3d
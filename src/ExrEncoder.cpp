@@ -0,0 +1,755 @@
+﻿//-----------------------------------------------------------------------------
+// File : ExrEncoder.cpp
+// Desc : Block Parallel OpenEXR Encoder.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ExrEncoder.h>
+#include <Deflate.h>
+#include <Platform.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint8_t  EXR_MAGIC[4]          = { 0x76, 0x2F, 0x31, 0x01 };
+static const uint32_t EXR_VERSION           = 2;        // シングルパート, スキャンライン.
+static const uint32_t EXR_PIXEL_TYPE_HALF   = 1;
+static const uint32_t EXR_PIXEL_TYPE_FLOAT  = 2;
+static const uint32_t EXR_FLAG_UNSUPPORTED  = 0x200 | 0x800 | 0x1000;   // タイル, ディープ, マルチパート.
+static const uint8_t  EXR_COMPRESSION_ZIPS  = 2;        // zlib (1行ごとのブロック).
+static const uint8_t  EXR_LINE_ORDER_INC_Y  = 0;
+static const uint32_t ZIP_LINES_PER_BLOCK   = 16;
+static const uint32_t SRC_BYTES_PER_PIXEL   = 8;        // RGBA16F.
+static const uint32_t CHANNEL_COUNT         = 3;
+static const uint32_t TASKS_PER_THREAD      = 4;        // 負荷の偏りを均すための分割数.
+static const uint32_t MATCH_DIST            = 1;        // 予測後は同じ値の連続になりやすい.
+static const uint32_t MAX_BLOCK_SIZE        = 1u << 30; // ブロックサイズは int32 で記録される.
+
+// チャンネルは名前順に格納する. 値は RGBA16F の要素番号.
+static const char*    CHANNEL_NAMES[CHANNEL_COUNT]  = { "B", "G", "R" };
+static const uint32_t CHANNEL_INDEX[CHANNEL_COUNT]  = { 2, 1, 0 };
+
+///////////////////////////////////////////////////////////////////////////////
+// BlockScratch structure
+///////////////////////////////////////////////////////////////////////////////
+struct BlockScratch
+{
+    std::vector<uint8_t>    Raw;            //!< 無圧縮のブロック.
+    std::vector<uint8_t>    Predicted;      //!< 並べ替えと差分予測を適用したブロック.
+    std::vector<uint8_t>    Compressed;     //!< zlib ストリーム.
+};
+
+//-----------------------------------------------------------------------------
+//      スレッドごとの作業領域を取得します.
+//-----------------------------------------------------------------------------
+BlockScratch& GetScratch()
+{
+    static thread_local BlockScratch s_Scratch;
+    return s_Scratch;
+}
+
+//-----------------------------------------------------------------------------
+//      リトルエンディアンで32bit値を追加します.
+//-----------------------------------------------------------------------------
+inline void PushLE32(std::vector<uint8_t>& buffer, uint32_t value)
+{
+    buffer.push_back(uint8_t(value));
+    buffer.push_back(uint8_t(value >> 8));
+    buffer.push_back(uint8_t(value >> 16));
+    buffer.push_back(uint8_t(value >> 24));
+}
+
+//-----------------------------------------------------------------------------
+//      リトルエンディアンで32bit値を書き込みます.
+//-----------------------------------------------------------------------------
+inline void WriteLE32(uint8_t* p, uint32_t value)
+{
+    p[0] = uint8_t(value);
+    p[1] = uint8_t(value >> 8);
+    p[2] = uint8_t(value >> 16);
+    p[3] = uint8_t(value >> 24);
+}
+
+//-----------------------------------------------------------------------------
+//      ヘッダーの属性を追加します.
+//-----------------------------------------------------------------------------
+void PushAttribute
+(
+    std::vector<uint8_t>&   buffer,
+    const char*             name,
+    const char*             type,
+    const void*             pValue,
+    uint32_t                size
+)
+{
+    buffer.insert(buffer.end(), name, name + strlen(name) + 1);
+    buffer.insert(buffer.end(), type, type + strlen(type) + 1);
+    PushLE32(buffer, size);
+
+    auto p = static_cast<const uint8_t*>(pValue);
+    buffer.insert(buffer.end(), p, p + size);
+}
+
+//-----------------------------------------------------------------------------
+//      ヘッダーを追加します.
+//-----------------------------------------------------------------------------
+void PushHeader(std::vector<uint8_t>& buffer, uint32_t width, uint32_t height, r3d::EXR_COMPRESSION compression)
+{
+    buffer.insert(buffer.end(), EXR_MAGIC, EXR_MAGIC + sizeof(EXR_MAGIC));
+    PushLE32(buffer, EXR_VERSION);
+
+    // チャンネル一覧. 名前, 型, pLinear + 予約3バイト, xSampling, ySampling を並べ, 空文字で終端する.
+    {
+        std::vector<uint8_t> channels;
+        for(auto i=0u; i<CHANNEL_COUNT; ++i)
+        {
+            auto name = CHANNEL_NAMES[i];
+            channels.insert(channels.end(), name, name + strlen(name) + 1);
+            PushLE32(channels, EXR_PIXEL_TYPE_HALF);
+            PushLE32(channels, 0);
+            PushLE32(channels, 1);
+            PushLE32(channels, 1);
+        }
+        channels.push_back(0);
+
+        PushAttribute(buffer, "channels", "chlist", channels.data(), uint32_t(channels.size()));
+    }
+
+    auto value = uint8_t(compression);
+    PushAttribute(buffer, "compression", "compression", &value, sizeof(value));
+
+    uint8_t window[16];
+    WriteLE32(window + 0,  0);
+    WriteLE32(window + 4,  0);
+    WriteLE32(window + 8,  width  - 1);
+    WriteLE32(window + 12, height - 1);
+    PushAttribute(buffer, "dataWindow",    "box2i", window, sizeof(window));
+    PushAttribute(buffer, "displayWindow", "box2i", window, sizeof(window));
+
+    value = EXR_LINE_ORDER_INC_Y;
+    PushAttribute(buffer, "lineOrder", "lineOrder", &value, sizeof(value));
+
+    float aspect = 1.0f;
+    PushAttribute(buffer, "pixelAspectRatio", "float", &aspect, sizeof(aspect));
+
+    float center[2] = { 0.0f, 0.0f };
+    PushAttribute(buffer, "screenWindowCenter", "v2f", center, sizeof(center));
+
+    float windowWidth = 1.0f;
+    PushAttribute(buffer, "screenWindowWidth", "float", &windowWidth, sizeof(windowWidth));
+
+    buffer.push_back(0);
+}
+
+//-----------------------------------------------------------------------------
+//      ZIP 圧縮の前処理 (バイトの並べ替えと差分予測) を行います.
+//-----------------------------------------------------------------------------
+void Predict(const uint8_t* pSrc, size_t size, uint8_t* pDst)
+{
+    // 偶数番目のバイトを前半に, 奇数番目のバイトを後半に並べる.
+    auto pLo = pDst;
+    auto pHi = pDst + (size + 1) / 2;
+    for(size_t i=0; i + 1 < size; i += 2)
+    {
+        *pLo++ = pSrc[i + 0];
+        *pHi++ = pSrc[i + 1];
+    }
+    if (size & 1)
+    { *pLo = pSrc[size - 1]; }
+
+    // 直前のバイトとの差分 + 128.
+    auto prev = pDst[0];
+    for(size_t i=1; i<size; ++i)
+    {
+        auto curr = pDst[i];
+        pDst[i] = uint8_t(curr - prev + 128);
+        prev = curr;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ZIP 圧縮の前処理を元に戻します.
+//-----------------------------------------------------------------------------
+void Reconstruct(uint8_t* pSrc, size_t size, uint8_t* pDst)
+{
+    for(size_t i=1; i<size; ++i)
+    { pSrc[i] = uint8_t(pSrc[i - 1] + pSrc[i] - 128); }
+
+    auto pLo = pSrc;
+    auto pHi = pSrc + (size + 1) / 2;
+    for(size_t i=0; i + 1 < size; i += 2)
+    {
+        pDst[i + 0] = *pLo++;
+        pDst[i + 1] = *pHi++;
+    }
+    if (size & 1)
+    { pDst[size - 1] = *pLo; }
+}
+
+//-----------------------------------------------------------------------------
+//      リトルエンディアンで32bit値を読み込みます.
+//-----------------------------------------------------------------------------
+inline uint32_t ReadLE32(const uint8_t* p)
+{ return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24); }
+
+//-----------------------------------------------------------------------------
+//      half を float に変換します.
+//-----------------------------------------------------------------------------
+inline float HalfToFloat(uint16_t value)
+{
+    auto sign     = uint32_t(value & 0x8000) << 16;
+    auto exponent = (value >> 10) & 0x1F;
+    auto mantissa = uint32_t(value & 0x3FF);
+
+    uint32_t bits;
+    if (exponent == 0x1F)
+    { bits = sign | 0x7F800000 | (mantissa << 13); }
+    else if (exponent != 0)
+    { bits = sign | ((exponent + 112) << 23) | (mantissa << 13); }
+    else if (mantissa == 0)
+    { bits = sign; }
+    else
+    {
+        // 非正規化数は正規化する.
+        exponent = 113;
+        while((mantissa & 0x400) == 0)
+        {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ExrChannel structure
+///////////////////////////////////////////////////////////////////////////////
+struct ExrChannel
+{
+    int32_t     Target;     //!< 出力先の要素番号 (R, G, B, A). 使わないチャンネルは -1.
+    uint32_t    Type;       //!< 画素の型.
+    uint32_t    Offset;     //!< 1行の中での開始位置[byte] (幅を掛ける前).
+};
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// ExrEncoder::Job structure
+///////////////////////////////////////////////////////////////////////////////
+struct ExrEncoder::Job
+{
+    const uint8_t*                      pPixels;
+    uint32_t                            Width;
+    uint32_t                            Height;
+    uint32_t                            Pitch;
+    EXR_COMPRESSION                     Compression;
+    uint32_t                            LinesPerBlock;
+    uint32_t                            Remaining;      //!< 未完了のタスクの数 (m_Mutex で保護).
+    std::vector<std::vector<uint8_t>>   Chunks;         //!< ブロックごとのチャンク (y, サイズ, データ).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// ExrEncoder class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+ExrEncoder::~ExrEncoder()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool ExrEncoder::Init(uint32_t threadCount)
+{
+    Term();
+
+    if (threadCount == 0)
+    { threadCount = std::max(std::thread::hardware_concurrency(), 1u); }
+
+    // テーブルはワーカーが動き出す前に作っておく.
+    InitDeflate();
+
+    m_Threads.reserve(threadCount);
+    for(auto i=0u; i<threadCount; ++i)
+    { m_Threads.emplace_back(&ExrEncoder::Run, this); }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void ExrEncoder::Term()
+{
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        m_Quit = true;
+    }
+    m_TaskCond.notify_all();
+
+    for(auto& thread : m_Threads)
+    {
+        if (thread.joinable())
+        { thread.join(); }
+    }
+    m_Threads.clear();
+
+    // Encode() は完了まで戻らないので残っているタスクは無い.
+    assert(m_Tasks.empty());
+    m_Quit = false;
+}
+
+//-----------------------------------------------------------------------------
+//      RGBA16F の画像を OpenEXR にエンコードします.
+//-----------------------------------------------------------------------------
+bool ExrEncoder::Encode
+(
+    const uint8_t*          pPixels,
+    uint32_t                width,
+    uint32_t                height,
+    uint32_t                pitch,
+    EXR_COMPRESSION         compression,
+    std::vector<uint8_t>&   result
+)
+{
+    if (pPixels == nullptr || width == 0 || height == 0 || uint64_t(pitch) < uint64_t(width) * SRC_BYTES_PER_PIXEL)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    if (compression != EXR_COMPRESSION_NONE && compression != EXR_COMPRESSION_ZIP)
+    {
+        ELOGA("Error : Unsupported Compression. compression = %d", compression);
+        return false;
+    }
+
+    // ブロックの座標とサイズは int32 で記録される.
+    auto linesPerBlock = (compression == EXR_COMPRESSION_ZIP) ? ZIP_LINES_PER_BLOCK : 1;
+    auto blockSize     = uint64_t(width) * CHANNEL_COUNT * sizeof(uint16_t) * linesPerBlock;
+    if (blockSize > MAX_BLOCK_SIZE || width > uint32_t(INT32_MAX) || height > uint32_t(INT32_MAX))
+    {
+        ELOGA("Error : Image is too large. width = %u, height = %u", width, height);
+        return false;
+    }
+
+    auto blockCount = (height + linesPerBlock - 1) / linesPerBlock;
+    auto taskCount  = std::min(blockCount, (GetThreadCount() + 1) * TASKS_PER_THREAD);
+    auto perTask    = (blockCount + taskCount - 1) / taskCount;
+    taskCount       = (blockCount + perTask - 1) / perTask;
+
+    Job job;
+    job.pPixels       = pPixels;
+    job.Width         = width;
+    job.Height        = height;
+    job.Pitch         = pitch;
+    job.Compression   = compression;
+    job.LinesPerBlock = linesPerBlock;
+    job.Remaining     = taskCount;
+    job.Chunks.resize(blockCount);
+
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        for(auto i=0u; i<taskCount; ++i)
+        {
+            auto begin = i * perTask;
+            auto end   = std::min(begin + perTask, blockCount);
+            m_Tasks.push_back({ &job, begin, end });
+        }
+    }
+    m_TaskCond.notify_all();
+
+    // 完了を待つ間もタスクを処理する.
+    for(;;)
+    {
+        Task task = {};
+        {
+            std::unique_lock<std::mutex> locker(m_Mutex);
+            if (job.Remaining == 0)
+            { break; }
+
+            if (m_Tasks.empty())
+            {
+                m_DoneCond.wait(locker, [&]() { return job.Remaining == 0; });
+                break;
+            }
+
+            task = m_Tasks.front();
+            m_Tasks.pop_front();
+        }
+
+        Execute(task);
+    }
+
+    result.clear();
+    PushHeader(result, width, height, compression);
+
+    // オフセットテーブル (ファイル先頭からの各チャンクの位置).
+    auto tableOffset = result.size();
+    auto offset      = uint64_t(tableOffset) + uint64_t(blockCount) * sizeof(uint64_t);
+
+    size_t totalSize = 0;
+    for(auto& chunk : job.Chunks)
+    { totalSize += chunk.size(); }
+
+    result.resize(tableOffset + size_t(blockCount) * sizeof(uint64_t));
+    result.reserve(result.size() + totalSize);
+
+    for(auto i=0u; i<blockCount; ++i)
+    {
+        auto p = result.data() + tableOffset + size_t(i) * sizeof(uint64_t);
+        WriteLE32(p + 0, uint32_t(offset));
+        WriteLE32(p + 4, uint32_t(offset >> 32));
+        offset += job.Chunks[i].size();
+    }
+
+    for(auto& chunk : job.Chunks)
+    { result.insert(result.end(), chunk.begin(), chunk.end()); }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ワーカースレッド数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t ExrEncoder::GetThreadCount() const
+{ return uint32_t(m_Threads.size()); }
+
+//-----------------------------------------------------------------------------
+//      ワーカースレッドの処理です.
+//-----------------------------------------------------------------------------
+void ExrEncoder::Run()
+{
+    for(;;)
+    {
+        Task task = {};
+        {
+            std::unique_lock<std::mutex> locker(m_Mutex);
+            m_TaskCond.wait(locker, [&]() { return !m_Tasks.empty() || m_Quit; });
+
+            if (m_Tasks.empty())
+            { return; }
+
+            task = m_Tasks.front();
+            m_Tasks.pop_front();
+        }
+
+        Execute(task);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックを圧縮してチャンクにします.
+//-----------------------------------------------------------------------------
+void ExrEncoder::Execute(const Task& task)
+{
+    auto& job     = *task.pJob;
+    auto& scratch = GetScratch();
+
+    auto lineSize = size_t(job.Width) * CHANNEL_COUNT * sizeof(uint16_t);
+
+    for(auto block=task.BeginBlock; block<task.EndBlock; ++block)
+    {
+        auto beginLine = block * job.LinesPerBlock;
+        auto endLine   = std::min(beginLine + job.LinesPerBlock, job.Height);
+        auto size      = lineSize * (endLine - beginLine);
+
+        // 1行ごとにチャンネル単位で並べる.
+        auto& raw = scratch.Raw;
+        if (raw.size() < size)
+        { raw.resize(size); }
+
+        auto pDst = raw.data();
+        for(auto y=beginLine; y<endLine; ++y)
+        {
+            auto pRow = job.pPixels + size_t(y) * job.Pitch;
+            for(auto c=0u; c<CHANNEL_COUNT; ++c)
+            {
+                auto pSrc = pRow + CHANNEL_INDEX[c] * sizeof(uint16_t);
+                for(auto x=0u; x<job.Width; ++x)
+                {
+                    pDst[0] = pSrc[0];
+                    pDst[1] = pSrc[1];
+                    pDst += 2;
+                    pSrc += SRC_BYTES_PER_PIXEL;
+                }
+            }
+        }
+
+        auto pData    = raw.data();
+        auto dataSize = size;
+
+        if (job.Compression == EXR_COMPRESSION_ZIP)
+        {
+            auto& predicted = scratch.Predicted;
+            if (predicted.size() < size)
+            { predicted.resize(size); }
+
+            Predict(raw.data(), size, predicted.data());
+            CompressZlib(predicted.data(), uint32_t(size), MATCH_DIST, scratch.Compressed);
+
+            // 圧縮しても小さくならないブロックはそのまま格納する (デコーダはサイズで判別する).
+            if (scratch.Compressed.size() < size)
+            {
+                pData    = scratch.Compressed.data();
+                dataSize = scratch.Compressed.size();
+            }
+        }
+
+        auto& chunk = job.Chunks[block];
+        chunk.resize(8 + dataSize);
+        WriteLE32(chunk.data() + 0, beginLine);
+        WriteLE32(chunk.data() + 4, uint32_t(dataSize));
+        memcpy(chunk.data() + 8, pData, dataSize);
+    }
+
+    bool done = false;
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        job.Remaining--;
+        done = (job.Remaining == 0);
+    }
+
+    if (done)
+    { m_DoneCond.notify_all(); }
+}
+
+//-----------------------------------------------------------------------------
+//      OpenEXR をデコードします.
+//-----------------------------------------------------------------------------
+bool DecodeExr
+(
+    const uint8_t*          pData,
+    size_t                  size,
+    std::vector<float>&     pixels,
+    uint32_t&               width,
+    uint32_t&               height
+)
+{
+    if (size < 8 || memcmp(pData, EXR_MAGIC, sizeof(EXR_MAGIC)) != 0)
+    { return false; }
+
+    auto version = ReadLE32(pData + 4);
+    if ((version & 0xFF) != EXR_VERSION || (version & EXR_FLAG_UNSUPPORTED) != 0)
+    { return false; }
+
+    std::vector<ExrChannel> channels;
+    auto    hasY        = false;
+    auto    compression = uint8_t(0xFF);
+    int32_t window[4]   = {};
+    auto    hasWindow   = false;
+
+    // ヘッダーの属性を読み込む.
+    size_t pos = 8;
+    for(;;)
+    {
+        if (pos >= size)
+        { return false; }
+        if (pData[pos] == 0)
+        {
+            pos++;
+            break;
+        }
+
+        auto pName = reinterpret_cast<const char*>(pData + pos);
+        auto nameLength = strnlen(pName, size - pos);
+        pos += nameLength + 1;
+        if (pos >= size)
+        { return false; }
+
+        auto pType = reinterpret_cast<const char*>(pData + pos);
+        auto typeLength = strnlen(pType, size - pos);
+        pos += typeLength + 1;
+        if (pos + 4 > size)
+        { return false; }
+
+        auto attrSize = ReadLE32(pData + pos);
+        pos += 4;
+        if (attrSize > size - pos)
+        { return false; }
+
+        auto pValue = pData + pos;
+        if (strcmp(pName, "channels") == 0)
+        {
+            // 名前順に並んでいるので, 出現順に1行の中での位置を積み上げる.
+            uint32_t offset = 0;
+            size_t   cur    = 0;
+            while(cur < attrSize && pValue[cur] != 0)
+            {
+                auto pChannel = reinterpret_cast<const char*>(pValue + cur);
+                auto length   = strnlen(pChannel, attrSize - cur);
+                cur += length + 1;
+                if (cur + 16 > attrSize)
+                { return false; }
+
+                ExrChannel channel = {};
+                channel.Type   = ReadLE32(pValue + cur);
+                channel.Offset = offset;
+                channel.Target = -1;
+                if (channel.Type > EXR_PIXEL_TYPE_FLOAT
+                 || ReadLE32(pValue + cur + 8) != 1
+                 || ReadLE32(pValue + cur + 12) != 1)
+                { return false; }
+
+                if      (strcmp(pChannel, "R") == 0) { channel.Target = 0; }
+                else if (strcmp(pChannel, "G") == 0) { channel.Target = 1; }
+                else if (strcmp(pChannel, "B") == 0) { channel.Target = 2; }
+                else if (strcmp(pChannel, "A") == 0) { channel.Target = 3; }
+                else if (strcmp(pChannel, "Y") == 0) { channel.Target = 4; hasY = true; }
+
+                offset += (channel.Type == EXR_PIXEL_TYPE_HALF) ? 2 : 4;
+                channels.push_back(channel);
+                cur += 16;
+            }
+        }
+        else if (strcmp(pName, "compression") == 0 && attrSize == 1)
+        { compression = pValue[0]; }
+        else if (strcmp(pName, "dataWindow") == 0 && attrSize == 16)
+        {
+            for(auto i=0; i<4; ++i)
+            { window[i] = int32_t(ReadLE32(pValue + i * 4)); }
+            hasWindow = true;
+        }
+
+        pos += attrSize;
+    }
+
+    if (channels.empty() || !hasWindow || window[2] < window[0] || window[3] < window[1])
+    { return false; }
+
+    uint32_t linesPerBlock = 0;
+    switch(compression)
+    {
+    case EXR_COMPRESSION_NONE:  linesPerBlock = 1; break;
+    case EXR_COMPRESSION_ZIPS:  linesPerBlock = 1; break;
+    case EXR_COMPRESSION_ZIP:   linesPerBlock = ZIP_LINES_PER_BLOCK; break;
+    default: return false;
+    }
+
+    auto w = uint32_t(int64_t(window[2]) - window[0] + 1);
+    auto h = uint32_t(int64_t(window[3]) - window[1] + 1);
+    if (uint64_t(w) * h > (uint64_t(1) << 28))
+    { return false; }
+
+    uint32_t pixelSize = 0;
+    for(auto& channel : channels)
+    { pixelSize += (channel.Type == EXR_PIXEL_TYPE_HALF) ? 2 : 4; }
+
+    auto lineSize   = size_t(w) * pixelSize;
+    auto blockCount = (h + linesPerBlock - 1) / linesPerBlock;
+    if (size - pos < size_t(blockCount) * 8)
+    { return false; }
+
+    pixels.assign(size_t(w) * h * 4, 0.0f);
+    if (hasY)
+    {
+        for(auto& channel : channels)
+        {
+            if (channel.Target >= 0 && channel.Target < 3)
+            { hasY = false; }
+        }
+    }
+
+    // A が無ければ不透明とする.
+    auto hasAlpha = false;
+    for(auto& channel : channels)
+    { hasAlpha |= (channel.Target == 3); }
+    if (!hasAlpha)
+    {
+        for(size_t i=3; i<pixels.size(); i+=4)
+        { pixels[i] = 1.0f; }
+    }
+
+    std::vector<uint8_t> inflated;
+    std::vector<uint8_t> block;
+    for(auto i=0u; i<blockCount; ++i)
+    {
+        uint64_t offset = 0;
+        for(auto k=0; k<8; ++k)
+        { offset |= uint64_t(pData[pos + i * 8 + k]) << (k * 8); }
+        if (offset > size || size - offset < 8)
+        { return false; }
+
+        auto pChunk    = pData + offset;
+        auto beginLine = int64_t(int32_t(ReadLE32(pChunk))) - window[1];
+        auto dataSize  = ReadLE32(pChunk + 4);
+        if (beginLine < 0 || beginLine >= int64_t(h) || dataSize > size - offset - 8)
+        { return false; }
+
+        auto lineCount = std::min(linesPerBlock, h - uint32_t(beginLine));
+        auto rawSize   = lineSize * lineCount;
+        auto pSrc      = pChunk + 8;
+
+        // 圧縮して小さくならないブロックはそのまま格納されている.
+        if (dataSize < rawSize)
+        {
+            if (!DecompressZlib(pSrc, dataSize, inflated) || inflated.size() != rawSize)
+            { return false; }
+
+            block.resize(rawSize);
+            Reconstruct(inflated.data(), rawSize, block.data());
+            pSrc = block.data();
+        }
+        else if (dataSize != rawSize)
+        { return false; }
+
+        for(auto y=0u; y<lineCount; ++y)
+        {
+            auto pLine = pSrc + lineSize * y;
+            auto pDst  = pixels.data() + (size_t(beginLine) + y) * w * 4;
+            for(auto& channel : channels)
+            {
+                if (channel.Target < 0)
+                { continue; }
+
+                auto pValue = pLine + size_t(channel.Offset) * w;
+                for(auto x=0u; x<w; ++x)
+                {
+                    float value;
+                    if (channel.Type == EXR_PIXEL_TYPE_HALF)
+                    { value = HalfToFloat(uint16_t(pValue[x * 2] | (pValue[x * 2 + 1] << 8))); }
+                    else if (channel.Type == EXR_PIXEL_TYPE_FLOAT)
+                    {
+                        auto bits = ReadLE32(pValue + x * 4);
+                        memcpy(&value, &bits, sizeof(value));
+                    }
+                    else
+                    { value = float(ReadLE32(pValue + x * 4)); }
+
+                    // 輝度だけの画像はグレーとして展開する.
+                    if (channel.Target == 4)
+                    {
+                        if (hasY)
+                        { pDst[x * 4 + 0] = pDst[x * 4 + 1] = pDst[x * 4 + 2] = value; }
+                    }
+                    else
+                    { pDst[x * 4 + channel.Target] = value; }
+                }
+            }
+        }
+    }
+
+    width  = w;
+    height = h;
+    return true;
+}
+
+} // namespace r3d
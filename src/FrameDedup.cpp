@@ -0,0 +1,314 @@
+﻿//-----------------------------------------------------------------------------
+// File : FrameDedup.cpp
+// Desc : Duplicate Capture Frame Detection.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <FrameDedup.h>
+#include <Platform.h>
+#include <xxhash.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DEDUP_ENABLE_SSE2   (1)
+#include <emmintrin.h>
+#else
+#define DEDUP_ENABLE_SSE2   (0)
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t DEFAULT_TILE_SIZE = 64;
+static const uint8_t  STATUS_PENDING    = 0;
+static const uint8_t  STATUS_SUCCESS    = 1;
+static const uint8_t  STATUS_FAILED     = 2;
+
+//-----------------------------------------------------------------------------
+//      経過時間を秒で取得します.
+//-----------------------------------------------------------------------------
+inline double GetElapsedSec(const std::chrono::steady_clock::time_point& begin)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+//-----------------------------------------------------------------------------
+//      矩形のハッシュを計算します.
+//-----------------------------------------------------------------------------
+uint64_t CalcRectHash(const uint8_t* pPixels, uint32_t pitch, uint32_t rowSize, uint32_t rowCount)
+{
+    uint64_t hash = 0;
+    for(auto y=0u; y<rowCount; ++y)
+    { hash = XXH3_64bits_withSeed(pPixels + size_t(y) * pitch, rowSize, hash); }
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+//      全てのバイトの差が許容差以内かどうかチェックします.
+//-----------------------------------------------------------------------------
+bool IsWithinTolerance(const uint8_t* pLhs, const uint8_t* pRhs, uint32_t size, uint8_t tolerance)
+{
+    auto i = 0u;
+
+#if DEDUP_ENABLE_SSE2
+    auto tol  = _mm_set1_epi8(char(tolerance));
+    auto zero = _mm_setzero_si128();
+    for(; i + 16 <= size; i += 16)
+    {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pLhs + i));
+        auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRhs + i));
+
+        // |a - b| - tolerance が全て 0 なら許容差以内.
+        auto diff = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+        auto over = _mm_subs_epu8(diff, tol);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(over, zero)) != 0xFFFF)
+        { return false; }
+    }
+#endif
+
+    for(; i<size; ++i)
+    {
+        if (abs(int(pLhs[i]) - int(pRhs[i])) > tolerance)
+        { return false; }
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// FrameDedup class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool FrameDedup::Init(const FrameDedupDesc& desc)
+{
+    if (desc.Width == 0 || desc.Height == 0 || desc.Tolerance > 255)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    Term();
+
+    m_Width     = desc.Width;
+    m_Height    = desc.Height;
+    m_Tolerance = desc.Tolerance;
+    m_TileSize  = (desc.TileSize > 0) ? desc.TileSize : DEFAULT_TILE_SIZE;
+
+    if (m_Tolerance > 0)
+    {
+        auto tileX = (m_Width  + m_TileSize - 1) / m_TileSize;
+        auto tileY = (m_Height + m_TileSize - 1) / m_TileSize;
+        m_TileHashes.resize(size_t(tileX) * tileY);
+        m_CurrHashes.resize(size_t(tileX) * tileY);
+        m_Source    .resize(size_t(m_Width) * m_Height * 4);
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void FrameDedup::Term()
+{
+    m_TileHashes.clear();
+    m_TileHashes.shrink_to_fit();
+    m_CurrHashes.clear();
+    m_CurrHashes.shrink_to_fit();
+    m_Source.clear();
+    m_Source.shrink_to_fit();
+
+    m_Width       = 0;
+    m_Height      = 0;
+    m_Tolerance   = 0;
+    m_TileSize    = 0;
+    m_SourceIndex = 0;
+    m_SourceHash  = 0;
+    m_HasSource   = false;
+
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    m_Status.clear();
+    m_Stats = {};
+}
+
+//-----------------------------------------------------------------------------
+//      直前に出力したフレームと同じ内容かどうか判定します.
+//-----------------------------------------------------------------------------
+uint32_t FrameDedup::Check(uint32_t frameIndex, const uint8_t* pPixels, uint32_t pitch)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    auto     duplicate    = false;
+    uint64_t compareCount = 0;
+    if (m_Tolerance == 0)
+    {
+        auto hash = CalcRectHash(pPixels, pitch, m_Width * 4, m_Height);
+        duplicate = m_HasSource && (hash == m_SourceHash);
+        if (!duplicate)
+        {
+            m_SourceHash  = hash;
+            m_SourceIndex = frameIndex;
+            m_HasSource   = true;
+        }
+    }
+    else
+    {
+        duplicate = m_HasSource && IsSimilar(pPixels, pitch, compareCount);
+        if (!duplicate)
+        { SetSource(frameIndex, pPixels, pitch); }
+    }
+
+    auto sec = GetElapsedSec(begin);
+
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (duplicate)
+    { m_Stats.DuplicateCount++; }
+    else
+    {
+        if (m_Status.size() <= frameIndex)
+        { m_Status.resize(size_t(frameIndex) + 1, STATUS_PENDING); }
+        m_Status[frameIndex] = STATUS_PENDING;
+    }
+    m_Stats.CheckCount++;
+    m_Stats.CompareTileCount += compareCount;
+    m_Stats.CheckSec += sec;
+
+    return m_SourceIndex;
+}
+
+//-----------------------------------------------------------------------------
+//      フレームの出力が完了したことを通知します.
+//-----------------------------------------------------------------------------
+void FrameDedup::MarkWritten(uint32_t frameIndex, bool success, double encodeSec)
+{
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        if (m_Status.size() <= frameIndex)
+        { m_Status.resize(size_t(frameIndex) + 1, STATUS_PENDING); }
+        m_Status[frameIndex] = success ? STATUS_SUCCESS : STATUS_FAILED;
+
+        if (success)
+        {
+            m_Stats.WrittenCount++;
+            m_Stats.EncodeSec += encodeSec;
+        }
+    }
+    m_WrittenCond.notify_all();
+}
+
+//-----------------------------------------------------------------------------
+//      フレームの出力が完了するまで待ちます.
+//-----------------------------------------------------------------------------
+bool FrameDedup::WaitWritten(uint32_t frameIndex)
+{
+    // 出力元は重複フレームより先にエンコードプールへ投入されているので,
+    // 先に取り出したワーカーが処理中であり待ち続けることはない.
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_WrittenCond.wait(lock, [&]()
+    { return frameIndex < m_Status.size() && m_Status[frameIndex] != STATUS_PENDING; });
+    return m_Status[frameIndex] == STATUS_SUCCESS;
+}
+
+//-----------------------------------------------------------------------------
+//      統計情報を取得します.
+//-----------------------------------------------------------------------------
+FrameDedupStats FrameDedup::GetStats() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    auto result = m_Stats;
+
+    // 重複フレームも出力元と同じ時間が掛かったものとして見積もる.
+    if (result.WrittenCount > 0)
+    { result.SavedSec = result.EncodeSec / double(result.WrittenCount) * double(result.DuplicateCount); }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      出力元のフレームと許容差以内かどうかチェックします.
+//-----------------------------------------------------------------------------
+bool FrameDedup::IsSimilar(const uint8_t* pPixels, uint32_t pitch, uint64_t& compareCount)
+{
+    // 重複でない場合は出力元を差し替えるので, 先に全タイルのハッシュを求めておく.
+    CalcTileHashes(pPixels, pitch, m_CurrHashes);
+
+    auto srcPitch  = size_t(m_Width) * 4;
+    auto tolerance = uint8_t(m_Tolerance);
+
+    for(auto y=0u, tile=0u; y<m_Height; y+=m_TileSize)
+    {
+        auto rowCount = (y + m_TileSize <= m_Height) ? m_TileSize : m_Height - y;
+
+        for(auto x=0u; x<m_Width; x+=m_TileSize, ++tile)
+        {
+            if (m_CurrHashes[tile] == m_TileHashes[tile])
+            { continue; }
+
+            compareCount++;
+
+            auto rowSize = ((x + m_TileSize <= m_Width) ? m_TileSize : m_Width - x) * 4;
+            auto pCurr   = pPixels + size_t(y) * pitch + x * 4;
+            auto pSrc    = m_Source.data() + y * srcPitch + x * 4;
+            for(auto i=0u; i<rowCount; ++i)
+            {
+                if (!IsWithinTolerance(pCurr + size_t(i) * pitch, pSrc + i * srcPitch, rowSize, tolerance))
+                { return false; }
+            }
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      出力元のフレームを差し替えます.
+//-----------------------------------------------------------------------------
+void FrameDedup::SetSource(uint32_t frameIndex, const uint8_t* pPixels, uint32_t pitch)
+{
+    // 最初のフレームは IsSimilar() を通らないのでここでハッシュを求める.
+    if (!m_HasSource)
+    { CalcTileHashes(pPixels, pitch, m_CurrHashes); }
+
+    auto rowSize = size_t(m_Width) * 4;
+    for(auto y=0u; y<m_Height; ++y)
+    { memcpy(m_Source.data() + rowSize * y, pPixels + size_t(y) * pitch, rowSize); }
+
+    m_TileHashes.swap(m_CurrHashes);
+    m_SourceIndex = frameIndex;
+    m_HasSource   = true;
+}
+
+//-----------------------------------------------------------------------------
+//      タイルごとのハッシュを計算します.
+//-----------------------------------------------------------------------------
+void FrameDedup::CalcTileHashes(const uint8_t* pPixels, uint32_t pitch, std::vector<uint64_t>& result) const
+{
+    for(auto y=0u, tile=0u; y<m_Height; y+=m_TileSize)
+    {
+        auto rowCount = (y + m_TileSize <= m_Height) ? m_TileSize : m_Height - y;
+        for(auto x=0u; x<m_Width; x+=m_TileSize, ++tile)
+        {
+            auto rowSize = ((x + m_TileSize <= m_Width) ? m_TileSize : m_Width - x) * 4;
+            result[tile] = CalcRectHash(pPixels + size_t(y) * pitch + x * 4, pitch, rowSize, rowCount);
+        }
+    }
+}
+
+} // namespace r3d
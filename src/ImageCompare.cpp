@@ -0,0 +1,972 @@
+﻿//-----------------------------------------------------------------------------
+// File : ImageCompare.cpp
+// Desc : Image Comparison Metrics.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ImageCompare.h>
+#include <PngEncoder.h>
+#include <QoiEncoder.h>
+#include <ExrEncoder.h>
+#include <Platform.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define IMGCMP_ENABLE_AVX2  (1)
+#include <immintrin.h>
+#else
+#define IMGCMP_ENABLE_AVX2  (0)
+#endif
+
+#if !IMGCMP_ENABLE_AVX2 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IMGCMP_ENABLE_SSE2  (1)
+#include <emmintrin.h>
+#else
+#define IMGCMP_ENABLE_SSE2  (0)
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t DEFAULT_TILE_SIZE = 32;
+static const uint32_t ROW_ALIGNMENT     = 8;        // 作業領域の行を AVX2 の幅に揃える.
+static const uint32_t SSIM_WINDOW       = 8;
+static const uint32_t SSIM_STEP         = 4;
+static const double   SSIM_C1           = 0.01 * 0.01;
+static const double   SSIM_C2           = 0.03 * 0.03;
+static const float    FLIP_QC           = 0.7f;
+static const float    FLIP_PC           = 0.4f;
+static const float    FLIP_PT           = 0.95f;
+static const float    WHITE_X           = 0.950456f;    // D65 の白色点.
+static const float    WHITE_Z           = 1.088754f;
+static const int      MAX_BLUR_RADIUS   = 9;
+
+// FLIP の CSF を 67 ppd (0.7m の距離から見た 4K モニタ) で1つの Gaussian に近似した標準偏差[px].
+// Yy, Cx, Cz の順.
+static const float    CSF_SIGMA[3]      = { 1.0f, 1.1f, 2.8f };
+
+// 作業領域の平面.
+static const uint32_t PLANE_REF_LUMA    = 0;        // SSIM の後はエッジの差に使う.
+static const uint32_t PLANE_TEST_LUMA   = 1;
+static const uint32_t PLANE_REF_YCC     = 2;
+static const uint32_t PLANE_TEST_YCC    = 5;
+static const uint32_t PLANE_TEMP        = 8;
+static const uint32_t PLANE_COUNT       = 9;
+
+//-----------------------------------------------------------------------------
+// SIMD Wrappers.
+//-----------------------------------------------------------------------------
+#if IMGCMP_ENABLE_AVX2
+typedef __m256  VFloat;
+typedef __m256i VInt;
+static const uint32_t LANE_COUNT = 8;
+
+inline VFloat VLoad (const float* p)                    { return _mm256_loadu_ps(p); }
+inline void   VStore(float* p, VFloat v)                { _mm256_storeu_ps(p, v); }
+inline VFloat VSet  (float v)                           { return _mm256_set1_ps(v); }
+inline VFloat VAdd  (VFloat a, VFloat b)                { return _mm256_add_ps(a, b); }
+inline VFloat VSub  (VFloat a, VFloat b)                { return _mm256_sub_ps(a, b); }
+inline VFloat VMul  (VFloat a, VFloat b)                { return _mm256_mul_ps(a, b); }
+inline VFloat VDiv  (VFloat a, VFloat b)                { return _mm256_div_ps(a, b); }
+inline VFloat VMin  (VFloat a, VFloat b)                { return _mm256_min_ps(a, b); }
+inline VFloat VMax  (VFloat a, VFloat b)                { return _mm256_max_ps(a, b); }
+inline VFloat VSqrt (VFloat a)                          { return _mm256_sqrt_ps(a); }
+inline VFloat VAbs  (VFloat a)                          { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+inline VFloat VMulAdd(VFloat a, VFloat b, VFloat c)     { return _mm256_fmadd_ps(a, b, c); }
+inline VInt   VRound(VFloat a)                          { return _mm256_cvtps_epi32(a); }
+inline VFloat VToFloat(VInt a)                          { return _mm256_cvtepi32_ps(a); }
+inline VInt   VAsInt  (VFloat a)                        { return _mm256_castps_si256(a); }
+inline VFloat VAsFloat(VInt a)                          { return _mm256_castsi256_ps(a); }
+inline VInt   VSetInt (int32_t v)                       { return _mm256_set1_epi32(v); }
+inline VInt   VAddInt (VInt a, VInt b)                  { return _mm256_add_epi32(a, b); }
+inline VInt   VSubInt (VInt a, VInt b)                  { return _mm256_sub_epi32(a, b); }
+inline VInt   VAndInt (VInt a, VInt b)                  { return _mm256_and_si256(a, b); }
+inline VInt   VOrInt  (VInt a, VInt b)                  { return _mm256_or_si256(a, b); }
+inline VInt   VShiftLeft23 (VInt a)                     { return _mm256_slli_epi32(a, 23); }
+inline VInt   VShiftRight23(VInt a)                     { return _mm256_srli_epi32(a, 23); }
+
+// a > b ? x : y
+inline VFloat VSelectGreater(VFloat a, VFloat b, VFloat x, VFloat y)
+{ return _mm256_blendv_ps(y, x, _mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+
+inline float VSum(VFloat v)
+{
+    auto s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#elif IMGCMP_ENABLE_SSE2
+typedef __m128  VFloat;
+typedef __m128i VInt;
+static const uint32_t LANE_COUNT = 4;
+
+inline VFloat VLoad (const float* p)                    { return _mm_loadu_ps(p); }
+inline void   VStore(float* p, VFloat v)                { _mm_storeu_ps(p, v); }
+inline VFloat VSet  (float v)                           { return _mm_set1_ps(v); }
+inline VFloat VAdd  (VFloat a, VFloat b)                { return _mm_add_ps(a, b); }
+inline VFloat VSub  (VFloat a, VFloat b)                { return _mm_sub_ps(a, b); }
+inline VFloat VMul  (VFloat a, VFloat b)                { return _mm_mul_ps(a, b); }
+inline VFloat VDiv  (VFloat a, VFloat b)                { return _mm_div_ps(a, b); }
+inline VFloat VMin  (VFloat a, VFloat b)                { return _mm_min_ps(a, b); }
+inline VFloat VMax  (VFloat a, VFloat b)                { return _mm_max_ps(a, b); }
+inline VFloat VSqrt (VFloat a)                          { return _mm_sqrt_ps(a); }
+inline VFloat VAbs  (VFloat a)                          { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline VFloat VMulAdd(VFloat a, VFloat b, VFloat c)     { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline VInt   VRound(VFloat a)                          { return _mm_cvtps_epi32(a); }
+inline VFloat VToFloat(VInt a)                          { return _mm_cvtepi32_ps(a); }
+inline VInt   VAsInt  (VFloat a)                        { return _mm_castps_si128(a); }
+inline VFloat VAsFloat(VInt a)                          { return _mm_castsi128_ps(a); }
+inline VInt   VSetInt (int32_t v)                       { return _mm_set1_epi32(v); }
+inline VInt   VAddInt (VInt a, VInt b)                  { return _mm_add_epi32(a, b); }
+inline VInt   VSubInt (VInt a, VInt b)                  { return _mm_sub_epi32(a, b); }
+inline VInt   VAndInt (VInt a, VInt b)                  { return _mm_and_si128(a, b); }
+inline VInt   VOrInt  (VInt a, VInt b)                  { return _mm_or_si128(a, b); }
+inline VInt   VShiftLeft23 (VInt a)                     { return _mm_slli_epi32(a, 23); }
+inline VInt   VShiftRight23(VInt a)                     { return _mm_srli_epi32(a, 23); }
+
+// a > b ? x : y
+inline VFloat VSelectGreater(VFloat a, VFloat b, VFloat x, VFloat y)
+{
+    auto mask = _mm_cmpgt_ps(a, b);
+    return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y));
+}
+
+inline float VSum(VFloat v)
+{
+    auto s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+#else
+typedef float   VFloat;
+typedef int32_t VInt;
+static const uint32_t LANE_COUNT = 1;
+
+inline VFloat VLoad (const float* p)                    { return *p; }
+inline void   VStore(float* p, VFloat v)                { *p = v; }
+inline VFloat VSet  (float v)                           { return v; }
+inline VFloat VAdd  (VFloat a, VFloat b)                { return a + b; }
+inline VFloat VSub  (VFloat a, VFloat b)                { return a - b; }
+inline VFloat VMul  (VFloat a, VFloat b)                { return a * b; }
+inline VFloat VDiv  (VFloat a, VFloat b)                { return a / b; }
+inline VFloat VMin  (VFloat a, VFloat b)                { return (b < a) ? b : a; }
+inline VFloat VMax  (VFloat a, VFloat b)                { return (a < b) ? b : a; }
+inline VFloat VSqrt (VFloat a)                          { return sqrtf(a); }
+inline VFloat VAbs  (VFloat a)                          { return fabsf(a); }
+inline VFloat VMulAdd(VFloat a, VFloat b, VFloat c)     { return a * b + c; }
+inline VInt   VRound(VFloat a)                          { return int32_t(lrintf(a)); }
+inline VFloat VToFloat(VInt a)                          { return float(a); }
+inline VInt   VAsInt  (VFloat a)                        { VInt r; memcpy(&r, &a, sizeof(r)); return r; }
+inline VFloat VAsFloat(VInt a)                          { VFloat r; memcpy(&r, &a, sizeof(r)); return r; }
+inline VInt   VSetInt (int32_t v)                       { return v; }
+inline VInt   VAddInt (VInt a, VInt b)                  { return a + b; }
+inline VInt   VSubInt (VInt a, VInt b)                  { return a - b; }
+inline VInt   VAndInt (VInt a, VInt b)                  { return a & b; }
+inline VInt   VOrInt  (VInt a, VInt b)                  { return a | b; }
+inline VInt   VShiftLeft23 (VInt a)                     { return VInt(uint32_t(a) << 23); }
+inline VInt   VShiftRight23(VInt a)                     { return VInt(uint32_t(a) >> 23); }
+
+// a > b ? x : y
+inline VFloat VSelectGreater(VFloat a, VFloat b, VFloat x, VFloat y)
+{ return (a > b) ? x : y; }
+
+inline float VSum(VFloat v)
+{ return v; }
+#endif
+
+//-----------------------------------------------------------------------------
+//      2を底とする対数を求めます (x > 0).
+//-----------------------------------------------------------------------------
+inline VFloat VLog2(VFloat x)
+{
+    // x = m * 2^e (1 <= m < 2) に分解し, log2(m) を atanh の級数で求める.
+    auto bits = VAsInt(x);
+    auto e    = VSubInt(VShiftRight23(bits), VSetInt(127));
+    auto m    = VAsFloat(VOrInt(VAndInt(bits, VSetInt(0x007FFFFF)), VSetInt(0x3F800000)));
+
+    auto one = VSet(1.0f);
+    auto t   = VDiv(VSub(m, one), VAdd(m, one));
+    auto t2  = VMul(t, t);
+    auto p   = VMulAdd(t2, VSet(1.0f / 9.0f), VSet(1.0f / 7.0f));
+    p = VMulAdd(t2, p, VSet(1.0f / 5.0f));
+    p = VMulAdd(t2, p, VSet(1.0f / 3.0f));
+    p = VMulAdd(t2, p, one);
+    p = VMul(VMul(p, t), VSet(2.0f / 0.69314718f));
+
+    return VAdd(VToFloat(e), p);
+}
+
+//-----------------------------------------------------------------------------
+//      2のべき乗を求めます.
+//-----------------------------------------------------------------------------
+inline VFloat VExp2(VFloat y)
+{
+    // y = n + f (|f| <= 0.5) に分解し, 2^f を Taylor 展開で求める.
+    y = VMin(VMax(y, VSet(-126.0f)), VSet(126.0f));
+    auto n = VRound(y);
+    auto f = VMul(VSub(y, VToFloat(n)), VSet(0.69314718f));
+
+    auto p = VMulAdd(f, VSet(1.0f / 720.0f), VSet(1.0f / 120.0f));
+    p = VMulAdd(f, p, VSet(1.0f / 24.0f));
+    p = VMulAdd(f, p, VSet(1.0f / 6.0f));
+    p = VMulAdd(f, p, VSet(0.5f));
+    p = VMulAdd(f, p, VSet(1.0f));
+    p = VMulAdd(f, p, VSet(1.0f));
+
+    auto scale = VAsFloat(VShiftLeft23(VAddInt(n, VSetInt(127))));
+    return VMul(p, scale);
+}
+
+//-----------------------------------------------------------------------------
+//      べき乗を求めます (x <= 0 の場合は 0 とみなします).
+//-----------------------------------------------------------------------------
+inline VFloat VPow(VFloat x, VFloat y)
+{
+    auto zero = VSet(0.0f);
+    auto p    = VExp2(VMul(y, VLog2(VMax(x, VSet(1e-30f)))));
+    return VSelectGreater(x, zero, p, zero);
+}
+
+//-----------------------------------------------------------------------------
+//      sRGB の表示値をリニアに変換します.
+//-----------------------------------------------------------------------------
+inline VFloat SrgbToLinear(VFloat v)
+{
+    auto lo = VMul(v, VSet(1.0f / 12.92f));
+    auto hi = VPow(VMul(VAdd(v, VSet(0.055f)), VSet(1.0f / 1.055f)), VSet(2.4f));
+    return VSelectGreater(v, VSet(0.04045f), hi, lo);
+}
+
+//-----------------------------------------------------------------------------
+//      リニア RGB を白色点で正規化した XYZ に変換します.
+//-----------------------------------------------------------------------------
+inline void LinearToXyz(VFloat r, VFloat g, VFloat b, VFloat& x, VFloat& y, VFloat& z)
+{
+    x = VMulAdd(r, VSet(0.4124564f / WHITE_X), VMulAdd(g, VSet(0.3575761f / WHITE_X), VMul(b, VSet(0.1804375f / WHITE_X))));
+    y = VMulAdd(r, VSet(0.2126729f          ), VMulAdd(g, VSet(0.7151522f          ), VMul(b, VSet(0.0721750f          ))));
+    z = VMulAdd(r, VSet(0.0193339f / WHITE_Z), VMulAdd(g, VSet(0.1191920f / WHITE_Z), VMul(b, VSet(0.9503041f / WHITE_Z))));
+}
+
+//-----------------------------------------------------------------------------
+//      sRGB の表示値を YyCxCz に変換します.
+//-----------------------------------------------------------------------------
+inline void SrgbToYcc(VFloat r, VFloat g, VFloat b, VFloat* pResult)
+{
+    VFloat x, y, z;
+    LinearToXyz(SrgbToLinear(r), SrgbToLinear(g), SrgbToLinear(b), x, y, z);
+    pResult[0] = VMulAdd(y, VSet(116.0f), VSet(-16.0f));
+    pResult[1] = VMul(VSub(x, y), VSet(500.0f));
+    pResult[2] = VMul(VSub(y, z), VSet(200.0f));
+}
+
+//-----------------------------------------------------------------------------
+//      L*a*b* の非線形変換を行います.
+//-----------------------------------------------------------------------------
+inline VFloat LabCurve(VFloat t)
+{
+    auto lo = VMulAdd(t, VSet(7.787037f), VSet(4.0f / 29.0f));
+    auto hi = VPow(t, VSet(1.0f / 3.0f));
+    return VSelectGreater(t, VSet(0.008856452f), hi, lo);
+}
+
+//-----------------------------------------------------------------------------
+//      YyCxCz を Hunt 効果を補正した L*a*b* に変換します.
+//-----------------------------------------------------------------------------
+inline void YccToHuntLab(VFloat yy, VFloat cx, VFloat cz, VFloat* pResult)
+{
+    // フィルタ後の色は sRGB の色域外になり得るので, リニア RGB に戻してクランプする.
+    auto y = VMul(VAdd(yy, VSet(16.0f)), VSet(1.0f / 116.0f));
+    auto x = VMul(VMulAdd(cx, VSet(1.0f / 500.0f), y), VSet(WHITE_X));
+    auto z = VMul(VSub(y, VMul(cz, VSet(1.0f / 200.0f))), VSet(WHITE_Z));
+
+    auto zero = VSet(0.0f);
+    auto one  = VSet(1.0f);
+    auto r = VMulAdd(x, VSet( 3.2404542f), VMulAdd(y, VSet(-1.5371385f), VMul(z, VSet(-0.4985314f))));
+    auto g = VMulAdd(x, VSet(-0.9692660f), VMulAdd(y, VSet( 1.8760108f), VMul(z, VSet( 0.0415560f))));
+    auto b = VMulAdd(x, VSet( 0.0556434f), VMulAdd(y, VSet(-0.2040259f), VMul(z, VSet( 1.0572252f))));
+    r = VMin(VMax(r, zero), one);
+    g = VMin(VMax(g, zero), one);
+    b = VMin(VMax(b, zero), one);
+
+    LinearToXyz(r, g, b, x, y, z);
+    auto fx = LabCurve(x);
+    auto fy = LabCurve(y);
+    auto fz = LabCurve(z);
+
+    auto l     = VMulAdd(fy, VSet(116.0f), VSet(-16.0f));
+    auto scale = VMul(l, VSet(0.01f));
+    pResult[0] = l;
+    pResult[1] = VMul(VMul(VSub(fx, fy), VSet(500.0f)), scale);
+    pResult[2] = VMul(VMul(VSub(fy, fz), VSet(200.0f)), scale);
+}
+
+//-----------------------------------------------------------------------------
+//      2色の HyAB 距離を求めます.
+//-----------------------------------------------------------------------------
+inline VFloat HyAB(const VFloat* pLhs, const VFloat* pRhs)
+{
+    auto dl = VAbs(VSub(pLhs[0], pRhs[0]));
+    auto da = VSub(pLhs[1], pRhs[1]);
+    auto db = VSub(pLhs[2], pRhs[2]);
+    return VAdd(dl, VSqrt(VMulAdd(da, da, VMul(db, db))));
+}
+
+//-----------------------------------------------------------------------------
+//      色差の最大値を求めます.
+//-----------------------------------------------------------------------------
+float CalcMaxColorError()
+{
+    // FLIP と同様に, 緑と青の距離を最大値とする.
+    VFloat green[3], blue[3], labG[3], labB[3];
+    SrgbToYcc(VSet(0.0f), VSet(1.0f), VSet(0.0f), green);
+    SrgbToYcc(VSet(0.0f), VSet(0.0f), VSet(1.0f), blue);
+    YccToHuntLab(green[0], green[1], green[2], labG);
+    YccToHuntLab(blue [0], blue [1], blue [2], labB);
+
+    float lanes[LANE_COUNT];
+    VStore(lanes, VPow(HyAB(labG, labB), VSet(FLIP_QC)));
+    return lanes[0];
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Scratch structure
+///////////////////////////////////////////////////////////////////////////////
+struct Scratch
+{
+    std::vector<float>  Planes;     //!< 画像全体の作業領域.
+    std::vector<float>  Rows;       //!< 行単位の作業領域.
+};
+
+//-----------------------------------------------------------------------------
+//      スレッドごとの作業領域を取得します.
+//-----------------------------------------------------------------------------
+Scratch& GetScratch()
+{
+    static thread_local Scratch s_Scratch;
+    return s_Scratch;
+}
+
+//-----------------------------------------------------------------------------
+//      行の左右を端の値で埋めてコピーします.
+//-----------------------------------------------------------------------------
+void PadRow(const float* pSrc, uint32_t width, uint32_t stride, uint32_t pad, float* pDst)
+{
+    // 右側は SIMD の読み出しがはみ出す分も埋める.
+    std::fill(pDst, pDst + pad, pSrc[0]);
+    memcpy(pDst + pad, pSrc, width * sizeof(float));
+    std::fill(pDst + pad + width, pDst + stride + pad * 2 + LANE_COUNT, pSrc[width - 1]);
+}
+
+//-----------------------------------------------------------------------------
+//      1行を比較用の色空間に変換し, 二乗誤差の合計を返却します.
+//-----------------------------------------------------------------------------
+float PrepareRow
+(
+    const float* const* ppRef,
+    const float* const* ppTest,
+    uint32_t            stride,
+    float*              pRefLuma,
+    float*              pTestLuma,
+    float* const*       ppRefYcc,
+    float* const*       ppTestYcc
+)
+{
+    auto sum = VSet(0.0f);
+    for(auto x=0u; x<stride; x+=LANE_COUNT)
+    {
+        VFloat ref [3] = { VLoad(ppRef [0] + x), VLoad(ppRef [1] + x), VLoad(ppRef [2] + x) };
+        VFloat test[3] = { VLoad(ppTest[0] + x), VLoad(ppTest[1] + x), VLoad(ppTest[2] + x) };
+
+        for(auto c=0; c<3; ++c)
+        {
+            auto d = VSub(ref[c], test[c]);
+            sum = VMulAdd(d, d, sum);
+        }
+
+        // SSIM は表示値の輝度で求める.
+        auto kr = VSet(0.2126f);
+        auto kg = VSet(0.7152f);
+        auto kb = VSet(0.0722f);
+        VStore(pRefLuma  + x, VMulAdd(ref [0], kr, VMulAdd(ref [1], kg, VMul(ref [2], kb))));
+        VStore(pTestLuma + x, VMulAdd(test[0], kr, VMulAdd(test[1], kg, VMul(test[2], kb))));
+
+        VFloat ycc[3];
+        SrgbToYcc(ref[0], ref[1], ref[2], ycc);
+        for(auto c=0; c<3; ++c)
+        { VStore(ppRefYcc[c] + x, ycc[c]); }
+
+        SrgbToYcc(test[0], test[1], test[2], ycc);
+        for(auto c=0; c<3; ++c)
+        { VStore(ppTestYcc[c] + x, ycc[c]); }
+    }
+    return VSum(sum);
+}
+
+//-----------------------------------------------------------------------------
+//      モーメントから SSIM を求めます.
+//-----------------------------------------------------------------------------
+double CalcSsimFromMoments(double sx, double sy, double sxx, double syy, double sxy, double n)
+{
+    auto mx  = sx / n;
+    auto my  = sy / n;
+    auto vx  = sxx / n - mx * mx;
+    auto vy  = syy / n - my * my;
+    auto cxy = sxy / n - mx * my;
+    return ((2.0 * mx * my + SSIM_C1) * (2.0 * cxy + SSIM_C2))
+         / ((mx * mx + my * my + SSIM_C1) * (vx + vy + SSIM_C2));
+}
+
+//-----------------------------------------------------------------------------
+//      輝度の SSIM を求めます.
+//-----------------------------------------------------------------------------
+double CalcSsim(const float* pRef, const float* pTest, uint32_t width, uint32_t height, uint32_t stride)
+{
+    // 窓より小さい画像は全体を1つの窓とする.
+    if (width < SSIM_WINDOW || height < SSIM_WINDOW)
+    {
+        double sx = 0.0, sy = 0.0, sxx = 0.0, syy = 0.0, sxy = 0.0;
+        for(auto y=0u; y<height; ++y)
+        {
+            for(auto x=0u; x<width; ++x)
+            {
+                double a = pRef [y * stride + x];
+                double b = pTest[y * stride + x];
+                sx += a; sy += b; sxx += a * a; syy += b * b; sxy += a * b;
+            }
+        }
+        return CalcSsimFromMoments(sx, sy, sxx, syy, sxy, double(width) * height);
+    }
+
+    double   sum   = 0.0;
+    uint64_t count = 0;
+    for(auto y=0u; y + SSIM_WINDOW <= height; y += SSIM_STEP)
+    {
+        for(auto x=0u; x + SSIM_WINDOW <= width; x += SSIM_STEP)
+        {
+            auto sx  = VSet(0.0f);
+            auto sy  = VSet(0.0f);
+            auto sxx = VSet(0.0f);
+            auto syy = VSet(0.0f);
+            auto sxy = VSet(0.0f);
+            for(auto i=0u; i<SSIM_WINDOW; ++i)
+            {
+                auto offset = size_t(y + i) * stride + x;
+                for(auto j=0u; j<SSIM_WINDOW; j+=LANE_COUNT)
+                {
+                    auto a = VLoad(pRef  + offset + j);
+                    auto b = VLoad(pTest + offset + j);
+                    sx  = VAdd(sx, a);
+                    sy  = VAdd(sy, b);
+                    sxx = VMulAdd(a, a, sxx);
+                    syy = VMulAdd(b, b, syy);
+                    sxy = VMulAdd(a, b, sxy);
+                }
+            }
+
+            sum += CalcSsimFromMoments(VSum(sx), VSum(sy), VSum(sxx), VSum(syy), VSum(sxy), double(SSIM_WINDOW * SSIM_WINDOW));
+            count++;
+        }
+    }
+    return sum / double(count);
+}
+
+//-----------------------------------------------------------------------------
+//      Sobel フィルタで勾配の大きさを求めます.
+//-----------------------------------------------------------------------------
+inline VFloat CalcGradient(const float* const* ppRows, uint32_t x)
+{
+    auto two = VSet(2.0f);
+    auto a0 = VLoad(ppRows[0] + x - 1);
+    auto a1 = VLoad(ppRows[0] + x);
+    auto a2 = VLoad(ppRows[0] + x + 1);
+    auto b0 = VLoad(ppRows[1] + x - 1);
+    auto b2 = VLoad(ppRows[1] + x + 1);
+    auto c0 = VLoad(ppRows[2] + x - 1);
+    auto c1 = VLoad(ppRows[2] + x);
+    auto c2 = VLoad(ppRows[2] + x + 1);
+
+    auto gx = VSub(VAdd(VMulAdd(b2, two, a2), c2), VAdd(VMulAdd(b0, two, a0), c0));
+    auto gy = VSub(VAdd(VMulAdd(c1, two, c0), c2), VAdd(VMulAdd(a1, two, a0), a2));
+
+    // Yy を輝度 [0, 1] に戻し, 各軸の勾配を [-1, 1] に正規化する.
+    auto scale = VSet(1.0f / (4.0f * 116.0f));
+    gx = VMul(gx, scale);
+    gy = VMul(gy, scale);
+    return VSqrt(VMulAdd(gx, gx, VMul(gy, gy)));
+}
+
+//-----------------------------------------------------------------------------
+//      1行分のエッジの差を求めます.
+//-----------------------------------------------------------------------------
+void CalcFeatureRow
+(
+    const float* const* ppRef,
+    const float* const* ppTest,
+    uint32_t            stride,
+    float*              pResult
+)
+{
+    auto scale = VSet(0.70710678f);
+    auto one   = VSet(1.0f);
+    for(auto x=0u; x<stride; x+=LANE_COUNT)
+    {
+        auto d = VAbs(VSub(CalcGradient(ppRef, x), CalcGradient(ppTest, x)));
+        VStore(pResult + x, VSqrt(VMin(VMul(d, scale), one)));
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      平面に Gaussian フィルタを掛けます.
+//-----------------------------------------------------------------------------
+void BlurPlane
+(
+    float*      pPlane,
+    float*      pTemp,
+    float*      pRow,
+    uint32_t    width,
+    uint32_t    height,
+    uint32_t    stride,
+    float       sigma
+)
+{
+    auto radius = std::min(int(ceilf(sigma * 3.0f)), MAX_BLUR_RADIUS);
+
+    float weights[MAX_BLUR_RADIUS + 1];
+    auto total = 0.0f;
+    for(auto k=0; k<=radius; ++k)
+    {
+        weights[k] = expf(-float(k * k) / (2.0f * sigma * sigma));
+        total += (k == 0) ? weights[k] : weights[k] * 2.0f;
+    }
+    for(auto k=0; k<=radius; ++k)
+    { weights[k] /= total; }
+
+    // 縦方向. 行を連続して読むように, 出力行に1行ずつ足し込む.
+    auto last = int(height) - 1;
+    for(auto y=0; y<=last; ++y)
+    {
+        auto pDst = pTemp  + size_t(y) * stride;
+        auto pSrc = pPlane + size_t(y) * stride;
+        auto w0   = VSet(weights[0]);
+        for(auto x=0u; x<stride; x+=LANE_COUNT)
+        { VStore(pDst + x, VMul(VLoad(pSrc + x), w0)); }
+
+        for(auto k=1; k<=radius; ++k)
+        {
+            auto pSrc0 = pPlane + size_t(std::max(y - k, 0   )) * stride;
+            auto pSrc1 = pPlane + size_t(std::min(y + k, last)) * stride;
+            auto wk    = VSet(weights[k]);
+            for(auto x=0u; x<stride; x+=LANE_COUNT)
+            {
+                auto v = VAdd(VLoad(pSrc0 + x), VLoad(pSrc1 + x));
+                VStore(pDst + x, VMulAdd(v, wk, VLoad(pDst + x)));
+            }
+        }
+    }
+
+    // 横方向.
+    for(auto y=0u; y<height; ++y)
+    {
+        PadRow(pTemp + size_t(y) * stride, width, stride, uint32_t(radius), pRow);
+
+        auto pSrc = pRow + radius;
+        auto pDst = pPlane + size_t(y) * stride;
+        for(auto x=0u; x<stride; x+=LANE_COUNT)
+        {
+            auto sum = VMul(VLoad(pSrc + x), VSet(weights[0]));
+            for(auto k=1; k<=radius; ++k)
+            {
+                auto v = VAdd(VLoad(pSrc + x - k), VLoad(pSrc + x + k));
+                sum = VMulAdd(v, VSet(weights[k]), sum);
+            }
+            VStore(pDst + x, sum);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      1行分の知覚誤差を求めます.
+//-----------------------------------------------------------------------------
+void CalcErrorRow
+(
+    const float* const* ppRef,
+    const float* const* ppTest,
+    const float*        pFeature,
+    uint32_t            stride,
+    float               maxColorError,
+    float*              pResult
+)
+{
+    // pc * cmax を境に, 小さな色差ほど強調して [0, 1] に圧縮する.
+    auto knee    = FLIP_PC * maxColorError;
+    auto loScale = VSet(FLIP_PT / knee);
+    auto hiScale = VSet((1.0f - FLIP_PT) / (maxColorError - knee));
+    auto one     = VSet(1.0f);
+
+    for(auto x=0u; x<stride; x+=LANE_COUNT)
+    {
+        VFloat ref[3], test[3];
+        YccToHuntLab(VLoad(ppRef [0] + x), VLoad(ppRef [1] + x), VLoad(ppRef [2] + x), ref);
+        YccToHuntLab(VLoad(ppTest[0] + x), VLoad(ppTest[1] + x), VLoad(ppTest[2] + x), test);
+
+        auto d  = VPow(HyAB(ref, test), VSet(FLIP_QC));
+        auto lo = VMul(d, loScale);
+        auto hi = VMulAdd(VSub(d, VSet(knee)), hiScale, VSet(FLIP_PT));
+        auto ec = VMin(VSelectGreater(d, VSet(knee), hi, lo), one);
+
+        // エッジの差が大きいほど色差を持ち上げる.
+        auto ef = VLoad(pFeature + x);
+        VStore(pResult + x, VPow(ec, VSub(one, ef)));
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルを読み込みます.
+//-----------------------------------------------------------------------------
+bool LoadFile(const char* path, std::vector<uint8_t>& result)
+{
+    auto pFile = r3d::OpenFile(path, "rb");
+    if (pFile == nullptr)
+    {
+        ELOGA("Error : File Open Failed. path = %s", path);
+        return false;
+    }
+
+    fseek(pFile, 0, SEEK_END);
+    auto size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    if (size < 0)
+    {
+        fclose(pFile);
+        ELOGA("Error : File Read Failed. path = %s", path);
+        return false;
+    }
+
+    result.resize(size_t(size));
+    auto count = fread(result.data(), 1, result.size(), pFile);
+    fclose(pFile);
+
+    if (count != result.size())
+    {
+        ELOGA("Error : File Read Failed. path = %s", path);
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      リニアな HDR の値を表示値に変換します.
+//-----------------------------------------------------------------------------
+float HdrToDisplay(float value)
+{
+    // NaN と負の値は 0 とする.
+    auto x = (value > 0.0f) ? value : 0.0f;
+    if (std::isinf(x))
+    { return 1.0f; }
+
+    auto t = x / (1.0f + x);
+    return (t <= 0.0031308f) ? t * 12.92f : 1.055f * powf(t, 1.0f / 2.4f) - 0.055f;
+}
+
+} // namespace
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//      比較用に画像ファイルを読み込みます.
+//-----------------------------------------------------------------------------
+bool LoadCompareImage(const char* path, CompareImage& result)
+{
+    std::vector<uint8_t> data;
+    if (!LoadFile(path, data))
+    { return false; }
+
+    static const uint8_t kPngSignature[4] = { 0x89, 'P', 'N', 'G' };
+    static const uint8_t kExrSignature[4] = { 0x76, 0x2f, 0x31, 0x01 };
+
+    uint32_t width  = 0;
+    uint32_t height = 0;
+
+    if (data.size() >= 4 && memcmp(data.data(), kExrSignature, 4) == 0)
+    {
+        std::vector<float> pixels;
+        if (!DecodeExr(data.data(), data.size(), pixels, width, height))
+        {
+            ELOGA("Error : DecodeExr() Failed. path = %s", path);
+            return false;
+        }
+
+        auto count = size_t(width) * height;
+        result.Pixels.resize(count * 3);
+        for(size_t i=0; i<count; ++i)
+        {
+            for(auto c=0; c<3; ++c)
+            { result.Pixels[c * count + i] = HdrToDisplay(pixels[i * 4 + c]); }
+        }
+    }
+    else
+    {
+        std::vector<uint8_t> pixels;
+        auto ret = false;
+        if (data.size() >= 4 && memcmp(data.data(), kPngSignature, 4) == 0)
+        { ret = DecodePng(data.data(), data.size(), pixels, width, height); }
+        else if (data.size() >= 4 && memcmp(data.data(), "qoif", 4) == 0)
+        { ret = DecodeQoi(data.data(), data.size(), pixels, width, height); }
+        else
+        {
+            ELOGA("Error : Unknown Image Format. path = %s", path);
+            return false;
+        }
+
+        if (!ret)
+        {
+            ELOGA("Error : Image Decode Failed. path = %s", path);
+            return false;
+        }
+
+        float table[256];
+        for(auto i=0; i<256; ++i)
+        { table[i] = float(i) / 255.0f; }
+
+        // キャプチャは不透明なので α は比較しない.
+        auto count = size_t(width) * height;
+        result.Pixels.resize(count * 3);
+        for(size_t i=0; i<count; ++i)
+        {
+            for(auto c=0; c<3; ++c)
+            { result.Pixels[c * count + i] = table[pixels[i * 4 + c]]; }
+        }
+    }
+
+    result.Width  = width;
+    result.Height = height;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      2つの画像を比較します.
+//-----------------------------------------------------------------------------
+bool CompareImages
+(
+    const CompareImage& reference,
+    const CompareImage& test,
+    uint32_t            tileSize,
+    CompareResult&      result
+)
+{
+    auto width  = reference.Width;
+    auto height = reference.Height;
+    auto count  = size_t(width) * height;
+    if (width == 0 || height == 0 || test.Width != width || test.Height != height
+     || reference.Pixels.size() != count * 3 || test.Pixels.size() != count * 3)
+    {
+        ELOGA("Error : Image Size Mismatch. reference = %u x %u, test = %u x %u",
+            reference.Width, reference.Height, test.Width, test.Height);
+        return false;
+    }
+
+    if (tileSize == 0)
+    { tileSize = DEFAULT_TILE_SIZE; }
+
+    auto stride    = (width + ROW_ALIGNMENT - 1) & ~(ROW_ALIGNMENT - 1);
+    auto planeSize = size_t(stride) * height;
+    auto rowSize   = size_t(stride) + MAX_BLUR_RADIUS * 2 + LANE_COUNT;
+
+    auto& scratch = GetScratch();
+    scratch.Planes.resize(planeSize * PLANE_COUNT);
+    scratch.Rows.assign(rowSize * 7, 0.0f);
+
+    float* pPlanes[PLANE_COUNT];
+    for(auto i=0u; i<PLANE_COUNT; ++i)
+    { pPlanes[i] = scratch.Planes.data() + planeSize * i; }
+
+    float* pRows[7];
+    for(auto i=0u; i<7; ++i)
+    { pRows[i] = scratch.Rows.data() + rowSize * i; }
+
+    // 色空間の変換と二乗誤差.
+    // 入力の行を作業領域にコピーし, 行末の端数も SIMD でまとめて処理する (端数は 0 のまま).
+    double squareSum = 0.0;
+    for(auto y=0u; y<height; ++y)
+    {
+        const float* pRef [3];
+        const float* pTest[3];
+        float*       pRefYcc [3];
+        float*       pTestYcc[3];
+        for(auto c=0u; c<3; ++c)
+        {
+            memcpy(pRows[c    ], reference.Pixels.data() + count * c + size_t(y) * width, width * sizeof(float));
+            memcpy(pRows[c + 3], test     .Pixels.data() + count * c + size_t(y) * width, width * sizeof(float));
+            pRef [c]    = pRows[c];
+            pTest[c]    = pRows[c + 3];
+            pRefYcc [c] = pPlanes[PLANE_REF_YCC  + c] + size_t(y) * stride;
+            pTestYcc[c] = pPlanes[PLANE_TEST_YCC + c] + size_t(y) * stride;
+        }
+
+        squareSum += PrepareRow(
+            pRef,
+            pTest,
+            stride,
+            pPlanes[PLANE_REF_LUMA ] + size_t(y) * stride,
+            pPlanes[PLANE_TEST_LUMA] + size_t(y) * stride,
+            pRefYcc,
+            pTestYcc);
+    }
+
+    result.Mse  = squareSum / (double(count) * 3.0);
+    result.Psnr = (result.Mse > 0.0) ? 10.0 * log10(1.0 / result.Mse) : std::numeric_limits<double>::infinity();
+    result.Ssim = CalcSsim(pPlanes[PLANE_REF_LUMA], pPlanes[PLANE_TEST_LUMA], width, height, stride);
+
+    // エッジの差. フィルタ前の Yy から求め, SSIM を求め終えた輝度の平面に格納する.
+    auto pFeature = pPlanes[PLANE_REF_LUMA];
+    auto last     = int(height) - 1;
+    for(auto y=0; y<=last; ++y)
+    {
+        const float* pRef [3];
+        const float* pTest[3];
+        for(auto i=0; i<3; ++i)
+        {
+            auto row = size_t(std::min(std::max(y + i - 1, 0), last)) * stride;
+            PadRow(pPlanes[PLANE_REF_YCC ] + row, width, stride, 1, pRows[i    ]);
+            PadRow(pPlanes[PLANE_TEST_YCC] + row, width, stride, 1, pRows[i + 3]);
+            pRef [i] = pRows[i    ] + 1;
+            pTest[i] = pRows[i + 3] + 1;
+        }
+        CalcFeatureRow(pRef, pTest, stride, pFeature + size_t(y) * stride);
+    }
+
+    // コントラスト感度を近似する空間フィルタ.
+    for(auto c=0u; c<3; ++c)
+    {
+        BlurPlane(pPlanes[PLANE_REF_YCC  + c], pPlanes[PLANE_TEMP], pRows[6], width, height, stride, CSF_SIGMA[c]);
+        BlurPlane(pPlanes[PLANE_TEST_YCC + c], pPlanes[PLANE_TEMP], pRows[6], width, height, stride, CSF_SIGMA[c]);
+    }
+
+    // 知覚誤差をタイルごとに集計する.
+    result.TileSize   = tileSize;
+    result.TileCountX = (width  + tileSize - 1) / tileSize;
+    result.TileCountY = (height + tileSize - 1) / tileSize;
+
+    std::vector<double> tileSums(size_t(result.TileCountX) * result.TileCountY, 0.0);
+
+    auto maxColorError = CalcMaxColorError();
+    auto pError        = pRows[6];
+    auto errorSum      = 0.0;
+    for(auto y=0u; y<height; ++y)
+    {
+        const float* pRef [3];
+        const float* pTest[3];
+        for(auto c=0u; c<3; ++c)
+        {
+            pRef [c] = pPlanes[PLANE_REF_YCC  + c] + size_t(y) * stride;
+            pTest[c] = pPlanes[PLANE_TEST_YCC + c] + size_t(y) * stride;
+        }
+        CalcErrorRow(pRef, pTest, pFeature + size_t(y) * stride, stride, maxColorError, pError);
+
+        auto pTileSums = tileSums.data() + size_t(y / tileSize) * result.TileCountX;
+        for(auto tx=0u; tx<result.TileCountX; ++tx)
+        {
+            auto x0  = tx * tileSize;
+            auto x1  = std::min(x0 + tileSize, width);
+            auto sum = 0.0f;
+            for(auto x=x0; x<x1; ++x)
+            { sum += pError[x]; }
+
+            pTileSums[tx] += sum;
+            errorSum      += sum;
+        }
+    }
+
+    result.Flip         = errorSum / double(count);
+    result.MaxTileError = 0.0;
+    result.MaxTileX     = 0;
+    result.MaxTileY     = 0;
+    result.TileErrors.resize(tileSums.size());
+    for(auto ty=0u; ty<result.TileCountY; ++ty)
+    {
+        for(auto tx=0u; tx<result.TileCountX; ++tx)
+        {
+            auto x0 = tx * tileSize;
+            auto y0 = ty * tileSize;
+            auto w  = std::min(x0 + tileSize, width ) - x0;
+            auto h  = std::min(y0 + tileSize, height) - y0;
+
+            auto index = size_t(ty) * result.TileCountX + tx;
+            auto error = tileSums[index] / (double(w) * h);
+            result.TileErrors[index] = float(error);
+
+            if (error > result.MaxTileError)
+            {
+                result.MaxTileError = error;
+                result.MaxTileX     = x0;
+                result.MaxTileY     = y0;
+            }
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      タイルごとの誤差をヒートマップ画像にします.
+//-----------------------------------------------------------------------------
+void CreateHeatmap
+(
+    const CompareResult&    result,
+    uint32_t                width,
+    uint32_t                height,
+    float                   scale,
+    std::vector<uint8_t>&   pixels
+)
+{
+    static const float kColors[4][3] = {
+        {   0.0f,   0.0f,   0.0f },
+        { 255.0f,   0.0f,   0.0f },
+        { 255.0f, 255.0f,   0.0f },
+        { 255.0f, 255.0f, 255.0f },
+    };
+
+    // タイルごとの色を先に求めておく.
+    std::vector<uint32_t> colors(result.TileErrors.size());
+    for(size_t i=0; i<colors.size(); ++i)
+    {
+        auto t = (scale > 0.0f) ? result.TileErrors[i] / scale : 1.0f;
+        t = std::min(std::max(t, 0.0f), 1.0f) * 3.0f;
+
+        auto index = std::min(int(t), 2);
+        auto f     = t - float(index);
+
+        uint8_t rgba[4];
+        for(auto c=0; c<3; ++c)
+        { rgba[c] = uint8_t(kColors[index][c] + (kColors[index + 1][c] - kColors[index][c]) * f + 0.5f); }
+        rgba[3] = 255;
+        memcpy(&colors[i], rgba, sizeof(rgba));
+    }
+
+    pixels.resize(size_t(width) * height * 4);
+    for(auto y=0u; y<height; ++y)
+    {
+        auto ty   = std::min(y / result.TileSize, result.TileCountY - 1);
+        auto pDst = pixels.data() + size_t(y) * width * 4;
+        for(auto x=0u; x<width; ++x)
+        {
+            auto tx = std::min(x / result.TileSize, result.TileCountX - 1);
+            memcpy(pDst + x * 4, &colors[size_t(ty) * result.TileCountX + tx], 4);
+        }
+    }
+}
+
+} // namespace r3d
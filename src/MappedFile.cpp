@@ -0,0 +1,264 @@
+﻿//-----------------------------------------------------------------------------
+// File : MappedFile.cpp
+// Desc : Memory Mapped File.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <MappedFile.h>
+#include <Platform.h>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      ページサイズを取得します.
+//-----------------------------------------------------------------------------
+size_t GetPageSize()
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info = {};
+    GetSystemInfo(&info);
+    return size_t(info.dwPageSize);
+#else
+    return size_t(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// MappedFile class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+MappedFile::~MappedFile()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      ファイルを読み取り専用でメモリにマッピングします.
+//-----------------------------------------------------------------------------
+bool MappedFile::Init(const char* path, MAPPED_FILE_HINT hint)
+{
+    Term();
+
+    if (path == nullptr)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+#if defined(_WIN32)
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (hint == MAPPED_FILE_HINT_SEQUENTIAL)
+    { flags |= FILE_FLAG_SEQUENTIAL_SCAN; }
+    else if (hint == MAPPED_FILE_HINT_RANDOM)
+    { flags |= FILE_FLAG_RANDOM_ACCESS; }
+
+    // マッピング中もコンバーターが置き換え (削除・リネーム) できるようにする.
+    auto hFile = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        flags,
+        NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        ELOGA("Error : File Open Failed. path = %s", path);
+        return false;
+    }
+
+    LARGE_INTEGER size = {};
+    if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0)
+    {
+        ELOGA("Error : Invalid File Size. path = %s", path);
+        CloseHandle(hFile);
+        return false;
+    }
+
+    auto hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMapping == NULL)
+    {
+        ELOGA("Error : CreateFileMappingA() Failed. path = %s", path);
+        CloseHandle(hFile);
+        return false;
+    }
+
+    auto ptr = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (ptr == nullptr)
+    {
+        ELOGA("Error : MapViewOfFile() Failed. path = %s", path);
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return false;
+    }
+
+    m_hFile    = hFile;
+    m_hMapping = hMapping;
+    m_pData    = static_cast<const uint8_t*>(ptr);
+    m_Size     = size_t(size.QuadPart);
+#else
+    auto fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        ELOGA("Error : File Open Failed. path = %s", path);
+        return false;
+    }
+
+    struct stat info = {};
+    if (fstat(fd, &info) != 0 || info.st_size <= 0)
+    {
+        ELOGA("Error : Invalid File Size. path = %s", path);
+        close(fd);
+        return false;
+    }
+
+    auto size = size_t(info.st_size);
+    auto ptr  = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // マッピングが生きている間はファイルディスクリプタは不要.
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+    {
+        ELOGA("Error : mmap() Failed. path = %s", path);
+        return false;
+    }
+
+    if (hint == MAPPED_FILE_HINT_SEQUENTIAL)
+    { madvise(ptr, size, MADV_SEQUENTIAL); }
+    else if (hint == MAPPED_FILE_HINT_RANDOM)
+    { madvise(ptr, size, MADV_RANDOM); }
+
+    m_pData = static_cast<const uint8_t*>(ptr);
+    m_Size  = size;
+#endif
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      マッピングを解除します.
+//-----------------------------------------------------------------------------
+void MappedFile::Term()
+{
+#if defined(_WIN32)
+    if (m_pData != nullptr)
+    { UnmapViewOfFile(m_pData); }
+
+    if (m_hMapping != nullptr)
+    { CloseHandle(m_hMapping); }
+
+    if (m_hFile != nullptr)
+    { CloseHandle(m_hFile); }
+#else
+    if (m_pData != nullptr)
+    { munmap(const_cast<uint8_t*>(m_pData), m_Size); }
+#endif
+
+    m_pData    = nullptr;
+    m_Size     = 0;
+    m_hFile    = nullptr;
+    m_hMapping = nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      指定範囲の先読みを要求します.
+//-----------------------------------------------------------------------------
+void MappedFile::Prefetch(const void* ptr, size_t size) const
+{
+    uintptr_t begin = 0;
+    uintptr_t end   = 0;
+    if (!GetPageRange(ptr, size, false, begin, end))
+    { return; }
+
+#if defined(_WIN32)
+    WIN32_MEMORY_RANGE_ENTRY entry = {};
+    entry.VirtualAddress = reinterpret_cast<void*>(begin);
+    entry.NumberOfBytes  = SIZE_T(end - begin);
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+#else
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      指定範囲の物理ページを解放します.
+//-----------------------------------------------------------------------------
+void MappedFile::Release(const void* ptr, size_t size) const
+{
+    uintptr_t begin = 0;
+    uintptr_t end   = 0;
+    if (!GetPageRange(ptr, size, true, begin, end))
+    { return; }
+
+#if defined(_WIN32)
+    // ロックされていないページに対して呼ぶとワーキングセットから外れる.
+    VirtualUnlock(reinterpret_cast<void*>(begin), SIZE_T(end - begin));
+#else
+    madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      マッピング内のページ境界に揃えた範囲を取得します.
+//-----------------------------------------------------------------------------
+bool MappedFile::GetPageRange
+(
+    const void* ptr,
+    size_t      size,
+    bool        inner,
+    uintptr_t&  begin,
+    uintptr_t&  end
+) const
+{
+    if (m_pData == nullptr || ptr == nullptr || size == 0)
+    { return false; }
+
+    auto head = reinterpret_cast<uintptr_t>(m_pData);
+    auto tail = head + m_Size;
+    auto addr = reinterpret_cast<uintptr_t>(ptr);
+    if (addr < head || addr >= tail)
+    { return false; }
+
+    static const auto pageSize = uintptr_t(GetPageSize());
+    auto last = (size < tail - addr) ? addr + size : tail;
+
+    if (inner)
+    {
+        // 範囲に完全に含まれるページのみ.
+        begin = (addr + pageSize - 1) & ~(pageSize - 1);
+        end   = last & ~(pageSize - 1);
+    }
+    else
+    {
+        // 範囲を含むページ全て.
+        begin = addr & ~(pageSize - 1);
+        end   = (last + pageSize - 1) & ~(pageSize - 1);
+    }
+
+    return begin < end;
+}
+
+} // namespace r3d
@@ -10,6 +10,64 @@
 #include <ModelManager.h>
 #include <gfx/asdxDevice.h>
 #include <fnd/asdxLogger.h>
+#include <algorithm>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint64_t MESH_BLOCK_SIZE       = 64 * 1024 * 1024;     // メッシュバッファのブロックサイズ.
+static const uint64_t MESH_ALIGNMENT        = 256;                  // メッシュバッファのアライメント.
+static const D3D12_RESOURCE_STATES MESH_READ_STATE
+    = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER
+    | D3D12_RESOURCE_STATE_INDEX_BUFFER
+    | D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE;
+static const uint32_t DIRTY_MERGE_GAP       = 4;                    // これ以下の隙間は1つの範囲として書き込む.
+static const uint32_t INSTANCE_CHUNK_COUNT  = 1024;                 // インスタンスバッファの拡張単位.
+static const uint32_t MATERIAL_CHUNK_COUNT  = 256;                  // マテリアルバッファの拡張単位.
+static const uint32_t MAX_INSTANCE_COUNT    = 1 << 24;              // InstanceID は24bit.
+static const uint32_t MAX_MATERIAL_COUNT    = 1 << 24;              // 最大マテリアル数.
+
+//-----------------------------------------------------------------------------
+//      バッファのステートを遷移させます.
+//-----------------------------------------------------------------------------
+void TransitionBuffer
+(
+    ID3D12GraphicsCommandList6* pCmdList,
+    ID3D12Resource*             pResource,
+    D3D12_RESOURCE_STATES       before,
+    D3D12_RESOURCE_STATES       after
+)
+{
+    D3D12_RESOURCE_BARRIER barrier = {};
+    barrier.Type                    = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Flags                   = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    barrier.Transition.pResource    = pResource;
+    barrier.Transition.Subresource  = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    barrier.Transition.StateBefore  = before;
+    barrier.Transition.StateAfter   = after;
+
+    pCmdList->ResourceBarrier(1, &barrier);
+}
+
+//-----------------------------------------------------------------------------
+//      実行中のフレームが参照し終わってからバッファを破棄します.
+//-----------------------------------------------------------------------------
+void DisposeBuffer(asdx::RefPtr<ID3D12Resource>& resource)
+{
+    auto pResource = resource.GetPtr();
+    if (pResource == nullptr)
+    { return; }
+
+    // 破棄キューに参照を1つ渡す.
+    pResource->AddRef();
+    resource.Reset();
+    asdx::Dispose(pResource);
+}
+
+} // namespace
 
 
 namespace r3d {
@@ -24,22 +82,32 @@ namespace r3d {
 bool ModelMgr::Init
 (
     ID3D12GraphicsCommandList6* pCmdList,
-    uint32_t maxInstanceCount,
-    uint32_t maxMaterialCount
+    UploadHeap* pUploadHeap,
+    uint32_t instanceCount,
+    uint32_t materialCount
 )
 {
-    auto pDevice = asdx::GetD3D12Device();
-
-    const auto sizeIB = maxInstanceCount * sizeof(GpuInstance);
-    const auto sizeTB = maxInstanceCount * sizeof(asdx::Transform3x4);
-    const auto sizeMB = maxMaterialCount * sizeof(Material);
-
-    m_MaxInstanceCount = maxInstanceCount;
-    m_MaxMaterialCount = maxMaterialCount;
+    m_InstanceCapacity = 0;
+    m_MaterialCapacity = 0;
 
     m_OffsetInstance = 0;
     m_OffsetMaterial = 0;
 
+    if (!m_InstancePlanner.Init(INSTANCE_CHUNK_COUNT, MAX_INSTANCE_COUNT)
+     || !m_MaterialPlanner.Init(MATERIAL_CHUNK_COUNT, MAX_MATERIAL_COUNT))
+    {
+        ELOGA("Error : CapacityPlanner::Init() Failed.");
+        return false;
+    }
+
+    m_pUploadHeap = pUploadHeap;
+
+    if (!m_MeshArena.Init(MESH_BLOCK_SIZE, MESH_ALIGNMENT))
+    {
+        ELOGA("Error : BufferArena::Init() Failed.");
+        return false;
+    }
+
     // デフォルトベースカラー生成.
     {
         asdx::ResTexture res;
@@ -222,83 +290,22 @@ bool ModelMgr::Init
     }
 
     //--------------------
-    // インスタンスデータ.
-    //--------------------
-    if (!asdx::CreateUploadBuffer(pDevice, sizeIB, m_IB.GetAddress()))
-    {
-        ELOGA("Error : InstanceBuffer Create Failed.");
-        return false;
-    }
-
-    if (!asdx::CreateBufferSRV(pDevice, m_IB.GetPtr(), UINT(sizeIB / 4), 0, m_IB_SRV.GetAddress()))
-    {
-        ELOGA("Error : InstanceBuffer SRV Create Failed.");
-        return false;
-    }
-
-    {
-        m_AddressIB = m_IB->GetGPUVirtualAddress();
-
-        auto hr = m_IB->Map(0, nullptr, reinterpret_cast<void**>(&m_pInstances));
-        if (FAILED(hr))
-        {
-            ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
-            return false;
-        }
-    }
-
-    //--------------------
-    // トランスフォームデータ.
+    // インスタンス・トランスフォーム・マテリアルデータ.
     //--------------------
-    if (!asdx::CreateUploadBuffer(pDevice, sizeTB, m_TB.GetAddress()))
-    {
-        ELOGA("Error : TransformBuffer Create Failed.");
-        return false;
-    }
-
-    if (!asdx::CreateBufferSRV(pDevice, m_TB.GetPtr(), UINT(sizeTB / 4), 0, m_TB_SRV.GetAddress()))
-    {
-        ELOGA("Error : Transform SRV Create Failed.");
-        return false;
-    }
+    if (!ReserveInstances(std::max(instanceCount, 1u)))
+    { return false; }
 
-    {
-        m_AddressTB = m_TB->GetGPUVirtualAddress();
+    if (!ReserveMaterials(std::max(materialCount, 1u)))
+    { return false; }
 
-        auto hr = m_TB->Map(0, nullptr, reinterpret_cast<void**>(&m_pTransforms));
-        if (FAILED(hr))
-        {
-            ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
-            return false;
-        }
-    }
-
-    //--------------------
-    // マテリアルデータ.
-    //--------------------
-    if (!asdx::CreateUploadBuffer(pDevice, sizeMB, m_MB.GetAddress()))
-    {
-        ELOGA("Error : MaterialBuffer Create Failed.");
-        return false;
-    }
+    m_FrameSlot = 0;
 
-    if (!asdx::CreateBufferSRV(pDevice, m_MB.GetPtr(), UINT(sizeMB / sizeof(Material)), sizeof(Material), m_MB_SRV.GetAddress()))
+    if (!m_DirtyInstances.Init(FRAME_SLOT_COUNT, DIRTY_MERGE_GAP))
     {
-        ELOGA("Error : Material SRV Create Failed.");
+        ELOGA("Error : DirtyRangeTracker::Init() Failed.");
         return false;
     }
 
-    {
-        m_AddressMB = m_MB->GetGPUVirtualAddress();
-
-        auto hr = m_MB->Map(0, nullptr, reinterpret_cast<void**>(&m_pMaterials));
-        if (FAILED(hr))
-        {
-            ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
-            return false;
-        }
-    }
-
     return true;
 }
 
@@ -307,25 +314,40 @@ bool ModelMgr::Init
 //-----------------------------------------------------------------------------
 void ModelMgr::Term()
 {
-    m_IB_SRV.Reset();
-    m_TB_SRV.Reset();
+    for(auto i=0u; i<FRAME_SLOT_COUNT; ++i)
+    {
+        m_IB_SRV[i].Reset();
+        m_TB_SRV[i].Reset();
+
+        m_IB[i].Reset();
+        m_TB[i].Reset();
+
+        m_pInstances [i] = nullptr;
+        m_pTransforms[i] = nullptr;
+
+        m_AddressIB[i] = 0;
+        m_AddressTB[i] = 0;
+    }
+
     m_MB_SRV.Reset();
+    m_MB    .Reset();
 
-    m_IB.Reset();
-    m_TB.Reset();
-    m_MB.Reset();
+    m_OffsetInstance   = 0;
+    m_OffsetMaterial   = 0;
+    m_InstanceCapacity = 0;
+    m_MaterialCapacity = 0;
 
-    m_OffsetInstance = 0;
-    m_OffsetMaterial = 0;
+    m_pMaterials = nullptr;
+    m_AddressMB  = 0;
+
+    m_InstancePlanner.Term();
+    m_MaterialPlanner.Term();
 
-    m_pInstances  = nullptr;
-    m_pTransforms = nullptr;
-    m_pMaterials  = nullptr;
+    m_FrameSlot = 0;
+    m_DirtyInstances.Term();
 
     for(size_t i=0; i<m_Meshes.size(); ++i)
     {
-        m_Meshes[i].VB.Reset();
-        m_Meshes[i].IB.Reset();
         m_Meshes[i].VB_SRV.Reset();
         m_Meshes[i].IB_SRV.Reset();
         m_Meshes[i].VertexCount = 0;
@@ -335,6 +357,14 @@ void ModelMgr::Term()
     m_Meshes.clear();
     m_Meshes.shrink_to_fit();
 
+    m_pUploadHeap = nullptr;
+
+    for(size_t i=0; i<m_MeshBlocks.size(); ++i)
+    { m_MeshBlocks[i].Resource.Reset(); }
+
+    m_MeshBlocks.clear();
+    m_MeshArena .Term();
+
     m_DefaultBaseColor  .Term();
     m_DefaultNormal     .Term();
     m_DefaultORM        .Term();
@@ -343,98 +373,79 @@ void ModelMgr::Term()
     m_GeometryHandles.clear();
     m_InstanceHandles.clear();
     m_CpuInstances   .clear();
-}
-
-//-----------------------------------------------------------------------------
-//      メモリマッピングを解除します.
-//-----------------------------------------------------------------------------
-void ModelMgr::Fixed()
-{
-    m_IB->Unmap(0, nullptr);
-    m_pInstances = nullptr;
-
-    m_TB->Unmap(0, nullptr);
-    m_pTransforms = nullptr;
-
-    m_MB->Unmap(0, nullptr);
-    m_pMaterials = nullptr;
+    m_CpuMaterials   .clear();
 }
 
 //-----------------------------------------------------------------------------
 //      メッシュを登録します.
 //-----------------------------------------------------------------------------
-GeometryHandle ModelMgr::AddMesh(const Mesh& mesh)
+GeometryHandle ModelMgr::AddMesh(ID3D12GraphicsCommandList6* pCmdList, const Mesh& mesh)
 {
-    auto pDevice = asdx::GetD3D12Device();
-
     MeshBuffer item;
     GeometryHandle result = {};
 
-    // 頂点バッファ生成.
-    {
-        auto vbSize = mesh.VertexCount * sizeof(ResVertex);
-        if (!asdx::CreateUploadBuffer(pDevice, vbSize, item.VB.GetAddress()))
-        {
-            ELOGA("Error : CreateUploadBuffer() Failed.");
-            return result;
-        }
-
-        if (!asdx::CreateBufferSRV(pDevice, item.VB.GetPtr(), UINT(vbSize/4), 0, item.VB_SRV.GetAddress()))
-        {
-            ELOGA("Error : CreateBufferSRV() Failed.");
-            return result;
-        }
-
-        item.VB->SetName(L"ModelMangaer::VB");
+    auto vbSize = uint64_t(mesh.VertexCount) * sizeof(ResVertex);
+    auto ibSize = uint64_t(mesh.IndexCount)  * sizeof(uint32_t);
 
-        uint8_t* ptr = nullptr;
-        auto hr = item.VB->Map(0, nullptr, reinterpret_cast<void**>(&ptr));
-        if (FAILED(hr))
-        {
-            ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
-            return result;
-        }
-
-        memcpy(ptr, mesh.Vertices, vbSize);
-
-        item.VB->Unmap(0, nullptr);
+    // 頂点とインデックスを1つの領域に詰める.
+    item.OffsetIB = asdx::RoundUp(vbSize, MESH_ALIGNMENT);
+    if (!m_MeshArena.Alloc(item.OffsetIB + ibSize, item.Allocation))
+    {
+        ELOGA("Error : BufferArena::Alloc() Failed.");
+        return result;
     }
 
-    // インデックスバッファ生成.
+    // 追加されたブロックのバッファを生成.
+    for(auto i=uint32_t(m_MeshBlocks.size()); i<m_MeshArena.GetBlockCount(); ++i)
     {
-        auto ibSize = mesh.VertexCount * sizeof(uint32_t);
-        if (!asdx::CreateUploadBuffer(pDevice, ibSize, item.IB.GetAddress()))
+        if (!AddMeshBlock(i))
         {
-            ELOGA("Error : CreateUploadBuffer() Failed.");
+            m_MeshArena.Free(item.Allocation);
             return result;
         }
+    }
 
-        if (!asdx::CreateBufferSRV(pDevice, item.IB.GetPtr(), UINT(ibSize/4), 0, item.IB_SRV.GetAddress()))
-        {
-            ELOGA("Error : CreateBufferSRV() Failed.");
-            return result;
-        }
+    auto pResource = m_MeshBlocks[item.Allocation.Block].Resource.GetPtr();
 
-        item.IB->SetName(L"ModelManager::IB");
+    // オフセット指定の ByteAddressBuffer として参照する.
+    D3D12_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+    viewDesc.ViewDimension              = D3D12_SRV_DIMENSION_BUFFER;
+    viewDesc.Format                     = DXGI_FORMAT_R32_TYPELESS;
+    viewDesc.Shader4ComponentMapping    = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    viewDesc.Buffer.FirstElement        = item.Allocation.Offset / 4;
+    viewDesc.Buffer.NumElements         = UINT(vbSize / 4);
+    viewDesc.Buffer.Flags               = D3D12_BUFFER_SRV_FLAG_RAW;
 
-        uint8_t* ptr = nullptr;
-        auto hr = item.IB->Map(0, nullptr, reinterpret_cast<void**>(&ptr));
-        if (FAILED(hr))
-        {
-            ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
-            return result;
-        }
+    if (!asdx::CreateShaderResourceView(pResource, &viewDesc, item.VB_SRV.GetAddress()))
+    {
+        ELOGA("Error : CreateShaderResourceView() Failed.");
+        m_MeshArena.Free(item.Allocation);
+        return result;
+    }
 
-        memcpy(ptr, mesh.Indices, ibSize);
+    viewDesc.Buffer.FirstElement        = (item.Allocation.Offset + item.OffsetIB) / 4;
+    viewDesc.Buffer.NumElements         = UINT(ibSize / 4);
 
-        item.IB->Unmap(0, nullptr);
+    if (!asdx::CreateShaderResourceView(pResource, &viewDesc, item.IB_SRV.GetAddress()))
+    {
+        ELOGA("Error : CreateShaderResourceView() Failed.");
+        m_MeshArena.Free(item.Allocation);
+        return result;
     }
 
     item.VertexCount = mesh.VertexCount;
     item.IndexCount  = mesh.IndexCount;
 
-    result.AddressVB    = item.VB->GetGPUVirtualAddress();
-    result.AddressIB    = item.IB->GetGPUVirtualAddress();
+    if (!CopyMesh(pCmdList, item, mesh))
+    {
+        m_MeshArena.Free(item.Allocation);
+        return result;
+    }
+
+    auto address = pResource->GetGPUVirtualAddress() + item.Allocation.Offset;
+
+    result.AddressVB    = address;
+    result.AddressIB    = address + item.OffsetIB;
     result.IndexVB      = item.VB_SRV->GetDescriptorIndex();
     result.IndexIB      = item.IB_SRV->GetDescriptorIndex();
 
@@ -449,21 +460,27 @@ GeometryHandle ModelMgr::AddMesh(const Mesh& mesh)
 //-----------------------------------------------------------------------------
 InstanceHandle ModelMgr::AddInstance(const CpuInstance& instance)
 {
-    assert(m_OffsetInstance + 1 < m_MaxInstanceCount);
     assert(instance.MeshId < m_Meshes.size());
 
+    InstanceHandle result = {};
+    result.InstanceId = UINT32_MAX;
+
+    if (!ReserveInstances(uint64_t(m_OffsetInstance) + 1))
+    { return result; }
+
     auto idx = m_OffsetInstance;
-    m_pInstances[idx].VertexBufferId = m_Meshes[instance.MeshId].VB_SRV->GetDescriptorIndex();
-    m_pInstances[idx].IndexBufferId  = m_Meshes[instance.MeshId].IB_SRV->GetDescriptorIndex();
-    m_pInstances[idx].MaterialId     = instance.MaterialId;
+    auto gpuInstance = ToGpuInstance(instance);
 
-    m_pTransforms[idx] = instance.Transform;
+    // 登録時は全ての面に書き込んでおく.
+    for(auto i=0u; i<FRAME_SLOT_COUNT; ++i)
+    {
+        m_pInstances [i][idx] = gpuInstance;
+        m_pTransforms[i][idx] = instance.Transform;
+    }
 
     m_OffsetInstance++;
 
-    InstanceHandle result = {};
     result.InstanceId = idx;
-    result.AddressTB  = m_AddressTB + idx * sizeof(asdx::Transform3x4);
 
     m_InstanceHandles.push_back(result);
     m_CpuInstances   .push_back(instance);
@@ -476,44 +493,107 @@ InstanceHandle ModelMgr::AddInstance(const CpuInstance& instance)
 //-----------------------------------------------------------------------------
 D3D12_GPU_VIRTUAL_ADDRESS ModelMgr::AddMaterials(const Material* ptr, uint32_t count)
 {
-    assert(m_OffsetMaterial + count < m_MaxMaterialCount);
+    if (!ReserveMaterials(uint64_t(m_OffsetMaterial) + count))
+    { return 0; }
+
+    WriteMaterials(m_OffsetMaterial, ptr, count);
+
     D3D12_GPU_VIRTUAL_ADDRESS result = m_AddressMB + m_OffsetMaterial * sizeof(Material);
+    m_OffsetMaterial += count;
 
-    for(uint32_t i=0; i<count; ++i)
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      登録済みメッシュの頂点・インデックスを書き換えます.
+//-----------------------------------------------------------------------------
+bool ModelMgr::UpdateMesh(ID3D12GraphicsCommandList6* pCmdList, uint32_t index, const Mesh& mesh)
+{
+    assert(index < m_Meshes.size());
+    auto& item = m_Meshes[index];
+
+    if (item.VertexCount != mesh.VertexCount || item.IndexCount != mesh.IndexCount)
     {
-        auto& src = ptr[i];
-        auto& dst = m_pMaterials[m_OffsetMaterial + i];
+        ELOGA("Error : Mesh Size Not Matched. index = %u", index);
+        return false;
+    }
 
-        dst.BaseColorMap = GetBaseColor(src.BaseColorMap);
-        dst.NormalMap    = GetNormal(src.NormalMap);
-        dst.OrmMap       = GetOrm(src.OrmMap);
-        dst.EmissiveMap  = GetEmissive(src.EmissiveMap);
+    return CopyMesh(pCmdList, item, mesh);
+}
 
-        dst.BaseColor  = src.BaseColor;
-        dst.Occlusion  = src.Occlusion;
-        dst.Roughness  = src.Roughness;
-        dst.Metalness  = src.Metalness;
+//-----------------------------------------------------------------------------
+//      登録済みインスタンスの変換行列とマテリアルを書き換えます.
+//-----------------------------------------------------------------------------
+void ModelMgr::UpdateInstance(uint32_t instanceId, const CpuInstance& instance)
+{
+    assert(instanceId < m_CpuInstances.size());
+    assert(instance.MeshId == m_CpuInstances[instanceId].MeshId);
 
-        dst.Emissive   = src.Emissive;
-        dst.Ior        = src.Ior;
+    m_CpuInstances[instanceId] = instance;
+    m_DirtyInstances.Mark(instanceId);
+}
+
+//-----------------------------------------------------------------------------
+//      登録済みインスタンスの変換行列を書き換えます.
+//-----------------------------------------------------------------------------
+void ModelMgr::SetTransform(uint32_t instanceId, const asdx::Transform3x4& transform)
+{
+    assert(instanceId < m_CpuInstances.size());
+
+    m_CpuInstances[instanceId].Transform = transform;
+    m_DirtyInstances.Mark(instanceId);
+}
+
+//-----------------------------------------------------------------------------
+//      次の面に切り替えて，溜まっている変更を書き込みます.
+//-----------------------------------------------------------------------------
+void ModelMgr::BeginFrame(std::vector<DirtyRange>& dirtyRanges)
+{
+    m_FrameSlot = (m_FrameSlot + 1) % FRAME_SLOT_COUNT;
+    m_DirtyInstances.Flush(m_FrameSlot, dirtyRanges);
+
+    auto pInstances  = m_pInstances [m_FrameSlot];
+    auto pTransforms = m_pTransforms[m_FrameSlot];
+
+    // 変更された範囲だけをCPU側の値から書き写す.
+    for(auto& range : dirtyRanges)
+    {
+        auto end = range.Offset + range.Count;
+        for(auto i=range.Offset; i<end; ++i)
+        {
+            auto& instance = m_CpuInstances[i];
+            pInstances [i] = ToGpuInstance(instance);
+            pTransforms[i] = instance.Transform;
+        }
     }
+}
 
-    m_OffsetMaterial += count;
+//-----------------------------------------------------------------------------
+//      現在の面番号を取得します.
+//-----------------------------------------------------------------------------
+uint32_t ModelMgr::GetFrameSlot() const
+{ return m_FrameSlot; }
 
-    return result;
+//-----------------------------------------------------------------------------
+//      登録済みマテリアルを書き換えます.
+//-----------------------------------------------------------------------------
+void ModelMgr::UpdateMaterials(uint32_t offset, const Material* ptr, uint32_t count)
+{
+    assert(offset + count <= m_OffsetMaterial);
+    WriteMaterials(offset, ptr, count);
 }
 
 //-----------------------------------------------------------------------------
 //      インスタンスバッファのシェーダリソースビューを取得します.
 //-----------------------------------------------------------------------------
 asdx::IShaderResourceView* ModelMgr::GetIB() const
-{ return m_IB_SRV.GetPtr(); }
+{ return m_IB_SRV[m_FrameSlot].GetPtr(); }
 
 //-----------------------------------------------------------------------------
 //      トランスフォームバッファのシェーダリソースビューを取得します.
 //-----------------------------------------------------------------------------
 asdx::IShaderResourceView* ModelMgr::GetTB() const
-{ return m_TB_SRV.GetPtr(); }
+{ return m_TB_SRV[m_FrameSlot].GetPtr(); }
 
 //-----------------------------------------------------------------------------
 //      マテリアルバッファのシェーダリソースビューを取得します.
@@ -525,13 +605,13 @@ asdx::IShaderResourceView* ModelMgr::GetMB() const
 //      インスタンスバッファのGPU仮想アドレスを取得します.
 //-----------------------------------------------------------------------------
 D3D12_GPU_VIRTUAL_ADDRESS ModelMgr::GetAddressIB() const
-{ return m_AddressIB; }
+{ return m_AddressIB[m_FrameSlot]; }
 
 //-----------------------------------------------------------------------------
 //      トランスフォームバッファのGPU仮想アドレスを取得します.
 //-----------------------------------------------------------------------------
 D3D12_GPU_VIRTUAL_ADDRESS ModelMgr::GetAddressTB() const
-{ return m_AddressTB; }
+{ return m_AddressTB[m_FrameSlot]; }
 
 //-----------------------------------------------------------------------------
 //      マテリアルバッファのGPU仮想アドレスを取得します.
@@ -543,19 +623,19 @@ D3D12_GPU_VIRTUAL_ADDRESS ModelMgr::GetAddressMB() const
 //      インスタンスバッファサイズを取得します.
 //-----------------------------------------------------------------------------
 uint32_t ModelMgr::GetSizeIB() const
-{ return m_MaxInstanceCount * sizeof(GpuInstance); }
+{ return m_InstanceCapacity * sizeof(GpuInstance); }
 
 //-----------------------------------------------------------------------------
 //      トランスフォームバッファサイズを取得します.
 //-----------------------------------------------------------------------------
 uint32_t ModelMgr::GetSizeTB() const
-{ return m_MaxInstanceCount * sizeof(asdx::Transform3x4); }
+{ return m_InstanceCapacity * sizeof(asdx::Transform3x4); }
 
 //-----------------------------------------------------------------------------
 //      マテリアルバッファサイズを取得します.
 //-----------------------------------------------------------------------------
 uint32_t ModelMgr::GetSizeMB() const
-{ return m_MaxMaterialCount * sizeof(Material); }
+{ return m_MaterialCapacity * sizeof(Material); }
 
 //-----------------------------------------------------------------------------
 //      ベースカラーハンドルを取得します.
@@ -607,6 +687,322 @@ uint32_t ModelMgr::GetMask(uint32_t handle)
         : handle;
 }
 
+//-----------------------------------------------------------------------------
+//      GPUインスタンスに変換します.
+//-----------------------------------------------------------------------------
+ModelMgr::GpuInstance ModelMgr::ToGpuInstance(const CpuInstance& instance) const
+{
+    auto& mesh = m_Meshes[instance.MeshId];
+
+    GpuInstance result = {};
+    result.VertexBufferId = mesh.VB_SRV->GetDescriptorIndex();
+    result.IndexBufferId  = mesh.IB_SRV->GetDescriptorIndex();
+    result.MaterialId     = instance.MaterialId;
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      マテリアルデータを書き込みます.
+//-----------------------------------------------------------------------------
+void ModelMgr::WriteMaterials(uint32_t offset, const Material* ptr, uint32_t count)
+{
+    for(uint32_t i=0; i<count; ++i)
+    {
+        auto& src = ptr[i];
+        auto& dst = m_CpuMaterials[offset + i];
+
+        dst.BaseColorMap = GetBaseColor(src.BaseColorMap);
+        dst.NormalMap    = GetNormal(src.NormalMap);
+        dst.OrmMap       = GetOrm(src.OrmMap);
+        dst.EmissiveMap  = GetEmissive(src.EmissiveMap);
+
+        dst.BaseColor  = src.BaseColor;
+        dst.Occlusion  = src.Occlusion;
+        dst.Roughness  = src.Roughness;
+        dst.Metalness  = src.Metalness;
+
+        dst.Emissive   = src.Emissive;
+        dst.Ior        = src.Ior;
+
+        m_pMaterials[offset + i] = dst;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      インスタンスバッファの容量を確保します.
+//-----------------------------------------------------------------------------
+bool ModelMgr::ReserveInstances(uint64_t count)
+{
+    uint32_t capacity = 0;
+    if (!m_InstancePlanner.Plan(m_InstanceCapacity, count, capacity))
+    {
+        ELOGA("Error : Instance Count Over. count = %llu, max = %u",
+            static_cast<unsigned long long>(count), m_InstancePlanner.GetMaxCount());
+        return false;
+    }
+
+    if (capacity == m_InstanceCapacity)
+    { return true; }
+
+    auto pDevice = asdx::GetD3D12Device();
+
+    const auto sizeIB = uint64_t(capacity) * sizeof(GpuInstance);
+    const auto sizeTB = uint64_t(capacity) * sizeof(asdx::Transform3x4);
+
+    for(auto i=0u; i<FRAME_SLOT_COUNT; ++i)
+    {
+        asdx::RefPtr<ID3D12Resource>            ib;
+        asdx::RefPtr<ID3D12Resource>            tb;
+        asdx::RefPtr<asdx::IShaderResourceView> ibSRV;
+        asdx::RefPtr<asdx::IShaderResourceView> tbSRV;
+        GpuInstance*                            pInstances  = nullptr;
+        asdx::Transform3x4*                     pTransforms = nullptr;
+
+        if (!asdx::CreateUploadBuffer(pDevice, sizeIB, ib.GetAddress()))
+        {
+            ELOGA("Error : InstanceBuffer Create Failed.");
+            return false;
+        }
+
+        if (!asdx::CreateBufferSRV(pDevice, ib.GetPtr(), UINT(sizeIB / 4), 0, ibSRV.GetAddress()))
+        {
+            ELOGA("Error : InstanceBuffer SRV Create Failed.");
+            return false;
+        }
+
+        auto hr = ib->Map(0, nullptr, reinterpret_cast<void**>(&pInstances));
+        if (FAILED(hr))
+        {
+            ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
+            return false;
+        }
+
+        if (!asdx::CreateUploadBuffer(pDevice, sizeTB, tb.GetAddress()))
+        {
+            ELOGA("Error : TransformBuffer Create Failed.");
+            return false;
+        }
+
+        if (!asdx::CreateBufferSRV(pDevice, tb.GetPtr(), UINT(sizeTB / 4), 0, tbSRV.GetAddress()))
+        {
+            ELOGA("Error : Transform SRV Create Failed.");
+            return false;
+        }
+
+        hr = tb->Map(0, nullptr, reinterpret_cast<void**>(&pTransforms));
+        if (FAILED(hr))
+        {
+            ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
+            return false;
+        }
+
+        // 書き込み結合メモリから読み戻さずにCPU側の値から書き直す.
+        // インスタンス番号は変わらないので登録済みのハンドルはそのまま使える.
+        for(auto idx=0u; idx<m_OffsetInstance; ++idx)
+        {
+            auto& instance = m_CpuInstances[idx];
+            pInstances [idx] = ToGpuInstance(instance);
+            pTransforms[idx] = instance.Transform;
+        }
+
+        // 古いバッファは実行中のフレームが参照しているかもしれない.
+        DisposeBuffer(m_IB[i]);
+        DisposeBuffer(m_TB[i]);
+
+        m_IB    [i] = ib;
+        m_TB    [i] = tb;
+        m_IB_SRV[i] = ibSRV;
+        m_TB_SRV[i] = tbSRV;
+
+        m_pInstances [i] = pInstances;
+        m_pTransforms[i] = pTransforms;
+        m_AddressIB  [i] = ib->GetGPUVirtualAddress();
+        m_AddressTB  [i] = tb->GetGPUVirtualAddress();
+    }
+
+    if (m_InstanceCapacity > 0)
+    { ILOGA("Info : Instance Buffer Grown. %u -> %u", m_InstanceCapacity, capacity); }
+
+    m_InstanceCapacity = capacity;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      マテリアルバッファの容量を確保します.
+//-----------------------------------------------------------------------------
+bool ModelMgr::ReserveMaterials(uint64_t count)
+{
+    uint32_t capacity = 0;
+    if (!m_MaterialPlanner.Plan(m_MaterialCapacity, count, capacity))
+    {
+        ELOGA("Error : Material Count Over. count = %llu, max = %u",
+            static_cast<unsigned long long>(count), m_MaterialPlanner.GetMaxCount());
+        return false;
+    }
+
+    if (capacity == m_MaterialCapacity)
+    { return true; }
+
+    auto pDevice = asdx::GetD3D12Device();
+    const auto sizeMB = uint64_t(capacity) * sizeof(Material);
+
+    asdx::RefPtr<ID3D12Resource>            mb;
+    asdx::RefPtr<asdx::IShaderResourceView> mbSRV;
+    Material*                               pMaterials = nullptr;
+
+    if (!asdx::CreateUploadBuffer(pDevice, sizeMB, mb.GetAddress()))
+    {
+        ELOGA("Error : MaterialBuffer Create Failed.");
+        return false;
+    }
+
+    if (!asdx::CreateBufferSRV(pDevice, mb.GetPtr(), capacity, sizeof(Material), mbSRV.GetAddress()))
+    {
+        ELOGA("Error : Material SRV Create Failed.");
+        return false;
+    }
+
+    auto hr = mb->Map(0, nullptr, reinterpret_cast<void**>(&pMaterials));
+    if (FAILED(hr))
+    {
+        ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
+        return false;
+    }
+
+    if (m_OffsetMaterial > 0)
+    { memcpy(pMaterials, m_CpuMaterials.data(), sizeof(Material) * m_OffsetMaterial); }
+
+    DisposeBuffer(m_MB);
+
+    m_MB         = mb;
+    m_MB_SRV     = mbSRV;
+    m_pMaterials = pMaterials;
+    m_AddressMB  = mb->GetGPUVirtualAddress();
+
+    if (m_MaterialCapacity > 0)
+    { ILOGA("Info : Material Buffer Grown. %u -> %u", m_MaterialCapacity, capacity); }
+
+    m_CpuMaterials.resize(capacity);
+    m_MaterialCapacity = capacity;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュバッファのブロックを生成します.
+//-----------------------------------------------------------------------------
+bool ModelMgr::AddMeshBlock(uint32_t index)
+{
+    auto pDevice = asdx::GetD3D12Device();
+
+    D3D12_RESOURCE_DESC desc = {};
+    desc.Dimension          = D3D12_RESOURCE_DIMENSION_BUFFER;
+    desc.Alignment          = 0;
+    desc.Width              = m_MeshArena.GetBlockSize(index);
+    desc.Height             = 1;
+    desc.DepthOrArraySize   = 1;
+    desc.MipLevels          = 1;
+    desc.Format             = DXGI_FORMAT_UNKNOWN;
+    desc.SampleDesc.Count   = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Layout             = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    desc.Flags              = D3D12_RESOURCE_FLAG_NONE;
+
+    D3D12_HEAP_PROPERTIES props = {};
+    props.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+    MeshBlock block;
+    block.State = D3D12_RESOURCE_STATE_COMMON;
+
+    auto hr = pDevice->CreateCommittedResource(
+        &props,
+        D3D12_HEAP_FLAG_NONE,
+        &desc,
+        block.State,
+        nullptr,
+        IID_PPV_ARGS(block.Resource.GetAddress()));
+    if (FAILED(hr))
+    {
+        ELOGA("Error : ID3D12Device::CreateCommittedResource() Failed. errcode = 0x%x", hr);
+        return false;
+    }
+
+    block.Resource->SetName(L"ModelManager::MeshBlock");
+
+    m_MeshBlocks.emplace_back(block);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      アップロードヒープ経由で頂点・インデックスをコピーします.
+//-----------------------------------------------------------------------------
+bool ModelMgr::CopyMesh(ID3D12GraphicsCommandList6* pCmdList, const MeshBuffer& item, const Mesh& mesh)
+{
+    auto vbSize = uint64_t(mesh.VertexCount) * sizeof(ResVertex);
+    auto ibSize = uint64_t(mesh.IndexCount)  * sizeof(uint32_t);
+    auto size   = item.OffsetIB + ibSize;
+
+    UploadRegion region;
+    if (!m_pUploadHeap->Alloc(size, MESH_ALIGNMENT, region))
+    {
+        ELOGA("Error : UploadHeap::Alloc() Failed.");
+        return false;
+    }
+
+    memcpy(region.pData,                 mesh.Vertices, size_t(vbSize));
+    memcpy(region.pData + item.OffsetIB, mesh.Indices,  size_t(ibSize));
+
+    // 読み取りステートへの遷移は FlushMeshes() でまとめて行う.
+    auto& block = m_MeshBlocks[item.Allocation.Block];
+    if (block.State != D3D12_RESOURCE_STATE_COPY_DEST)
+    {
+        TransitionBuffer(pCmdList, block.Resource.GetPtr(), block.State, D3D12_RESOURCE_STATE_COPY_DEST);
+        block.State = D3D12_RESOURCE_STATE_COPY_DEST;
+    }
+
+    pCmdList->CopyBufferRegion(
+        block.Resource.GetPtr(),
+        item.Allocation.Offset,
+        region.pResource,
+        region.Offset,
+        size);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      コピー先になったメッシュバッファをまとめて読み取りステートに戻します.
+//-----------------------------------------------------------------------------
+void ModelMgr::FlushMeshes(ID3D12GraphicsCommandList6* pCmdList)
+{
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+
+    for(auto& block : m_MeshBlocks)
+    {
+        if (block.State != D3D12_RESOURCE_STATE_COPY_DEST)
+        { continue; }
+
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Type                    = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barrier.Flags                   = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        barrier.Transition.pResource    = block.Resource.GetPtr();
+        barrier.Transition.Subresource  = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        barrier.Transition.StateBefore  = D3D12_RESOURCE_STATE_COPY_DEST;
+        barrier.Transition.StateAfter   = MESH_READ_STATE;
+        barriers.push_back(barrier);
+
+        block.State = MESH_READ_STATE;
+    }
+
+    if (!barriers.empty())
+    { pCmdList->ResourceBarrier(UINT(barriers.size()), barriers.data()); }
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュバッファの統計情報を取得します.
+//-----------------------------------------------------------------------------
+ArenaStats ModelMgr::GetMeshStats() const
+{ return m_MeshArena.GetStats(); }
+
 //-----------------------------------------------------------------------------
 //      メッシュを取得します.
 //-----------------------------------------------------------------------------
@@ -0,0 +1,369 @@
+﻿//-----------------------------------------------------------------------------
+// File : Platform.cpp
+// Desc : Platform Abstraction.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <Platform.h>
+#include <cstdarg>
+#include <cstring>
+#include <ctime>
+#include <cctype>
+#include <algorithm>
+#include <vector>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#include <string.h>
+#else
+#include <dirent.h>
+#include <strings.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+#if defined(_WIN32)
+static const char kSeparator      = '\\';
+static const char kOtherSeparator = '/';
+#else
+static const char kSeparator      = '/';
+static const char kOtherSeparator = '\\';
+#endif
+
+//-----------------------------------------------------------------------------
+// Global Variables.
+//-----------------------------------------------------------------------------
+std::vector<std::string>    g_SearchDirectories;
+
+//-----------------------------------------------------------------------------
+//      最後のパス区切り文字の位置を取得します.
+//-----------------------------------------------------------------------------
+size_t FindLastSeparator(const std::string& path)
+{ return path.find_last_of("/\\"); }
+
+} // namespace
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//      ログを出力します.
+//-----------------------------------------------------------------------------
+void PrintLog(FILE* stream, const char* format, ...)
+{
+    char buffer[2048] = {};
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    fprintf(stream, "%s\n", buffer);
+}
+
+//-----------------------------------------------------------------------------
+//      大文字小文字を区別せずに文字列を比較します.
+//-----------------------------------------------------------------------------
+int StrICmp(const char* lhs, const char* rhs)
+{
+#if defined(_WIN32)
+    return _stricmp(lhs, rhs);
+#else
+    return strcasecmp(lhs, rhs);
+#endif
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルを開きます.
+//-----------------------------------------------------------------------------
+FILE* OpenFile(const char* path, const char* mode)
+{
+    FILE* fp = nullptr;
+#if defined(_WIN32)
+    if (fopen_s(&fp, path, mode) != 0)
+    { return nullptr; }
+#else
+    fp = fopen(path, mode);
+#endif
+    return fp;
+}
+
+//-----------------------------------------------------------------------------
+//      現在時刻のタイムスタンプ文字列を取得します.
+//-----------------------------------------------------------------------------
+std::string GetTimeStamp()
+{
+    tm local_time = {};
+    auto t = time(nullptr);
+#if defined(_WIN32)
+    localtime_s(&local_time, &t);
+#else
+    localtime_r(&t, &local_time);
+#endif
+
+    char timeStamp[256] = {};
+    snprintf(timeStamp, sizeof(timeStamp), "%04d%02d%02d_%02d%02d%02d",
+        local_time.tm_year + 1900,
+        local_time.tm_mon + 1,
+        local_time.tm_mday,
+        local_time.tm_hour,
+        local_time.tm_min,
+        local_time.tm_sec);
+
+    return timeStamp;
+}
+
+//-----------------------------------------------------------------------------
+//      パス区切り文字を実行環境のものに揃えます.
+//-----------------------------------------------------------------------------
+std::string NormalizePath(const char* path)
+{
+    if (path == nullptr)
+    { return std::string(); }
+
+    std::string result = path;
+    for(auto& c : result)
+    {
+        if (c == kOtherSeparator)
+        { c = kSeparator; }
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ディレクトリパスを取得します.
+//-----------------------------------------------------------------------------
+std::string GetDirectoryPath(const char* path)
+{
+    auto temp = NormalizePath(path);
+    auto idx  = FindLastSeparator(temp);
+    if (idx == std::string::npos)
+    { return std::string("."); }
+
+    return temp.substr(0, idx);
+}
+
+//-----------------------------------------------------------------------------
+//      ディレクトリパスを取り除いたファイル名を取得します.
+//-----------------------------------------------------------------------------
+std::string RemoveDirectoryPath(const char* path)
+{
+    std::string temp = (path != nullptr) ? path : "";
+    auto idx = FindLastSeparator(temp);
+    if (idx == std::string::npos)
+    { return temp; }
+
+    return temp.substr(idx + 1);
+}
+
+//-----------------------------------------------------------------------------
+//      拡張子を取り除いたパスを取得します.
+//-----------------------------------------------------------------------------
+std::string GetPathWithoutExt(const char* path)
+{
+    std::string temp = (path != nullptr) ? path : "";
+    auto idx = temp.find_last_of('.');
+    auto sep = FindLastSeparator(temp);
+    if (idx == std::string::npos || (sep != std::string::npos && idx < sep))
+    { return temp; }
+
+    return temp.substr(0, idx);
+}
+
+//-----------------------------------------------------------------------------
+//      拡張子を取得します.
+//-----------------------------------------------------------------------------
+std::string GetExt(const char* path)
+{
+    std::string temp = (path != nullptr) ? path : "";
+    auto idx = temp.find_last_of('.');
+    auto sep = FindLastSeparator(temp);
+    if (idx == std::string::npos || (sep != std::string::npos && idx < sep))
+    { return std::string(); }
+
+    auto result = temp.substr(idx + 1);
+    for(auto& c : result)
+    { c = char(tolower(c)); }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルが存在するかどうかチェックします.
+//-----------------------------------------------------------------------------
+bool IsExistFile(const char* path)
+{
+    if (path == nullptr)
+    { return false; }
+
+    struct stat info = {};
+    if (stat(path, &info) != 0)
+    { return false; }
+
+    return (info.st_mode & S_IFMT) == S_IFREG;
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルのハードリンクを作成します.
+//-----------------------------------------------------------------------------
+bool LinkOrCopyFile(const char* src, const char* dst)
+{
+    if (src == nullptr || dst == nullptr)
+    { return false; }
+
+    remove(dst);
+
+#if defined(_WIN32)
+    if (CreateHardLinkA(dst, src, nullptr))
+    { return true; }
+#else
+    if (link(src, dst) == 0)
+    { return true; }
+#endif
+
+    auto pSrc = OpenFile(src, "rb");
+    if (pSrc == nullptr)
+    { return false; }
+
+    auto pDst = OpenFile(dst, "wb");
+    if (pDst == nullptr)
+    {
+        fclose(pSrc);
+        return false;
+    }
+
+    auto ret = true;
+    char buffer[64 * 1024];
+    for(;;)
+    {
+        auto count = fread(buffer, 1, sizeof(buffer), pSrc);
+        if (count == 0)
+        {
+            ret = (ferror(pSrc) == 0);
+            break;
+        }
+
+        if (fwrite(buffer, 1, count, pDst) != count)
+        {
+            ret = false;
+            break;
+        }
+    }
+
+    fclose(pSrc);
+    if (fclose(pDst) != 0)
+    { ret = false; }
+
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+//      ディレクトリ直下のファイル名を取得します.
+//-----------------------------------------------------------------------------
+bool GetFileList(const char* directory, std::vector<std::string>& result)
+{
+    result.clear();
+    if (directory == nullptr)
+    { return false; }
+
+#if defined(_WIN32)
+    auto pattern = std::string(directory) + "\\*";
+
+    WIN32_FIND_DATAA data = {};
+    auto handle = FindFirstFileA(pattern.c_str(), &data);
+    if (handle == INVALID_HANDLE_VALUE)
+    { return false; }
+
+    do
+    {
+        if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+        { result.push_back(data.cFileName); }
+    }
+    while (FindNextFileA(handle, &data));
+
+    FindClose(handle);
+#else
+    auto pDir = opendir(directory);
+    if (pDir == nullptr)
+    { return false; }
+
+    // d_type を返さないファイルシステムもあるので stat で判定する.
+    std::string base = directory;
+    if (!base.empty() && base.back() != '/')
+    { base += '/'; }
+
+    while (auto pEntry = readdir(pDir))
+    {
+        if (IsExistFile((base + pEntry->d_name).c_str()))
+        { result.push_back(pEntry->d_name); }
+    }
+
+    closedir(pDir);
+#endif
+
+    std::sort(result.begin(), result.end());
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ファイル検索用のディレクトリを追加します.
+//-----------------------------------------------------------------------------
+void AddSearchDirectory(const char* directory)
+{
+    if (directory == nullptr)
+    { return; }
+
+    g_SearchDirectories.push_back(NormalizePath(directory));
+}
+
+//-----------------------------------------------------------------------------
+//      ファイル検索用のディレクトリをクリアします.
+//-----------------------------------------------------------------------------
+void ClearSearchDirectories()
+{ g_SearchDirectories.clear(); }
+
+//-----------------------------------------------------------------------------
+//      ファイルパスを検索します.
+//-----------------------------------------------------------------------------
+bool SearchFilePath(const char* path, std::string& result)
+{
+    if (path == nullptr || path[0] == '\0')
+    { return false; }
+
+    auto temp = NormalizePath(path);
+    if (IsExistFile(temp.c_str()))
+    {
+        result = temp;
+        return true;
+    }
+
+    for(auto& dir : g_SearchDirectories)
+    {
+        auto candidate = dir + kSeparator + temp;
+        if (IsExistFile(candidate.c_str()))
+        {
+            result = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace r3d
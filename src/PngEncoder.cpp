@@ -0,0 +1,659 @@
+﻿//-----------------------------------------------------------------------------
+// File : PngEncoder.cpp
+// Desc : Strip Parallel PNG Encoder.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <PngEncoder.h>
+#include <Deflate.h>
+#include <Platform.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint8_t  PNG_SIGNATURE[8]  = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+static const uint32_t BYTES_PER_PIXEL   = 4;        // RGBA8.
+static const uint32_t MIN_STRIP_ROWS    = 16;       // これより細かく分割すると圧縮率が落ちる.
+static const uint32_t STRIPS_PER_THREAD = 2;        // 負荷の偏りを均すための分割数.
+static const uint32_t MAX_STRIP_SIZE    = 1u << 26; // 帯1つあたりの最大サイズ[byte].
+static const uint32_t MATCH_DIST        = 4;        // 直前の画素との一致だけを探す.
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CrcTable structure
+///////////////////////////////////////////////////////////////////////////////
+struct CrcTable
+{
+    uint32_t    Crc[8][256];            //!< CRC-32 (slice-by-8).
+
+    CrcTable()
+    {
+        for(auto i=0u; i<256; ++i)
+        {
+            auto c = i;
+            for(auto k=0; k<8; ++k)
+            { c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1); }
+            Crc[0][i] = c;
+        }
+        for(auto i=0u; i<256; ++i)
+        {
+            for(auto s=1; s<8; ++s)
+            { Crc[s][i] = (Crc[s - 1][i] >> 8) ^ Crc[0][Crc[s - 1][i] & 0xFF]; }
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------
+//      CRC テーブルを取得します.
+//-----------------------------------------------------------------------------
+const CrcTable& GetCrcTable()
+{
+    static const CrcTable s_Table;
+    return s_Table;
+}
+
+//-----------------------------------------------------------------------------
+//      CRC-32 を更新します.
+//-----------------------------------------------------------------------------
+uint32_t UpdateCrc32(uint32_t crc, const uint8_t* pData, size_t size)
+{
+    auto& t = GetCrcTable().Crc;
+    crc = ~crc;
+
+    while(size >= 8)
+    {
+        auto lo = crc ^ (uint32_t(pData[0]) | (uint32_t(pData[1]) << 8) | (uint32_t(pData[2]) << 16) | (uint32_t(pData[3]) << 24));
+        auto hi = uint32_t(pData[4]) | (uint32_t(pData[5]) << 8) | (uint32_t(pData[6]) << 16) | (uint32_t(pData[7]) << 24);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+            ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        pData += 8;
+        size  -= 8;
+    }
+
+    while(size-- > 0)
+    { crc = t[0][(crc ^ *pData++) & 0xFF] ^ (crc >> 8); }
+
+    return ~crc;
+}
+
+//-----------------------------------------------------------------------------
+//      ビッグエンディアンで32bit値を追加します.
+//-----------------------------------------------------------------------------
+inline void PushBE32(std::vector<uint8_t>& buffer, uint32_t value)
+{
+    buffer.push_back(uint8_t(value >> 24));
+    buffer.push_back(uint8_t(value >> 16));
+    buffer.push_back(uint8_t(value >> 8));
+    buffer.push_back(uint8_t(value));
+}
+
+//-----------------------------------------------------------------------------
+//      チャンクを追加します.
+//-----------------------------------------------------------------------------
+void PushChunk(std::vector<uint8_t>& buffer, const char* type, const uint8_t* pData, uint32_t size)
+{
+    PushBE32(buffer, size);
+
+    auto begin = buffer.size();
+    buffer.insert(buffer.end(), type, type + 4);
+    if (size > 0)
+    { buffer.insert(buffer.end(), pData, pData + size); }
+
+    PushBE32(buffer, UpdateCrc32(0, buffer.data() + begin, buffer.size() - begin));
+}
+
+//-----------------------------------------------------------------------------
+//      ビッグエンディアンで32bit値を読み込みます.
+//-----------------------------------------------------------------------------
+inline uint32_t ReadBE32(const uint8_t* p)
+{ return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]); }
+
+//-----------------------------------------------------------------------------
+//      Paeth 予測を行います.
+//-----------------------------------------------------------------------------
+inline uint8_t PaethPredict(int a, int b, int c)
+{
+    auto p  = a + b - c;
+    auto pa = abs(p - a);
+    auto pb = abs(p - b);
+    auto pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+    { return uint8_t(a); }
+    return (pb <= pc) ? uint8_t(b) : uint8_t(c);
+}
+
+//-----------------------------------------------------------------------------
+//      1行のフィルタを元に戻します.
+//-----------------------------------------------------------------------------
+bool UnfilterRow(uint8_t filter, uint8_t* pCurr, const uint8_t* pPrev, uint32_t rowSize, uint32_t bpp)
+{
+    switch(filter)
+    {
+    case 0:
+        break;
+
+    case 1:
+        for(auto i=bpp; i<rowSize; ++i)
+        { pCurr[i] = uint8_t(pCurr[i] + pCurr[i - bpp]); }
+        break;
+
+    case 2:
+        for(auto i=0u; i<rowSize; ++i)
+        { pCurr[i] = uint8_t(pCurr[i] + pPrev[i]); }
+        break;
+
+    case 3:
+        for(auto i=0u; i<rowSize; ++i)
+        {
+            auto left = (i >= bpp) ? pCurr[i - bpp] : 0;
+            pCurr[i] = uint8_t(pCurr[i] + ((left + pPrev[i]) >> 1));
+        }
+        break;
+
+    case 4:
+        for(auto i=0u; i<rowSize; ++i)
+        {
+            auto left     = (i >= bpp) ? pCurr[i - bpp] : 0;
+            auto upLeft   = (i >= bpp) ? pPrev[i - bpp] : 0;
+            pCurr[i] = uint8_t(pCurr[i] + PaethPredict(left, pPrev[i], upLeft));
+        }
+        break;
+
+    default:
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      スレッドごとのフィルタ済みデータの作業領域を取得します.
+//-----------------------------------------------------------------------------
+std::vector<uint8_t>& GetFiltered()
+{
+    static thread_local std::vector<uint8_t> s_Filtered;
+    return s_Filtered;
+}
+
+//-----------------------------------------------------------------------------
+//      1行にフィルタを適用します.
+//-----------------------------------------------------------------------------
+void FilterRow(const uint8_t* pCurr, const uint8_t* pPrev, uint32_t rowSize, uint8_t* pDst)
+{
+    // 先頭行は上の行が無いので Sub, それ以外は Up.
+    // Paeth の方が残差は小さいが，ノイズの乗った描画結果では圧縮率がほぼ変わらず数倍遅い.
+    if (pPrev == nullptr)
+    {
+        *pDst++ = 1;
+        for(auto i=0u; i<BYTES_PER_PIXEL; ++i)
+        { pDst[i] = pCurr[i]; }
+        for(auto i=BYTES_PER_PIXEL; i<rowSize; ++i)
+        { pDst[i] = uint8_t(pCurr[i] - pCurr[i - BYTES_PER_PIXEL]); }
+        return;
+    }
+
+    *pDst++ = 2;
+    for(auto i=0u; i<rowSize; ++i)
+    { pDst[i] = uint8_t(pCurr[i] - pPrev[i]); }
+}
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// PngEncoder::Job structure
+///////////////////////////////////////////////////////////////////////////////
+struct PngEncoder::Job
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // Strip structure
+    ///////////////////////////////////////////////////////////////////////////
+    struct Strip
+    {
+        std::vector<uint8_t>    Chunk;      //!< IDAT チャンク.
+        uint32_t                Adler;      //!< フィルタ済みデータの Adler-32.
+        uint64_t                Size;       //!< フィルタ済みデータのサイズ.
+    };
+
+    const uint8_t*      pPixels;
+    uint32_t            Width;
+    uint32_t            Height;
+    uint32_t            Pitch;
+    uint32_t            RowsPerStrip;
+    uint32_t            Remaining;          //!< 未完了の帯の数 (m_Mutex で保護).
+    std::vector<Strip>  Strips;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// PngEncoder class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+PngEncoder::~PngEncoder()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool PngEncoder::Init(uint32_t threadCount)
+{
+    Term();
+
+    if (threadCount == 0)
+    { threadCount = std::max(std::thread::hardware_concurrency(), 1u); }
+
+    // テーブルはワーカーが動き出す前に作っておく.
+    GetCrcTable();
+    InitDeflate();
+
+    m_Threads.reserve(threadCount);
+    for(auto i=0u; i<threadCount; ++i)
+    { m_Threads.emplace_back(&PngEncoder::Run, this); }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void PngEncoder::Term()
+{
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        m_Quit = true;
+    }
+    m_TaskCond.notify_all();
+
+    for(auto& thread : m_Threads)
+    {
+        if (thread.joinable())
+        { thread.join(); }
+    }
+    m_Threads.clear();
+
+    // Encode() は完了まで戻らないので残っているタスクは無い.
+    assert(m_Tasks.empty());
+    m_Quit = false;
+}
+
+//-----------------------------------------------------------------------------
+//      RGBA8 の画像を PNG にエンコードします.
+//-----------------------------------------------------------------------------
+bool PngEncoder::Encode
+(
+    const uint8_t*          pPixels,
+    uint32_t                width,
+    uint32_t                height,
+    uint32_t                pitch,
+    std::vector<uint8_t>&   result
+)
+{
+    if (pPixels == nullptr || width == 0 || height == 0 || uint64_t(pitch) < uint64_t(width) * BYTES_PER_PIXEL)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    // 帯のサイズは 32bit で扱うので，1行 (フィルタ種別 + 画素) が収まる必要がある.
+    auto rowSize = uint64_t(width) * BYTES_PER_PIXEL + 1;
+    if (rowSize > MAX_STRIP_SIZE)
+    {
+        ELOGA("Error : Image is too large. width = %u", width);
+        return false;
+    }
+
+    auto maxStrips = (height + MIN_STRIP_ROWS - 1) / MIN_STRIP_ROWS;
+    auto minStrips = uint32_t((rowSize * height + MAX_STRIP_SIZE - 1) / MAX_STRIP_SIZE);
+    auto strips    = std::min(maxStrips, (GetThreadCount() + 1) * STRIPS_PER_THREAD);
+    strips = std::max(strips, minStrips);
+
+    Job job;
+    job.pPixels      = pPixels;
+    job.Width        = width;
+    job.Height       = height;
+    job.Pitch        = pitch;
+    job.RowsPerStrip = (height + strips - 1) / strips;
+    job.Remaining    = (height + job.RowsPerStrip - 1) / job.RowsPerStrip;
+    job.Strips.resize(job.Remaining);
+
+    auto stripCount = job.Remaining;
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        for(auto i=0u; i<stripCount; ++i)
+        { m_Tasks.push_back({ &job, i }); }
+    }
+    m_TaskCond.notify_all();
+
+    // 完了を待つ間もタスクを処理する.
+    for(;;)
+    {
+        Task task = {};
+        {
+            std::unique_lock<std::mutex> locker(m_Mutex);
+            if (job.Remaining == 0)
+            { break; }
+
+            if (m_Tasks.empty())
+            {
+                m_DoneCond.wait(locker, [&]() { return job.Remaining == 0; });
+                break;
+            }
+
+            task = m_Tasks.front();
+            m_Tasks.pop_front();
+        }
+
+        Execute(task);
+    }
+
+    // 帯ごとの Adler-32 を結合.
+    uint32_t adler = 1;
+    size_t totalSize = 0;
+    for(auto& strip : job.Strips)
+    {
+        adler = CombineAdler32(adler, strip.Adler, strip.Size);
+        totalSize += strip.Chunk.size();
+    }
+
+    uint8_t header[13] = {};
+    header[0]  = uint8_t(width  >> 24);
+    header[1]  = uint8_t(width  >> 16);
+    header[2]  = uint8_t(width  >> 8);
+    header[3]  = uint8_t(width);
+    header[4]  = uint8_t(height >> 24);
+    header[5]  = uint8_t(height >> 16);
+    header[6]  = uint8_t(height >> 8);
+    header[7]  = uint8_t(height);
+    header[8]  = 8;     // bit depth.
+    header[9]  = 6;     // color type (RGBA).
+    header[10] = 0;     // compression.
+    header[11] = 0;     // filter.
+    header[12] = 0;     // interlace.
+
+    uint8_t trailer[4] = {
+        uint8_t(adler >> 24),
+        uint8_t(adler >> 16),
+        uint8_t(adler >> 8),
+        uint8_t(adler)
+    };
+
+    result.clear();
+    result.reserve(sizeof(PNG_SIGNATURE) + 25 + totalSize + 16 + 12);
+    result.insert(result.end(), PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+    PushChunk(result, "IHDR", header, sizeof(header));
+    for(auto& strip : job.Strips)
+    { result.insert(result.end(), strip.Chunk.begin(), strip.Chunk.end()); }
+
+    // Adler-32 は全ての帯が揃うまで決まらないので，最後に独立した IDAT として追加する.
+    PushChunk(result, "IDAT", trailer, sizeof(trailer));
+    PushChunk(result, "IEND", nullptr, 0);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ワーカースレッド数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t PngEncoder::GetThreadCount() const
+{ return uint32_t(m_Threads.size()); }
+
+//-----------------------------------------------------------------------------
+//      ワーカースレッドの処理です.
+//-----------------------------------------------------------------------------
+void PngEncoder::Run()
+{
+    for(;;)
+    {
+        Task task = {};
+        {
+            std::unique_lock<std::mutex> locker(m_Mutex);
+            m_TaskCond.wait(locker, [&]() { return !m_Tasks.empty() || m_Quit; });
+
+            if (m_Tasks.empty())
+            { return; }
+
+            task = m_Tasks.front();
+            m_Tasks.pop_front();
+        }
+
+        Execute(task);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      帯をフィルタ・圧縮して IDAT チャンクにします.
+//-----------------------------------------------------------------------------
+void PngEncoder::Execute(const Task& task)
+{
+    auto& job   = *task.pJob;
+    auto& strip = job.Strips[task.Strip];
+
+    auto rowSize  = job.Width * BYTES_PER_PIXEL;
+    auto beginRow = task.Strip * job.RowsPerStrip;
+    auto endRow   = std::min(beginRow + job.RowsPerStrip, job.Height);
+    auto size     = (endRow - beginRow) * (rowSize + 1);
+
+    // 帯の先頭行も直前の行を参照してフィルタする. 参照するのは元画像なので他の帯とは独立.
+    auto& filtered = GetFiltered();
+    if (filtered.size() < size)
+    { filtered.resize(size); }
+
+    for(auto y=beginRow; y<endRow; ++y)
+    {
+        auto pCurr = job.pPixels + size_t(y) * job.Pitch;
+        auto pPrev = (y > 0) ? pCurr - job.Pitch : nullptr;
+        FilterRow(pCurr, pPrev, rowSize, filtered.data() + size_t(y - beginRow) * (rowSize + 1));
+    }
+
+    strip.Adler = UpdateAdler32(1, filtered.data(), size);
+    strip.Size  = size;
+
+    auto& chunk = strip.Chunk;
+    chunk.clear();
+    chunk.reserve(size_t(size) + size_t(size) / 8 + 64);
+    chunk.resize(8);
+
+    // zlib ヘッダー (Deflate, 32KB 窓, 圧縮レベル最速).
+    if (task.Strip == 0)
+    {
+        chunk.push_back(0x78);
+        chunk.push_back(0x01);
+    }
+
+    auto final = (endRow == job.Height);
+    Deflate(filtered.data(), size, rowSize + 1, MATCH_DIST, final, chunk);
+
+    auto length = uint32_t(chunk.size() - 8);
+    chunk[0] = uint8_t(length >> 24);
+    chunk[1] = uint8_t(length >> 16);
+    chunk[2] = uint8_t(length >> 8);
+    chunk[3] = uint8_t(length);
+    memcpy(chunk.data() + 4, "IDAT", 4);
+
+    auto crc = UpdateCrc32(0, chunk.data() + 4, chunk.size() - 4);
+    chunk.push_back(uint8_t(crc >> 24));
+    chunk.push_back(uint8_t(crc >> 16));
+    chunk.push_back(uint8_t(crc >> 8));
+    chunk.push_back(uint8_t(crc));
+
+    bool done = false;
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        job.Remaining--;
+        done = (job.Remaining == 0);
+    }
+
+    if (done)
+    { m_DoneCond.notify_all(); }
+}
+
+//-----------------------------------------------------------------------------
+//      PNG をデコードします.
+//-----------------------------------------------------------------------------
+bool DecodePng
+(
+    const uint8_t*          pData,
+    size_t                  size,
+    std::vector<uint8_t>&   pixels,
+    uint32_t&               width,
+    uint32_t&               height
+)
+{
+    if (size < sizeof(PNG_SIGNATURE) || memcmp(pData, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0)
+    { return false; }
+
+    uint8_t header[13] = {};
+    auto    hasHeader  = false;
+    uint8_t palette[256 * 4];
+    memset(palette, 0xFF, sizeof(palette));
+
+    std::vector<uint8_t> compressed;
+    size_t pos = sizeof(PNG_SIGNATURE);
+    for(;;)
+    {
+        if (size - pos < 12)
+        { return false; }
+
+        auto length = ReadBE32(pData + pos);
+        auto pType  = pData + pos + 4;
+        auto pChunk = pData + pos + 8;
+        if (length > size - pos - 12)
+        { return false; }
+
+        if (ReadBE32(pChunk + length) != UpdateCrc32(0, pType, size_t(length) + 4))
+        { return false; }
+
+        if (memcmp(pType, "IHDR", 4) == 0 && length == sizeof(header))
+        {
+            memcpy(header, pChunk, sizeof(header));
+            hasHeader = true;
+        }
+        else if (memcmp(pType, "PLTE", 4) == 0 && length <= 256 * 3)
+        {
+            for(auto i=0u; i<length/3; ++i)
+            {
+                palette[i * 4 + 0] = pChunk[i * 3 + 0];
+                palette[i * 4 + 1] = pChunk[i * 3 + 1];
+                palette[i * 4 + 2] = pChunk[i * 3 + 2];
+            }
+        }
+        else if (memcmp(pType, "tRNS", 4) == 0 && length <= 256)
+        {
+            for(auto i=0u; i<length; ++i)
+            { palette[i * 4 + 3] = pChunk[i]; }
+        }
+        else if (memcmp(pType, "IDAT", 4) == 0)
+        { compressed.insert(compressed.end(), pChunk, pChunk + length); }
+        else if (memcmp(pType, "IEND", 4) == 0)
+        { break; }
+
+        pos += size_t(length) + 12;
+    }
+
+    if (!hasHeader)
+    { return false; }
+
+    auto w         = ReadBE32(header + 0);
+    auto h         = ReadBE32(header + 4);
+    auto depth     = header[8];
+    auto colorType = header[9];
+
+    // インターレースと 8/16bit 以外のビット深度は非対応.
+    uint32_t channels = 0;
+    switch(colorType)
+    {
+    case 0: channels = 1; break;
+    case 2: channels = 3; break;
+    case 3: channels = 1; break;
+    case 4: channels = 2; break;
+    case 6: channels = 4; break;
+    default: return false;
+    }
+
+    if (w == 0 || h == 0
+     || (depth != 8 && depth != 16)
+     || (colorType == 3 && depth != 8)
+     || header[10] != 0 || header[11] != 0 || header[12] != 0
+     || uint64_t(w) * h > (uint64_t(1) << 28))
+    { return false; }
+
+    auto bpp     = channels * depth / 8;
+    auto rowSize = w * bpp;
+
+    std::vector<uint8_t> filtered;
+    if (!DecompressZlib(compressed.data(), compressed.size(), filtered)
+     || filtered.size() < (size_t(rowSize) + 1) * h)
+    { return false; }
+
+    std::vector<uint8_t> zero(rowSize, 0);
+    const uint8_t* pPrev = zero.data();
+    for(auto y=0u; y<h; ++y)
+    {
+        auto pRow = filtered.data() + (size_t(rowSize) + 1) * y;
+        if (!UnfilterRow(pRow[0], pRow + 1, pPrev, rowSize, bpp))
+        { return false; }
+        pPrev = pRow + 1;
+    }
+
+    // RGBA8 に揃える. 16bit は上位バイトだけを使う.
+    auto step = depth / 8;
+    pixels.resize(size_t(w) * h * 4);
+    for(auto y=0u; y<h; ++y)
+    {
+        auto pSrc = filtered.data() + (size_t(rowSize) + 1) * y + 1;
+        auto pDst = pixels.data() + size_t(w) * 4 * y;
+        for(auto x=0u; x<w; ++x, pSrc+=bpp, pDst+=4)
+        {
+            switch(colorType)
+            {
+            case 0:
+                pDst[0] = pDst[1] = pDst[2] = pSrc[0];
+                pDst[3] = 0xFF;
+                break;
+
+            case 2:
+                pDst[0] = pSrc[0];
+                pDst[1] = pSrc[step];
+                pDst[2] = pSrc[step * 2];
+                pDst[3] = 0xFF;
+                break;
+
+            case 3:
+                memcpy(pDst, palette + pSrc[0] * 4, 4);
+                break;
+
+            case 4:
+                pDst[0] = pDst[1] = pDst[2] = pSrc[0];
+                pDst[3] = pSrc[step];
+                break;
+
+            default:
+                pDst[0] = pSrc[0];
+                pDst[1] = pSrc[step];
+                pDst[2] = pSrc[step * 2];
+                pDst[3] = pSrc[step * 3];
+                break;
+            }
+        }
+    }
+
+    width  = w;
+    height = h;
+    return true;
+}
+
+} // namespace r3d
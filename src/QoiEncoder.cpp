@@ -0,0 +1,415 @@
+﻿//-----------------------------------------------------------------------------
+// File : QoiEncoder.cpp
+// Desc : QOI Image Encoder.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <QoiEncoder.h>
+#include <Platform.h>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QOI_ENABLE_SSE2     (1)
+#include <emmintrin.h>
+#else
+#define QOI_ENABLE_SSE2     (0)
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint8_t  QOI_OP_INDEX      = 0x00;
+static const uint8_t  QOI_OP_DIFF       = 0x40;
+static const uint8_t  QOI_OP_LUMA       = 0x80;
+static const uint8_t  QOI_OP_RUN        = 0xC0;
+static const uint8_t  QOI_OP_RGB        = 0xFE;
+static const uint8_t  QOI_OP_RGBA       = 0xFF;
+static const uint8_t  QOI_MASK_2        = 0xC0;
+static const uint32_t QOI_HEADER_SIZE   = 14;
+static const uint32_t QOI_MAX_RUN       = 62;
+static const uint8_t  QOI_PADDING[8]    = { 0, 0, 0, 0, 0, 0, 0, 1 };
+static const uint32_t QOI_INITIAL_PIXEL = 0xFF000000u;      // (r, g, b, a) = (0, 0, 0, 255).
+static const uint32_t QOI_MAX_PIXELS    = 400000000u;       // 参照実装と同じ上限.
+
+// 画素ごとの分類結果 (64bit).
+//  [ 0..39] 出力するバイト列 (DIFF, LUMA, RGB, RGBA のいずれか).
+//  [40..47] カラーテーブルのハッシュ.
+//  [48..55] バイト数. 0 なら直前の画素と同じ.
+static const uint32_t OP_HASH_SHIFT     = 40;
+static const uint32_t OP_SIZE_SHIFT     = 48;
+
+//-----------------------------------------------------------------------------
+//      32bit値を読み込みます.
+//-----------------------------------------------------------------------------
+inline uint32_t Load32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+//-----------------------------------------------------------------------------
+//      カラーテーブルのハッシュを求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t Hash(uint32_t px)
+{
+    auto r = px & 0xFF;
+    auto g = (px >> 8) & 0xFF;
+    auto b = (px >> 16) & 0xFF;
+    auto a = px >> 24;
+    return (r * 3 + g * 5 + b * 7 + a * 11) & 63;
+}
+
+//-----------------------------------------------------------------------------
+//      1画素を分類します.
+//-----------------------------------------------------------------------------
+inline uint64_t Classify(uint32_t curr, uint32_t prev)
+{
+    auto hash = uint64_t(Hash(curr)) << OP_HASH_SHIFT;
+    if (curr == prev)
+    { return hash; }
+
+    if ((curr >> 24) != (prev >> 24))
+    { return QOI_OP_RGBA | (uint64_t(curr) << 8) | hash | (5ull << OP_SIZE_SHIFT); }
+
+    auto dr = int8_t(uint8_t(curr)       - uint8_t(prev));
+    auto dg = int8_t(uint8_t(curr >> 8)  - uint8_t(prev >> 8));
+    auto db = int8_t(uint8_t(curr >> 16) - uint8_t(prev >> 16));
+
+    if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+    {
+        auto op = QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+        return uint64_t(op) | hash | (1ull << OP_SIZE_SHIFT);
+    }
+
+    auto dr_dg = dr - dg;
+    auto db_dg = db - dg;
+    if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+    {
+        auto b0 = QOI_OP_LUMA | (dg + 32);
+        auto b1 = ((dr_dg + 8) << 4) | (db_dg + 8);
+        return uint64_t(b0) | (uint64_t(b1) << 8) | hash | (2ull << OP_SIZE_SHIFT);
+    }
+
+    return QOI_OP_RGB | (uint64_t(curr & 0x00FFFFFF) << 8) | hash | (4ull << OP_SIZE_SHIFT);
+}
+
+#if QOI_ENABLE_SSE2
+//-----------------------------------------------------------------------------
+//      条件に応じて値を選択します.
+//-----------------------------------------------------------------------------
+inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+{ return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+//-----------------------------------------------------------------------------
+//      連続する4画素を分類します.
+//-----------------------------------------------------------------------------
+inline void Classify4(const uint8_t* pCurr, uint64_t* pResult)
+{
+    const auto zero     = _mm_setzero_si128();
+    const auto mask8    = _mm_set1_epi32(0xFF);
+    const auto weights  = _mm_set_epi16(11, 7, 5, 3, 11, 7, 5, 3);
+
+    auto curr = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pCurr));
+    auto prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pCurr - 4));
+    auto d    = _mm_sub_epi8(curr, prev);
+
+    auto same      = _mm_cmpeq_epi32(curr, prev);
+    auto alphaSame = _mm_cmpeq_epi32(_mm_and_si128(d, _mm_set1_epi32(int(0xFF000000))), zero);
+
+    // DIFF : 各チャンネルの差分 + 2 が 0..3 に収まる.
+    auto t      = _mm_add_epi8(d, _mm_set1_epi32(0x00020202));
+    auto diffOk = _mm_and_si128(alphaSame, _mm_cmpeq_epi32(_mm_and_si128(t, _mm_set1_epi32(0x00FCFCFC)), zero));
+    auto diffOp = _mm_or_si128(
+        _mm_or_si128(_mm_set1_epi32(QOI_OP_DIFF), _mm_slli_epi32(_mm_and_si128(t, mask8), 4)),
+        _mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(t, 8), mask8), 2), _mm_and_si128(_mm_srli_epi32(t, 16), mask8)));
+
+    // LUMA : dg + 32 が 0..63, dr - dg + 8 と db - dg + 8 が 0..15 に収まる.
+    auto dg     = _mm_and_si128(_mm_srli_epi32(d, 8), mask8);
+    auto u      = _mm_add_epi8(_mm_sub_epi8(d, _mm_or_si128(dg, _mm_slli_epi32(dg, 16))), _mm_set1_epi32(0x00082008));
+    auto lumaOk = _mm_and_si128(alphaSame, _mm_cmpeq_epi32(_mm_and_si128(u, _mm_set1_epi32(0x00F0C0F0)), zero));
+    auto lumaB0 = _mm_or_si128(_mm_set1_epi32(QOI_OP_LUMA), _mm_and_si128(_mm_srli_epi32(u, 8), mask8));
+    auto lumaB1 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(u, _mm_set1_epi32(0x0F)), 4), _mm_and_si128(_mm_srli_epi32(u, 16), _mm_set1_epi32(0x0F)));
+    auto lumaOp = _mm_or_si128(lumaB0, _mm_slli_epi32(lumaB1, 8));
+
+    // RGB / RGBA : 先頭のタグに続けて画素をそのまま出力する (RGBA の A は5バイト目).
+    auto rgbOp  = _mm_or_si128(_mm_set1_epi32(QOI_OP_RGB),  _mm_slli_epi32(curr, 8));
+    auto rgbaOp = _mm_or_si128(_mm_set1_epi32(QOI_OP_RGBA), _mm_slli_epi32(curr, 8));
+
+    // ハッシュ : r * 3 + g * 5 + b * 7 + a * 11.
+    auto lo   = _mm_madd_epi16(_mm_unpacklo_epi8(curr, zero), weights);
+    auto hi   = _mm_madd_epi16(_mm_unpackhi_epi8(curr, zero), weights);
+    auto even = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+    auto odd  = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+    auto hash = _mm_and_si128(_mm_add_epi32(even, odd), _mm_set1_epi32(63));
+
+    // 優先度の低い順に上書きする.
+    auto ops  = rgbaOp;
+    auto size = _mm_set1_epi32(5);
+    ops  = Select(alphaSame, rgbOp,  ops);
+    size = Select(alphaSame, _mm_set1_epi32(4), size);
+    ops  = Select(lumaOk,    lumaOp, ops);
+    size = Select(lumaOk,    _mm_set1_epi32(2), size);
+    ops  = Select(diffOk,    diffOp, ops);
+    size = Select(diffOk,    _mm_set1_epi32(1), size);
+    size = _mm_andnot_si128(same, size);
+
+    // 上位32bit : RGBA の A, ハッシュ, バイト数.
+    auto info = _mm_or_si128(
+        _mm_or_si128(_mm_srli_epi32(curr, 24), _mm_slli_epi32(hash, OP_HASH_SHIFT - 32)),
+        _mm_slli_epi32(size, OP_SIZE_SHIFT - 32));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pResult + 0), _mm_unpacklo_epi32(ops, info));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pResult + 2), _mm_unpackhi_epi32(ops, info));
+}
+#endif
+
+//-----------------------------------------------------------------------------
+//      1行分の画素を分類します.
+//-----------------------------------------------------------------------------
+void ClassifyRow(const uint8_t* pRow, uint32_t width, uint32_t prev, uint64_t* pResult)
+{
+    // 先頭の画素は前の行の末尾と比較する.
+    pResult[0] = Classify(Load32(pRow), prev);
+
+    auto x = 1u;
+#if QOI_ENABLE_SSE2
+    for(; x + 4 <= width; x += 4)
+    { Classify4(pRow + x * 4, pResult + x); }
+#endif
+
+    for(; x<width; ++x)
+    { pResult[x] = Classify(Load32(pRow + x * 4), Load32(pRow + (x - 1) * 4)); }
+}
+
+//-----------------------------------------------------------------------------
+//      ビッグエンディアンで32bit値を書き込みます.
+//-----------------------------------------------------------------------------
+inline uint8_t* WriteBE32(uint8_t* p, uint32_t value)
+{
+    p[0] = uint8_t(value >> 24);
+    p[1] = uint8_t(value >> 16);
+    p[2] = uint8_t(value >> 8);
+    p[3] = uint8_t(value);
+    return p + 4;
+}
+
+//-----------------------------------------------------------------------------
+//      ビッグエンディアンで32bit値を読み込みます.
+//-----------------------------------------------------------------------------
+inline uint32_t ReadBE32(const uint8_t* p)
+{ return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]); }
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// QoiEncoder class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      RGBA8 の画像を QOI にエンコードします.
+//-----------------------------------------------------------------------------
+bool QoiEncoder::Encode
+(
+    const uint8_t*          pPixels,
+    uint32_t                width,
+    uint32_t                height,
+    uint32_t                pitch,
+    std::vector<uint8_t>&   result
+)
+{
+    if (pPixels == nullptr || width == 0 || height == 0 || uint64_t(pitch) < uint64_t(width) * 4)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    if (height >= QOI_MAX_PIXELS / width)
+    {
+        ELOGA("Error : Image is too large. width = %u, height = %u", width, height);
+        return false;
+    }
+
+    static thread_local std::vector<uint64_t> s_Ops;
+    if (s_Ops.size() < width)
+    { s_Ops.resize(width); }
+    auto ops = s_Ops.data();
+
+    // 最悪ケース (全画素 QOI_OP_RGBA) で確保しておく.
+    // 画素のバイト列は常に8バイト書き込むため, 末尾の3バイトは終端マーカーの領域にはみ出す.
+    result.resize(QOI_HEADER_SIZE + size_t(width) * height * 5 + sizeof(QOI_PADDING));
+    auto pDst = result.data();
+
+    memcpy(pDst, "qoif", 4);
+    pDst = WriteBE32(pDst + 4, width);
+    pDst = WriteBE32(pDst, height);
+    *pDst++ = 4;    // channels.
+    *pDst++ = 0;    // colorspace (sRGB with linear alpha).
+
+    uint32_t index[64] = {};
+    uint32_t prev = QOI_INITIAL_PIXEL;
+    uint32_t run  = 0;
+
+    for(auto y=0u; y<height; ++y)
+    {
+        auto pRow = pPixels + size_t(y) * pitch;
+        ClassifyRow(pRow, width, prev, ops);
+
+        for(auto x=0u; x<width; ++x)
+        {
+            auto op   = ops[x];
+            auto size = uint32_t(op >> OP_SIZE_SHIFT);
+            if (size == 0)
+            {
+                if (++run == QOI_MAX_RUN)
+                {
+                    *pDst++ = uint8_t(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0)
+            {
+                *pDst++ = uint8_t(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            auto px   = Load32(pRow + x * 4);
+            auto hash = uint32_t(op >> OP_HASH_SHIFT) & 63;
+            if (index[hash] == px)
+            {
+                *pDst++ = uint8_t(QOI_OP_INDEX | hash);
+                continue;
+            }
+            index[hash] = px;
+
+            memcpy(pDst, &op, sizeof(op));
+            pDst += size;
+        }
+
+        prev = Load32(pRow + (width - 1) * 4);
+    }
+
+    if (run > 0)
+    { *pDst++ = uint8_t(QOI_OP_RUN | (run - 1)); }
+
+    memcpy(pDst, QOI_PADDING, sizeof(QOI_PADDING));
+    pDst += sizeof(QOI_PADDING);
+
+    result.resize(size_t(pDst - result.data()));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      QOI をデコードします.
+//-----------------------------------------------------------------------------
+bool DecodeQoi
+(
+    const uint8_t*          pData,
+    size_t                  size,
+    std::vector<uint8_t>&   pixels,
+    uint32_t&               width,
+    uint32_t&               height
+)
+{
+    if (pData == nullptr || size < QOI_HEADER_SIZE + sizeof(QOI_PADDING) || memcmp(pData, "qoif", 4) != 0)
+    {
+        ELOGA("Error : Invalid QOI Header.");
+        return false;
+    }
+
+    width  = ReadBE32(pData + 4);
+    height = ReadBE32(pData + 8);
+    if (width == 0 || height == 0 || height >= QOI_MAX_PIXELS / width || pData[12] < 3 || pData[12] > 4)
+    {
+        ELOGA("Error : Invalid QOI Header.");
+        return false;
+    }
+
+    auto pixelCount = size_t(width) * height;
+    pixels.resize(pixelCount * 4);
+
+    uint32_t index[64] = {};
+    uint32_t px  = QOI_INITIAL_PIXEL;
+    uint32_t run = 0;
+
+    auto pSrc = pData + QOI_HEADER_SIZE;
+    auto pEnd = pData + size - sizeof(QOI_PADDING);
+    auto pDst = pixels.data();
+
+    for(size_t i=0; i<pixelCount; ++i)
+    {
+        if (run > 0)
+        { run--; }
+        else if (pSrc < pEnd)
+        {
+            auto b0 = *pSrc++;
+            if (b0 == QOI_OP_RGB)
+            {
+                if (pEnd - pSrc < 3)
+                { break; }
+                px = (px & 0xFF000000u) | uint32_t(pSrc[0]) | (uint32_t(pSrc[1]) << 8) | (uint32_t(pSrc[2]) << 16);
+                pSrc += 3;
+            }
+            else if (b0 == QOI_OP_RGBA)
+            {
+                if (pEnd - pSrc < 4)
+                { break; }
+                px = Load32(pSrc);
+                pSrc += 4;
+            }
+            else if ((b0 & QOI_MASK_2) == QOI_OP_INDEX)
+            {
+                px = index[b0];
+            }
+            else if ((b0 & QOI_MASK_2) == QOI_OP_DIFF)
+            {
+                auto r = uint8_t(px)       + ((b0 >> 4) & 3) - 2;
+                auto g = uint8_t(px >> 8)  + ((b0 >> 2) & 3) - 2;
+                auto b = uint8_t(px >> 16) + ( b0       & 3) - 2;
+                px = (px & 0xFF000000u) | uint32_t(uint8_t(r)) | (uint32_t(uint8_t(g)) << 8) | (uint32_t(uint8_t(b)) << 16);
+            }
+            else if ((b0 & QOI_MASK_2) == QOI_OP_LUMA)
+            {
+                if (pSrc >= pEnd)
+                { break; }
+                auto b1 = *pSrc++;
+                auto dg = int(b0 & 0x3F) - 32;
+                auto r  = uint8_t(px)       + dg - 8 + ((b1 >> 4) & 0x0F);
+                auto g  = uint8_t(px >> 8)  + dg;
+                auto b  = uint8_t(px >> 16) + dg - 8 + ( b1       & 0x0F);
+                px = (px & 0xFF000000u) | uint32_t(uint8_t(r)) | (uint32_t(uint8_t(g)) << 8) | (uint32_t(uint8_t(b)) << 16);
+            }
+            else
+            {
+                run = b0 & 0x3F;
+            }
+
+            index[Hash(px)] = px;
+        }
+        else
+        {
+            break;
+        }
+
+        memcpy(pDst + i * 4, &px, 4);
+
+        if (i + 1 == pixelCount)
+        { return true; }
+    }
+
+    ELOGA("Error : QOI Data is Truncated.");
+    return false;
+}
+
+} // namespace r3d
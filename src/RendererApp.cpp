@@ -10,9 +10,10 @@
 #include <RendererApp.h>
 #include <fnd/asdxLogger.h>
 #include <fnd/asdxMisc.h>
-#include <process.h>
-#include <fpng.h>
-#include <OBJLoader.h>
+#include <Platform.h>
+#include <MappedFile.h>
+#include <SceneContainer.h>
+#include <xxhash.h>
 
 #if ASDX_ENABLE_IMGUI
 #include "../external/asdx12/external/imgui/imgui.h"
@@ -20,6 +21,8 @@
 
 #if RTC_TARGET == RTC_DEVELOP
 #include <pix3.h>
+#include <offline/SceneExporter.h>
+#include <offline/CameraSequenceExporter.h>
 #endif
 
 extern "C" { __declspec(dllexport) extern const UINT D3D12SDKVersion = 610;}
@@ -32,8 +35,21 @@ namespace {
 //-----------------------------------------------------------------------------
 // Constant Values.
 //-----------------------------------------------------------------------------
+static const uint64_t   RANDOM_SEED             = 1234567;
+static const double     MIN_RESUME_FRAME_SEC    = 0.5;  // 再開時に1フレームあたりに確保する最低限の時間[sec].
+static const uint32_t   PROBE_RENDER_COUNT      = 4;    // 事前パスで1フレームあたりに描画する回数.
+static const uint32_t   MAX_PROBE_COUNT         = 32;   // 事前パスで難しさを推定するフレーム数の上限.
+static const uint32_t   PROBE_INTERVAL          = 4;    // 事前パスで難しさを推定するフレームの最小の間隔.
+static const double     PROBE_BUDGET_RATIO      = 0.03; // 事前パスに使う残り時間の割合の上限.
+static const double     MIN_PROBE_SAMPLES       = 8.0;  // 1フレームあたりの描画回数がこれより少なければ割り振る余地が無いので事前パスを止める.
+static const double     MIN_SCHEDULE_SCALE      = 0.5;  // 均等に割り振った時間に対する1フレームの下限の比率.
+static const double     MAX_SCHEDULE_SCALE      = 2.0;  // 均等に割り振った時間に対する1フレームの上限の比率.
+static const double     MIN_SCHEDULE_FRAME_SEC  = 0.1;  // 1フレームに割り振る最低限の時間[sec]. 後に残すフレームの分も確保する.
+static const uint32_t   NOISE_ROW_STEP          = 2;    // ノイズを計測する行の間隔.
+
 #include "../res/shader/Compile/TonemapVS.inc"
 #include "../res/shader/Compile/TonemapCS.inc"
+#include "../res/shader/Compile/ResolveRadianceCS.inc"
 #include "../res/shader/Compile/RtCamp.inc"
 #include "../res/shader/Compile/ModelVS.inc"
 #include "../res/shader/Compile/ModelPS.inc"
@@ -53,8 +69,6 @@ static const D3D12_INPUT_ELEMENT_DESC kModelElements[] = {
     { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT   , 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 };
 
-static_assert(sizeof(r3d::ResVertex) == sizeof(VertexOBJ), "Vertex size not matched!");
-
 #if RTC_TARGET == RTC_DEVELOP
 static const size_t     REQUEST_BIT_INDEX   = 0;
 static const size_t     RELOADED_BIT_INDEX  = 1;
@@ -285,55 +299,6 @@ asdx::Vector4 CalcRotator(float angleRad, float angleScale)
     return result;
 }
 
-//-----------------------------------------------------------------------------
-//      画像に出力します.
-//-----------------------------------------------------------------------------
-unsigned Export(void* args)
-{
-    auto data = reinterpret_cast<r3d::Renderer::ExportData*>(args);
-    if (data == nullptr)
-    { return -1; }
-
-    // 解放されると不味いので参照カウンタを上げる.
-    data->pResources->AddRef();
-
-    // メモリマッピング.
-    uint8_t* ptr = nullptr;
-    auto hr = data->pResources->Map(0, nullptr, reinterpret_cast<void**>(&ptr));
-    if (FAILED(hr))
-    {
-        data->pResources->Release();
-        return -1;
-    }
-
-    if (fpng::fpng_encode_image_to_memory(
-        ptr,
-        data->Width,
-        data->Height,
-        4,
-        data->Converted))
-    {
-        char path[256] = {};
-        sprintf_s(path, "output_%03ld.png", data->FrameIndex);
-
-        FILE* pFile = nullptr;
-        auto err = fopen_s(&pFile, path, "wb");
-        if (err == 0)
-        {
-            fwrite(data->Converted.data(), 1, data->Converted.size(), pFile);
-            fclose(pFile);
-        }
-    }
-
-    // メモリマッピング解除.
-    data->pResources->Unmap(0, nullptr);
-
-    // 参照カウンタを下げる.
-    data->pResources->Release();
-
-    return 0;
-}
-
 //-----------------------------------------------------------------------------
 //      Radical Inverse Function of Sobol.
 //-----------------------------------------------------------------------------
@@ -383,6 +348,104 @@ asdx::Vector2 CalcTemporalJitterOffset(uint8_t index)
     return asdx::Vector2(float(sampleX), float(sampleY));
 }
 
+//-----------------------------------------------------------------------------
+//      ファイルの内容をハッシュに混ぜます.
+//-----------------------------------------------------------------------------
+uint64_t MixFileHash(const char* path, uint64_t hash)
+{
+    if (path == nullptr)
+    { return hash; }
+
+    // 見つからない場合はパスだけを混ぜる (読み込み時にエラーになる).
+    std::string findPath;
+    r3d::MappedFile file;
+    if (!asdx::SearchFilePathA(path, findPath) || !file.Init(findPath.c_str()))
+    { return XXH3_64bits_withSeed(path, strlen(path), hash); }
+
+    // .scn はヘッダとセクションテーブルだけを混ぜる.
+    // テーブルは各セクションのチェックサムを持っているので, 中身を全て読まなくても変更を検出できる.
+    auto size = file.GetSize();
+    if (size >= sizeof(r3d::SceneContainerHeader))
+    {
+        auto pHeader = reinterpret_cast<const r3d::SceneContainerHeader*>(file.GetData());
+        if (pHeader->Magic == r3d::SCENE_CONTAINER_MAGIC)
+        {
+            auto tableSize = sizeof(r3d::SceneContainerHeader) + size_t(pHeader->SectionCount) * sizeof(r3d::SceneSectionEntry);
+            if (tableSize <= size)
+            { size = tableSize; }
+        }
+    }
+
+    // .cam はヘッダを持たないが, カメラキーだけの小さなファイルなので全体を混ぜる.
+    return XXH3_64bits_withSeed(file.GetData(), size, hash);
+}
+
+//-----------------------------------------------------------------------------
+//      出力結果に影響する設定のハッシュを計算します.
+//
+//      シーンとカメラはファイルの内容を, シェーダは埋め込んだバイナリを混ぜるので,
+//      同じパスのまま再出力した場合も以前の記録とは一致しない.
+//      .scn はブロブファイルのセクションのチェックサムもテーブルに持っているので, ルートファイルのテーブルだけで足りる.
+//-----------------------------------------------------------------------------
+uint64_t CalcSequenceHash(const r3d::SceneDesc& desc)
+{
+    struct Params
+    {
+        double      FPS;
+        double      AnimationTimeSec;
+        uint32_t    OutputWidth;
+        uint32_t    OutputHeight;
+        uint32_t    RenderWidth;
+        uint32_t    RenderHeight;
+        uint32_t    OutputFormat;
+        uint32_t    CaptureHdr;
+        uint32_t    SkipDuplicate;
+        uint32_t    DuplicateTolerance;
+    };
+    static_assert(sizeof(Params) == 48, "Params Size Not Matched.");
+
+    Params params;
+    memset(&params, 0, sizeof(params));
+    params.FPS                  = desc.FPS;
+    params.AnimationTimeSec     = desc.AnimationTimeSec;
+    params.OutputWidth          = desc.OutputWidth;
+    params.OutputHeight         = desc.OutputHeight;
+    params.RenderWidth          = desc.RenderWidth;
+    params.RenderHeight         = desc.RenderHeight;
+    params.OutputFormat         = uint32_t(desc.OutputFormat);
+    params.CaptureHdr           = desc.CaptureHdr ? 1 : 0;
+    params.SkipDuplicate        = desc.SkipDuplicate ? 1 : 0;
+    params.DuplicateTolerance   = desc.SkipDuplicate ? desc.DuplicateTolerance : 0;
+
+    auto hash = XXH3_64bits(&params, sizeof(params));
+    hash = MixFileHash(desc.SceneFilePath,  hash);
+    hash = MixFileHash(desc.CameraFilePath, hash);
+
+    struct Binary
+    {
+        const void* pData;
+        size_t      Size;
+    };
+
+    const Binary shaders[] = {
+        { TonemapVS,                sizeof(TonemapVS) },
+        { TonemapCS,                sizeof(TonemapCS) },
+        { ResolveRadianceCS,        sizeof(ResolveRadianceCS) },
+        { RtCamp,                   sizeof(RtCamp) },
+        { PreBlurCS,                sizeof(PreBlurCS) },
+        { TemporalAccumulationCS,   sizeof(TemporalAccumulationCS) },
+        { DenoiserCS,               sizeof(DenoiserCS) },
+        { TemporalStabilizationCS,  sizeof(TemporalStabilizationCS) },
+        { PostBlurCS,               sizeof(PostBlurCS) },
+        { TaaCS,                    sizeof(TaaCS) },
+    };
+
+    for(auto& shader : shaders)
+    { hash = XXH3_64bits_withSeed(shader.pData, shader.Size, hash); }
+
+    return hash;
+}
+
 } // namespace
 
 
@@ -543,7 +606,7 @@ void Renderer::RayTracingPipe::Dispatch
 Renderer::Renderer(const SceneDesc& desc)
 : asdx::Application(L"Ponzu Renderer", desc.OutputWidth, desc.OutputHeight, nullptr, nullptr, nullptr)
 , m_SceneDesc(desc)
-, m_PcgRandom(1234567)
+, m_PcgRandom(RANDOM_SEED)
 {
     m_RenderingTimer.Start();
 
@@ -595,15 +658,67 @@ bool Renderer::OnInit()
 
     // 1フレームあたりの時間を算出.
     {
-        auto setupTime  = m_Timer.GetRelativeSec();
-        auto renderTime = m_SceneDesc.RenderTimeSec - setupTime;
-        auto totalFrame = double(m_SceneDesc.FPS * m_SceneDesc.AnimationTimeSec);
-        m_AnimationOneFrameTime = renderTime / totalFrame;
+        // 中断から再開する場合は完了済みのフレームを飛ばして, 残り時間を未完了のフレームに割り振る.
+        auto resumed = m_Journal.IsResumed();
+        if (resumed)
+        {
+            auto& state = m_Journal.GetResumeState();
+            m_ElapsedOffsetSec    = state.ElapsedSec;
+            m_FrameIndexOffset    = state.RenderFrameCount;
+            m_TemporalJitterIndex = uint8_t(state.JitterIndex % 8);
+            m_PcgRandom           = asdx::PCG(RANDOM_SEED + state.RenderFrameCount);
+        }
+
+        m_CaptureIndex = m_Journal.FindPending(0);
+
+        auto pendingCount = m_Journal.CountPending(m_CaptureIndex);
+        auto elapsedSec   = m_ElapsedOffsetSec + m_Timer.GetRelativeSec();
+        auto minFrameSec  = resumed ? MIN_RESUME_FRAME_SEC : 0.0;
+        m_RenderDeadlineSec     = CalcRenderDeadline(m_SceneDesc.RenderTimeSec, elapsedSec, pendingCount, minFrameSec);
+        m_AnimationOneFrameTime = m_BudgetScheduler.GetFrameTime(m_CaptureIndex, m_RenderDeadlineSec, elapsedSec);
         m_AnimationElapsedTime  = 0.0f;
 
+        // 事前パスで難しさを推定するフレームを, 未完了のフレームから等間隔に選ぶ.
+        m_ProbeFrames.clear();
+        m_ProbeIndex       = 0;
+        m_ProbeRenderCount = 0;
+        m_ProbeElapsedSec  = 0.0;
+        m_ProbeBeginSec    = elapsedSec;
+        m_ProbeLimitSec    = (m_RenderDeadlineSec - elapsedSec) * PROBE_BUDGET_RATIO;
+
+        auto probeCount = std::min(MAX_PROBE_COUNT, pendingCount / PROBE_INTERVAL);
+        if (probeCount > 0)
+        {
+            std::vector<uint32_t> pendingFrames;
+            pendingFrames.reserve(pendingCount);
+            for(auto i=m_CaptureIndex; i<m_Journal.GetFrameCount(); ++i)
+            {
+                if (!m_Journal.IsCompleted(i))
+                { pendingFrames.push_back(i); }
+            }
+
+            for(auto i=0u; i<probeCount; ++i)
+            { m_ProbeFrames.push_back(pendingFrames[size_t((i + 0.5) * pendingFrames.size() / probeCount)]); }
+        }
+
         DLOG("Animation One Frame Time = %lf[sec]", m_AnimationOneFrameTime);
 
-        ChangeFrame(0);
+        if (resumed)
+        {
+            auto stats = m_Journal.GetStats();
+            ILOG("Resumed : %u / %u frames completed (rejected %u), elapsed %lf[sec], deadline %lf[sec], verify %lf[sec]",
+                stats.ResumedCount, m_Journal.GetFrameCount(), stats.RejectedCount,
+                m_ElapsedOffsetSec, m_RenderDeadlineSec, stats.VerifySec);
+        }
+
+        if (pendingCount == 0)
+        {
+            ILOG("All frames are already completed.");
+            PostQuitMessage(0);
+            m_EndRequest = true;
+        }
+
+        ChangeFrame(m_CaptureIndex);
     }
 
     // 標準出力をフラッシュ.
@@ -665,9 +780,6 @@ bool Renderer::SystemSetup()
         }
     }
 
-    // PNGライブラリ初期化.
-    fpng::fpng_init();
-
     m_RendererViewport.TopLeftX = 0.0f;
     m_RendererViewport.TopLeftY = 0.0f;
     m_RendererViewport.Width    = FLOAT(m_SceneDesc.RenderWidth);
@@ -702,6 +814,101 @@ bool Renderer::SystemSetup()
         m_CaptureTarget.SetName(L"CaptureTarget");
     }
 
+    // HDR キャプチャー用ターゲットとリードバックバッファ.
+    if (m_SceneDesc.CaptureHdr)
+    {
+        asdx::TargetDesc desc;
+        desc.Dimension          = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+        desc.Width              = m_SceneDesc.RenderWidth;
+        desc.Height             = m_SceneDesc.RenderHeight;
+        desc.DepthOrArraySize   = 1;
+        desc.Format             = DXGI_FORMAT_R16G16B16A16_FLOAT;
+        desc.MipLevels          = 1;
+        desc.SampleDesc.Count   = 1;
+        desc.SampleDesc.Quality = 0;
+        desc.InitState          = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+        if (!m_HdrCaptureTarget.Init(&desc))
+        {
+            ELOGA("Error : HdrCaptureTarget Init Failed.");
+            return false;
+        }
+
+        m_HdrCaptureTarget.SetName(L"HdrCaptureTarget");
+
+        UINT   rowCount     = 0;
+        UINT64 pitchSize    = 0;
+        UINT64 resSize      = 0;
+
+        D3D12_RESOURCE_DESC srcDesc = {};
+        srcDesc.Dimension           = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+        srcDesc.Alignment           = 0;
+        srcDesc.Width               = m_SceneDesc.RenderWidth;
+        srcDesc.Height              = m_SceneDesc.RenderHeight;
+        srcDesc.DepthOrArraySize    = 1;
+        srcDesc.MipLevels           = 1;
+        srcDesc.Format              = DXGI_FORMAT_R16G16B16A16_FLOAT;
+        srcDesc.SampleDesc.Count    = 1;
+        srcDesc.SampleDesc.Quality  = 0;
+        srcDesc.Layout              = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+        srcDesc.Flags               = D3D12_RESOURCE_FLAG_NONE;
+
+        pDevice->GetCopyableFootprints(&srcDesc,
+            0,
+            1,
+            0,
+            nullptr,
+            &rowCount,
+            &pitchSize,
+            &resSize);
+
+        m_HdrReadBackPitch = static_cast<uint32_t>((pitchSize + 255) & ~0xFFu);
+
+        D3D12_RESOURCE_DESC bufDesc = {};
+        bufDesc.Dimension           = D3D12_RESOURCE_DIMENSION_BUFFER;
+        bufDesc.Alignment           = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        bufDesc.Width               = uint64_t(m_HdrReadBackPitch) * m_SceneDesc.RenderHeight;
+        bufDesc.Height              = 1;
+        bufDesc.DepthOrArraySize    = 1;
+        bufDesc.MipLevels           = 1;
+        bufDesc.Format              = DXGI_FORMAT_UNKNOWN;
+        bufDesc.SampleDesc.Count    = 1;
+        bufDesc.SampleDesc.Quality  = 0;
+        bufDesc.Layout              = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        bufDesc.Flags               = D3D12_RESOURCE_FLAG_NONE;
+
+        D3D12_HEAP_PROPERTIES props = {};
+        props.Type = D3D12_HEAP_TYPE_READBACK;
+
+        for(auto i=0; i<3; ++i)
+        {
+            auto hr = pDevice->CreateCommittedResource(
+                &props,
+                D3D12_HEAP_FLAG_NONE,
+                &bufDesc,
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                nullptr,
+                IID_PPV_ARGS(m_HdrReadBackTexture[i].GetAddress()));
+
+            if (FAILED(hr))
+            {
+                ELOGA("Error : ID3D12Device::CreateCommittedResource() Failed. errcode = 0x%x", hr);
+                return false;
+            }
+        }
+
+        m_HdrReadBackTexture[0]->SetName(L"HdrReadBackTexture0");
+        m_HdrReadBackTexture[1]->SetName(L"HdrReadBackTexture1");
+        m_HdrReadBackTexture[2]->SetName(L"HdrReadBackTexture2");
+
+        // EXR のブロックごとの圧縮スレッド.
+        if (!m_ExrEncoder.Init())
+        {
+            ELOG("Error : ExrEncoder::Init() Failed.");
+            return false;
+        }
+    }
+
     // リードバックテクスチャ生成.
     {
         D3D12_RESOURCE_DESC desc = {};
@@ -769,13 +976,140 @@ bool Renderer::SystemSetup()
 
         m_ReadBackPitch = static_cast<uint32_t>((pitchSize + 255) & ~0xFFu);
 
-        m_ExportData.resize(2);
-        for(auto i=0; i<m_ExportData.size(); ++i)
+        if (m_SceneDesc.StreamPath != nullptr)
+        {
+            // 連番画像の代わりに動画ストリームを出力.
+            VideoStreamDesc streamDesc = {};
+            streamDesc.Path         = m_SceneDesc.StreamPath;
+            streamDesc.Format       = m_SceneDesc.StreamFormat;
+            streamDesc.Width        = m_SceneDesc.OutputWidth;
+            streamDesc.Height       = m_SceneDesc.OutputHeight;
+            streamDesc.FrameRate    = m_SceneDesc.FPS;
+
+            if (!m_VideoStream.Init(streamDesc))
+            {
+                ELOG("Error : VideoStream::Init() Failed.");
+                return false;
+            }
+        }
+        else
+        {
+            // 出力フォーマットのエンコーダ.
+            switch(m_SceneDesc.OutputFormat)
+            {
+            case IMAGE_FORMAT_PNG:
+                {
+                    // PNG の帯ごとの圧縮スレッド.
+                    if (!m_PngEncoder.Init())
+                    {
+                        ELOG("Error : PngEncoder::Init() Failed.");
+                        return false;
+                    }
+                    m_pImageEncoder = &m_PngEncoder;
+                }
+                break;
+
+            case IMAGE_FORMAT_QOI:
+                {
+                    m_pImageEncoder = &m_QoiEncoder;
+                }
+                break;
+
+            default:
+                {
+                    ELOG("Error : Invalid Output Format. format = %d", m_SceneDesc.OutputFormat);
+                    return false;
+                }
+            }
+        }
+
+        // 重複フレームの検出 (動画ストリームは全フレームを書き出すので対象外).
+        if (m_SceneDesc.SkipDuplicate && !m_VideoStream.IsOpen())
+        {
+            FrameDedupDesc dedupDesc = {};
+            dedupDesc.Width     = m_SceneDesc.OutputWidth;
+            dedupDesc.Height    = m_SceneDesc.OutputHeight;
+            dedupDesc.Tolerance = m_SceneDesc.DuplicateTolerance;
+            dedupDesc.TileSize  = 0;
+
+            if (!m_FrameDedup.Init(dedupDesc))
+            {
+                ELOG("Error : FrameDedup::Init() Failed.");
+                return false;
+            }
+
+            m_SkipDuplicate = true;
+        }
+
+        // 出力ファイルの書き込み (エンコードと書き込みを重ねる).
+        AsyncFileWriterDesc writerDesc = {};
+        writerDesc.QueueDepth      = 0;
+        writerDesc.ThreadCount     = 0;
+        writerDesc.ChunkSize       = 0;
+        writerDesc.MaxPendingBytes = 0;
+        writerDesc.DirectIO        = m_SceneDesc.DirectIO;
+
+        if (!m_FileWriter.Init(writerDesc))
+        {
+            ELOG("Error : AsyncFileWriter::Init() Failed.");
+            return false;
+        }
+
+        // 完了したフレームの記録 (動画ストリームは途中から再開できないのでファイルに残さない).
+        CaptureJournalDesc journalDesc = {};
+        journalDesc.Path         = nullptr;
+        journalDesc.SequenceHash = 0;
+        journalDesc.FrameCount   = uint32_t(m_SceneDesc.FPS * m_SceneDesc.AnimationTimeSec) + 1;
+        journalDesc.OutputCount  = m_SceneDesc.CaptureHdr ? 2 : 1;
+    #if RTC_TARGET == RTC_RELEASE
+        if (!m_VideoStream.IsOpen())
+        { journalDesc.Path = m_SceneDesc.JournalPath; }
+    #endif
+
+        // ハッシュは記録ファイルとの照合にしか使わない.
+        if (journalDesc.Path != nullptr)
+        { journalDesc.SequenceHash = CalcSequenceHash(m_SceneDesc); }
+
+        if (!m_Journal.Init(journalDesc))
         {
-            m_ExportData[i].FrameIndex  = 0;
-            m_ExportData[i].Width       = m_SceneDesc.OutputWidth;
-            m_ExportData[i].Height      = m_SceneDesc.OutputHeight;
+            ELOG("Error : CaptureJournal::Init() Failed.");
+            return false;
+        }
+
+        // 収束具合に応じた描画時間の割り振り.
+        BudgetSchedulerDesc budgetDesc = {};
+        budgetDesc.FrameCount  = journalDesc.FrameCount;
+        budgetDesc.MinScale    = MIN_SCHEDULE_SCALE;
+        budgetDesc.MaxScale    = MAX_SCHEDULE_SCALE;
+        budgetDesc.MinFrameSec = MIN_SCHEDULE_FRAME_SEC;
+
+        if (!m_BudgetScheduler.Init(budgetDesc))
+        {
+            ELOG("Error : BudgetScheduler::Init() Failed.");
+            return false;
         }
+
+        for(auto i=0u; i<budgetDesc.FrameCount; ++i)
+        {
+            if (m_Journal.IsCompleted(i))
+            { m_BudgetScheduler.SetDone(i, 0.0); }
+        }
+
+        // 画像出力スレッド.
+        EncoderPoolDesc encoderDesc = {};
+        encoderDesc.WorkerCount = m_SceneDesc.EncoderThreadCount;
+        encoderDesc.BufferCount = m_SceneDesc.EncoderBufferCount;
+        encoderDesc.BufferSize  = uint64_t(m_ReadBackPitch) * m_SceneDesc.OutputHeight;
+        encoderDesc.HdrBufferSize = uint64_t(m_HdrReadBackPitch) * m_SceneDesc.RenderHeight;
+        encoderDesc.pHandler    = this;
+
+        if (!m_EncoderPool.Init(encoderDesc))
+        {
+            ELOG("Error : EncoderPool::Init() Failed.");
+            return false;
+        }
+
+        m_ExportData.resize(m_EncoderPool.GetWorkerCount());
     }
 
     #ifdef ASDX_ENABLE_IMGUI
@@ -912,6 +1246,19 @@ bool Renderer::SystemSetup()
         }
     }
 
+    // 放射輝度解決用パイプラインステート生成.
+    {
+        D3D12_COMPUTE_PIPELINE_STATE_DESC desc = {};
+        desc.pRootSignature = m_TonemapRootSig.GetPtr();
+        desc.CS             = { ResolveRadianceCS, sizeof(ResolveRadianceCS) };
+
+        if (!m_ResolveRadiancePipe.Init(pDevice, &desc))
+        {
+            ELOGA("Error : ResolveRadiance PipelineState Init Failed.");
+            return false;
+        }
+    }
+
     // ヒストリーバッファ生成.
     {
         asdx::TargetDesc desc;
@@ -1679,10 +2026,13 @@ bool Renderer::BuildScene()
     timer.Start();
     printf_s("Build scene  ... ");
 
+    m_Scene.SetUploadHeapSize(m_SceneDesc.UploadHeapSize);
+
     #if RTC_TARGET == RTC_DEVELOP
     {
-        SceneExporter sceneExporter;
+        offline::SceneExporter sceneExporter;
         std::string sceneExportPath;
+        sceneExporter.SetPlacedFootprint(true);
         if (!sceneExporter.LoadFromTXT(SCENE_SETTING_PATH, sceneExportPath))
         {
             ELOG("Error : Scene Load Failed.");
@@ -1695,7 +2045,7 @@ bool Renderer::BuildScene()
             return false;
         }
 
-        CameraSequenceExporter cameraExporter;
+        offline::CameraSequenceExporter cameraExporter;
         std::string cameraExportPath;
         if (!cameraExporter.LoadFromTXT(CAMERA_SETTING_PATH, cameraExportPath))
         {
@@ -1745,6 +2095,7 @@ bool Renderer::BuildScene()
 
         // 待機点を発行.
         m_FrameWaitPoint = pGraphicsQueue->Signal();
+        m_Scene.Submit(m_FrameWaitPoint);
 
         // 完了を待機.
         pGraphicsQueue->Sync(m_FrameWaitPoint);
@@ -1765,6 +2116,55 @@ void Renderer::OnTerm()
     asdx::StopWatch timer;
     timer.Start();
 
+    // 出力待ちのフレームを書き出してから終了.
+    {
+        m_EncoderPool.Drain();
+        m_FileWriter .Flush();
+
+        auto stats = m_EncoderPool.GetStats();
+        printf_s("Export Frames     ... %llu (failed %llu)\n", stats.CompleteCount, stats.FailCount);
+        printf_s("Export Encode     ... %lf[sec]\n", stats.EncodeSec);
+        printf_s("Export Stall      ... %llu times, total %lf[msec], max %lf[msec]\n",
+            stats.StallCount, stats.StallSec * 1000.0, stats.MaxStallSec * 1000.0);
+        if (m_VideoStream.IsOpen())
+        { printf_s("Export Stream     ... %u frames\n", m_VideoStream.GetWrittenCount()); }
+        if (m_SkipDuplicate)
+        {
+            auto dedup = m_FrameDedup.GetStats();
+            printf_s("Export Duplicate  ... %llu / %llu frames, check %lf[msec], saved %lf[sec] (estimated)\n",
+                dedup.DuplicateCount, dedup.CheckCount, dedup.CheckSec * 1000.0, dedup.SavedSec);
+        }
+        {
+            auto writer = m_FileWriter.GetStats();
+            auto count  = (writer.WriteCount > 0) ? double(writer.WriteCount) : 1.0;
+            printf_s("Export Write      ... %llu files (failed %llu), %llu bytes, %s\n",
+                writer.FileCount, writer.FailCount, writer.WriteBytes, writer.UseIoUring ? "io_uring" : "threads");
+            printf_s("Export Write Queue... max depth %u, latency avg %lf[msec], max %lf[msec], stall %llu times\n",
+                writer.MaxQueueDepth, writer.LatencySec * 1000.0 / count, writer.MaxLatencySec * 1000.0, writer.StallCount);
+        }
+        {
+            auto journal = m_Journal.GetStats();
+            printf_s("Export Journal    ... %u / %u frames completed (resumed %u, rejected %u), write failed %u\n",
+                journal.CompletedCount, m_Journal.GetFrameCount(), journal.ResumedCount, journal.RejectedCount, journal.FailCount);
+        }
+        {
+            auto budget = m_BudgetScheduler.GetStats();
+            printf_s("Export Budget     ... probe %u frames, measured %u frames, frame time %lf - %lf[sec]\n",
+                budget.EstimateCount, budget.ReportCount, budget.MinFrameSec, budget.MaxFrameSec);
+        }
+
+        m_EncoderPool.Term();
+        m_FileWriter .Term();
+        m_PngEncoder .Term();
+        m_ExrEncoder .Term();
+        m_VideoStream.Term();
+        m_FrameDedup .Term();
+        m_Journal    .Term();
+        m_BudgetScheduler.Term();
+        m_pImageEncoder = nullptr;
+        m_SkipDuplicate = false;
+    }
+
     #ifdef ASDX_ENABLE_IMGUI
     asdx::GuiMgr::Instance().Term();
     #endif
@@ -1783,6 +2183,7 @@ void Renderer::OnTerm()
     for(auto i=0; i<3; ++i) 
     {
         m_ReadBackTexture[i].Reset();
+        m_HdrReadBackTexture[i].Reset();
     }
 
     // シーン関連.
@@ -1793,7 +2194,8 @@ void Renderer::OnTerm()
 
     // レンダーターゲット関連.
     {
-        m_CaptureTarget.Term();
+        m_CaptureTarget   .Term();
+        m_HdrCaptureTarget.Term();
 
         for(auto i=0; i<2; ++i)
         {
@@ -1817,10 +2219,6 @@ void Renderer::OnTerm()
 
     // 出力データ関連.
     {
-        for(auto i=0; i<m_ExportData.size(); ++i)
-        {
-            m_ExportData[i].Converted.clear();
-        }
         m_ExportData.clear();
     }
 
@@ -1841,6 +2239,7 @@ void Renderer::OnTerm()
 
         m_CopyPipe   .Term();
         m_TaaPipe    .Term();
+        m_ResolveRadiancePipe.Term();
         m_TonemapPipe.Term();
         m_ModelPipe  .Term();
         m_RtPipe     .Term();
@@ -1867,14 +2266,18 @@ void Renderer::OnTerm()
 void Renderer::OnFrameMove(asdx::FrameEventArgs& args)
 {
 #if RTC_TARGET == RTC_RELEASE
+    if (m_EndRequest)
+    { return; }
+
     // 制限時間を超えた
-    if (args.Time >= m_SceneDesc.RenderTimeSec)
+    if (m_ElapsedOffsetSec + args.Time >= m_RenderDeadlineSec)
     {
-        // キャプチャー実行.
-        uint32_t totalFrame = uint32_t(m_SceneDesc.FPS * m_SceneDesc.AnimationTimeSec);
-        if (m_CaptureIndex <= totalFrame)
+        // キャプチャー実行 (事前パスの画像は出力しない).
+        if (m_CaptureIndex < m_Journal.GetFrameCount() && m_ProbeIndex >= m_ProbeFrames.size())
         {
-            CaptureScreen(m_ReadBackTexture[m_ReadBackTargetIndex].GetPtr());
+            CaptureScreen(
+                m_ReadBackTexture   [m_ReadBackTargetIndex].GetPtr(),
+                m_HdrReadBackTexture[m_ReadBackTargetIndex].GetPtr());
         }
 
         ILOG("Rendering Finished.");
@@ -1885,19 +2288,49 @@ void Renderer::OnFrameMove(asdx::FrameEventArgs& args)
         return;
     }
 
-    // CPUで読み取り.
+    // シーンが揃うまでは事前パスも出力も始めない.
+    if (!m_Scene.IsLoaded())
+    {
+        m_WaitSceneLoad = true;
+        return;
+    }
+
+    // 読み込みに掛かった時間を除いた残り時間で割り振り直す.
+    if (m_WaitSceneLoad)
+    {
+        auto elapsedSec = m_ElapsedOffsetSec + m_Timer.GetRelativeSec();
+        m_ProbeBeginSec         = elapsedSec;
+        m_ProbeLimitSec         = (m_RenderDeadlineSec - elapsedSec) * PROBE_BUDGET_RATIO;
+        m_AnimationOneFrameTime = m_BudgetScheduler.GetFrameTime(m_CaptureIndex, m_RenderDeadlineSec, elapsedSec);
+        m_AnimationElapsedTime  = 0.0;
+        m_RequestReset          = true;
+        m_WaitSceneLoad         = false;
+    }
+
+    // 事前パスでフレームごとの難しさを推定.
+    if (m_ProbeIndex < m_ProbeFrames.size())
+    {
+        UpdateProbe(args.ElapsedTime);
+        return;
+    }
+
+    // CPUで読み取り. 次の描画で割り振った時間を超えるなら今の画像を出力する.
+    // 超えてから出力すると使い過ぎた分が後のフレームから削られ, 締め切りに間に合わなくなる.
     m_AnimationElapsedTime += args.ElapsedTime;
-    if (m_AnimationElapsedTime >= m_AnimationOneFrameTime && GetFrameCount() > 0)
+    m_BudgetScheduler.SetSampleSec(args.ElapsedTime);
+    if (m_AnimationElapsedTime + args.ElapsedTime > m_AnimationOneFrameTime && GetFrameCount() > 0 && m_CaptureIndex < m_Journal.GetFrameCount())
     {
         // キャプチャー実行.
-        CaptureScreen(m_ReadBackTexture[m_ReadBackTargetIndex].GetPtr());
+        CaptureScreen(
+            m_ReadBackTexture   [m_ReadBackTargetIndex].GetPtr(),
+            m_HdrReadBackTexture[m_ReadBackTargetIndex].GetPtr());
 
         // 次のフレームに切り替え.
         m_AnimationElapsedTime = 0.0;
 
         // 適宜調整する.
-        auto totalFrame = double(m_SceneDesc.FPS * m_SceneDesc.AnimationTimeSec - (m_CaptureIndex - 1));
-        m_AnimationOneFrameTime = (m_SceneDesc.RenderTimeSec - m_Timer.GetRelativeSec()) / totalFrame;
+        auto elapsedSec = m_ElapsedOffsetSec + m_Timer.GetRelativeSec();
+        m_AnimationOneFrameTime = m_BudgetScheduler.GetFrameTime(m_CaptureIndex, m_RenderDeadlineSec, elapsedSec);
     }
 
     ChangeFrame(m_CaptureIndex);
@@ -1906,6 +2339,74 @@ void Renderer::OnFrameMove(asdx::FrameEventArgs& args)
 #endif
 }
 
+//-----------------------------------------------------------------------------
+//      事前パスでフレームの難しさを推定します.
+//-----------------------------------------------------------------------------
+void Renderer::UpdateProbe(double elapsedTime)
+{
+    if (m_ProbeRenderCount > 0)
+    { m_ProbeElapsedSec += elapsedTime; }
+
+    if (m_ProbeRenderCount >= PROBE_RENDER_COUNT)
+    {
+        auto frameIndex = m_ProbeFrames[m_ProbeIndex];
+        auto sampleSec  = m_ProbeElapsedSec / double(m_ProbeRenderCount);
+        m_BudgetScheduler.SetSampleSec(sampleSec);
+
+        // リードバックは2フレーム遅れるので, 蓄積数が1少ない画像を計測する.
+        auto pResource = m_ReadBackTexture[m_ReadBackTargetIndex].GetPtr();
+        uint8_t* ptr = nullptr;
+        auto hr = pResource->Map(0, nullptr, reinterpret_cast<void**>(&ptr));
+        if (SUCCEEDED(hr))
+        {
+            auto variance = EstimateNoiseVariance(
+                ptr,
+                m_SceneDesc.OutputWidth,
+                m_SceneDesc.OutputHeight,
+                m_ReadBackPitch,
+                NOISE_ROW_STEP);
+            pResource->Unmap(0, nullptr);
+
+            m_BudgetScheduler.SetEstimate(frameIndex, variance, sampleSec * (PROBE_RENDER_COUNT - 1));
+        }
+        else
+        {
+            ELOG("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
+        }
+
+        m_ProbeIndex++;
+        m_ProbeRenderCount = 0;
+        m_ProbeElapsedSec  = 0.0;
+
+        // 時間を使い過ぎた場合や, 描画回数が少なくて割り振る余地が無い場合は打ち切る.
+        auto elapsedSec = m_ElapsedOffsetSec + m_Timer.GetRelativeSec();
+        auto frameSec   = (m_RenderDeadlineSec - elapsedSec) / double(std::max(m_BudgetScheduler.GetPendingCount(), 1u));
+        if (elapsedSec - m_ProbeBeginSec >= m_ProbeLimitSec || frameSec < sampleSec * MIN_PROBE_SAMPLES)
+        { m_ProbeIndex = uint32_t(m_ProbeFrames.size()); }
+
+        if (m_ProbeIndex >= m_ProbeFrames.size())
+        {
+            auto stats = m_BudgetScheduler.GetStats();
+            ILOG("Probe Finished : %u frames, %lf[sec]", stats.EstimateCount, elapsedSec - m_ProbeBeginSec);
+
+            // 推定した難しさで割り振り直して本描画を始める.
+            m_AnimationOneFrameTime = m_BudgetScheduler.GetFrameTime(m_CaptureIndex, m_RenderDeadlineSec, elapsedSec);
+            m_AnimationElapsedTime  = 0.0;
+            m_RequestReset          = true;
+
+            ChangeFrame(m_CaptureIndex);
+            return;
+        }
+    }
+
+    // 直前と同じカメラでも蓄積をやり直す.
+    if (m_ProbeRenderCount == 0)
+    { m_RequestReset = true; }
+
+    ChangeFrame(m_ProbeFrames[m_ProbeIndex]);
+    m_ProbeRenderCount++;
+}
+
 //-----------------------------------------------------------------------------
 //      アニメーション用の変更処理です.
 //-----------------------------------------------------------------------------
@@ -1924,8 +2425,11 @@ void Renderer::ChangeFrame(uint32_t index)
     auto aspectRatio = float(m_SceneDesc.RenderWidth) / float(m_SceneDesc.RenderHeight);
     m_Camera.Update(index, aspectRatio);
 
+    // 逆行列も計算済みのものを使う.
     m_CurrView    = m_Camera.GetCurrView();
     m_CurrProj    = m_Camera.GetCurrProj();
+    m_CurrInvView = m_Camera.GetCurrInvView();
+    m_CurrInvProj = m_Camera.GetCurrInvProj();
     m_CameraZAxis = m_Camera.GetCameraDir();
 
     nearClip = m_Camera.GetNearClip();
@@ -1946,10 +2450,10 @@ void Renderer::ChangeFrame(uint32_t index)
     nearClip = m_AppCamera.GetNearClip();
     farClip  = m_AppCamera.GetFarClip ();
     fovY     = m_FovY;
-#endif
 
     m_CurrInvView = asdx::Matrix::Invert(m_CurrView);
     m_CurrInvProj = asdx::Matrix::Invert(m_CurrProj);
+#endif
 
     auto changed = memcmp(&m_CurrView, &m_PrevView, sizeof(asdx::Matrix)) != 0;
 
@@ -1963,6 +2467,12 @@ void Renderer::ChangeFrame(uint32_t index)
         if (GetFrameCount() <= 1)
         { m_ResetHistory = true; }
 
+        if (m_RequestReset)
+        {
+            changed = true;
+            m_RequestReset = false;
+        }
+
     #if RTC_TARGET == RTC_DEVELOP
         if (m_Dirty)
         {
@@ -1979,6 +2489,12 @@ void Renderer::ChangeFrame(uint32_t index)
         }
     #endif
 
+        // 読み込み途中はセクションが届くたびに見た目が変わる.
+        if (!m_Scene.IsLoaded())
+        {
+            changed = true;
+        }
+
         // カメラ変更があったかどうか?
         if (changed)
         {
@@ -2003,7 +2519,7 @@ void Renderer::ChangeFrame(uint32_t index)
         param.PrevInvViewProj       = m_PrevInvViewProj;
         param.MaxBounce             = MAX_RECURSION_DEPTH;
         param.MinBounce             = 4;
-        param.FrameIndex            = GetFrameCount();
+        param.FrameIndex            = GetFrameCount() + m_FrameIndexOffset;
         param.SkyIntensity          = 5.0f;
         param.EnableAccumulation    = enableAccumulation;
         param.AccumulatedFrames     = m_AccumulatedFrames;
@@ -2056,10 +2572,22 @@ void Renderer::OnFrameRender(asdx::FrameEventArgs& args)
     m_GfxCmdList.Reset();
     auto pCmd = m_GfxCmdList.GetCommandList();
 
+    // 読み込み途中のシーンは1フレームあたりのアップロード量を制限して, 揃った分から描画する.
+    if (!m_Scene.UpdateStream(pCmd))
+    {
+        ELOG("Error : Scene::UpdateStream() Failed.");
+        PostQuitMessage(0);
+        m_EndRequest = true;
+    }
+
+    // 動的インスタンスの更新.
+    if (m_Scene.IsDrawable())
+    {
+        m_Scene.Update(pCmd);
+    }
+
     // G-Buffer描画.
-#if RTC_TARGET == RTC_DEVELOP
-    if (!m_Scene.IsReloading())
-#endif
+    if (m_Scene.IsDrawable())
     {
         RTC_DEBUG_CODE(ScopedMarker marker(pCmd, "G-Buffer"));
 
@@ -2122,9 +2650,7 @@ void Renderer::OnFrameRender(asdx::FrameEventArgs& args)
     RTC_DEBUG_CODE(m_Scene.Polling(m_GfxCmdList.GetCommandList()));
 
     // レイトレ実行.
-#if RTC_TARGET == RTC_DEVELOP
-    if (!m_Scene.IsReloading())
-#endif
+    if (m_Scene.IsDrawable())
     {
         RTC_DEBUG_CODE(ScopedMarker marker(pCmd, "PathTracing"));
 
@@ -2168,6 +2694,23 @@ void Renderer::OnFrameRender(asdx::FrameEventArgs& args)
         asdx::UAVBarrier(pCmd, m_Tonemapped.GetResource());
     }
 
+    // HDR キャプチャー用に蓄積した放射輝度を平均化.
+    if (m_SceneDesc.CaptureHdr)
+    {
+        RTC_DEBUG_CODE(ScopedMarker marker(pCmd, "ResolveRadiance"));
+
+        m_HdrCaptureTarget.Transition(pCmd, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+        pCmd->SetComputeRootSignature(m_TonemapRootSig.GetPtr());
+        m_ResolveRadiancePipe.SetState(pCmd);
+        pCmd->SetComputeRootDescriptorTable(0, m_Radiance.GetSRV()->GetHandleGPU());
+        pCmd->SetComputeRootConstantBufferView(1, m_SceneParam.GetResource()->GetGPUVirtualAddress());
+        pCmd->SetComputeRootDescriptorTable(2, m_HdrCaptureTarget.GetUAV()->GetHandleGPU());
+        pCmd->Dispatch(threadX, threadY, 1);
+
+        asdx::UAVBarrier(pCmd, m_HdrCaptureTarget.GetResource());
+    }
+
     asdx::Vector3 randomAngle;
     randomAngle.x = m_PcgRandom.GetAsF32() * asdx::ToRadian(360.0f);
     randomAngle.y = m_PcgRandom.GetAsF32() * asdx::ToRadian(360.0f);
@@ -2465,6 +3008,24 @@ void Renderer::OnFrameRender(asdx::FrameEventArgs& args)
         box.back    = 1;
 
         pCmd->CopyTextureRegion(&dst, 0, 0, 0, &src, &box);
+
+        if (m_SceneDesc.CaptureHdr)
+        {
+            m_HdrCaptureTarget.Transition(pCmd, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+            dst.pResource                           = m_HdrReadBackTexture[m_CaptureTargetIndex].GetPtr();
+            dst.PlacedFootprint.Footprint.Width     = static_cast<UINT>(m_SceneDesc.RenderWidth);
+            dst.PlacedFootprint.Footprint.Height    = m_SceneDesc.RenderHeight;
+            dst.PlacedFootprint.Footprint.RowPitch  = m_HdrReadBackPitch;
+            dst.PlacedFootprint.Footprint.Format    = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+            src.pResource = m_HdrCaptureTarget.GetResource();
+
+            box.right   = m_SceneDesc.RenderWidth;
+            box.bottom  = m_SceneDesc.RenderHeight;
+
+            pCmd->CopyTextureRegion(&dst, 0, 0, 0, &src, &box);
+        }
     }
 
     // スワップチェインに描画.
@@ -2572,6 +3133,7 @@ void Renderer::OnFrameRender(asdx::FrameEventArgs& args)
 
     // 待機点を発行.
     m_FrameWaitPoint = pGraphicsQueue->Signal();
+    m_Scene.Submit(m_FrameWaitPoint);
 
     // 画面に表示.
     Present(0);
@@ -2794,13 +3356,19 @@ void Renderer::Draw2D(float elapsedSec)
             }
             if (ImGui::Button(u8"シーン設定 リロード"))
             {
-                SceneExporter exporter;
+                offline::SceneExporter exporter;
                 std::string exportPath;
+                exporter.SetPlacedFootprint(true);
                 if (exporter.LoadFromTXT(SCENE_SETTING_PATH, exportPath))
                 {
                     m_Scene.Reload(exportPath.c_str());
                 }
             }
+            if (m_Scene.IsReloading() || !m_Scene.IsLoaded())
+            {
+                ImGui::SameLine();
+                ImGui::ProgressBar(m_Scene.GetLoadProgress());
+            }
             if (ImGui::Button(u8"シェーダ リロード"))
             {
                 m_RtShaderFlags.Set(REQUEST_BIT_INDEX, true);
@@ -2878,22 +3446,199 @@ void Renderer::Draw2D(float elapsedSec)
 //-----------------------------------------------------------------------------
 //      スクリーンキャプチャーを行います.
 //-----------------------------------------------------------------------------
-void Renderer::CaptureScreen(ID3D12Resource* pResource)
+void Renderer::CaptureScreen(ID3D12Resource* pResource, ID3D12Resource* pHdrResource)
 {
     if (pResource == nullptr)
     { return; }
 
-    auto idx = m_ExportIndex;
+    // エンコードが追いついていない場合はここで待たされる.
+    auto pFrame = m_EncoderPool.Acquire();
+    if (pFrame == nullptr)
+    { return; }
+
+    // リードバックテクスチャは次のフレームで再利用されるので，ここでコピーしておく.
+    uint8_t* ptr = nullptr;
+    auto hr = pResource->Map(0, nullptr, reinterpret_cast<void**>(&ptr));
+    if (FAILED(hr))
+    {
+        ELOG("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
+        m_EncoderPool.Discard(pFrame);
+        return;
+    }
+
+    memcpy(pFrame->Pixels.data(), ptr, pFrame->Pixels.size());
+    pResource->Unmap(0, nullptr);
+
+    pFrame->FrameIndex = m_CaptureIndex;
+    pFrame->Width      = m_SceneDesc.OutputWidth;
+    pFrame->Height     = m_SceneDesc.OutputHeight;
+    pFrame->Pitch      = m_ReadBackPitch;
+    pFrame->SourceIndex = m_CaptureIndex;
+    pFrame->HdrWidth   = 0;
+    pFrame->HdrHeight  = 0;
+    pFrame->HdrPitch   = 0;
+
+    // HDR も同様にコピー. 失敗した場合は LDR だけ出力する.
+    if (pHdrResource != nullptr && !pFrame->HdrPixels.empty())
+    {
+        hr = pHdrResource->Map(0, nullptr, reinterpret_cast<void**>(&ptr));
+        if (SUCCEEDED(hr))
+        {
+            memcpy(pFrame->HdrPixels.data(), ptr, pFrame->HdrPixels.size());
+            pHdrResource->Unmap(0, nullptr);
+
+            pFrame->HdrWidth  = m_SceneDesc.RenderWidth;
+            pFrame->HdrHeight = m_SceneDesc.RenderHeight;
+            pFrame->HdrPitch  = m_HdrReadBackPitch;
+        }
+        else
+        {
+            ELOG("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
+        }
+    }
+
+    // 直前と同じ内容ならエンコードを省略する.
+    if (m_SkipDuplicate)
+    { pFrame->SourceIndex = m_FrameDedup.Check(m_CaptureIndex, pFrame->Pixels.data(), m_ReadBackPitch); }
+
+    // 描画に掛けた時間. ノイズはワーカースレッドで計測する.
+    m_BudgetScheduler.SetDone(m_CaptureIndex, m_AnimationElapsedTime);
+
+    // ワーカースレッドでエンコードとファイル出力を実行.
+    m_EncoderPool.Submit(pFrame);
+
+    // 以前のセッションで完了したフレームは飛ばす.
+    m_CaptureIndex = m_Journal.FindPending(m_CaptureIndex + 1);
+
+    // 中断から再開できるように状態を記録.
+    CaptureState state = {};
+    state.ElapsedSec        = m_ElapsedOffsetSec + m_Timer.GetRelativeSec();
+    state.FrameTimeSec      = m_AnimationOneFrameTime;
+    state.CaptureIndex      = m_CaptureIndex;
+    state.RenderFrameCount  = uint32_t(GetFrameCount()) + m_FrameIndexOffset;
+    state.JitterIndex       = m_TemporalJitterIndex;
+    m_Journal.SaveState(state);
+}
+
+//-----------------------------------------------------------------------------
+//      画像に出力します.
+//-----------------------------------------------------------------------------
+bool Renderer::Encode(uint32_t workerIndex, const CaptureFrame& frame)
+{
+    auto& data = m_ExportData[workerIndex];
+    char path[256] = {};
+
+    // 描画結果のノイズから難しさを計測して, 以降のフレームの割り振りに使う.
+    m_BudgetScheduler.Report(
+        frame.FrameIndex,
+        EstimateNoiseVariance(frame.Pixels.data(), frame.Width, frame.Height, frame.Pitch, NOISE_ROW_STEP));
+
+    if (m_VideoStream.IsOpen())
+    {
+        // 変換はワーカーごとに並列に行い, 書き出しだけをフレーム番号順に行う.
+        m_VideoStream.Convert(frame.Pixels.data(), frame.Pitch, data.Converted);
+        if (!m_VideoStream.Write(frame.FrameIndex, data.Converted))
+        {
+            ELOG("Error : VideoStream::Write() Failed. frame = %u", frame.FrameIndex);
+            return false;
+        }
+    }
+    else if (frame.SourceIndex != frame.FrameIndex)
+    {
+        // 出力元の書き出しを待ってからハードリンク (できなければコピー) する.
+        char srcPath[256] = {};
+        sprintf_s(srcPath, "output_%03u.%s", frame.SourceIndex, m_pImageEncoder->GetExtension());
+        sprintf_s(path,    "output_%03u.%s", frame.FrameIndex,  m_pImageEncoder->GetExtension());
+
+        if (!m_FrameDedup.WaitWritten(frame.SourceIndex))
+        {
+            ELOG("Error : Duplicate Source Failed. frame = %u, source = %u", frame.FrameIndex, frame.SourceIndex);
+            return false;
+        }
+
+        if (!LinkOrCopyFile(srcPath, path))
+        {
+            ELOG("Error : LinkOrCopyFile() Failed. src = %s, dst = %s", srcPath, path);
+            return false;
+        }
+
+        m_Journal.AddOutputFile(frame.FrameIndex, 0, path);
+    }
+    else
     {
-        m_ExportData[idx].pResources = pResource;
-        m_ExportData[idx].FrameIndex = m_CaptureIndex;
+        asdx::StopWatch timer;
+        timer.Start();
 
-        // 別スレッドで待機とファイル出力を実行.
-        _beginthreadex(nullptr, 0, Export, &m_ExportData[idx], 0, nullptr);
+        // リードバックの行ピッチのまま圧縮する.
+        auto ret = m_pImageEncoder->Encode(
+            frame.Pixels.data(),
+            frame.Width,
+            frame.Height,
+            frame.Pitch,
+            data.Converted);
+        timer.End();
+
+        auto frameIndex = frame.FrameIndex;
+        auto encodeSec  = timer.GetElapsedMsec() / 1000.0;
+        if (!ret)
+        { ELOG("Error : IImageEncoder::Encode() Failed. frame = %u", frameIndex); }
+        else
+        {
+            // 重複フレームは出力元のファイルにリンクするので, 閉じ終わってから通知する.
+            // 書き込みが完了してからジャーナルに記録するので, ハッシュは手元にあるうちに計算しておく.
+            sprintf_s(path, "output_%03u.%s", frameIndex, m_pImageEncoder->GetExtension());
+            std::string outputPath = path;
+            auto size = uint64_t(data.Converted.size());
+            auto hash = XXH3_64bits(data.Converted.data(), data.Converted.size());
+            ret = m_FileWriter.WriteFile(path, data.Converted.data(), data.Converted.size(),
+                [this, frameIndex, encodeSec, outputPath, size, hash](bool success)
+                {
+                    if (success)
+                    { m_Journal.AddOutput(frameIndex, 0, outputPath.c_str(), size, hash); }
+                    if (m_SkipDuplicate)
+                    { m_FrameDedup.MarkWritten(frameIndex, success, encodeSec); }
+                });
+        }
+
+        // 重複フレームが出力元の完了を待っているので, 失敗した場合も通知する.
+        if (!ret)
+        {
+            if (m_SkipDuplicate)
+            { m_FrameDedup.MarkWritten(frameIndex, false, encodeSec); }
+            return false;
+        }
+    }
+
+    // 線形放射輝度を OpenEXR で出力.
+    if (frame.HdrWidth > 0)
+    {
+        if (!m_ExrEncoder.Encode(
+            frame.HdrPixels.data(),
+            frame.HdrWidth,
+            frame.HdrHeight,
+            frame.HdrPitch,
+            EXR_COMPRESSION_ZIP,
+            data.Hdr))
+        {
+            ELOG("Error : ExrEncoder::Encode() Failed. frame = %u", frame.FrameIndex);
+            return false;
+        }
+
+        sprintf_s(path, "output_%03u.exr", frame.FrameIndex);
+        std::string outputPath = path;
+        auto frameIndex = frame.FrameIndex;
+        auto size = uint64_t(data.Hdr.size());
+        auto hash = XXH3_64bits(data.Hdr.data(), data.Hdr.size());
+        if (!m_FileWriter.WriteFile(path, data.Hdr.data(), data.Hdr.size(),
+            [this, frameIndex, outputPath, size, hash](bool success)
+            {
+                if (success)
+                { m_Journal.AddOutput(frameIndex, 1, outputPath.c_str(), size, hash); }
+            }))
+        { return false; }
     }
 
-    m_CaptureIndex++;
-    m_ExportIndex = (m_ExportIndex + 1) % m_ExportData.size();
+    return true;
 }
 
 #if RTC_TARGET == RTC_DEVELOP
@@ -8,23 +8,22 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <Scene.h>
+#include <TextureFootprint.h>
 #include <fnd/asdxLogger.h>
 #include <fnd/asdxMisc.h>
 #include <gfx/asdxDevice.h>
 #include <generated/scene_format.h>
-#include <xxhash.h>
 #include <Windows.h>
 
-#if !CAMP_RELEASE
-#include <OBJLoader.h>
-#include <fstream>
-#include <map>
-#include <ctime>
-#endif//!CAMP_RELEASE
-
 
 namespace {
 
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint64_t   STREAM_UPLOAD_BUDGET = 64 * 1024 * 1024;    // 読み込み中の1フレームあたりのアップロード量.
+static const uint64_t   UPLOAD_HEAP_SIZE     = 256 * 1024 * 1024;   // アップロードヒープの既定サイズ.
+
 ///////////////////////////////////////////////////////////////////////////////
 // TEXTURE_DIMENSION enum
 ///////////////////////////////////////////////////////////////////////////////
@@ -94,56 +93,34 @@ inline void CopySubresource
 //-----------------------------------------------------------------------------
 //      テクスチャを更新します.
 //-----------------------------------------------------------------------------
-void UpdateTexture
+bool UpdateTexture
 (
     ID3D12GraphicsCommandList6*     pCmdList,
+    r3d::UploadHeap&                heap,
     ID3D12Resource*                 pDstResource,
     const r3d::ResTexture*          pResTexture
 )
 {
     if (pDstResource == nullptr || pResTexture == nullptr)
-    { return; }
+    { return false; }
 
     auto device = asdx::GetD3D12Device();
     auto dstDesc = pDstResource->GetDesc();
 
     auto count = pResTexture->MipLevels() * pResTexture->SurfaceCount();
 
-    D3D12_RESOURCE_DESC uploadDesc = {
-        D3D12_RESOURCE_DIMENSION_BUFFER,
-        0,
+    r3d::UploadRegion region;
+    if (!heap.Alloc(
         GetRequiredIntermediateSize(device, &dstDesc, 0, count),
-        1,
-        1,
-        1,
-        DXGI_FORMAT_UNKNOWN,
-        { 1, 0 },
-        D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-        D3D12_RESOURCE_FLAG_NONE
-    };
-
-    D3D12_HEAP_PROPERTIES props = {
-        D3D12_HEAP_TYPE_UPLOAD,
-        D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-        D3D12_MEMORY_POOL_UNKNOWN,
-        1,
-        1
-    };
-
-    ID3D12Resource* pSrcResource = nullptr;
-    auto hr = device->CreateCommittedResource(
-        &props,
-        D3D12_HEAP_FLAG_NONE,
-        &uploadDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&pSrcResource));
-    if (FAILED(hr))
+        D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT,
+        region))
     {
-        ELOG("Error : ID3D12Device::CreateCommitedResource() Failed. errcode = 0x%x", hr);
-        return;
+        ELOG("Error : UploadHeap::Alloc() Failed.");
+        return false;
     }
 
+    auto pSrcResource = region.pResource;
+
     // コマンドを生成.
     {
         std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts;
@@ -158,47 +135,103 @@ void UpdateTexture
         device->GetCopyableFootprints(
             &dstDesc, 0, count, 0, layouts.data(), rows.data(), rowSizeInBytes.data(), &requiredSize);
 
-        BYTE* pData = nullptr;
-        hr = pSrcResource->Map(0, nullptr, reinterpret_cast<void**>(&pData));
-        if (FAILED(hr))
+        auto pData = region.pData;
+
+        if (pResTexture->Option() & r3d::TEXTURE_OPTION_PLACED_FOOTPRINT)
         {
-            ELOG("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
-            pSrcResource->Release();
-            return;
-        }
+            std::vector<r3d::TextureFootprint> footprints;
+            uint64_t totalSize = 0;
+
+            auto pixels = pResTexture->Resources()->Get(0)->Pixels();
+            auto valid  = r3d::CalcTextureFootprints(
+                pResTexture->Dimension(),
+                pResTexture->Width(),
+                pResTexture->Height(),
+                pResTexture->Depth(),
+                pResTexture->Format(),
+                pResTexture->MipLevels(),
+                pResTexture->SurfaceCount(),
+                footprints,
+                totalSize);
+            if (!valid || footprints.size() != count || pixels->size() < totalSize)
+            {
+                ELOG("Error : Invalid Placed Footprint Texture.");
+                return false;
+            }
 
-        for(auto i=0u; i<count; ++i)
+            auto matched = true;
+            for(auto i=0u; i<count; ++i)
+            {
+                matched &= (layouts[i].Offset             == footprints[i].Offset);
+                matched &= (layouts[i].Footprint.RowPitch == footprints[i].RowPitch);
+                matched &= (rows[i]                       == footprints[i].RowCount);
+            }
+
+            if (matched)
+            {
+                // 出力時に配置済みなのでまとめてコピー.
+                auto copySize = (requiredSize < totalSize) ? requiredSize : totalSize;
+                memcpy(pData, pixels->data(), SIZE_T(copySize));
+            }
+            else
+            {
+                // 配置規則が異なるデバイスでは行単位でコピー.
+                for(auto i=0u; i<count; ++i)
+                {
+                    D3D12_SUBRESOURCE_DATA srcData = {};
+                    srcData.pData       = pixels->data() + footprints[i].Offset;
+                    srcData.RowPitch    = footprints[i].RowPitch;
+                    srcData.SlicePitch  = LONG_PTR(footprints[i].RowPitch) * footprints[i].RowCount;
+
+                    D3D12_MEMCPY_DEST dstData = {};
+                    dstData.pData       = pData + layouts[i].Offset;
+                    dstData.RowPitch    = layouts[i].Footprint.RowPitch;
+                    dstData.SlicePitch  = SIZE_T(layouts[i].Footprint.RowPitch) * SIZE_T(rows[i]);
+
+                    CopySubresource(
+                        &dstData,
+                        &srcData,
+                        SIZE_T(rowSizeInBytes[i]),
+                        rows[i],
+                        layouts[i].Footprint.Depth);
+                }
+            }
+        }
+        else
         {
-            auto srcResource = pResTexture->Resources()->Get(i);
-
-            D3D12_SUBRESOURCE_DATA srcData = {};
-            srcData.pData       = srcResource->Pixels();
-            srcData.RowPitch    = srcResource->Pitch();
-            srcData.SlicePitch  = srcResource->SlicePitch();
-            assert(layouts[i].Footprint.Width  == srcResource->Width());
-            assert(layouts[i].Footprint.Height == srcResource->Height());
-
-            D3D12_MEMCPY_DEST dstData = {};
-            dstData.pData       = pData + layouts[i].Offset;
-            dstData.RowPitch    = layouts[i].Footprint.RowPitch;
-            dstData.SlicePitch  = SIZE_T(layouts[i].Footprint.RowPitch) * SIZE_T(rows[i]);
-
-            CopySubresource(
-                &dstData,
-                &srcData,
-                SIZE_T(rowSizeInBytes[i]),
-                rows[i],
-                layouts[i].Footprint.Depth);
+            for(auto i=0u; i<count; ++i)
+            {
+                auto srcResource = pResTexture->Resources()->Get(i);
+
+                D3D12_SUBRESOURCE_DATA srcData = {};
+                srcData.pData       = srcResource->Pixels()->data();
+                srcData.RowPitch    = srcResource->Pitch();
+                srcData.SlicePitch  = srcResource->SlicePitch();
+                assert(layouts[i].Footprint.Width  == srcResource->Width());
+                assert(layouts[i].Footprint.Height == srcResource->Height());
+
+                D3D12_MEMCPY_DEST dstData = {};
+                dstData.pData       = pData + layouts[i].Offset;
+                dstData.RowPitch    = layouts[i].Footprint.RowPitch;
+                dstData.SlicePitch  = SIZE_T(layouts[i].Footprint.RowPitch) * SIZE_T(rows[i]);
+
+                CopySubresource(
+                    &dstData,
+                    &srcData,
+                    SIZE_T(rowSizeInBytes[i]),
+                    rows[i],
+                    layouts[i].Footprint.Depth);
+            }
         }
-        pSrcResource->Unmap(0, nullptr);
 
+        // 先にまとめて書き込んでから連続してコピーを記録する.
         if (dstDesc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
         {
             pCmdList->CopyBufferRegion(
                 pDstResource,
                 0,
                 pSrcResource,
-                layouts[0].Offset,
+                region.Offset + layouts[0].Offset,
                 layouts[0].Footprint.Width);
         }
         else
@@ -214,13 +247,14 @@ void UpdateTexture
                 srcLoc.pResource        = pSrcResource;
                 srcLoc.Type             = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
                 srcLoc.PlacedFootprint  = layouts[i];
+                srcLoc.PlacedFootprint.Offset += region.Offset;
 
                 pCmdList->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
             }
         }
     }
 
-    asdx::Dispose(pSrcResource);
+    return true;
 }
 
 asdx::Vector4 FromBinaryFormat(const r3d::Vector4& value)
@@ -232,32 +266,36 @@ asdx::Vector3 FromBinaryFormat(const r3d::Vector3& value)
 asdx::Vector2 FromBinaryFormat(const r3d::Vector2& value)
 { return asdx::Vector2(value.x(), value.y()); }
 
-r3d::Vector4 ToBinaryFormat(const asdx::Vector4& value)
-{ return r3d::Vector4(value.x, value.y, value.z, value.w); }
-
-r3d::Vector3 ToBinaryFormat(const asdx::Vector3& value)
-{ return r3d::Vector3(value.x, value.y, value.z); }
-
-r3d::Vector2 ToBinaryFormat(const asdx::Vector2& value)
-{ return r3d::Vector2(value.x, value.y); }
+asdx::Transform3x4 FromBinaryFormat(const r3d::Matrix3x4& value)
+{
+    auto& r0 = value.row0();
+    auto& r1 = value.row1();
+    auto& r2 = value.row2();
+
+    asdx::Transform3x4 result;
+    result.m[0][0] = r0.x();
+    result.m[0][1] = r0.y();
+    result.m[0][2] = r0.z();
+    result.m[0][3] = r0.w();
+
+    result.m[1][0] = r1.x();
+    result.m[1][1] = r1.y();
+    result.m[1][2] = r1.z();
+    result.m[1][3] = r1.w();
+
+    result.m[2][0] = r2.x();
+    result.m[2][1] = r2.y();
+    result.m[2][2] = r2.z();
+    result.m[2][3] = r2.w();
+
+    return result;
+}
 
 } // namespace
 
 
 namespace r3d {
 
-//-----------------------------------------------------------------------------
-//      ハッシュタグを計算します.
-//-----------------------------------------------------------------------------
-uint32_t CalcHashTag(const char* name, size_t nameLength)
-{ return XXH32(name, nameLength, 12345); }
-
-//-----------------------------------------------------------------------------
-//      ハッシュタグを計算します.
-//-----------------------------------------------------------------------------
-uint32_t CalcHashTag(const std::string& name)
-{ return CalcHashTag(name.c_str(), name.length()); }
-
 ///////////////////////////////////////////////////////////////////////////////
 // SceneTexture
 ///////////////////////////////////////////////////////////////////////////////
@@ -268,6 +306,7 @@ uint32_t CalcHashTag(const std::string& name)
 bool SceneTexture::Init
 (
     ID3D12GraphicsCommandList6* pCmdList,
+    UploadHeap&                 heap,
     const void*                 resTexture,
     uint32_t                    componentMapping
 )
@@ -432,8 +471,15 @@ bool SceneTexture::Init
         }
     }
 
-    UpdateTexture(pCmdList, pResource, resource);
+    if (!UpdateTexture(pCmdList, heap, pResource, resource))
+    {
+        m_View.Reset();
+        pResource->Release();
+        pResource = nullptr;
+        return false;
+    }
 
+    // 他のテクスチャのコピーとまとめて遷移させる.
     D3D12_RESOURCE_BARRIER barrier = {};
     barrier.Type                    = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
     barrier.Flags                   = D3D12_RESOURCE_BARRIER_FLAG_NONE;
@@ -442,7 +488,7 @@ bool SceneTexture::Init
     barrier.Transition.StateBefore  = D3D12_RESOURCE_STATE_COPY_DEST;
     barrier.Transition.StateAfter   = D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE;
 
-    pCmdList->ResourceBarrier(1, &barrier);
+    heap.AddBarrier(barrier);
 
     pResource->Release();
     pResource = nullptr;
@@ -472,48 +518,164 @@ asdx::IShaderResourceView* SceneTexture::GetView() const
 //-----------------------------------------------------------------------------
 bool Scene::Init(const char* path, ID3D12GraphicsCommandList6* pCmdList)
 {
-    if (!m_ModelMgr.Init(pCmdList, UINT16_MAX, UINT16_MAX))
+    if (!BeginLoad(path, pCmdList))
+    { return false; }
+
+    // 背景の IBL が届くまでは待ち, 残りは UpdateStream() で1フレームずつ予算内でアップロードする.
+    m_pUploadCmdList = pCmdList;
+    auto state = m_Streamer.GetState();
+    while(state == SCENE_STREAM_STATE_LOADING && m_IBL.GetView() == nullptr)
+    { state = m_Streamer.Update(this, STREAM_UPLOAD_BUDGET, true); }
+    m_pUploadCmdList = nullptr;
+
+    if (state == SCENE_STREAM_STATE_FAILED)
+    {
+        ELOGA("Error : Scene Load Failed. path = %s", path);
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      非同期読み込みを開始します.
+//-----------------------------------------------------------------------------
+bool Scene::BeginLoad(const char* path, ID3D12GraphicsCommandList6* pCmdList)
+{
+    auto uploadHeapSize = (m_UploadHeapSize != 0) ? m_UploadHeapSize : UPLOAD_HEAP_SIZE;
+    if (!m_UploadHeap.Init(uploadHeapSize))
+    {
+        ELOGA("Error : UploadHeap::Init() Failed.");
+        return false;
+    }
+
+    if (!m_Streamer.Start(path))
+    {
+        ELOGA("Error : SceneStreamer::Start() Failed. path = %s", path);
+        return false;
+    }
+
+    // インスタンス・マテリアルのバッファはシーンの数に合わせて確保する.
+    auto& header = m_Streamer.GetHeader();
+    if (!m_ModelMgr.Init(pCmdList, &m_UploadHeap, header.InstanceCount, header.MaterialCount))
     {
         ELOGA("Error : ModelMgr::Init() Failed.");
         return false;
     }
 
-    // ファイル読み込み.
+    // インスタンスはマテリアルより先に届くので, 仮のマテリアルで形状だけ先に描画する.
+    if (header.MaterialCount > 0)
     {
-        auto hFile = CreateFileA(
-            path,
-            GENERIC_READ,
-            0,
-            NULL,
-            OPEN_EXISTING,
-            FILE_ATTRIBUTE_NORMAL,
-            NULL);
-        if (hFile == INVALID_HANDLE_VALUE)
+        std::vector<Material> materials(header.MaterialCount, Material::Default());
+        if (m_ModelMgr.AddMaterials(materials.data(), header.MaterialCount) == 0)
         {
-            ELOGA("Error : File Open Failed. path = %s");
+            ELOGA("Error : ModelMgr::AddMaterials() Failed.");
             return false;
         }
+    }
 
-        auto size = GetFileSize(hFile, NULL);
-        m_pBinary = malloc(size);
-        DWORD readSize = 0;
-        auto ret = ReadFile(hFile, m_pBinary, size, &readSize, NULL);
-        if (!ret)
-        { ELOGA("Error : Read Failed. path = %s", path); }
+    m_Textures.resize(header.TextureCount);
+    m_BLAS    .resize(header.MeshCount);
+    m_Meshes  .resize(header.MeshCount);
 
-        CloseHandle(hFile);
-    }
+#if !CAMP_RELEASE
+    m_Digest.Reset(header);
+#endif
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      展開済みのデータを予算内でアップロードします.
+//-----------------------------------------------------------------------------
+SCENE_STREAM_STATE Scene::UpdateLoad(ID3D12GraphicsCommandList6* pCmdList, uint64_t budget)
+{
+    m_pUploadCmdList = pCmdList;
+    auto state = m_Streamer.Update(this, budget);
+    m_pUploadCmdList = nullptr;
+
+    return state;
+}
+
+//-----------------------------------------------------------------------------
+//      読み込み途中なら予算内でアップロードします.
+//-----------------------------------------------------------------------------
+bool Scene::UpdateStream(ID3D12GraphicsCommandList6* pCmdList)
+{
+#if !CAMP_RELEASE
+    // リロード中は Polling() で進める.
+    if (m_RequestTerm)
+    { return true; }
+#endif
+
+    if (m_Streamer.GetState() != SCENE_STREAM_STATE_LOADING)
+    { return true; }
+
+    return UpdateLoad(pCmdList, STREAM_UPLOAD_BUDGET) != SCENE_STREAM_STATE_FAILED;
+}
+
+//-----------------------------------------------------------------------------
+//      読み込みが完了したかどうか?
+//-----------------------------------------------------------------------------
+bool Scene::IsLoaded() const
+{ return m_Streamer.GetState() == SCENE_STREAM_STATE_COMPLETED; }
+
+//-----------------------------------------------------------------------------
+//      描画に必要なデータが揃っているかどうか?
+//-----------------------------------------------------------------------------
+bool Scene::IsDrawable() const
+{
+#if !CAMP_RELEASE
+    // 破棄を待つ間と作り直すまでは参照しない. 読み込み直し中は揃った分だけ描画する.
+    if (m_RequestTerm && m_WaitCount <= 8)
+    { return false; }
+#endif
 
-    // シーンリソース取得.
-    auto resScene = GetResScene(m_pBinary);
-    assert(resScene != nullptr);
+    // テクスチャとマテリアルは後から届くので, IBL とライトと形状があれば描画できる.
+    return m_IBL.GetView()          != nullptr
+        && m_LB_SRV.GetPtr()        != nullptr
+        && m_TLAS[0].GetResource()  != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      読み込みの進捗を取得します.
+//-----------------------------------------------------------------------------
+float Scene::GetLoadProgress() const
+{
+    auto progress = m_Streamer.GetProgress();
+    if (progress.TotalBytes == 0)
+    { return 0.0f; }
+
+    return float(double(progress.UploadedBytes) / double(progress.TotalBytes));
+}
 
+//-----------------------------------------------------------------------------
+//      アップロードヒープのサイズを設定します.
+//-----------------------------------------------------------------------------
+void Scene::SetUploadHeapSize(uint64_t size)
+{ m_UploadHeapSize = size; }
+
+//-----------------------------------------------------------------------------
+//      アップロードを含むコマンドリストの待機点を設定します.
+//-----------------------------------------------------------------------------
+void Scene::Submit(const asdx::WaitPoint& waitPoint)
+{ m_UploadHeap.Submit(waitPoint); }
+
+//-----------------------------------------------------------------------------
+//      セクションをアップロードします.
+//-----------------------------------------------------------------------------
+bool Scene::Upload(const SceneSection& section)
+{
+    auto pCmdList  = m_pUploadCmdList;
+    auto resScene  = section.pScene;
+    auto& header   = m_Streamer.GetHeader();
     auto pDevice   = asdx::GetD3D12Device();
     auto buildFlag = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
 
     // IBLテクスチャのセットアップ.
+    if (resScene->IblTexture() != nullptr)
     {
-        if (!m_IBL.Init(pCmdList, resScene->IblTexture()))
+        if (!m_IBL.Init(pCmdList, m_UploadHeap, resScene->IblTexture()))
         {
             ELOGA("Error : IBL Initialize Failed.");
             return false;
@@ -521,71 +683,64 @@ bool Scene::Init(const char* path, ID3D12GraphicsCommandList6* pCmdList)
     }
 
     // テクスチャセットアップ.
+    if (resScene->Textures() != nullptr)
     {
-        auto count       = resScene->TextureCount();
         auto resTextures = resScene->Textures();
-        assert(resTextures != nullptr);
-        m_Textures.resize(count);
-
-        for(auto i=0u; i<count; ++i)
+        for(auto i=0u; i<resTextures->size(); ++i)
         {
-            if (!m_Textures[i].Init(pCmdList, resTextures->Get(i)))
+            auto index = section.FirstIndex + i;
+            if (index >= m_Textures.size() || !m_Textures[index].Init(pCmdList, m_UploadHeap, resTextures->Get(i)))
             {
-                ELOGA("Error : SceneTexture::Init() Failed. index = %u", i);
+                ELOGA("Error : SceneTexture::Init() Failed. index = %u", index);
                 return false;
             }
         }
     }
 
-    // マテリアル登録.
-    {
-        auto count        = resScene->MaterialCount();
-        auto resMaterials = resScene->Materials();
-        assert(resMaterials != nullptr);
-
-        for(auto i=0u; i<count; ++i)
-        {
-            auto srcMaterial = resMaterials->Get(i);
-            assert(srcMaterial != nullptr);
-
-            r3d::Material material = {};
-            material.BaseColorMap = GetTextureHandle(srcMaterial->BaseColorMap());
-            material.NormalMap    = GetTextureHandle(srcMaterial->NormalMap());
-            material.OrmMap       = GetTextureHandle(srcMaterial->OrmMap());
-            material.EmissiveMap  = GetTextureHandle(srcMaterial->EmissiveMap());
-
-            material.BaseColor = FromBinaryFormat(srcMaterial->BaseColor());
-            material.Occlusion = srcMaterial->Occlusion();
-            material.Roughness = srcMaterial->Roughness();
-            material.Metalness = srcMaterial->Metalness();
-            material.Ior       = srcMaterial->Ior();
-            material.Emissive  = FromBinaryFormat(srcMaterial->Emissive());
-
-            m_ModelMgr.AddMaterials(&material, 1);
-        }
-    }
+    m_UploadHeap.FlushBarriers(pCmdList);
 
-    // BLAS構築.
+    // BLAS構築. ModelMgr は登録順に番号を振るので番号順に呼び出される.
+    if (resScene->Meshes() != nullptr)
     {
-        auto count = resScene->MeshCount();
-
-        m_BLAS.resize(count);
-
         auto resMeshes = resScene->Meshes();
-        assert(resMeshes != nullptr);
+        if (section.FirstIndex + resMeshes->size() > header.MeshCount)
+        {
+            ELOGA("Error : Invalid Mesh Section. index = %u", section.Index);
+            return false;
+        }
 
-        for(auto i=0u; i<count; ++i)
+        // コピーをまとめて記録してからBLASを構築する.
+        for(auto i=0u; i<resMeshes->size(); ++i)
         {
             auto srcMesh = resMeshes->Get(i);
             assert(srcMesh != nullptr);
 
+            auto index = section.FirstIndex + i;
+
             r3d::Mesh mesh = {};
             mesh.VertexCount = srcMesh->VertexCount();
             mesh.IndexCount  = srcMesh->IndexCount();
             mesh.Vertices    = const_cast<r3d::ResVertex*>(reinterpret_cast<const r3d::ResVertex*>(srcMesh->Vertices()->Data()));
             mesh.Indices     = const_cast<uint32_t*>(reinterpret_cast<const uint32_t*>(srcMesh->Indices()->Data()));
 
-            auto geometryHandle = m_ModelMgr.AddMesh(mesh);
+            if (m_ModelMgr.AddMesh(pCmdList, mesh).AddressVB == 0)
+            {
+                ELOGA("Error : ModelMgr::AddMesh() Failed. index = %u", index);
+                return false;
+            }
+
+            // 頂点・インデックスはGPUバッファにコピー済みなので数だけ残す.
+            m_Meshes[index].VertexCount = mesh.VertexCount;
+            m_Meshes[index].IndexCount  = mesh.IndexCount;
+        }
+
+        m_ModelMgr.FlushMeshes(pCmdList);
+
+        for(auto i=0u; i<resMeshes->size(); ++i)
+        {
+            auto  index          = section.FirstIndex + i;
+            auto& mesh           = m_Meshes[index];
+            auto  geometryHandle = m_ModelMgr.GetGeometryHandle(index);
 
             D3D12_RAYTRACING_GEOMETRY_DESC desc = {};
             desc.Type                                   = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES;
@@ -598,63 +753,59 @@ bool Scene::Init(const char* path, ID3D12GraphicsCommandList6* pCmdList)
             desc.Triangles.VertexBuffer.StrideInBytes   = UINT(sizeof(ResVertex));
             desc.Triangles.VertexCount                  = mesh.VertexCount;
 
-            if (!m_BLAS[i].Init(pDevice, 1, &desc, buildFlag))
+            if (!m_BLAS[index].Init(pDevice, 1, &desc, buildFlag))
             {
-                ELOGA("Error : Blas::Init() Failed. index = %llu", i);
+                ELOGA("Error : Blas::Init() Failed. index = %u", index);
                 return false;
             }
 
-            m_BLAS[i].Build(pCmdList);
+            m_BLAS[index].Build(pCmdList);
         }
     }
 
-    // TLAS構築.
+    // マテリアル登録. 全テクスチャのアップロード後に呼び出され, 仮のマテリアルを書き換える.
+    if (resScene->Materials() != nullptr)
     {
-        auto count = resScene->InstanceCount();
-        assert(count > 0);
-
-        std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDescs;
-        instanceDescs.resize(count);
-        m_Instances.resize(count);
+        auto srcMaterials = resScene->Materials();
+        if (srcMaterials->size() != header.MaterialCount)
+        {
+            ELOGA("Error : Invalid Material Section. index = %u", section.Index);
+            return false;
+        }
 
-        auto resInstances = resScene->Instances();
+        for(auto i=0u; i<srcMaterials->size(); ++i)
+        {
+            auto srcMaterial = srcMaterials->Get(i);
+            assert(srcMaterial != nullptr);
 
-        m_DrawCalls.resize(count);
-        auto resMeshes = resScene->Meshes();
-        assert(resMeshes != nullptr);
+            auto material = ConvertMaterial(srcMaterial);
+            m_ModelMgr.UpdateMaterials(i, &material, 1);
+        }
+    }
 
+    // TLAS構築. 全メッシュのアップロード後に呼び出される.
+    if (resScene->Instances() != nullptr)
+    {
+        auto srcInstances    = resScene->Instances();
         auto resInstanceTags = resScene->InstanceTags();
 
-        for(auto i=0u; i<count; ++i)
-        {
-            auto srcInstance = resInstances->Get(i);
-            auto& dstDesc = instanceDescs[i];
-
-            auto& r0 = srcInstance->Transform().row0();
-            auto& r1 = srcInstance->Transform().row1();
-            auto& r2 = srcInstance->Transform().row2();
-
-            asdx::Transform3x4 transform;
-            transform.m[0][0] = r0.x();
-            transform.m[0][1] = r0.y();
-            transform.m[0][2] = r0.z();
-            transform.m[0][3] = r0.w();
+        auto count = srcInstances->size();
+        assert(count > 0);
+        assert(count == header.InstanceCount);
 
-            transform.m[1][0] = r1.x();
-            transform.m[1][1] = r1.y();
-            transform.m[1][2] = r1.z();
-            transform.m[1][3] = r1.w();
+        m_Instances.resize(count);
+        m_DrawCalls.resize(count);
 
-            transform.m[2][0] = r2.x();
-            transform.m[2][1] = r2.y();
-            transform.m[2][2] = r2.z();
-            transform.m[2][3] = r2.w();
+        for(auto i=0u; i<count; ++i)
+        {
+            auto srcInstance = srcInstances->Get(i);
+            auto transform   = FromBinaryFormat(srcInstance->Transform());
 
             auto meshId = srcInstance->MeshIndex();
-            assert(meshId < resScene->MeshCount());
+            assert(meshId < header.MeshCount);
 
             auto matId = srcInstance->MaterialIndex();
-            assert(matId < resScene->MaterialCount());
+            assert(matId < header.MaterialCount);
 
             r3d::CpuInstance instance;
             instance.MeshId     = meshId;
@@ -662,81 +813,120 @@ bool Scene::Init(const char* path, ID3D12GraphicsCommandList6* pCmdList)
             instance.Transform  = transform;
 
             auto instanceHandle = m_ModelMgr.AddInstance(instance);
-
-            memcpy(dstDesc.Transform, transform.m, sizeof(float) * 12);
-            dstDesc.InstanceID                          = instanceHandle.InstanceId;
-            dstDesc.InstanceMask                        = 0xFF;
-            dstDesc.InstanceContributionToHitGroupIndex = 0;
-            dstDesc.Flags                               = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
-            dstDesc.AccelerationStructure               = m_BLAS[meshId].GetResource()->GetGPUVirtualAddress();
+            if (instanceHandle.InstanceId == UINT32_MAX)
+            {
+                ELOGA("Error : ModelMgr::AddInstance() Failed. index = %u", i);
+                return false;
+            }
 
             m_Instances[i].InstanceId = instanceHandle.InstanceId;
             m_Instances[i].MeshId     = meshId;
 
-            auto mesh = resMeshes->Get(meshId);
+            auto& mesh = m_Meshes[meshId];
 
             auto geometryHandle = m_ModelMgr.GetGeometryHandle(meshId);
 
             D3D12_VERTEX_BUFFER_VIEW vbv = {};
             vbv.BufferLocation  = geometryHandle.AddressVB;
-            vbv.SizeInBytes     = sizeof(ResVertex) * mesh->VertexCount();
+            vbv.SizeInBytes     = sizeof(ResVertex) * mesh.VertexCount;
             vbv.StrideInBytes   = sizeof(ResVertex);
 
             D3D12_INDEX_BUFFER_VIEW ibv = {};
             ibv.BufferLocation  = geometryHandle.AddressIB;
-            ibv.SizeInBytes     = sizeof(uint32_t) * mesh->IndexCount();
+            ibv.SizeInBytes     = sizeof(uint32_t) * mesh.IndexCount;
             ibv.Format          = DXGI_FORMAT_R32_UINT;
 
-            m_DrawCalls[i].IndexCount = mesh->IndexCount();
+            m_DrawCalls[i].IndexCount = mesh.IndexCount;
             m_DrawCalls[i].VBV        = vbv;
             m_DrawCalls[i].IBV        = ibv;
             m_DrawCalls[i].IndexVB    = geometryHandle.IndexVB;
             m_DrawCalls[i].IndexIB    = geometryHandle.IndexIB;
             m_DrawCalls[i].MaterialId = matId;
-
-            // データバインディング用辞書を作成しておく.
-            auto hashTag = resInstanceTags->Get(i);
-            auto itr = m_InstanceDict.find(hashTag);
-            assert(itr == m_InstanceDict.end());
-            m_InstanceDict[hashTag] = i;
         }
 
-        if (!m_TLAS.Init(pDevice, resScene->InstanceCount(), instanceDescs.data(), buildFlag))
+        // データバインディング用の表. 古いファイルは表を持たないのでここで作る.
+        // 格納された表はコピーせずに参照するので, セクションのメモリを引き取っておく.
+        auto ret = false;
+        if (resScene->InstanceTagSlots() != nullptr)
         {
-            ELOGA("Error : Tlas::Init() Failed.");
+            m_InstanceSection = m_Streamer.DetachSection(section.Index);
+            auto pScene = (m_InstanceSection) ? GetResScene(m_InstanceSection.get()) : nullptr;
+            ret = (pScene != nullptr) && m_InstanceTags.Init(pScene->InstanceTagSeeds(), pScene->InstanceTagSlots());
+        }
+        else
+        { ret = m_InstanceTags.Init(resInstanceTags->data(), resInstanceTags->size()); }
+        if (!ret)
+        {
+            ELOGA("Error : Instance TagTable::Init() Failed.");
             return false;
         }
 
-        m_TLAS.Build(pCmdList);
+        if (!BuildTLAS(pCmdList))
+        { return false; }
     }
 
     // ライトバッファ構築.
+    if (resScene->Lights() != nullptr)
     {
-        auto count  = resScene->LightCount();
-        auto stride = uint32_t(sizeof(ResLight));
-
         auto srcLights    = resScene->Lights();
         auto srcLightTags = resScene->LightTags();
 
-        // ライトがあれば初期化.
+        auto count  = srcLights->size();
+        auto stride = uint32_t(sizeof(ResLight));
+
+        // ライトがあれば初期化. 差分更新で書き換えるのでマップしたままにする.
         if (count > 0)
         {
-            if (!m_LB.Init(pCmdList, count, stride, srcLights->data()))
+            if (!asdx::CreateUploadBuffer(pDevice, count * stride, m_LB.GetAddress()))
             {
-                ELOGA("Error : LB::Init() Failed.");
+                ELOGA("Error : LightBuffer Create Failed.");
                 return false;
             }
+
+            if (!asdx::CreateBufferSRV(pDevice, m_LB.GetPtr(), count, stride, m_LB_SRV.GetAddress()))
+            {
+                ELOGA("Error : LightBuffer SRV Create Failed.");
+                return false;
+            }
+
+            auto hr = m_LB->Map(0, nullptr, reinterpret_cast<void**>(&m_pLights));
+            if (FAILED(hr))
+            {
+                ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
+                return false;
+            }
+
+            memcpy(m_pLights, srcLights->data(), count * stride);
         }
 
-        // データバインディング用辞書を作成しておく.
-        for(auto i=0u; i<count; ++i)
+        // データバインディング用の表. 古いファイルは表を持たないのでここで作る.
+        // 格納された表はコピーせずに参照するので, セクションのメモリを引き取っておく.
+        auto ret = false;
+        if (resScene->LightTagSlots() != nullptr)
+        {
+            m_LightSection = m_Streamer.DetachSection(section.Index);
+            auto pScene = (m_LightSection) ? GetResScene(m_LightSection.get()) : nullptr;
+            ret = (pScene != nullptr) && m_LightTags.Init(pScene->LightTagSeeds(), pScene->LightTagSlots());
+        }
+        else
+        { ret = m_LightTags.Init(srcLightTags->data(), srcLightTags->size()); }
+        if (!ret)
         {
-            auto hashTag = srcLightTags->Get(i);
-            auto itr = m_LightDict.find(hashTag);
-            assert(itr == m_LightDict.end());
-            m_LightDict[hashTag] = i;
+            ELOGA("Error : Light TagTable::Init() Failed.");
+            return false;
         }
+
+        m_LightCount = count;
+    }
+
+#if !CAMP_RELEASE
+    // 差分リロード用に内容のハッシュを残しておく.
+    if (!m_Digest.Append(section))
+    {
+        ELOGA("Error : SceneDigest::Append() Failed. index = %u", section.Index);
+        return false;
     }
+#endif
 
     return true;
 }
@@ -754,23 +944,35 @@ void Scene::Term()
     { m_Textures[i].Term(); }
     m_Textures.clear();
 
-    m_TLAS    .Term();
-    m_Param   .Term();
-    m_ModelMgr.Term();
-    m_IBL     .Term();
-    m_LB      .Term();
+    for(auto i=0u; i<FRAME_SLOT_COUNT; ++i)
+    { m_TLAS[i].Term(); }
+    m_DirtyRanges.clear();
+
+    m_Param     .Term();
+    m_ModelMgr  .Term();
+    m_IBL       .Term();
+    m_UploadHeap.Term();
+
+    m_LB_SRV.Reset();
+    m_LB    .Reset();
+    m_pLights = nullptr;
+
+    m_Streamer.Term();
 
     m_DrawCalls.clear();
     m_Instances.clear();
+    m_Meshes   .clear();
 
-    if (m_pBinary != nullptr)
-    {
-        free(m_pBinary);
-        m_pBinary = nullptr;
-    }
+    m_LightCount = 0;
+
+    m_LightTags   .Term();
+    m_InstanceTags.Term();
+    m_LightSection   .reset();
+    m_InstanceSection.reset();
 
-    m_LightDict   .clear();
-    m_InstanceDict.clear();
+#if !CAMP_RELEASE
+    m_Digest = SceneDigest();
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -801,7 +1003,7 @@ asdx::IShaderResourceView* Scene::GetMB() const
 //      ライトバッファのシェーダリソースビューを取得します.
 //-----------------------------------------------------------------------------
 asdx::IShaderResourceView* Scene::GetLB() const
-{ return m_LB.GetView(); }
+{ return m_LB_SRV.GetPtr(); }
 
 //-----------------------------------------------------------------------------
 //      IBLのシェーダリソースビューを取得します.
@@ -813,7 +1015,40 @@ asdx::IShaderResourceView* Scene::GetIBL() const
 //      TLASを取得します.
 //-----------------------------------------------------------------------------
 ID3D12Resource* Scene::GetTLAS() const
-{ return m_TLAS.GetResource(); }
+{ return m_TLAS[m_ModelMgr.GetFrameSlot()].GetResource(); }
+
+//-----------------------------------------------------------------------------
+//      フレーム毎の更新処理を行います.
+//-----------------------------------------------------------------------------
+void Scene::Update(ID3D12GraphicsCommandList6* pCmdList)
+{
+    if (!IsLoaded())
+    { return; }
+
+    // 今フレームで使う面に切り替えて，変更されたインスタンスを書き込む.
+    m_ModelMgr.BeginFrame(m_DirtyRanges);
+    if (m_DirtyRanges.empty())
+    { return; }
+
+    // 変更されたインスタンスの記述子だけを書き換えて，この面のTLASを作り直す.
+    auto& tlas   = m_TLAS[m_ModelMgr.GetFrameSlot()];
+    auto  pDescs = tlas.Map();
+    if (pDescs == nullptr)
+    {
+        ELOGA("Error : Tlas::Map() Failed.");
+        return;
+    }
+
+    for(auto& range : m_DirtyRanges)
+    {
+        auto end = range.Offset + range.Count;
+        for(auto i=range.Offset; i<end; ++i)
+        { WriteInstanceDesc(i, pDescs[i]); }
+    }
+
+    tlas.Unmap();
+    tlas.Build(pCmdList);
+}
 
 //-----------------------------------------------------------------------------
 //      描画処理を行います.
@@ -845,42 +1080,100 @@ uint32_t Scene::GetTextureHandle(uint32_t index)
 }
 
 //-----------------------------------------------------------------------------
-//      ライト数を取得します.
+//      マテリアルを変換します.
 //-----------------------------------------------------------------------------
-uint32_t Scene::GetLightCount() const
+Material Scene::ConvertMaterial(const ResMaterial* srcMaterial)
 {
-    if (m_pBinary == nullptr)
-    { return 0; }
+    Material material = {};
+    material.BaseColorMap = GetTextureHandle(srcMaterial->BaseColorMap());
+    material.NormalMap    = GetTextureHandle(srcMaterial->NormalMap());
+    material.OrmMap       = GetTextureHandle(srcMaterial->OrmMap());
+    material.EmissiveMap  = GetTextureHandle(srcMaterial->EmissiveMap());
+
+    material.BaseColor = FromBinaryFormat(srcMaterial->BaseColor());
+    material.Occlusion = srcMaterial->Occlusion();
+    material.Roughness = srcMaterial->Roughness();
+    material.Metalness = srcMaterial->Metalness();
+    material.Ior       = srcMaterial->Ior();
+    material.Emissive  = FromBinaryFormat(srcMaterial->Emissive());
+
+    return material;
+}
 
-    // シーンリソース取得.
-    auto resScene = GetResScene(m_pBinary);
-    assert(resScene != nullptr);
+//-----------------------------------------------------------------------------
+//      登録済みのインスタンスからTLASを構築します.
+//-----------------------------------------------------------------------------
+bool Scene::BuildTLAS(ID3D12GraphicsCommandList6* pCmdList)
+{
+    auto pDevice   = asdx::GetD3D12Device();
+    auto buildFlag = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PREFER_FAST_TRACE;
+    auto count     = uint32_t(m_Instances.size());
+
+    std::vector<D3D12_RAYTRACING_INSTANCE_DESC> instanceDescs;
+    instanceDescs.resize(count);
+
+    for(auto i=0u; i<count; ++i)
+    { WriteInstanceDesc(i, instanceDescs[i]); }
 
-    return resScene->LightCount();
+    // 面ごとに持つので，実行中のフレームが参照するTLASを書き換えずに済む.
+    for(auto i=0u; i<FRAME_SLOT_COUNT; ++i)
+    {
+        m_TLAS[i].Term();
+
+        if (!m_TLAS[i].Init(pDevice, count, instanceDescs.data(), buildFlag))
+        {
+            ELOGA("Error : Tlas::Init() Failed.");
+            return false;
+        }
+
+        m_TLAS[i].Build(pCmdList);
+    }
+
+    return true;
 }
 
 //-----------------------------------------------------------------------------
-//      ハッシュタグに対応するライトインデックスを検索します.
+//      インスタンス記述子を書き込みます.
 //-----------------------------------------------------------------------------
-uint32_t Scene::FindLightIndex(uint32_t hashTag) const
+void Scene::WriteInstanceDesc(uint32_t index, D3D12_RAYTRACING_INSTANCE_DESC& desc) const
 {
-    auto itr = m_LightDict.find(hashTag);
-    if (itr == m_LightDict.end())
-    { return UINT32_MAX; }
-
-    return itr->second;
+    // インスタンスは読み込み順に登録するので, 番号とインスタンスIDは一致する.
+    assert(m_Instances[index].InstanceId == index);
+    auto instance = m_ModelMgr.GetCpuInstance(index);
+
+    memcpy(desc.Transform, instance.Transform.m, sizeof(float) * 12);
+    desc.InstanceID                          = index;
+    desc.InstanceMask                        = 0xFF;
+    desc.InstanceContributionToHitGroupIndex = 0;
+    desc.Flags                               = D3D12_RAYTRACING_INSTANCE_FLAG_NONE;
+    desc.AccelerationStructure               = m_BLAS[m_Instances[index].MeshId].GetResource()->GetGPUVirtualAddress();
 }
 
+//-----------------------------------------------------------------------------
+//      ライト数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t Scene::GetLightCount() const
+{ return m_LightCount; }
+
+//-----------------------------------------------------------------------------
+//      ハッシュタグに対応するライトインデックスを検索します.
+//-----------------------------------------------------------------------------
+uint32_t Scene::FindLightIndex(uint32_t hashTag) const
+{ return m_LightTags.Find(hashTag); }
+
 //-----------------------------------------------------------------------------
 //      ハッシュタグに対応するインスタンスインデックスを検索します.
 //-----------------------------------------------------------------------------
 uint32_t Scene::FindInstanceIndex(uint32_t hashTag) const
-{
-    auto itr = m_InstanceDict.find(hashTag);
-    if (itr == m_InstanceDict.end())
-    { return UINT32_MAX; }
+{ return m_InstanceTags.Find(hashTag); }
 
-    return itr->second;
+//-----------------------------------------------------------------------------
+//      インスタンスの変換行列を設定します.
+//-----------------------------------------------------------------------------
+void Scene::SetInstanceTransform(uint32_t index, const asdx::Transform3x4& transform)
+{
+    assert(index < m_Instances.size());
+    m_ModelMgr.SetTransform(m_Instances[index].InstanceId, transform);
 }
 
 
@@ -906,904 +1199,181 @@ bool Scene::IsReloading() const
 { return m_RequestTerm; }
 
 //-----------------------------------------------------------------------------
-//      巡回処理.
+//      変更のあった要素だけを更新します.
 //-----------------------------------------------------------------------------
-void Scene::Polling(ID3D12GraphicsCommandList6* pCmdList)
+bool Scene::Patch(const char* path, ID3D12GraphicsCommandList6* pCmdList)
 {
-    if (!m_RequestTerm) 
-        return;
-
-    if (m_WaitCount == 4)
-    {
-        Term();
-    }
-    else if (m_WaitCount == 8) 
-    {
-        Init(m_ReloadPath.c_str(), pCmdList);
-        m_RequestTerm = false;
-        m_WaitCount   = 0;
-    }
+    // 読み込み途中のシーンにはダイジェストが揃っていない.
+    if (!IsLoaded())
+    { return false; }
 
-    m_WaitCount++;
-}
-#endif
+    SceneContainer container;
+    if (!container.Init(path))
+    { return false; }
 
+    // 全セクションを展開したまま保持して差分を求める.
+    SceneDigest digest;
+    digest.Reset(container.GetHeader());
 
-#if !CAMP_RELEASE
-
-struct ImTextureSurfaceMemory
-{
-    std::vector<uint8_t>     Pixels;
-};
-
-struct ImTextureMemory
-{
-    asdx::ResTexture                                    SrcTexture;
-    std::vector<flatbuffers::Offset<r3d::SubResource>>  SubResources;
-    std::vector<ImTextureSurfaceMemory>                 Surfaces;
-
-    void Dispose()
+    std::vector<SceneSection> sections;
+    auto ret = container.Decode(0, [&](const SceneSection& section)
     {
-        SrcTexture.Dispose();
-        for(size_t i=0; i<Surfaces.size(); ++i)
-        { Surfaces[i].Pixels.clear(); }
-        Surfaces.clear();
-    }
-};
-
-///////////////////////////////////////////////////////////////////////////////
-// SceneExporter class
-///////////////////////////////////////////////////////////////////////////////
-
-//-----------------------------------------------------------------------------
-//      テキストファイルからシーンを読み込み，出力します.
-//-----------------------------------------------------------------------------
-bool SceneExporter::LoadFromTXT(const char* path, std::string& exportPath)
-{
-    std::string inputPath;
-    if (!asdx::SearchFilePathA(path, inputPath))
+        sections.push_back(section);
+        return digest.Append(section);
+    });
+    if (!ret)
+    { return false; }
+
+    SceneDiff diff;
+    DiffScene(m_Digest, digest, diff);
+    if (diff.Rebuild)
     {
-        ELOGA("Error : File Not Found. path = %s", path);
+        ILOGA("Info : Scene Rebuild Required. reason = %s", diff.Reason);
         return false;
     }
 
-    std::ifstream stream;
-    stream.open(inputPath.c_str(), std::ios::in);
-
-    if (!stream.is_open())
-    {
-        ELOGA("Error : File Open Failed. path = %s", inputPath.c_str());
-        return false;
-    }
-
-    const uint32_t BUFFER_SIZE =4096;
-    char buf[BUFFER_SIZE] = {};
-
-    std::vector<r3d::CpuInstance> instances;
-    std::map<std::string, uint32_t>  meshDic;
-    std::map<std::string, uint32_t>  materialDic;
-    std::map<std::string, uint32_t>  textureDic;
-
-    uint32_t meshIndex     = 0;
-    uint32_t materialIndex = 0;
-    uint32_t textureIndex  = 0;
-
-    for(;;)
+    for(auto& section : sections)
     {
-        // バッファに格納.
-        stream >> buf;
+        auto resScene = section.pScene;
 
-        if (!stream || stream.eof())
-        { break; }
-
-        if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-        { /* DO_NOTHING */ }
-        else if (0 == _stricmp(buf, "model"))
+        // メッシュ. バッファを書き換えてBLASを再構築.
+        if (resScene->Meshes() != nullptr)
         {
-            std::string tag;
-            std::string path;
-
-            for(;;)
+            auto resMeshes = resScene->Meshes();
+            for(auto index : diff.Meshes)
             {
-                stream >> buf;
-                if (!stream || stream.eof())
-                { break; }
-
-                if (0 == strcmp(buf, "};"))
-                { break; }
-                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-                { /* DO_NOTHING */ }
-                else if (0 == _stricmp(buf, "-Tag:"))
-                { stream >> tag; }
-                else if (0 == _stricmp(buf, "-Path:"))
-                { stream >> path; }
-
-                stream.ignore(BUFFER_SIZE, '\n');
-            }
+                if (index < section.FirstIndex || index >= section.FirstIndex + resMeshes->size())
+                { continue; }
 
-            assert(tag.empty() == false);
-            assert(path.empty() == false);
-            {
-                std::string findPath;
-                if (asdx::SearchFilePathA(path.c_str(), findPath))
-                {
-                    std::vector<r3d::MeshInfo> meshInfos;
-                    std::vector<r3d::Mesh>     meshes;
-
-                    if (LoadMesh(findPath.c_str(), meshes, meshInfos))
-                    {
-                        for(size_t i=0; i<meshInfos.size(); ++i)
-                        {
-                            if (meshDic.find(meshInfos[i].MeshName) == meshDic.end())
-                            {
-                                meshDic[meshInfos[i].MeshName] = meshIndex;
-                                meshIndex++;
-                            }
-                        }
-
-                        AddMeshes(meshes);
-                    }
-                }
-            }
-        }
-        else if (0 == _stricmp(buf, "material"))
-        {
-            std::string tag;
-            asdx::Vector4 baseColor = asdx::Vector4(0.0f, 0.0f, 0.0f, 1.0f);
-            float occlusion = 0.0f;
-            float roughness = 1.0f;
-            float metalness = 0.0f;
-            asdx::Vector4 emissive = asdx::Vector4(0.0f, 0.0f, 0.0f, 0.0f);
-            float ior = 0.0f;
-            std::string texBaseColor;
-            std::string texNormal;
-            std::string texOrm;
-            std::string texEmissive;
-
-            for(;;)
-            {
-                stream >> buf;
-                if (!stream || stream.eof())
-                { break; }
-
-                if (0 == strcmp(buf, "};"))
-                { break; }
-                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-                { /* DO_NOTHING */ }
-                else if (0 == _stricmp(buf, "-Tag:"))
-                { stream >> tag; }
-                else if (0 == _stricmp(buf, "-BaseColor:"))
-                { stream >> baseColor.x >> baseColor.y >> baseColor.z >> baseColor.w; }
-                else if (0 == _stricmp(buf, "-Occlusion:"))
-                { stream >> occlusion; }
-                else if (0 == _stricmp(buf, "-Roughness:"))
-                { stream >> roughness; }
-                else if (0 == _stricmp(buf, "-Metalness:"))
-                { stream >> metalness; }
-                else if (0 == _stricmp(buf, "-Ior:"))
-                { stream >> ior; }
-                else if (0 == _stricmp(buf, "-Emissive:"))
-                { stream >> emissive.x >> emissive.y >> emissive.z >> emissive.w; }
-                else if (0 == _stricmp(buf, "-BaseColorMap:"))
-                { stream >> texBaseColor; }
-                else if (0 == _stricmp(buf, "-NormalMap:"))
-                { stream >> texNormal; }
-                else if (0 == _stricmp(buf, "-OrmMap:"))
-                { stream >> texOrm; }
-                else if (0 == _stricmp(buf, "-EmissiveMap:"))
-                { stream >> texEmissive; }
-
-                stream.ignore(BUFFER_SIZE, '\n');
-            }
+                auto srcMesh = resMeshes->Get(index - section.FirstIndex);
 
-            assert(tag.empty() == false);
-
-            if (materialDic.find(tag) == materialDic.end())
-            {
-                Material material  = material.Default();
-                material.BaseColor = baseColor;
-                material.Occlusion = occlusion;
-                material.Roughness = roughness;
-                material.Metalness = metalness;
-                material.Ior       = ior;
-                material.Emissive  = emissive;
-
-                uint32_t baseColorMapId = INVALID_MATERIAL_MAP;
-                uint32_t normalMapId    = INVALID_MATERIAL_MAP;
-                uint32_t ormMapId       = INVALID_MATERIAL_MAP;
-                uint32_t emissiveMapId  = INVALID_MATERIAL_MAP;
-
-                auto getOrRegisterTextureId = [&](std::string& path, uint32_t& retId)
-                {
-                    if (textureDic.find(path) != textureDic.end()) {
-                        retId = textureDic[path];
-                    }
-                    else {
-                        retId = textureIndex;
-                        textureIndex++;
-                        textureDic[path] = retId;
-                    }
-                };
-
-                if (!texBaseColor.empty())
-                { getOrRegisterTextureId(texBaseColor, baseColorMapId); }
-                if (!texNormal.empty())
-                { getOrRegisterTextureId(texNormal, normalMapId); }
-                if (!texOrm.empty())
-                { getOrRegisterTextureId(texOrm, ormMapId); }
-                if (!texEmissive.empty())
-                { getOrRegisterTextureId(texEmissive, emissiveMapId); }
-
-                // テクスチャIDを設定.
-                material.BaseColorMap = baseColorMapId;
-                material.NormalMap    = normalMapId;
-                material.OrmMap       = ormMapId;
-                material.EmissiveMap  = emissiveMapId;
-
-                AddMaterial(material);
-
-                materialDic[tag] = materialIndex;
-                materialIndex++;
-            }
-        }
-        else if (0 == _stricmp(buf, "instance"))
-        {
-            std::string   instanceTag;
-            std::string   meshTag;
-            std::string   materialTag;
-            asdx::Vector3 scale         = asdx::Vector3(1.0f, 1.0f, 1.0f);
-            asdx::Vector3 rotate        = asdx::Vector3(0.0f, 0.0f, 0.0f);
-            asdx::Vector3 translation   = asdx::Vector3(0.0f, 0.0f, 0.0f);
-
-            for(;;)
-            {
-                stream >> buf;
-                if (!stream || stream.eof())
-                { break; }
-
-                if (0 == strcmp(buf, "};"))
-                { break; }
-                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-                { /* DO_NOTHING */ }
-                else if (0 == _stricmp(buf, "-Tag:"))
-                { stream >> instanceTag; }
-                else if (0 == _stricmp(buf, "-Mesh:"))
-                { stream >> meshTag; }
-                else if (0 == _stricmp(buf, "-Material:"))
-                { stream >> materialTag; }
-                else if (0 == _stricmp(buf, "-Scale:"))
-                { stream >> scale.x >> scale.y >> scale.z; }
-                else if (0 == _stricmp(buf, "-Rotation:"))
-                { stream >> rotate.x >> rotate.y >> rotate.z; }
-                else if (0 == _stricmp(buf, "-Translation:"))
-                { stream >> translation.x >> translation.y >> translation.z; }
-
-                stream.ignore(BUFFER_SIZE, '\n');
-            }
+                r3d::Mesh mesh = {};
+                mesh.VertexCount = srcMesh->VertexCount();
+                mesh.IndexCount  = srcMesh->IndexCount();
+                mesh.Vertices    = const_cast<r3d::ResVertex*>(reinterpret_cast<const r3d::ResVertex*>(srcMesh->Vertices()->Data()));
+                mesh.Indices     = const_cast<uint32_t*>(reinterpret_cast<const uint32_t*>(srcMesh->Indices()->Data()));
 
-            if (instanceTag.empty() || instanceTag == "")
-            {
-                instanceTag = "r3d::Instance";
-                instanceTag += std::to_string(m_Instances.size());
+                if (!m_ModelMgr.UpdateMesh(pCmdList, index, mesh))
+                { return false; }
             }
 
-            assert(meshTag.empty() == false);
-            assert(materialTag.empty() == false);
-
-            bool findMesh = meshDic.find(meshTag) != meshDic.end();
-            bool findMat  = materialDic.find(materialTag) != materialDic.end();
+            m_ModelMgr.FlushMeshes(pCmdList);
 
-            if (findMesh && findMat)
+            for(auto index : diff.Meshes)
             {
-                asdx::Matrix matrix = asdx::Matrix::CreateScale(scale)
-                    * asdx::Matrix::CreateRotationY(asdx::ToRadian(rotate.y))
-                    * asdx::Matrix::CreateRotationZ(asdx::ToRadian(rotate.z))
-                    * asdx::Matrix::CreateRotationX(asdx::ToRadian(rotate.x))
-                    * asdx::Matrix::CreateTranslation(translation);
-
-                r3d::CpuInstance instance;
-                instance.HashTag    = CalcHashTag(instanceTag);
-                instance.MaterialId = materialDic[materialTag];
-                instance.MeshId     = meshDic[meshTag];
-                instance.Transform  = asdx::FromMatrix(matrix);
-
-                AddInstance(instance);
-            }
-            else
-            {
-                ELOGA("Error : Instance(MeshTag = %s, MaterialTag = %s) is Not Registered. findMesh = %s, findMat = %s", meshTag.c_str(), materialTag.c_str(),
-                    findMesh ? "true" : "false",
-                    findMat ? "true" : "false"); 
-                assert(false);
+                if (index >= section.FirstIndex && index < section.FirstIndex + resMeshes->size())
+                { m_BLAS[index].Build(pCmdList); }
             }
         }
-        else if (0 == _stricmp(buf, "ibl"))
-        {
-            std::string path;
-
-            for(;;)
-            {
-                stream >> buf;
-                if (!stream || stream.eof())
-                { break; }
-
-                if (0 == strcmp(buf, "};"))
-                { break; }
-                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-                { /* DO_NOTHING */ }
-                else if (0 == _stricmp(buf, "-Path:"))
-                { stream >> path; }
-
-                stream.ignore(BUFFER_SIZE, '\n');
-            }
 
-            assert(path.empty() == false);
-            {
-                std::string findPath;
-                if (asdx::SearchFilePathA(path.c_str(), findPath))
-                { SetIBL(path.c_str()); }
-            }
-        }
-        else if (0 == _stricmp(buf, "directional_light"))
+        // マテリアル.
+        if (resScene->Materials() != nullptr)
         {
-            asdx::Vector3 direction = asdx::Vector3(0.0f, -1.0f, 0.0f);
-            asdx::Vector3 intensity = asdx::Vector3(1.0f, 1.0f, 1.0f);
-            std::string   tag;
-
-            for(;;)
-            {
-                stream >> buf;
-                if (!stream || stream.eof())
-                { break; }
-
-                if (0 == strcmp(buf, "};"))
-                { break; }
-                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-                { /* DO_NOTHING */ }
-                else if (0 == _stricmp(buf, "-Tag:"))
-                { stream >> tag; }
-                else if (0 == _stricmp(buf, "-Direction:"))
-                { stream >> direction.x >> direction.y >> direction.z; }
-                else if (0 == _stricmp(buf, "-Intensity:"))
-                { stream >> intensity.x >> intensity.y >> intensity.z; }
-
-                stream.ignore(BUFFER_SIZE, '\n');
-            }
-
-            if (tag.empty() || tag =="")
+            auto srcMaterials = resScene->Materials();
+            for(auto& range : diff.Materials)
             {
-                tag = "r3d::DirectionalLight";
-                tag += std::to_string(m_Lights.size());
+                for(auto i=0u; i<range.Count; ++i)
+                {
+                    auto material = ConvertMaterial(srcMaterials->Get(range.NewIndex + i));
+                    m_ModelMgr.UpdateMaterials(range.Index + i, &material, 1);
+                }
             }
-
-            Light light;
-            light.HashTag   = CalcHashTag(tag);
-            light.Type      = LIGHT_TYPE_DIRECTIONAL;
-            light.Position  = direction;
-            light.Intensity = intensity;
-            light.Radius    = 1.0f;
-
-            AddLight(light);
         }
-        else if (0 == _stricmp(buf, "point_light"))
-        {
-            asdx::Vector3 position  = asdx::Vector3(0.0f, 0.0f, 0.0f);
-            float         radius    = 1.0f;
-            asdx::Vector3 intensity = asdx::Vector3(0.0f, 0.0f, 0.0f);
-            std::string   tag;
-
-            for(;;)
-            {
-                stream >> buf;
-                if (!stream || stream.eof())
-                { break; }
-
-                if (0 == strcmp(buf, "};"))
-                { break; }
-                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-                { /* DO_NOTHING */ }
-                else if (0 == _stricmp(buf, "-Tag:"))
-                { stream >> tag; }
-                else if (0 == _stricmp(buf, "-Position:"))
-                { stream >> position.x >> position.y >> position.z; }
-                else if (0 == _stricmp(buf, "-Radius:"))
-                { stream >> radius; }
-                else if (0 == _stricmp(buf, "-Intensity:"))
-                { stream >> intensity.x >> intensity.y >> intensity.z; }
-
-                stream.ignore(BUFFER_SIZE, '\n');
-            }
-
-            if (tag.empty() || tag == "")
-            {
-                tag = "r3d::PointLight";
-                tag += std::to_string(m_Lights.size());
-            }
 
-            Light light;
-            light.HashTag   = CalcHashTag(tag);
-            light.Type      = LIGHT_TYPE_POINT;
-            light.Position  = position;
-            light.Radius    = radius;
-            light.Intensity = intensity;
-
-            AddLight(light);
-        }
-        else if (0 == _stricmp(buf, "spot_light"))
-        {
-            assert(false); // Not Implementation Yet.
-        }
-        else if (0 == _stricmp(buf, "export"))
+        // インスタンス. 並びは読み込み済みシーンのまま.
+        if (resScene->Instances() != nullptr)
         {
-            for(;;)
+            auto srcInstances = resScene->Instances();
+            for(auto& range : diff.Instances)
             {
-                stream >> buf;
-                if (!stream || stream.eof())
-                { break; }
-
-                if (0 == strcmp(buf, "};"))
-                { break; }
-                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
-                { /* DO_NOTHING */ }
-                else if (0 == _stricmp(buf, "-Path:"))
-                { stream >> exportPath; }
-
-                stream.ignore(BUFFER_SIZE, '\n');
-            }
-        }
-
-        stream.ignore(BUFFER_SIZE, '\n');
-    }
-    stream.close();
-
-    // エクスポート名が無ければタイムスタンプを付ける
-    if (exportPath.empty())
-    {
-        tm local_time = {};
-        auto t   = time(nullptr);
-        auto err = localtime_s( &local_time, &t );
-
-        char timeStamp[256] = {};
-        sprintf_s(timeStamp, "%04d%02d%02d_%02d%02d%02d",
-            local_time.tm_year + 1900,
-            local_time.tm_mon + 1,
-            local_time.tm_mday,
-            local_time.tm_hour,
-            local_time.tm_min,
-            local_time.tm_sec);
-
-        exportPath = "../res/scene/scene_";
-        exportPath += timeStamp;
-        exportPath += ".scn";
-    }
-
-    if (!Export(exportPath.c_str()))
-    {
-        ELOG("Error : Scene Export Failed.");
-        return false;
-    }
-
-    ILOGA("Info : Scene Exported!! path = %s", exportPath.c_str());
-    return true;
-}
-
-//-----------------------------------------------------------------------------
-//      ファイルに出力します.
-//-----------------------------------------------------------------------------
-bool SceneExporter::Export(const char* path)
-{
-    std::vector<flatbuffers::Offset<r3d::ResMesh>>      dstMeshes;
-    std::vector<flatbuffers::Offset<r3d::ResTexture>>   dstTextures;
-    std::vector<r3d::ResMaterial>                       dstMaterials;
-    std::vector<r3d::ResLight>                          dstLights;
-    std::vector<r3d::ResInstance>                       dstInstances;
-    flatbuffers::Offset<r3d::ResTexture>                dstIBL;
-    std::vector<uint32_t>                               instanceTags;
-    std::vector<uint32_t>                               lightTags;
-
-    ImTextureMemory srcIBL;
-    std::vector<ImTextureMemory> srcTextures;
-
-    flatbuffers::FlatBufferBuilder  builder(2048);
-
-    // 破棄処理.
-    auto dispose = [&]() {
-        srcIBL.Dispose();
-        for(size_t i=0; i<srcTextures.size(); ++i)
-        { srcTextures[i].Dispose(); }
-    };
-
-    // IBLテクスチャ読み込み.
-    {
-        std::string texPath;
-        if (!asdx::SearchFilePathA(m_IBL.c_str(), texPath))
-        {
-            ELOGA("Error : File Not Found. path = %s", m_IBL.c_str());
-            return false;
-        }
-
-        if (!srcIBL.SrcTexture.LoadFromFileA(texPath.c_str()))
-        {
-            ELOGA("Error : IBL Load Failed. path = %s", texPath.c_str());
-            return false;
-        }
-
-        auto count = srcIBL.SrcTexture.SurfaceCount * srcIBL.SrcTexture.MipMapCount;
-
-        srcIBL.Surfaces.resize(count);
-
-        for(auto i=0u; i<count; ++i)
-        {
-            srcIBL.Surfaces[i].Pixels.resize(srcIBL.SrcTexture.pResources[i].SlicePitch);
+                for(auto i=0u; i<range.Count; ++i)
+                {
+                    auto srcInstance = srcInstances->Get(range.NewIndex + i);
+                    auto index       = range.Index + i;
+                    auto instanceId  = m_Instances[index].InstanceId;
 
-            // 順番補正.
-            if (srcIBL.SrcTexture.Format == 2/*DXGI_FORMAT_R32G32B32A32_FLOAT*/)
-            {
-                auto count = srcIBL.SrcTexture.pResources[i].SlicePitch / sizeof(float);
-                auto pFloatPixels = reinterpret_cast<float*>(srcIBL.SrcTexture.pResources[i].pPixels);
+                    auto instance = m_ModelMgr.GetCpuInstance(instanceId);
+                    instance.MaterialId = srcInstance->MaterialIndex();
+                    instance.Transform  = FromBinaryFormat(srcInstance->Transform());
+                    m_ModelMgr.UpdateInstance(instanceId, instance);
 
-                for(auto px=0; px<count; px+=4)
-                {
-                    auto A = pFloatPixels[px + 0];
-                    auto R = pFloatPixels[px + 1];
-                    auto G = pFloatPixels[px + 2];
-                    auto B = pFloatPixels[px + 3];
-
-                    pFloatPixels[px + 0] = R;
-                    pFloatPixels[px + 1] = G;
-                    pFloatPixels[px + 2] = B;
-                    pFloatPixels[px + 3] = A;
+                    m_DrawCalls[index].MaterialId = instance.MaterialId;
                 }
             }
-
-            memcpy(
-                srcIBL.Surfaces[i].Pixels.data(),
-                srcIBL.SrcTexture.pResources[i].pPixels,
-                srcIBL.SrcTexture.pResources[i].SlicePitch);
-
-            auto item = r3d::CreateSubResourceDirect(
-                builder,
-                srcIBL.SrcTexture.pResources[i].Width,
-                srcIBL.SrcTexture.pResources[i].Height,
-                srcIBL.SrcTexture.pResources[i].MipIndex,
-                srcIBL.SrcTexture.pResources[i].Pitch,
-                srcIBL.SrcTexture.pResources[i].SlicePitch,
-                &srcIBL.Surfaces[i].Pixels);
-
-            srcIBL.SubResources.push_back(item);
         }
 
-        dstIBL = r3d::CreateResTextureDirect(
-            builder,
-            srcIBL.SrcTexture.Dimension,
-            srcIBL.SrcTexture.Width,
-            srcIBL.SrcTexture.Height,
-            srcIBL.SrcTexture.Depth,
-            srcIBL.SrcTexture.Format,
-            srcIBL.SrcTexture.MipMapCount,
-            srcIBL.SrcTexture.SurfaceCount,
-            0,
-            &srcIBL.SubResources);
-    }
-
-    // マテリアル用テクスチャ読み込み.
-    {
-        srcTextures.resize(m_Textures.size());
-
-        for(size_t i=0; i<m_Textures.size(); ++i)
+        // ライト. 変更された範囲だけ書き換える.
+        if (resScene->Lights() != nullptr && m_pLights != nullptr)
         {
-            std::string texPath;
-            if (!asdx::SearchFilePathA(m_Textures[i].c_str(), texPath))
-            {
-                ELOGA("Error : File Not Found. path = %s", m_Textures[i].c_str());
-                dispose();
-                return false;
-            }
-
-            if (!srcTextures[i].SrcTexture.LoadFromFileA(texPath.c_str()))
-            {
-                ELOGA("Error : Texture Load Failed. path = %s", texPath.c_str());
-                dispose();
-                return false;
-            }
-
-            auto count = srcTextures[i].SrcTexture.SurfaceCount * srcTextures[i].SrcTexture.MipMapCount;
-
-            srcTextures[i].Surfaces.resize(count);
-
-            for(auto j=0u; j<count; ++j)
+            auto srcLights = resScene->Lights();
+            for(auto& range : diff.Lights)
             {
-                srcTextures[i].Surfaces[j].Pixels.resize(srcTextures[i].SrcTexture.pResources[j].SlicePitch);
                 memcpy(
-                    srcTextures[i].Surfaces[j].Pixels.data(),
-                    srcTextures[i].SrcTexture.pResources[j].pPixels,
-                    srcTextures[i].SrcTexture.pResources[j].SlicePitch);
-
-                auto item = r3d::CreateSubResourceDirect(
-                    builder,
-                    srcTextures[i].SrcTexture.pResources[j].Width,
-                    srcTextures[i].SrcTexture.pResources[j].Height,
-                    srcTextures[i].SrcTexture.pResources[j].MipIndex,
-                    srcTextures[i].SrcTexture.pResources[j].Pitch,
-                    srcTextures[i].SrcTexture.pResources[j].SlicePitch,
-                    &srcTextures[i].Surfaces[j].Pixels);
-
-                srcTextures[i].SubResources.push_back(item);
+                    m_pLights + range.Index,
+                    srcLights->Get(range.NewIndex),
+                    sizeof(ResLight) * range.Count);
             }
-
-            dstTextures.push_back(
-                r3d::CreateResTextureDirect(
-                    builder,
-                    srcTextures[i].SrcTexture.Dimension,
-                    srcTextures[i].SrcTexture.Width,
-                    srcTextures[i].SrcTexture.Height,
-                    srcTextures[i].SrcTexture.Depth,
-                    srcTextures[i].SrcTexture.Format,
-                    srcTextures[i].SrcTexture.MipMapCount,
-                    srcTextures[i].SrcTexture.SurfaceCount,
-                    0,
-                    &srcTextures[i].SubResources));
         }
     }
 
-    // メッシュ変換処理
+    // インスタンスの変更は Update() で面ごとに反映される.
+    // BLASを作り直した場合だけ全ての面を作り直す.
+    if (!diff.Meshes.empty())
     {
-        for(size_t i=0; i<m_Meshes.size(); ++i)
-        {
-            auto& srcMesh = m_Meshes[i];
-
-            std::vector<ResVertex> vertices(srcMesh.Vertices, srcMesh.Vertices + srcMesh.VertexCount);
-            std::vector<uint32_t>  indices(srcMesh.Indices, srcMesh.Indices + srcMesh.IndexCount);
-
-            dstMeshes.push_back(
-                r3d::CreateResMeshDirect(
-                    builder,
-                    m_Meshes[i].VertexCount,
-                    m_Meshes[i].IndexCount,
-                    &vertices,
-                    &indices));
-        }
-    }
-
-    // マテリアル変換処理.
-    {
-        for(size_t i=0; i<m_Materials.size(); ++i)
-        {
-            r3d::ResMaterial item(
-                m_Materials[i].BaseColorMap,
-                m_Materials[i].NormalMap,
-                m_Materials[i].OrmMap,
-                m_Materials[i].EmissiveMap,
-
-                ToBinaryFormat(m_Materials[i].BaseColor),
-                m_Materials[i].Occlusion,
-                m_Materials[i].Roughness,
-                m_Materials[i].Metalness,
-                m_Materials[i].Ior,
-                ToBinaryFormat(m_Materials[i].Emissive)
-            );
-
-            dstMaterials.push_back(item);
-        }
-    }
-
-    // ライト変換処理.
-    {
-        for(size_t i=0; i<m_Lights.size(); ++i)
-        {
-            r3d::ResLight item(
-                m_Lights[i].Type,
-                r3d::Vector3(m_Lights[i].Intensity.x, m_Lights[i].Intensity.y, m_Lights[i].Intensity.z),
-                r3d::Vector3(m_Lights[i].Position .x, m_Lights[i].Position .y, m_Lights[i].Position .z),
-                m_Lights[i].Radius);
-
-            dstLights.push_back(item);
-
-            auto hashTag = m_Lights[i].HashTag;
-            lightTags.push_back(hashTag);
-        }
+        if (!BuildTLAS(pCmdList))
+        { return false; }
     }
 
-    // インスタンス変換処理.
-    {
-        for(size_t i=0; i<m_Instances.size(); ++i)
-        {
-            auto& srcMtx = m_Instances[i].Transform;
-            r3d::Matrix3x4 dstMtx(
-                r3d::Vector4(srcMtx.m[0][0], srcMtx.m[0][1], srcMtx.m[0][2], srcMtx.m[0][3]),
-                r3d::Vector4(srcMtx.m[1][0], srcMtx.m[1][1], srcMtx.m[1][2], srcMtx.m[1][3]),
-                r3d::Vector4(srcMtx.m[2][0], srcMtx.m[2][1], srcMtx.m[2][2], srcMtx.m[2][3]));
+    ILOGA("Info : Scene Patched. mesh = %zu, material = %zu, instance = %zu, light = %zu",
+        diff.Meshes.size(), diff.Materials.size(), diff.Instances.size(), diff.Lights.size());
 
-            r3d::ResInstance item(
-                m_Instances[i].MeshId,
-                m_Instances[i].MaterialId,
-                dstMtx);
-
-            dstInstances.push_back(item);
-
-            auto hashTag = m_Instances[i].HashTag;
-            instanceTags.push_back(hashTag);
-        }
-    }
-
-    // 出力処理.
-    {
-        auto meshCount      = uint32_t(dstMeshes.size());
-        auto instanceCount  = uint32_t(dstInstances.size());
-        auto textureCount   = uint32_t(dstTextures.size());
-        auto materialCount  = uint32_t(dstMaterials.size());
-        auto lightCount     = uint32_t(dstLights.size());
-
-        auto dstScene = r3d::CreateResSceneDirect(
-            builder,
-            meshCount,
-            instanceCount,
-            textureCount,
-            materialCount,
-            lightCount,
-            dstIBL,
-            &dstMeshes,
-            &dstInstances,
-            &dstTextures,
-            &dstMaterials,
-            &dstLights,
-            &instanceTags,
-            &lightTags);
-
-        builder.Finish(dstScene);
-
-        auto buffer = builder.GetBufferPointer();
-        auto size   = builder.GetSize();
-
-        // ファイルに出力.
-        FILE* fp = nullptr;
-        auto err = fopen_s(&fp, path, "wb");
-        if (err != 0)
-        {
-            ELOGA("Error : File Open Failed. path = %s", path);
-            dispose();
-            return false;
-        }
-
-        fwrite(buffer, size, 1, fp);
-        fclose(fp);
-
-        ILOGA("Info : Scene File Exported!! path = %s", path);
-    }
-
-    dispose();
-
-    // 正常終了.
+    m_Digest = std::move(digest);
     return true;
 }
 
 //-----------------------------------------------------------------------------
-//      リセットします.
+//      巡回処理.
 //-----------------------------------------------------------------------------
-void SceneExporter::Reset()
+void Scene::Polling(ID3D12GraphicsCommandList6* pCmdList)
 {
-    for(size_t i=0; i<m_Meshes.size(); ++i)
-    {
-        if (m_Meshes[i].Vertices != nullptr)
-        { delete[] m_Meshes[i].Vertices; }
-
-        if (m_Meshes[i].Indices != nullptr)
-        { delete[] m_Meshes[i].Indices; }
-    }
-
-    m_Lights   .clear();
-    m_Meshes   .clear();
-    m_Materials.clear();
-    m_Instances.clear();
-    m_Textures .clear();
-}
-
-//-----------------------------------------------------------------------------
-//      ライトを追加します.
-//-----------------------------------------------------------------------------
-void SceneExporter::AddLight(const Light& value)
-{ m_Lights.emplace_back(value); }
-
-//-----------------------------------------------------------------------------
-//      メッシュを追加します.
-//-----------------------------------------------------------------------------
-void SceneExporter::AddMesh(const Mesh& value)
-{ m_Meshes.emplace_back(value); }
-
-//-----------------------------------------------------------------------------
-//      メッシュを追加します.
-//-----------------------------------------------------------------------------
-void SceneExporter::AddMeshes(const std::vector<Mesh>& values)
-{ m_Meshes.insert(m_Meshes.end(), values.begin(), values.end()); }
-
-//-----------------------------------------------------------------------------
-//      マテリアルを追加します.
-//-----------------------------------------------------------------------------
-void SceneExporter::AddMaterial(const Material& value)
-{ m_Materials.emplace_back(value); }
-
-//-----------------------------------------------------------------------------
-//      インスタンスを追加します.
-//-----------------------------------------------------------------------------
-void SceneExporter::AddInstance(const CpuInstance& value)
-{ m_Instances.emplace_back(value); }
-
-//-----------------------------------------------------------------------------
-//      インスタンスを追加します.
-//-----------------------------------------------------------------------------
-void SceneExporter::AddInstances(const std::vector<CpuInstance>& values)
-{ m_Instances.insert(m_Instances.end(), values.begin(), values.end()); }
-
-//-----------------------------------------------------------------------------
-//      テクスチャを追加します.
-//-----------------------------------------------------------------------------
-void SceneExporter::AddTexture(const char* path)
-{ m_Textures.push_back(path); }
-
-//-----------------------------------------------------------------------------
-//      IBLを設定します.
-//-----------------------------------------------------------------------------
-void SceneExporter::SetIBL(const char* path)
-{ m_IBL = path; }
+    if (!m_RequestTerm) 
+        return;
 
-//-----------------------------------------------------------------------------
-//      メッシュをロードします.
-//-----------------------------------------------------------------------------
-bool LoadMesh(const char* path, std::vector<Mesh>& result, std::vector<MeshInfo>& infos)
-{
-    std::string meshPath;
-    if (!asdx::SearchFilePathA(path, meshPath))
+    if (m_WaitCount == 4)
     {
-        ELOGA("Error : File Not Found. path = %s", path);
-        return false;
-    }
+        // 差分だけで済む場合は作り直さない.
+        if (Patch(m_ReloadPath.c_str(), pCmdList))
+        {
+            m_RequestTerm = false;
+            m_WaitCount   = 0;
+            return;
+        }
 
-    ModelOBJ  model;
-    OBJLoader loader;
-    if (!loader.Load(meshPath.c_str(), model))
+        Term();
+    }
+    else if (m_WaitCount == 8) 
     {
-        ELOGA("Error : Model Load Failed. path = %s", meshPath.c_str());
-        return false;
+        if (!BeginLoad(m_ReloadPath.c_str(), pCmdList))
+        {
+            m_RequestTerm = false;
+            m_WaitCount   = 0;
+            return;
+        }
     }
-
-    result.resize(model.Meshes.size());
-    infos .resize(model.Meshes.size());
-
-    for(size_t i=0; i<model.Meshes.size(); ++i)
+    else if (m_WaitCount > 8)
     {
-        auto& srcMesh = model.Meshes[i];
-        auto& dstMesh = result[i];
-
-        infos[i].MeshName     = srcMesh.Name;
-        infos[i].MaterialName = srcMesh.MaterialName;
-
-        auto vertexCount = uint32_t(srcMesh.Vertices.size());
-        auto indexCount  = uint32_t(srcMesh.Indices.size());
-
-        dstMesh.VertexCount = vertexCount;
-        dstMesh.IndexCount  = indexCount;
-
-        dstMesh.Vertices = new ResVertex[vertexCount];
-        dstMesh.Indices  = new uint32_t [indexCount];
-
-        for(uint32_t j=0; j<vertexCount; ++j)
+        // 1フレームあたりのアップロード量を制限して描画を止めないようにする.
+        auto state = UpdateLoad(pCmdList, STREAM_UPLOAD_BUDGET);
+        if (state != SCENE_STREAM_STATE_LOADING)
         {
-            auto& srcVtx = srcMesh.Vertices[j];
-            dstMesh.Vertices[j] = ResVertex(
-                r3d::Vector3(srcVtx.Position.x, srcVtx.Position.y, srcVtx.Position.z),
-                r3d::Vector3(srcVtx.Normal  .x, srcVtx.Normal  .y, srcVtx.Normal  .z),
-                r3d::Vector3(srcVtx.Tangent .x, srcVtx.Tangent .y, srcVtx.Tangent .z),
-                r3d::Vector2(srcVtx.TexCoord.x, srcVtx.TexCoord.y)
-            );
+            m_RequestTerm = false;
+            m_WaitCount   = 0;
         }
-
-        for(uint32_t j=0; j<indexCount; ++j)
-        { dstMesh.Indices[j] = srcMesh.Indices[j]; }
+        return;
     }
 
-    return true;
+    m_WaitCount++;
 }
-
 #endif
 
 } // namespace r3d
@@ -0,0 +1,415 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneContainer.cpp
+// Desc : Sectioned Scene Container.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <SceneContainer.h>
+#include <Compression.h>
+#include <Platform.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//      ブロブファイルのパスを取得します.
+//-----------------------------------------------------------------------------
+std::string GetSceneBlobPath(const char* path, uint32_t file)
+{
+    char suffix[16] = {};
+    snprintf(suffix, sizeof(suffix), "_%03u.scb", file);
+    return GetPathWithoutExt(path) + suffix;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneContainer class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+SceneContainer::~SceneContainer()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      ファイルを開いてセクションテーブルを検証します.
+//-----------------------------------------------------------------------------
+bool SceneContainer::Init(const char* path)
+{
+    Term();
+
+    std::unique_ptr<MappedFile> root(new MappedFile());
+    if (!root->Init(path))
+    {
+        ELOGA("Error : MappedFile::Init() Failed. path = %s", path);
+        return false;
+    }
+
+    // 展開中に残りを読み込ませる.
+    root->Prefetch(root->GetData(), root->GetSize());
+
+    auto pData = root->GetData();
+    auto size  = uint64_t(root->GetSize());
+    m_Files.push_back(std::move(root));
+
+    if (size >= sizeof(SceneContainerHeader))
+    { memcpy(&m_Header, pData, sizeof(m_Header)); }
+
+    if (size < sizeof(SceneContainerHeader) || m_Header.Magic != SCENE_CONTAINER_MAGIC)
+    {
+        if (!InitLegacy())
+        {
+            ELOGA("Error : Invalid Scene File. path = %s", path);
+            Term();
+            return false;
+        }
+
+        return true;
+    }
+
+    if (m_Header.Version != SCENE_CONTAINER_VERSION)
+    {
+        ELOGA("Error : Unsupported Scene Version. version = %u, path = %s", m_Header.Version, path);
+        Term();
+        return false;
+    }
+
+    auto tableSize = uint64_t(m_Header.SectionCount) * sizeof(SceneSectionEntry);
+    if (m_Header.SectionCount == 0 || tableSize > size - sizeof(SceneContainerHeader))
+    {
+        ELOGA("Error : Invalid Section Table. path = %s", path);
+        Term();
+        return false;
+    }
+
+    auto pTable = pData + sizeof(SceneContainerHeader);
+    if (XXH3_64bits(pTable, size_t(tableSize)) != m_Header.TableChecksum)
+    {
+        ELOGA("Error : Section Table Checksum Not Matched. path = %s", path);
+        Term();
+        return false;
+    }
+
+    m_Entries.resize(m_Header.SectionCount);
+    memcpy(m_Entries.data(), pTable, size_t(tableSize));
+
+    if (!InitBlobs(path))
+    {
+        Term();
+        return false;
+    }
+
+    for(size_t i=0; i<m_Entries.size(); ++i)
+    {
+        auto& entry = m_Entries[i];
+
+        auto valid = entry.Type <= SCENE_SECTION_TYPE_SCENE
+                  && entry.Codec <= COMPRESSION_CODEC_LZ4
+                  && entry.File < m_Files.size();
+        if (valid)
+        { size = uint64_t(m_Files[entry.File]->GetSize()); }
+
+        valid = valid
+                  && entry.Offset % SCENE_SECTION_ALIGNMENT == 0
+                  && entry.Offset <= size
+                  && entry.StoredSize <= size - entry.Offset
+                  && entry.RawSize > 0
+                  && (entry.Codec != COMPRESSION_CODEC_NONE || entry.StoredSize == entry.RawSize);
+        if (!valid)
+        {
+            ELOGA("Error : Invalid Section Entry. index = %zu, path = %s", i, path);
+            Term();
+            return false;
+        }
+    }
+
+    m_Buffers.resize(m_Entries.size());
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      参照しているブロブファイルを開きます.
+//-----------------------------------------------------------------------------
+bool SceneContainer::InitBlobs(const char* path)
+{
+    for(auto i=1u; i<=m_Header.BlobCount; ++i)
+    {
+        auto blobPath = GetSceneBlobPath(path, i);
+
+        std::unique_ptr<MappedFile> blob(new MappedFile());
+        if (!blob->Init(blobPath.c_str()))
+        {
+            ELOGA("Error : Scene Blob Not Found. path = %s", blobPath.c_str());
+            return false;
+        }
+
+        SceneBlobHeader header = {};
+        if (blob->GetSize() >= sizeof(header))
+        { memcpy(&header, blob->GetData(), sizeof(header)); }
+
+        // 別のエクスポート結果と混ざっていないか確認.
+        auto valid = blob->GetSize() >= sizeof(header)
+                  && header.Magic    == SCENE_BLOB_MAGIC
+                  && header.Version  == SCENE_BLOB_VERSION
+                  && header.File     == i
+                  && header.BundleId == m_Header.BundleId;
+        if (!valid)
+        {
+            ELOGA("Error : Scene Blob Not Matched. path = %s", blobPath.c_str());
+            return false;
+        }
+
+        // ファイル毎に先読みを要求し，複数のファイルを並行して読み込ませる.
+        blob->Prefetch(blob->GetData(), blob->GetSize());
+        m_Files.push_back(std::move(blob));
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      セクション化前の形式として初期化します.
+//-----------------------------------------------------------------------------
+bool SceneContainer::InitLegacy()
+{
+    auto pData = m_Files[0]->GetData();
+    auto size  = m_Files[0]->GetSize();
+
+    // ヘッダもチェックサムも無いので，ここで構造を検証しておく.
+    flatbuffers::Verifier verifier(pData, size);
+    if (!VerifyResSceneBuffer(verifier))
+    { return false; }
+
+    auto resScene = GetResScene(pData);
+
+    m_Header = {};
+    m_Header.Version        = 0;
+    m_Header.SectionCount   = 1;
+    m_Header.MeshCount      = resScene->MeshCount();
+    m_Header.InstanceCount  = resScene->InstanceCount();
+    m_Header.TextureCount   = resScene->TextureCount();
+    m_Header.MaterialCount  = resScene->MaterialCount();
+    m_Header.LightCount     = resScene->LightCount();
+
+    SceneSectionEntry entry = {};
+    entry.Type          = SCENE_SECTION_TYPE_SCENE;
+    entry.Codec         = COMPRESSION_CODEC_NONE;
+    entry.FirstIndex    = 0;
+    entry.Count         = 1;
+    entry.Offset        = 0;
+    entry.StoredSize    = size;
+    entry.RawSize       = size;
+    entry.Checksum      = 0;
+
+    m_Entries.push_back(entry);
+    m_Buffers.resize(1);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void SceneContainer::Term()
+{
+    m_Buffers.clear();
+    m_Entries.clear();
+    m_Header = {};
+    m_Files  .clear();
+}
+
+//-----------------------------------------------------------------------------
+//      セクションを展開し，チェックサムを検証します.
+//-----------------------------------------------------------------------------
+bool SceneContainer::DecodeSection(uint32_t index, const uint8_t*& pData)
+{
+    auto& entry = m_Entries[index];
+    auto  pSrc  = m_Files[entry.File]->GetData() + entry.Offset;
+
+    if (entry.Codec == COMPRESSION_CODEC_NONE)
+    {
+        // 無圧縮ならマッピングをそのまま参照する.
+        pData = pSrc;
+    }
+    else
+    {
+        std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[size_t(entry.RawSize)]);
+        if (!buffer)
+        {
+            ELOGA("Error : Out of Memory. index = %u, size = %llu", index, (unsigned long long)entry.RawSize);
+            return false;
+        }
+
+        if (!DecompressLZ4(pSrc, size_t(entry.StoredSize), buffer.get(), size_t(entry.RawSize)))
+        {
+            ELOGA("Error : DecompressLZ4() Failed. index = %u", index);
+            return false;
+        }
+
+        pData = buffer.get();
+        m_Buffers[index] = std::move(buffer);
+    }
+
+    // セクション化前の形式は Init() 時に検証済み.
+    if (m_Header.Version == 0)
+    { return true; }
+
+    if (XXH3_64bits(pData, size_t(entry.RawSize)) != entry.Checksum)
+    {
+        ELOGA("Error : Section Checksum Not Matched. index = %u", index);
+        m_Buffers[index].reset();
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      全セクションを並列に展開します.
+//-----------------------------------------------------------------------------
+bool SceneContainer::Decode(uint32_t threadCount, const Callback& callback)
+{
+    auto sectionCount = uint32_t(m_Entries.size());
+    if (sectionCount == 0)
+    { return false; }
+
+    if (threadCount == 0)
+    { threadCount = std::max(std::thread::hardware_concurrency(), 1u); }
+    threadCount = std::min(threadCount, sectionCount);
+
+    std::mutex                  mutex;
+    std::condition_variable     cond;
+    std::deque<SceneSection>    completed;
+    std::atomic<uint32_t>       next(0);
+    std::atomic<bool>           abort(false);
+    bool                        failed = false;
+
+    // テーブル順に取り出すので，ファイル上も先頭から順に読まれる.
+    auto worker = [&]()
+    {
+        while(!abort)
+        {
+            auto index = next++;
+            if (index >= sectionCount)
+            { break; }
+
+            const uint8_t* pData = nullptr;
+            auto result = DecodeSection(index, pData);
+
+            {
+                std::lock_guard<std::mutex> locker(mutex);
+                if (result)
+                {
+                    auto& entry = m_Entries[index];
+
+                    SceneSection section = {};
+                    section.Index       = index;
+                    section.Type        = SCENE_SECTION_TYPE(entry.Type);
+                    section.FirstIndex  = entry.FirstIndex;
+                    section.Count       = entry.Count;
+                    section.pScene      = GetResScene(pData);
+                    completed.push_back(section);
+                }
+                else
+                {
+                    failed = true;
+                }
+            }
+
+            cond.notify_one();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for(auto i=0u; i<threadCount; ++i)
+    { threads.emplace_back(worker); }
+
+    auto result = true;
+    for(auto i=0u; i<sectionCount; ++i)
+    {
+        SceneSection section = {};
+        {
+            std::unique_lock<std::mutex> locker(mutex);
+            cond.wait(locker, [&]() { return failed || !completed.empty(); });
+
+            if (failed)
+            {
+                result = false;
+                break;
+            }
+
+            section = completed.front();
+            completed.pop_front();
+        }
+
+        if (!callback(section))
+        {
+            result = false;
+            break;
+        }
+    }
+
+    abort = true;
+    for(auto& thread : threads)
+    { thread.join(); }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      展開済みのセクションのメモリを解放します.
+//-----------------------------------------------------------------------------
+void SceneContainer::ReleaseSection(uint32_t index)
+{
+    if (index >= m_Entries.size())
+    { return; }
+
+    if (m_Buffers[index])
+    {
+        m_Buffers[index].reset();
+        return;
+    }
+
+    auto& entry = m_Entries[index];
+    auto& file  = m_Files[entry.File];
+    file->Release(file->GetData() + entry.Offset, size_t(entry.StoredSize));
+}
+
+//-----------------------------------------------------------------------------
+//      展開済みのセクションのメモリを引き取ります.
+//-----------------------------------------------------------------------------
+std::unique_ptr<uint8_t[]> SceneContainer::DetachSection(uint32_t index)
+{
+    if (index >= m_Entries.size())
+    { return nullptr; }
+
+    if (m_Buffers[index])
+    { return std::move(m_Buffers[index]); }
+
+    // 無圧縮ならファイルを閉じた後も残るようにコピーする.
+    auto& entry = m_Entries[index];
+    auto  size  = size_t(entry.RawSize);
+
+    std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[size]);
+    if (!buffer)
+    {
+        ELOGA("Error : Out of Memory. index = %u, size = %llu", index, (unsigned long long)entry.RawSize);
+        return nullptr;
+    }
+
+    memcpy(buffer.get(), m_Files[entry.File]->GetData() + entry.Offset, size);
+    return buffer;
+}
+
+} // namespace r3d
@@ -0,0 +1,390 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneDiff.cpp
+// Desc : Scene Difference Detection.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <SceneDiff.h>
+#include <Platform.h>
+#include <unordered_map>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      テクスチャのハッシュを計算します.
+//-----------------------------------------------------------------------------
+uint64_t CalcTextureHash(const r3d::ResTexture* texture)
+{
+    const uint32_t params[] = {
+        texture->Dimension(),
+        texture->Width(),
+        texture->Height(),
+        texture->Depth(),
+        texture->Format(),
+        texture->MipLevels(),
+        texture->SurfaceCount(),
+        texture->Option(),
+    };
+
+    auto hash = XXH3_64bits(params, sizeof(params));
+
+    auto resources = texture->Resources();
+    if (resources == nullptr)
+    { return hash; }
+
+    for(auto i=0u; i<resources->size(); ++i)
+    {
+        auto subRes = resources->Get(i);
+
+        const uint32_t layout[] = {
+            subRes->Width(),
+            subRes->Height(),
+            subRes->MipIndex(),
+            subRes->Pitch(),
+            subRes->SlicePitch(),
+        };
+        hash = XXH3_64bits_withSeed(layout, sizeof(layout), hash);
+
+        auto pixels = subRes->Pixels();
+        if (pixels != nullptr)
+        { hash = XXH3_64bits_withSeed(pixels->data(), pixels->size(), hash); }
+    }
+
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュのハッシュを計算します.
+//-----------------------------------------------------------------------------
+uint64_t CalcMeshHash(const r3d::ResMesh* mesh)
+{
+    uint64_t hash = 0;
+
+    auto vertices = mesh->Vertices();
+    if (vertices != nullptr)
+    { hash = XXH3_64bits(vertices->Data(), vertices->size() * sizeof(r3d::ResVertex)); }
+
+    auto indices = mesh->Indices();
+    if (indices != nullptr)
+    { hash = XXH3_64bits_withSeed(indices->Data(), indices->size() * sizeof(uint32_t), hash); }
+
+    return hash;
+}
+
+//-----------------------------------------------------------------------------
+//      連続していれば直前の範囲を延長し，そうでなければ追加します.
+//-----------------------------------------------------------------------------
+void AddRange(std::vector<r3d::SceneRange>& ranges, uint32_t index, uint32_t newIndex)
+{
+    if (!ranges.empty())
+    {
+        auto& last = ranges.back();
+        if (last.Index + last.Count == index && last.NewIndex + last.Count == newIndex)
+        {
+            last.Count++;
+            return;
+        }
+    }
+
+    r3d::SceneRange range = {};
+    range.Index    = index;
+    range.NewIndex = newIndex;
+    range.Count    = 1;
+    ranges.push_back(range);
+}
+
+//-----------------------------------------------------------------------------
+//      ハッシュタグから要素番号への辞書を作成します.
+//-----------------------------------------------------------------------------
+template<typename T>
+bool BuildTagMap(const std::vector<T>& items, std::unordered_map<uint32_t, uint32_t>& result)
+{
+    result.clear();
+    result.reserve(items.size());
+
+    for(auto i=0u; i<items.size(); ++i)
+    {
+        if (!result.insert(std::make_pair(items[i].HashTag, i)).second)
+        { return false; }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      再構築が必要であることを設定します.
+//-----------------------------------------------------------------------------
+void SetRebuild(r3d::SceneDiff& diff, const char* reason)
+{
+    diff.Rebuild = true;
+    diff.Reason  = reason;
+    diff.Meshes   .clear();
+    diff.Materials.clear();
+    diff.Instances.clear();
+    diff.Lights   .clear();
+}
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneDigest structure
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      ヘッダの要素数で初期化します.
+//-----------------------------------------------------------------------------
+void SceneDigest::Reset(const SceneContainerHeader& header)
+{
+    IblHash = 0;
+
+    Textures .assign(header.TextureCount,  0);
+    Meshes   .assign(header.MeshCount,     SceneMeshDigest());
+    Materials.assign(header.MaterialCount, 0);
+    Instances.assign(header.InstanceCount, SceneInstanceDigest());
+    Lights   .assign(header.LightCount,    SceneLightDigest());
+}
+
+//-----------------------------------------------------------------------------
+//      セクションに含まれる要素のハッシュを記録します.
+//-----------------------------------------------------------------------------
+bool SceneDigest::Append(const SceneSection& section)
+{
+    auto resScene = section.pScene;
+    if (resScene == nullptr)
+    { return false; }
+
+    if (resScene->IblTexture() != nullptr)
+    { IblHash = CalcTextureHash(resScene->IblTexture()); }
+
+    if (resScene->Textures() != nullptr)
+    {
+        auto textures = resScene->Textures();
+        if (section.FirstIndex + textures->size() > Textures.size())
+        { return false; }
+
+        for(auto i=0u; i<textures->size(); ++i)
+        { Textures[section.FirstIndex + i] = CalcTextureHash(textures->Get(i)); }
+    }
+
+    if (resScene->Meshes() != nullptr)
+    {
+        auto meshes = resScene->Meshes();
+        if (section.FirstIndex + meshes->size() > Meshes.size())
+        { return false; }
+
+        for(auto i=0u; i<meshes->size(); ++i)
+        {
+            auto  mesh = meshes->Get(i);
+            auto& dst  = Meshes[section.FirstIndex + i];
+            dst.VertexCount = mesh->VertexCount();
+            dst.IndexCount  = mesh->IndexCount();
+            dst.Hash        = CalcMeshHash(mesh);
+        }
+    }
+
+    if (resScene->Materials() != nullptr)
+    {
+        auto materials = resScene->Materials();
+        if (materials->size() > Materials.size())
+        { return false; }
+
+        for(auto i=0u; i<materials->size(); ++i)
+        { Materials[i] = XXH3_64bits(materials->Get(i), sizeof(ResMaterial)); }
+    }
+
+    if (resScene->Instances() != nullptr)
+    {
+        auto instances = resScene->Instances();
+        auto tags      = resScene->InstanceTags();
+        if (instances->size() > Instances.size() || tags == nullptr || tags->size() != instances->size())
+        { return false; }
+
+        for(auto i=0u; i<instances->size(); ++i)
+        {
+            auto  instance = instances->Get(i);
+            auto& dst      = Instances[i];
+            dst.HashTag       = tags->Get(i);
+            dst.MeshIndex     = instance->MeshIndex();
+            dst.MaterialIndex = instance->MaterialIndex();
+            dst.Hash          = XXH3_64bits(&instance->Transform(), sizeof(Matrix3x4));
+        }
+    }
+
+    if (resScene->Lights() != nullptr)
+    {
+        auto lights = resScene->Lights();
+        auto tags   = resScene->LightTags();
+        if (lights->size() > Lights.size() || tags == nullptr || tags->size() != lights->size())
+        { return false; }
+
+        for(auto i=0u; i<lights->size(); ++i)
+        {
+            Lights[i].HashTag = tags->Get(i);
+            Lights[i].Hash    = XXH3_64bits(lights->Get(i), sizeof(ResLight));
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      シーンファイルを展開してダイジェストを作成します.
+//-----------------------------------------------------------------------------
+bool LoadSceneDigest(const char* path, SceneDigest& result)
+{
+    SceneContainer container;
+    if (!container.Init(path))
+    {
+        ELOGA("Error : SceneContainer::Init() Failed. path = %s", path);
+        return false;
+    }
+
+    result.Reset(container.GetHeader());
+
+    auto ret = container.Decode(0, [&](const SceneSection& section)
+    {
+        if (!result.Append(section))
+        {
+            ELOGA("Error : Invalid Scene Section. index = %u", section.Index);
+            return false;
+        }
+
+        container.ReleaseSection(section.Index);
+        return true;
+    });
+
+    if (!ret)
+    {
+        ELOGA("Error : SceneContainer::Decode() Failed. path = %s", path);
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      2つのシーンの差分を求めます.
+//-----------------------------------------------------------------------------
+void DiffScene(const SceneDigest& prev, const SceneDigest& next, SceneDiff& result)
+{
+    result = SceneDiff();
+
+    if (prev.IblHash != next.IblHash)
+    {
+        SetRebuild(result, "ibl changed");
+        return;
+    }
+
+    // テクスチャはディスクリプタ番号をマテリアルが参照しているので作り直す.
+    if (prev.Textures != next.Textures)
+    {
+        SetRebuild(result, "texture changed");
+        return;
+    }
+
+    // メッシュ. バッファサイズが同じなら書き換えてBLASを再構築できる.
+    if (prev.Meshes.size() != next.Meshes.size())
+    {
+        SetRebuild(result, "mesh count changed");
+        return;
+    }
+
+    for(auto i=0u; i<prev.Meshes.size(); ++i)
+    {
+        auto& a = prev.Meshes[i];
+        auto& b = next.Meshes[i];
+
+        if (a.VertexCount != b.VertexCount || a.IndexCount != b.IndexCount)
+        {
+            SetRebuild(result, "mesh size changed");
+            return;
+        }
+
+        if (a.Hash != b.Hash)
+        { result.Meshes.push_back(i); }
+    }
+
+    // マテリアル.
+    if (prev.Materials.size() != next.Materials.size())
+    {
+        SetRebuild(result, "material count changed");
+        return;
+    }
+
+    for(auto i=0u; i<prev.Materials.size(); ++i)
+    {
+        if (prev.Materials[i] != next.Materials[i])
+        { AddRange(result.Materials, i, i); }
+    }
+
+    // インスタンス. 描画コールとTLASの並びは読み込み済みシーンの順番を保つ.
+    std::unordered_map<uint32_t, uint32_t> tagMap;
+    if (prev.Instances.size() != next.Instances.size())
+    {
+        SetRebuild(result, "instance count changed");
+        return;
+    }
+
+    if (!BuildTagMap(next.Instances, tagMap))
+    {
+        SetRebuild(result, "instance tag duplicated");
+        return;
+    }
+
+    for(auto i=0u; i<prev.Instances.size(); ++i)
+    {
+        auto& a   = prev.Instances[i];
+        auto  itr = tagMap.find(a.HashTag);
+        if (itr == tagMap.end())
+        {
+            SetRebuild(result, "instance tag changed");
+            return;
+        }
+
+        auto& b = next.Instances[itr->second];
+        if (a.MeshIndex != b.MeshIndex)
+        {
+            SetRebuild(result, "instance mesh changed");
+            return;
+        }
+
+        if (a.Hash != b.Hash || a.MaterialIndex != b.MaterialIndex)
+        { AddRange(result.Instances, i, itr->second); }
+    }
+
+    // ライト.
+    if (prev.Lights.size() != next.Lights.size())
+    {
+        SetRebuild(result, "light count changed");
+        return;
+    }
+
+    if (!BuildTagMap(next.Lights, tagMap))
+    {
+        SetRebuild(result, "light tag duplicated");
+        return;
+    }
+
+    for(auto i=0u; i<prev.Lights.size(); ++i)
+    {
+        auto& a   = prev.Lights[i];
+        auto  itr = tagMap.find(a.HashTag);
+        if (itr == tagMap.end())
+        {
+            SetRebuild(result, "light tag changed");
+            return;
+        }
+
+        if (a.Hash != next.Lights[itr->second].Hash)
+        { AddRange(result.Lights, i, itr->second); }
+    }
+}
+
+} // namespace r3d
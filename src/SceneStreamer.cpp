@@ -0,0 +1,323 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneStreamer.cpp
+// Desc : Asynchronous Scene Streamer.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <SceneStreamer.h>
+#include <Platform.h>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      アップロードの優先度を取得します (小さいほど先).
+//-----------------------------------------------------------------------------
+uint32_t GetPriority(r3d::SCENE_SECTION_TYPE type)
+{
+    switch(type)
+    {
+    case r3d::SCENE_SECTION_TYPE_IBL:       return 0;   // 背景として最初に表示できる.
+    case r3d::SCENE_SECTION_TYPE_SCENE:     return 0;
+    case r3d::SCENE_SECTION_TYPE_LIGHTS:    return 1;   // 小さいので描画に必要なものから先に流す.
+    case r3d::SCENE_SECTION_TYPE_MESHES:    return 2;   // インスタンスが全メッシュを待つので先に流す.
+    case r3d::SCENE_SECTION_TYPE_INSTANCES: return 3;   // テクスチャより先に形状だけを表示できる.
+    case r3d::SCENE_SECTION_TYPE_TEXTURES:  return 4;
+    case r3d::SCENE_SECTION_TYPE_MATERIALS: return 5;
+    }
+
+    return UINT32_MAX;
+}
+
+} // namespace
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneStreamer class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+SceneStreamer::~SceneStreamer()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      読み込みを開始します.
+//-----------------------------------------------------------------------------
+bool SceneStreamer::Start(const char* path, uint32_t threadCount)
+{
+    Term();
+
+    if (!m_Container.Init(path))
+    {
+        ELOGA("Error : SceneContainer::Init() Failed. path = %s", path);
+        return false;
+    }
+
+    for(auto& entry : m_Container.GetEntries())
+    { m_TotalBytes += entry.RawSize; }
+
+    m_Header       = m_Container.GetHeader();
+    m_SectionCount = uint32_t(m_Container.GetEntries().size());
+
+    m_State = SCENE_STREAM_STATE_LOADING;
+
+    // 読み込みスレッド. 展開はさらにワーカースレッドに分散される.
+    m_Thread = std::thread([this, threadCount]()
+    {
+        auto result = m_Container.Decode(threadCount, [this](const SceneSection& section)
+        {
+            if (m_Cancel)
+            { return false; }
+
+            {
+                std::lock_guard<std::mutex> locker(m_Mutex);
+                m_Decoded.push_back(section);
+                m_DecodedCount++;
+            }
+
+            m_Cond.notify_all();
+            return true;
+        });
+
+        {
+            std::lock_guard<std::mutex> locker(m_Mutex);
+            m_DecodeDone   = true;
+            m_DecodeFailed = !result && !m_Cancel;
+        }
+
+        m_Cond.notify_all();
+    });
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      読み込みを中断して終了処理を行います.
+//-----------------------------------------------------------------------------
+void SceneStreamer::Term()
+{
+    Close();
+
+    m_Header        = {};
+    m_SectionCount  = 0;
+    m_DecodeDone    = false;
+    m_DecodeFailed  = false;
+    m_Cancel        = false;
+    m_State         = SCENE_STREAM_STATE_IDLE;
+    m_DecodedCount  = 0;
+    m_UploadedCount = 0;
+    m_TotalBytes    = 0;
+    m_UploadedBytes = 0;
+    m_NextMesh      = 0;
+    m_TextureCount  = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      展開済みのセクションをアップロードします.
+//-----------------------------------------------------------------------------
+SCENE_STREAM_STATE SceneStreamer::Update(ISceneUploader* pUploader, uint64_t budget, bool wait)
+{
+    if (m_State != SCENE_STREAM_STATE_LOADING)
+    { return m_State; }
+
+    if (pUploader == nullptr)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return m_State;
+    }
+
+    uint64_t spent    = 0;
+    bool     uploaded = false;
+
+    for(;;)
+    {
+        bool decodeDone   = false;
+        bool decodeFailed = false;
+        {
+            std::lock_guard<std::mutex> locker(m_Mutex);
+            m_Pending.insert(m_Pending.end(), m_Decoded.begin(), m_Decoded.end());
+            m_Decoded.clear();
+            decodeDone   = m_DecodeDone;
+            decodeFailed = m_DecodeFailed;
+        }
+
+        if (decodeFailed)
+        {
+            ELOGA("Error : Scene Section Decode Failed.");
+            Close();
+            m_State = SCENE_STREAM_STATE_FAILED;
+            return m_State;
+        }
+
+        // 依存関係を満たしたセクションを予算内でアップロード.
+        auto index = FindNext();
+        while(index != SIZE_MAX)
+        {
+            auto section = m_Pending[index];
+            auto cost    = m_Container.GetEntries()[section.Index].RawSize;
+            if (uploaded && spent + cost > budget)
+            { return m_State; }
+
+            m_Pending.erase(m_Pending.begin() + index);
+
+            if (!pUploader->Upload(section))
+            {
+                ELOGA("Error : Scene Section Upload Failed. index = %u", section.Index);
+                Close();
+                m_State = SCENE_STREAM_STATE_FAILED;
+                return m_State;
+            }
+
+            m_Container.ReleaseSection(section.Index);
+            OnUploaded(section);
+
+            spent   += cost;
+            uploaded = true;
+            index    = FindNext();
+        }
+
+        if (m_UploadedCount == m_SectionCount)
+        {
+            // 全て GPU に送ったのでファイルは不要. マッピングしたままだと
+            // Windows では上書きできず, POSIX では切り詰められた時に SIGBUS になる.
+            Close();
+            m_State = SCENE_STREAM_STATE_COMPLETED;
+            return m_State;
+        }
+
+        // 全て展開済みなのに進めない場合はデータが欠けている.
+        if (decodeDone)
+        {
+            ELOGA("Error : Scene Section Missing. mesh = %u, texture = %u", m_NextMesh, m_TextureCount);
+            Close();
+            m_State = SCENE_STREAM_STATE_FAILED;
+            return m_State;
+        }
+
+        if (!wait)
+        { return m_State; }
+
+        std::unique_lock<std::mutex> locker(m_Mutex);
+        m_Cond.wait(locker, [&]() { return !m_Decoded.empty() || m_DecodeDone; });
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      進捗を取得します.
+//-----------------------------------------------------------------------------
+SceneStreamProgress SceneStreamer::GetProgress() const
+{
+    SceneStreamProgress result = {};
+    result.SectionCount  = m_SectionCount;
+    result.UploadedCount = m_UploadedCount;
+    result.TotalBytes    = m_TotalBytes;
+    result.UploadedBytes = m_UploadedBytes;
+
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        result.DecodedCount = m_DecodedCount;
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      依存するセクションがアップロード済みかどうか?
+//-----------------------------------------------------------------------------
+bool SceneStreamer::IsUploadable(const SceneSection& section) const
+{
+    auto& header = m_Header;
+
+    switch(section.Type)
+    {
+    case SCENE_SECTION_TYPE_MESHES:
+        return section.FirstIndex == m_NextMesh;
+
+    case SCENE_SECTION_TYPE_MATERIALS:
+        return m_TextureCount == header.TextureCount;
+
+    case SCENE_SECTION_TYPE_INSTANCES:
+        return m_NextMesh == header.MeshCount;
+
+    default:
+        return true;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      次にアップロードするセクションを検索します.
+//-----------------------------------------------------------------------------
+size_t SceneStreamer::FindNext() const
+{
+    auto result   = SIZE_MAX;
+    auto priority = UINT32_MAX;
+
+    for(size_t i=0; i<m_Pending.size(); ++i)
+    {
+        if (!IsUploadable(m_Pending[i]))
+        { continue; }
+
+        auto value = GetPriority(m_Pending[i].Type);
+        if (value < priority)
+        {
+            result   = i;
+            priority = value;
+        }
+    }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      アップロード済みの状態を更新します.
+//-----------------------------------------------------------------------------
+void SceneStreamer::OnUploaded(const SceneSection& section)
+{
+    auto& header = m_Header;
+
+    m_UploadedCount++;
+    m_UploadedBytes += m_Container.GetEntries()[section.Index].RawSize;
+
+    switch(section.Type)
+    {
+    case SCENE_SECTION_TYPE_MESHES:
+        m_NextMesh = section.FirstIndex + section.Count;
+        break;
+
+    case SCENE_SECTION_TYPE_TEXTURES:
+        m_TextureCount += section.Count;
+        break;
+
+    case SCENE_SECTION_TYPE_SCENE:
+        m_NextMesh     = header.MeshCount;
+        m_TextureCount = header.TextureCount;
+        break;
+
+    default:
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      展開を止めてファイルを閉じます.
+//-----------------------------------------------------------------------------
+void SceneStreamer::Close()
+{
+    m_Cancel = true;
+    if (m_Thread.joinable())
+    { m_Thread.join(); }
+
+    // 展開済みのセクションはコンテナのメモリを指しているので一緒に捨てる.
+    m_Decoded.clear();
+    m_Pending.clear();
+    m_Container.Term();
+}
+
+} // namespace r3d
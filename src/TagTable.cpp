@@ -0,0 +1,237 @@
+﻿//-----------------------------------------------------------------------------
+// File : TagTable.cpp
+// Desc : Minimal Perfect Hash Table for Hash Tags.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TagTable.h>
+#include <algorithm>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const int32_t MAX_SEED = INT32_MAX;
+
+//-----------------------------------------------------------------------------
+//      シード付きでハッシュタグを攪拌します.
+//-----------------------------------------------------------------------------
+inline uint32_t MixTag(uint32_t tag, uint32_t seed)
+{
+    // murmur3 の fmix32.
+    auto h = tag ^ (seed * 0x9E3779B1u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+//-----------------------------------------------------------------------------
+//      [0, count) の範囲に縮約します.
+//-----------------------------------------------------------------------------
+inline uint32_t Reduce(uint32_t hash, uint32_t count)
+{ return uint32_t((uint64_t(hash) * count) >> 32); }
+
+//-----------------------------------------------------------------------------
+//      スロット番号を求めます.
+//-----------------------------------------------------------------------------
+inline uint32_t FindSlot(const int32_t* seeds, uint32_t count, uint32_t tag)
+{
+    auto seed = seeds[Reduce(MixTag(tag, 0), count)];
+    if (seed < 0)
+    { return uint32_t(-seed - 1); }
+
+    return Reduce(MixTag(tag, uint32_t(seed)), count);
+}
+
+} // namespace
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//      ハッシュタグの最小完全ハッシュ表を構築します.
+//-----------------------------------------------------------------------------
+bool BuildTagTable
+(
+    const uint32_t*             tags,
+    uint32_t                    count,
+    std::vector<int32_t>&       seeds,
+    std::vector<ResTagSlot>&    slots
+)
+{
+    seeds.clear();
+    slots.clear();
+
+    if (count == 0)
+    { return true; }
+
+    // バケットに振り分け.
+    std::vector<std::vector<uint32_t>> buckets(count);
+    for(auto i=0u; i<count; ++i)
+    { buckets[Reduce(MixTag(tags[i], 0), count)].push_back(i); }
+
+    // 要素数の多いバケットから配置する.
+    std::vector<uint32_t> order(count);
+    for(auto i=0u; i<count; ++i)
+    { order[i] = i; }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t lhs, uint32_t rhs)
+    { return buckets[lhs].size() > buckets[rhs].size(); });
+
+    seeds.assign(count, 0);
+    slots.assign(count, ResTagSlot());
+
+    std::vector<bool>     used(count, false);
+    std::vector<uint32_t> candidates;
+
+    size_t pos = 0;
+    for(; pos<order.size(); ++pos)
+    {
+        auto& bucket = buckets[order[pos]];
+        if (bucket.size() <= 1)
+        { break; }
+
+        // 同じバケット内で重複していたら表は作れない.
+        for(size_t i=0; i<bucket.size(); ++i)
+        {
+            for(size_t j=i+1; j<bucket.size(); ++j)
+            {
+                if (tags[bucket[i]] == tags[bucket[j]])
+                { return false; }
+            }
+        }
+
+        // 全要素が空きスロットに入るシードを探索.
+        auto seed = 1;
+        for(; seed<MAX_SEED; ++seed)
+        {
+            candidates.clear();
+
+            auto found = true;
+            for(auto idx : bucket)
+            {
+                auto slot = Reduce(MixTag(tags[idx], uint32_t(seed)), count);
+                if (used[slot] || std::find(candidates.begin(), candidates.end(), slot) != candidates.end())
+                {
+                    found = false;
+                    break;
+                }
+                candidates.push_back(slot);
+            }
+
+            if (found)
+            { break; }
+        }
+
+        if (seed == MAX_SEED)
+        { return false; }
+
+        seeds[order[pos]] = seed;
+        for(size_t i=0; i<bucket.size(); ++i)
+        {
+            used [candidates[i]] = true;
+            slots[candidates[i]] = ResTagSlot(tags[bucket[i]], bucket[i]);
+        }
+    }
+
+    // 要素が1つのバケットは空きスロットを直接指す.
+    auto freeSlot = 0u;
+    for(; pos<order.size(); ++pos)
+    {
+        auto& bucket = buckets[order[pos]];
+        if (bucket.empty())
+        { break; }
+
+        while(used[freeSlot])
+        { freeSlot++; }
+
+        used [freeSlot] = true;
+        seeds[order[pos]] = -int32_t(freeSlot) - 1;
+        slots[freeSlot]   = ResTagSlot(tags[bucket[0]], bucket[0]);
+    }
+
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// TagTable class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      シーンファイルに格納された表を参照します.
+//-----------------------------------------------------------------------------
+bool TagTable::Init(const flatbuffers::Vector<int32_t>* seeds, const flatbuffers::Vector<const ResTagSlot*>* slots)
+{
+    Term();
+
+    if (seeds == nullptr || slots == nullptr || seeds->size() != slots->size())
+    { return false; }
+
+    auto count = slots->size();
+    for(auto i=0u; i<count; ++i)
+    {
+        auto seed = seeds->Get(i);
+        if (seed < 0 && uint32_t(-(seed + 1)) >= count)
+        { return false; }
+
+        if (slots->Get(i)->Index() >= count)
+        { return false; }
+    }
+
+    m_pSeeds = seeds->data();
+    m_pSlots = reinterpret_cast<const ResTagSlot*>(slots->Data());
+    m_Count  = count;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ハッシュタグから表を構築します.
+//-----------------------------------------------------------------------------
+bool TagTable::Init(const uint32_t* tags, uint32_t count)
+{
+    Term();
+
+    if (!BuildTagTable(tags, count, m_Seeds, m_Slots))
+    {
+        Term();
+        return false;
+    }
+
+    m_pSeeds = m_Seeds.data();
+    m_pSlots = m_Slots.data();
+    m_Count  = count;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void TagTable::Term()
+{
+    m_pSeeds = nullptr;
+    m_pSlots = nullptr;
+    m_Count  = 0;
+    m_Seeds.clear();
+    m_Slots.clear();
+}
+
+//-----------------------------------------------------------------------------
+//      ハッシュタグに対応する要素番号を検索します.
+//-----------------------------------------------------------------------------
+uint32_t TagTable::Find(uint32_t hashTag) const
+{
+    if (m_Count == 0)
+    { return UINT32_MAX; }
+
+    auto& slot = m_pSlots[FindSlot(m_pSeeds, m_Count, hashTag)];
+    return (slot.Tag() == hashTag) ? slot.Index() : UINT32_MAX;
+}
+
+} // namespace r3d
@@ -0,0 +1,283 @@
+﻿//-----------------------------------------------------------------------------
+// File : TextureFootprint.cpp
+// Desc : Texture Upload Footprint.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <TextureFootprint.h>
+#include <algorithm>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t TEXTURE_DIMENSION_3D      = 3;
+static const uint32_t FORMAT_R8G8_B8G8_UNORM    = 68;
+static const uint32_t FORMAT_G8R8_G8B8_UNORM    = 69;
+
+//-----------------------------------------------------------------------------
+//      アラインメントを揃えます.
+//-----------------------------------------------------------------------------
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{ return (value + alignment - 1) & ~(alignment - 1); }
+
+} // namespace
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//      DXGI_FORMAT のビット数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t GetBitsPerPixel(uint32_t format)
+{
+    if (1 <= format && format <= 4)
+    { return 128; }
+    if (5 <= format && format <= 8)
+    { return 96; }
+    if (9 <= format && format <= 22)
+    { return 64; }
+    if ((23 <= format && format <= 47) || (67 <= format && format <= 69) || (87 <= format && format <= 93))
+    { return 32; }
+    if ((48 <= format && format <= 59) || format == 85 || format == 86 || format == 115)
+    { return 16; }
+    if (60 <= format && format <= 65)
+    { return 8; }
+    if (format == 66)
+    { return 1; }
+    if ((70 <= format && format <= 72) || (79 <= format && format <= 81))
+    { return 4; }
+    if ((73 <= format && format <= 78) || (82 <= format && format <= 84) || (94 <= format && format <= 99))
+    { return 8; }
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+//      DXGI_FORMAT の名前を取得します.
+//-----------------------------------------------------------------------------
+const char* GetFormatName(uint32_t format)
+{
+    static const char* kNames[] = {
+        "UNKNOWN",
+        "R32G32B32A32_TYPELESS",
+        "R32G32B32A32_FLOAT",
+        "R32G32B32A32_UINT",
+        "R32G32B32A32_SINT",
+        "R32G32B32_TYPELESS",
+        "R32G32B32_FLOAT",
+        "R32G32B32_UINT",
+        "R32G32B32_SINT",
+        "R16G16B16A16_TYPELESS",
+        "R16G16B16A16_FLOAT",
+        "R16G16B16A16_UNORM",
+        "R16G16B16A16_UINT",
+        "R16G16B16A16_SNORM",
+        "R16G16B16A16_SINT",
+        "R32G32_TYPELESS",
+        "R32G32_FLOAT",
+        "R32G32_UINT",
+        "R32G32_SINT",
+        "R32G8X24_TYPELESS",
+        "D32_FLOAT_S8X24_UINT",
+        "R32_FLOAT_X8X24_TYPELESS",
+        "X32_TYPELESS_G8X24_UINT",
+        "R10G10B10A2_TYPELESS",
+        "R10G10B10A2_UNORM",
+        "R10G10B10A2_UINT",
+        "R11G11B10_FLOAT",
+        "R8G8B8A8_TYPELESS",
+        "R8G8B8A8_UNORM",
+        "R8G8B8A8_UNORM_SRGB",
+        "R8G8B8A8_UINT",
+        "R8G8B8A8_SNORM",
+        "R8G8B8A8_SINT",
+        "R16G16_TYPELESS",
+        "R16G16_FLOAT",
+        "R16G16_UNORM",
+        "R16G16_UINT",
+        "R16G16_SNORM",
+        "R16G16_SINT",
+        "R32_TYPELESS",
+        "D32_FLOAT",
+        "R32_FLOAT",
+        "R32_UINT",
+        "R32_SINT",
+        "R24G8_TYPELESS",
+        "D24_UNORM_S8_UINT",
+        "R24_UNORM_X8_TYPELESS",
+        "X24_TYPELESS_G8_UINT",
+        "R8G8_TYPELESS",
+        "R8G8_UNORM",
+        "R8G8_UINT",
+        "R8G8_SNORM",
+        "R8G8_SINT",
+        "R16_TYPELESS",
+        "R16_FLOAT",
+        "D16_UNORM",
+        "R16_UNORM",
+        "R16_UINT",
+        "R16_SNORM",
+        "R16_SINT",
+        "R8_TYPELESS",
+        "R8_UNORM",
+        "R8_UINT",
+        "R8_SNORM",
+        "R8_SINT",
+        "A8_UNORM",
+        "R1_UNORM",
+        "R9G9B9E5_SHAREDEXP",
+        "R8G8_B8G8_UNORM",
+        "G8R8_G8B8_UNORM",
+        "BC1_TYPELESS",
+        "BC1_UNORM",
+        "BC1_UNORM_SRGB",
+        "BC2_TYPELESS",
+        "BC2_UNORM",
+        "BC2_UNORM_SRGB",
+        "BC3_TYPELESS",
+        "BC3_UNORM",
+        "BC3_UNORM_SRGB",
+        "BC4_TYPELESS",
+        "BC4_UNORM",
+        "BC4_SNORM",
+        "BC5_TYPELESS",
+        "BC5_UNORM",
+        "BC5_SNORM",
+        "B5G6R5_UNORM",
+        "B5G5R5A1_UNORM",
+        "B8G8R8A8_UNORM",
+        "B8G8R8X8_UNORM",
+        "R10G10B10_XR_BIAS_A2_UNORM",
+        "B8G8R8A8_TYPELESS",
+        "B8G8R8A8_UNORM_SRGB",
+        "B8G8R8X8_TYPELESS",
+        "B8G8R8X8_UNORM_SRGB",
+        "BC6H_TYPELESS",
+        "BC6H_UF16",
+        "BC6H_SF16",
+        "BC7_TYPELESS",
+        "BC7_UNORM",
+        "BC7_UNORM_SRGB",
+        "AYUV",
+        "Y410",
+        "Y416",
+        "NV12",
+        "P010",
+        "P016",
+        "420_OPAQUE",
+        "YUY2",
+        "Y210",
+        "Y216",
+        "NV11",
+        "AI44",
+        "IA44",
+        "P8",
+        "A8P8",
+        "B4G4R4A4_UNORM",
+    };
+
+    if (format >= sizeof(kNames) / sizeof(kNames[0]))
+    { return kNames[0]; }
+
+    return kNames[format];
+}
+
+//-----------------------------------------------------------------------------
+//      ブロック圧縮フォーマットかどうかチェックします.
+//-----------------------------------------------------------------------------
+bool IsBlockCompressed(uint32_t format)
+{ return (70 <= format && format <= 84) || (94 <= format && format <= 99); }
+
+//-----------------------------------------------------------------------------
+//      アップロードバッファ上のサブリソース配置を計算します.
+//-----------------------------------------------------------------------------
+bool CalcTextureFootprints
+(
+    uint32_t                        dimension,
+    uint32_t                        width,
+    uint32_t                        height,
+    uint32_t                        depth,
+    uint32_t                        format,
+    uint32_t                        mipLevels,
+    uint32_t                        surfaceCount,
+    std::vector<TextureFootprint>&  result,
+    uint64_t&                       totalSize
+)
+{
+    result.clear();
+    totalSize = 0;
+
+    auto bpp = GetBitsPerPixel(format);
+    if (bpp == 0 || width == 0 || height == 0 || depth == 0 || mipLevels == 0 || surfaceCount == 0)
+    { return false; }
+
+    // 1ブロックあたりのピクセル数とバイト数.
+    auto blockW     = 1u;
+    auto blockH     = 1u;
+    auto blockBytes = 0u;
+    if (IsBlockCompressed(format))
+    {
+        blockW     = 4;
+        blockH     = 4;
+        blockBytes = (bpp == 4) ? 8u : 16u;
+    }
+    else if (format == FORMAT_R8G8_B8G8_UNORM || format == FORMAT_G8R8_G8B8_UNORM)
+    {
+        blockW     = 2;
+        blockBytes = 4;
+    }
+
+    result.resize(size_t(surfaceCount) * mipLevels);
+
+    uint64_t offset = 0;
+    auto idx = 0u;
+    for(auto i=0u; i<surfaceCount; ++i)
+    {
+        auto w = width;
+        auto h = height;
+        auto d = (dimension == TEXTURE_DIMENSION_3D) ? depth : 1u;
+
+        for(auto m=0u; m<mipLevels; ++m)
+        {
+            auto countW = (w + blockW - 1) / blockW;
+            auto countH = (h + blockH - 1) / blockH;
+
+            auto rowSize = (blockBytes > 0)
+                ? uint64_t(countW) * blockBytes
+                : (uint64_t(w) * bpp + 7) / 8;
+
+            auto rowPitch = AlignUp(rowSize, TEXTURE_DATA_PITCH_ALIGNMENT);
+            if (rowPitch > UINT32_MAX)
+            { return false; }
+
+            offset = AlignUp(offset, TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+
+            auto& footprint = result[idx++];
+            footprint.Offset    = offset;
+            footprint.Width     = countW * blockW;
+            footprint.Height    = countH * blockH;
+            footprint.Depth     = d;
+            footprint.RowPitch  = uint32_t(rowPitch);
+            footprint.RowCount  = countH;
+            footprint.RowSize   = uint32_t(rowSize);
+
+            // 最終行はパディング不要.
+            totalSize = offset + rowPitch * (uint64_t(countH) * d - 1) + rowSize;
+            offset   += rowPitch * countH * d;
+
+            w = std::max(1u, w >> 1);
+            h = std::max(1u, h >> 1);
+            d = std::max(1u, d >> 1);
+        }
+    }
+
+    return true;
+}
+
+} // namespace r3d
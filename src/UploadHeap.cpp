@@ -0,0 +1,186 @@
+﻿//-----------------------------------------------------------------------------
+// File : UploadHeap.cpp
+// Desc : Persistent Upload Heap.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <UploadHeap.h>
+#include <gfx/asdxDevice.h>
+#include <gfx/asdxRayTracing.h>
+#include <fnd/asdxLogger.h>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadHeap class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool UploadHeap::Init(uint64_t size)
+{
+    Term();
+
+    if (!m_Ring.Init(size))
+    {
+        ELOGA("Error : UploadRing::Init() Failed.");
+        return false;
+    }
+
+    if (!asdx::CreateUploadBuffer(asdx::GetD3D12Device(), size, &m_pBuffer))
+    {
+        ELOGA("Error : CreateUploadBuffer() Failed.");
+        return false;
+    }
+
+    m_pBuffer->SetName(L"UploadHeap");
+
+    // 永続的にマップしておく.
+    auto hr = m_pBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_pData));
+    if (FAILED(hr))
+    {
+        ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
+        Term();
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void UploadHeap::Term()
+{
+    if (m_pBuffer != nullptr)
+    {
+        if (m_pData != nullptr)
+        { m_pBuffer->Unmap(0, nullptr); }
+
+        // 記録済みのコピーが終わってから破棄される.
+        asdx::Dispose(m_pBuffer);
+        m_pBuffer = nullptr;
+    }
+
+    m_pData         = nullptr;
+    m_pFence        = nullptr;
+    m_FallbackCount = 0;
+    m_Barriers.clear();
+    m_Ring.Term();
+}
+
+//-----------------------------------------------------------------------------
+//      アップロード領域を割り当てます.
+//-----------------------------------------------------------------------------
+bool UploadHeap::Alloc(uint64_t size, uint64_t alignment, UploadRegion& result)
+{
+    if (m_pBuffer == nullptr)
+    { return AllocFallback(size, result); }
+
+    if (m_pFence != nullptr)
+    { m_Ring.Retire(m_pFence->GetCompletedValue()); }
+
+    uint64_t offset = 0;
+    auto ret = m_Ring.Alloc(size, alignment, offset);
+
+    // サブミット済みのコピーが終われば空く場合は待つ.
+    uint64_t fenceValue = 0;
+    if (!ret && m_pFence != nullptr && m_Ring.FindStallFence(size, alignment, fenceValue))
+    {
+        if (m_pFence->GetCompletedValue() < fenceValue)
+        { m_pFence->SetEventOnCompletion(fenceValue, nullptr); }
+
+        m_Ring.Stall(fenceValue);
+        ret = m_Ring.Alloc(size, alignment, offset);
+    }
+
+    // 容量を超える要求や，同じコマンドリスト内で使い切った場合.
+    if (!ret)
+    { return AllocFallback(size, result); }
+
+    result.pResource = m_pBuffer;
+    result.Offset    = offset;
+    result.pData     = m_pData + offset;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      コピー完了後に発行するリソースバリアを追加します.
+//-----------------------------------------------------------------------------
+void UploadHeap::AddBarrier(const D3D12_RESOURCE_BARRIER& barrier)
+{ m_Barriers.push_back(barrier); }
+
+//-----------------------------------------------------------------------------
+//      溜めたリソースバリアをまとめて発行します.
+//-----------------------------------------------------------------------------
+void UploadHeap::FlushBarriers(ID3D12GraphicsCommandList6* pCmdList)
+{
+    if (m_Barriers.empty())
+    { return; }
+
+    pCmdList->ResourceBarrier(UINT(m_Barriers.size()), m_Barriers.data());
+    m_Barriers.clear();
+}
+
+//-----------------------------------------------------------------------------
+//      コピーコマンドを含むサブミットの待機点を設定します.
+//-----------------------------------------------------------------------------
+void UploadHeap::Submit(const asdx::WaitPoint& waitPoint)
+{
+    if (!waitPoint.IsValid())
+    { return; }
+
+    m_pFence = waitPoint.pFence;
+    m_Ring.Submit(waitPoint.FenceValue);
+    m_Ring.Retire(m_pFence->GetCompletedValue());
+}
+
+//-----------------------------------------------------------------------------
+//      統計情報を取得します.
+//-----------------------------------------------------------------------------
+const UploadRingStats& UploadHeap::GetStats() const
+{ return m_Ring.GetStats(); }
+
+//-----------------------------------------------------------------------------
+//      単発バッファにフォールバックした回数を取得します.
+//-----------------------------------------------------------------------------
+uint64_t UploadHeap::GetFallbackCount() const
+{ return m_FallbackCount; }
+
+//-----------------------------------------------------------------------------
+//      単発のアップロードバッファを割り当てます.
+//-----------------------------------------------------------------------------
+bool UploadHeap::AllocFallback(uint64_t size, UploadRegion& result)
+{
+    ID3D12Resource* pResource = nullptr;
+    if (!asdx::CreateUploadBuffer(asdx::GetD3D12Device(), size, &pResource))
+    {
+        ELOGA("Error : CreateUploadBuffer() Failed.");
+        return false;
+    }
+
+    uint8_t* pData = nullptr;
+    auto hr = pResource->Map(0, nullptr, reinterpret_cast<void**>(&pData));
+    if (FAILED(hr))
+    {
+        ELOGA("Error : ID3D12Resource::Map() Failed. errcode = 0x%x", hr);
+        pResource->Release();
+        return false;
+    }
+
+    result.pResource = pResource;
+    result.Offset    = 0;
+    result.pData     = pData;
+
+    // 破棄は数フレーム遅延されるので記録するコピーには間に合う.
+    asdx::Dispose(pResource);
+    m_FallbackCount++;
+    return true;
+}
+
+} // namespace r3d
@@ -0,0 +1,173 @@
+﻿//-----------------------------------------------------------------------------
+// File : UploadRing.cpp
+// Desc : Fence Tracked Ring Allocator.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <UploadRing.h>
+#include <cassert>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// UploadRing class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool UploadRing::Init(uint64_t capacity)
+{
+    Term();
+
+    if (capacity == 0)
+    { return false; }
+
+    m_Capacity = capacity;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void UploadRing::Term()
+{
+    m_Capacity  = 0;
+    m_Head      = 0;
+    m_Tail      = 0;
+    m_Submitted = 0;
+    m_Submissions.clear();
+    m_Stats = UploadRingStats();
+}
+
+//-----------------------------------------------------------------------------
+//      領域を割り当てます.
+//-----------------------------------------------------------------------------
+bool UploadRing::Alloc(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    if (size > m_Capacity)
+    {
+        m_Stats.OversizeCount++;
+        return false;
+    }
+
+    uint64_t begin = 0;
+    if (!Place(m_Tail, size, alignment, begin))
+    {
+        m_Stats.FullCount++;
+        return false;
+    }
+
+    if (begin / m_Capacity != m_Head / m_Capacity)
+    { m_Stats.WrapCount++; }
+
+    m_Stats.AllocCount++;
+    m_Stats.AllocSize   += size;
+    m_Stats.PaddingSize += begin - m_Head;
+
+    offset = begin % m_Capacity;
+    m_Head = begin + size;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      前回のサブミット以降の割り当てをフェンス値に紐づけます.
+//-----------------------------------------------------------------------------
+void UploadRing::Submit(uint64_t fenceValue)
+{
+    if (m_Head == m_Submitted)
+    { return; }
+
+    Submission item = {};
+    item.FenceValue = fenceValue;
+    item.End        = m_Head;
+    m_Submissions.push_back(item);
+
+    m_Submitted = m_Head;
+}
+
+//-----------------------------------------------------------------------------
+//      完了したサブミットの領域を回収します.
+//-----------------------------------------------------------------------------
+void UploadRing::Retire(uint64_t completedValue)
+{
+    while(!m_Submissions.empty() && m_Submissions.front().FenceValue <= completedValue)
+    {
+        m_Tail = m_Submissions.front().End;
+        m_Submissions.pop_front();
+        m_Stats.RetireCount++;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      フェンスを待った後に領域を回収します.
+//-----------------------------------------------------------------------------
+void UploadRing::Stall(uint64_t fenceValue)
+{
+    m_Stats.StallCount++;
+    Retire(fenceValue);
+}
+
+//-----------------------------------------------------------------------------
+//      指定サイズを割り当てるために待つべきフェンス値を求めます.
+//-----------------------------------------------------------------------------
+bool UploadRing::FindStallFence(uint64_t size, uint64_t alignment, uint64_t& fenceValue) const
+{
+    if (size > m_Capacity)
+    { return false; }
+
+    // 古いサブミットから順に回収したと仮定して収まるかを調べる.
+    uint64_t begin = 0;
+    for(auto& item : m_Submissions)
+    {
+        if (Place(item.End, size, alignment, begin))
+        {
+            fenceValue = item.FenceValue;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+//      容量を取得します.
+//-----------------------------------------------------------------------------
+uint64_t UploadRing::GetCapacity() const
+{ return m_Capacity; }
+
+//-----------------------------------------------------------------------------
+//      使用中のサイズを取得します.
+//-----------------------------------------------------------------------------
+uint64_t UploadRing::GetUsedSize() const
+{ return m_Head - m_Tail; }
+
+//-----------------------------------------------------------------------------
+//      統計情報を取得します.
+//-----------------------------------------------------------------------------
+const UploadRingStats& UploadRing::GetStats() const
+{ return m_Stats; }
+
+//-----------------------------------------------------------------------------
+//      割り当て位置を求めます.
+//-----------------------------------------------------------------------------
+bool UploadRing::Place(uint64_t tail, uint64_t size, uint64_t alignment, uint64_t& begin) const
+{
+    auto pos     = m_Head % m_Capacity;
+    auto aligned = (pos + alignment - 1) & ~(alignment - 1);
+
+    // 末尾に収まらなければ先頭に折り返す.
+    begin = (aligned + size > m_Capacity)
+        ? m_Head + (m_Capacity - pos)
+        : m_Head + (aligned - pos);
+
+    return (begin + size - tail) <= m_Capacity;
+}
+
+} // namespace r3d
@@ -0,0 +1,505 @@
+﻿//-----------------------------------------------------------------------------
+// File : VideoStream.cpp
+// Desc : Ordered Raw Video Stream Writer.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <VideoStream.h>
+#include <Platform.h>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VIDEO_ENABLE_SSE2   (1)
+#include <emmintrin.h>
+#else
+#define VIDEO_ENABLE_SSE2   (0)
+#endif
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+// BT.709 limited range の変換係数 (8bit 固定小数).
+//  Y  =  16 + ( 47 R + 157 G +  16 B) / 256
+//  Cb = 128 + (-26 R -  87 G + 113 B) / 256
+//  Cr = 128 + (112 R - 102 G -  10 B) / 256
+// 途中結果は 0 ～ 65535 に収まるので, 16bit の符号無し演算で計算できる.
+static const int32_t Y_R        = 47;
+static const int32_t Y_G        = 157;
+static const int32_t Y_B        = 16;
+static const int32_t U_R        = 26;
+static const int32_t U_G        = 87;
+static const int32_t U_B        = 113;
+static const int32_t V_R        = 112;
+static const int32_t V_G        = 102;
+static const int32_t V_B        = 10;
+static const int32_t Y_BIAS     = (16  << 8) + 128;
+static const int32_t UV_BIAS    = (128 << 8) + 128;
+
+static const char    Y4M_FRAME_HEADER[]  = "FRAME\n";
+static const size_t  Y4M_FRAME_HEADER_SIZE = sizeof(Y4M_FRAME_HEADER) - 1;
+
+//-----------------------------------------------------------------------------
+//      輝度を求めます.
+//-----------------------------------------------------------------------------
+inline uint8_t ToY(int32_t r, int32_t g, int32_t b)
+{ return uint8_t((r * Y_R + g * Y_G + b * Y_B + Y_BIAS) >> 8); }
+
+//-----------------------------------------------------------------------------
+//      色差 Cb を求めます.
+//-----------------------------------------------------------------------------
+inline uint8_t ToU(int32_t r, int32_t g, int32_t b)
+{ return uint8_t((b * U_B - r * U_R - g * U_G + UV_BIAS) >> 8); }
+
+//-----------------------------------------------------------------------------
+//      色差 Cr を求めます.
+//-----------------------------------------------------------------------------
+inline uint8_t ToV(int32_t r, int32_t g, int32_t b)
+{ return uint8_t((r * V_R - g * V_G - b * V_B + UV_BIAS) >> 8); }
+
+//-----------------------------------------------------------------------------
+//      1行の輝度をスカラーで求めます.
+//-----------------------------------------------------------------------------
+void ConvertRowY(const uint8_t* pSrc, uint32_t begin, uint32_t end, uint8_t* pY)
+{
+    for(auto x=begin; x<end; ++x)
+    {
+        auto p = pSrc + x * 4;
+        pY[x] = ToY(p[0], p[1], p[2]);
+    }
+}
+
+#if VIDEO_ENABLE_SSE2
+///////////////////////////////////////////////////////////////////////////////
+// Rgb16 structure
+///////////////////////////////////////////////////////////////////////////////
+struct Rgb16
+{
+    __m128i R;
+    __m128i G;
+    __m128i B;
+};
+
+//-----------------------------------------------------------------------------
+//      8画素を 16bit のチャンネルごとに分解します.
+//-----------------------------------------------------------------------------
+inline Rgb16 Unpack8(const uint8_t* p)
+{
+    auto mask = _mm_set1_epi32(0xFF);
+    auto a    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    auto b    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+
+    Rgb16 result;
+    result.R = _mm_packs_epi32(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+    result.G = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 8), mask), _mm_and_si128(_mm_srli_epi32(b, 8), mask));
+    result.B = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a, 16), mask), _mm_and_si128(_mm_srli_epi32(b, 16), mask));
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      16bit の各レーンで輝度を求めます.
+//-----------------------------------------------------------------------------
+inline __m128i ToY16(const Rgb16& c)
+{
+    auto y = _mm_add_epi16(
+        _mm_add_epi16(_mm_mullo_epi16(c.R, _mm_set1_epi16(Y_R)), _mm_mullo_epi16(c.G, _mm_set1_epi16(Y_G))),
+        _mm_add_epi16(_mm_mullo_epi16(c.B, _mm_set1_epi16(Y_B)), _mm_set1_epi16(Y_BIAS)));
+    return _mm_srli_epi16(y, 8);
+}
+
+//-----------------------------------------------------------------------------
+//      16bit の各レーンで色差 Cb を求めます.
+//-----------------------------------------------------------------------------
+inline __m128i ToU16(const Rgb16& c)
+{
+    auto u = _mm_add_epi16(_mm_mullo_epi16(c.B, _mm_set1_epi16(U_B)), _mm_set1_epi16(short(UV_BIAS)));
+    u = _mm_sub_epi16(u, _mm_mullo_epi16(c.R, _mm_set1_epi16(U_R)));
+    u = _mm_sub_epi16(u, _mm_mullo_epi16(c.G, _mm_set1_epi16(U_G)));
+    return _mm_srli_epi16(u, 8);
+}
+
+//-----------------------------------------------------------------------------
+//      16bit の各レーンで色差 Cr を求めます.
+//-----------------------------------------------------------------------------
+inline __m128i ToV16(const Rgb16& c)
+{
+    auto v = _mm_add_epi16(_mm_mullo_epi16(c.R, _mm_set1_epi16(V_R)), _mm_set1_epi16(short(UV_BIAS)));
+    v = _mm_sub_epi16(v, _mm_mullo_epi16(c.G, _mm_set1_epi16(V_G)));
+    v = _mm_sub_epi16(v, _mm_mullo_epi16(c.B, _mm_set1_epi16(V_B)));
+    return _mm_srli_epi16(v, 8);
+}
+
+//-----------------------------------------------------------------------------
+//      16bit の下位 8 レーンを 8bit にして格納します.
+//-----------------------------------------------------------------------------
+inline void Store8(uint8_t* p, __m128i v)
+{ _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(v, v)); }
+
+//-----------------------------------------------------------------------------
+//      16bit の下位 4 レーンを 8bit にして格納します.
+//-----------------------------------------------------------------------------
+inline void Store4(uint8_t* p, __m128i v)
+{
+    auto bits = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+    memcpy(p, &bits, sizeof(bits));
+}
+
+//-----------------------------------------------------------------------------
+//      隣り合う2画素の和を求め, 2行分の 4画素平均にします.
+//-----------------------------------------------------------------------------
+inline __m128i Average2x2(__m128i row0, __m128i row1)
+{
+    auto sum = _mm_madd_epi16(_mm_add_epi16(row0, row1), _mm_set1_epi16(1));
+    auto avg = _mm_srli_epi32(_mm_add_epi32(sum, _mm_set1_epi32(2)), 2);
+    return _mm_packs_epi32(avg, avg);
+}
+#endif//VIDEO_ENABLE_SSE2
+
+} // namespace
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//      RGBA8 を YUV 4:2:0 に変換します.
+//-----------------------------------------------------------------------------
+void ConvertToYuv420
+(
+    const uint8_t*  pPixels,
+    uint32_t        width,
+    uint32_t        height,
+    uint32_t        pitch,
+    uint8_t*        pY,
+    uint8_t*        pU,
+    uint8_t*        pV
+)
+{
+    auto chromaWidth = (width + 1) / 2;
+
+    for(auto y=0u; y<height; y+=2)
+    {
+        // 奇数サイズの最後の行は同じ行を2回使って平均する.
+        auto hasRow1 = (y + 1 < height);
+        auto pRow0   = pPixels + size_t(y) * pitch;
+        auto pRow1   = hasRow1 ? pRow0 + pitch : pRow0;
+        auto pY0     = pY + size_t(y) * width;
+        auto pY1     = pY0 + width;
+        auto pU0     = pU + size_t(y / 2) * chromaWidth;
+        auto pV0     = pV + size_t(y / 2) * chromaWidth;
+
+        auto x = 0u;
+
+    #if VIDEO_ENABLE_SSE2
+        for(; x + 8 <= width; x += 8)
+        {
+            auto c0 = Unpack8(pRow0 + x * 4);
+            auto c1 = Unpack8(pRow1 + x * 4);
+
+            Store8(pY0 + x, ToY16(c0));
+            if (hasRow1)
+            { Store8(pY1 + x, ToY16(c1)); }
+
+            Rgb16 avg;
+            avg.R = Average2x2(c0.R, c1.R);
+            avg.G = Average2x2(c0.G, c1.G);
+            avg.B = Average2x2(c0.B, c1.B);
+
+            Store4(pU0 + x / 2, ToU16(avg));
+            Store4(pV0 + x / 2, ToV16(avg));
+        }
+    #endif
+
+        ConvertRowY(pRow0, x, width, pY0);
+        if (hasRow1)
+        { ConvertRowY(pRow1, x, width, pY1); }
+
+        for(; x<width; x+=2)
+        {
+            // 奇数サイズの最後の列は同じ画素を2回使って平均する.
+            auto x1 = (x + 1 < width) ? x + 1 : x;
+            auto p0 = pRow0 + x  * 4;
+            auto p1 = pRow0 + x1 * 4;
+            auto p2 = pRow1 + x  * 4;
+            auto p3 = pRow1 + x1 * 4;
+
+            auto r = (p0[0] + p1[0] + p2[0] + p3[0] + 2) >> 2;
+            auto g = (p0[1] + p1[1] + p2[1] + p3[1] + 2) >> 2;
+            auto b = (p0[2] + p1[2] + p2[2] + p3[2] + 2) >> 2;
+
+            pU0[x / 2] = ToU(r, g, b);
+            pV0[x / 2] = ToV(r, g, b);
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      RGBA8 を YUV 4:4:4 に変換します.
+//-----------------------------------------------------------------------------
+void ConvertToYuv444
+(
+    const uint8_t*  pPixels,
+    uint32_t        width,
+    uint32_t        height,
+    uint32_t        pitch,
+    uint8_t*        pY,
+    uint8_t*        pU,
+    uint8_t*        pV
+)
+{
+    for(auto y=0u; y<height; ++y)
+    {
+        auto pRow   = pPixels + size_t(y) * pitch;
+        auto offset = size_t(y) * width;
+
+        auto x = 0u;
+
+    #if VIDEO_ENABLE_SSE2
+        for(; x + 8 <= width; x += 8)
+        {
+            auto c = Unpack8(pRow + x * 4);
+            Store8(pY + offset + x, ToY16(c));
+            Store8(pU + offset + x, ToU16(c));
+            Store8(pV + offset + x, ToV16(c));
+        }
+    #endif
+
+        for(; x<width; ++x)
+        {
+            auto p = pRow + x * 4;
+            pY[offset + x] = ToY(p[0], p[1], p[2]);
+            pU[offset + x] = ToU(p[0], p[1], p[2]);
+            pV[offset + x] = ToV(p[0], p[1], p[2]);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// VideoStream class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+VideoStream::~VideoStream()
+{ Term(); }
+
+//-----------------------------------------------------------------------------
+//      初期化処理を行います.
+//-----------------------------------------------------------------------------
+bool VideoStream::Init(const VideoStreamDesc& desc)
+{
+    if (desc.Path == nullptr || desc.Width == 0 || desc.Height == 0)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    if (desc.Format != STREAM_FORMAT_Y4M_420
+     && desc.Format != STREAM_FORMAT_Y4M_444
+     && desc.Format != STREAM_FORMAT_RAW_RGBA)
+    {
+        ELOGA("Error : Invalid Stream Format. format = %d", desc.Format);
+        return false;
+    }
+
+    Term();
+
+    if (desc.Path[0] == '|')
+    {
+        // 外部エンコーダの標準入力に流す.
+        auto command = desc.Path + 1;
+    #if defined(_WIN32)
+        m_pFile = _popen(command, "wb");
+    #else
+        m_pFile = popen(command, "w");
+    #endif
+        if (m_pFile == nullptr)
+        {
+            ELOGA("Error : Pipe Open Failed. command = %s", command);
+            return false;
+        }
+        m_IsPipe = true;
+    }
+    else
+    {
+        m_pFile = OpenFile(desc.Path, "wb");
+        if (m_pFile == nullptr)
+        {
+            ELOGA("Error : File Open Failed. path = %s", desc.Path);
+            return false;
+        }
+        m_IsPipe = false;
+    }
+
+    m_Format        = desc.Format;
+    m_Width         = desc.Width;
+    m_Height        = desc.Height;
+    m_NextIndex     = 0;
+    m_WrittenCount  = 0;
+    m_Failed        = false;
+
+    if (m_Format != STREAM_FORMAT_RAW_RGBA)
+    {
+        // フレームレートは 1/1000 の精度の分数で記録する.
+        auto num = uint32_t(std::round(desc.FrameRate * 1000.0));
+        auto den = 1000u;
+        if (num == 0)
+        { num = 60000; }
+        for(auto a = num, b = den; ; )
+        {
+            auto r = a % b;
+            if (r == 0)
+            {
+                num /= b;
+                den /= b;
+                break;
+            }
+            a = b;
+            b = r;
+        }
+
+        char header[256] = {};
+        auto size = snprintf(header, sizeof(header),
+            "YUV4MPEG2 W%u H%u F%u:%u Ip A1:1 %s XCOLORRANGE=LIMITED\n",
+            m_Width, m_Height, num, den,
+            (m_Format == STREAM_FORMAT_Y4M_420) ? "C420jpeg" : "C444");
+
+        if (fwrite(header, 1, size_t(size), m_pFile) != size_t(size))
+        {
+            ELOGA("Error : Stream Header Write Failed. path = %s", desc.Path);
+            Term();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      終了処理を行います.
+//-----------------------------------------------------------------------------
+void VideoStream::Term()
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    if (m_pFile == nullptr)
+    { return; }
+
+    if (m_IsPipe)
+    {
+    #if defined(_WIN32)
+        auto ret = _pclose(m_pFile);
+    #else
+        auto ret = pclose(m_pFile);
+    #endif
+        if (ret != 0)
+        { ELOGA("Error : Stream Command Failed. ret = %d", ret); }
+    }
+    else
+    {
+        fclose(m_pFile);
+    }
+
+    m_pFile  = nullptr;
+    m_IsPipe = false;
+}
+
+//-----------------------------------------------------------------------------
+//      1フレーム分のストリームデータに変換します.
+//-----------------------------------------------------------------------------
+void VideoStream::Convert(const uint8_t* pPixels, uint32_t pitch, std::vector<uint8_t>& result) const
+{
+    auto lumaSize = size_t(m_Width) * m_Height;
+
+    switch(m_Format)
+    {
+    case STREAM_FORMAT_Y4M_420:
+        {
+            auto chromaSize = size_t((m_Width + 1) / 2) * ((m_Height + 1) / 2);
+            result.resize(Y4M_FRAME_HEADER_SIZE + lumaSize + chromaSize * 2);
+
+            auto pY = result.data() + Y4M_FRAME_HEADER_SIZE;
+            memcpy(result.data(), Y4M_FRAME_HEADER, Y4M_FRAME_HEADER_SIZE);
+            ConvertToYuv420(pPixels, m_Width, m_Height, pitch, pY, pY + lumaSize, pY + lumaSize + chromaSize);
+        }
+        break;
+
+    case STREAM_FORMAT_Y4M_444:
+        {
+            result.resize(Y4M_FRAME_HEADER_SIZE + lumaSize * 3);
+
+            auto pY = result.data() + Y4M_FRAME_HEADER_SIZE;
+            memcpy(result.data(), Y4M_FRAME_HEADER, Y4M_FRAME_HEADER_SIZE);
+            ConvertToYuv444(pPixels, m_Width, m_Height, pitch, pY, pY + lumaSize, pY + lumaSize * 2);
+        }
+        break;
+
+    case STREAM_FORMAT_RAW_RGBA:
+        {
+            auto rowSize = size_t(m_Width) * 4;
+            result.resize(rowSize * m_Height);
+            for(auto y=0u; y<m_Height; ++y)
+            { memcpy(result.data() + rowSize * y, pPixels + size_t(pitch) * y, rowSize); }
+        }
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      フレームを書き出します.
+//-----------------------------------------------------------------------------
+bool VideoStream::Write(uint32_t frameIndex, const std::vector<uint8_t>& data)
+{
+    // 前のフレームが書き出されるまで待つ.
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_TurnCond.wait(lock, [&]() { return frameIndex <= m_NextIndex; });
+
+    if (frameIndex != m_NextIndex)
+    {
+        ELOGA("Error : Frame Already Passed. frame = %u, next = %u", frameIndex, m_NextIndex);
+        return false;
+    }
+
+    auto ret = (m_pFile != nullptr) && !m_Failed;
+    if (ret)
+    {
+        ret = (fwrite(data.data(), 1, data.size(), m_pFile) == data.size());
+        if (ret)
+        { m_WrittenCount++; }
+        else
+        {
+            // 以降のフレームは書き出さない (ストリームの途中が欠けるため).
+            ELOGA("Error : Stream Write Failed. frame = %u", frameIndex);
+            m_Failed = true;
+        }
+    }
+
+    m_NextIndex++;
+    m_TurnCond.notify_all();
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+//      出力先が開かれているかどうかチェックします.
+//-----------------------------------------------------------------------------
+bool VideoStream::IsOpen() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return m_pFile != nullptr;
+}
+
+//-----------------------------------------------------------------------------
+//      書き出したフレーム数を取得します.
+//-----------------------------------------------------------------------------
+uint32_t VideoStream::GetWrittenCount() const
+{
+    std::lock_guard<std::mutex> locker(m_Mutex);
+    return m_WrittenCount;
+}
+
+} // namespace r3d
@@ -8,6 +8,7 @@
 // Includes
 //-----------------------------------------------------------------------------
 #include <RendererApp.h>
+#include <cstring>
 
 
 //-----------------------------------------------------------------------------
@@ -23,6 +24,17 @@ int main(int argc, char** argv)
     desc.RenderHeight       = 1080;//1080;//1440;
     desc.FPS                = 23.9;
     desc.AnimationTimeSec   = 10.0;
+    desc.UploadHeapSize     = 256 * 1024 * 1024;
+    desc.EncoderThreadCount = 4;
+    desc.EncoderBufferCount = 8;
+    desc.OutputFormat       = r3d::IMAGE_FORMAT_PNG;
+    desc.CaptureHdr         = false;
+    desc.StreamPath         = nullptr;
+    desc.StreamFormat       = r3d::STREAM_FORMAT_Y4M_420;
+    desc.SkipDuplicate      = true;
+    desc.DuplicateTolerance = 0;
+    desc.DirectIO           = false;
+    desc.JournalPath        = nullptr;
 #if 1
     desc.SceneFilePath      = "../res/scene/rtcamp_2023.scn";
     desc.CameraFilePath     = "../res/scene/rtcamp_2023.cam";
@@ -30,6 +42,14 @@ int main(int argc, char** argv)
     desc.SceneFilePath      = "../res/scene/test_scene.scn";
     desc.CameraFilePath     = "../res/scene/test_camera.cam";
 #endif
+
+    // --resume <path> を指定した場合だけジャーナルに記録し, 中断したところから再開する.
+    for(auto i=1; i<argc; ++i)
+    {
+        if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc)
+        { desc.JournalPath = argv[++i]; }
+    }
+
     r3d::Renderer app(desc);
     app.Run();
 
@@ -0,0 +1,229 @@
+﻿//-----------------------------------------------------------------------------
+// File : CameraSequenceExporter.cpp
+// Desc : Camera Sequence Exporter.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <offline/CameraSequenceExporter.h>
+#include <generated/camera_format.h>
+#include <AsyncFileWriter.h>
+#include <Platform.h>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+
+namespace r3d {
+namespace offline {
+
+///////////////////////////////////////////////////////////////////////////////
+// CameraSequenceExporter class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      テキストファイルからデータをロードし，出力します.
+//-----------------------------------------------------------------------------
+bool CameraSequenceExporter::LoadFromTXT(const char* path, std::string& exportPath)
+{
+    if (!Parse(path, exportPath))
+    { return false; }
+
+    // エクスポート名が無ければタイムスタンプを付ける
+    if (exportPath.empty())
+    {
+        exportPath = "../res/scene/camera_";
+        exportPath += GetTimeStamp();
+        exportPath += ".cam";
+    }
+
+    if (!Export(exportPath.c_str()))
+    {
+        ELOG("Error : Camera Sequence Data Export Failed.");
+        return false;
+    }
+
+    ILOGA("Info : Camera Sequence Data Exported!! path = %s", exportPath.c_str());
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      テキストファイルからデータをロードします.
+//-----------------------------------------------------------------------------
+bool CameraSequenceExporter::Parse(const char* path, std::string& exportPath)
+{
+    exportPath.clear();
+
+    std::string inputPath;
+    if (!SearchFilePath(path, inputPath))
+    {
+        ELOGA("Error : File Not Found. path = %s", path);
+        return false;
+    }
+
+    std::ifstream stream;
+    stream.open(inputPath.c_str(), std::ios::in);
+
+    if (!stream.is_open())
+    {
+        ELOGA("Error : File Open Failed. path = %s", inputPath.c_str());
+        return false;
+    }
+
+    const uint32_t BUFFER_SIZE = 4096;
+    char buf[BUFFER_SIZE] = {};
+
+    for(;;)
+    {
+        stream >> buf;
+        if (!stream || stream.eof())
+        { break; }
+
+        if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+        { /* DO_NOTHING */ }
+        else if (0 == StrICmp(buf, "camera"))
+        {
+            CameraParam param = {};
+
+            for(;;)
+            {
+                stream >> buf;
+                if (!stream || stream.eof())
+                { break; }
+
+                if (0 == strcmp(buf, "};"))
+                { break; }
+                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+                { /* DO_NOTHING */ }
+                else if (0 == StrICmp(buf, "-FrameIndex:"))
+                { stream >> param.FrameIndex; }
+                else if (0 == StrICmp(buf, "-Position:"))
+                { stream >> param.Position.x >> param.Position.y >> param.Position.z; }
+                else if (0 == StrICmp(buf, "-Target:"))
+                { stream >> param.Target.x >> param.Target.y >> param.Target.z; }
+                else if (0 == StrICmp(buf, "-Upward:"))
+                { stream >> param.Upward.x >> param.Upward.y >> param.Upward.z; }
+                else if (0 == StrICmp(buf, "-FieldOfView:"))
+                {
+                    float fovYDeg = 0.0f;
+                    stream >> fovYDeg;
+                    param.FieldOfView = ToRadian(fovYDeg);
+                }
+                else if (0 == StrICmp(buf, "-NearClip:"))
+                { stream >> param.NearClip; }
+                else if (0 == StrICmp(buf, "-FarClip:"))
+                { stream >> param.FarClip; }
+
+                stream.ignore(BUFFER_SIZE, '\n');
+            }
+
+            m_Params.push_back(param);
+        }
+        else if (0 == StrICmp(buf, "export"))
+        {
+            for(;;)
+            {
+                stream >> buf;
+                if (!stream || stream.eof())
+                { break; }
+                if (0 == strcmp(buf, "};"))
+                { break; }
+                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+                { /* DO_NOTHING */ }
+                else if (0 == StrICmp(buf, "-Path:"))
+                { stream >> exportPath; }
+
+                stream.ignore(BUFFER_SIZE, '\n');
+            }
+        }
+
+        stream.ignore(BUFFER_SIZE, '\n');
+    }
+    stream.close();
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      バイナリに出力します.
+//-----------------------------------------------------------------------------
+bool CameraSequenceExporter::Export(const char* path)
+{
+    // キーは疎で構わないが，時刻順に並んでいる必要がある.
+    std::stable_sort(m_Params.begin(), m_Params.end(),
+        [](const CameraParam& lhs, const CameraParam& rhs)
+        { return lhs.FrameIndex < rhs.FrameIndex; });
+
+    for(size_t i=1; i<m_Params.size(); ++i)
+    {
+        if (m_Params[i - 1].FrameIndex == m_Params[i].FrameIndex)
+        {
+            ELOG("Error : Duplicate Camera Key. FrameIndex = %u", m_Params[i].FrameIndex);
+            return false;
+        }
+    }
+
+    std::vector<r3d::ResCameraParam> params;
+    params.resize(m_Params.size());
+
+    // データ変換.
+    for(size_t i=0; i<m_Params.size(); ++i)
+    {
+        r3d::Vector3 position(m_Params[i].Position.x, m_Params[i].Position.y, m_Params[i].Position.z);
+        r3d::Vector3 target(m_Params[i].Target.x, m_Params[i].Target.y, m_Params[i].Target.z);
+        r3d::Vector3 upward(m_Params[i].Upward.x, m_Params[i].Upward.y, m_Params[i].Upward.z);
+
+        params[i] = r3d::ResCameraParam(
+            m_Params[i].FrameIndex,
+            position,
+            target,
+            upward,
+            m_Params[i].FieldOfView,
+            m_Params[i].NearClip,
+            m_Params[i].FarClip);
+    }
+
+    flatbuffers::FlatBufferBuilder builder(2048);
+    auto dstSequence = r3d::CreateResCameraSequenceDirect(
+        builder,
+        &params);
+
+    builder.Finish(dstSequence);
+
+    auto buffer = builder.GetBufferPointer();
+    auto size   = builder.GetSize();
+
+    AsyncFileWriterDesc writerDesc = {};
+    writerDesc.ThreadCount = 1;
+
+    AsyncFileWriter writer;
+    if (!writer.Init(writerDesc))
+    {
+        ELOG("Error : AsyncFileWriter::Init() Failed.");
+        return false;
+    }
+
+    if (!writer.WriteFile(path, buffer, size))
+    { return false; }
+
+    if (!writer.Flush())
+    {
+        ELOG("Error : File Write Failed. path = %s", path);
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      データをリセットします.
+//-----------------------------------------------------------------------------
+void CameraSequenceExporter::Reset()
+{
+    m_Params.clear();
+    m_Params.shrink_to_fit();
+}
+} // namespace offline
+} // namespace r3d
@@ -7,12 +7,13 @@
 //-----------------------------------------------------------------------------
 // Includes
 //-----------------------------------------------------------------------------
-#include <OBJLoader.h>
-#include <fnd/asdxMisc.h>
-#include <fnd/asdxLogger.h>
+#include <offline/OBJLoader.h>
+#include <Platform.h>
 #include <fstream>
 #include <algorithm>
 #include <tuple>
+#include <cassert>
+#include <cstring>
 #include <mikktspace.h>
 
 //-----------------------------------------------------------------------------
@@ -23,6 +24,8 @@ static const uint32_t OBJ_BUFFER_LENGTH = 2048;
 
 namespace {
 
+using namespace r3d::offline;
+
 //-----------------------------------------------------------------------------
 //      面数を取得します.
 //-----------------------------------------------------------------------------
@@ -122,13 +125,13 @@ void SetTSpaceBasic(const SMikkTSpaceContext* pContext, const float fvTangent[],
 void CalcNormals(MeshOBJ& mesh)
 {
     auto vertexCount = mesh.Vertices.size();
-    std::vector<asdx::Vector3> normals;
+    std::vector<Vector3> normals;
     normals.resize(vertexCount);
 
     // 法線データ初期化.
     for(size_t i=0; i<vertexCount; ++i)
     {
-        normals[i] = asdx::Vector3(0.0f, 0.0f, 0.0f);
+        normals[i] = Vector3(0.0f, 0.0f, 0.0f);
     }
 
     auto indexCount = mesh.Indices.size();
@@ -147,8 +150,8 @@ void CalcNormals(MeshOBJ& mesh)
         auto e1 = p2 - p0;
 
         // 面法線を算出.
-        auto fn = asdx::Vector3::Cross(e0, e1);
-        fn = asdx::Vector3::SafeNormalize(fn, fn);
+        auto fn = Vector3::Cross(e0, e1);
+        fn = Vector3::SafeNormalize(fn, fn);
 
         // 面法線を加算.
         normals[i0] += fn;
@@ -159,11 +162,11 @@ void CalcNormals(MeshOBJ& mesh)
     // 加算した法線を正規化し，頂点法線を求める.
     for(size_t i=0; i<vertexCount; ++i)
     {
-        normals[i] = asdx::Vector3::SafeNormalize(normals[i], normals[i]);
+        normals[i] = Vector3::SafeNormalize(normals[i], normals[i]);
     }
 
     const auto SMOOTHING_ANGLE = 59.7f;
-    auto cosSmooth = cosf(asdx::ToDegree(SMOOTHING_ANGLE));
+    auto cosSmooth = cosf(ToDegree(SMOOTHING_ANGLE));
 
     // スムージング処理.
     for(size_t i=0; i<indexCount; i+=3)
@@ -181,13 +184,13 @@ void CalcNormals(MeshOBJ& mesh)
         auto e1 = p2 - p0;
 
         // 面法線を算出.
-        auto fn = asdx::Vector3::Cross(e0, e1);
-        fn = asdx::Vector3::SafeNormalize(fn, fn);
+        auto fn = Vector3::Cross(e0, e1);
+        fn = Vector3::SafeNormalize(fn, fn);
 
         // 頂点法線と面法線のなす角度を算出.
-        auto c0 = asdx::Vector3::Dot(normals[i0], fn);
-        auto c1 = asdx::Vector3::Dot(normals[i1], fn);
-        auto c2 = asdx::Vector3::Dot(normals[i2], fn);
+        auto c0 = Vector3::Dot(normals[i0], fn);
+        auto c1 = Vector3::Dot(normals[i1], fn);
+        auto c2 = Vector3::Dot(normals[i2], fn);
 
         // スムージング処理.
         mesh.Vertices[i0].Normal = (c0 >= cosSmooth) ? normals[i0] : fn;
@@ -226,8 +229,8 @@ void CalcTangentRoughly(MeshOBJ& mesh)
     auto vertexCount = mesh.Vertices.size();
     for(size_t i=0; i<vertexCount; ++i)
     {
-        asdx::Vector3 T, B;
-        asdx::CalcONB(mesh.Vertices[i].Normal, T, B);
+        Vector3 T, B;
+        CalcONB(mesh.Vertices[i].Normal, T, B);
         mesh.Vertices[i].Tangent = T;
     }
 }
@@ -235,6 +238,9 @@ void CalcTangentRoughly(MeshOBJ& mesh)
 } // namespace
 
 
+namespace r3d {
+namespace offline {
+
 //-----------------------------------------------------------------------------
 //      ロードします.
 //-----------------------------------------------------------------------------
@@ -247,7 +253,7 @@ bool OBJLoader::Load(const char* path, ModelOBJ& model)
     }
 
     // ディレクトリパス取得.
-    m_DirectoryPath = asdx::GetDirectoryPathA(path);
+    m_DirectoryPath = GetDirectoryPath(path);
 
     // OBJファイルをロード.
     return LoadOBJ(path, model);
@@ -267,8 +273,8 @@ bool OBJLoader::LoadOBJ(const char* path, ModelOBJ& model)
         return false;
     }
 
-    std::string baseName = asdx::RemoveDirectoryPathA(path);
-    baseName = asdx::GetPathWithoutExtA(baseName.c_str());
+    std::string baseName = RemoveDirectoryPath(path);
+    baseName = GetPathWithoutExt(baseName.c_str());
 
     char buf[OBJ_BUFFER_LENGTH] = {};
     std::string group;
@@ -276,9 +282,9 @@ bool OBJLoader::LoadOBJ(const char* path, ModelOBJ& model)
     uint32_t faceIndex = 0;
     uint32_t faceCount = 0;
 
-    std::vector<asdx::Vector3>  positions;
-    std::vector<asdx::Vector3>  normals;
-    std::vector<asdx::Vector2>  texcoords;
+    std::vector<Vector3>  positions;
+    std::vector<Vector3>  normals;
+    std::vector<Vector2>  texcoords;
     std::vector<IndexOBJ>       indices;
     std::vector<SubsetOBJ>      subsets;
 
@@ -294,19 +300,19 @@ bool OBJLoader::LoadOBJ(const char* path, ModelOBJ& model)
         }
         else if (0 == strcmp(buf, "v"))
         {
-            asdx::Vector3 v;
+            Vector3 v;
             stream >> v.x >> v.y >> v.z;
             positions.push_back(v);
         }
         else if (0 == strcmp(buf, "vt"))
         {
-            asdx::Vector2 vt;
+            Vector2 vt;
             stream >> vt.x >> vt.y;
             texcoords.push_back(vt);
         }
         else if (0 == strcmp(buf, "vn"))
         {
-            asdx::Vector3 vn;
+            Vector3 vn;
             stream >> vn.x >> vn.y >> vn.z;
             normals.push_back(vn);
         }
@@ -540,7 +546,7 @@ bool OBJLoader::LoadMTL(const char* path, ModelOBJ& model)
 {
     std::ifstream stream;
 
-    std::string filename = m_DirectoryPath + "/" + path;
+    auto filename = NormalizePath((m_DirectoryPath + "/" + path).c_str());
 
     stream.open(filename.c_str(), std::ios::in);
 
@@ -587,7 +593,7 @@ bool OBJLoader::LoadMTL(const char* path, ModelOBJ& model)
         { stream >> model.Materials[index].map_Ks; }
         else if (0 == strcmp(buf, "map_Ke"))
         { stream >> model.Materials[index].map_Ke; }
-        else if (0 == _stricmp(buf, "map_bump") || 0 == strcmp(buf, "bump"))
+        else if (0 == StrICmp(buf, "map_bump") || 0 == strcmp(buf, "bump"))
         { stream >> model.Materials[index].map_bump; }
         else if (0 == strcmp(buf, "disp"))
         { stream >> model.Materials[index].disp; }
@@ -606,3 +612,6 @@ bool OBJLoader::LoadMTL(const char* path, ModelOBJ& model)
     // 正常終了.
     return true;
 }
+
+} // namespace offline
+} // namespace r3d
@@ -0,0 +1,1339 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneExporter.cpp
+// Desc : Scene Exporter.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <offline/SceneExporter.h>
+#include <offline/OBJLoader.h>
+#include <offline/TextureLoader.h>
+#include <SceneContainer.h>
+#include <TagTable.h>
+#include <Compression.h>
+#include <AsyncFileWriter.h>
+#include <Platform.h>
+#include <fstream>
+#include <map>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      バイナリ形式に変換します.
+//-----------------------------------------------------------------------------
+r3d::Vector4 ToBinaryFormat(const r3d::offline::Vector4& value)
+{ return r3d::Vector4(value.x, value.y, value.z, value.w); }
+
+//-----------------------------------------------------------------------------
+//      テクスチャをフラットバッファに変換します.
+//-----------------------------------------------------------------------------
+flatbuffers::Offset<r3d::ResTexture> ToBinaryFormat
+(
+    flatbuffers::FlatBufferBuilder&     builder,
+    const r3d::offline::TextureData&    texture,
+    bool                                placedFootprint
+)
+{
+    std::vector<flatbuffers::Offset<r3d::SubResource>> subResources;
+    uint32_t option = 0;
+
+    std::vector<r3d::TextureFootprint> footprints;
+    uint64_t totalSize = 0;
+
+    if (placedFootprint && r3d::CalcTextureFootprints(
+        texture.Dimension,
+        texture.Width,
+        texture.Height,
+        texture.Depth,
+        texture.Format,
+        texture.MipMapCount,
+        texture.SurfaceCount,
+        footprints,
+        totalSize))
+    {
+        // アップロードバッファの配置に並べ替えて1つのサブリソースにまとめる.
+        std::vector<uint8_t> pixels(size_t(totalSize), 0);
+
+        for(size_t i=0; i<footprints.size(); ++i)
+        {
+            auto& src = texture.Resources[i];
+            auto& dst = footprints[i];
+
+            auto rowCount = size_t(dst.RowCount) * dst.Depth;
+            for(size_t y=0; y<rowCount; ++y)
+            {
+                memcpy(pixels.data() + dst.Offset + dst.RowPitch * y,
+                       src.Pixels.data() + size_t(src.Pitch) * y,
+                       dst.RowSize);
+            }
+        }
+
+        subResources.push_back(r3d::CreateSubResourceDirect(
+            builder,
+            texture.Width,
+            texture.Height,
+            0,
+            footprints[0].RowPitch,
+            footprints[0].RowPitch * footprints[0].RowCount,
+            &pixels));
+
+        option |= r3d::TEXTURE_OPTION_PLACED_FOOTPRINT;
+    }
+    else
+    {
+        subResources.reserve(texture.Resources.size());
+
+        for(auto& res : texture.Resources)
+        {
+            subResources.push_back(r3d::CreateSubResourceDirect(
+                builder,
+                res.Width,
+                res.Height,
+                res.MipIndex,
+                res.Pitch,
+                res.SlicePitch,
+                &res.Pixels));
+        }
+    }
+
+    return r3d::CreateResTextureDirect(
+        builder,
+        texture.Dimension,
+        texture.Width,
+        texture.Height,
+        texture.Depth,
+        texture.Format,
+        texture.MipMapCount,
+        texture.SurfaceCount,
+        option,
+        &subResources);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SectionData structure
+///////////////////////////////////////////////////////////////////////////////
+struct SectionData
+{
+    r3d::SceneSectionEntry  Entry;
+    std::vector<uint8_t>    Payload;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BlobWriter structure
+///////////////////////////////////////////////////////////////////////////////
+struct BlobWriter
+{
+    std::string             RootPath;               //!< ルートファイルのパス.
+    uint64_t                MaxSize     = 0;        //!< ブロブファイル1つあたりの最大サイズ.
+    uint64_t                BundleId    = 0;        //!< ルートファイルとの対応を確認する識別子.
+    r3d::AsyncFileWriter*   pWriter     = nullptr;  //!< 書き込み先.
+    uint32_t                Handle      = r3d::AsyncFileWriter::INVALID_HANDLE; //!< 出力中のブロブファイル.
+    uint32_t                FileCount   = 0;        //!< 作成したブロブファイル数.
+    uint64_t                Position    = 0;        //!< 出力中のブロブファイルの書き込み位置.
+
+    ~BlobWriter()
+    {
+        // 途中で失敗した場合も閉じておく.
+        if (Handle != r3d::AsyncFileWriter::INVALID_HANDLE)
+        { pWriter->Close(Handle); }
+    }
+};
+
+static const size_t   MESH_SECTION_SIZE  = 1024 * 1024;   // メッシュセクションの目安サイズ.
+static const uint64_t MAX_SECTION_SIZE   = FLATBUFFERS_MAX_BUFFER_SIZE - 64 * 1024; // テーブル分の余裕を残す.
+static const uint64_t MAX_PENDING_WRITE  = 64 * 1024 * 1024; // 書き込み待ちのペイロードの上限.
+
+//-----------------------------------------------------------------------------
+//      アラインメントを揃えます.
+//-----------------------------------------------------------------------------
+inline uint64_t AlignSection(uint64_t value)
+{ return (value + r3d::SCENE_SECTION_ALIGNMENT - 1) & ~(r3d::SCENE_SECTION_ALIGNMENT - 1); }
+
+//-----------------------------------------------------------------------------
+//      書き込み中のファイルパスを取得します.
+//
+//      読み込み中のシーンを上書きしないように，書き終えてから置き換える.
+//-----------------------------------------------------------------------------
+std::string GetWritingPath(const std::string& path)
+{ return path + ".tmp"; }
+
+//-----------------------------------------------------------------------------
+//      書き終えたファイルで置き換えます.
+//-----------------------------------------------------------------------------
+bool CommitFile(const std::string& path)
+{
+    auto writingPath = GetWritingPath(path);
+
+#if defined(_WIN32)
+    // Windows の rename は既存のファイルを置き換えないので先に削除する.
+    remove(path.c_str());
+#endif
+    if (rename(writingPath.c_str(), path.c_str()) != 0)
+    {
+        ELOGA("Error : File Rename Failed. path = %s", path.c_str());
+        remove(writingPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      出力中のブロブファイルを閉じます.
+//-----------------------------------------------------------------------------
+void CloseBlob(BlobWriter& writer)
+{
+    // 書き込みの完了は AsyncFileWriter::Flush() でまとめて確認する.
+    if (writer.Handle == r3d::AsyncFileWriter::INVALID_HANDLE)
+    { return; }
+
+    writer.pWriter->Close(writer.Handle);
+    writer.Handle   = r3d::AsyncFileWriter::INVALID_HANDLE;
+    writer.Position = 0;
+}
+
+//-----------------------------------------------------------------------------
+//      セクションをブロブファイルに出力し，ペイロードを解放します.
+//
+//      書き込みは非同期に行われるので，次のセクションの圧縮と重なる.
+//-----------------------------------------------------------------------------
+bool WriteBlob(BlobWriter& writer, SectionData& section)
+{
+    static const uint8_t padding[r3d::SCENE_SECTION_ALIGNMENT] = {};
+
+    auto size = uint64_t(section.Payload.size());
+
+    // 収まらなければ次のファイルへ. 空のファイルには必ず書き込む.
+    auto offset = AlignSection(writer.Position);
+    if (writer.Handle != r3d::AsyncFileWriter::INVALID_HANDLE
+     && writer.Position > sizeof(r3d::SceneBlobHeader)
+     && offset + size > writer.MaxSize)
+    { CloseBlob(writer); }
+
+    if (writer.Handle == r3d::AsyncFileWriter::INVALID_HANDLE)
+    {
+        writer.FileCount++;
+
+        auto path = GetWritingPath(r3d::GetSceneBlobPath(writer.RootPath.c_str(), writer.FileCount));
+        writer.Handle = writer.pWriter->Open(path.c_str());
+        if (writer.Handle == r3d::AsyncFileWriter::INVALID_HANDLE)
+        {
+            ELOGA("Error : File Open Failed. path = %s", path.c_str());
+            return false;
+        }
+
+        r3d::SceneBlobHeader header = {};
+        header.Magic    = r3d::SCENE_BLOB_MAGIC;
+        header.Version  = r3d::SCENE_BLOB_VERSION;
+        header.File     = writer.FileCount;
+        header.BundleId = writer.BundleId;
+
+        if (!writer.pWriter->Append(writer.Handle, &header, sizeof(header)))
+        {
+            ELOGA("Error : File Write Failed. path = %s", path.c_str());
+            return false;
+        }
+
+        writer.Position = sizeof(header);
+        offset = AlignSection(writer.Position);
+    }
+
+    auto result = true;
+
+    auto pad = size_t(offset - writer.Position);
+    if (pad > 0)
+    { result &= writer.pWriter->Append(writer.Handle, padding, pad); }
+
+    result &= writer.pWriter->Append(writer.Handle, section.Payload.data(), size_t(size));
+    if (!result)
+    {
+        ELOGA("Error : File Write Failed. path = %s", r3d::GetSceneBlobPath(writer.RootPath.c_str(), writer.FileCount).c_str());
+        return false;
+    }
+
+    section.Entry.File   = writer.FileCount;
+    section.Entry.Offset = offset;
+    writer.Position      = offset + size;
+
+    // チャンクにコピー済みなのでメモリに残さない.
+    std::vector<uint8_t>().swap(section.Payload);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ビルド済みのフラットバッファをセクションとして追加します.
+//-----------------------------------------------------------------------------
+bool AddSection
+(
+    std::vector<SectionData>&           sections,
+    r3d::SCENE_SECTION_TYPE             type,
+    uint32_t                            firstIndex,
+    uint32_t                            count,
+    flatbuffers::FlatBufferBuilder&     builder,
+    BlobWriter*                         pBlob = nullptr
+)
+{
+    auto pRaw    = builder.GetBufferPointer();
+    auto rawSize = size_t(builder.GetSize());
+
+    SectionData section;
+    section.Entry = {};
+    section.Entry.Type          = type;
+    section.Entry.FirstIndex    = firstIndex;
+    section.Entry.Count         = count;
+    section.Entry.RawSize       = rawSize;
+    section.Entry.Checksum      = XXH3_64bits(pRaw, rawSize);
+
+    r3d::CompressLZ4(pRaw, rawSize, section.Payload);
+
+    // 1/8 以上縮まなければ無圧縮で格納し，読み込み時の展開とコピーを省く.
+    if (section.Payload.size() + rawSize / 8 > rawSize)
+    {
+        section.Entry.Codec = r3d::COMPRESSION_CODEC_NONE;
+        section.Payload.assign(pRaw, pRaw + rawSize);
+    }
+    else
+    {
+        section.Entry.Codec = r3d::COMPRESSION_CODEC_LZ4;
+    }
+
+    section.Entry.StoredSize = section.Payload.size();
+
+    if (pBlob != nullptr && !WriteBlob(*pBlob, section))
+    { return false; }
+
+    sections.push_back(std::move(section));
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ハッシュタグを登録し，重複と衝突を検出します.
+//-----------------------------------------------------------------------------
+bool RegisterHashTag
+(
+    std::map<uint32_t, std::string>&    dic,
+    const std::string&                  tag,
+    uint32_t                            hashTag
+)
+{
+    auto itr = dic.find(hashTag);
+    if (itr == dic.end())
+    {
+        dic[hashTag] = tag;
+        return true;
+    }
+
+    if (itr->second == tag)
+    { ELOGA("Error : Duplicate Tag. tag = %s", tag.c_str()); }
+    else
+    { ELOGA("Error : Hash Tag Collision. tag = %s, other = %s, hash = 0x%08x", tag.c_str(), itr->second.c_str(), hashTag); }
+
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+//      セクション化したシーンファイルを出力します.
+//-----------------------------------------------------------------------------
+bool WriteContainer
+(
+    r3d::AsyncFileWriter&           writer,
+    const char*                     path,
+    r3d::SceneContainerHeader&      header,
+    std::vector<SectionData>&       sections
+)
+{
+    std::vector<r3d::SceneSectionEntry> entries;
+    entries.reserve(sections.size());
+
+    // ブロブファイルに出力済みのセクションはテーブルにだけ載せる.
+    auto offset = AlignSection(sizeof(header) + sizeof(r3d::SceneSectionEntry) * sections.size());
+    for(auto& section : sections)
+    {
+        if (section.Entry.File == 0)
+        {
+            section.Entry.Offset = offset;
+            offset = AlignSection(offset + section.Entry.StoredSize);
+        }
+        entries.push_back(section.Entry);
+    }
+
+    header.SectionCount  = uint32_t(entries.size());
+    header.TableChecksum = XXH3_64bits(entries.data(), sizeof(r3d::SceneSectionEntry) * entries.size());
+
+    auto handle = writer.Open(path);
+    if (handle == r3d::AsyncFileWriter::INVALID_HANDLE)
+    {
+        ELOGA("Error : File Open Failed. path = %s", path);
+        return false;
+    }
+
+    static const uint8_t padding[r3d::SCENE_SECTION_ALIGNMENT] = {};
+
+    auto result = writer.Append(handle, &header, sizeof(header));
+    if (!entries.empty())
+    { result &= writer.Append(handle, entries.data(), sizeof(r3d::SceneSectionEntry) * entries.size()); }
+
+    uint64_t pos = sizeof(header) + sizeof(r3d::SceneSectionEntry) * entries.size();
+    for(auto& section : sections)
+    {
+        if (section.Entry.File != 0)
+        { continue; }
+
+        auto pad = size_t(section.Entry.Offset - pos);
+        if (pad > 0)
+        { result &= writer.Append(handle, padding, pad); }
+
+        result &= writer.Append(handle, section.Payload.data(), section.Payload.size());
+        pos = section.Entry.Offset + section.Payload.size();
+    }
+
+    writer.Close(handle);
+    result &= writer.Flush();
+
+    if (!result)
+    {
+        ELOGA("Error : File Write Failed. path = %s", path);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+namespace r3d {
+namespace offline {
+
+static_assert(sizeof(VertexOBJ) == sizeof(ResVertex), "Vertex size not matched!");
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneExporter class
+///////////////////////////////////////////////////////////////////////////////
+
+//-----------------------------------------------------------------------------
+//      デストラクタです.
+//-----------------------------------------------------------------------------
+SceneExporter::~SceneExporter()
+{ Reset(); }
+
+//-----------------------------------------------------------------------------
+//      テキストファイルからシーンを読み込み，出力します.
+//-----------------------------------------------------------------------------
+bool SceneExporter::LoadFromTXT(const char* path, std::string& exportPath)
+{
+    if (!Parse(path, exportPath))
+    { return false; }
+
+    // エクスポート名が無ければタイムスタンプを付ける
+    if (exportPath.empty())
+    {
+        exportPath = "../res/scene/scene_";
+        exportPath += GetTimeStamp();
+        exportPath += ".scn";
+    }
+
+    if (!Export(exportPath.c_str()))
+    {
+        ELOG("Error : Scene Export Failed.");
+        return false;
+    }
+
+    ILOGA("Info : Scene Exported!! path = %s", exportPath.c_str());
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      テキストファイルからシーンを読み込みます.
+//-----------------------------------------------------------------------------
+bool SceneExporter::Parse(const char* path, std::string& exportPath)
+{
+    exportPath.clear();
+
+    std::string inputPath;
+    if (!SearchFilePath(path, inputPath))
+    {
+        ELOGA("Error : File Not Found. path = %s", path);
+        return false;
+    }
+
+    std::ifstream stream;
+    stream.open(inputPath.c_str(), std::ios::in);
+
+    if (!stream.is_open())
+    {
+        ELOGA("Error : File Open Failed. path = %s", inputPath.c_str());
+        return false;
+    }
+
+    const uint32_t BUFFER_SIZE =4096;
+    char buf[BUFFER_SIZE] = {};
+
+    std::map<std::string, uint32_t>  meshDic;
+    std::map<std::string, uint32_t>  materialDic;
+    std::map<std::string, uint32_t>  textureDic;
+    std::map<uint32_t, std::string>  instanceTagDic;
+    std::map<uint32_t, std::string>  lightTagDic;
+
+    uint32_t meshIndex     = 0;
+    uint32_t materialIndex = 0;
+    uint32_t textureIndex  = 0;
+
+    for(;;)
+    {
+        // バッファに格納.
+        stream >> buf;
+
+        if (!stream || stream.eof())
+        { break; }
+
+        if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+        { /* DO_NOTHING */ }
+        else if (0 == StrICmp(buf, "model"))
+        {
+            std::string tag;
+            std::string path;
+
+            for(;;)
+            {
+                stream >> buf;
+                if (!stream || stream.eof())
+                { break; }
+
+                if (0 == strcmp(buf, "};"))
+                { break; }
+                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+                { /* DO_NOTHING */ }
+                else if (0 == StrICmp(buf, "-Tag:"))
+                { stream >> tag; }
+                else if (0 == StrICmp(buf, "-Path:"))
+                { stream >> path; }
+
+                stream.ignore(BUFFER_SIZE, '\n');
+            }
+
+            if (tag.empty() || path.empty())
+            {
+                ELOGA("Error : Invalid Model Block. tag = %s, path = %s", tag.c_str(), path.c_str());
+                return false;
+            }
+
+            std::vector<MeshInfo> meshInfos;
+            std::vector<Mesh>     meshes;
+            if (!LoadMesh(path.c_str(), meshes, meshInfos))
+            { return false; }
+
+            for(size_t i=0; i<meshInfos.size(); ++i)
+            {
+                if (meshDic.find(meshInfos[i].MeshName) == meshDic.end())
+                {
+                    meshDic[meshInfos[i].MeshName] = meshIndex;
+                    meshIndex++;
+                }
+            }
+
+            AddMeshes(meshes);
+        }
+        else if (0 == StrICmp(buf, "material"))
+        {
+            std::string tag;
+            Vector4 baseColor = Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+            float occlusion = 0.0f;
+            float roughness = 1.0f;
+            float metalness = 0.0f;
+            Vector4 emissive = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+            float ior = 0.0f;
+            std::string texBaseColor;
+            std::string texNormal;
+            std::string texOrm;
+            std::string texEmissive;
+
+            for(;;)
+            {
+                stream >> buf;
+                if (!stream || stream.eof())
+                { break; }
+
+                if (0 == strcmp(buf, "};"))
+                { break; }
+                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+                { /* DO_NOTHING */ }
+                else if (0 == StrICmp(buf, "-Tag:"))
+                { stream >> tag; }
+                else if (0 == StrICmp(buf, "-BaseColor:"))
+                { stream >> baseColor.x >> baseColor.y >> baseColor.z >> baseColor.w; }
+                else if (0 == StrICmp(buf, "-Occlusion:"))
+                { stream >> occlusion; }
+                else if (0 == StrICmp(buf, "-Roughness:"))
+                { stream >> roughness; }
+                else if (0 == StrICmp(buf, "-Metalness:"))
+                { stream >> metalness; }
+                else if (0 == StrICmp(buf, "-Ior:"))
+                { stream >> ior; }
+                else if (0 == StrICmp(buf, "-Emissive:"))
+                { stream >> emissive.x >> emissive.y >> emissive.z >> emissive.w; }
+                else if (0 == StrICmp(buf, "-BaseColorMap:"))
+                { stream >> texBaseColor; }
+                else if (0 == StrICmp(buf, "-NormalMap:"))
+                { stream >> texNormal; }
+                else if (0 == StrICmp(buf, "-OrmMap:"))
+                { stream >> texOrm; }
+                else if (0 == StrICmp(buf, "-EmissiveMap:"))
+                { stream >> texEmissive; }
+
+                stream.ignore(BUFFER_SIZE, '\n');
+            }
+
+            if (tag.empty())
+            {
+                ELOGA("Error : Material Tag is Empty.");
+                return false;
+            }
+
+            if (materialDic.find(tag) == materialDic.end())
+            {
+                Material material  = material.Default();
+                material.BaseColor = baseColor;
+                material.Occlusion = occlusion;
+                material.Roughness = roughness;
+                material.Metalness = metalness;
+                material.Ior       = ior;
+                material.Emissive  = emissive;
+
+                uint32_t baseColorMapId = INVALID_MATERIAL_MAP;
+                uint32_t normalMapId    = INVALID_MATERIAL_MAP;
+                uint32_t ormMapId       = INVALID_MATERIAL_MAP;
+                uint32_t emissiveMapId  = INVALID_MATERIAL_MAP;
+
+                auto getOrRegisterTextureId = [&](std::string& path, uint32_t& retId)
+                {
+                    if (textureDic.find(path) != textureDic.end()) {
+                        retId = textureDic[path];
+                    }
+                    else {
+                        retId = textureIndex;
+                        textureIndex++;
+                        textureDic[path] = retId;
+                        AddTexture(path.c_str());
+                    }
+                };
+
+                if (!texBaseColor.empty())
+                { getOrRegisterTextureId(texBaseColor, baseColorMapId); }
+                if (!texNormal.empty())
+                { getOrRegisterTextureId(texNormal, normalMapId); }
+                if (!texOrm.empty())
+                { getOrRegisterTextureId(texOrm, ormMapId); }
+                if (!texEmissive.empty())
+                { getOrRegisterTextureId(texEmissive, emissiveMapId); }
+
+                // テクスチャIDを設定.
+                material.BaseColorMap = baseColorMapId;
+                material.NormalMap    = normalMapId;
+                material.OrmMap       = ormMapId;
+                material.EmissiveMap  = emissiveMapId;
+
+                AddMaterial(material);
+
+                materialDic[tag] = materialIndex;
+                materialIndex++;
+            }
+        }
+        else if (0 == StrICmp(buf, "instance"))
+        {
+            std::string   instanceTag;
+            std::string   meshTag;
+            std::string   materialTag;
+            Vector3       scale         = Vector3(1.0f, 1.0f, 1.0f);
+            Vector3       rotate        = Vector3(0.0f, 0.0f, 0.0f);
+            Vector3       translation   = Vector3(0.0f, 0.0f, 0.0f);
+
+            for(;;)
+            {
+                stream >> buf;
+                if (!stream || stream.eof())
+                { break; }
+
+                if (0 == strcmp(buf, "};"))
+                { break; }
+                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+                { /* DO_NOTHING */ }
+                else if (0 == StrICmp(buf, "-Tag:"))
+                { stream >> instanceTag; }
+                else if (0 == StrICmp(buf, "-Mesh:"))
+                { stream >> meshTag; }
+                else if (0 == StrICmp(buf, "-Material:"))
+                { stream >> materialTag; }
+                else if (0 == StrICmp(buf, "-Scale:"))
+                { stream >> scale.x >> scale.y >> scale.z; }
+                else if (0 == StrICmp(buf, "-Rotation:"))
+                { stream >> rotate.x >> rotate.y >> rotate.z; }
+                else if (0 == StrICmp(buf, "-Translation:"))
+                { stream >> translation.x >> translation.y >> translation.z; }
+
+                stream.ignore(BUFFER_SIZE, '\n');
+            }
+
+            if (instanceTag.empty() || instanceTag == "")
+            {
+                instanceTag = "r3d::Instance";
+                instanceTag += std::to_string(m_Instances.size());
+            }
+
+            bool findMesh = meshDic.find(meshTag) != meshDic.end();
+            bool findMat  = materialDic.find(materialTag) != materialDic.end();
+
+            if (findMesh && findMat)
+            {
+                Matrix matrix = Matrix::CreateScale(scale)
+                    * Matrix::CreateRotationY(ToRadian(rotate.y))
+                    * Matrix::CreateRotationZ(ToRadian(rotate.z))
+                    * Matrix::CreateRotationX(ToRadian(rotate.x))
+                    * Matrix::CreateTranslation(translation);
+
+                CpuInstance instance;
+                instance.HashTag    = CalcHashTag(instanceTag);
+
+                if (!RegisterHashTag(instanceTagDic, instanceTag, instance.HashTag))
+                { return false; }
+                instance.MaterialId = materialDic[materialTag];
+                instance.MeshId     = meshDic[meshTag];
+                instance.Transform  = FromMatrix(matrix);
+
+                AddInstance(instance);
+            }
+            else
+            {
+                ELOGA("Error : Instance(MeshTag = %s, MaterialTag = %s) is Not Registered. findMesh = %s, findMat = %s", meshTag.c_str(), materialTag.c_str(),
+                    findMesh ? "true" : "false",
+                    findMat ? "true" : "false");
+                return false;
+            }
+        }
+        else if (0 == StrICmp(buf, "ibl"))
+        {
+            std::string path;
+
+            for(;;)
+            {
+                stream >> buf;
+                if (!stream || stream.eof())
+                { break; }
+
+                if (0 == strcmp(buf, "};"))
+                { break; }
+                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+                { /* DO_NOTHING */ }
+                else if (0 == StrICmp(buf, "-Path:"))
+                { stream >> path; }
+
+                stream.ignore(BUFFER_SIZE, '\n');
+            }
+
+            std::string findPath;
+            if (!SearchFilePath(path.c_str(), findPath))
+            {
+                ELOGA("Error : File Not Found. path = %s", path.c_str());
+                return false;
+            }
+
+            SetIBL(path.c_str());
+        }
+        else if (0 == StrICmp(buf, "directional_light"))
+        {
+            Vector3       direction = Vector3(0.0f, -1.0f, 0.0f);
+            Vector3       intensity = Vector3(1.0f, 1.0f, 1.0f);
+            std::string   tag;
+
+            for(;;)
+            {
+                stream >> buf;
+                if (!stream || stream.eof())
+                { break; }
+
+                if (0 == strcmp(buf, "};"))
+                { break; }
+                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+                { /* DO_NOTHING */ }
+                else if (0 == StrICmp(buf, "-Tag:"))
+                { stream >> tag; }
+                else if (0 == StrICmp(buf, "-Direction:"))
+                { stream >> direction.x >> direction.y >> direction.z; }
+                else if (0 == StrICmp(buf, "-Intensity:"))
+                { stream >> intensity.x >> intensity.y >> intensity.z; }
+
+                stream.ignore(BUFFER_SIZE, '\n');
+            }
+
+            if (tag.empty() || tag =="")
+            {
+                tag = "r3d::DirectionalLight";
+                tag += std::to_string(m_Lights.size());
+            }
+
+            Light light;
+            light.HashTag   = CalcHashTag(tag);
+
+            if (!RegisterHashTag(lightTagDic, tag, light.HashTag))
+            { return false; }
+            light.Type      = LIGHT_TYPE_DIRECTIONAL;
+            light.Position  = direction;
+            light.Intensity = intensity;
+            light.Radius    = 1.0f;
+
+            AddLight(light);
+        }
+        else if (0 == StrICmp(buf, "point_light"))
+        {
+            Vector3       position  = Vector3(0.0f, 0.0f, 0.0f);
+            float         radius    = 1.0f;
+            Vector3       intensity = Vector3(0.0f, 0.0f, 0.0f);
+            std::string   tag;
+
+            for(;;)
+            {
+                stream >> buf;
+                if (!stream || stream.eof())
+                { break; }
+
+                if (0 == strcmp(buf, "};"))
+                { break; }
+                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+                { /* DO_NOTHING */ }
+                else if (0 == StrICmp(buf, "-Tag:"))
+                { stream >> tag; }
+                else if (0 == StrICmp(buf, "-Position:"))
+                { stream >> position.x >> position.y >> position.z; }
+                else if (0 == StrICmp(buf, "-Radius:"))
+                { stream >> radius; }
+                else if (0 == StrICmp(buf, "-Intensity:"))
+                { stream >> intensity.x >> intensity.y >> intensity.z; }
+
+                stream.ignore(BUFFER_SIZE, '\n');
+            }
+
+            if (tag.empty() || tag == "")
+            {
+                tag = "r3d::PointLight";
+                tag += std::to_string(m_Lights.size());
+            }
+
+            Light light;
+            light.HashTag   = CalcHashTag(tag);
+
+            if (!RegisterHashTag(lightTagDic, tag, light.HashTag))
+            { return false; }
+            light.Type      = LIGHT_TYPE_POINT;
+            light.Position  = position;
+            light.Radius    = radius;
+            light.Intensity = intensity;
+
+            AddLight(light);
+        }
+        else if (0 == StrICmp(buf, "spot_light"))
+        {
+            ELOGA("Error : spot_light is Not Implemented Yet.");
+            return false;
+        }
+        else if (0 == StrICmp(buf, "export"))
+        {
+            for(;;)
+            {
+                stream >> buf;
+                if (!stream || stream.eof())
+                { break; }
+
+                if (0 == strcmp(buf, "};"))
+                { break; }
+                else if (0 == strcmp(buf, "#") || 0 == strcmp(buf, "//"))
+                { /* DO_NOTHING */ }
+                else if (0 == StrICmp(buf, "-Path:"))
+                { stream >> exportPath; }
+
+                stream.ignore(BUFFER_SIZE, '\n');
+            }
+        }
+
+        stream.ignore(BUFFER_SIZE, '\n');
+    }
+    stream.close();
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルに出力します.
+//-----------------------------------------------------------------------------
+bool SceneExporter::Export(const char* path)
+{
+    std::vector<SectionData> sections;
+
+    // 圧縮と書き込みを重ねるため，ファイルは非同期に書き込む.
+    AsyncFileWriterDesc writerDesc = {};
+    writerDesc.MaxPendingBytes = MAX_PENDING_WRITE;
+
+    AsyncFileWriter writer;
+    if (!writer.Init(writerDesc))
+    {
+        ELOGA("Error : AsyncFileWriter::Init() Failed.");
+        return false;
+    }
+
+    // 大きなペイロードはブロブファイルへ逐次出力し，メモリに溜めない.
+    BlobWriter  blob;
+    BlobWriter* pBlob = nullptr;
+    if (m_BlobSize > 0)
+    {
+        std::random_device device;
+
+        blob.RootPath = path;
+        blob.pWriter  = &writer;
+        blob.MaxSize  = m_BlobSize;
+        blob.BundleId = (uint64_t(device()) << 32) | device();
+        pBlob = &blob;
+    }
+
+    // IBLテクスチャ読み込み.
+    {
+        std::string texPath;
+        if (!SearchFilePath(m_IBL.c_str(), texPath))
+        {
+            ELOGA("Error : File Not Found. path = %s", m_IBL.c_str());
+            return false;
+        }
+
+        TextureData srcIBL;
+        if (!srcIBL.LoadFromFile(texPath.c_str()))
+        {
+            ELOGA("Error : IBL Load Failed. path = %s", texPath.c_str());
+            return false;
+        }
+
+        // 順番補正.
+        if (srcIBL.Format == 2/*DXGI_FORMAT_R32G32B32A32_FLOAT*/)
+        {
+            for(auto& res : srcIBL.Resources)
+            {
+                auto count = res.Pixels.size() / sizeof(float);
+                auto pFloatPixels = reinterpret_cast<float*>(res.Pixels.data());
+
+                for(size_t px=0; px<count; px+=4)
+                {
+                    auto A = pFloatPixels[px + 0];
+                    auto R = pFloatPixels[px + 1];
+                    auto G = pFloatPixels[px + 2];
+                    auto B = pFloatPixels[px + 3];
+
+                    pFloatPixels[px + 0] = R;
+                    pFloatPixels[px + 1] = G;
+                    pFloatPixels[px + 2] = B;
+                    pFloatPixels[px + 3] = A;
+                }
+            }
+        }
+
+        flatbuffers::FlatBufferBuilder builder(2048);
+        auto dstIBL = ToBinaryFormat(builder, srcIBL, m_PlacedFootprint);
+        builder.Finish(r3d::CreateResScene(builder, 0, 0, 0, 0, 0, dstIBL));
+
+        if (!AddSection(sections, SCENE_SECTION_TYPE_IBL, 0, 1, builder, pBlob))
+        { return false; }
+    }
+
+    // マテリアル用テクスチャ読み込み.
+    {
+        // テクスチャ毎に1セクション.
+        for(size_t i=0; i<m_Textures.size(); ++i)
+        {
+            std::string texPath;
+            if (!SearchFilePath(m_Textures[i].c_str(), texPath))
+            {
+                ELOGA("Error : File Not Found. path = %s", m_Textures[i].c_str());
+                return false;
+            }
+
+            TextureData srcTexture;
+            if (!srcTexture.LoadFromFile(texPath.c_str()))
+            {
+                ELOGA("Error : Texture Load Failed. path = %s", texPath.c_str());
+                return false;
+            }
+
+            // フラットバッファのオフセットは32bitなので1セクションに収まる必要がある.
+            uint64_t pixelSize = 0;
+            for(auto& res : srcTexture.Resources)
+            { pixelSize += res.Pixels.size(); }
+
+            if (pixelSize > MAX_SECTION_SIZE)
+            {
+                ELOGA("Error : Texture Too Large. path = %s, size = %llu", texPath.c_str(), (unsigned long long)pixelSize);
+                return false;
+            }
+
+            flatbuffers::FlatBufferBuilder builder(2048);
+            std::vector<flatbuffers::Offset<r3d::ResTexture>> dstTextures;
+            dstTextures.push_back(ToBinaryFormat(builder, srcTexture, m_PlacedFootprint));
+            builder.Finish(r3d::CreateResSceneDirect(builder, 0, 0, 1, 0, 0, 0, nullptr, nullptr, &dstTextures));
+
+            if (!AddSection(sections, SCENE_SECTION_TYPE_TEXTURES, uint32_t(i), 1, builder, pBlob))
+            { return false; }
+        }
+    }
+
+    // メッシュ変換処理
+    {
+        // 小さなメッシュはまとめて1セクションにする.
+        size_t first = 0;
+        while(first < m_Meshes.size())
+        {
+            flatbuffers::FlatBufferBuilder builder(2048);
+            std::vector<flatbuffers::Offset<r3d::ResMesh>> dstMeshes;
+
+            uint64_t rawSize = 0;
+            size_t   last    = first;
+            while(last < m_Meshes.size() && (last == first || rawSize < MESH_SECTION_SIZE))
+            {
+                auto& srcMesh = m_Meshes[last];
+
+                auto meshSize = uint64_t(sizeof(ResVertex)) * srcMesh.VertexCount
+                              + uint64_t(sizeof(uint32_t))  * srcMesh.IndexCount;
+                if (meshSize > MAX_SECTION_SIZE)
+                {
+                    ELOGA("Error : Mesh Too Large. index = %zu, size = %llu", last, (unsigned long long)meshSize);
+                    return false;
+                }
+
+                // まとめると1セクションに収まらない場合は次のセクションに回す.
+                if (last != first && rawSize + meshSize > MAX_SECTION_SIZE)
+                { break; }
+
+                std::vector<ResVertex> vertices(srcMesh.Vertices, srcMesh.Vertices + srcMesh.VertexCount);
+                std::vector<uint32_t>  indices(srcMesh.Indices, srcMesh.Indices + srcMesh.IndexCount);
+
+                dstMeshes.push_back(
+                    r3d::CreateResMeshDirect(
+                        builder,
+                        srcMesh.VertexCount,
+                        srcMesh.IndexCount,
+                        &vertices,
+                        &indices));
+
+                rawSize += meshSize;
+                last++;
+            }
+
+            auto count = uint32_t(last - first);
+            builder.Finish(r3d::CreateResSceneDirect(builder, count, 0, 0, 0, 0, 0, &dstMeshes));
+
+            if (!AddSection(sections, SCENE_SECTION_TYPE_MESHES, uint32_t(first), count, builder, pBlob))
+            { return false; }
+            first = last;
+        }
+    }
+
+    // マテリアル変換処理.
+    if (!m_Materials.empty())
+    {
+        std::vector<r3d::ResMaterial> dstMaterials;
+
+        for(size_t i=0; i<m_Materials.size(); ++i)
+        {
+            r3d::ResMaterial item(
+                m_Materials[i].BaseColorMap,
+                m_Materials[i].NormalMap,
+                m_Materials[i].OrmMap,
+                m_Materials[i].EmissiveMap,
+
+                ToBinaryFormat(m_Materials[i].BaseColor),
+                m_Materials[i].Occlusion,
+                m_Materials[i].Roughness,
+                m_Materials[i].Metalness,
+                m_Materials[i].Ior,
+                ToBinaryFormat(m_Materials[i].Emissive)
+            );
+
+            dstMaterials.push_back(item);
+        }
+
+        auto count = uint32_t(dstMaterials.size());
+
+        flatbuffers::FlatBufferBuilder builder(2048);
+        builder.Finish(r3d::CreateResSceneDirect(
+            builder, 0, 0, 0, count, 0, 0, nullptr, nullptr, nullptr, &dstMaterials));
+
+        if (!AddSection(sections, SCENE_SECTION_TYPE_MATERIALS, 0, count, builder))
+        { return false; }
+    }
+
+    // ライト変換処理.
+    if (!m_Lights.empty())
+    {
+        std::vector<r3d::ResLight>  dstLights;
+        std::vector<uint32_t>       lightTags;
+
+        for(size_t i=0; i<m_Lights.size(); ++i)
+        {
+            r3d::ResLight item(
+                m_Lights[i].Type,
+                r3d::Vector3(m_Lights[i].Intensity.x, m_Lights[i].Intensity.y, m_Lights[i].Intensity.z),
+                r3d::Vector3(m_Lights[i].Position .x, m_Lights[i].Position .y, m_Lights[i].Position .z),
+                m_Lights[i].Radius);
+
+            dstLights.push_back(item);
+
+            auto hashTag = m_Lights[i].HashTag;
+            lightTags.push_back(hashTag);
+        }
+
+        auto count = uint32_t(dstLights.size());
+
+        // 実行時に辞書を作らなくて済むように最小完全ハッシュ表を格納する.
+        std::vector<int32_t>        seeds;
+        std::vector<ResTagSlot>     slots;
+        if (!BuildTagTable(lightTags.data(), count, seeds, slots))
+        {
+            ELOGA("Error : Light Hash Tag Duplicated.");
+            return false;
+        }
+
+        flatbuffers::FlatBufferBuilder builder(2048);
+        builder.Finish(r3d::CreateResSceneDirect(
+            builder, 0, 0, 0, 0, count, 0, nullptr, nullptr, nullptr, nullptr, &dstLights, nullptr, &lightTags,
+            nullptr, nullptr, &seeds, &slots));
+
+        if (!AddSection(sections, SCENE_SECTION_TYPE_LIGHTS, 0, count, builder))
+        { return false; }
+    }
+
+    // インスタンス変換処理.
+    if (!m_Instances.empty())
+    {
+        std::vector<r3d::ResInstance>   dstInstances;
+        std::vector<uint32_t>           instanceTags;
+
+        for(size_t i=0; i<m_Instances.size(); ++i)
+        {
+            auto& srcMtx = m_Instances[i].Transform;
+            r3d::Matrix3x4 dstMtx(
+                r3d::Vector4(srcMtx.m[0][0], srcMtx.m[0][1], srcMtx.m[0][2], srcMtx.m[0][3]),
+                r3d::Vector4(srcMtx.m[1][0], srcMtx.m[1][1], srcMtx.m[1][2], srcMtx.m[1][3]),
+                r3d::Vector4(srcMtx.m[2][0], srcMtx.m[2][1], srcMtx.m[2][2], srcMtx.m[2][3]));
+
+            r3d::ResInstance item(
+                m_Instances[i].MeshId,
+                m_Instances[i].MaterialId,
+                dstMtx);
+
+            dstInstances.push_back(item);
+
+            auto hashTag = m_Instances[i].HashTag;
+            instanceTags.push_back(hashTag);
+        }
+
+        auto count = uint32_t(dstInstances.size());
+
+        std::vector<int32_t>        seeds;
+        std::vector<ResTagSlot>     slots;
+        if (!BuildTagTable(instanceTags.data(), count, seeds, slots))
+        {
+            ELOGA("Error : Instance Hash Tag Duplicated.");
+            return false;
+        }
+
+        flatbuffers::FlatBufferBuilder builder(2048);
+        builder.Finish(r3d::CreateResSceneDirect(
+            builder, 0, count, 0, 0, 0, 0, nullptr, &dstInstances, nullptr, nullptr, nullptr, &instanceTags, nullptr,
+            &seeds, &slots));
+
+        if (!AddSection(sections, SCENE_SECTION_TYPE_INSTANCES, 0, count, builder))
+        { return false; }
+    }
+
+    // 出力処理.
+    {
+        SceneContainerHeader header = {};
+        header.Magic            = SCENE_CONTAINER_MAGIC;
+        header.Version          = SCENE_CONTAINER_VERSION;
+        header.SectionCount     = uint32_t(sections.size());
+        header.MeshCount        = uint32_t(m_Meshes   .size());
+        header.InstanceCount    = uint32_t(m_Instances.size());
+        header.TextureCount     = uint32_t(m_Textures .size());
+        header.MaterialCount    = uint32_t(m_Materials.size());
+        header.LightCount       = uint32_t(m_Lights   .size());
+        header.BlobCount        = blob.FileCount;
+        header.BundleId         = blob.BundleId;
+
+        // ブロブファイルの書き込み結果もルートファイルと一緒に確認する.
+        CloseBlob(blob);
+
+        auto writingPath = GetWritingPath(path);
+        if (!WriteContainer(writer, writingPath.c_str(), header, sections))
+        {
+            remove(writingPath.c_str());
+            return false;
+        }
+
+        // ルートファイルの BundleId と揃うのは全て置き換えた後.
+        for(auto i=1u; i<=blob.FileCount; ++i)
+        {
+            if (!CommitFile(GetSceneBlobPath(path, i)))
+            { return false; }
+        }
+
+        if (!CommitFile(path))
+        { return false; }
+
+        ILOGA("Info : Scene File Exported!! path = %s", path);
+    }
+
+    // 正常終了.
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      リセットします.
+//-----------------------------------------------------------------------------
+void SceneExporter::Reset()
+{
+    for(size_t i=0; i<m_Meshes.size(); ++i)
+    {
+        if (m_Meshes[i].Vertices != nullptr)
+        { delete[] m_Meshes[i].Vertices; }
+
+        if (m_Meshes[i].Indices != nullptr)
+        { delete[] m_Meshes[i].Indices; }
+    }
+
+    m_Lights   .clear();
+    m_Meshes   .clear();
+    m_Materials.clear();
+    m_Instances.clear();
+    m_Textures .clear();
+}
+
+//-----------------------------------------------------------------------------
+//      ライトを追加します.
+//-----------------------------------------------------------------------------
+void SceneExporter::AddLight(const Light& value)
+{ m_Lights.emplace_back(value); }
+
+//-----------------------------------------------------------------------------
+//      メッシュを追加します.
+//-----------------------------------------------------------------------------
+void SceneExporter::AddMesh(const Mesh& value)
+{ m_Meshes.emplace_back(value); }
+
+//-----------------------------------------------------------------------------
+//      メッシュを追加します.
+//-----------------------------------------------------------------------------
+void SceneExporter::AddMeshes(const std::vector<Mesh>& values)
+{ m_Meshes.insert(m_Meshes.end(), values.begin(), values.end()); }
+
+//-----------------------------------------------------------------------------
+//      マテリアルを追加します.
+//-----------------------------------------------------------------------------
+void SceneExporter::AddMaterial(const Material& value)
+{ m_Materials.emplace_back(value); }
+
+//-----------------------------------------------------------------------------
+//      インスタンスを追加します.
+//-----------------------------------------------------------------------------
+void SceneExporter::AddInstance(const CpuInstance& value)
+{ m_Instances.emplace_back(value); }
+
+//-----------------------------------------------------------------------------
+//      インスタンスを追加します.
+//-----------------------------------------------------------------------------
+void SceneExporter::AddInstances(const std::vector<CpuInstance>& values)
+{ m_Instances.insert(m_Instances.end(), values.begin(), values.end()); }
+
+//-----------------------------------------------------------------------------
+//      テクスチャを追加します.
+//-----------------------------------------------------------------------------
+void SceneExporter::AddTexture(const char* path)
+{ m_Textures.push_back(path); }
+
+//-----------------------------------------------------------------------------
+//      IBLを設定します.
+//-----------------------------------------------------------------------------
+void SceneExporter::SetIBL(const char* path)
+{ m_IBL = path; }
+
+//-----------------------------------------------------------------------------
+//      テクスチャをアップロードバッファの配置で出力するかどうか設定します.
+//-----------------------------------------------------------------------------
+void SceneExporter::SetPlacedFootprint(bool value)
+{ m_PlacedFootprint = value; }
+
+//-----------------------------------------------------------------------------
+//      ブロブファイル1つあたりの最大サイズを設定します.
+//-----------------------------------------------------------------------------
+void SceneExporter::SetBlobSize(uint64_t value)
+{ m_BlobSize = value; }
+
+//-----------------------------------------------------------------------------
+//      メッシュをロードします.
+//-----------------------------------------------------------------------------
+bool LoadMesh(const char* path, std::vector<Mesh>& result, std::vector<MeshInfo>& infos)
+{
+    std::string meshPath;
+    if (!SearchFilePath(path, meshPath))
+    {
+        ELOGA("Error : File Not Found. path = %s", path);
+        return false;
+    }
+
+    ModelOBJ  model;
+    OBJLoader loader;
+    if (!loader.Load(meshPath.c_str(), model))
+    {
+        ELOGA("Error : Model Load Failed. path = %s", meshPath.c_str());
+        return false;
+    }
+
+    result.resize(model.Meshes.size());
+    infos .resize(model.Meshes.size());
+
+    for(size_t i=0; i<model.Meshes.size(); ++i)
+    {
+        auto& srcMesh = model.Meshes[i];
+        auto& dstMesh = result[i];
+
+        infos[i].MeshName     = srcMesh.Name;
+        infos[i].MaterialName = srcMesh.MaterialName;
+
+        auto vertexCount = uint32_t(srcMesh.Vertices.size());
+        auto indexCount  = uint32_t(srcMesh.Indices.size());
+
+        dstMesh.VertexCount = vertexCount;
+        dstMesh.IndexCount  = indexCount;
+
+        dstMesh.Vertices = new ResVertex[vertexCount];
+        dstMesh.Indices  = new uint32_t [indexCount];
+
+        for(uint32_t j=0; j<vertexCount; ++j)
+        {
+            auto& srcVtx = srcMesh.Vertices[j];
+            dstMesh.Vertices[j] = ResVertex(
+                r3d::Vector3(srcVtx.Position.x, srcVtx.Position.y, srcVtx.Position.z),
+                r3d::Vector3(srcVtx.Normal  .x, srcVtx.Normal  .y, srcVtx.Normal  .z),
+                r3d::Vector3(srcVtx.Tangent .x, srcVtx.Tangent .y, srcVtx.Tangent .z),
+                r3d::Vector2(srcVtx.TexCoord.x, srcVtx.TexCoord.y)
+            );
+        }
+
+        for(uint32_t j=0; j<indexCount; ++j)
+        { dstMesh.Indices[j] = srcMesh.Indices[j]; }
+    }
+
+    return true;
+}
+
+} // namespace offline
+} // namespace r3d
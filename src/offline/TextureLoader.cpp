@@ -0,0 +1,393 @@
+﻿//-----------------------------------------------------------------------------
+// File : TextureLoader.cpp
+// Desc : Portable Texture Loader for Offline Tools.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <offline/TextureLoader.h>
+#include <Platform.h>
+#include <algorithm>
+#include <cstring>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t DDS_MAGIC             = 0x20534444;   // "DDS "
+static const uint32_t DDPF_ALPHA            = 0x00000002;
+static const uint32_t DDPF_FOURCC           = 0x00000004;
+static const uint32_t DDPF_RGB              = 0x00000040;
+static const uint32_t DDPF_LUMINANCE        = 0x00020000;
+static const uint32_t DDSCAPS2_CUBEMAP      = 0x00000200;
+static const uint32_t DDSCAPS2_VOLUME       = 0x00200000;
+static const uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+static const uint32_t DDS_DIMENSION_TEXTURE1D = 2;
+static const uint32_t DDS_DIMENSION_TEXTURE3D = 4;
+
+// DXGI_FORMAT の値 (d3d12 に依存しないように数値で定義).
+static const uint32_t FORMAT_R32G32B32A32_FLOAT = 2;
+static const uint32_t FORMAT_R16G16B16A16_FLOAT = 10;
+static const uint32_t FORMAT_R16G16B16A16_UNORM = 11;
+static const uint32_t FORMAT_R16G16B16A16_SNORM = 13;
+static const uint32_t FORMAT_R32G32_FLOAT       = 16;
+static const uint32_t FORMAT_R10G10B10A2_UNORM  = 24;
+static const uint32_t FORMAT_R8G8B8A8_UNORM     = 28;
+static const uint32_t FORMAT_R16G16_FLOAT       = 34;
+static const uint32_t FORMAT_R16G16_UNORM       = 35;
+static const uint32_t FORMAT_R32_FLOAT          = 41;
+static const uint32_t FORMAT_R8G8_UNORM         = 49;
+static const uint32_t FORMAT_R16_FLOAT          = 54;
+static const uint32_t FORMAT_R16_UNORM          = 56;
+static const uint32_t FORMAT_R8_UNORM           = 61;
+static const uint32_t FORMAT_A8_UNORM           = 65;
+static const uint32_t FORMAT_R8G8_B8G8_UNORM    = 68;
+static const uint32_t FORMAT_G8R8_G8B8_UNORM    = 69;
+static const uint32_t FORMAT_BC1_UNORM          = 71;
+static const uint32_t FORMAT_BC2_UNORM          = 74;
+static const uint32_t FORMAT_BC3_UNORM          = 77;
+static const uint32_t FORMAT_BC4_UNORM          = 80;
+static const uint32_t FORMAT_BC4_SNORM          = 81;
+static const uint32_t FORMAT_BC5_UNORM          = 83;
+static const uint32_t FORMAT_BC5_SNORM          = 84;
+static const uint32_t FORMAT_B5G6R5_UNORM       = 85;
+static const uint32_t FORMAT_B5G5R5A1_UNORM     = 86;
+static const uint32_t FORMAT_B8G8R8A8_UNORM     = 87;
+static const uint32_t FORMAT_B8G8R8X8_UNORM     = 88;
+static const uint32_t FORMAT_B4G4R4A4_UNORM     = 115;
+
+///////////////////////////////////////////////////////////////////////////////
+// DDS_PIXEL_FORMAT structure
+///////////////////////////////////////////////////////////////////////////////
+struct DDS_PIXEL_FORMAT
+{
+    uint32_t    Size;
+    uint32_t    Flags;
+    uint32_t    FourCC;
+    uint32_t    RGBBitCount;
+    uint32_t    RBitMask;
+    uint32_t    GBitMask;
+    uint32_t    BBitMask;
+    uint32_t    ABitMask;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DDS_HEADER structure
+///////////////////////////////////////////////////////////////////////////////
+struct DDS_HEADER
+{
+    uint32_t            Size;
+    uint32_t            Flags;
+    uint32_t            Height;
+    uint32_t            Width;
+    uint32_t            PitchOrLinearSize;
+    uint32_t            Depth;
+    uint32_t            MipMapCount;
+    uint32_t            Reserved1[11];
+    DDS_PIXEL_FORMAT    PixelFormat;
+    uint32_t            Caps;
+    uint32_t            Caps2;
+    uint32_t            Caps3;
+    uint32_t            Caps4;
+    uint32_t            Reserved2;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// DDS_HEADER_DXT10 structure
+///////////////////////////////////////////////////////////////////////////////
+struct DDS_HEADER_DXT10
+{
+    uint32_t    Format;
+    uint32_t    ResourceDimension;
+    uint32_t    MiscFlag;
+    uint32_t    ArraySize;
+    uint32_t    MiscFlags2;
+};
+
+static_assert(sizeof(DDS_HEADER) == 124, "DDS_HEADER size not matched!");
+static_assert(sizeof(DDS_HEADER_DXT10) == 20, "DDS_HEADER_DXT10 size not matched!");
+
+//-----------------------------------------------------------------------------
+//      FourCCを生成します.
+//-----------------------------------------------------------------------------
+constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+{
+    return uint32_t(uint8_t(a))
+        | (uint32_t(uint8_t(b)) << 8)
+        | (uint32_t(uint8_t(c)) << 16)
+        | (uint32_t(uint8_t(d)) << 24);
+}
+
+//-----------------------------------------------------------------------------
+//      ビットマスクが一致するかどうか?
+//-----------------------------------------------------------------------------
+bool IsBitMask(const DDS_PIXEL_FORMAT& pf, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+{ return pf.RBitMask == r && pf.GBitMask == g && pf.BBitMask == b && pf.ABitMask == a; }
+
+//-----------------------------------------------------------------------------
+//      旧形式のピクセルフォーマットからDXGI_FORMATを取得します.
+//-----------------------------------------------------------------------------
+uint32_t GetFormat(const DDS_PIXEL_FORMAT& pf)
+{
+    if (pf.Flags & DDPF_RGB)
+    {
+        switch(pf.RGBBitCount)
+        {
+        case 32:
+            if (IsBitMask(pf, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+            { return FORMAT_R8G8B8A8_UNORM; }
+            if (IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+            { return FORMAT_B8G8R8A8_UNORM; }
+            if (IsBitMask(pf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000))
+            { return FORMAT_B8G8R8X8_UNORM; }
+            if (IsBitMask(pf, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+            { return FORMAT_R10G10B10A2_UNORM; }
+            if (IsBitMask(pf, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+            { return FORMAT_R16G16_UNORM; }
+            if (IsBitMask(pf, 0xffffffff, 0x00000000, 0x00000000, 0x00000000))
+            { return FORMAT_R32_FLOAT; }
+            break;
+
+        case 16:
+            if (IsBitMask(pf, 0x7c00, 0x03e0, 0x001f, 0x8000))
+            { return FORMAT_B5G5R5A1_UNORM; }
+            if (IsBitMask(pf, 0xf800, 0x07e0, 0x001f, 0x0000))
+            { return FORMAT_B5G6R5_UNORM; }
+            if (IsBitMask(pf, 0x0f00, 0x00f0, 0x000f, 0xf000))
+            { return FORMAT_B4G4R4A4_UNORM; }
+            break;
+        }
+    }
+    else if (pf.Flags & DDPF_LUMINANCE)
+    {
+        if (pf.RGBBitCount == 8 && IsBitMask(pf, 0xff, 0, 0, 0))
+        { return FORMAT_R8_UNORM; }
+        if (pf.RGBBitCount == 16 && IsBitMask(pf, 0xffff, 0, 0, 0))
+        { return FORMAT_R16_UNORM; }
+        if (pf.RGBBitCount == 16 && IsBitMask(pf, 0x00ff, 0, 0, 0xff00))
+        { return FORMAT_R8G8_UNORM; }
+    }
+    else if (pf.Flags & DDPF_ALPHA)
+    {
+        if (pf.RGBBitCount == 8)
+        { return FORMAT_A8_UNORM; }
+    }
+    else if (pf.Flags & DDPF_FOURCC)
+    {
+        switch(pf.FourCC)
+        {
+        case MakeFourCC('D', 'X', 'T', '1'): return FORMAT_BC1_UNORM;
+        case MakeFourCC('D', 'X', 'T', '2'): return FORMAT_BC2_UNORM;
+        case MakeFourCC('D', 'X', 'T', '3'): return FORMAT_BC2_UNORM;
+        case MakeFourCC('D', 'X', 'T', '4'): return FORMAT_BC3_UNORM;
+        case MakeFourCC('D', 'X', 'T', '5'): return FORMAT_BC3_UNORM;
+        case MakeFourCC('A', 'T', 'I', '1'): return FORMAT_BC4_UNORM;
+        case MakeFourCC('B', 'C', '4', 'U'): return FORMAT_BC4_UNORM;
+        case MakeFourCC('B', 'C', '4', 'S'): return FORMAT_BC4_SNORM;
+        case MakeFourCC('A', 'T', 'I', '2'): return FORMAT_BC5_UNORM;
+        case MakeFourCC('B', 'C', '5', 'U'): return FORMAT_BC5_UNORM;
+        case MakeFourCC('B', 'C', '5', 'S'): return FORMAT_BC5_SNORM;
+        case MakeFourCC('R', 'G', 'B', 'G'): return FORMAT_R8G8_B8G8_UNORM;
+        case MakeFourCC('G', 'R', 'G', 'B'): return FORMAT_G8R8_G8B8_UNORM;
+
+        // D3DFORMAT の数値がそのまま格納されているもの.
+        case 36:  return FORMAT_R16G16B16A16_UNORM;
+        case 110: return FORMAT_R16G16B16A16_SNORM;
+        case 111: return FORMAT_R16_FLOAT;
+        case 112: return FORMAT_R16G16_FLOAT;
+        case 113: return FORMAT_R16G16B16A16_FLOAT;
+        case 114: return FORMAT_R32_FLOAT;
+        case 115: return FORMAT_R32G32_FLOAT;
+        case 116: return FORMAT_R32G32B32A32_FLOAT;
+        }
+    }
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+//      サブリソースのサイズを計算します.
+//-----------------------------------------------------------------------------
+void CalcSurfaceInfo
+(
+    uint32_t    width,
+    uint32_t    height,
+    uint32_t    format,
+    uint32_t&   rowPitch,
+    uint32_t&   slicePitch
+)
+{
+    using namespace r3d;
+
+    if (IsBlockCompressed(format))
+    {
+        auto blockBytes = (GetBitsPerPixel(format) == 4) ? 8u : 16u;
+        auto blockW     = std::max(1u, (width  + 3) / 4);
+        auto blockH     = std::max(1u, (height + 3) / 4);
+        rowPitch   = blockW * blockBytes;
+        slicePitch = rowPitch * blockH;
+    }
+    else if (format == FORMAT_R8G8_B8G8_UNORM || format == FORMAT_G8R8_G8B8_UNORM)
+    {
+        rowPitch   = ((width + 1) >> 1) * 4;
+        slicePitch = rowPitch * height;
+    }
+    else
+    {
+        auto bpp = GetBitsPerPixel(format);
+        rowPitch   = (width * bpp + 7) / 8;
+        slicePitch = rowPitch * height;
+    }
+}
+
+} // namespace
+
+
+namespace r3d {
+namespace offline {
+
+//-----------------------------------------------------------------------------
+//      ファイルからロードします.
+//-----------------------------------------------------------------------------
+bool TextureData::LoadFromFile(const char* path)
+{
+    auto ext = GetExt(path);
+    if (ext != "dds")
+    {
+        ELOGA("Error : Unsupported Texture Format. path = %s", path);
+        return false;
+    }
+
+    auto fp = OpenFile(path, "rb");
+    if (fp == nullptr)
+    {
+        ELOGA("Error : File Open Failed. path = %s", path);
+        return false;
+    }
+
+    uint32_t magic = 0;
+    DDS_HEADER header = {};
+    if (fread(&magic, sizeof(magic), 1, fp) != 1
+     || magic != DDS_MAGIC
+     || fread(&header, sizeof(header), 1, fp) != 1
+     || header.Size != sizeof(DDS_HEADER))
+    {
+        ELOGA("Error : Invalid DDS File. path = %s", path);
+        fclose(fp);
+        return false;
+    }
+
+    auto arraySize = 1u;
+    auto isCube    = false;
+    auto isVolume  = false;
+    auto isArray1D = false;
+
+    Width       = header.Width;
+    Height      = std::max(1u, header.Height);
+    Depth       = 1;
+    MipMapCount = std::max(1u, header.MipMapCount);
+
+    if ((header.PixelFormat.Flags & DDPF_FOURCC) && header.PixelFormat.FourCC == MakeFourCC('D', 'X', '1', '0'))
+    {
+        DDS_HEADER_DXT10 ext10 = {};
+        if (fread(&ext10, sizeof(ext10), 1, fp) != 1)
+        {
+            ELOGA("Error : Invalid DDS File. path = %s", path);
+            fclose(fp);
+            return false;
+        }
+
+        Format    = ext10.Format;
+        arraySize = std::max(1u, ext10.ArraySize);
+        isCube    = (ext10.MiscFlag & DDS_RESOURCE_MISC_TEXTURECUBE) != 0;
+        isVolume  = (ext10.ResourceDimension == DDS_DIMENSION_TEXTURE3D);
+        isArray1D = (ext10.ResourceDimension == DDS_DIMENSION_TEXTURE1D);
+    }
+    else
+    {
+        Format   = GetFormat(header.PixelFormat);
+        isCube   = (header.Caps2 & DDSCAPS2_CUBEMAP) != 0;
+        isVolume = (header.Caps2 & DDSCAPS2_VOLUME) != 0;
+    }
+
+    if (Format == 0 || GetBitsPerPixel(Format) == 0)
+    {
+        ELOGA("Error : Unsupported DDS Pixel Format. path = %s", path);
+        fclose(fp);
+        return false;
+    }
+
+    if (isVolume)
+    {
+        Dimension    = TEXTURE_DIMENSION_3D;
+        Depth        = std::max(1u, header.Depth);
+        SurfaceCount = 1;
+    }
+    else if (isCube)
+    {
+        Dimension    = TEXTURE_DIMENSION_CUBE;
+        SurfaceCount = arraySize * 6;
+    }
+    else if (isArray1D)
+    {
+        Dimension    = TEXTURE_DIMENSION_1D;
+        SurfaceCount = arraySize;
+    }
+    else
+    {
+        Dimension    = TEXTURE_DIMENSION_2D;
+        SurfaceCount = arraySize;
+    }
+
+    // DDS ファイルはサーフェイス毎にミップマップが並ぶので D3D12 のサブリソース順と一致する.
+    Resources.resize(size_t(SurfaceCount) * MipMapCount);
+
+    auto idx = 0u;
+    for(auto i=0u; i<SurfaceCount; ++i)
+    {
+        auto w = Width;
+        auto h = Height;
+        auto d = Depth;
+
+        for(auto m=0u; m<MipMapCount; ++m)
+        {
+            auto& res = Resources[idx++];
+            res.Width    = w;
+            res.Height   = h;
+            res.MipIndex = m;
+            CalcSurfaceInfo(w, h, Format, res.Pitch, res.SlicePitch);
+
+            res.Pixels.resize(size_t(res.SlicePitch) * d);
+            if (fread(res.Pixels.data(), 1, res.Pixels.size(), fp) != res.Pixels.size())
+            {
+                ELOGA("Error : Unexpected End Of File. path = %s", path);
+                fclose(fp);
+                Dispose();
+                return false;
+            }
+
+            w = std::max(1u, w >> 1);
+            h = std::max(1u, h >> 1);
+            d = std::max(1u, d >> 1);
+        }
+    }
+
+    fclose(fp);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      メモリを解放します.
+//-----------------------------------------------------------------------------
+void TextureData::Dispose()
+{
+    Resources.clear();
+    Resources.shrink_to_fit();
+}
+
+} // namespace offline
+} // namespace r3d
@@ -0,0 +1,231 @@
+﻿//-----------------------------------------------------------------------------
+// File : main.cpp
+// Desc : Mesh Buffer Arena Benchmark.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <BufferArena.h>
+#include <Platform.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+// メッシュバッファのブロックサイズとアライメント (ModelManager と同じ).
+static const uint64_t MESH_BLOCK_SIZE           = 64 * 1024 * 1024;
+static const uint64_t MESH_ALIGNMENT            = 256;
+// 従来のコミットリソースの配置単位.
+static const uint64_t COMMITTED_PLACEMENT       = 64 * 1024;
+static const uint64_t MIN_MESH_SIZE             = 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+// Option structure
+///////////////////////////////////////////////////////////////////////////////
+struct Option
+{
+    uint32_t    MeshCount       = 20000;
+    uint64_t    MaxMeshSize     = 1024 * 1024;
+    uint32_t    ReloadCount     = 50;
+    double      ReloadRatio     = 0.25;
+    uint32_t    IterationCount  = 5;
+    uint32_t    Seed            = 1234;
+};
+
+//-----------------------------------------------------------------------------
+//      メッシュのサイズを生成します (対数一様分布).
+//-----------------------------------------------------------------------------
+std::vector<uint64_t> GenerateSizes(const Option& option)
+{
+    std::mt19937 rng(option.Seed);
+    std::uniform_real_distribution<double> dist(
+        std::log(double(MIN_MESH_SIZE)),
+        std::log(double(option.MaxMeshSize)));
+
+    std::vector<uint64_t> result(option.MeshCount);
+    for(auto& size : result)
+    { size = uint64_t(std::exp(dist(rng))); }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      経過時間[ns]を求めます.
+//-----------------------------------------------------------------------------
+double GetNanoSec(std::chrono::steady_clock::time_point begin)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+//-----------------------------------------------------------------------------
+//      使用方法を表示します.
+//-----------------------------------------------------------------------------
+void PrintUsage()
+{
+    printf("Usage : arenabench [options]\n");
+    printf("Options :\n");
+    printf("    -m <count>                  : mesh count (default: 20000).\n");
+    printf("    -s <KiB>                    : max mesh size (default: 1024).\n");
+    printf("    -r <count>                  : reload count (default: 50).\n");
+    printf("    -p <ratio>                  : meshes replaced per reload (default: 0.25).\n");
+    printf("    -n <count>                  : iteration count, best time is reported (default: 5).\n");
+    printf("    -x <seed>                   : random seed (default: 1234).\n");
+    printf("    -h                          : show this message.\n");
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドライン引数を解析します.
+//-----------------------------------------------------------------------------
+bool ParseArgs(int argc, char** argv, Option& option)
+{
+    for(auto i=1; i<argc; ++i)
+    {
+        auto arg = argv[i];
+        auto hasNext = (i + 1 < argc);
+
+        if (0 == strcmp(arg, "-h") || 0 == strcmp(arg, "--help"))
+        { return false; }
+        else if (0 == strcmp(arg, "-m") && hasNext)
+        { option.MeshCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-s") && hasNext)
+        { option.MaxMeshSize = uint64_t(strtoull(argv[++i], nullptr, 10)) * 1024; }
+        else if (0 == strcmp(arg, "-r") && hasNext)
+        { option.ReloadCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-p") && hasNext)
+        { option.ReloadRatio = strtod(argv[++i], nullptr); }
+        else if (0 == strcmp(arg, "-n") && hasNext)
+        { option.IterationCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-x") && hasNext)
+        { option.Seed = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else
+        {
+            ELOGA("Error : Unknown Option. option = %s", arg);
+            return false;
+        }
+    }
+
+    if (option.IterationCount == 0)
+    { option.IterationCount = 1; }
+
+    return option.MeshCount > 0
+        && option.MaxMeshSize > MIN_MESH_SIZE
+        && option.ReloadRatio >= 0.0 && option.ReloadRatio <= 1.0;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Option option;
+    if (!ParseArgs(argc, argv, option))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    auto sizes = GenerateSizes(option);
+
+    uint64_t requested = 0;
+    uint64_t committed = 0;
+    for(auto size : sizes)
+    {
+        requested += size;
+
+        // 従来は VB と IB を別々のリソースにしていた (インデックスは 1/4 程度とみなす).
+        auto ib = size / 4;
+        auto vb = size - ib;
+        committed += (vb + COMMITTED_PLACEMENT - 1) & ~(COMMITTED_PLACEMENT - 1);
+        committed += (ib + COMMITTED_PLACEMENT - 1) & ~(COMMITTED_PLACEMENT - 1);
+    }
+
+    double bestLoadNs   = 0.0;
+    double bestReloadNs = 0.0;
+    uint64_t reloadOps  = 0;
+    r3d::ArenaStats loadStats;
+    r3d::ArenaStats reloadStats;
+
+    for(auto iter=0u; iter<option.IterationCount; ++iter)
+    {
+        r3d::BufferArena arena;
+        if (!arena.Init(MESH_BLOCK_SIZE, MESH_ALIGNMENT))
+        {
+            ELOGA("Error : BufferArena::Init() Failed.");
+            return EXIT_FAILURE;
+        }
+
+        std::vector<r3d::ArenaAllocation> allocs(sizes.size());
+
+        // 初回ロード.
+        auto begin = std::chrono::steady_clock::now();
+        for(size_t i=0; i<sizes.size(); ++i)
+        {
+            if (!arena.Alloc(sizes[i], allocs[i]))
+            {
+                ELOGA("Error : BufferArena::Alloc() Failed. size = %llu", (unsigned long long)sizes[i]);
+                return EXIT_FAILURE;
+            }
+        }
+        auto loadNs = GetNanoSec(begin);
+        loadStats = arena.GetStats();
+
+        // ホットリロードで一部のメッシュを差し替え続ける.
+        std::mt19937 rng(option.Seed + 1);
+        std::uniform_int_distribution<size_t> pick(0, sizes.size() - 1);
+        auto replaceCount = size_t(double(sizes.size()) * option.ReloadRatio);
+
+        reloadOps = 0;
+        begin = std::chrono::steady_clock::now();
+        for(auto r=0u; r<option.ReloadCount; ++r)
+        {
+            for(size_t i=0; i<replaceCount; ++i)
+            {
+                auto index = pick(rng);
+                arena.Free(allocs[index]);
+                if (!arena.Alloc(sizes[pick(rng)], allocs[index]))
+                {
+                    ELOGA("Error : BufferArena::Alloc() Failed.");
+                    return EXIT_FAILURE;
+                }
+                reloadOps++;
+            }
+        }
+        auto reloadNs = GetNanoSec(begin);
+        reloadStats = arena.GetStats();
+
+        if (iter == 0 || loadNs < bestLoadNs)
+        { bestLoadNs = loadNs; }
+        if (iter == 0 || reloadNs < bestReloadNs)
+        { bestReloadNs = reloadNs; }
+    }
+
+    auto MiB = [](uint64_t size) { return double(size) / (1024.0 * 1024.0); };
+
+    printf("%u meshes, %.2f MiB requested, block %.0f MiB, alignment %llu\n",
+        option.MeshCount, MiB(requested), MiB(MESH_BLOCK_SIZE), (unsigned long long)MESH_ALIGNMENT);
+    printf("    %-10s %10s %12s %8s %8s %10s %8s\n", "phase", "ns/op", "capacity[MiB]", "blocks", "dedic", "used[MiB]", "frag");
+    printf("    %-10s %10.1f %12.2f %8u %8u %10.2f %7.2f%%\n", "load",
+        bestLoadNs / double(option.MeshCount), MiB(loadStats.Capacity),
+        loadStats.BlockCount, loadStats.DedicatedCount, MiB(loadStats.UsedSize), loadStats.GetFragmentation() * 100.0);
+    printf("    %-10s %10.1f %12.2f %8u %8u %10.2f %7.2f%%\n", "reload",
+        (reloadOps > 0) ? bestReloadNs / double(reloadOps) : 0.0, MiB(reloadStats.Capacity),
+        reloadStats.BlockCount, reloadStats.DedicatedCount, MiB(reloadStats.UsedSize), reloadStats.GetFragmentation() * 100.0);
+    printf("    committed placement (64 KiB per VB/IB) : %.2f MiB\n", MiB(committed));
+
+    return EXIT_SUCCESS;
+}
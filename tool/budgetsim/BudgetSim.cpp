@@ -0,0 +1,237 @@
+﻿//-----------------------------------------------------------------------------
+// File : BudgetSim.cpp
+// Desc : Frame Time Budget Simulation.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BudgetSim.h"
+#include <BudgetScheduler.h>
+#include <CaptureJournal.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+// 以下は RendererApp と同じ値.
+static const uint32_t PROBE_RENDER_COUNT    = 4;        // 事前パスで1フレームあたりに描画する回数.
+static const uint32_t MAX_PROBE_COUNT       = 32;       // 事前パスで計測するフレーム数の上限.
+static const uint32_t PROBE_INTERVAL        = 4;        // 事前パスで計測するフレームの最小の間隔.
+static const double   MIN_PROBE_SAMPLES     = 8.0;      // 1フレームあたりの描画回数がこれより少なければ割り振る余地が無いので事前パスを止める.
+static const double   PROBE_BUDGET_RATIO    = 0.03;     // 事前パスに使う残り時間の割合の上限.
+static const double   MIN_SCHEDULE_SCALE    = 0.5;
+static const double   MAX_SCHEDULE_SCALE    = 2.0;
+static const double   MIN_SCHEDULE_SAMPLES  = 2.0;      // 1フレームに割り振る最低限のサンプル数.
+static const uint32_t REPORT_DELAY          = 2;        // 描画結果のノイズがワーカーから届くまでのフレーム数.
+
+static const char* kPolicyNames[r3d::BUDGET_POLICY_COUNT] = {
+    "even",
+    "adaptive",
+};
+
+//-----------------------------------------------------------------------------
+//      画像のノイズの計測値を生成します.
+//-----------------------------------------------------------------------------
+double MeasureVariance
+(
+    const r3d::BudgetSimOption&     option,
+    const r3d::BudgetSimSequence&   sequence,
+    uint32_t                        frameIndex,
+    uint32_t                        sampleCount,
+    double                          scale,
+    std::mt19937&                   random
+)
+{
+    std::normal_distribution<double> normal(0.0, option.MeasureNoise);
+    auto variance = sequence.Variance[frameIndex] / std::max(sampleCount, 1u) + sequence.Texture[frameIndex];
+    return variance * scale * std::exp(normal(random));
+}
+
+} // namespace
+
+
+namespace r3d {
+
+//-----------------------------------------------------------------------------
+//      方式の名前を取得します.
+//-----------------------------------------------------------------------------
+const char* GetPolicyName(BUDGET_POLICY policy)
+{ return (policy < BUDGET_POLICY_COUNT) ? kPolicyNames[policy] : "unknown"; }
+
+//-----------------------------------------------------------------------------
+//      シーケンスを生成します.
+//-----------------------------------------------------------------------------
+void CreateBudgetSequence(const BudgetSimOption& option, std::mt19937& random, BudgetSimSequence& result)
+{
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    auto count = option.FrameCount;
+    result.Variance.resize(count);
+    result.Cost    .resize(count);
+    result.Texture .resize(count);
+
+    // 緩やかな変化に, 難しい区間 (光源が遮られる, 反射が多い等) をいくつか重ねる.
+    auto phase  = uniform(random) * 6.28318530718;
+    auto period = 60.0 + uniform(random) * 120.0;
+    auto hardCount = 1 + uint32_t(uniform(random) * 3.0);
+
+    std::vector<double> hard(count, 1.0);
+    for(auto h=0u; h<hardCount; ++h)
+    {
+        auto center = uniform(random) * count;
+        auto width  = 5.0 + uniform(random) * 25.0;
+        for(auto i=0u; i<count; ++i)
+        {
+            auto x = (double(i) - center) / width;
+            hard[i] = std::max(hard[i], 1.0 + (option.HardRatio - 1.0) * std::exp(-x * x));
+        }
+    }
+
+    for(auto i=0u; i<count; ++i)
+    {
+        auto wave = 1.0 + 0.5 * std::sin(phase + 6.28318530718 * i / period);
+        result.Variance[i] = 0.01 * wave * hard[i];
+        result.Cost    [i] = option.FrameCostSec * (0.8 + 0.2 * hard[i] / option.HardRatio + 0.1 * uniform(random));
+        result.Texture [i] = 0.0002 * (0.5 + uniform(random));
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      描画をシミュレーションします.
+//-----------------------------------------------------------------------------
+BudgetSimResult SimulateBudget
+(
+    const BudgetSimOption&      option,
+    const BudgetSimSequence&    sequence,
+    BUDGET_POLICY               policy,
+    std::mt19937&               random
+)
+{
+    BudgetSimResult result;
+
+    auto frameCount = option.FrameCount;
+    auto elapsedSec = option.SetupSec;
+    auto deadline   = CalcRenderDeadline(option.RenderTimeSec, elapsedSec, frameCount, 0.0);
+
+    BudgetScheduler scheduler;
+    BudgetSchedulerDesc desc = {};
+    desc.FrameCount  = frameCount;
+    desc.MinScale    = MIN_SCHEDULE_SCALE;
+    desc.MaxScale    = MAX_SCHEDULE_SCALE;
+    desc.MinFrameSec = option.FrameCostSec * MIN_SCHEDULE_SAMPLES;
+    scheduler.Init(desc);
+
+    // 事前パス: 未完了のフレームを等間隔に数回ずつ描画してノイズを計測.
+    if (policy == BUDGET_POLICY_ADAPTIVE)
+    {
+        auto probeCount = std::min(MAX_PROBE_COUNT, frameCount / PROBE_INTERVAL);
+        auto limitSec   = (deadline - elapsedSec) * PROBE_BUDGET_RATIO;
+        auto beginSec   = elapsedSec;
+
+        for(auto p=0u; p<probeCount; ++p)
+        {
+            auto frameIndex = uint32_t((p + 0.5) * frameCount / probeCount);
+            auto cost       = sequence.Cost[frameIndex];
+
+            // リードバックは2フレーム遅れるので, 計測する画像は1回少ないサンプル数.
+            elapsedSec += cost * (PROBE_RENDER_COUNT + 1);
+            auto variance = MeasureVariance(option, sequence, frameIndex, PROBE_RENDER_COUNT - 1, 1.0, random);
+            scheduler.SetEstimate(frameIndex, variance, cost * (PROBE_RENDER_COUNT - 1));
+            scheduler.SetSampleSec(cost);
+
+            auto frameSec = (deadline - elapsedSec) / frameCount;
+            if (elapsedSec - beginSec >= limitSec || frameSec < cost * MIN_PROBE_SAMPLES)
+            { break; }
+        }
+
+        result.ProbeSec = elapsedSec - beginSec;
+    }
+
+    std::vector<double>   errors;
+    std::vector<uint32_t> samples(frameCount, 0);
+    std::deque<uint32_t>  reports;
+
+    for(auto i=0u; i<frameCount; ++i)
+    {
+        auto frameSec = (policy == BUDGET_POLICY_ADAPTIVE)
+            ? scheduler.GetFrameTime(i, deadline, elapsedSec)
+            : CalcFrameTimeBudget(deadline, elapsedSec, frameCount - i);
+
+        // 次の描画で割り振った時間を超えるなら出力 (最低1回は描画する).
+        // 締め切りを過ぎたら今のフレームを出力して終了.
+        auto cost        = sequence.Cost[i];
+        auto spentSec    = 0.0;
+        auto sampleCount = 0u;
+        auto finished    = false;
+        while(spentSec + cost <= frameSec || sampleCount == 0)
+        {
+            if (elapsedSec >= deadline)
+            {
+                finished = true;
+                break;
+            }
+
+            elapsedSec  += cost;
+            spentSec    += cost;
+            sampleCount++;
+            scheduler.SetSampleSec(cost);
+        }
+
+        if (sampleCount > 0)
+        {
+            errors.push_back(sequence.Variance[i] / sampleCount);
+            samples[i] = sampleCount;
+            result.CapturedCount++;
+
+            scheduler.SetDone(i, spentSec);
+            reports.push_back(i);
+        }
+
+        // ワーカーでの計測は遅れて届く. 描画結果はデノイズ済みなので尺度が違う.
+        while(reports.size() > REPORT_DELAY)
+        {
+            auto index = reports.front();
+            reports.pop_front();
+
+            scheduler.Report(index, MeasureVariance(option, sequence, index, samples[index], 0.25, random));
+        }
+
+        if (option.Verbose)
+        {
+            printf("    %-8s frame %3u : difficulty %.3e, time %7.3lf[sec], samples %4u\n",
+                kPolicyNames[policy], i, scheduler.GetDifficulty(i), spentSec, sampleCount);
+        }
+
+        if (finished)
+        { break; }
+    }
+
+    result.FinishSec = elapsedSec;
+
+    if (!errors.empty())
+    {
+        auto sorted = errors;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto sum = 0.0;
+        for(auto e : sorted)
+        { sum += e; }
+
+        result.MeanError = sum / double(sorted.size());
+        result.P95Error  = sorted[std::min(sorted.size() - 1, size_t(double(sorted.size()) * 0.95))];
+        result.MaxError  = sorted.back();
+        result.Spread    = sorted.back() / sorted.front();
+    }
+
+    return result;
+}
+
+} // namespace r3d
@@ -0,0 +1,97 @@
+﻿//-----------------------------------------------------------------------------
+// File : BudgetSim.h
+// Desc : Frame Time Budget Simulation.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <random>
+#include <vector>
+
+
+namespace r3d {
+
+///////////////////////////////////////////////////////////////////////////////
+// BUDGET_POLICY enum
+///////////////////////////////////////////////////////////////////////////////
+enum BUDGET_POLICY
+{
+    BUDGET_POLICY_EVEN = 0,     //!< 残り時間を均等に割り振る (従来の方式).
+    BUDGET_POLICY_ADAPTIVE,     //!< BudgetScheduler で割り振る.
+    BUDGET_POLICY_COUNT,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BudgetSimOption structure
+///////////////////////////////////////////////////////////////////////////////
+struct BudgetSimOption
+{
+    uint32_t    FrameCount      = 240;
+    double      RenderTimeSec   = 299.0;
+    double      SetupSec        = 5.0;
+    double      FrameCostSec    = 0.05;     //!< 1回の描画 (1サンプル) の平均時間[sec].
+    double      HardRatio       = 6.0;      //!< 難しい区間の1サンプルあたりの分散の倍率.
+    double      MeasureNoise    = 0.3;      //!< ノイズの計測誤差 (対数正規の標準偏差).
+    uint32_t    RunCount        = 20;
+    uint32_t    Seed            = 1234567;
+    bool        Verbose         = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BudgetSimSequence structure
+///////////////////////////////////////////////////////////////////////////////
+struct BudgetSimSequence
+{
+    std::vector<double> Variance;   //!< 1サンプルあたりの分散.
+    std::vector<double> Cost;       //!< 1サンプルあたりの描画時間[sec].
+    std::vector<double> Texture;    //!< ノイズの推定に混ざるテクスチャの分散.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// BudgetSimResult structure
+///////////////////////////////////////////////////////////////////////////////
+struct BudgetSimResult
+{
+    uint32_t    CapturedCount   = 0;
+    double      FinishSec       = 0.0;
+    double      MeanError       = 0.0;
+    double      P95Error        = 0.0;
+    double      MaxError        = 0.0;
+    double      Spread          = 0.0;      //!< 最大誤差 / 最小誤差.
+    double      ProbeSec        = 0.0;
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      方式の名前を取得します.
+//-----------------------------------------------------------------------------
+const char* GetPolicyName(BUDGET_POLICY policy);
+
+//-----------------------------------------------------------------------------
+//! @brief      シーケンスを生成します.
+//!
+//! @note       緩やかに変化する分散に, 難しい区間をいくつか重ねます.
+//-----------------------------------------------------------------------------
+void CreateBudgetSequence(const BudgetSimOption& option, std::mt19937& random, BudgetSimSequence& result);
+
+//-----------------------------------------------------------------------------
+//! @brief      描画をシミュレーションします.
+//!
+//! @note       RendererApp と同じ手順 (事前パス, 割り振り, 出力の判定, 遅れて届く計測) を
+//!             サンプル単位で進めます.
+//! @param[in]      option      設定.
+//! @param[in]      sequence    シーケンス.
+//! @param[in]      policy      割り振りの方式.
+//! @param[in]      random      計測誤差の乱数.
+//! @return     シミュレーション結果を返却します.
+//-----------------------------------------------------------------------------
+BudgetSimResult SimulateBudget(
+    const BudgetSimOption&      option,
+    const BudgetSimSequence&    sequence,
+    BUDGET_POLICY               policy,
+    std::mt19937&               random);
+
+} // namespace r3d
@@ -0,0 +1,151 @@
+﻿//-----------------------------------------------------------------------------
+// File : main.cpp
+// Desc : Frame Time Budget Simulator.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "BudgetSim.h"
+#include <Platform.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace r3d;
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      使用方法を表示します.
+//-----------------------------------------------------------------------------
+void PrintUsage()
+{
+    printf("Usage : budgetsim [options]\n");
+    printf("Options :\n");
+    printf("    -n <count>                  : frame count (default: 240).\n");
+    printf("    -t <sec>                    : render time (default: 299).\n");
+    printf("    -c <sec>                    : average cost of one accumulation frame (default: 0.05).\n");
+    printf("    -d <ratio>                  : variance ratio of hard segments (default: 6).\n");
+    printf("    -e <sigma>                  : log-normal error of noise measurement (default: 0.3).\n");
+    printf("    -r <count>                  : number of simulated sequences (default: 20).\n");
+    printf("    -s <seed>                   : random seed (default: 1234567).\n");
+    printf("    -v                          : print per-frame schedule.\n");
+    printf("    -h                          : show this message.\n");
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドライン引数を解析します.
+//-----------------------------------------------------------------------------
+bool ParseArgs(int argc, char** argv, BudgetSimOption& option)
+{
+    for(auto i=1; i<argc; ++i)
+    {
+        auto arg = argv[i];
+        auto hasNext = (i + 1 < argc);
+
+        if (0 == strcmp(arg, "-h") || 0 == strcmp(arg, "--help"))
+        { return false; }
+        else if (0 == strcmp(arg, "-n") && hasNext)
+        { option.FrameCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-t") && hasNext)
+        { option.RenderTimeSec = strtod(argv[++i], nullptr); }
+        else if (0 == strcmp(arg, "-c") && hasNext)
+        { option.FrameCostSec = strtod(argv[++i], nullptr); }
+        else if (0 == strcmp(arg, "-d") && hasNext)
+        { option.HardRatio = strtod(argv[++i], nullptr); }
+        else if (0 == strcmp(arg, "-e") && hasNext)
+        { option.MeasureNoise = strtod(argv[++i], nullptr); }
+        else if (0 == strcmp(arg, "-r") && hasNext)
+        { option.RunCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-s") && hasNext)
+        { option.Seed = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-v"))
+        { option.Verbose = true; }
+        else
+        {
+            ELOGA("Error : Unknown Option. option = %s", arg);
+            return false;
+        }
+    }
+
+    if (option.FrameCount == 0 || option.RenderTimeSec <= option.SetupSec || option.FrameCostSec <= 0.0
+     || option.HardRatio < 1.0 || option.MeasureNoise < 0.0 || option.RunCount == 0)
+    {
+        ELOGA("Error : Invalid Argument.");
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    BudgetSimOption option;
+    if (!ParseArgs(argc, argv, option))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    BudgetSimResult total[BUDGET_POLICY_COUNT] = {};
+    auto missed = false;
+
+    std::mt19937 random(option.Seed);
+    for(auto r=0u; r<option.RunCount; ++r)
+    {
+        BudgetSimSequence sequence;
+        CreateBudgetSequence(option, random, sequence);
+
+        for(auto p=0u; p<BUDGET_POLICY_COUNT; ++p)
+        {
+            // 計測誤差の乱数は方式ごとに同じ系列を使う.
+            std::mt19937 measure(option.Seed + r);
+            auto result = SimulateBudget(option, sequence, BUDGET_POLICY(p), measure);
+
+            if (result.CapturedCount < option.FrameCount || result.FinishSec > option.RenderTimeSec + option.FrameCostSec * 2.0)
+            { missed = true; }
+
+            total[p].CapturedCount += result.CapturedCount;
+            total[p].FinishSec      = std::max(total[p].FinishSec, result.FinishSec);
+            total[p].MeanError     += result.MeanError;
+            total[p].P95Error      += result.P95Error;
+            total[p].MaxError      += result.MaxError;
+            total[p].Spread        += result.Spread;
+            total[p].ProbeSec      += result.ProbeSec;
+        }
+    }
+
+    // 誤差は方式ごとの平均を従来の方式に対する比で表示する.
+    auto runs = double(option.RunCount);
+    printf("%u sequences, %u frames, %.1lf[sec], %.3lf[sec] per sample\n",
+        option.RunCount, option.FrameCount, option.RenderTimeSec, option.FrameCostSec);
+    printf("    %-10s %14s %10s %10s %10s %10s %10s %10s\n",
+        "policy", "frames", "finish[s]", "probe[s]", "mean err", "p95 err", "max err", "max/min");
+    for(auto p=0u; p<BUDGET_POLICY_COUNT; ++p)
+    {
+        printf("    %-10s %7u/%-6u %10.2lf %10.2lf %10.3lf %10.3lf %10.3lf %10.2lf\n",
+            GetPolicyName(BUDGET_POLICY(p)),
+            total[p].CapturedCount, option.FrameCount * option.RunCount,
+            total[p].FinishSec,
+            total[p].ProbeSec / runs,
+            total[p].MeanError / total[BUDGET_POLICY_EVEN].MeanError,
+            total[p].P95Error  / total[BUDGET_POLICY_EVEN].P95Error,
+            total[p].MaxError  / total[BUDGET_POLICY_EVEN].MaxError,
+            total[p].Spread    / runs);
+    }
+
+    if (missed)
+    { ELOGA("Error : Some frames were not captured before the deadline."); }
+
+    return missed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,477 @@
+﻿//-----------------------------------------------------------------------------
+// File : main.cpp
+// Desc : Camera Sequence Benchmark.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <CameraTrack.h>
+#include <MappedFile.h>
+#include <Platform.h>
+#include <generated/camera_format.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+// 計測対象の計算が最適化で消されないように結果を書き込む.
+volatile float g_Sink = 0.0f;
+
+///////////////////////////////////////////////////////////////////////////////
+// Option structure
+///////////////////////////////////////////////////////////////////////////////
+struct Option
+{
+    uint32_t                    PassCount       = 100;
+    uint32_t                    IterationCount  = 5;
+    float                       AspectRatio     = 1920.0f / 1080.0f;
+    std::vector<std::string>    Inputs;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Matrix structure
+///////////////////////////////////////////////////////////////////////////////
+struct Matrix
+{
+    float m[4][4];  //!< asdx::Matrix と同じ行優先 (行ベクトル).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// FrameState structure
+///////////////////////////////////////////////////////////////////////////////
+struct FrameState
+{
+    // Renderer::ChangeFrame() で更新する値.
+    Matrix  CurrView;
+    Matrix  CurrProj;
+    Matrix  CurrInvView;
+    Matrix  CurrInvProj;
+    Matrix  PrevView;
+    Matrix  PrevProj;
+    Matrix  PrevInvView;
+    Matrix  PrevInvViewProj;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// CameraTable structure
+///////////////////////////////////////////////////////////////////////////////
+struct CameraTable
+{
+    // CameraSequence と同じフレーム毎の計算済みテーブル.
+    std::vector<Matrix>         Views;
+    std::vector<Matrix>         Projs;
+    std::vector<Matrix>         InvViews;
+    std::vector<Matrix>         InvProjs;
+    std::vector<r3d::Float3>    Positions;
+    std::vector<float>          FovY;
+    std::vector<float>          NearClip;
+    std::vector<float>          FarClip;
+
+    size_t GetMemorySize() const
+    {
+        return Views.size() * (sizeof(Matrix) * 4 + sizeof(r3d::Float3) + sizeof(float) * 3);
+    }
+};
+
+//-----------------------------------------------------------------------------
+//      ベクトル演算.
+//-----------------------------------------------------------------------------
+inline r3d::Float3 Sub(const r3d::Float3& a, const r3d::Float3& b)
+{ return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+
+inline float Dot(const r3d::Float3& a, const r3d::Float3& b)
+{ return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+inline r3d::Float3 Cross(const r3d::Float3& a, const r3d::Float3& b)
+{ return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+inline r3d::Float3 Normalize(const r3d::Float3& a)
+{
+    auto len = std::sqrt(Dot(a, a));
+    return (len > 0.0f) ? r3d::Float3{ a.x / len, a.y / len, a.z / len } : a;
+}
+
+//-----------------------------------------------------------------------------
+//      ビュー行列を求めます (asdx::Matrix::CreateLookAt() と同じ右手系).
+//-----------------------------------------------------------------------------
+Matrix CreateLookAt(const r3d::Float3& position, const r3d::Float3& target, const r3d::Float3& upward)
+{
+    auto zaxis = Normalize(Sub(position, target));
+    auto xaxis = Normalize(Cross(upward, zaxis));
+    auto yaxis = Normalize(Cross(zaxis, xaxis));
+
+    Matrix result = {{
+        { xaxis.x, yaxis.x, zaxis.x, 0.0f },
+        { xaxis.y, yaxis.y, zaxis.y, 0.0f },
+        { xaxis.z, yaxis.z, zaxis.z, 0.0f },
+        { -Dot(xaxis, position), -Dot(yaxis, position), -Dot(zaxis, position), 1.0f },
+    }};
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      透視投影行列を求めます (asdx::Matrix::CreatePerspectiveFieldOfView() と同じ右手系).
+//-----------------------------------------------------------------------------
+Matrix CreatePerspectiveFieldOfView(float fieldOfView, float aspectRatio, float nearClip, float farClip)
+{
+    auto yScale = 1.0f / std::tan(fieldOfView * 0.5f);
+    auto xScale = yScale / aspectRatio;
+    auto range  = farClip / (nearClip - farClip);
+
+    Matrix result = {{
+        { xScale, 0.0f,   0.0f,             0.0f },
+        { 0.0f,   yScale, 0.0f,             0.0f },
+        { 0.0f,   0.0f,   range,           -1.0f },
+        { 0.0f,   0.0f,   range * nearClip, 0.0f },
+    }};
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      逆行列を求めます.
+//-----------------------------------------------------------------------------
+Matrix Invert(const Matrix& value)
+{
+    auto& a = value.m;
+
+    float c[16];
+    c[ 0] =  a[1][1]*a[2][2]*a[3][3] - a[1][1]*a[2][3]*a[3][2] - a[2][1]*a[1][2]*a[3][3] + a[2][1]*a[1][3]*a[3][2] + a[3][1]*a[1][2]*a[2][3] - a[3][1]*a[1][3]*a[2][2];
+    c[ 4] = -a[1][0]*a[2][2]*a[3][3] + a[1][0]*a[2][3]*a[3][2] + a[2][0]*a[1][2]*a[3][3] - a[2][0]*a[1][3]*a[3][2] - a[3][0]*a[1][2]*a[2][3] + a[3][0]*a[1][3]*a[2][2];
+    c[ 8] =  a[1][0]*a[2][1]*a[3][3] - a[1][0]*a[2][3]*a[3][1] - a[2][0]*a[1][1]*a[3][3] + a[2][0]*a[1][3]*a[3][1] + a[3][0]*a[1][1]*a[2][3] - a[3][0]*a[1][3]*a[2][1];
+    c[12] = -a[1][0]*a[2][1]*a[3][2] + a[1][0]*a[2][2]*a[3][1] + a[2][0]*a[1][1]*a[3][2] - a[2][0]*a[1][2]*a[3][1] - a[3][0]*a[1][1]*a[2][2] + a[3][0]*a[1][2]*a[2][1];
+    c[ 1] = -a[0][1]*a[2][2]*a[3][3] + a[0][1]*a[2][3]*a[3][2] + a[2][1]*a[0][2]*a[3][3] - a[2][1]*a[0][3]*a[3][2] - a[3][1]*a[0][2]*a[2][3] + a[3][1]*a[0][3]*a[2][2];
+    c[ 5] =  a[0][0]*a[2][2]*a[3][3] - a[0][0]*a[2][3]*a[3][2] - a[2][0]*a[0][2]*a[3][3] + a[2][0]*a[0][3]*a[3][2] + a[3][0]*a[0][2]*a[2][3] - a[3][0]*a[0][3]*a[2][2];
+    c[ 9] = -a[0][0]*a[2][1]*a[3][3] + a[0][0]*a[2][3]*a[3][1] + a[2][0]*a[0][1]*a[3][3] - a[2][0]*a[0][3]*a[3][1] - a[3][0]*a[0][1]*a[2][3] + a[3][0]*a[0][3]*a[2][1];
+    c[13] =  a[0][0]*a[2][1]*a[3][2] - a[0][0]*a[2][2]*a[3][1] - a[2][0]*a[0][1]*a[3][2] + a[2][0]*a[0][2]*a[3][1] + a[3][0]*a[0][1]*a[2][2] - a[3][0]*a[0][2]*a[2][1];
+    c[ 2] =  a[0][1]*a[1][2]*a[3][3] - a[0][1]*a[1][3]*a[3][2] - a[1][1]*a[0][2]*a[3][3] + a[1][1]*a[0][3]*a[3][2] + a[3][1]*a[0][2]*a[1][3] - a[3][1]*a[0][3]*a[1][2];
+    c[ 6] = -a[0][0]*a[1][2]*a[3][3] + a[0][0]*a[1][3]*a[3][2] + a[1][0]*a[0][2]*a[3][3] - a[1][0]*a[0][3]*a[3][2] - a[3][0]*a[0][2]*a[1][3] + a[3][0]*a[0][3]*a[1][2];
+    c[10] =  a[0][0]*a[1][1]*a[3][3] - a[0][0]*a[1][3]*a[3][1] - a[1][0]*a[0][1]*a[3][3] + a[1][0]*a[0][3]*a[3][1] + a[3][0]*a[0][1]*a[1][3] - a[3][0]*a[0][3]*a[1][1];
+    c[14] = -a[0][0]*a[1][1]*a[3][2] + a[0][0]*a[1][2]*a[3][1] + a[1][0]*a[0][1]*a[3][2] - a[1][0]*a[0][2]*a[3][1] - a[3][0]*a[0][1]*a[1][2] + a[3][0]*a[0][2]*a[1][1];
+    c[ 3] = -a[0][1]*a[1][2]*a[2][3] + a[0][1]*a[1][3]*a[2][2] + a[1][1]*a[0][2]*a[2][3] - a[1][1]*a[0][3]*a[2][2] - a[2][1]*a[0][2]*a[1][3] + a[2][1]*a[0][3]*a[1][2];
+    c[ 7] =  a[0][0]*a[1][2]*a[2][3] - a[0][0]*a[1][3]*a[2][2] - a[1][0]*a[0][2]*a[2][3] + a[1][0]*a[0][3]*a[2][2] + a[2][0]*a[0][2]*a[1][3] - a[2][0]*a[0][3]*a[1][2];
+    c[11] = -a[0][0]*a[1][1]*a[2][3] + a[0][0]*a[1][3]*a[2][1] + a[1][0]*a[0][1]*a[2][3] - a[1][0]*a[0][3]*a[2][1] - a[2][0]*a[0][1]*a[1][3] + a[2][0]*a[0][3]*a[1][1];
+    c[15] =  a[0][0]*a[1][1]*a[2][2] - a[0][0]*a[1][2]*a[2][1] - a[1][0]*a[0][1]*a[2][2] + a[1][0]*a[0][2]*a[2][1] + a[2][0]*a[0][1]*a[1][2] - a[2][0]*a[0][2]*a[1][1];
+
+    auto det = a[0][0] * c[0] + a[0][1] * c[4] + a[0][2] * c[8] + a[0][3] * c[12];
+    auto inv = (det != 0.0f) ? 1.0f / det : 0.0f;
+
+    Matrix result;
+    for(auto i=0; i<4; ++i)
+    {
+        for(auto j=0; j<4; ++j)
+        { result.m[i][j] = c[i * 4 + j] * inv; }
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      行列の積を求めます.
+//-----------------------------------------------------------------------------
+Matrix Multiply(const Matrix& a, const Matrix& b)
+{
+    Matrix result;
+    for(auto i=0; i<4; ++i)
+    {
+        for(auto j=0; j<4; ++j)
+        {
+            result.m[i][j] = a.m[i][0] * b.m[0][j]
+                           + a.m[i][1] * b.m[1][j]
+                           + a.m[i][2] * b.m[2][j]
+                           + a.m[i][3] * b.m[3][j];
+        }
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      トラック形式に変換します.
+//-----------------------------------------------------------------------------
+r3d::Float3 Convert(const r3d::Vector3& value)
+{ return r3d::Float3{ value.x(), value.y(), value.z() }; }
+
+//-----------------------------------------------------------------------------
+//      カメラシーケンスを読み込みます (CameraSequence::Init() と同じ変換).
+//-----------------------------------------------------------------------------
+bool LoadTrack(const std::string& path, r3d::CameraTrack& track)
+{
+    r3d::MappedFile file;
+    if (!file.Init(path.c_str(), r3d::MAPPED_FILE_HINT_SEQUENTIAL))
+    {
+        ELOGA("Error : MappedFile::Init() Failed. path = %s", path.c_str());
+        return false;
+    }
+
+    flatbuffers::Verifier verifier(file.GetData(), file.GetSize());
+    if (!r3d::VerifyResCameraSequenceBuffer(verifier))
+    {
+        ELOGA("Error : Invalid Camera File. path = %s", path.c_str());
+        return false;
+    }
+
+    auto resParams = r3d::GetResCameraSequence(file.GetData())->params();
+    if (resParams == nullptr || resParams->size() == 0)
+    {
+        ELOGA("Error : Camera Key Not Found. path = %s", path.c_str());
+        return false;
+    }
+
+    std::vector<r3d::CameraKey> keys(resParams->size());
+    for(auto i=0u; i<resParams->size(); ++i)
+    {
+        auto param = resParams->Get(i);
+
+        auto& key = keys[i];
+        key.Time        = float(param->frameIndex());
+        key.Position    = Convert(param->position());
+        key.Target      = Convert(param->target());
+        key.Upward      = Convert(param->upward());
+        key.FieldOfView = param->fieldOfView();
+        key.NearClip    = param->nearClip();
+        key.FarClip     = param->farClip();
+    }
+
+    if (!track.Init(keys.data(), keys.size()))
+    {
+        ELOGA("Error : CameraTrack::Init() Failed. Frame indices must be ascending. path = %s", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      カメラ姿勢から行列を求めます (CameraSequence::ToMatrix() と同じ).
+//-----------------------------------------------------------------------------
+void ToMatrix(const r3d::CameraPose& pose, float aspectRatio, Matrix& view, Matrix& proj)
+{
+    r3d::Float3 target = {
+        pose.Position.x + pose.Forward.x,
+        pose.Position.y + pose.Forward.y,
+        pose.Position.z + pose.Forward.z };
+
+    view = CreateLookAt(pose.Position, target, pose.Upward);
+    proj = CreatePerspectiveFieldOfView(pose.FieldOfView, aspectRatio, pose.NearClip, pose.FarClip);
+}
+
+//-----------------------------------------------------------------------------
+//      全フレームのテーブルを作成します (CameraSequence::BuildTable() と同じ).
+//-----------------------------------------------------------------------------
+void BuildTable(const r3d::CameraTrack& track, float aspectRatio, CameraTable& table)
+{
+    auto firstFrame = uint32_t(track.GetBeginTime());
+    auto count      = size_t(uint32_t(track.GetEndTime()) - firstFrame) + 1;
+
+    table.Views    .resize(count);
+    table.Projs    .resize(count);
+    table.InvViews .resize(count);
+    table.InvProjs .resize(count);
+    table.Positions.resize(count);
+    table.FovY     .resize(count);
+    table.NearClip .resize(count);
+    table.FarClip  .resize(count);
+
+    for(size_t i=0; i<count; ++i)
+    {
+        auto pose = track.Evaluate(double(firstFrame + i));
+
+        ToMatrix(pose, aspectRatio, table.Views[i], table.Projs[i]);
+        table.InvViews [i] = Invert(table.Views[i]);
+        table.InvProjs [i] = Invert(table.Projs[i]);
+        table.Positions[i] = pose.Position;
+        table.FovY     [i] = pose.FieldOfView;
+        table.NearClip [i] = pose.NearClip;
+        table.FarClip  [i] = pose.FarClip;
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      前フレームの値を退避します (Renderer::ChangeFrame() の先頭と同じ).
+//-----------------------------------------------------------------------------
+inline void SavePrev(FrameState& state)
+{
+    state.PrevView        = state.CurrView;
+    state.PrevProj        = state.CurrProj;
+    state.PrevInvView     = state.CurrInvView;
+    state.PrevInvViewProj = Multiply(state.CurrInvProj, state.CurrInvView);
+}
+
+//-----------------------------------------------------------------------------
+//      経過時間[ns]を求めます.
+//-----------------------------------------------------------------------------
+double GetNanoSec(std::chrono::steady_clock::time_point begin)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+//-----------------------------------------------------------------------------
+//      最も速い計測時間[ns]を求めます.
+//-----------------------------------------------------------------------------
+template<typename Func>
+double Measure(uint32_t iterationCount, Func func)
+{
+    auto result = 0.0;
+    for(auto i=0u; i<iterationCount; ++i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        func();
+        auto ns = GetNanoSec(begin);
+        if (i == 0 || ns < result)
+        { result = ns; }
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      1つのカメラファイルでベンチマークを行います.
+//-----------------------------------------------------------------------------
+bool Run(const Option& option, const std::string& path)
+{
+    r3d::CameraTrack track;
+    if (!LoadTrack(path, track))
+    { return false; }
+
+    auto firstFrame = uint32_t(track.GetBeginTime());
+    auto frameCount = uint32_t(track.GetEndTime()) - firstFrame + 1;
+    auto stepCount  = double(frameCount) * double(option.PassCount);
+
+    FrameState state = {};
+
+    // 従来の方式: フレームを切り替える度にトラックを評価して逆行列を求める.
+    auto evaluateNs = Measure(option.IterationCount, [&]()
+    {
+        for(auto pass=0u; pass<option.PassCount; ++pass)
+        {
+            for(auto i=0u; i<frameCount; ++i)
+            {
+                SavePrev(state);
+
+                auto pose = track.Evaluate(double(firstFrame + i));
+                ToMatrix(pose, option.AspectRatio, state.CurrView, state.CurrProj);
+                state.CurrInvView = Invert(state.CurrView);
+                state.CurrInvProj = Invert(state.CurrProj);
+            }
+        }
+        g_Sink = state.PrevInvViewProj.m[3][3];
+    });
+
+    // 読み込み時 (と解像度の変更時) のテーブル作成.
+    CameraTable table;
+    auto buildNs = Measure(option.IterationCount, [&]()
+    { BuildTable(track, option.AspectRatio, table); });
+
+    // 現在の方式: CameraSequence::Update() で参照先を切り替えて計算済みの値を写す.
+    auto lookupNs = Measure(option.IterationCount, [&]()
+    {
+        auto last = uint32_t(table.Views.size() - 1);
+        for(auto pass=0u; pass<option.PassCount; ++pass)
+        {
+            for(auto i=0u; i<frameCount; ++i)
+            {
+                SavePrev(state);
+
+                auto frameIndex = firstFrame + i;
+                auto index = (frameIndex > firstFrame) ? std::min(frameIndex - firstFrame, last) : 0u;
+                state.CurrView    = table.Views   [index];
+                state.CurrProj    = table.Projs   [index];
+                state.CurrInvView = table.InvViews[index];
+                state.CurrInvProj = table.InvProjs[index];
+            }
+        }
+        g_Sink = state.PrevInvViewProj.m[3][3];
+    });
+
+    printf("%s (%zu keys, %u frames, aspect %.4f)\n", path.c_str(), track.GetKeyCount(), frameCount, option.AspectRatio);
+    printf("    %-10s %12s %12s\n", "mode", "total[us]", "ns/frame");
+    printf("    %-10s %12.1f %12.1f\n", "evaluate", evaluateNs / 1000.0, evaluateNs / stepCount);
+    printf("    %-10s %12.1f %12.1f\n", "build",    buildNs    / 1000.0, buildNs    / double(frameCount));
+    printf("    %-10s %12.1f %12.1f\n", "lookup",   lookupNs   / 1000.0, lookupNs   / stepCount);
+    printf("    table memory : %zu bytes\n", table.GetMemorySize());
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      使用方法を表示します.
+//-----------------------------------------------------------------------------
+void PrintUsage()
+{
+    printf("Usage : cambench [options] <camera.cam> ...\n");
+    printf("Options :\n");
+    printf("    -p <count>                  : passes over all frames per measurement (default: 100).\n");
+    printf("    -n <count>                  : iteration count, best time is reported (default: 5).\n");
+    printf("    -a <ratio>                  : aspect ratio (default: 1.777778).\n");
+    printf("    -h                          : show this message.\n");
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドライン引数を解析します.
+//-----------------------------------------------------------------------------
+bool ParseArgs(int argc, char** argv, Option& option)
+{
+    for(auto i=1; i<argc; ++i)
+    {
+        auto arg = argv[i];
+        auto hasNext = (i + 1 < argc);
+
+        if (0 == strcmp(arg, "-h") || 0 == strcmp(arg, "--help"))
+        { return false; }
+        else if (0 == strcmp(arg, "-p") && hasNext)
+        { option.PassCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-n") && hasNext)
+        { option.IterationCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-a") && hasNext)
+        { option.AspectRatio = float(strtod(argv[++i], nullptr)); }
+        else if (arg[0] == '-')
+        {
+            ELOGA("Error : Unknown Option. option = %s", arg);
+            return false;
+        }
+        else
+        { option.Inputs.push_back(arg); }
+    }
+
+    if (option.IterationCount == 0)
+    { option.IterationCount = 1; }
+    if (option.PassCount == 0)
+    { option.PassCount = 1; }
+
+    return option.AspectRatio > 0.0f && !option.Inputs.empty();
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Option option;
+    if (!ParseArgs(argc, argv, option))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    auto failed = false;
+    for(size_t i=0; i<option.Inputs.size(); ++i)
+    {
+        if (i > 0)
+        { printf("\n"); }
+
+        if (!Run(option, option.Inputs[i]))
+        { failed = true; }
+    }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
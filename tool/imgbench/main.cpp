@@ -0,0 +1,342 @@
+﻿//-----------------------------------------------------------------------------
+// File : main.cpp
+// Desc : Image Encoder Benchmark.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <PngEncoder.h>
+#include <QoiEncoder.h>
+#include <Platform.h>
+#include <fpng.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+// リードバックテクスチャの行ピッチのアラインメント (RendererApp と同じ).
+static const uint32_t READBACK_PITCH_ALIGNMENT = 256;
+
+///////////////////////////////////////////////////////////////////////////////
+// Option structure
+///////////////////////////////////////////////////////////////////////////////
+struct Option
+{
+    uint32_t                    ThreadCount     = 0;
+    uint32_t                    IterationCount  = 5;
+    std::vector<std::string>    Inputs;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Image structure
+///////////////////////////////////////////////////////////////////////////////
+struct Image
+{
+    uint32_t                Width   = 0;
+    uint32_t                Height  = 0;
+    uint32_t                Pitch   = 0;
+    std::vector<uint8_t>    Pixels;     //!< リードバックと同じ行ピッチで格納した RGBA8.
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Result structure
+///////////////////////////////////////////////////////////////////////////////
+struct Result
+{
+    const char* Name        = nullptr;
+    bool        Success     = false;
+    size_t      Size        = 0;
+    double      BestMsec    = 0.0;
+    const char* Verify      = "-";
+};
+
+//-----------------------------------------------------------------------------
+//      ファイルを読み込みます.
+//-----------------------------------------------------------------------------
+bool LoadFile(const std::string& path, std::vector<uint8_t>& result)
+{
+    auto pFile = fopen(path.c_str(), "rb");
+    if (pFile == nullptr)
+    {
+        ELOGA("Error : File Open Failed. path = %s", path.c_str());
+        return false;
+    }
+
+    fseek(pFile, 0, SEEK_END);
+    auto size = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+
+    result.resize(size_t(size));
+    auto count = fread(result.data(), 1, result.size(), pFile);
+    fclose(pFile);
+
+    if (count != result.size())
+    {
+        ELOGA("Error : File Read Failed. path = %s", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      キャプチャ画像を読み込みます.
+//-----------------------------------------------------------------------------
+bool LoadImage(const std::string& path, Image& image)
+{
+    std::vector<uint8_t> data;
+    if (!LoadFile(path, data))
+    { return false; }
+
+    std::vector<uint8_t> pixels;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+
+    if (data.size() >= 4 && memcmp(data.data(), "qoif", 4) == 0)
+    {
+        if (!r3d::DecodeQoi(data.data(), data.size(), pixels, width, height))
+        {
+            ELOGA("Error : DecodeQoi() Failed. path = %s", path.c_str());
+            return false;
+        }
+    }
+    else
+    {
+        // 以前のキャプチャは fpng で出力されている.
+        uint32_t channels = 0;
+        auto ret = fpng::fpng_decode_memory(data.data(), uint32_t(data.size()), pixels, width, height, channels, 4);
+        if (ret != fpng::FPNG_DECODE_SUCCESS)
+        {
+            ELOGA("Error : fpng_decode_memory() Failed. path = %s, ret = %d", path.c_str(), ret);
+            return false;
+        }
+    }
+
+    // リードバックバッファと同じ行ピッチに並べ直す.
+    image.Width  = width;
+    image.Height = height;
+    image.Pitch  = (width * 4 + READBACK_PITCH_ALIGNMENT - 1) & ~(READBACK_PITCH_ALIGNMENT - 1);
+    image.Pixels.resize(size_t(image.Pitch) * height);
+    for(auto y=0u; y<height; ++y)
+    { memcpy(image.Pixels.data() + size_t(y) * image.Pitch, pixels.data() + size_t(y) * width * 4, width * 4); }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      行間を詰めた画素データを取得します.
+//-----------------------------------------------------------------------------
+std::vector<uint8_t> GetTightPixels(const Image& image)
+{
+    std::vector<uint8_t> result(size_t(image.Width) * image.Height * 4);
+    for(auto y=0u; y<image.Height; ++y)
+    { memcpy(result.data() + size_t(y) * image.Width * 4, image.Pixels.data() + size_t(y) * image.Pitch, image.Width * 4); }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      処理時間を計測します.
+//-----------------------------------------------------------------------------
+template<typename Func>
+bool Measure(uint32_t iterationCount, Result& result, Func func)
+{
+    result.BestMsec = 0.0;
+    for(auto i=0u; i<iterationCount; ++i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        if (!func())
+        { return false; }
+        auto end = std::chrono::steady_clock::now();
+
+        auto msec = std::chrono::duration<double, std::milli>(end - begin).count();
+        if (i == 0 || msec < result.BestMsec)
+        { result.BestMsec = msec; }
+    }
+
+    result.Success = true;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      1枚の画像でベンチマークを行います.
+//-----------------------------------------------------------------------------
+bool Run(const Option& option, r3d::PngEncoder& pngEncoder, const std::string& path)
+{
+    Image image;
+    if (!LoadImage(path, image))
+    { return false; }
+
+    auto tight    = GetTightPixels(image);
+    auto rawBytes = tight.size();
+
+    Result results[3];
+    std::vector<uint8_t> encoded;
+    std::vector<uint8_t> decoded;
+
+    // fpng (従来の出力). 行間を詰めた画像しか受け取れないので変換込みで計測する.
+    {
+        auto& r = results[0];
+        r.Name = "fpng";
+        std::vector<uint8_t> temp;
+        Measure(option.IterationCount, r, [&]()
+        {
+            temp = GetTightPixels(image);
+            return fpng::fpng_encode_image_to_memory(temp.data(), image.Width, image.Height, 4, encoded);
+        });
+        if (r.Success)
+        {
+            r.Size = encoded.size();
+
+            uint32_t w = 0, h = 0, c = 0;
+            auto ret = fpng::fpng_decode_memory(encoded.data(), uint32_t(encoded.size()), decoded, w, h, c, 4);
+            r.Verify = (ret == fpng::FPNG_DECODE_SUCCESS && w == image.Width && h == image.Height && decoded == tight) ? "ok" : "NG";
+        }
+    }
+
+    // PngEncoder (帯分割).
+    {
+        auto& r = results[1];
+        r.Name = "png-strip";
+        Measure(option.IterationCount, r, [&]()
+        { return pngEncoder.Encode(image.Pixels.data(), image.Width, image.Height, image.Pitch, encoded); });
+        if (r.Success)
+        {
+            r.Size = encoded.size();
+
+            uint32_t w = 0, h = 0;
+            auto ret = r3d::DecodePng(encoded.data(), encoded.size(), decoded, w, h);
+            r.Verify = (ret && w == image.Width && h == image.Height && decoded == tight) ? "ok" : "NG";
+        }
+    }
+
+    // QoiEncoder.
+    {
+        auto& r = results[2];
+        r.Name = "qoi";
+        r3d::QoiEncoder encoder;
+        Measure(option.IterationCount, r, [&]()
+        { return encoder.Encode(image.Pixels.data(), image.Width, image.Height, image.Pitch, encoded); });
+        if (r.Success)
+        {
+            r.Size = encoded.size();
+
+            uint32_t w = 0, h = 0;
+            auto ret = r3d::DecodeQoi(encoded.data(), encoded.size(), decoded, w, h);
+            r.Verify = (ret && w == image.Width && h == image.Height && decoded == tight) ? "ok" : "NG";
+        }
+    }
+
+    printf("%s (%u x %u, pitch %u)\n", path.c_str(), image.Width, image.Height, image.Pitch);
+    printf("    %-12s %12s %8s %10s %10s %6s\n", "encoder", "size[byte]", "ratio", "best[ms]", "MB/s", "verify");
+
+    auto failed = false;
+    for(auto& r : results)
+    {
+        if (!r.Success)
+        {
+            printf("    %-12s failed.\n", r.Name);
+            failed = true;
+            continue;
+        }
+
+        auto ratio = double(r.Size) / double(rawBytes);
+        auto mbps  = (r.BestMsec > 0.0) ? double(rawBytes) / (r.BestMsec * 1000.0) : 0.0;
+        printf("    %-12s %12zu %7.2f%% %10.3f %10.1f %6s\n", r.Name, r.Size, ratio * 100.0, r.BestMsec, mbps, r.Verify);
+
+        if (strcmp(r.Verify, "NG") == 0)
+        { failed = true; }
+    }
+
+    return !failed;
+}
+
+//-----------------------------------------------------------------------------
+//      使用方法を表示します.
+//-----------------------------------------------------------------------------
+void PrintUsage()
+{
+    printf("Usage : imgbench [options] <frame.png|frame.qoi> ...\n");
+    printf("Options :\n");
+    printf("    -j <count>                  : PngEncoder thread count (default: hardware concurrency).\n");
+    printf("    -n <count>                  : iteration count, best time is reported (default: 5).\n");
+    printf("    -h                          : show this message.\n");
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドライン引数を解析します.
+//-----------------------------------------------------------------------------
+bool ParseArgs(int argc, char** argv, Option& option)
+{
+    for(auto i=1; i<argc; ++i)
+    {
+        auto arg = argv[i];
+        auto hasNext = (i + 1 < argc);
+
+        if (0 == strcmp(arg, "-h") || 0 == strcmp(arg, "--help"))
+        { return false; }
+        else if (0 == strcmp(arg, "-j") && hasNext)
+        { option.ThreadCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-n") && hasNext)
+        { option.IterationCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (arg[0] == '-')
+        {
+            ELOGA("Error : Unknown Option. option = %s", arg);
+            return false;
+        }
+        else
+        { option.Inputs.push_back(arg); }
+    }
+
+    if (option.IterationCount == 0)
+    { option.IterationCount = 1; }
+
+    return !option.Inputs.empty();
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Option option;
+    if (!ParseArgs(argc, argv, option))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    fpng::fpng_init();
+
+    r3d::PngEncoder pngEncoder;
+    if (!pngEncoder.Init(option.ThreadCount))
+    {
+        ELOGA("Error : PngEncoder::Init() Failed.");
+        return EXIT_FAILURE;
+    }
+
+    auto failed = false;
+    for(size_t i=0; i<option.Inputs.size(); ++i)
+    {
+        if (i > 0)
+        { printf("\n"); }
+
+        if (!Run(option, pngEncoder, option.Inputs[i]))
+        { failed = true; }
+    }
+
+    pngEncoder.Term();
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,439 @@
+﻿//-----------------------------------------------------------------------------
+// File : main.cpp
+// Desc : Golden Frame Comparison.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <ImageCompare.h>
+#include <PngEncoder.h>
+#include <Platform.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+// CI から判別できるように終了コードを分ける.
+static const int EXIT_CODE_PASS         = 0;    // 全てのフレームが閾値以内.
+static const int EXIT_CODE_REGRESSION   = 1;    // 閾値を超えたフレームがある.
+static const int EXIT_CODE_ERROR        = 2;    // 引数の誤り, フレームの欠落, 読み込みの失敗.
+
+///////////////////////////////////////////////////////////////////////////////
+// FRAME_STATUS enum
+///////////////////////////////////////////////////////////////////////////////
+enum FRAME_STATUS
+{
+    FRAME_STATUS_PASS,
+    FRAME_STATUS_FAIL,
+    FRAME_STATUS_MISSING,
+    FRAME_STATUS_ERROR,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Option structure
+///////////////////////////////////////////////////////////////////////////////
+struct Option
+{
+    uint32_t    ThreadCount     = 0;
+    uint32_t    TileSize        = 32;
+    double      MinPsnr         = 40.0;
+    double      MinSsim         = 0.99;
+    double      MaxFlip         = 0.05;
+    double      MaxTileError    = 0.2;
+    std::string HeatmapDir;
+    bool        HeatmapAll      = false;
+    bool        Quiet           = false;
+    std::string GoldenPath;
+    std::string TestPath;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Frame structure
+///////////////////////////////////////////////////////////////////////////////
+struct Frame
+{
+    std::string         Name;
+    std::string         GoldenPath;
+    std::string         TestPath;
+    FRAME_STATUS        Status  = FRAME_STATUS_ERROR;
+    uint32_t            Width   = 0;
+    uint32_t            Height  = 0;
+    r3d::CompareResult  Result  = {};
+};
+
+//-----------------------------------------------------------------------------
+//      比較対象の画像ファイルかどうかチェックします.
+//-----------------------------------------------------------------------------
+bool IsImageFile(const std::string& name)
+{
+    auto ext = r3d::GetExt(name.c_str());
+    return ext == "png" || ext == "qoi" || ext == "exr";
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルを書き出します.
+//-----------------------------------------------------------------------------
+bool WriteFile(const std::string& path, const std::vector<uint8_t>& data)
+{
+    auto pFile = r3d::OpenFile(path.c_str(), "wb");
+    if (pFile == nullptr)
+    {
+        ELOGA("Error : File Open Failed. path = %s", path.c_str());
+        return false;
+    }
+
+    auto count = fwrite(data.data(), 1, data.size(), pFile);
+    auto ret   = (fclose(pFile) == 0) && (count == data.size());
+    if (!ret)
+    { ELOGA("Error : File Write Failed. path = %s", path.c_str()); }
+
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+//      比較するフレームを列挙します.
+//-----------------------------------------------------------------------------
+bool ListFrames(const Option& option, std::vector<Frame>& frames)
+{
+    // ファイル同士の比較.
+    if (r3d::IsExistFile(option.GoldenPath.c_str()) && r3d::IsExistFile(option.TestPath.c_str()))
+    {
+        Frame frame;
+        frame.Name       = r3d::RemoveDirectoryPath(option.TestPath.c_str());
+        frame.GoldenPath = option.GoldenPath;
+        frame.TestPath   = option.TestPath;
+        frames.push_back(frame);
+        return true;
+    }
+
+    std::vector<std::string> goldenNames;
+    std::vector<std::string> testNames;
+    if (!r3d::GetFileList(option.GoldenPath.c_str(), goldenNames))
+    {
+        ELOGA("Error : Directory Open Failed. path = %s", option.GoldenPath.c_str());
+        return false;
+    }
+    if (!r3d::GetFileList(option.TestPath.c_str(), testNames))
+    {
+        ELOGA("Error : Directory Open Failed. path = %s", option.TestPath.c_str());
+        return false;
+    }
+
+    goldenNames.erase(std::remove_if(goldenNames.begin(), goldenNames.end(), [](const std::string& name)
+    { return !IsImageFile(name); }), goldenNames.end());
+    testNames.erase(std::remove_if(testNames.begin(), testNames.end(), [](const std::string& name)
+    { return !IsImageFile(name); }), testNames.end());
+
+    // 名前の昇順に並んでいるので, 両方を同時に辿って対応付ける.
+    // 片方にしか無いフレームは欠落として扱う.
+    size_t i = 0;
+    size_t j = 0;
+    while (i < goldenNames.size() || j < testNames.size())
+    {
+        Frame frame;
+        if (j >= testNames.size() || (i < goldenNames.size() && goldenNames[i] < testNames[j]))
+        {
+            frame.Name       = goldenNames[i++];
+            frame.GoldenPath = option.GoldenPath + "/" + frame.Name;
+        }
+        else if (i >= goldenNames.size() || testNames[j] < goldenNames[i])
+        {
+            frame.Name     = testNames[j++];
+            frame.TestPath = option.TestPath + "/" + frame.Name;
+        }
+        else
+        {
+            frame.Name       = goldenNames[i++];
+            frame.GoldenPath = option.GoldenPath + "/" + frame.Name;
+            frame.TestPath   = option.TestPath   + "/" + testNames[j++];
+        }
+        frames.push_back(frame);
+    }
+
+    if (frames.empty())
+    {
+        ELOGA("Error : No Image Found. golden = %s, test = %s", option.GoldenPath.c_str(), option.TestPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      1フレームを比較します.
+//-----------------------------------------------------------------------------
+void CompareFrame(const Option& option, r3d::PngEncoder& encoder, Frame& frame)
+{
+    if (frame.GoldenPath.empty() || frame.TestPath.empty())
+    {
+        frame.Status = FRAME_STATUS_MISSING;
+        return;
+    }
+
+    r3d::CompareImage golden;
+    r3d::CompareImage test;
+    if (!r3d::LoadCompareImage(frame.GoldenPath.c_str(), golden)
+     || !r3d::LoadCompareImage(frame.TestPath  .c_str(), test))
+    {
+        frame.Status = FRAME_STATUS_ERROR;
+        return;
+    }
+
+    frame.Width  = test.Width;
+    frame.Height = test.Height;
+
+    if (!r3d::CompareImages(golden, test, option.TileSize, frame.Result))
+    {
+        ELOGA("Error : CompareImages() Failed. name = %s", frame.Name.c_str());
+        frame.Status = FRAME_STATUS_ERROR;
+        return;
+    }
+
+    auto& r = frame.Result;
+    auto pass = (r.Psnr >= option.MinPsnr)
+             && (r.Ssim >= option.MinSsim)
+             && (r.Flip <= option.MaxFlip)
+             && (r.MaxTileError <= option.MaxTileError);
+    frame.Status = pass ? FRAME_STATUS_PASS : FRAME_STATUS_FAIL;
+
+    if (option.HeatmapDir.empty() || (pass && !option.HeatmapAll))
+    { return; }
+
+    // 閾値を白として塗る.
+    std::vector<uint8_t> pixels;
+    std::vector<uint8_t> encoded;
+    r3d::CreateHeatmap(r, test.Width, test.Height, float(option.MaxTileError), pixels);
+    if (!encoder.Encode(pixels.data(), test.Width, test.Height, test.Width * 4, encoded))
+    {
+        ELOGA("Error : PngEncoder::Encode() Failed. name = %s", frame.Name.c_str());
+        return;
+    }
+
+    auto path = option.HeatmapDir + "/" + r3d::GetPathWithoutExt(frame.Name.c_str()) + "_heatmap.png";
+    WriteFile(path, encoded);
+}
+
+//-----------------------------------------------------------------------------
+//      フレームの比較結果を表示します.
+//-----------------------------------------------------------------------------
+void PrintFrame(const Frame& frame)
+{
+    switch(frame.Status)
+    {
+    case FRAME_STATUS_MISSING:
+        printf("MISSING %s (%s)\n", frame.Name.c_str(), frame.TestPath.empty() ? "no test frame" : "no golden frame");
+        return;
+
+    case FRAME_STATUS_ERROR:
+        printf("ERROR   %s\n", frame.Name.c_str());
+        return;
+
+    default:
+        break;
+    }
+
+    auto& r = frame.Result;
+    char psnr[32];
+    if (std::isinf(r.Psnr))
+    { snprintf(psnr, sizeof(psnr), "%8s", "inf"); }
+    else
+    { snprintf(psnr, sizeof(psnr), "%8.3f", r.Psnr); }
+
+    printf("%-7s %s : PSNR %s dB, SSIM %.5f, FLIP %.5f, max tile %.5f at (%u, %u)\n",
+        (frame.Status == FRAME_STATUS_PASS) ? "ok" : "FAIL",
+        frame.Name.c_str(),
+        psnr,
+        r.Ssim,
+        r.Flip,
+        r.MaxTileError,
+        r.MaxTileX,
+        r.MaxTileY);
+}
+
+//-----------------------------------------------------------------------------
+//      使用方法を表示します.
+//-----------------------------------------------------------------------------
+void PrintUsage()
+{
+    printf("Usage : imgcmp [options] <golden_dir> <test_dir>\n");
+    printf("        imgcmp [options] <golden.png|qoi|exr> <test.png|qoi|exr>\n");
+    printf("Options :\n");
+    printf("    -j <count>                  : worker thread count (default: hardware concurrency).\n");
+    printf("    -p <dB>                     : minimum PSNR (default: 40).\n");
+    printf("    -s <value>                  : minimum SSIM (default: 0.99).\n");
+    printf("    -f <value>                  : maximum mean FLIP-like error (default: 0.05).\n");
+    printf("    -m <value>                  : maximum mean error of a tile (default: 0.2).\n");
+    printf("    -t <px>                     : tile size of error heatmap (default: 32).\n");
+    printf("    -H <dir>                    : write error heatmaps of failed frames into <dir>.\n");
+    printf("    -a                          : write heatmaps of all frames (with -H).\n");
+    printf("    -q                          : print failed frames only.\n");
+    printf("    -h                          : show this message.\n");
+    printf("Exit Code :\n");
+    printf("    0 : all frames passed, 1 : regression detected, 2 : missing or unreadable frames.\n");
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドライン引数を解析します.
+//-----------------------------------------------------------------------------
+bool ParseArgs(int argc, char** argv, Option& option)
+{
+    std::vector<std::string> inputs;
+    for(auto i=1; i<argc; ++i)
+    {
+        auto arg = argv[i];
+        auto hasNext = (i + 1 < argc);
+
+        if (0 == strcmp(arg, "-h") || 0 == strcmp(arg, "--help"))
+        { return false; }
+        else if (0 == strcmp(arg, "-j") && hasNext)
+        { option.ThreadCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-p") && hasNext)
+        { option.MinPsnr = strtod(argv[++i], nullptr); }
+        else if (0 == strcmp(arg, "-s") && hasNext)
+        { option.MinSsim = strtod(argv[++i], nullptr); }
+        else if (0 == strcmp(arg, "-f") && hasNext)
+        { option.MaxFlip = strtod(argv[++i], nullptr); }
+        else if (0 == strcmp(arg, "-m") && hasNext)
+        { option.MaxTileError = strtod(argv[++i], nullptr); }
+        else if (0 == strcmp(arg, "-t") && hasNext)
+        { option.TileSize = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-H") && hasNext)
+        { option.HeatmapDir = r3d::NormalizePath(argv[++i]); }
+        else if (0 == strcmp(arg, "-a"))
+        { option.HeatmapAll = true; }
+        else if (0 == strcmp(arg, "-q"))
+        { option.Quiet = true; }
+        else if (arg[0] == '-')
+        {
+            ELOGA("Error : Unknown Option. option = %s", arg);
+            return false;
+        }
+        else
+        { inputs.push_back(arg); }
+    }
+
+    if (inputs.size() != 2)
+    { return false; }
+
+    if (option.TileSize == 0)
+    {
+        ELOGA("Error : Invalid Tile Size.");
+        return false;
+    }
+
+    option.GoldenPath = r3d::NormalizePath(inputs[0].c_str());
+    option.TestPath   = r3d::NormalizePath(inputs[1].c_str());
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Option option;
+    if (!ParseArgs(argc, argv, option))
+    {
+        PrintUsage();
+        return EXIT_CODE_ERROR;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+
+    std::vector<Frame> frames;
+    if (!ListFrames(option, frames))
+    { return EXIT_CODE_ERROR; }
+
+    // ヒートマップは小さいので, エンコーダのワーカーは1つで十分.
+    r3d::PngEncoder encoder;
+    if (!option.HeatmapDir.empty() && !encoder.Init(1))
+    {
+        ELOGA("Error : PngEncoder::Init() Failed.");
+        return EXIT_CODE_ERROR;
+    }
+
+    auto threadCount = option.ThreadCount;
+    if (threadCount == 0)
+    { threadCount = std::max(1u, std::thread::hardware_concurrency()); }
+    if (threadCount > frames.size())
+    { threadCount = uint32_t(frames.size()); }
+
+    // フレーム単位で並列に比較.
+    std::atomic<size_t> nextIndex(0);
+
+    auto worker = [&]() {
+        for(;;)
+        {
+            auto idx = nextIndex.fetch_add(1);
+            if (idx >= frames.size())
+            { break; }
+
+            CompareFrame(option, encoder, frames[idx]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(auto i=1u; i<threadCount; ++i)
+    { threads.emplace_back(worker); }
+
+    worker();
+
+    for(auto& thread : threads)
+    { thread.join(); }
+
+    encoder.Term();
+
+    auto sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    // 出力順を安定させるため, 全て終わってから名前順に表示する.
+    uint32_t counts[4] = {};
+    double   minPsnr   = std::numeric_limits<double>::infinity();
+    double   minSsim   = 1.0;
+    double   maxFlip   = 0.0;
+    for(auto& frame : frames)
+    {
+        counts[frame.Status]++;
+        if (frame.Status == FRAME_STATUS_PASS || frame.Status == FRAME_STATUS_FAIL)
+        {
+            minPsnr = std::min(minPsnr, frame.Result.Psnr);
+            minSsim = std::min(minSsim, frame.Result.Ssim);
+            maxFlip = std::max(maxFlip, frame.Result.Flip);
+        }
+
+        if (!option.Quiet || frame.Status != FRAME_STATUS_PASS)
+        { PrintFrame(frame); }
+    }
+
+    printf("\n");
+    printf("Frames  : %zu (passed %u, failed %u, missing %u, error %u)\n",
+        frames.size(),
+        counts[FRAME_STATUS_PASS],
+        counts[FRAME_STATUS_FAIL],
+        counts[FRAME_STATUS_MISSING],
+        counts[FRAME_STATUS_ERROR]);
+    if (counts[FRAME_STATUS_PASS] + counts[FRAME_STATUS_FAIL] > 0)
+    { printf("Worst   : PSNR %.3f dB, SSIM %.5f, FLIP %.5f\n", minPsnr, minSsim, maxFlip); }
+    printf("Time    : %.3f sec (%u threads)\n", sec, threadCount);
+
+    if (counts[FRAME_STATUS_MISSING] > 0 || counts[FRAME_STATUS_ERROR] > 0)
+    { return EXIT_CODE_ERROR; }
+
+    return (counts[FRAME_STATUS_FAIL] > 0) ? EXIT_CODE_REGRESSION : EXIT_CODE_PASS;
+}
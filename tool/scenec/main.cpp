@@ -0,0 +1,257 @@
+﻿//-----------------------------------------------------------------------------
+// File : main.cpp
+// Desc : Scene Compiler.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <offline/SceneExporter.h>
+#include <offline/CameraSequenceExporter.h>
+#include <Platform.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// INPUT_TYPE enum
+///////////////////////////////////////////////////////////////////////////////
+enum INPUT_TYPE
+{
+    INPUT_TYPE_AUTO,
+    INPUT_TYPE_SCENE,
+    INPUT_TYPE_CAMERA,
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Option structure
+///////////////////////////////////////////////////////////////////////////////
+struct Option
+{
+    uint32_t                    ThreadCount = 0;
+    INPUT_TYPE                  Type        = INPUT_TYPE_AUTO;
+    bool                        Placed      = false;
+    uint64_t                    BlobSize    = 0;
+    std::string                 OutputDir;
+    std::vector<std::string>    Inputs;
+};
+
+//-----------------------------------------------------------------------------
+//      使用方法を表示します.
+//-----------------------------------------------------------------------------
+void PrintUsage()
+{
+    printf("Usage : scenec [options] <setting.txt> ...\n");
+    printf("Options :\n");
+    printf("    -j <count>                  : worker thread count (default: hardware concurrency).\n");
+    printf("    -o <dir>                    : output directory (overrides directory of export path).\n");
+    printf("    -I <dir>                    : add search directory for resources.\n");
+    printf("    -t <auto|scene|camera>      : input type (default: auto).\n");
+    printf("    -p                          : store textures in D3D12 upload footprint layout.\n");
+    printf("    -b <MiB>                    : split ibl/texture/mesh payloads into blob files of at most <MiB> each.\n");
+    printf("    -h                          : show this message.\n");
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドライン引数を解析します.
+//-----------------------------------------------------------------------------
+bool ParseArgs(int argc, char** argv, Option& option)
+{
+    for(auto i=1; i<argc; ++i)
+    {
+        auto arg = argv[i];
+        auto hasNext = (i + 1 < argc);
+
+        if (0 == strcmp(arg, "-h") || 0 == strcmp(arg, "--help"))
+        { return false; }
+        else if (0 == strcmp(arg, "-j") && hasNext)
+        { option.ThreadCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-o") && hasNext)
+        { option.OutputDir = r3d::NormalizePath(argv[++i]); }
+        else if (0 == strcmp(arg, "-p"))
+        { option.Placed = true; }
+        else if (0 == strcmp(arg, "-b") && hasNext)
+        { option.BlobSize = strtoull(argv[++i], nullptr, 10) * 1024 * 1024; }
+        else if (0 == strcmp(arg, "-I") && hasNext)
+        { r3d::AddSearchDirectory(argv[++i]); }
+        else if (0 == strcmp(arg, "-t") && hasNext)
+        {
+            auto type = argv[++i];
+            if (0 == r3d::StrICmp(type, "scene"))
+            { option.Type = INPUT_TYPE_SCENE; }
+            else if (0 == r3d::StrICmp(type, "camera"))
+            { option.Type = INPUT_TYPE_CAMERA; }
+            else if (0 == r3d::StrICmp(type, "auto"))
+            { option.Type = INPUT_TYPE_AUTO; }
+            else
+            {
+                ELOGA("Error : Unknown Input Type. type = %s", type);
+                return false;
+            }
+        }
+        else if (arg[0] == '-')
+        {
+            ELOGA("Error : Unknown Option. option = %s", arg);
+            return false;
+        }
+        else
+        { option.Inputs.push_back(arg); }
+    }
+
+    return !option.Inputs.empty();
+}
+
+//-----------------------------------------------------------------------------
+//      先頭のブロック名から入力ファイルの種別を判定します.
+//-----------------------------------------------------------------------------
+INPUT_TYPE DetectType(const char* path)
+{
+    std::string inputPath;
+    if (!r3d::SearchFilePath(path, inputPath))
+    { return INPUT_TYPE_AUTO; }
+
+    std::ifstream stream(inputPath.c_str(), std::ios::in);
+    if (!stream.is_open())
+    { return INPUT_TYPE_AUTO; }
+
+    std::string token;
+    while(stream >> token)
+    {
+        if (token == "camera")
+        { return INPUT_TYPE_CAMERA; }
+
+        if (token == "model"
+         || token == "material"
+         || token == "instance"
+         || token == "ibl"
+         || token == "directional_light"
+         || token == "point_light")
+        { return INPUT_TYPE_SCENE; }
+    }
+
+    return INPUT_TYPE_AUTO;
+}
+
+//-----------------------------------------------------------------------------
+//      出力パスを決定します.
+//-----------------------------------------------------------------------------
+std::string GetOutputPath
+(
+    const Option&       option,
+    const std::string&  input,
+    const std::string&  exportPath,
+    const char*         ext
+)
+{
+    auto fileName = exportPath.empty()
+        ? r3d::RemoveDirectoryPath(r3d::GetPathWithoutExt(input.c_str()).c_str()) + ext
+        : r3d::RemoveDirectoryPath(exportPath.c_str());
+
+    if (!option.OutputDir.empty())
+    { return option.OutputDir + "/" + fileName; }
+
+    if (!exportPath.empty())
+    { return r3d::NormalizePath(exportPath.c_str()); }
+
+    return r3d::GetDirectoryPath(input.c_str()) + "/" + fileName;
+}
+
+//-----------------------------------------------------------------------------
+//      入力ファイルを変換します.
+//-----------------------------------------------------------------------------
+bool Compile(const Option& option, const std::string& input)
+{
+    auto type = option.Type;
+    if (type == INPUT_TYPE_AUTO)
+    { type = DetectType(input.c_str()); }
+
+    std::string exportPath;
+
+    if (type == INPUT_TYPE_SCENE)
+    {
+        r3d::offline::SceneExporter exporter;
+        exporter.SetPlacedFootprint(option.Placed);
+        exporter.SetBlobSize(option.BlobSize);
+        if (!exporter.Parse(input.c_str(), exportPath))
+        { return false; }
+
+        auto outputPath = GetOutputPath(option, input, exportPath, ".scn");
+        return exporter.Export(outputPath.c_str());
+    }
+    else if (type == INPUT_TYPE_CAMERA)
+    {
+        r3d::offline::CameraSequenceExporter exporter;
+        if (!exporter.Parse(input.c_str(), exportPath))
+        { return false; }
+
+        auto outputPath = GetOutputPath(option, input, exportPath, ".cam");
+        if (!exporter.Export(outputPath.c_str()))
+        { return false; }
+
+        ILOGA("Info : Camera Sequence Data Exported!! path = %s", outputPath.c_str());
+        return true;
+    }
+
+    ELOGA("Error : Unknown Input Type. path = %s", input.c_str());
+    return false;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Option option;
+    if (!ParseArgs(argc, argv, option))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    auto threadCount = option.ThreadCount;
+    if (threadCount == 0)
+    { threadCount = std::max(1u, std::thread::hardware_concurrency()); }
+    if (threadCount > option.Inputs.size())
+    { threadCount = uint32_t(option.Inputs.size()); }
+
+    // 入力ファイル単位で並列に変換.
+    std::atomic<size_t>   nextIndex(0);
+    std::atomic<uint32_t> failedCount(0);
+
+    auto worker = [&]() {
+        for(;;)
+        {
+            auto idx = nextIndex.fetch_add(1);
+            if (idx >= option.Inputs.size())
+            { break; }
+
+            if (!Compile(option, option.Inputs[idx]))
+            {
+                ELOGA("Error : Compile Failed. path = %s", option.Inputs[idx].c_str());
+                failedCount++;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(auto i=1u; i<threadCount; ++i)
+    { threads.emplace_back(worker); }
+
+    worker();
+
+    for(auto& thread : threads)
+    { thread.join(); }
+
+    return (failedCount == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1110 @@
+﻿//-----------------------------------------------------------------------------
+// File : main.cpp
+// Desc : Scene Inspector.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <SceneContainer.h>
+#include <SceneDiff.h>
+#include <TextureFootprint.h>
+#include <Compression.h>
+#include <CapacityPlanner.h>
+#include <BufferArena.h>
+#include <Platform.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+// D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT. コミットリソースはこの単位で確保される.
+static const uint64_t RESOURCE_PLACEMENT_ALIGNMENT          = 64 * 1024;
+// D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BYTE_ALIGNMENT.
+static const uint64_t ACCELERATION_STRUCTURE_ALIGNMENT      = 256;
+// D3D12_RAYTRACING_INSTANCE_DESC のサイズ.
+static const uint64_t RAYTRACING_INSTANCE_DESC_SIZE         = 64;
+
+// PREFER_FAST_TRACE での構築結果の目安 (ドライバ依存なので概算).
+static const uint64_t BLAS_RESULT_BYTES_PER_TRIANGLE        = 64;
+static const uint64_t BLAS_SCRATCH_BYTES_PER_TRIANGLE       = 32;
+static const uint64_t TLAS_RESULT_BYTES_PER_INSTANCE        = 128;
+static const uint64_t TLAS_SCRATCH_BYTES_PER_INSTANCE       = 64;
+
+// 以下は ModelMgr と同じ値. VB/IB はブロックからサブアロケートされる.
+static const uint64_t MODEL_MGR_MESH_BLOCK_SIZE             = 64 * 1024 * 1024;
+static const uint64_t MODEL_MGR_MESH_ALIGNMENT              = 256;
+// 以下は ModelMgr と同じ値. 容量はシーンの要素数をチャンク単位に切り上げて確保される.
+static const uint32_t MODEL_MGR_INSTANCE_CHUNK_COUNT        = 1024;
+static const uint32_t MODEL_MGR_MATERIAL_CHUNK_COUNT        = 256;
+static const uint32_t MODEL_MGR_MAX_INSTANCE_COUNT          = 1 << 24;
+static const uint32_t MODEL_MGR_MAX_MATERIAL_COUNT          = 1 << 24;
+// インスタンスとトランスフォームは毎フレーム書き換えるので FRAME_SLOT_COUNT 面ある.
+static const uint64_t MODEL_MGR_FRAME_SLOT_COUNT            = 3;
+// ModelMgr の GpuInstance, asdx::Transform3x4, Material のサイズ.
+static const uint64_t MODEL_MGR_INSTANCE_SIZE               = 12;
+static const uint64_t MODEL_MGR_TRANSFORM_SIZE              = 48;
+static const uint64_t MODEL_MGR_MATERIAL_SIZE               = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+// Option structure
+///////////////////////////////////////////////////////////////////////////////
+struct Option
+{
+    uint32_t                    ThreadCount = 0;
+    uint32_t                    TopCount    = 10;
+    bool                        Json        = false;
+    bool                        Diff        = false;
+    std::string                 OutputPath;
+    std::vector<std::string>    Inputs;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MipInfo structure
+///////////////////////////////////////////////////////////////////////////////
+struct MipInfo
+{
+    uint32_t    Width;
+    uint32_t    Height;
+    uint32_t    Depth;
+    uint64_t    Bytes;          //!< 1サーフェイス分のバイト数 (アップロード配置).
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// TextureInfo structure
+///////////////////////////////////////////////////////////////////////////////
+struct TextureInfo
+{
+    uint32_t                Dimension       = 0;
+    uint32_t                Width           = 0;
+    uint32_t                Height          = 0;
+    uint32_t                Depth           = 0;
+    uint32_t                Format          = 0;
+    uint32_t                MipLevels       = 0;
+    uint32_t                SurfaceCount    = 0;
+    uint32_t                Option          = 0;
+    uint64_t                PixelBytes      = 0;    //!< ファイルに格納されているピクセルのバイト数.
+    uint64_t                FootprintBytes  = 0;    //!< アップロードバッファ上のバイト数.
+    uint64_t                GpuBytes        = 0;    //!< デフォルトヒープ上の推定バイト数.
+    std::vector<MipInfo>    Mips;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MeshInfo structure
+///////////////////////////////////////////////////////////////////////////////
+struct MeshInfo
+{
+    uint32_t    VertexCount     = 0;
+    uint32_t    IndexCount      = 0;
+    uint64_t    VertexBytes     = 0;
+    uint64_t    IndexBytes      = 0;
+    uint64_t    BufferBytes     = 0;    //!< ModelMgr::AddMesh() がメッシュブロックから割り当てるVB/IBのバイト数.
+    uint64_t    BlasBytes       = 0;    //!< BLASの推定バイト数.
+    uint64_t    BlasScratch     = 0;    //!< BLAS構築用スクラッチの推定バイト数.
+    uint32_t    InstanceCount   = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// GpuEstimate structure
+///////////////////////////////////////////////////////////////////////////////
+struct GpuEstimate
+{
+    uint64_t    MeshBuffers     = 0;    //!< VB/IB を収めるメッシュブロック.
+    uint64_t    Textures        = 0;    //!< マテリアル用テクスチャ.
+    uint64_t    Ibl             = 0;    //!< IBLテクスチャ.
+    uint64_t    Blas            = 0;
+    uint64_t    BlasScratchMax  = 0;    //!< BLAS構築用スクラッチの最大値.
+    uint64_t    Tlas            = 0;    //!< TLAS本体とインスタンス記述.
+    uint64_t    TlasScratch     = 0;
+    uint64_t    ModelMgr        = 0;    //!< インスタンス・トランスフォーム・マテリアルバッファ.
+    uint64_t    Lights          = 0;
+
+    uint64_t GetTotal() const
+    { return MeshBuffers + Textures + Ibl + Blas + BlasScratchMax + Tlas + TlasScratch + ModelMgr + Lights; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneReport structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneReport
+{
+    std::string                         Path;
+    r3d::SceneContainerHeader           Header = {};
+    std::vector<r3d::SceneSectionEntry> Sections;
+    std::vector<uint64_t>               FileSizes;          //!< [0] がルートファイル, 以降がブロブファイル.
+    bool                                HasIbl = false;
+    TextureInfo                         Ibl;
+    std::vector<TextureInfo>            Textures;
+    std::vector<MeshInfo>               Meshes;
+    std::vector<uint32_t>               MaterialInstances;  //!< マテリアル毎の参照インスタンス数.
+    uint32_t                            PointLightCount       = 0;
+    uint32_t                            DirectionalLightCount = 0;
+    GpuEstimate                         Gpu;
+};
+
+//-----------------------------------------------------------------------------
+//      アラインメントを揃えます.
+//-----------------------------------------------------------------------------
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{ return (value + alignment - 1) & ~(alignment - 1); }
+
+//-----------------------------------------------------------------------------
+//      セクションタイプ名を取得します.
+//-----------------------------------------------------------------------------
+const char* GetSectionTypeName(uint32_t type)
+{
+    switch(type)
+    {
+    case r3d::SCENE_SECTION_TYPE_IBL:       return "ibl";
+    case r3d::SCENE_SECTION_TYPE_TEXTURES:  return "textures";
+    case r3d::SCENE_SECTION_TYPE_MESHES:    return "meshes";
+    case r3d::SCENE_SECTION_TYPE_MATERIALS: return "materials";
+    case r3d::SCENE_SECTION_TYPE_INSTANCES: return "instances";
+    case r3d::SCENE_SECTION_TYPE_LIGHTS:    return "lights";
+    case r3d::SCENE_SECTION_TYPE_SCENE:     return "scene";
+    }
+
+    return "unknown";
+}
+
+//-----------------------------------------------------------------------------
+//      圧縮形式名を取得します.
+//-----------------------------------------------------------------------------
+const char* GetCodecName(uint32_t codec)
+{
+    switch(codec)
+    {
+    case r3d::COMPRESSION_CODEC_NONE:   return "none";
+    case r3d::COMPRESSION_CODEC_LZ4:    return "lz4";
+    }
+
+    return "unknown";
+}
+
+//-----------------------------------------------------------------------------
+//      ファイルサイズを取得します.
+//-----------------------------------------------------------------------------
+uint64_t GetFileSize(const std::string& path)
+{
+    std::ifstream stream(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!stream.is_open())
+    { return 0; }
+
+    return uint64_t(stream.tellg());
+}
+
+//-----------------------------------------------------------------------------
+//      バイト数を読みやすい文字列に変換します.
+//-----------------------------------------------------------------------------
+std::string FormatBytes(uint64_t value)
+{
+    static const char* kUnits[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+
+    auto size = double(value);
+    auto unit = 0u;
+    while(size >= 1024.0 && unit + 1 < sizeof(kUnits) / sizeof(kUnits[0]))
+    {
+        size /= 1024.0;
+        unit++;
+    }
+
+    char buf[64];
+    if (unit == 0)
+    { snprintf(buf, sizeof(buf), "%llu B", static_cast<unsigned long long>(value)); }
+    else
+    { snprintf(buf, sizeof(buf), "%.2f %s", size, kUnits[unit]); }
+
+    return buf;
+}
+
+//-----------------------------------------------------------------------------
+//      テクスチャ情報を収集します.
+//-----------------------------------------------------------------------------
+void CollectTexture(const r3d::ResTexture* texture, TextureInfo& result)
+{
+    result = TextureInfo();
+    result.Dimension    = texture->Dimension();
+    result.Width        = texture->Width();
+    result.Height       = texture->Height();
+    result.Depth        = texture->Depth();
+    result.Format       = texture->Format();
+    result.MipLevels    = texture->MipLevels();
+    result.SurfaceCount = texture->SurfaceCount();
+    result.Option       = texture->Option();
+
+    auto resources = texture->Resources();
+    if (resources != nullptr)
+    {
+        for(auto i=0u; i<resources->size(); ++i)
+        {
+            auto pixels = resources->Get(i)->Pixels();
+            if (pixels != nullptr)
+            { result.PixelBytes += pixels->size(); }
+        }
+    }
+
+    std::vector<r3d::TextureFootprint> footprints;
+    if (r3d::CalcTextureFootprints(
+        result.Dimension,
+        result.Width,
+        result.Height,
+        result.Depth,
+        result.Format,
+        result.MipLevels,
+        result.SurfaceCount,
+        footprints,
+        result.FootprintBytes))
+    {
+        for(auto m=0u; m<result.MipLevels; ++m)
+        {
+            auto& footprint = footprints[m];
+
+            MipInfo mip = {};
+            mip.Width  = std::max(1u, result.Width  >> m);
+            mip.Height = std::max(1u, result.Height >> m);
+            mip.Depth  = footprint.Depth;
+            mip.Bytes  = uint64_t(footprint.RowPitch) * footprint.RowCount * footprint.Depth;
+            result.Mips.push_back(mip);
+        }
+    }
+    else
+    {
+        // 未対応フォーマットは格納されているピクセル数で代用.
+        result.FootprintBytes = result.PixelBytes;
+    }
+
+    result.GpuBytes = AlignUp(result.FootprintBytes, RESOURCE_PLACEMENT_ALIGNMENT);
+}
+
+//-----------------------------------------------------------------------------
+//      セクションに含まれる要素の情報を収集します.
+//-----------------------------------------------------------------------------
+bool CollectSection(const r3d::SceneSection& section, SceneReport& report)
+{
+    auto resScene = section.pScene;
+    if (resScene == nullptr)
+    { return false; }
+
+    if (resScene->IblTexture() != nullptr)
+    {
+        CollectTexture(resScene->IblTexture(), report.Ibl);
+        report.HasIbl = true;
+    }
+
+    if (resScene->Textures() != nullptr)
+    {
+        auto textures = resScene->Textures();
+        if (section.FirstIndex + textures->size() > report.Textures.size())
+        { return false; }
+
+        for(auto i=0u; i<textures->size(); ++i)
+        { CollectTexture(textures->Get(i), report.Textures[section.FirstIndex + i]); }
+    }
+
+    if (resScene->Meshes() != nullptr)
+    {
+        auto meshes = resScene->Meshes();
+        if (section.FirstIndex + meshes->size() > report.Meshes.size())
+        { return false; }
+
+        for(auto i=0u; i<meshes->size(); ++i)
+        {
+            auto  mesh = meshes->Get(i);
+            auto& dst  = report.Meshes[section.FirstIndex + i];
+            auto  triangleCount = uint64_t(mesh->IndexCount() / 3);
+
+            dst.VertexCount = mesh->VertexCount();
+            dst.IndexCount  = mesh->IndexCount();
+            dst.VertexBytes = uint64_t(dst.VertexCount) * sizeof(r3d::ResVertex);
+            dst.IndexBytes  = uint64_t(dst.IndexCount)  * sizeof(uint32_t);
+            dst.BufferBytes = AlignUp(dst.VertexBytes, MODEL_MGR_MESH_ALIGNMENT)
+                            + AlignUp(dst.IndexBytes,  MODEL_MGR_MESH_ALIGNMENT);
+            dst.BlasBytes   = AlignUp(triangleCount * BLAS_RESULT_BYTES_PER_TRIANGLE,  ACCELERATION_STRUCTURE_ALIGNMENT);
+            dst.BlasScratch = AlignUp(triangleCount * BLAS_SCRATCH_BYTES_PER_TRIANGLE, ACCELERATION_STRUCTURE_ALIGNMENT);
+        }
+    }
+
+    if (resScene->Instances() != nullptr)
+    {
+        auto instances = resScene->Instances();
+        for(auto i=0u; i<instances->size(); ++i)
+        {
+            auto instance = instances->Get(i);
+            if (instance->MeshIndex() < report.Meshes.size())
+            { report.Meshes[instance->MeshIndex()].InstanceCount++; }
+            if (instance->MaterialIndex() < report.MaterialInstances.size())
+            { report.MaterialInstances[instance->MaterialIndex()]++; }
+        }
+    }
+
+    if (resScene->Lights() != nullptr)
+    {
+        auto lights = resScene->Lights();
+        for(auto i=0u; i<lights->size(); ++i)
+        {
+            auto type = lights->Get(i)->Type();
+            if (type == r3d::LIGHT_TYPE_POINT)
+            { report.PointLightCount++; }
+            else if (type == r3d::LIGHT_TYPE_DIRECTIONAL)
+            { report.DirectionalLightCount++; }
+        }
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      GPUメモリ使用量を見積もります.
+//-----------------------------------------------------------------------------
+void EstimateGpuMemory(SceneReport& report)
+{
+    auto& gpu    = report.Gpu;
+    auto& header = report.Header;
+
+    // ModelMgr::AddMesh() と同じ順に割り当てて, 確保されるブロックを数える.
+    r3d::BufferArena meshArena;
+    meshArena.Init(MODEL_MGR_MESH_BLOCK_SIZE, MODEL_MGR_MESH_ALIGNMENT);
+
+    for(auto& mesh : report.Meshes)
+    {
+        r3d::ArenaAllocation allocation;
+        meshArena.Alloc(mesh.BufferBytes, allocation);
+
+        gpu.Blas          += mesh.BlasBytes;
+        gpu.BlasScratchMax = std::max(gpu.BlasScratchMax, mesh.BlasScratch);
+    }
+
+    for(auto i=0u; i<meshArena.GetBlockCount(); ++i)
+    { gpu.MeshBuffers += AlignUp(meshArena.GetBlockSize(i), RESOURCE_PLACEMENT_ALIGNMENT); }
+
+    meshArena.Term();
+
+    for(auto& texture : report.Textures)
+    { gpu.Textures += texture.GpuBytes; }
+
+    if (report.HasIbl)
+    { gpu.Ibl = report.Ibl.GpuBytes; }
+
+    gpu.Tlas = AlignUp(header.InstanceCount * TLAS_RESULT_BYTES_PER_INSTANCE, ACCELERATION_STRUCTURE_ALIGNMENT)
+             + AlignUp(header.InstanceCount * RAYTRACING_INSTANCE_DESC_SIZE,  RESOURCE_PLACEMENT_ALIGNMENT);
+    gpu.TlasScratch = AlignUp(header.InstanceCount * TLAS_SCRATCH_BYTES_PER_INSTANCE, ACCELERATION_STRUCTURE_ALIGNMENT);
+
+    // ModelMgr::Init() と同じく最低1要素分を確保する.
+    r3d::CapacityPlanner instancePlanner;
+    r3d::CapacityPlanner materialPlanner;
+    instancePlanner.Init(MODEL_MGR_INSTANCE_CHUNK_COUNT, MODEL_MGR_MAX_INSTANCE_COUNT);
+    materialPlanner.Init(MODEL_MGR_MATERIAL_CHUNK_COUNT, MODEL_MGR_MAX_MATERIAL_COUNT);
+
+    uint32_t instanceCapacity = 0;
+    uint32_t materialCapacity = 0;
+    if (!instancePlanner.Plan(0, std::max(header.InstanceCount, 1u), instanceCapacity))
+    { instanceCapacity = MODEL_MGR_MAX_INSTANCE_COUNT; }
+    if (!materialPlanner.Plan(0, std::max(header.MaterialCount, 1u), materialCapacity))
+    { materialCapacity = MODEL_MGR_MAX_MATERIAL_COUNT; }
+
+    gpu.ModelMgr = MODEL_MGR_FRAME_SLOT_COUNT
+                 * (AlignUp(instanceCapacity * MODEL_MGR_INSTANCE_SIZE,  RESOURCE_PLACEMENT_ALIGNMENT)
+                  + AlignUp(instanceCapacity * MODEL_MGR_TRANSFORM_SIZE, RESOURCE_PLACEMENT_ALIGNMENT))
+                 + AlignUp(materialCapacity * MODEL_MGR_MATERIAL_SIZE, RESOURCE_PLACEMENT_ALIGNMENT);
+
+    if (header.LightCount > 0)
+    { gpu.Lights = AlignUp(uint64_t(header.LightCount) * sizeof(r3d::ResLight), RESOURCE_PLACEMENT_ALIGNMENT); }
+}
+
+//-----------------------------------------------------------------------------
+//      シーンファイルを解析します.
+//-----------------------------------------------------------------------------
+bool Inspect(const Option& option, const std::string& path, SceneReport& report)
+{
+    r3d::SceneContainer container;
+    if (!container.Init(path.c_str()))
+    {
+        ELOGA("Error : SceneContainer::Init() Failed. path = %s", path.c_str());
+        return false;
+    }
+
+    report.Path     = path;
+    report.Header   = container.GetHeader();
+    report.Sections = container.GetEntries();
+
+    report.FileSizes.push_back(GetFileSize(path));
+    for(auto i=1u; i<=report.Header.BlobCount; ++i)
+    { report.FileSizes.push_back(GetFileSize(r3d::GetSceneBlobPath(path.c_str(), i))); }
+
+    report.Textures         .resize(report.Header.TextureCount);
+    report.Meshes           .resize(report.Header.MeshCount);
+    report.MaterialInstances.resize(report.Header.MaterialCount);
+
+    auto ret = container.Decode(option.ThreadCount, [&](const r3d::SceneSection& section)
+    {
+        if (!CollectSection(section, report))
+        {
+            ELOGA("Error : Invalid Scene Section. index = %u", section.Index);
+            return false;
+        }
+
+        container.ReleaseSection(section.Index);
+        return true;
+    });
+
+    if (!ret)
+    {
+        ELOGA("Error : SceneContainer::Decode() Failed. path = %s", path.c_str());
+        return false;
+    }
+
+    EstimateGpuMemory(report);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      値の大きい順に並べた番号を取得します.
+//-----------------------------------------------------------------------------
+template<typename Func>
+std::vector<uint32_t> SortIndices(size_t count, uint32_t topCount, Func key)
+{
+    std::vector<uint32_t> result(count);
+    std::iota(result.begin(), result.end(), 0u);
+    std::stable_sort(result.begin(), result.end(), [&](uint32_t lhs, uint32_t rhs)
+    { return key(lhs) > key(rhs); });
+
+    if (topCount > 0 && result.size() > topCount)
+    { result.resize(topCount); }
+
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      テクスチャ情報をテキストで出力します.
+//-----------------------------------------------------------------------------
+void PrintTextureText(FILE* pFile, const char* label, const TextureInfo& texture)
+{
+    fprintf(pFile, "  %-8s %-24s %5ux%-5u x%-3u mips %2u surfaces %2u %s%s\n",
+        label,
+        r3d::GetFormatName(texture.Format),
+        texture.Width,
+        texture.Height,
+        texture.Depth,
+        texture.MipLevels,
+        texture.SurfaceCount,
+        FormatBytes(texture.GpuBytes).c_str(),
+        (texture.Option & r3d::TEXTURE_OPTION_PLACED_FOOTPRINT) ? " (placed)" : "");
+
+    for(size_t m=0; m<texture.Mips.size(); ++m)
+    {
+        auto& mip = texture.Mips[m];
+        fprintf(pFile, "             mip %2zu : %5ux%-5u %s\n", m, mip.Width, mip.Height, FormatBytes(mip.Bytes).c_str());
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      レポートをテキストで出力します.
+//-----------------------------------------------------------------------------
+void PrintText(FILE* pFile, const Option& option, const SceneReport& report)
+{
+    auto& header = report.Header;
+
+    uint64_t fileBytes = 0;
+    for(auto size : report.FileSizes)
+    { fileBytes += size; }
+
+    uint64_t triangleCount = 0;
+    uint64_t vertexCount   = 0;
+    for(auto& mesh : report.Meshes)
+    {
+        triangleCount += mesh.IndexCount / 3;
+        vertexCount   += mesh.VertexCount;
+    }
+
+    fprintf(pFile, "scene : %s\n", report.Path.c_str());
+    fprintf(pFile, "  version %u, sections %u, blobs %u, files %s\n",
+        header.Version, header.SectionCount, header.BlobCount, FormatBytes(fileBytes).c_str());
+    fprintf(pFile, "  meshes %u (%llu triangles, %llu vertices), instances %u, textures %u, materials %u, lights %u (point %u, directional %u)\n",
+        header.MeshCount,
+        static_cast<unsigned long long>(triangleCount),
+        static_cast<unsigned long long>(vertexCount),
+        header.InstanceCount,
+        header.TextureCount,
+        header.MaterialCount,
+        header.LightCount,
+        report.PointLightCount,
+        report.DirectionalLightCount);
+
+    // セクション.
+    fprintf(pFile, "\nsections :\n");
+    fprintf(pFile, "  %5s %-10s %4s %-5s %8s %8s %12s %12s %6s\n",
+        "index", "type", "file", "codec", "first", "count", "stored", "raw", "ratio");
+    for(size_t i=0; i<report.Sections.size(); ++i)
+    {
+        auto& entry = report.Sections[i];
+        fprintf(pFile, "  %5zu %-10s %4u %-5s %8u %8u %12s %12s %5.1f%%\n",
+            i,
+            GetSectionTypeName(entry.Type),
+            entry.File,
+            GetCodecName(entry.Codec),
+            entry.FirstIndex,
+            entry.Count,
+            FormatBytes(entry.StoredSize).c_str(),
+            FormatBytes(entry.RawSize).c_str(),
+            (entry.RawSize > 0) ? 100.0 * double(entry.StoredSize) / double(entry.RawSize) : 100.0);
+    }
+
+    // メッシュ.
+    auto meshIndices = SortIndices(report.Meshes.size(), option.TopCount,
+        [&](uint32_t i) { return report.Meshes[i].IndexCount; });
+    fprintf(pFile, "\nmeshes (by triangles, %zu of %zu) :\n", meshIndices.size(), report.Meshes.size());
+    fprintf(pFile, "  %6s %10s %10s %12s %12s %9s\n", "index", "triangles", "vertices", "vb+ib", "blas", "instances");
+    for(auto i : meshIndices)
+    {
+        auto& mesh = report.Meshes[i];
+        fprintf(pFile, "  %6u %10u %10u %12s %12s %9u\n",
+            i,
+            mesh.IndexCount / 3,
+            mesh.VertexCount,
+            FormatBytes(mesh.BufferBytes).c_str(),
+            FormatBytes(mesh.BlasBytes).c_str(),
+            mesh.InstanceCount);
+    }
+
+    // テクスチャ.
+    auto textureIndices = SortIndices(report.Textures.size(), option.TopCount,
+        [&](uint32_t i) { return report.Textures[i].GpuBytes; });
+    fprintf(pFile, "\ntextures (by size, %zu of %zu) :\n", textureIndices.size(), report.Textures.size());
+    if (report.HasIbl)
+    { PrintTextureText(pFile, "ibl", report.Ibl); }
+    for(auto i : textureIndices)
+    {
+        char label[16];
+        snprintf(label, sizeof(label), "%u", i);
+        PrintTextureText(pFile, label, report.Textures[i]);
+    }
+
+    // インスタンスの分布.
+    auto meshHistogram = SortIndices(report.Meshes.size(), option.TopCount,
+        [&](uint32_t i) { return report.Meshes[i].InstanceCount; });
+    fprintf(pFile, "\ninstances per mesh (%zu of %zu) :\n", meshHistogram.size(), report.Meshes.size());
+    for(auto i : meshHistogram)
+    { fprintf(pFile, "  mesh %6u : %u\n", i, report.Meshes[i].InstanceCount); }
+
+    auto materialHistogram = SortIndices(report.MaterialInstances.size(), option.TopCount,
+        [&](uint32_t i) { return report.MaterialInstances[i]; });
+    fprintf(pFile, "\ninstances per material (%zu of %zu) :\n", materialHistogram.size(), report.MaterialInstances.size());
+    for(auto i : materialHistogram)
+    { fprintf(pFile, "  material %6u : %u\n", i, report.MaterialInstances[i]); }
+
+    // GPUメモリ.
+    auto& gpu = report.Gpu;
+    fprintf(pFile, "\ngpu memory (estimate) :\n");
+    fprintf(pFile, "  mesh buffers   : %s\n", FormatBytes(gpu.MeshBuffers)   .c_str());
+    fprintf(pFile, "  textures       : %s\n", FormatBytes(gpu.Textures)      .c_str());
+    fprintf(pFile, "  ibl            : %s\n", FormatBytes(gpu.Ibl)           .c_str());
+    fprintf(pFile, "  blas           : %s\n", FormatBytes(gpu.Blas)          .c_str());
+    fprintf(pFile, "  blas scratch   : %s\n", FormatBytes(gpu.BlasScratchMax).c_str());
+    fprintf(pFile, "  tlas           : %s\n", FormatBytes(gpu.Tlas)          .c_str());
+    fprintf(pFile, "  tlas scratch   : %s\n", FormatBytes(gpu.TlasScratch)   .c_str());
+    fprintf(pFile, "  model manager  : %s\n", FormatBytes(gpu.ModelMgr)      .c_str());
+    fprintf(pFile, "  lights         : %s\n", FormatBytes(gpu.Lights)        .c_str());
+    fprintf(pFile, "  total          : %s\n", FormatBytes(gpu.GetTotal())    .c_str());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// JsonWriter class
+///////////////////////////////////////////////////////////////////////////////
+class JsonWriter
+{
+public:
+    explicit JsonWriter(FILE* pFile)
+    : m_pFile(pFile)
+    { /* DO_NOTHING */ }
+
+    void BeginObject(const char* key = nullptr)
+    { Begin(key, '{'); }
+
+    void EndObject()
+    { End('}'); }
+
+    void BeginArray(const char* key = nullptr)
+    { Begin(key, '['); }
+
+    void EndArray()
+    { End(']'); }
+
+    void Value(const char* key, uint64_t value)
+    {
+        Key(key);
+        fprintf(m_pFile, "%llu", static_cast<unsigned long long>(value));
+    }
+
+    void Value(const char* key, const char* value)
+    {
+        Key(key);
+        fputc('"', m_pFile);
+        for(auto c = value; *c != '\0'; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+            { fprintf(m_pFile, "\\%c", *c); }
+            else if (uint8_t(*c) < 0x20)
+            { fprintf(m_pFile, "\\u%04x", uint8_t(*c)); }
+            else
+            { fputc(*c, m_pFile); }
+        }
+        fputc('"', m_pFile);
+    }
+
+    void Value(const char* key, bool value)
+    {
+        Key(key);
+        fputs(value ? "true" : "false", m_pFile);
+    }
+
+private:
+    FILE*               m_pFile;
+    std::vector<bool>   m_First;    //!< 階層毎に最初の要素かどうか.
+
+    void Key(const char* key)
+    {
+        if (!m_First.empty())
+        {
+            if (!m_First.back())
+            { fputc(',', m_pFile); }
+            m_First.back() = false;
+
+            fputc('\n', m_pFile);
+            Indent();
+        }
+
+        if (key != nullptr)
+        { fprintf(m_pFile, "\"%s\": ", key); }
+    }
+
+    void Begin(const char* key, char c)
+    {
+        Key(key);
+        fputc(c, m_pFile);
+        m_First.push_back(true);
+    }
+
+    void End(char c)
+    {
+        auto empty = m_First.back();
+        m_First.pop_back();
+        if (!empty)
+        {
+            fputc('\n', m_pFile);
+            Indent();
+        }
+        fputc(c, m_pFile);
+
+        if (m_First.empty())
+        { fputc('\n', m_pFile); }
+    }
+
+    void Indent()
+    {
+        for(size_t i=0; i<m_First.size(); ++i)
+        { fputs("  ", m_pFile); }
+    }
+};
+
+//-----------------------------------------------------------------------------
+//      テクスチャ情報をJSONで出力します.
+//-----------------------------------------------------------------------------
+void WriteTextureJson(JsonWriter& writer, const char* key, const TextureInfo& texture)
+{
+    writer.BeginObject(key);
+    writer.Value("dimension",       uint64_t(texture.Dimension));
+    writer.Value("width",           uint64_t(texture.Width));
+    writer.Value("height",          uint64_t(texture.Height));
+    writer.Value("depth",           uint64_t(texture.Depth));
+    writer.Value("format",          r3d::GetFormatName(texture.Format));
+    writer.Value("format_id",       uint64_t(texture.Format));
+    writer.Value("mip_levels",      uint64_t(texture.MipLevels));
+    writer.Value("surface_count",   uint64_t(texture.SurfaceCount));
+    writer.Value("placed",          (texture.Option & r3d::TEXTURE_OPTION_PLACED_FOOTPRINT) != 0);
+    writer.Value("pixel_bytes",     texture.PixelBytes);
+    writer.Value("footprint_bytes", texture.FootprintBytes);
+    writer.Value("gpu_bytes",       texture.GpuBytes);
+
+    writer.BeginArray("mips");
+    for(auto& mip : texture.Mips)
+    {
+        writer.BeginObject();
+        writer.Value("width",  uint64_t(mip.Width));
+        writer.Value("height", uint64_t(mip.Height));
+        writer.Value("depth",  uint64_t(mip.Depth));
+        writer.Value("bytes",  mip.Bytes);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.EndObject();
+}
+
+//-----------------------------------------------------------------------------
+//      レポートをJSONで出力します.
+//-----------------------------------------------------------------------------
+void WriteJson(JsonWriter& writer, const SceneReport& report)
+{
+    auto& header = report.Header;
+    auto& gpu    = report.Gpu;
+
+    writer.BeginObject();
+    writer.Value("path",    report.Path.c_str());
+    writer.Value("version", uint64_t(header.Version));
+
+    writer.BeginObject("counts");
+    writer.Value("sections",           uint64_t(header.SectionCount));
+    writer.Value("blobs",              uint64_t(header.BlobCount));
+    writer.Value("meshes",             uint64_t(header.MeshCount));
+    writer.Value("instances",          uint64_t(header.InstanceCount));
+    writer.Value("textures",           uint64_t(header.TextureCount));
+    writer.Value("materials",          uint64_t(header.MaterialCount));
+    writer.Value("lights",             uint64_t(header.LightCount));
+    writer.Value("point_lights",       uint64_t(report.PointLightCount));
+    writer.Value("directional_lights", uint64_t(report.DirectionalLightCount));
+    writer.EndObject();
+
+    writer.BeginArray("files");
+    for(size_t i=0; i<report.FileSizes.size(); ++i)
+    {
+        auto path = (i == 0) ? report.Path : r3d::GetSceneBlobPath(report.Path.c_str(), uint32_t(i));
+        writer.BeginObject();
+        writer.Value("path",  path.c_str());
+        writer.Value("bytes", report.FileSizes[i]);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.BeginArray("sections");
+    for(auto& entry : report.Sections)
+    {
+        writer.BeginObject();
+        writer.Value("type",         GetSectionTypeName(entry.Type));
+        writer.Value("file",         uint64_t(entry.File));
+        writer.Value("codec",        GetCodecName(entry.Codec));
+        writer.Value("first_index",  uint64_t(entry.FirstIndex));
+        writer.Value("count",        uint64_t(entry.Count));
+        writer.Value("offset",       entry.Offset);
+        writer.Value("stored_bytes", entry.StoredSize);
+        writer.Value("raw_bytes",    entry.RawSize);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    writer.BeginArray("meshes");
+    for(auto& mesh : report.Meshes)
+    {
+        writer.BeginObject();
+        writer.Value("triangles",    uint64_t(mesh.IndexCount / 3));
+        writer.Value("vertices",     uint64_t(mesh.VertexCount));
+        writer.Value("indices",      uint64_t(mesh.IndexCount));
+        writer.Value("vertex_bytes", mesh.VertexBytes);
+        writer.Value("index_bytes",  mesh.IndexBytes);
+        writer.Value("buffer_bytes", mesh.BufferBytes);
+        writer.Value("blas_bytes",   mesh.BlasBytes);
+        writer.Value("instances",    uint64_t(mesh.InstanceCount));
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    if (report.HasIbl)
+    { WriteTextureJson(writer, "ibl", report.Ibl); }
+
+    writer.BeginArray("textures");
+    for(auto& texture : report.Textures)
+    { WriteTextureJson(writer, nullptr, texture); }
+    writer.EndArray();
+
+    writer.BeginArray("material_instances");
+    for(auto count : report.MaterialInstances)
+    { writer.Value(nullptr, uint64_t(count)); }
+    writer.EndArray();
+
+    writer.BeginObject("gpu_estimate");
+    writer.Value("mesh_buffers",  gpu.MeshBuffers);
+    writer.Value("textures",      gpu.Textures);
+    writer.Value("ibl",           gpu.Ibl);
+    writer.Value("blas",          gpu.Blas);
+    writer.Value("blas_scratch",  gpu.BlasScratchMax);
+    writer.Value("tlas",          gpu.Tlas);
+    writer.Value("tlas_scratch",  gpu.TlasScratch);
+    writer.Value("model_manager", gpu.ModelMgr);
+    writer.Value("lights",        gpu.Lights);
+    writer.Value("total",         gpu.GetTotal());
+    writer.EndObject();
+
+    writer.EndObject();
+}
+
+//-----------------------------------------------------------------------------
+//      範囲に含まれる要素数を求めます.
+//-----------------------------------------------------------------------------
+uint64_t CountRanges(const std::vector<r3d::SceneRange>& ranges)
+{
+    uint64_t result = 0;
+    for(auto& range : ranges)
+    { result += range.Count; }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      差分の範囲をテキストで出力します.
+//-----------------------------------------------------------------------------
+void PrintRangesText
+(
+    FILE*                               pFile,
+    const char*                         label,
+    const std::vector<r3d::SceneRange>& ranges,
+    uint32_t                            topCount
+)
+{
+    fprintf(pFile, "  %-10s : %llu changed in %zu ranges\n",
+        label, static_cast<unsigned long long>(CountRanges(ranges)), ranges.size());
+
+    auto count = (topCount > 0) ? std::min(ranges.size(), size_t(topCount)) : ranges.size();
+    for(size_t i=0; i<count; ++i)
+    {
+        auto& range = ranges[i];
+        if (range.Index == range.NewIndex)
+        { fprintf(pFile, "    [%u, %u)\n", range.Index, range.Index + range.Count); }
+        else
+        { fprintf(pFile, "    [%u, %u) -> [%u, %u)\n", range.Index, range.Index + range.Count, range.NewIndex, range.NewIndex + range.Count); }
+    }
+    if (count < ranges.size())
+    { fprintf(pFile, "    ... %zu more\n", ranges.size() - count); }
+}
+
+//-----------------------------------------------------------------------------
+//      差分をテキストで出力します.
+//-----------------------------------------------------------------------------
+void PrintDiffText(FILE* pFile, const Option& option, const r3d::SceneDiff& diff)
+{
+    fprintf(pFile, "diff : %s -> %s\n", option.Inputs[0].c_str(), option.Inputs[1].c_str());
+    if (diff.IsEmpty())
+    {
+        fprintf(pFile, "  no changes\n");
+        return;
+    }
+
+    if (diff.Rebuild)
+    {
+        fprintf(pFile, "  rebuild    : %s\n", (diff.Reason != nullptr) ? diff.Reason : "unknown");
+        return;
+    }
+
+    fprintf(pFile, "  %-10s : %zu changed\n", "meshes", diff.Meshes.size());
+    auto count = (option.TopCount > 0) ? std::min(diff.Meshes.size(), size_t(option.TopCount)) : diff.Meshes.size();
+    for(size_t i=0; i<count; ++i)
+    { fprintf(pFile, "    %u\n", diff.Meshes[i]); }
+    if (count < diff.Meshes.size())
+    { fprintf(pFile, "    ... %zu more\n", diff.Meshes.size() - count); }
+
+    PrintRangesText(pFile, "materials", diff.Materials, option.TopCount);
+    PrintRangesText(pFile, "instances", diff.Instances, option.TopCount);
+    PrintRangesText(pFile, "lights",    diff.Lights,    option.TopCount);
+}
+
+//-----------------------------------------------------------------------------
+//      差分の範囲をJSONで出力します.
+//-----------------------------------------------------------------------------
+void WriteRangesJson(JsonWriter& writer, const char* key, const std::vector<r3d::SceneRange>& ranges)
+{
+    writer.BeginArray(key);
+    for(auto& range : ranges)
+    {
+        writer.BeginObject();
+        writer.Value("index",     uint64_t(range.Index));
+        writer.Value("new_index", uint64_t(range.NewIndex));
+        writer.Value("count",     uint64_t(range.Count));
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+//-----------------------------------------------------------------------------
+//      差分をJSONで出力します.
+//-----------------------------------------------------------------------------
+void WriteDiffJson(JsonWriter& writer, const Option& option, const r3d::SceneDiff& diff)
+{
+    writer.BeginObject();
+    writer.Value("prev",    option.Inputs[0].c_str());
+    writer.Value("next",    option.Inputs[1].c_str());
+    writer.Value("empty",   diff.IsEmpty());
+    writer.Value("rebuild", diff.Rebuild);
+    if (diff.Rebuild && diff.Reason != nullptr)
+    { writer.Value("reason", diff.Reason); }
+
+    writer.BeginArray("meshes");
+    for(auto index : diff.Meshes)
+    { writer.Value(nullptr, uint64_t(index)); }
+    writer.EndArray();
+
+    WriteRangesJson(writer, "materials", diff.Materials);
+    WriteRangesJson(writer, "instances", diff.Instances);
+    WriteRangesJson(writer, "lights",    diff.Lights);
+    writer.EndObject();
+}
+
+//-----------------------------------------------------------------------------
+//      2つのシーンの差分を出力します.
+//-----------------------------------------------------------------------------
+bool PrintDiff(FILE* pFile, const Option& option)
+{
+    r3d::SceneDigest prev;
+    r3d::SceneDigest next;
+    for(auto i=0u; i<2; ++i)
+    {
+        if (!r3d::LoadSceneDigest(option.Inputs[i].c_str(), (i == 0) ? prev : next))
+        {
+            ELOGA("Error : LoadSceneDigest() Failed. path = %s", option.Inputs[i].c_str());
+            return false;
+        }
+    }
+
+    r3d::SceneDiff diff;
+    r3d::DiffScene(prev, next, diff);
+
+    if (option.Json)
+    {
+        JsonWriter writer(pFile);
+        WriteDiffJson(writer, option, diff);
+    }
+    else
+    { PrintDiffText(pFile, option, diff); }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      使用方法を表示します.
+//-----------------------------------------------------------------------------
+void PrintUsage()
+{
+    printf("Usage : scninfo [options] <scene.scn> ...\n");
+    printf("        scninfo [options] --diff <prev.scn> <next.scn>\n");
+    printf("Options :\n");
+    printf("    -j <count>                  : worker thread count (default: hardware concurrency).\n");
+    printf("    -n <count>                  : number of rows in text tables (default: 10, 0: all).\n");
+    printf("    -o <file>                   : output file (default: stdout).\n");
+    printf("    --json                      : output JSON instead of text.\n");
+    printf("    --diff                      : show changes between two scenes as seen by hot reload.\n");
+    printf("    -h                          : show this message.\n");
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドライン引数を解析します.
+//-----------------------------------------------------------------------------
+bool ParseArgs(int argc, char** argv, Option& option)
+{
+    for(auto i=1; i<argc; ++i)
+    {
+        auto arg = argv[i];
+        auto hasNext = (i + 1 < argc);
+
+        if (0 == strcmp(arg, "-h") || 0 == strcmp(arg, "--help"))
+        { return false; }
+        else if (0 == strcmp(arg, "-j") && hasNext)
+        { option.ThreadCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-n") && hasNext)
+        { option.TopCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-o") && hasNext)
+        { option.OutputPath = argv[++i]; }
+        else if (0 == strcmp(arg, "--json"))
+        { option.Json = true; }
+        else if (0 == strcmp(arg, "--diff"))
+        { option.Diff = true; }
+        else if (arg[0] == '-')
+        {
+            ELOGA("Error : Unknown Option. option = %s", arg);
+            return false;
+        }
+        else
+        { option.Inputs.push_back(arg); }
+    }
+
+    if (option.Diff && option.Inputs.size() != 2)
+    {
+        ELOGA("Error : --diff requires two scene files.");
+        return false;
+    }
+
+    return !option.Inputs.empty();
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Option option;
+    if (!ParseArgs(argc, argv, option))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    auto pFile = stdout;
+    if (!option.OutputPath.empty())
+    {
+        pFile = fopen(option.OutputPath.c_str(), "w");
+        if (pFile == nullptr)
+        {
+            ELOGA("Error : File Open Failed. path = %s", option.OutputPath.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (option.Diff)
+    {
+        auto ret = PrintDiff(pFile, option);
+        if (pFile != stdout)
+        { fclose(pFile); }
+
+        return ret ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    JsonWriter writer(pFile);
+    if (option.Json)
+    { writer.BeginArray(); }
+
+    auto failed = false;
+    for(size_t i=0; i<option.Inputs.size(); ++i)
+    {
+        SceneReport report;
+        if (!Inspect(option, option.Inputs[i], report))
+        {
+            failed = true;
+            continue;
+        }
+
+        if (option.Json)
+        { WriteJson(writer, report); }
+        else
+        {
+            if (i > 0)
+            { fprintf(pFile, "\n"); }
+            PrintText(pFile, option, report);
+        }
+    }
+
+    if (option.Json)
+    { writer.EndArray(); }
+
+    if (pFile != stdout)
+    { fclose(pFile); }
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,320 @@
+﻿//-----------------------------------------------------------------------------
+// File : BudgetSchedulerTest.cpp
+// Desc : BudgetScheduler Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <BudgetScheduler.h>
+#include <BudgetSim.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+//      許容誤差内で等しいかどうか.
+//-----------------------------------------------------------------------------
+bool IsNear(double a, double b, double eps = 1e-6)
+{ return std::abs(a - b) <= eps * std::max(1.0, std::abs(b)); }
+
+//-----------------------------------------------------------------------------
+//      スケジューラーを初期化します.
+//-----------------------------------------------------------------------------
+bool InitScheduler(r3d::BudgetScheduler& scheduler, uint32_t frameCount, double minScale, double maxScale)
+{
+    r3d::BudgetSchedulerDesc desc = {};
+    desc.FrameCount = frameCount;
+    desc.MinScale   = minScale;
+    desc.MaxScale   = maxScale;
+    return scheduler.Init(desc);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SimTotal structure
+///////////////////////////////////////////////////////////////////////////////
+struct SimTotal
+{
+    uint32_t    MissedRuns  = 0;    //!< 出力できないフレームがあったか締め切りを過ぎた回数.
+    double      P95Error    = 0.0;
+    double      Spread      = 0.0;
+};
+
+//-----------------------------------------------------------------------------
+//      budgetsim と同じ手順で複数のシーケンスをシミュレーションします.
+//-----------------------------------------------------------------------------
+void RunSimulation(const r3d::BudgetSimOption& option, SimTotal (&total)[r3d::BUDGET_POLICY_COUNT])
+{
+    std::mt19937 random(option.Seed);
+    for(auto r=0u; r<option.RunCount; ++r)
+    {
+        r3d::BudgetSimSequence sequence;
+        r3d::CreateBudgetSequence(option, random, sequence);
+
+        for(auto p=0u; p<r3d::BUDGET_POLICY_COUNT; ++p)
+        {
+            std::mt19937 measure(option.Seed + r);
+            auto result = r3d::SimulateBudget(option, sequence, r3d::BUDGET_POLICY(p), measure);
+
+            if (result.CapturedCount < option.FrameCount || result.FinishSec > option.RenderTimeSec + option.FrameCostSec * 2.0)
+            { total[p].MissedRuns++; }
+
+            total[p].P95Error += result.P95Error;
+            total[p].Spread   += result.Spread;
+        }
+    }
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      不正な引数を拒否します.
+//-----------------------------------------------------------------------------
+R3D_TEST(InitRejectsInvalidArgs)
+{
+    r3d::BudgetScheduler scheduler;
+    R3D_CHECK(!InitScheduler(scheduler, 0, 0.0, 0.0));
+    R3D_CHECK(!InitScheduler(scheduler, 4, 2.0, 0.0));
+    R3D_CHECK(!InitScheduler(scheduler, 4, 0.0, 0.5));
+    R3D_CHECK(InitScheduler(scheduler, 4, 0.0, 0.0));
+    R3D_CHECK(scheduler.GetPendingCount() == 4);
+}
+
+//-----------------------------------------------------------------------------
+//      推定値が無ければ均等に割り振ります.
+//-----------------------------------------------------------------------------
+R3D_TEST(UniformWithoutEstimates)
+{
+    r3d::BudgetScheduler scheduler;
+    R3D_REQUIRE(InitScheduler(scheduler, 4, 0.0, 0.0));
+
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(0, 12.0, 4.0), 2.0));
+
+    // 完了したフレームは数えない.
+    scheduler.SetDone(0, 2.0);
+    R3D_CHECK(scheduler.GetPendingCount() == 3);
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(1, 12.0, 6.0), 2.0));
+
+    // 締め切りを過ぎていれば 0.
+    R3D_CHECK(scheduler.GetFrameTime(1, 12.0, 20.0) == 0.0);
+}
+
+//-----------------------------------------------------------------------------
+//      難しさに比例して割り振ります.
+//-----------------------------------------------------------------------------
+R3D_TEST(ProportionalToDifficulty)
+{
+    r3d::BudgetScheduler scheduler;
+    R3D_REQUIRE(InitScheduler(scheduler, 4, 0.25, 4.0));
+
+    // 難しさは (分散) x (描画時間).
+    scheduler.SetEstimate(0, 1.0, 1.0);
+    scheduler.SetEstimate(1, 1.0, 1.0);
+    scheduler.SetEstimate(2, 1.0, 1.0);
+    scheduler.SetEstimate(3, 3.0, 1.0);
+    R3D_CHECK(scheduler.GetStats().EstimateCount == 4);
+
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(0, 12.0, 0.0), 2.0, 1e-4));
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(3, 12.0, 0.0), 6.0, 1e-4));
+}
+
+//-----------------------------------------------------------------------------
+//      推定していないフレームは前後から補間します.
+//-----------------------------------------------------------------------------
+R3D_TEST(InterpolatesMissingEstimates)
+{
+    r3d::BudgetScheduler scheduler;
+    R3D_REQUIRE(InitScheduler(scheduler, 5, 0.0, 0.0));
+
+    scheduler.SetEstimate(0, 1.0, 1.0);
+    scheduler.SetEstimate(4, 5.0, 1.0);
+
+    R3D_CHECK(IsNear(scheduler.GetDifficulty(2), 3.0));
+    R3D_CHECK(IsNear(scheduler.GetDifficulty(1), 2.0));
+}
+
+//-----------------------------------------------------------------------------
+//      均等に割り振った時間の上限で切ります.
+//-----------------------------------------------------------------------------
+R3D_TEST(ClampsToMaxScale)
+{
+    r3d::BudgetScheduler scheduler;
+    R3D_REQUIRE(InitScheduler(scheduler, 4, 0.5, 2.0));
+
+    scheduler.SetEstimate(0, 1.0, 1.0);
+    scheduler.SetEstimate(1, 1.0, 1.0);
+    scheduler.SetEstimate(2, 1.0, 1.0);
+    scheduler.SetEstimate(3, 100.0, 1.0);
+
+    // 上限で切った分は他のフレームに回る.
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(3, 12.0, 0.0), 6.0, 1e-4));
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(0, 12.0, 0.0), 2.0, 1e-4));
+
+    auto stats = scheduler.GetStats();
+    R3D_CHECK(IsNear(stats.MinFrameSec, 2.0, 1e-4));
+    R3D_CHECK(IsNear(stats.MaxFrameSec, 6.0, 1e-4));
+}
+
+//-----------------------------------------------------------------------------
+//      後に残すフレームに1回の描画時間を確保します.
+//-----------------------------------------------------------------------------
+R3D_TEST(ReservesSampleTime)
+{
+    r3d::BudgetScheduler scheduler;
+    R3D_REQUIRE(InitScheduler(scheduler, 4, 0.25, 4.0));
+
+    scheduler.SetEstimate(0, 1.0, 1.0);
+    scheduler.SetEstimate(1, 1.0, 1.0);
+    scheduler.SetEstimate(2, 1.0, 1.0);
+    scheduler.SetEstimate(3, 100.0, 1.0);
+
+    // 下限は均等に割り振った時間の 0.25 倍 = 0.75 だが, 1回の描画に 2.5 掛かる.
+    scheduler.SetSampleSec(2.5);
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(3, 12.0, 0.0), 4.5, 1e-4));
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(0, 12.0, 0.0), 2.5, 1e-4));
+
+    // 1回の描画時間は移動平均を取る.
+    scheduler.SetSampleSec(12.5);
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(3, 12.0, 0.0), 3.0, 1e-4));
+
+    // 全てのフレームに確保できなければ均等に割り振る.
+    scheduler.SetSampleSec(100.0);
+    scheduler.SetSampleSec(100.0);
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(3, 12.0, 0.0), 3.0, 1e-4));
+    R3D_CHECK(IsNear(scheduler.GetFrameTime(0, 12.0, 0.0), 3.0, 1e-4));
+}
+
+//-----------------------------------------------------------------------------
+//      描画結果の尺度を事前パスに揃えます.
+//-----------------------------------------------------------------------------
+R3D_TEST(ReportCalibratesScale)
+{
+    r3d::BudgetScheduler scheduler;
+    R3D_REQUIRE(InitScheduler(scheduler, 4, 0.0, 0.0));
+
+    scheduler.SetEstimate(0, 0.01, 1.0);
+    scheduler.SetEstimate(3, 0.01, 1.0);
+
+    // 完了していないフレームの報告は無視する.
+    scheduler.Report(0, 0.04);
+    R3D_CHECK(scheduler.GetStats().ReportCount == 0);
+
+    scheduler.SetDone(0, 1.0);
+    scheduler.Report(0, 0.04);
+
+    auto stats = scheduler.GetStats();
+    R3D_CHECK(stats.ReportCount == 1);
+    R3D_CHECK(IsNear(stats.Calibration, 4.0));
+
+    // 補正後は事前パスと同じ難しさになる.
+    R3D_CHECK(IsNear(scheduler.GetDifficulty(0), 0.01));
+}
+
+//-----------------------------------------------------------------------------
+//      既知のノイズの分散を推定します.
+//-----------------------------------------------------------------------------
+R3D_TEST(EstimateNoiseVarianceMatchesSigma)
+{
+    const uint32_t width  = 256;
+    const uint32_t height = 256;
+    const uint32_t pitch  = width * 4;
+
+    std::vector<uint8_t> pixels(size_t(pitch) * height, 128);
+    R3D_CHECK(r3d::EstimateNoiseVariance(pixels.data(), width, height, pitch, 1) == 0.0);
+    R3D_CHECK(r3d::EstimateNoiseVariance(nullptr, width, height, pitch, 1) == 0.0);
+    R3D_CHECK(r3d::EstimateNoiseVariance(pixels.data(), 2, height, pitch, 1) == 0.0);
+
+    // 灰色にガウスノイズを加える.
+    const double sigma = 8.0;
+    std::mt19937 random(1234567);
+    std::normal_distribution<double> normal(128.0, sigma);
+    for(auto i=0u; i<width * height; ++i)
+    {
+        auto value = uint8_t(std::min(std::max(std::lround(normal(random)), 0l), 255l));
+        pixels[size_t(i) * 4 + 0] = value;
+        pixels[size_t(i) * 4 + 1] = value;
+        pixels[size_t(i) * 4 + 2] = value;
+    }
+
+    auto expected = (sigma / 255.0) * (sigma / 255.0);
+    auto variance = r3d::EstimateNoiseVariance(pixels.data(), width, height, pitch, 1);
+    R3D_CHECK(std::abs(variance - expected) < expected * 0.1);
+
+    // 行を間引いても大きくは変わらない.
+    auto sparse = r3d::EstimateNoiseVariance(pixels.data(), width, height, pitch, 4);
+    R3D_CHECK(std::abs(sparse - expected) < expected * 0.15);
+}
+
+//-----------------------------------------------------------------------------
+//      どの描画時間でも全てのフレームを締め切りまでに出力します.
+//-----------------------------------------------------------------------------
+R3D_TEST(SimCapturesAllFrames)
+{
+    // 1サンプルの平均 0.05[sec], 最大 0.055[sec] なので 20[sec] でも1回ずつは描画できる.
+    const double renderTimes[] = { 299.0, 120.0, 60.0, 30.0, 20.0 };
+    for(auto renderTime : renderTimes)
+    {
+        r3d::BudgetSimOption option;
+        option.RenderTimeSec = renderTime;
+        option.RunCount      = 5;
+
+        SimTotal total[r3d::BUDGET_POLICY_COUNT] = {};
+        RunSimulation(option, total);
+
+        R3D_CHECK(total[r3d::BUDGET_POLICY_EVEN    ].MissedRuns == 0);
+        R3D_CHECK(total[r3d::BUDGET_POLICY_ADAPTIVE].MissedRuns == 0);
+    }
+
+    // フレーム数や難しさの偏りを変えても同じ.
+    r3d::BudgetSimOption option;
+    option.FrameCount = 60;
+    option.HardRatio  = 20.0;
+    option.RunCount   = 5;
+
+    SimTotal total[r3d::BUDGET_POLICY_COUNT] = {};
+    RunSimulation(option, total);
+
+    R3D_CHECK(total[r3d::BUDGET_POLICY_EVEN    ].MissedRuns == 0);
+    R3D_CHECK(total[r3d::BUDGET_POLICY_ADAPTIVE].MissedRuns == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      割り振る余地があれば誤差のばらつきを均等割りより小さくします.
+//-----------------------------------------------------------------------------
+R3D_TEST(SimAdaptiveReducesSpread)
+{
+    struct Case
+    {
+        uint32_t    FrameCount;
+        double      HardRatio;
+    };
+    const Case cases[] = {
+        { 240,  6.0 },
+        { 240, 20.0 },
+        {  60,  6.0 },
+    };
+
+    for(auto& item : cases)
+    {
+        r3d::BudgetSimOption option;
+        option.FrameCount = item.FrameCount;
+        option.HardRatio  = item.HardRatio;
+        option.RunCount   = 10;
+
+        SimTotal total[r3d::BUDGET_POLICY_COUNT] = {};
+        RunSimulation(option, total);
+
+        auto& even     = total[r3d::BUDGET_POLICY_EVEN];
+        auto& adaptive = total[r3d::BUDGET_POLICY_ADAPTIVE];
+        R3D_CHECK(adaptive.MissedRuns == 0);
+        R3D_CHECK(adaptive.Spread   < even.Spread   * 0.75);
+        R3D_CHECK(adaptive.P95Error < even.P95Error * 0.95);
+    }
+}
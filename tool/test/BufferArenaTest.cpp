@@ -0,0 +1,273 @@
+﻿//-----------------------------------------------------------------------------
+// File : BufferArenaTest.cpp
+// Desc : BufferArena Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <BufferArena.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint64_t BLOCK_SIZE    = 64 * 1024;
+static const uint64_t ALIGNMENT     = 256;
+
+//-----------------------------------------------------------------------------
+//      割り当て同士が重ならず, ブロックに収まっているか検証します.
+//-----------------------------------------------------------------------------
+bool IsDisjoint(const r3d::BufferArena& arena, std::vector<r3d::ArenaAllocation> allocs)
+{
+    std::sort(allocs.begin(), allocs.end(), [](const r3d::ArenaAllocation& lhs, const r3d::ArenaAllocation& rhs)
+    {
+        if (lhs.Block != rhs.Block)
+        { return lhs.Block < rhs.Block; }
+        return lhs.Offset < rhs.Offset;
+    });
+
+    for(size_t i=0; i<allocs.size(); ++i)
+    {
+        auto& a = allocs[i];
+        if (a.Block >= arena.GetBlockCount() || a.Offset + a.Size > arena.GetBlockSize(a.Block))
+        { return false; }
+
+        if ((a.Offset % ALIGNMENT) != 0 || (a.Size % ALIGNMENT) != 0)
+        { return false; }
+
+        if (i > 0 && allocs[i - 1].Block == a.Block && allocs[i - 1].Offset + allocs[i - 1].Size > a.Offset)
+        { return false; }
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      不正な引数を拒否します.
+//-----------------------------------------------------------------------------
+R3D_TEST(InitRejectsInvalidArgs)
+{
+    r3d::BufferArena arena;
+    R3D_CHECK(!arena.Init(BLOCK_SIZE, 0));
+    R3D_CHECK(!arena.Init(BLOCK_SIZE, 300));
+    R3D_CHECK(!arena.Init(128, ALIGNMENT));
+    R3D_CHECK(arena.Init(BLOCK_SIZE, ALIGNMENT));
+
+    r3d::ArenaAllocation alloc;
+    R3D_CHECK(!arena.Alloc(0, alloc));
+    R3D_CHECK(!alloc.IsValid());
+}
+
+//-----------------------------------------------------------------------------
+//      サイズとオフセットをアライメントに揃えます.
+//-----------------------------------------------------------------------------
+R3D_TEST(AllocRoundsToAlignment)
+{
+    r3d::BufferArena arena;
+    R3D_REQUIRE(arena.Init(BLOCK_SIZE, ALIGNMENT));
+
+    r3d::ArenaAllocation a, b;
+    R3D_REQUIRE(arena.Alloc(1, a));
+    R3D_REQUIRE(arena.Alloc(ALIGNMENT + 1, b));
+
+    R3D_CHECK(a.Block == 0 && a.Offset == 0 && a.Size == ALIGNMENT);
+    R3D_CHECK(b.Block == 0 && b.Offset == ALIGNMENT && b.Size == ALIGNMENT * 2);
+    R3D_CHECK(arena.GetBlockCount() == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      解放した領域を前後の空き領域と結合します.
+//-----------------------------------------------------------------------------
+R3D_TEST(FreeCoalescesNeighbors)
+{
+    r3d::BufferArena arena;
+    R3D_REQUIRE(arena.Init(BLOCK_SIZE, ALIGNMENT));
+
+    // ブロックをちょうど 4 分割して埋める.
+    r3d::ArenaAllocation allocs[4];
+    for(auto& alloc : allocs)
+    { R3D_REQUIRE(arena.Alloc(BLOCK_SIZE / 4, alloc)); }
+
+    auto stats = arena.GetStats();
+    R3D_CHECK(stats.BlockCount == 1);
+    R3D_CHECK(stats.FreeRangeCount == 0);
+    R3D_CHECK(stats.FreeSize == 0);
+
+    // 飛び飛びに解放すると結合されない.
+    arena.Free(allocs[0]);
+    arena.Free(allocs[2]);
+    stats = arena.GetStats();
+    R3D_CHECK(stats.FreeRangeCount == 2);
+    R3D_CHECK(stats.LargestFreeRange == BLOCK_SIZE / 4);
+
+    // 間を解放すると前後と結合される.
+    arena.Free(allocs[1]);
+    stats = arena.GetStats();
+    R3D_CHECK(stats.FreeRangeCount == 1);
+    R3D_CHECK(stats.LargestFreeRange == BLOCK_SIZE * 3 / 4);
+
+    arena.Free(allocs[3]);
+    stats = arena.GetStats();
+    R3D_CHECK(stats.FreeRangeCount == 1);
+    R3D_CHECK(stats.AllocationCount == 0);
+    R3D_CHECK(stats.LargestFreeRange == BLOCK_SIZE);
+
+    // 結合した領域はブロック全体として再利用できる.
+    r3d::ArenaAllocation whole;
+    R3D_CHECK(arena.Alloc(BLOCK_SIZE, whole));
+    R3D_CHECK(whole.Block == 0 && whole.Offset == 0);
+    R3D_CHECK(arena.GetBlockCount() == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      収まらない要求でブロックを追加します.
+//-----------------------------------------------------------------------------
+R3D_TEST(AllocAddsBlock)
+{
+    r3d::BufferArena arena;
+    R3D_REQUIRE(arena.Init(BLOCK_SIZE, ALIGNMENT));
+
+    r3d::ArenaAllocation a, b;
+    R3D_REQUIRE(arena.Alloc(BLOCK_SIZE * 3 / 4, a));
+    R3D_REQUIRE(arena.Alloc(BLOCK_SIZE / 2, b));
+
+    R3D_CHECK(a.Block == 0);
+    R3D_CHECK(b.Block == 1);
+    R3D_CHECK(arena.GetBlockCount() == 2);
+    R3D_CHECK(arena.GetBlockSize(1) == BLOCK_SIZE);
+
+    auto stats = arena.GetStats();
+    R3D_CHECK(stats.DedicatedCount == 0);
+    R3D_CHECK(stats.Capacity == BLOCK_SIZE * 2);
+}
+
+//-----------------------------------------------------------------------------
+//      ブロックより大きい要求は専用ブロックに割り当てます.
+//-----------------------------------------------------------------------------
+R3D_TEST(AllocDedicatedBlock)
+{
+    r3d::BufferArena arena;
+    R3D_REQUIRE(arena.Init(BLOCK_SIZE, ALIGNMENT));
+
+    r3d::ArenaAllocation small, large;
+    R3D_REQUIRE(arena.Alloc(ALIGNMENT, small));
+    R3D_REQUIRE(arena.Alloc(BLOCK_SIZE * 2 + 1, large));
+
+    auto largeSize = BLOCK_SIZE * 2 + ALIGNMENT;
+    R3D_CHECK(large.Block == 1);
+    R3D_CHECK(large.Offset == 0);
+    R3D_CHECK(large.Size == largeSize);
+    R3D_CHECK(arena.GetBlockSize(1) == largeSize);
+
+    auto stats = arena.GetStats();
+    R3D_CHECK(stats.BlockCount == 2);
+    R3D_CHECK(stats.DedicatedCount == 1);
+    R3D_CHECK(stats.Capacity == BLOCK_SIZE + largeSize);
+    R3D_CHECK(stats.UsedSize == ALIGNMENT + largeSize);
+
+    // 専用ブロックは解放後も他の要求に使える.
+    arena.Free(large);
+    r3d::ArenaAllocation reuse;
+    R3D_REQUIRE(arena.Alloc(BLOCK_SIZE * 2, reuse));
+    R3D_CHECK(reuse.Block == 1);
+    R3D_CHECK(arena.GetBlockCount() == 2);
+}
+
+//-----------------------------------------------------------------------------
+//      断片化率を求めます.
+//-----------------------------------------------------------------------------
+R3D_TEST(StatsFragmentation)
+{
+    r3d::BufferArena arena;
+    R3D_REQUIRE(arena.Init(BLOCK_SIZE, ALIGNMENT));
+    R3D_CHECK(arena.GetStats().GetFragmentation() == 0.0f);
+
+    r3d::ArenaAllocation allocs[8];
+    for(auto& alloc : allocs)
+    { R3D_REQUIRE(arena.Alloc(BLOCK_SIZE / 8, alloc)); }
+
+    // 1つおきに解放すると, 空きの半分 (4 区画中 3 区画) が最大の空き領域に入らない.
+    for(auto i=0; i<8; i+=2)
+    { arena.Free(allocs[i]); }
+
+    auto stats = arena.GetStats();
+    R3D_CHECK(stats.FreeSize == BLOCK_SIZE / 2);
+    R3D_CHECK(stats.LargestFreeRange == BLOCK_SIZE / 8);
+    R3D_CHECK(stats.FreeRangeCount == 4);
+    R3D_CHECK(stats.GetFragmentation() == 0.75f);
+
+    for(auto i=1; i<8; i+=2)
+    { arena.Free(allocs[i]); }
+
+    R3D_CHECK(arena.GetStats().GetFragmentation() == 0.0f);
+}
+
+//-----------------------------------------------------------------------------
+//      ランダムな割り当てと解放を総当たりの集計と比較します.
+//-----------------------------------------------------------------------------
+R3D_TEST(RandomMatchesReference)
+{
+    r3d::BufferArena arena;
+    R3D_REQUIRE(arena.Init(BLOCK_SIZE, ALIGNMENT));
+
+    std::mt19937 rng(12345);
+    std::vector<r3d::ArenaAllocation> live;
+
+    for(auto step=0; step<20000; ++step)
+    {
+        if (live.empty() || (rng() % 100) < 55)
+        {
+            // 時々ブロックより大きい要求を混ぜる.
+            auto size = ((rng() % 64) == 0)
+                ? BLOCK_SIZE + (rng() % BLOCK_SIZE)
+                : 1 + (rng() % (BLOCK_SIZE / 4));
+
+            r3d::ArenaAllocation alloc;
+            R3D_REQUIRE(arena.Alloc(size, alloc));
+            R3D_CHECK(alloc.Size >= size);
+            live.push_back(alloc);
+        }
+        else
+        {
+            auto index = rng() % live.size();
+            arena.Free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+
+        if ((step % 500) != 0)
+        { continue; }
+
+        R3D_REQUIRE(IsDisjoint(arena, live));
+
+        uint64_t used = 0;
+        for(auto& alloc : live)
+        { used += alloc.Size; }
+
+        auto stats = arena.GetStats();
+        R3D_CHECK(stats.AllocationCount == live.size());
+        R3D_CHECK(stats.UsedSize == used);
+        R3D_CHECK(stats.UsedSize + stats.FreeSize == stats.Capacity);
+        R3D_CHECK(stats.LargestFreeRange <= stats.FreeSize);
+    }
+
+    for(auto& alloc : live)
+    { arena.Free(alloc); }
+
+    // 全て解放するとブロックごとに 1 つの空き領域に戻る.
+    auto stats = arena.GetStats();
+    R3D_CHECK(stats.AllocationCount == 0);
+    R3D_CHECK(stats.UsedSize == 0);
+    R3D_CHECK(stats.FreeRangeCount == stats.BlockCount);
+}
@@ -0,0 +1,218 @@
+﻿//-----------------------------------------------------------------------------
+// File : CameraTrackTest.cpp
+// Desc : CameraTrack Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <CameraTrack.h>
+#include <cmath>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const float TOLERANCE = 1e-4f;
+
+//-----------------------------------------------------------------------------
+//      キーを作成します.
+//-----------------------------------------------------------------------------
+r3d::CameraKey CreateKey(float time, const r3d::Float3& position, const r3d::Float3& forward, float fov)
+{
+    r3d::CameraKey result = {};
+    result.Time        = time;
+    result.Position    = position;
+    result.Target      = { position.x + forward.x, position.y + forward.y, position.z + forward.z };
+    result.Upward      = { 0.0f, 1.0f, 0.0f };
+    result.FieldOfView = fov;
+    result.NearClip    = fov * 0.1f;
+    result.FarClip     = fov * 100.0f;
+    return result;
+}
+
+// 間隔が不均一な3キー. +Z を向いて右に進み, +X を向いてから再び +Z を向く.
+const r3d::CameraKey KEYS[] = {
+    CreateKey(10.0f, {  0.0f, 0.0f,  0.0f }, { 0.0f, 0.0f, 1.0f }, 0.5f),
+    CreateKey(20.0f, { 10.0f, 0.0f,  0.0f }, { 1.0f, 0.0f, 0.0f }, 1.0f),
+    CreateKey(40.0f, { 10.0f, 0.0f, 20.0f }, { 0.0f, 0.0f, 1.0f }, 1.5f),
+};
+
+//-----------------------------------------------------------------------------
+//      誤差を許して比較します.
+//-----------------------------------------------------------------------------
+bool IsNear(float a, float b)
+{ return std::abs(a - b) <= TOLERANCE; }
+
+bool IsNear(const r3d::Float3& a, const r3d::Float3& b)
+{ return IsNear(a.x, b.x) && IsNear(a.y, b.y) && IsNear(a.z, b.z); }
+
+//-----------------------------------------------------------------------------
+//      キーと同じ姿勢かどうか検証します.
+//-----------------------------------------------------------------------------
+void CheckKeyPose(const r3d::CameraPose& pose, const r3d::CameraKey& key)
+{
+    r3d::Float3 forward = {
+        key.Target.x - key.Position.x,
+        key.Target.y - key.Position.y,
+        key.Target.z - key.Position.z };
+
+    R3D_CHECK(IsNear(pose.Position, key.Position));
+    R3D_CHECK(IsNear(pose.Forward,  forward));
+    R3D_CHECK(IsNear(pose.Upward,   key.Upward));
+    R3D_CHECK(IsNear(pose.FieldOfView, key.FieldOfView));
+    R3D_CHECK(IsNear(pose.NearClip,    key.NearClip));
+    R3D_CHECK(IsNear(pose.FarClip,     key.FarClip));
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      不正なキーは受け付けません.
+//-----------------------------------------------------------------------------
+R3D_TEST(InitRejectsInvalidKeys)
+{
+    r3d::CameraTrack track;
+    R3D_CHECK(!track.Init(nullptr, 1));
+    R3D_CHECK(!track.Init(KEYS, 0));
+
+    const r3d::CameraKey descending[] = { KEYS[1], KEYS[0] };
+    R3D_CHECK(!track.Init(descending, 2));
+
+    const r3d::CameraKey duplicated[] = { KEYS[0], KEYS[0] };
+    R3D_CHECK(!track.Init(duplicated, 2));
+    R3D_CHECK(track.GetKeyCount() == 0);
+
+    // 空のトラックは既定値を返す.
+    auto pose = track.Evaluate(0.0);
+    R3D_CHECK(pose.FieldOfView == 0.0f);
+}
+
+//-----------------------------------------------------------------------------
+//      先頭キーより前は先頭キーに固定します.
+//-----------------------------------------------------------------------------
+R3D_TEST(BeforeFirstKey)
+{
+    r3d::CameraTrack track;
+    R3D_REQUIRE(track.Init(KEYS, 3));
+    R3D_CHECK(track.GetBeginTime() == 10.0);
+    R3D_CHECK(track.GetEndTime()   == 40.0);
+
+    const double times[] = { -100.0, 0.0, 9.5 };
+    for(auto time : times)
+    {
+        R3D_CHECK(track.FindSegment(time) == 0);
+        CheckKeyPose(track.Evaluate(time), KEYS[0]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      キーの時刻ちょうどではキーの姿勢になります.
+//-----------------------------------------------------------------------------
+R3D_TEST(ExactlyOnKey)
+{
+    r3d::CameraTrack track;
+    R3D_REQUIRE(track.Init(KEYS, 3));
+
+    R3D_CHECK(track.FindSegment(10.0) == 0);
+    R3D_CHECK(track.FindSegment(20.0) == 1);
+    R3D_CHECK(track.FindSegment(40.0) == 1);
+
+    for(auto& key : KEYS)
+    { CheckKeyPose(track.Evaluate(key.Time), key); }
+}
+
+//-----------------------------------------------------------------------------
+//      キーの間は位置をエルミート補間, 向きを球面線形補間します.
+//-----------------------------------------------------------------------------
+R3D_TEST(BetweenKeys)
+{
+    r3d::CameraTrack track;
+    R3D_REQUIRE(track.Init(KEYS, 3));
+
+    R3D_CHECK(track.FindSegment(15.0) == 0);
+    R3D_CHECK(track.FindSegment(30.0) == 1);
+
+    // 区間 [10, 20] の中央. 接線は (p1 - p0) / 10 と (p2 - p0) / 30.
+    auto pose = track.Evaluate(15.0);
+    R3D_CHECK(IsNear(pose.Position, r3d::Float3{ 6.25f - 1.25f / 3.0f, 0.0f, -2.5f / 3.0f }));
+
+    // +Z と +X の中間を向き, 上向きは変わらない.
+    auto s = std::sqrt(0.5f);
+    R3D_CHECK(IsNear(pose.Forward, r3d::Float3{ s, 0.0f, s }));
+    R3D_CHECK(IsNear(pose.Upward,  r3d::Float3{ 0.0f, 1.0f, 0.0f }));
+
+    // 画角とクリップ平面は線形補間.
+    R3D_CHECK(IsNear(pose.FieldOfView, 0.75f));
+    R3D_CHECK(IsNear(pose.NearClip,    0.075f));
+    R3D_CHECK(IsNear(pose.FarClip,     75.0f));
+
+    // 区間の途中は常に正規直交で, 小数フレームも評価できる.
+    for(auto time=10.0; time<=40.0; time+=0.25)
+    {
+        auto p = track.Evaluate(time);
+        auto f = p.Forward;
+        auto u = p.Upward;
+        R3D_CHECK(IsNear(f.x * f.x + f.y * f.y + f.z * f.z, 1.0f));
+        R3D_CHECK(IsNear(u.x * u.x + u.y * u.y + u.z * u.z, 1.0f));
+        R3D_CHECK(IsNear(f.x * u.x + f.y * u.y + f.z * u.z, 0.0f));
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      末尾キーより後は末尾キーに固定します.
+//-----------------------------------------------------------------------------
+R3D_TEST(AfterLastKey)
+{
+    r3d::CameraTrack track;
+    R3D_REQUIRE(track.Init(KEYS, 3));
+
+    const double times[] = { 40.5, 100.0, 1e9 };
+    for(auto time : times)
+    {
+        R3D_CHECK(track.FindSegment(time) == 1);
+        CheckKeyPose(track.Evaluate(time), KEYS[2]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      キーが1つの場合は常にそのキーの姿勢です.
+//-----------------------------------------------------------------------------
+R3D_TEST(SingleKey)
+{
+    r3d::CameraTrack track;
+    R3D_REQUIRE(track.Init(&KEYS[1], 1));
+    R3D_CHECK(track.GetKeyCount()  == 1);
+    R3D_CHECK(track.GetBeginTime() == 20.0);
+    R3D_CHECK(track.GetEndTime()   == 20.0);
+
+    const double times[] = { 0.0, 20.0, 25.0 };
+    for(auto time : times)
+    {
+        R3D_CHECK(track.FindSegment(time) == 0);
+        CheckKeyPose(track.Evaluate(time), KEYS[1]);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      視線と上向きが平行でも正規直交な姿勢を作ります.
+//-----------------------------------------------------------------------------
+R3D_TEST(ParallelUpward)
+{
+    auto key = CreateKey(0.0f, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, 1.0f);
+
+    r3d::CameraTrack track;
+    R3D_REQUIRE(track.Init(&key, 1));
+
+    auto pose = track.Evaluate(0.0);
+    R3D_CHECK(IsNear(pose.Forward, r3d::Float3{ 0.0f, 1.0f, 0.0f }));
+
+    auto& u = pose.Upward;
+    R3D_CHECK(IsNear(u.x * u.x + u.y * u.y + u.z * u.z, 1.0f));
+    R3D_CHECK(IsNear(u.y, 0.0f));
+}
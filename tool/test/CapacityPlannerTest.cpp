@@ -0,0 +1,117 @@
+﻿//-----------------------------------------------------------------------------
+// File : CapacityPlannerTest.cpp
+// Desc : CapacityPlanner Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <CapacityPlanner.h>
+
+
+//-----------------------------------------------------------------------------
+//      不正な引数を拒否します.
+//-----------------------------------------------------------------------------
+R3D_TEST(InitRejectsInvalidArgs)
+{
+    r3d::CapacityPlanner planner;
+    R3D_CHECK(!planner.Init(0, 1024));
+    R3D_CHECK(!planner.Init(1024, 256));
+    R3D_CHECK(planner.Init(256, 1024));
+    R3D_CHECK(planner.GetChunkCount() == 256);
+    R3D_CHECK(planner.GetMaxCount() == 1024);
+
+    // 初期化前は容量を求められない.
+    r3d::CapacityPlanner empty;
+    uint32_t result = 0;
+    R3D_CHECK(!empty.Plan(0, 1, result));
+}
+
+//-----------------------------------------------------------------------------
+//      必要数をチャンク単位に切り上げます.
+//-----------------------------------------------------------------------------
+R3D_TEST(PlanRoundsToChunk)
+{
+    r3d::CapacityPlanner planner;
+    R3D_REQUIRE(planner.Init(1024, 65535));
+
+    uint32_t result = 0;
+    R3D_CHECK(planner.Plan(0, 1, result) && result == 1024);
+    R3D_CHECK(planner.Plan(0, 1024, result) && result == 1024);
+    R3D_CHECK(planner.Plan(0, 1025, result) && result == 2048);
+
+    // 空のシーンでも容量は 0 のまま.
+    R3D_CHECK(planner.Plan(0, 0, result) && result == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      収まる場合は容量を変えません.
+//-----------------------------------------------------------------------------
+R3D_TEST(PlanKeepsCapacityWhenFits)
+{
+    r3d::CapacityPlanner planner;
+    R3D_REQUIRE(planner.Init(256, 4096));
+
+    uint32_t result = 0;
+    R3D_CHECK(planner.Plan(1024, 1024, result) && result == 1024);
+    R3D_CHECK(planner.Plan(1024, 10, result) && result == 1024);
+}
+
+//-----------------------------------------------------------------------------
+//      少しずつ増える場合は 1.5 倍ずつ伸ばします.
+//-----------------------------------------------------------------------------
+R3D_TEST(PlanGrowsGeometrically)
+{
+    r3d::CapacityPlanner planner;
+    R3D_REQUIRE(planner.Init(1024, 1u << 24));
+
+    uint32_t result = 0;
+    R3D_CHECK(planner.Plan(4096, 4097, result) && result == 6144);
+
+    // 1.5 倍がチャンクに揃わない場合は切り上げる.
+    R3D_CHECK(planner.Plan(3072, 3073, result) && result == 5120);
+
+    // 1.5 倍より多く必要ならそちらを使う.
+    R3D_CHECK(planner.Plan(4096, 10000, result) && result == 10240);
+
+    // 1つずつ追加してもコピーの総量は要素数に比例する.
+    uint32_t capacity   = 0;
+    uint64_t copied     = 0;
+    uint32_t growCount  = 0;
+    for(uint32_t count=1; count<=1000000; ++count)
+    {
+        uint32_t next = 0;
+        R3D_REQUIRE(planner.Plan(capacity, count, next));
+        if (next != capacity)
+        {
+            R3D_CHECK(next > capacity);
+            R3D_CHECK((next % 1024) == 0);
+            copied += capacity;
+            capacity = next;
+            growCount++;
+        }
+    }
+
+    R3D_CHECK(capacity >= 1000000);
+    R3D_CHECK(copied <= 3u * 1000000);
+    R3D_CHECK(growCount < 32);
+}
+
+//-----------------------------------------------------------------------------
+//      最大要素数で打ち切り, 超える要求は失敗します.
+//-----------------------------------------------------------------------------
+R3D_TEST(PlanClampsToLimit)
+{
+    r3d::CapacityPlanner planner;
+    R3D_REQUIRE(planner.Init(1024, 65535));
+
+    uint32_t result = 0;
+    R3D_CHECK(planner.Plan(49152, 49153, result) && result == 65535);
+    R3D_CHECK(planner.Plan(0, 65535, result) && result == 65535);
+
+    result = 123;
+    R3D_CHECK(!planner.Plan(65535, 65536, result));
+    R3D_CHECK(result == 123);
+}
@@ -0,0 +1,335 @@
+﻿//-----------------------------------------------------------------------------
+// File : CaptureJournalTest.cpp
+// Desc : CaptureJournal Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <CaptureJournal.h>
+#include <xxhash.h>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint64_t SEQUENCE_HASH = 0x0123456789abcdefull;
+static const uint32_t FRAME_COUNT   = 4;
+static const uint32_t OUTPUT_COUNT  = 2;
+
+//-----------------------------------------------------------------------------
+//      構成設定を作成します.
+//-----------------------------------------------------------------------------
+r3d::CaptureJournalDesc MakeDesc(const std::string& path, uint64_t sequenceHash = SEQUENCE_HASH)
+{
+    r3d::CaptureJournalDesc desc = {};
+    desc.Path         = path.c_str();
+    desc.SequenceHash = sequenceHash;
+    desc.FrameCount   = FRAME_COUNT;
+    desc.OutputCount  = OUTPUT_COUNT;
+    return desc;
+}
+
+//-----------------------------------------------------------------------------
+//      出力ファイルを書き込んでジャーナルに記録します.
+//-----------------------------------------------------------------------------
+bool WriteOutput(r3d::CaptureJournal& journal, uint32_t frameIndex, uint32_t slot)
+{
+    auto name    = "frame_" + std::to_string(frameIndex) + "_" + std::to_string(slot) + ".bin";
+    auto path    = r3d::test::GetTempPath(name.c_str());
+    auto content = "output " + name;
+
+    auto pFile = fopen(path.c_str(), "wb");
+    if (pFile == nullptr)
+    { return false; }
+    fwrite(content.data(), 1, content.size(), pFile);
+    fclose(pFile);
+
+    auto hash = XXH3_64bits(content.data(), content.size());
+    return journal.AddOutput(frameIndex, slot, path.c_str(), content.size(), hash);
+}
+
+//-----------------------------------------------------------------------------
+//      フレームの全ての出力を記録します.
+//-----------------------------------------------------------------------------
+bool CompleteFrame(r3d::CaptureJournal& journal, uint32_t frameIndex)
+{
+    for(auto slot=0u; slot<OUTPUT_COUNT; ++slot)
+    {
+        if (!WriteOutput(journal, frameIndex, slot))
+        { return false; }
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      描画の状態を作成します.
+//-----------------------------------------------------------------------------
+r3d::CaptureState MakeState(uint32_t captureIndex)
+{
+    r3d::CaptureState state = {};
+    state.ElapsedSec       = 12.5;
+    state.FrameTimeSec     = 3.25;
+    state.CaptureIndex     = captureIndex;
+    state.RenderFrameCount = 321;
+    state.JitterIndex      = 5;
+    return state;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      パスを指定しない場合はメモリ上だけで記録します.
+//-----------------------------------------------------------------------------
+R3D_TEST(MemoryOnly)
+{
+    r3d::CaptureJournalDesc desc = {};
+    desc.FrameCount  = FRAME_COUNT;
+    desc.OutputCount = 1;
+
+    r3d::CaptureJournal journal;
+    R3D_REQUIRE(journal.Init(desc));
+    R3D_CHECK(!journal.IsResumed());
+    R3D_CHECK(journal.CountPending(0) == FRAME_COUNT);
+
+    R3D_CHECK(journal.AddOutput(1, 0, "a.png", 1, 2));
+    R3D_CHECK(journal.IsCompleted(1));
+    R3D_CHECK(journal.FindPending(1) == 2);
+    R3D_CHECK(journal.CountPending(0) == FRAME_COUNT - 1);
+    R3D_CHECK(journal.SaveState(MakeState(2)));
+
+    // 範囲外の出力は拒否する.
+    R3D_CHECK(!journal.AddOutput(FRAME_COUNT, 0, "b.png", 1, 2));
+    R3D_CHECK(!journal.AddOutput(0, 1, "b.png", 1, 2));
+
+    desc.OutputCount = 9;
+    R3D_CHECK(!journal.Init(desc));
+}
+
+//-----------------------------------------------------------------------------
+//      全ての出力が揃ったフレームだけを完了済みとして再開します.
+//-----------------------------------------------------------------------------
+R3D_TEST(ResumeCompletedFrames)
+{
+    auto path = r3d::test::GetTempPath("resume.journal");
+    {
+        r3d::CaptureJournal journal;
+        R3D_REQUIRE(journal.Init(MakeDesc(path)));
+        R3D_CHECK(!journal.IsResumed());
+
+        R3D_REQUIRE(CompleteFrame(journal, 0));
+        R3D_REQUIRE(WriteOutput(journal, 1, 0));
+        R3D_REQUIRE(CompleteFrame(journal, 2));
+        R3D_REQUIRE(journal.SaveState(MakeState(3)));
+        R3D_CHECK(journal.GetStats().CompletedCount == 2);
+    }
+
+    r3d::CaptureJournal journal;
+    R3D_REQUIRE(journal.Init(MakeDesc(path)));
+    R3D_CHECK(journal.IsResumed());
+    R3D_CHECK(journal.IsCompleted(0));
+    R3D_CHECK(!journal.IsCompleted(1));
+    R3D_CHECK(journal.IsCompleted(2));
+    R3D_CHECK(journal.FindPending(0) == 1);
+    R3D_CHECK(journal.FindPending(2) == 3);
+    R3D_CHECK(journal.CountPending(0) == 2);
+
+    auto& state = journal.GetResumeState();
+    R3D_CHECK(state.ElapsedSec == 12.5);
+    R3D_CHECK(state.FrameTimeSec == 3.25);
+    R3D_CHECK(state.CaptureIndex == 3);
+    R3D_CHECK(state.RenderFrameCount == 321);
+    R3D_CHECK(state.JitterIndex == 5);
+
+    auto stats = journal.GetStats();
+    R3D_CHECK(stats.ResumedCount == 2);
+    R3D_CHECK(stats.RejectedCount == 0);
+    R3D_CHECK(stats.CompletedCount == 2);
+
+    // 残りの出力は 1 つ足りないスロットだけを追記すれば完了する.
+    R3D_REQUIRE(WriteOutput(journal, 1, 1));
+    R3D_CHECK(journal.IsCompleted(1));
+}
+
+//-----------------------------------------------------------------------------
+//      書きかけの末尾のレコードを捨てます.
+//-----------------------------------------------------------------------------
+R3D_TEST(TornTailIsDiscarded)
+{
+    auto path = r3d::test::GetTempPath("torn.journal");
+    uintmax_t intactSize = 0;
+    {
+        r3d::CaptureJournal journal;
+        R3D_REQUIRE(journal.Init(MakeDesc(path)));
+        R3D_REQUIRE(CompleteFrame(journal, 0));
+        intactSize = std::filesystem::file_size(path);
+        R3D_REQUIRE(CompleteFrame(journal, 1));
+    }
+
+    // フレーム 1 の最後のレコードの途中で中断されたことにする.
+    auto fullSize = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, fullSize - 5);
+    R3D_REQUIRE(std::filesystem::file_size(path) > intactSize);
+
+    {
+        r3d::CaptureJournal journal;
+        R3D_REQUIRE(journal.Init(MakeDesc(path)));
+        R3D_CHECK(journal.IsCompleted(0));
+        R3D_CHECK(!journal.IsCompleted(1));
+        R3D_CHECK(journal.GetStats().ResumedCount == 1);
+
+        // 捨てた後に追記した記録は次の再開で読める.
+        R3D_REQUIRE(CompleteFrame(journal, 3));
+    }
+
+    // 末尾にゴミが付いていても手前までは読める.
+    {
+        auto pFile = fopen(path.c_str(), "ab");
+        R3D_REQUIRE(pFile != nullptr);
+        const char garbage[] = "\x01\x00\x00\x00\xff\xff";
+        fwrite(garbage, 1, sizeof(garbage), pFile);
+        fclose(pFile);
+    }
+
+    r3d::CaptureJournal journal;
+    R3D_REQUIRE(journal.Init(MakeDesc(path)));
+    R3D_CHECK(journal.IsCompleted(0));
+    R3D_CHECK(!journal.IsCompleted(1));
+    R3D_CHECK(journal.IsCompleted(3));
+    R3D_CHECK(journal.GetStats().ResumedCount == 2);
+}
+
+//-----------------------------------------------------------------------------
+//      内容が変わった出力ファイルのフレームは描き直します.
+//-----------------------------------------------------------------------------
+R3D_TEST(CorruptOutputIsRejected)
+{
+    auto path = r3d::test::GetTempPath("corrupt.journal");
+    {
+        r3d::CaptureJournal journal;
+        R3D_REQUIRE(journal.Init(MakeDesc(path)));
+        for(auto i=0u; i<3; ++i)
+        { R3D_REQUIRE(CompleteFrame(journal, i)); }
+    }
+
+    // フレーム 0 は同じサイズで内容を壊し, フレーム 2 は消す.
+    {
+        auto output = r3d::test::GetTempPath("frame_0_1.bin");
+        auto pFile  = fopen(output.c_str(), "r+b");
+        R3D_REQUIRE(pFile != nullptr);
+        fputc('X', pFile);
+        fclose(pFile);
+
+        remove(r3d::test::GetTempPath("frame_2_0.bin").c_str());
+    }
+
+    r3d::CaptureJournal journal;
+    R3D_REQUIRE(journal.Init(MakeDesc(path)));
+    R3D_CHECK(!journal.IsCompleted(0));
+    R3D_CHECK(journal.IsCompleted(1));
+    R3D_CHECK(!journal.IsCompleted(2));
+
+    auto stats = journal.GetStats();
+    R3D_CHECK(stats.ResumedCount == 1);
+    R3D_CHECK(stats.RejectedCount == 2);
+    R3D_CHECK(journal.FindPending(0) == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      設定が変わった場合は最初から描画します.
+//-----------------------------------------------------------------------------
+R3D_TEST(SettingsChangeRestarts)
+{
+    auto path = r3d::test::GetTempPath("settings.journal");
+    {
+        r3d::CaptureJournal journal;
+        R3D_REQUIRE(journal.Init(MakeDesc(path)));
+        R3D_REQUIRE(CompleteFrame(journal, 0));
+        R3D_REQUIRE(journal.SaveState(MakeState(1)));
+    }
+
+    // シーケンスのハッシュが違う.
+    {
+        r3d::CaptureJournal journal;
+        R3D_REQUIRE(journal.Init(MakeDesc(path, SEQUENCE_HASH + 1)));
+        R3D_CHECK(!journal.IsResumed());
+        R3D_CHECK(!journal.IsCompleted(0));
+        R3D_CHECK(journal.CountPending(0) == FRAME_COUNT);
+        R3D_CHECK(journal.GetResumeState().CaptureIndex == 0);
+    }
+
+    // 書き直されたので元の設定でも再開しない.
+    {
+        r3d::CaptureJournal journal;
+        R3D_REQUIRE(journal.Init(MakeDesc(path)));
+        R3D_CHECK(!journal.IsResumed());
+        R3D_REQUIRE(CompleteFrame(journal, 0));
+    }
+
+    // フレーム数が違う.
+    auto desc = MakeDesc(path);
+    desc.FrameCount = FRAME_COUNT + 1;
+
+    r3d::CaptureJournal journal;
+    R3D_REQUIRE(journal.Init(desc));
+    R3D_CHECK(!journal.IsCompleted(0));
+    R3D_CHECK(journal.GetStats().ResumedCount == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      全てのフレームが完了したらジャーナルを削除します.
+//-----------------------------------------------------------------------------
+R3D_TEST(CompletedJournalIsRemoved)
+{
+    auto path = r3d::test::GetTempPath("complete.journal");
+
+    r3d::CaptureJournal journal;
+    R3D_REQUIRE(journal.Init(MakeDesc(path)));
+    for(auto i=0u; i<FRAME_COUNT - 1; ++i)
+    { R3D_REQUIRE(CompleteFrame(journal, i)); }
+
+    // 未完了のフレームが残っていれば残す.
+    journal.Term();
+    R3D_CHECK(std::filesystem::exists(path));
+
+    R3D_REQUIRE(journal.Init(MakeDesc(path)));
+    R3D_CHECK(journal.CountPending(0) == 1);
+    R3D_REQUIRE(CompleteFrame(journal, FRAME_COUNT - 1));
+    journal.Term();
+    R3D_CHECK(!std::filesystem::exists(path));
+
+    // 次の実行は最初から描画する.
+    R3D_REQUIRE(journal.Init(MakeDesc(path)));
+    R3D_CHECK(!journal.IsResumed());
+    R3D_CHECK(journal.CountPending(0) == FRAME_COUNT);
+}
+
+//-----------------------------------------------------------------------------
+//      締め切りと1フレームあたりの描画時間を計算します.
+//-----------------------------------------------------------------------------
+R3D_TEST(RenderDeadline)
+{
+    // 残り時間が足りていれば全体の描画時間のまま.
+    R3D_CHECK(r3d::CalcRenderDeadline(300.0, 100.0, 10, 0.5) == 300.0);
+
+    // 再開時に足りなければ未完了のフレームごとに最低限の時間を確保する.
+    R3D_CHECK(r3d::CalcRenderDeadline(300.0, 295.0, 20, 0.5) == 305.0);
+    R3D_CHECK(r3d::CalcRenderDeadline(300.0, 320.0, 0, 0.5) == 320.0);
+    R3D_CHECK(r3d::CalcRenderDeadline(300.0, 295.0, 20, -1.0) == 300.0);
+
+    R3D_CHECK(r3d::CalcFrameTimeBudget(300.0, 100.0, 4) == 50.0);
+    R3D_CHECK(r3d::CalcFrameTimeBudget(300.0, 100.0, 0) == 200.0);
+    R3D_CHECK(r3d::CalcFrameTimeBudget(300.0, 310.0, 4) == 0.0);
+
+    // 再開後の締め切りに対して割り振ると, 全てのフレームが最低限の時間を得る.
+    auto deadline = r3d::CalcRenderDeadline(300.0, 295.0, 20, 0.5);
+    R3D_CHECK(r3d::CalcFrameTimeBudget(deadline, 295.0, 20) == 0.5);
+}
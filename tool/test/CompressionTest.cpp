@@ -0,0 +1,240 @@
+﻿//-----------------------------------------------------------------------------
+// File : CompressionTest.cpp
+// Desc : Compression Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <Compression.h>
+#include <algorithm>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint8_t GUARD_VALUE = 0xCD;
+static const size_t  GUARD_SIZE  = 64;
+
+//-----------------------------------------------------------------------------
+//      乱数列を生成します (xorshift32).
+//-----------------------------------------------------------------------------
+std::vector<uint8_t> CreateRandom(size_t size, uint32_t seed)
+{
+    std::vector<uint8_t> result(size);
+    for(auto& value : result)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        value = uint8_t(seed >> 24);
+    }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      展開します. 展開先の後ろにはみ出して書き込んでいないかも検証します.
+//-----------------------------------------------------------------------------
+bool Decompress(const std::vector<uint8_t>& src, size_t dstSize, std::vector<uint8_t>& result)
+{
+    std::vector<uint8_t> buffer(dstSize + GUARD_SIZE, GUARD_VALUE);
+    auto ret = r3d::DecompressLZ4(src.data(), src.size(), buffer.data(), dstSize);
+
+    auto guard = std::all_of(buffer.begin() + dstSize, buffer.end(), [](uint8_t value) { return value == GUARD_VALUE; });
+    R3D_CHECK(guard);
+
+    result.assign(buffer.begin(), buffer.begin() + dstSize);
+    return ret;
+}
+
+//-----------------------------------------------------------------------------
+//      圧縮して展開した結果が元のデータと一致するか検証します.
+//-----------------------------------------------------------------------------
+bool RoundTrip(const std::vector<uint8_t>& src, std::vector<uint8_t>& compressed)
+{
+    r3d::CompressLZ4(src.data(), src.size(), compressed);
+
+    // 最悪でもリテラルの長さの分しか膨らまない.
+    if (compressed.empty() || compressed.size() > src.size() + src.size() / 255 + 16)
+    { return false; }
+
+    std::vector<uint8_t> decompressed;
+    if (!Decompress(compressed, src.size(), decompressed))
+    { return false; }
+
+    return decompressed == src;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      空のデータは最終シーケンスだけになります.
+//-----------------------------------------------------------------------------
+R3D_TEST(EmptyInput)
+{
+    std::vector<uint8_t> src;
+    std::vector<uint8_t> compressed;
+    R3D_REQUIRE(RoundTrip(src, compressed));
+    R3D_CHECK(compressed.size() == 1);
+
+    std::vector<uint8_t> decompressed;
+    R3D_CHECK(!Decompress(compressed, 1, decompressed));
+    R3D_CHECK(!Decompress(std::vector<uint8_t>(), 0, decompressed));
+}
+
+//-----------------------------------------------------------------------------
+//      マッチを探さない短いデータを往復します.
+//-----------------------------------------------------------------------------
+R3D_TEST(ShortInput)
+{
+    for(auto size=1u; size<=32; ++size)
+    {
+        std::vector<uint8_t> src(size, 'a');
+        std::vector<uint8_t> compressed;
+        R3D_CHECK(RoundTrip(src, compressed));
+        R3D_CHECK(RoundTrip(CreateRandom(size, size), compressed));
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      圧縮できないデータはほぼ同じ大きさのリテラルになります.
+//-----------------------------------------------------------------------------
+R3D_TEST(IncompressibleInput)
+{
+    const size_t sizes[] = { 15, 16, 270, 271, 4096, 256 * 1024 };
+    for(auto size : sizes)
+    {
+        auto src = CreateRandom(size, uint32_t(size) * 7 + 1);
+
+        std::vector<uint8_t> compressed;
+        R3D_CHECK(RoundTrip(src, compressed));
+        R3D_CHECK(compressed.size() >= src.size());
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      長い連続は可変長のマッチ長で表します.
+//-----------------------------------------------------------------------------
+R3D_TEST(LongRuns)
+{
+    const size_t sizes[] = { 19, 20, 274, 275, 1024 * 1024 };
+    for(auto size : sizes)
+    {
+        std::vector<uint8_t> src(size, 0);
+
+        std::vector<uint8_t> compressed;
+        R3D_CHECK(RoundTrip(src, compressed));
+        R3D_CHECK(compressed.size() <= 16 + size / 255);
+    }
+
+    // 連続とランダムが交互に並ぶ場合.
+    std::vector<uint8_t> src;
+    for(auto i=0u; i<64; ++i)
+    {
+        auto noise = CreateRandom(i * 13 + 1, i + 1);
+        src.insert(src.end(), noise.begin(), noise.end());
+        src.insert(src.end(), size_t(i) * 97 + 4, uint8_t(i));
+    }
+
+    std::vector<uint8_t> compressed;
+    R3D_CHECK(RoundTrip(src, compressed));
+    R3D_CHECK(compressed.size() < src.size() / 2);
+}
+
+//-----------------------------------------------------------------------------
+//      コピー元とコピー先が重なるマッチ (オフセット < 16) を往復します.
+//-----------------------------------------------------------------------------
+R3D_TEST(OverlappingMatches)
+{
+    for(auto period=1u; period<16; ++period)
+    {
+        auto pattern = CreateRandom(period, period);
+
+        std::vector<uint8_t> src(4096 + period);
+        for(size_t i=0; i<src.size(); ++i)
+        { src[i] = pattern[i % period]; }
+
+        std::vector<uint8_t> compressed;
+        R3D_CHECK(RoundTrip(src, compressed));
+        R3D_CHECK(compressed.size() < src.size() / 16);
+    }
+
+    // 手で組み立てたブロック. "abc" + オフセット3で9バイトのマッチ.
+    const std::vector<uint8_t> block = { 0x35, 'a', 'b', 'c', 0x03, 0x00, 0x00 };
+    const std::vector<uint8_t> expected = { 'a', 'b', 'c', 'a', 'b', 'c', 'a', 'b', 'c', 'a', 'b', 'c' };
+
+    std::vector<uint8_t> decompressed;
+    R3D_CHECK(Decompress(block, expected.size(), decompressed));
+    R3D_CHECK(decompressed == expected);
+}
+
+//-----------------------------------------------------------------------------
+//      途中で切れたデータは展開できません.
+//-----------------------------------------------------------------------------
+R3D_TEST(TruncatedInputFails)
+{
+    auto src = CreateRandom(2048, 3);
+    src.insert(src.end(), 600, 'x');
+    src.insert(src.end(), src.begin(), src.begin() + 1024);
+
+    std::vector<uint8_t> compressed;
+    R3D_REQUIRE(RoundTrip(src, compressed));
+
+    std::vector<uint8_t> decompressed;
+    for(size_t size=0; size<compressed.size(); ++size)
+    {
+        std::vector<uint8_t> truncated(compressed.begin(), compressed.begin() + size);
+        R3D_CHECK(!Decompress(truncated, src.size(), decompressed));
+    }
+
+    // 展開後のサイズが合わない場合も失敗する.
+    R3D_CHECK(!Decompress(compressed, src.size() - 1, decompressed));
+    R3D_CHECK(!Decompress(compressed, src.size() + 1, decompressed));
+}
+
+//-----------------------------------------------------------------------------
+//      壊れたデータは範囲外を読み書きせずに失敗します.
+//-----------------------------------------------------------------------------
+R3D_TEST(CorruptInputFails)
+{
+    std::vector<uint8_t> decompressed;
+
+    // オフセット0.
+    R3D_CHECK(!Decompress({ 0x10, 'a', 0x00, 0x00, 0x00 }, 6, decompressed));
+
+    // 出力済みの範囲より前を指すオフセット.
+    R3D_CHECK(!Decompress({ 0x10, 'a', 0x02, 0x00, 0x00 }, 6, decompressed));
+
+    // 出力サイズを超えるリテラルとマッチ.
+    R3D_CHECK(!Decompress({ 0x30, 'a', 'b', 'c' }, 2, decompressed));
+    R3D_CHECK(!Decompress({ 0x1f, 'a', 0x01, 0x00, 0xff, 0x10, 0x00 }, 64, decompressed));
+
+    // 入力を超えるリテラル長.
+    R3D_CHECK(!Decompress({ 0xf0, 0xff }, 512, decompressed));
+    R3D_CHECK(!Decompress({ 0x50, 'a', 'b' }, 5, decompressed));
+
+    // オフセットの途中で切れている.
+    R3D_CHECK(!Decompress({ 0x10, 'a', 0x01 }, 6, decompressed));
+
+    // ビットを反転しても展開先の外に書き込まない.
+    std::vector<uint8_t> src(8192);
+    for(size_t i=0; i<src.size(); ++i)
+    { src[i] = uint8_t((i / 7) ^ (i % 5)); }
+
+    std::vector<uint8_t> compressed;
+    R3D_REQUIRE(RoundTrip(src, compressed));
+
+    auto noise = CreateRandom(compressed.size() * 2, 99);
+    for(size_t i=0; i<compressed.size(); ++i)
+    {
+        auto corrupt = compressed;
+        corrupt[i] ^= uint8_t(1u << (noise[i] & 7));
+        Decompress(corrupt, src.size(), decompressed);
+    }
+}
@@ -0,0 +1,208 @@
+﻿//-----------------------------------------------------------------------------
+// File : DirtyRangeTest.cpp
+// Desc : DirtyRangeTracker Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <DirtyRange.h>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// Reference class
+///////////////////////////////////////////////////////////////////////////////
+class Reference
+{
+public:
+    Reference(uint32_t slotCount, uint32_t mergeGap)
+    : m_Slots(slotCount)
+    , m_MergeGap(mergeGap)
+    { /* DO_NOTHING */ }
+
+    void Mark(uint32_t offset, uint32_t count)
+    {
+        for(auto& slot : m_Slots)
+        {
+            if (slot.size() < size_t(offset) + count)
+            { slot.resize(size_t(offset) + count, false); }
+
+            for(auto i=0u; i<count; ++i)
+            { slot[offset + i] = true; }
+        }
+    }
+
+    // 1要素ずつ走査して範囲を作る.
+    std::vector<r3d::DirtyRange> Flush(uint32_t slot)
+    {
+        std::vector<r3d::DirtyRange> result;
+        auto& bits = m_Slots[slot];
+        for(uint32_t i=0; i<bits.size(); ++i)
+        {
+            if (!bits[i])
+            { continue; }
+
+            bits[i] = false;
+            if (!result.empty() && i <= result.back().Offset + result.back().Count + m_MergeGap)
+            { result.back().Count = i + 1 - result.back().Offset; }
+            else
+            { result.push_back({ i, 1 }); }
+        }
+        return result;
+    }
+
+private:
+    std::vector<std::vector<bool>>  m_Slots;
+    uint32_t                        m_MergeGap;
+};
+
+//-----------------------------------------------------------------------------
+//      範囲が一致するか比較します.
+//-----------------------------------------------------------------------------
+bool IsEqual(const std::vector<r3d::DirtyRange>& lhs, const std::vector<r3d::DirtyRange>& rhs)
+{
+    if (lhs.size() != rhs.size())
+    { return false; }
+
+    for(size_t i=0; i<lhs.size(); ++i)
+    {
+        if (lhs[i].Offset != rhs[i].Offset || lhs[i].Count != rhs[i].Count)
+        { return false; }
+    }
+
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      不正な面数を拒否します.
+//-----------------------------------------------------------------------------
+R3D_TEST(InitRejectsZeroSlots)
+{
+    r3d::DirtyRangeTracker tracker;
+    R3D_CHECK(!tracker.Init(0, 0));
+    R3D_CHECK(tracker.Init(3, 0));
+    R3D_CHECK(tracker.GetSlotCount() == 3);
+    R3D_CHECK(!tracker.IsDirty(0));
+}
+
+//-----------------------------------------------------------------------------
+//      面ごとに独立して取り出します.
+//-----------------------------------------------------------------------------
+R3D_TEST(FlushPerSlot)
+{
+    r3d::DirtyRangeTracker tracker;
+    R3D_REQUIRE(tracker.Init(3, 0));
+
+    tracker.Mark(10, 5);
+    R3D_CHECK(tracker.IsDirty(0) && tracker.IsDirty(1) && tracker.IsDirty(2));
+
+    std::vector<r3d::DirtyRange> ranges;
+    tracker.Flush(1, ranges);
+    R3D_CHECK(IsEqual(ranges, { { 10, 5 } }));
+    R3D_CHECK(!tracker.IsDirty(1));
+    R3D_CHECK(tracker.IsDirty(0));
+
+    // 取り出した後の変更はその面にだけ新しく積まれる.
+    tracker.Mark(100);
+    tracker.Flush(1, ranges);
+    R3D_CHECK(IsEqual(ranges, { { 100, 1 } }));
+
+    tracker.Flush(0, ranges);
+    R3D_CHECK(IsEqual(ranges, { { 10, 5 }, { 100, 1 } }));
+
+    tracker.Flush(0, ranges);
+    R3D_CHECK(ranges.empty());
+}
+
+//-----------------------------------------------------------------------------
+//      小さい隙間を結合します.
+//-----------------------------------------------------------------------------
+R3D_TEST(FlushMergesGaps)
+{
+    r3d::DirtyRangeTracker tracker;
+    R3D_REQUIRE(tracker.Init(1, 4));
+
+    tracker.Mark(0, 2);
+    tracker.Mark(6, 1);     // 隙間 4 : 結合する.
+    tracker.Mark(12, 1);    // 隙間 5 : 結合しない.
+    tracker.Mark(60, 8);    // ワード境界を跨ぐ.
+    tracker.Mark(70, 1);    // 隙間 2 : 結合する.
+
+    std::vector<r3d::DirtyRange> ranges;
+    tracker.Flush(0, ranges);
+    R3D_CHECK(IsEqual(ranges, { { 0, 7 }, { 12, 1 }, { 60, 11 } }));
+}
+
+//-----------------------------------------------------------------------------
+//      複数ワードに渡る範囲と重複した記録を扱います.
+//-----------------------------------------------------------------------------
+R3D_TEST(MarkSpansWords)
+{
+    r3d::DirtyRangeTracker tracker;
+    R3D_REQUIRE(tracker.Init(1, 0));
+
+    tracker.Mark(63, 130);
+    tracker.Mark(64, 10);
+    tracker.Mark(192, 1);
+
+    std::vector<r3d::DirtyRange> ranges;
+    tracker.Flush(0, ranges);
+    R3D_CHECK(IsEqual(ranges, { { 63, 130 } }));
+}
+
+//-----------------------------------------------------------------------------
+//      ランダムな変更を総当たりの結果と比較します.
+//-----------------------------------------------------------------------------
+R3D_TEST(RandomMatchesBruteForce)
+{
+    static const uint32_t SLOT_COUNT  = 3;
+    static const uint32_t ELEMENTS    = 5000;
+    static const uint32_t MERGE_GAPS[] = { 0, 1, 16, 100 };
+
+    for(auto gap : MERGE_GAPS)
+    {
+        r3d::DirtyRangeTracker tracker;
+        R3D_REQUIRE(tracker.Init(SLOT_COUNT, gap));
+        Reference reference(SLOT_COUNT, gap);
+
+        std::mt19937 rng(777 + gap);
+        std::vector<r3d::DirtyRange> ranges;
+
+        for(auto frame=0u; frame<500; ++frame)
+        {
+            // まばらな単発の変更と, まとまった範囲の変更を混ぜる.
+            auto markCount = rng() % 32;
+            for(auto i=0u; i<markCount; ++i)
+            {
+                auto offset = rng() % ELEMENTS;
+                auto count  = ((rng() % 8) == 0) ? 1 + rng() % 200 : 1;
+                tracker  .Mark(offset, count);
+                reference.Mark(offset, count);
+            }
+
+            // 毎フレーム1面ずつ, 時々全ての面を取り出す.
+            auto flushAll = (rng() % 16) == 0;
+            for(auto slot=0u; slot<SLOT_COUNT; ++slot)
+            {
+                if (!flushAll && slot != frame % SLOT_COUNT)
+                { continue; }
+
+                auto expected = reference.Flush(slot);
+                R3D_CHECK(tracker.IsDirty(slot) == !expected.empty());
+
+                tracker.Flush(slot, ranges);
+                R3D_REQUIRE(IsEqual(ranges, expected));
+                R3D_CHECK(!tracker.IsDirty(slot));
+            }
+        }
+    }
+}
@@ -0,0 +1,327 @@
+﻿//-----------------------------------------------------------------------------
+// File : EncoderPoolTest.cpp
+// Desc : EncoderPool Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <EncoderPool.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const auto   BLOCK_WAIT      = std::chrono::milliseconds(50);
+static const size_t MAX_WORKERS     = 16;
+
+///////////////////////////////////////////////////////////////////////////////
+// FakeHandler class
+///////////////////////////////////////////////////////////////////////////////
+class FakeHandler : public r3d::IEncodeHandler
+{
+public:
+    //-------------------------------------------------------------------------
+    //! @brief      フレームを記録します. ゲートが閉じている間は待ちます.
+    //-------------------------------------------------------------------------
+    bool Encode(uint32_t workerIndex, const r3d::CaptureFrame& frame) override
+    {
+        if (workerIndex >= MAX_WORKERS || m_Busy[workerIndex].exchange(true))
+        { m_Overlap = true; }
+
+        {
+            std::unique_lock<std::mutex> locker(m_Mutex);
+            m_Started++;
+            m_Changed.notify_all();
+            m_Changed.wait(locker, [this]() { return m_Open; });
+        }
+
+        if (m_Delay.count() > 0)
+        { std::this_thread::sleep_for(m_Delay); }
+
+        {
+            std::lock_guard<std::mutex> locker(m_Mutex);
+            m_Encoded.push_back(frame.FrameIndex);
+        }
+
+        if (workerIndex < MAX_WORKERS)
+        { m_Busy[workerIndex] = false; }
+
+        // 奇数フレームは失敗させる設定.
+        return !(m_FailOdd && (frame.FrameIndex & 1) != 0);
+    }
+
+    void SetOpen(bool open)
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        m_Open = open;
+        m_Changed.notify_all();
+    }
+
+    void WaitStarted(uint32_t count)
+    {
+        std::unique_lock<std::mutex> locker(m_Mutex);
+        m_Changed.wait(locker, [&]() { return m_Started >= count; });
+    }
+
+    std::vector<uint32_t> GetEncoded()
+    {
+        std::lock_guard<std::mutex> locker(m_Mutex);
+        return m_Encoded;
+    }
+
+    bool                        m_FailOdd   = false;
+    std::chrono::milliseconds   m_Delay     = std::chrono::milliseconds(0);
+    std::atomic<bool>           m_Overlap   = { false };
+
+private:
+    std::mutex              m_Mutex;
+    std::condition_variable m_Changed;
+    bool                    m_Open      = true;
+    uint32_t                m_Started   = 0;
+    std::vector<uint32_t>   m_Encoded;
+    std::atomic<bool>       m_Busy[MAX_WORKERS] = {};
+};
+
+//-----------------------------------------------------------------------------
+//      構成設定を作成します.
+//-----------------------------------------------------------------------------
+r3d::EncoderPoolDesc MakeDesc(FakeHandler* pHandler, uint32_t workerCount, uint32_t bufferCount)
+{
+    r3d::EncoderPoolDesc desc = {};
+    desc.WorkerCount = workerCount;
+    desc.BufferCount = bufferCount;
+    desc.BufferSize  = 64;
+    desc.pHandler    = pHandler;
+    return desc;
+}
+
+//-----------------------------------------------------------------------------
+//      フレームを投入します.
+//-----------------------------------------------------------------------------
+bool SubmitFrame(r3d::EncoderPool& pool, uint32_t frameIndex)
+{
+    auto pFrame = pool.Acquire();
+    if (pFrame == nullptr)
+    { return false; }
+
+    pFrame->FrameIndex  = frameIndex;
+    pFrame->SourceIndex = frameIndex;
+    pool.Submit(pFrame);
+    return true;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      キューは先入れ先出しで, 閉じた後も残りを取り出せます.
+//-----------------------------------------------------------------------------
+R3D_TEST(QueueFifoAndClose)
+{
+    r3d::BoundedQueue queue;
+    R3D_CHECK(!queue.Init(0));
+    R3D_REQUIRE(queue.Init(3));
+    R3D_CHECK(queue.GetCapacity() == 3);
+
+    uint32_t value = 0;
+    R3D_CHECK(!queue.TryPop(value));
+
+    // 折り返しを跨いで順序を保つ.
+    for(auto round=0u; round<4; ++round)
+    {
+        R3D_CHECK(queue.Push(round * 10 + 0));
+        R3D_CHECK(queue.Push(round * 10 + 1));
+        R3D_CHECK(queue.GetCount() == 2);
+        R3D_CHECK(queue.Pop(value) && value == round * 10 + 0);
+        R3D_CHECK(queue.TryPop(value) && value == round * 10 + 1);
+    }
+
+    R3D_CHECK(queue.Push(7));
+    queue.Close();
+    R3D_CHECK(!queue.Push(8));
+    R3D_CHECK(queue.Pop(value) && value == 7);
+    R3D_CHECK(!queue.Pop(value));
+}
+
+//-----------------------------------------------------------------------------
+//      満杯のキューへの追加は空くまで待ちます.
+//-----------------------------------------------------------------------------
+R3D_TEST(QueuePushBlocksWhenFull)
+{
+    r3d::BoundedQueue queue;
+    R3D_REQUIRE(queue.Init(1));
+    R3D_REQUIRE(queue.Push(1));
+
+    std::atomic<bool> pushed = { false };
+    std::thread producer([&]()
+    {
+        queue.Push(2);
+        pushed = true;
+    });
+
+    std::this_thread::sleep_for(BLOCK_WAIT);
+    R3D_CHECK(!pushed);
+
+    uint32_t value = 0;
+    R3D_CHECK(queue.Pop(value) && value == 1);
+    producer.join();
+    R3D_CHECK(pushed);
+    R3D_CHECK(queue.Pop(value) && value == 2);
+
+    // 空のキューで待っているスレッドは Close() で起きる.
+    std::atomic<bool> popped = { true };
+    std::thread consumer([&]()
+    {
+        uint32_t dummy = 0;
+        popped = queue.Pop(dummy);
+    });
+    std::this_thread::sleep_for(BLOCK_WAIT);
+    queue.Close();
+    consumer.join();
+    R3D_CHECK(!popped);
+}
+
+//-----------------------------------------------------------------------------
+//      不正な構成設定を拒否します.
+//-----------------------------------------------------------------------------
+R3D_TEST(PoolRejectsInvalidDesc)
+{
+    FakeHandler handler;
+    r3d::EncoderPool pool;
+    R3D_CHECK(!pool.Init(MakeDesc(nullptr, 1, 1)));
+
+    auto desc = MakeDesc(&handler, 1, 1);
+    desc.BufferSize = 0;
+    R3D_CHECK(!pool.Init(desc));
+
+    R3D_CHECK(pool.Acquire() == nullptr);
+
+    // ワーカー数はバッファ数で打ち切られる.
+    R3D_REQUIRE(pool.Init(MakeDesc(&handler, 8, 2)));
+    R3D_CHECK(pool.GetWorkerCount() == 2);
+    R3D_CHECK(pool.GetBufferCount() == 2);
+}
+
+//-----------------------------------------------------------------------------
+//      全てのバッファが処理中なら Acquire() は待ち, 待ち時間を記録します.
+//-----------------------------------------------------------------------------
+R3D_TEST(PoolBackpressure)
+{
+    FakeHandler handler;
+    handler.SetOpen(false);
+
+    r3d::EncoderPool pool;
+    R3D_REQUIRE(pool.Init(MakeDesc(&handler, 1, 2)));
+
+    R3D_REQUIRE(SubmitFrame(pool, 0));
+    R3D_REQUIRE(SubmitFrame(pool, 1));
+    handler.WaitStarted(1);
+
+    auto stats = pool.GetStats();
+    R3D_CHECK(stats.StallCount == 0);
+
+    std::atomic<bool> acquired = { false };
+    std::thread producer([&]()
+    {
+        auto pFrame = pool.Acquire();
+        acquired = true;
+        if (pFrame != nullptr)
+        {
+            pFrame->FrameIndex = 2;
+            pool.Submit(pFrame);
+        }
+    });
+
+    std::this_thread::sleep_for(BLOCK_WAIT);
+    R3D_CHECK(!acquired);
+
+    handler.SetOpen(true);
+    producer.join();
+    R3D_CHECK(acquired);
+
+    pool.Drain();
+
+    stats = pool.GetStats();
+    R3D_CHECK(stats.SubmitCount == 3);
+    R3D_CHECK(stats.CompleteCount == 3);
+    R3D_CHECK(stats.StallCount == 1);
+    R3D_CHECK(stats.StallSec > 0.0);
+    R3D_CHECK(stats.MaxStallSec <= stats.StallSec);
+    R3D_CHECK(handler.GetEncoded() == std::vector<uint32_t>({ 0, 1, 2 }));
+}
+
+//-----------------------------------------------------------------------------
+//      成功と失敗を数え, 返却したフレームはエンコードしません.
+//-----------------------------------------------------------------------------
+R3D_TEST(PoolCountsFailuresAndDiscards)
+{
+    FakeHandler handler;
+    handler.m_FailOdd = true;
+
+    r3d::EncoderPool pool;
+    R3D_REQUIRE(pool.Init(MakeDesc(&handler, 2, 4)));
+
+    for(auto i=0u; i<10; ++i)
+    { R3D_REQUIRE(SubmitFrame(pool, i)); }
+
+    auto pFrame = pool.Acquire();
+    R3D_REQUIRE(pFrame != nullptr);
+    pFrame->FrameIndex = 100;
+    pool.Discard(pFrame);
+
+    pool.Drain();
+
+    auto stats = pool.GetStats();
+    R3D_CHECK(stats.SubmitCount == 10);
+    R3D_CHECK(stats.CompleteCount == 5);
+    R3D_CHECK(stats.FailCount == 5);
+    R3D_CHECK(handler.GetEncoded().size() == 10);
+}
+
+//-----------------------------------------------------------------------------
+//      Term() は投入済みのフレームを全て出力してから抜けます.
+//-----------------------------------------------------------------------------
+R3D_TEST(PoolTermDrainsJobs)
+{
+    static const uint32_t FRAME_COUNT = 64;
+
+    FakeHandler handler;
+    handler.m_Delay = std::chrono::milliseconds(1);
+
+    {
+        r3d::EncoderPool pool;
+        R3D_REQUIRE(pool.Init(MakeDesc(&handler, 4, 8)));
+
+        for(auto i=0u; i<FRAME_COUNT; ++i)
+        { R3D_REQUIRE(SubmitFrame(pool, i)); }
+
+        pool.Term();
+        R3D_CHECK(pool.Acquire() == nullptr);
+        R3D_CHECK(pool.GetWorkerCount() == 0);
+    }
+
+    auto encoded = handler.GetEncoded();
+    R3D_CHECK(encoded.size() == FRAME_COUNT);
+
+    std::vector<bool> seen(FRAME_COUNT, false);
+    for(auto index : encoded)
+    {
+        R3D_REQUIRE(index < FRAME_COUNT);
+        R3D_CHECK(!seen[index]);
+        seen[index] = true;
+    }
+
+    // 同じワーカー番号で同時に呼び出されない.
+    R3D_CHECK(!handler.m_Overlap);
+}
@@ -0,0 +1,254 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneDiffTest.cpp
+// Desc : SceneDiff Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <SceneDiff.h>
+#include <offline/SceneExporter.h>
+#include <cstring>
+#include <string>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t MESH_COUNT        = 3;
+static const uint32_t MESH_VERTEX_COUNT = 36;
+static const uint32_t MATERIAL_COUNT    = 4;
+static const uint32_t INSTANCE_COUNT    = 4;
+static const uint32_t LIGHT_COUNT       = 2;
+
+///////////////////////////////////////////////////////////////////////////////
+// SceneEdit structure
+///////////////////////////////////////////////////////////////////////////////
+struct SceneEdit
+{
+    uint32_t    MeshCount           = MESH_COUNT;
+    uint32_t    EditedMesh          = UINT32_MAX;   //!< インデックスを並べ替えるメッシュ.
+    uint32_t    EditedMaterials     = 0;            //!< 粗さを変えるマテリアルのビットマスク.
+    uint32_t    MovedInstanceTag    = 0;            //!< 平行移動するインスタンスのハッシュタグ.
+    bool        ReverseInstances    = false;        //!< インスタンスを逆順に出力します.
+};
+
+//-----------------------------------------------------------------------------
+//      テスト用のシーンを出力します.
+//-----------------------------------------------------------------------------
+bool CreateScene(const char* name, const SceneEdit& edit, std::string& result)
+{
+    auto iblPath = r3d::test::GetTempPath("ibl.dds");
+    if (!r3d::test::WriteDds(iblPath, 16, 8))
+    { return false; }
+
+    r3d::offline::SceneExporter exporter;
+    exporter.SetIBL(iblPath.c_str());
+
+    // メッシュの配列はエクスポーターが解放する.
+    for(auto i=0u; i<edit.MeshCount; ++i)
+    {
+        r3d::Mesh mesh = {};
+        mesh.VertexCount = MESH_VERTEX_COUNT;
+        mesh.IndexCount  = MESH_VERTEX_COUNT;
+        mesh.Vertices    = new r3d::ResVertex[mesh.VertexCount];
+        mesh.Indices     = new uint32_t[mesh.IndexCount];
+        for(auto j=0u; j<mesh.IndexCount; ++j)
+        { mesh.Indices[j] = (i == edit.EditedMesh) ? mesh.IndexCount - 1 - j : j; }
+        exporter.AddMesh(mesh);
+    }
+
+    for(auto i=0u; i<MATERIAL_COUNT; ++i)
+    {
+        auto material = r3d::offline::Material::Default();
+        if (edit.EditedMaterials & (1u << i))
+        { material.Roughness = 0.5f; }
+        exporter.AddMaterial(material);
+    }
+
+    for(auto i=0u; i<INSTANCE_COUNT; ++i)
+    {
+        auto index = edit.ReverseInstances ? INSTANCE_COUNT - 1 - i : i;
+
+        r3d::offline::CpuInstance instance = {};
+        instance.HashTag    = 100 + index;
+        instance.MeshId     = index % 2;
+        instance.MaterialId = index % MATERIAL_COUNT;
+        instance.Transform  = r3d::offline::Transform3x4();
+        if (instance.HashTag == edit.MovedInstanceTag)
+        { instance.Transform.m[0][3] = 1.0f; }
+        exporter.AddInstance(instance);
+    }
+
+    for(auto i=0u; i<LIGHT_COUNT; ++i)
+    {
+        r3d::offline::Light light = {};
+        light.HashTag = 200 + i;
+        light.Type    = r3d::LIGHT_TYPE_POINT;
+        light.Radius  = 1.0f;
+        exporter.AddLight(light);
+    }
+
+    result = r3d::test::GetTempPath(name);
+    return exporter.Export(result.c_str());
+}
+
+//-----------------------------------------------------------------------------
+//      シーンを出力してダイジェストを作成します.
+//-----------------------------------------------------------------------------
+bool LoadDigest(const char* name, const SceneEdit& edit, r3d::SceneDigest& result)
+{
+    std::string path;
+    if (!CreateScene(name, edit, path))
+    { return false; }
+
+    return r3d::LoadSceneDigest(path.c_str(), result);
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      同じ内容のシーンには差分がありません.
+//-----------------------------------------------------------------------------
+R3D_TEST(UnchangedSceneIsEmpty)
+{
+    r3d::SceneDigest prev;
+    r3d::SceneDigest next;
+    R3D_REQUIRE(LoadDigest("prev.scn", SceneEdit(), prev));
+    R3D_REQUIRE(LoadDigest("next.scn", SceneEdit(), next));
+
+    R3D_CHECK(prev.IblHash != 0);
+    R3D_CHECK(prev.Meshes   .size() == MESH_COUNT);
+    R3D_CHECK(prev.Materials.size() == MATERIAL_COUNT);
+    R3D_CHECK(prev.Instances.size() == INSTANCE_COUNT);
+    R3D_CHECK(prev.Lights   .size() == LIGHT_COUNT);
+
+    r3d::SceneDiff diff;
+    r3d::DiffScene(prev, next, diff);
+    R3D_CHECK(diff.IsEmpty());
+    R3D_CHECK(diff.Reason == nullptr);
+}
+
+//-----------------------------------------------------------------------------
+//      変更したマテリアルだけを連続する範囲で返します.
+//-----------------------------------------------------------------------------
+R3D_TEST(MaterialEditPatchesMaterials)
+{
+    r3d::SceneDigest prev;
+    R3D_REQUIRE(LoadDigest("prev.scn", SceneEdit(), prev));
+
+    SceneEdit edit;
+    edit.EditedMaterials = 0x2 | 0x4 | 0x8;
+
+    r3d::SceneDigest next;
+    R3D_REQUIRE(LoadDigest("material.scn", edit, next));
+
+    r3d::SceneDiff diff;
+    r3d::DiffScene(prev, next, diff);
+    R3D_CHECK(!diff.Rebuild);
+    R3D_CHECK(diff.Meshes   .empty());
+    R3D_CHECK(diff.Instances.empty());
+    R3D_CHECK(diff.Lights   .empty());
+
+    R3D_REQUIRE(diff.Materials.size() == 1);
+    R3D_CHECK(diff.Materials[0].Index    == 1);
+    R3D_CHECK(diff.Materials[0].NewIndex == 1);
+    R3D_CHECK(diff.Materials[0].Count    == 3);
+
+    // 離れている場合は範囲を分ける.
+    edit.EditedMaterials = 0x1 | 0x8;
+    R3D_REQUIRE(LoadDigest("material.scn", edit, next));
+
+    r3d::DiffScene(prev, next, diff);
+    R3D_REQUIRE(diff.Materials.size() == 2);
+    R3D_CHECK(diff.Materials[0].Index == 0 && diff.Materials[0].Count == 1);
+    R3D_CHECK(diff.Materials[1].Index == 3 && diff.Materials[1].Count == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      サイズが同じメッシュは番号だけを返します.
+//-----------------------------------------------------------------------------
+R3D_TEST(MeshEditPatchesMesh)
+{
+    r3d::SceneDigest prev;
+    R3D_REQUIRE(LoadDigest("prev.scn", SceneEdit(), prev));
+
+    SceneEdit edit;
+    edit.EditedMesh = 1;
+
+    r3d::SceneDigest next;
+    R3D_REQUIRE(LoadDigest("mesh.scn", edit, next));
+
+    r3d::SceneDiff diff;
+    r3d::DiffScene(prev, next, diff);
+    R3D_CHECK(!diff.Rebuild);
+    R3D_CHECK(diff.Materials.empty());
+    R3D_CHECK(diff.Instances.empty());
+
+    R3D_REQUIRE(diff.Meshes.size() == 1);
+    R3D_CHECK(diff.Meshes[0] == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      メッシュの追加・削除は再構築になります.
+//-----------------------------------------------------------------------------
+R3D_TEST(MeshCountChangeRebuilds)
+{
+    r3d::SceneDigest prev;
+    R3D_REQUIRE(LoadDigest("prev.scn", SceneEdit(), prev));
+
+    const uint32_t counts[] = { MESH_COUNT + 1, MESH_COUNT - 1 };
+    for(auto count : counts)
+    {
+        SceneEdit edit;
+        edit.MeshCount = count;
+
+        r3d::SceneDigest next;
+        R3D_REQUIRE(LoadDigest("count.scn", edit, next));
+        R3D_CHECK(next.Meshes.size() == count);
+
+        r3d::SceneDiff diff;
+        r3d::DiffScene(prev, next, diff);
+        R3D_CHECK(diff.Rebuild);
+        R3D_CHECK(!diff.IsEmpty());
+        R3D_REQUIRE(diff.Reason != nullptr);
+        R3D_CHECK(strcmp(diff.Reason, "mesh count changed") == 0);
+        R3D_CHECK(diff.Meshes.empty());
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      インスタンスはハッシュタグで対応付けます.
+//-----------------------------------------------------------------------------
+R3D_TEST(InstancesMatchByHashTag)
+{
+    r3d::SceneDigest prev;
+    R3D_REQUIRE(LoadDigest("prev.scn", SceneEdit(), prev));
+
+    // 並びだけが変わっても差分は無い.
+    SceneEdit edit;
+    edit.ReverseInstances = true;
+
+    r3d::SceneDigest next;
+    R3D_REQUIRE(LoadDigest("reverse.scn", edit, next));
+
+    r3d::SceneDiff diff;
+    r3d::DiffScene(prev, next, diff);
+    R3D_CHECK(diff.IsEmpty());
+
+    // 動かしたインスタンスは読み込み済みの番号と新しい番号を返す.
+    edit.MovedInstanceTag = 101;
+    R3D_REQUIRE(LoadDigest("moved.scn", edit, next));
+
+    r3d::DiffScene(prev, next, diff);
+    R3D_CHECK(!diff.Rebuild);
+    R3D_REQUIRE(diff.Instances.size() == 1);
+    R3D_CHECK(diff.Instances[0].Index    == 1);
+    R3D_CHECK(diff.Instances[0].NewIndex == INSTANCE_COUNT - 2);
+    R3D_CHECK(diff.Instances[0].Count    == 1);
+}
@@ -0,0 +1,393 @@
+﻿//-----------------------------------------------------------------------------
+// File : SceneStreamerTest.cpp
+// Desc : SceneStreamer Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <SceneStreamer.h>
+#include <offline/SceneExporter.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t MESH_COUNT        = 6;
+static const uint32_t MESH_VERTEX_COUNT = 12000;    // 2メッシュで1セクション (1MiB) を超える大きさ.
+static const uint32_t TEXTURE_COUNT     = 3;
+static const uint32_t MATERIAL_COUNT    = 4;
+static const uint32_t INSTANCE_COUNT    = 8;
+static const uint32_t LIGHT_COUNT       = 2;
+
+///////////////////////////////////////////////////////////////////////////////
+// FakeUploader class
+///////////////////////////////////////////////////////////////////////////////
+class FakeUploader : public r3d::ISceneUploader
+{
+public:
+    std::vector<r3d::SceneSection>  Sections;       //!< アップロードした順のセクション.
+    uint32_t                        FailAt  = UINT32_MAX;
+    uint32_t                        Errors  = 0;    //!< 依存関係の違反数.
+    r3d::SceneStreamer*             pOwner  = nullptr;
+    std::unique_ptr<uint8_t[]>      Lights;         //!< pOwner から引き取ったライトのセクション.
+
+    FakeUploader(const r3d::SceneContainerHeader& header)
+    : m_Header(header)
+    { /* DO_NOTHING */ }
+
+    bool Upload(const r3d::SceneSection& section) override
+    {
+        if (Sections.size() == FailAt)
+        { return false; }
+
+        // ISceneUploader が保証する順序を検証する.
+        switch(section.Type)
+        {
+        case r3d::SCENE_SECTION_TYPE_MESHES:
+            if (section.FirstIndex != m_NextMesh)
+            { Errors++; }
+            m_NextMesh = section.FirstIndex + section.Count;
+            break;
+
+        case r3d::SCENE_SECTION_TYPE_TEXTURES:
+            m_TextureCount += section.Count;
+            break;
+
+        case r3d::SCENE_SECTION_TYPE_MATERIALS:
+            if (m_TextureCount != m_Header.TextureCount)
+            { Errors++; }
+            break;
+
+        case r3d::SCENE_SECTION_TYPE_INSTANCES:
+            if (m_NextMesh != m_Header.MeshCount)
+            { Errors++; }
+            break;
+
+        default:
+            break;
+        }
+
+        // 呼び出し中はセクションのデータを参照できる.
+        if (section.pScene == nullptr)
+        { Errors++; }
+
+        if (pOwner != nullptr && section.Type == r3d::SCENE_SECTION_TYPE_LIGHTS)
+        { Lights = pOwner->DetachSection(section.Index); }
+
+        Sections.push_back(section);
+        return true;
+    }
+
+    // 種類ごとに最初にアップロードした順番を取得する.
+    size_t FindFirst(r3d::SCENE_SECTION_TYPE type) const
+    {
+        for(size_t i=0; i<Sections.size(); ++i)
+        {
+            if (Sections[i].Type == type)
+            { return i; }
+        }
+        return SIZE_MAX;
+    }
+
+private:
+    r3d::SceneContainerHeader   m_Header;
+    uint32_t                    m_NextMesh      = 0;
+    uint32_t                    m_TextureCount  = 0;
+};
+
+//-----------------------------------------------------------------------------
+//      テスト用のシーンを出力します.
+//-----------------------------------------------------------------------------
+bool CreateScene(const char* name, std::string& result)
+{
+    auto iblPath = r3d::test::GetTempPath("ibl.dds");
+    if (!r3d::test::WriteDds(iblPath, 16, 8))
+    { return false; }
+
+    r3d::offline::SceneExporter exporter;
+    exporter.SetIBL(iblPath.c_str());
+
+    for(auto i=0u; i<TEXTURE_COUNT; ++i)
+    {
+        auto path = r3d::test::GetTempPath(("texture" + std::to_string(i) + ".dds").c_str());
+        if (!r3d::test::WriteDds(path, 64, 64))
+        { return false; }
+        exporter.AddTexture(path.c_str());
+    }
+
+    // メッシュの配列はエクスポーターが解放する.
+    for(auto i=0u; i<MESH_COUNT; ++i)
+    {
+        r3d::Mesh mesh = {};
+        mesh.VertexCount = MESH_VERTEX_COUNT;
+        mesh.IndexCount  = MESH_VERTEX_COUNT;
+        mesh.Vertices    = new r3d::ResVertex[mesh.VertexCount];
+        mesh.Indices     = new uint32_t[mesh.IndexCount];
+        for(auto j=0u; j<mesh.IndexCount; ++j)
+        { mesh.Indices[j] = j; }
+        exporter.AddMesh(mesh);
+    }
+
+    for(auto i=0u; i<MATERIAL_COUNT; ++i)
+    {
+        auto material = r3d::offline::Material::Default();
+        material.BaseColorMap = i % TEXTURE_COUNT;
+        exporter.AddMaterial(material);
+    }
+
+    for(auto i=0u; i<INSTANCE_COUNT; ++i)
+    {
+        r3d::offline::CpuInstance instance = {};
+        instance.HashTag    = 100 + i;
+        instance.MeshId     = i % MESH_COUNT;
+        instance.MaterialId = i % MATERIAL_COUNT;
+        exporter.AddInstance(instance);
+    }
+
+    for(auto i=0u; i<LIGHT_COUNT; ++i)
+    {
+        r3d::offline::Light light = {};
+        light.HashTag = 200 + i;
+        light.Type    = r3d::LIGHT_TYPE_POINT;
+        light.Radius  = 1.0f;
+        exporter.AddLight(light);
+    }
+
+    result = r3d::test::GetTempPath(name);
+    return exporter.Export(result.c_str());
+}
+
+//-----------------------------------------------------------------------------
+//      全セクションの展開を待ちます.
+//-----------------------------------------------------------------------------
+bool WaitDecoded(const r3d::SceneStreamer& streamer)
+{
+    for(auto i=0; i<10000; ++i)
+    {
+        auto progress = streamer.GetProgress();
+        if (progress.DecodedCount == progress.SectionCount)
+        { return true; }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      存在しないファイルは開始できません.
+//-----------------------------------------------------------------------------
+R3D_TEST(StartRejectsMissingFile)
+{
+    r3d::SceneStreamer streamer;
+    R3D_CHECK(!streamer.Start(r3d::test::GetTempPath("missing.scn").c_str()));
+    R3D_CHECK(streamer.GetState() == r3d::SCENE_STREAM_STATE_IDLE);
+
+    FakeUploader uploader(streamer.GetHeader());
+    R3D_CHECK(streamer.Update(&uploader, UINT64_MAX) == r3d::SCENE_STREAM_STATE_IDLE);
+    R3D_CHECK(uploader.Sections.empty());
+}
+
+//-----------------------------------------------------------------------------
+//      待ちながら全セクションを依存関係の順にアップロードします.
+//-----------------------------------------------------------------------------
+R3D_TEST(UploadsAllSectionsInDependencyOrder)
+{
+    std::string path;
+    R3D_REQUIRE(CreateScene("order.scn", path));
+
+    r3d::SceneStreamer streamer;
+    R3D_REQUIRE(streamer.Start(path.c_str(), 2));
+
+    auto& header = streamer.GetHeader();
+    R3D_CHECK(header.MeshCount     == MESH_COUNT);
+    R3D_CHECK(header.TextureCount  == TEXTURE_COUNT);
+    R3D_CHECK(header.MaterialCount == MATERIAL_COUNT);
+    R3D_CHECK(header.InstanceCount == INSTANCE_COUNT);
+
+    FakeUploader uploader(header);
+    R3D_CHECK(streamer.Update(&uploader, UINT64_MAX, true) == r3d::SCENE_STREAM_STATE_COMPLETED);
+    R3D_CHECK(uploader.Errors == 0);
+
+    auto progress = streamer.GetProgress();
+    R3D_CHECK(uploader.Sections.size() == progress.SectionCount);
+    R3D_CHECK(progress.UploadedCount   == progress.SectionCount);
+    R3D_CHECK(progress.UploadedBytes   == progress.TotalBytes);
+
+    // メッシュは複数のセクションに分かれて番号順に届く.
+    auto meshSections = std::count_if(uploader.Sections.begin(), uploader.Sections.end(),
+        [](const r3d::SceneSection& section) { return section.Type == r3d::SCENE_SECTION_TYPE_MESHES; });
+    R3D_CHECK(meshSections >= 2);
+
+    // 完了後は何もしない.
+    R3D_CHECK(streamer.Update(&uploader, UINT64_MAX) == r3d::SCENE_STREAM_STATE_COMPLETED);
+    R3D_CHECK(uploader.Sections.size() == progress.SectionCount);
+}
+
+//-----------------------------------------------------------------------------
+//      IBL とライトと形状をテクスチャとマテリアルより先にアップロードします.
+//-----------------------------------------------------------------------------
+R3D_TEST(UploadsDrawableSectionsFirst)
+{
+    std::string path;
+    R3D_REQUIRE(CreateScene("priority.scn", path));
+
+    r3d::SceneStreamer streamer;
+    R3D_REQUIRE(streamer.Start(path.c_str(), 2));
+    R3D_REQUIRE(WaitDecoded(streamer));
+
+    // 全て展開済みなら順番は優先度と依存関係だけで決まる.
+    FakeUploader uploader(streamer.GetHeader());
+    auto state = r3d::SCENE_STREAM_STATE_LOADING;
+    while(state == r3d::SCENE_STREAM_STATE_LOADING)
+    { state = streamer.Update(&uploader, 0); }
+    R3D_REQUIRE(state == r3d::SCENE_STREAM_STATE_COMPLETED);
+    R3D_CHECK(uploader.Errors == 0);
+
+    auto ibl       = uploader.FindFirst(r3d::SCENE_SECTION_TYPE_IBL);
+    auto lights    = uploader.FindFirst(r3d::SCENE_SECTION_TYPE_LIGHTS);
+    auto meshes    = uploader.FindFirst(r3d::SCENE_SECTION_TYPE_MESHES);
+    auto instances = uploader.FindFirst(r3d::SCENE_SECTION_TYPE_INSTANCES);
+    auto textures  = uploader.FindFirst(r3d::SCENE_SECTION_TYPE_TEXTURES);
+    auto materials = uploader.FindFirst(r3d::SCENE_SECTION_TYPE_MATERIALS);
+
+    R3D_CHECK(ibl == 0);
+    R3D_CHECK(ibl < lights && lights < meshes && meshes < instances);
+    R3D_CHECK(instances < textures && textures < materials);
+}
+
+//-----------------------------------------------------------------------------
+//      1回の呼び出しでアップロードする量を予算内に抑えます.
+//-----------------------------------------------------------------------------
+R3D_TEST(UpdateRespectsBudget)
+{
+    std::string path;
+    R3D_REQUIRE(CreateScene("budget.scn", path));
+
+    r3d::SceneContainer container;
+    R3D_REQUIRE(container.Init(path.c_str()));
+    auto& entries = container.GetEntries();
+
+    uint64_t maxSize = 0;
+    for(auto& entry : entries)
+    { maxSize = std::max(maxSize, entry.RawSize); }
+
+    const uint64_t budgets[] = { 0, 64 * 1024, maxSize, maxSize * 3 };
+    for(auto budget : budgets)
+    {
+        r3d::SceneStreamer streamer;
+        R3D_REQUIRE(streamer.Start(path.c_str(), 2));
+        R3D_REQUIRE(WaitDecoded(streamer));
+
+        FakeUploader uploader(streamer.GetHeader());
+        auto state = r3d::SCENE_STREAM_STATE_LOADING;
+        auto calls = 0u;
+        while(state == r3d::SCENE_STREAM_STATE_LOADING && calls < 1000)
+        {
+            auto first = uploader.Sections.size();
+            state = streamer.Update(&uploader, budget);
+            calls++;
+
+            // 少なくとも1セクションは進み, 2つ以上なら予算を超えない.
+            auto count = uploader.Sections.size() - first;
+            R3D_CHECK(count >= 1);
+
+            uint64_t spent = 0;
+            for(auto i=first; i<uploader.Sections.size(); ++i)
+            { spent += entries[uploader.Sections[i].Index].RawSize; }
+            R3D_CHECK(count == 1 || spent <= budget);
+        }
+
+        R3D_CHECK(state == r3d::SCENE_STREAM_STATE_COMPLETED);
+        R3D_CHECK(uploader.Errors == 0);
+
+        // 予算が小さいほど多くのフレームに分かれる.
+        if (budget == 0)
+        { R3D_CHECK(calls == entries.size()); }
+        else if (budget >= maxSize * 3)
+        { R3D_CHECK(calls < entries.size()); }
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      アップロードに失敗したら以降は何もしません.
+//-----------------------------------------------------------------------------
+R3D_TEST(UploadFailureStops)
+{
+    std::string path;
+    R3D_REQUIRE(CreateScene("failure.scn", path));
+
+    r3d::SceneStreamer streamer;
+    R3D_REQUIRE(streamer.Start(path.c_str(), 2));
+
+    FakeUploader uploader(streamer.GetHeader());
+    uploader.FailAt = 2;
+    R3D_CHECK(streamer.Update(&uploader, UINT64_MAX, true) == r3d::SCENE_STREAM_STATE_FAILED);
+    R3D_CHECK(uploader.Sections.size() == 2);
+
+    R3D_CHECK(streamer.Update(&uploader, UINT64_MAX, true) == r3d::SCENE_STREAM_STATE_FAILED);
+    R3D_CHECK(uploader.Sections.size() == 2);
+    R3D_CHECK(streamer.GetProgress().UploadedCount == 2);
+}
+
+//-----------------------------------------------------------------------------
+//      読み込み途中で中断して, やり直せます.
+//-----------------------------------------------------------------------------
+R3D_TEST(TermCancelsAndRestarts)
+{
+    std::string path;
+    R3D_REQUIRE(CreateScene("restart.scn", path));
+
+    r3d::SceneStreamer streamer;
+    R3D_REQUIRE(streamer.Start(path.c_str(), 2));
+
+    FakeUploader partial(streamer.GetHeader());
+    R3D_CHECK(streamer.Update(&partial, 0, true) == r3d::SCENE_STREAM_STATE_LOADING);
+    R3D_CHECK(partial.Sections.size() == 1);
+
+    streamer.Term();
+    R3D_CHECK(streamer.GetState() == r3d::SCENE_STREAM_STATE_IDLE);
+    R3D_CHECK(streamer.GetProgress().UploadedBytes == 0);
+
+    R3D_REQUIRE(streamer.Start(path.c_str(), 2));
+    FakeUploader uploader(streamer.GetHeader());
+    R3D_CHECK(streamer.Update(&uploader, UINT64_MAX, true) == r3d::SCENE_STREAM_STATE_COMPLETED);
+    R3D_CHECK(uploader.Errors == 0);
+    R3D_CHECK(uploader.Sections.size() == streamer.GetProgress().SectionCount);
+}
+
+//-----------------------------------------------------------------------------
+//      引き取ったセクションは読み込み完了後も参照できます.
+//-----------------------------------------------------------------------------
+R3D_TEST(DetachedSectionOutlivesStreamer)
+{
+    std::string path;
+    R3D_REQUIRE(CreateScene("detach.scn", path));
+
+    r3d::SceneStreamer streamer;
+    R3D_REQUIRE(streamer.Start(path.c_str(), 2));
+
+    FakeUploader uploader(streamer.GetHeader());
+    uploader.pOwner = &streamer;
+    R3D_CHECK(streamer.Update(&uploader, UINT64_MAX, true) == r3d::SCENE_STREAM_STATE_COMPLETED);
+    streamer.Term();
+
+    R3D_REQUIRE(uploader.Lights != nullptr);
+    auto resScene = r3d::GetResScene(uploader.Lights.get());
+    R3D_REQUIRE(resScene->Lights() != nullptr);
+    R3D_CHECK(resScene->Lights()->size() == LIGHT_COUNT);
+    R3D_CHECK(resScene->LightTags()->Get(1) == 201);
+}
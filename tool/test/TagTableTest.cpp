@@ -0,0 +1,181 @@
+﻿//-----------------------------------------------------------------------------
+// File : TagTableTest.cpp
+// Desc : TagTable Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <TagTable.h>
+#include <algorithm>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t TAG_COUNTS[] = { 1, 2, 7, 100, 5000 };
+
+//-----------------------------------------------------------------------------
+//      重複しないハッシュタグを生成します.
+//-----------------------------------------------------------------------------
+std::vector<uint32_t> CreateTags(uint32_t count)
+{
+    // 奇数の乗算は 2^32 上の全単射なので重複しない.
+    std::vector<uint32_t> result(count);
+    for(auto i=0u; i<count; ++i)
+    { result[i] = (i + 1) * 0x9E3779B1u; }
+    return result;
+}
+
+//-----------------------------------------------------------------------------
+//      全てのハッシュタグが要素番号を引けて, 含まれないタグは見つからないことを検証します.
+//-----------------------------------------------------------------------------
+void CheckTable(const r3d::TagTable& table, const std::vector<uint32_t>& tags)
+{
+    for(auto i=0u; i<tags.size(); ++i)
+    { R3D_CHECK(table.Find(tags[i]) == i); }
+
+    // スロットは全て埋まっているので, 含まれないタグはタグの比較で弾かれる.
+    auto misses = 0u;
+    for(auto i=0u; i<1000; ++i)
+    {
+        auto tag = (uint32_t(tags.size()) + 1 + i) * 0x9E3779B1u;
+        if (table.Find(tag) == UINT32_MAX)
+        { misses++; }
+    }
+    R3D_CHECK(misses == 1000);
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      構築した表は全スロットを1回ずつ使います.
+//-----------------------------------------------------------------------------
+R3D_TEST(BuildFillsEverySlot)
+{
+    for(auto count : TAG_COUNTS)
+    {
+        auto tags = CreateTags(count);
+
+        std::vector<int32_t>         seeds;
+        std::vector<r3d::ResTagSlot> slots;
+        R3D_REQUIRE(r3d::BuildTagTable(tags.data(), count, seeds, slots));
+        R3D_CHECK(seeds.size() == count);
+        R3D_CHECK(slots.size() == count);
+
+        std::vector<bool> found(count, false);
+        for(auto& slot : slots)
+        {
+            R3D_REQUIRE(slot.Index() < count);
+            R3D_CHECK(!found[slot.Index()]);
+            R3D_CHECK(tags[slot.Index()] == slot.Tag());
+            found[slot.Index()] = true;
+        }
+        R3D_CHECK(std::find(found.begin(), found.end(), false) == found.end());
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      重複したハッシュタグは構築できません.
+//-----------------------------------------------------------------------------
+R3D_TEST(BuildRejectsDuplicatedTags)
+{
+    auto tags = CreateTags(100);
+    tags[70] = tags[30];
+
+    std::vector<int32_t>         seeds;
+    std::vector<r3d::ResTagSlot> slots;
+    R3D_CHECK(!r3d::BuildTagTable(tags.data(), uint32_t(tags.size()), seeds, slots));
+
+    r3d::TagTable table;
+    R3D_CHECK(!table.Init(tags.data(), uint32_t(tags.size())));
+    R3D_CHECK(table.Find(tags[0]) == UINT32_MAX);
+}
+
+//-----------------------------------------------------------------------------
+//      ハッシュタグから構築した表を検索します.
+//-----------------------------------------------------------------------------
+R3D_TEST(FindBuiltTable)
+{
+    r3d::TagTable table;
+    R3D_CHECK(table.Init(static_cast<const uint32_t*>(nullptr), 0));
+    R3D_CHECK(table.Find(0) == UINT32_MAX);
+
+    for(auto count : TAG_COUNTS)
+    {
+        auto tags = CreateTags(count);
+        R3D_REQUIRE(table.Init(tags.data(), count));
+        CheckTable(table, tags);
+    }
+
+    table.Term();
+    R3D_CHECK(table.Find(CreateTags(1)[0]) == UINT32_MAX);
+}
+
+//-----------------------------------------------------------------------------
+//      シーンファイルに格納された表をそのまま参照して検索します.
+//-----------------------------------------------------------------------------
+R3D_TEST(FindStoredTable)
+{
+    for(auto count : TAG_COUNTS)
+    {
+        auto tags = CreateTags(count);
+
+        std::vector<int32_t>         seeds;
+        std::vector<r3d::ResTagSlot> slots;
+        R3D_REQUIRE(r3d::BuildTagTable(tags.data(), count, seeds, slots));
+
+        flatbuffers::FlatBufferBuilder builder(2048);
+        builder.Finish(r3d::CreateResSceneDirect(
+            builder, 0, 0, 0, 0, count, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &tags,
+            nullptr, nullptr, &seeds, &slots));
+
+        auto resScene = r3d::GetResScene(builder.GetBufferPointer());
+
+        r3d::TagTable table;
+        R3D_REQUIRE(table.Init(resScene->LightTagSeeds(), resScene->LightTagSlots()));
+        CheckTable(table, tags);
+    }
+}
+
+//-----------------------------------------------------------------------------
+//      範囲外を指す表は受け付けません.
+//-----------------------------------------------------------------------------
+R3D_TEST(InitRejectsBrokenTable)
+{
+    auto tags = CreateTags(7);
+
+    std::vector<int32_t>         seeds;
+    std::vector<r3d::ResTagSlot> slots;
+    R3D_REQUIRE(r3d::BuildTagTable(tags.data(), uint32_t(tags.size()), seeds, slots));
+
+    auto brokenSeeds = seeds;
+    brokenSeeds[0] = -int32_t(tags.size()) - 1;
+
+    auto brokenSlots = slots;
+    brokenSlots[0] = r3d::ResTagSlot(slots[0].Tag(), uint32_t(tags.size()));
+
+    std::vector<int32_t> shortSeeds(seeds.begin(), seeds.end() - 1);
+
+    const std::vector<int32_t>*         pSeeds[] = { &brokenSeeds, &seeds,       &shortSeeds };
+    const std::vector<r3d::ResTagSlot>* pSlots[] = { &slots,       &brokenSlots, &slots };
+    for(auto i=0; i<3; ++i)
+    {
+        flatbuffers::FlatBufferBuilder builder(2048);
+        builder.Finish(r3d::CreateResSceneDirect(
+            builder, 0, 0, 0, 0, 0, 0, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+            nullptr, nullptr, pSeeds[i], pSlots[i]));
+
+        auto resScene = r3d::GetResScene(builder.GetBufferPointer());
+
+        r3d::TagTable table;
+        R3D_CHECK(!table.Init(resScene->LightTagSeeds(), resScene->LightTagSlots()));
+        R3D_CHECK(table.Find(tags[0]) == UINT32_MAX);
+    }
+}
@@ -0,0 +1,162 @@
+﻿//-----------------------------------------------------------------------------
+// File : TestCommon.cpp
+// Desc : Minimal Unit Test Framework.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// TestCase structure
+///////////////////////////////////////////////////////////////////////////////
+struct TestCase
+{
+    const char* Name;
+    void        (*Func)();
+};
+
+//-----------------------------------------------------------------------------
+//      登録されたテストを取得します.
+//-----------------------------------------------------------------------------
+std::vector<TestCase>& GetTestCases()
+{
+    static std::vector<TestCase> s_Cases;
+    return s_Cases;
+}
+
+uint32_t    g_FailCount = 0;
+std::string g_TempDir;
+
+} // namespace
+
+
+namespace r3d {
+namespace test {
+
+//-----------------------------------------------------------------------------
+//      テスト関数を登録します.
+//-----------------------------------------------------------------------------
+TestRegister::TestRegister(const char* name, void (*func)())
+{ GetTestCases().push_back({name, func}); }
+
+//-----------------------------------------------------------------------------
+//      条件を検証します.
+//-----------------------------------------------------------------------------
+bool Check(bool condition, const char* expr, const char* file, int line)
+{
+    if (condition)
+    { return true; }
+
+    fprintf(stderr, "%s(%d) : CHECK FAILED : %s\n", file, line, expr);
+    g_FailCount++;
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+//      テスト用の一時ファイルパスを取得します.
+//-----------------------------------------------------------------------------
+std::string GetTempPath(const char* name)
+{
+    namespace fs = std::filesystem;
+
+    if (g_TempDir.empty())
+    {
+        auto base = fs::temp_directory_path();
+        for(auto i=0u; ; ++i)
+        {
+            auto dir = base / ("r3d_test_" + std::to_string(rand()) + "_" + std::to_string(i));
+            std::error_code ec;
+            if (fs::create_directory(dir, ec))
+            {
+                g_TempDir = dir.string();
+                break;
+            }
+        }
+    }
+
+    return (fs::path(g_TempDir) / name).string();
+}
+
+//-----------------------------------------------------------------------------
+//      RGBA8 の DDS ファイルを書き込みます.
+//-----------------------------------------------------------------------------
+bool WriteDds(const std::string& path, uint32_t width, uint32_t height)
+{
+    uint32_t header[32] = {};
+    header[0]  = 0x20534444;                // "DDS "
+    header[1]  = 124;                       // DDS_HEADER::Size
+    header[2]  = 0x1007;                    // CAPS | HEIGHT | WIDTH | PIXELFORMAT
+    header[3]  = height;
+    header[4]  = width;
+    header[5]  = width * 4;
+    header[7]  = 1;                         // MipMapCount
+    header[19] = 32;                        // DDS_PIXEL_FORMAT::Size
+    header[20] = 0x4;                       // DDPF_FOURCC
+    header[21] = 0x30315844;                // "DX10"
+    header[27] = 0x1000;                    // DDSCAPS_TEXTURE
+
+    uint32_t ext[5] = {};
+    ext[0] = 28;                            // DXGI_FORMAT_R8G8B8A8_UNORM
+    ext[1] = 3;                             // TEXTURE2D
+    ext[3] = 1;                             // ArraySize
+
+    std::vector<uint8_t> pixels(size_t(width) * height * 4, 0x80);
+
+    auto pFile = fopen(path.c_str(), "wb");
+    if (pFile == nullptr)
+    { return false; }
+
+    auto ret = fwrite(header, sizeof(header), 1, pFile) == 1
+            && fwrite(ext, sizeof(ext), 1, pFile) == 1
+            && fwrite(pixels.data(), 1, pixels.size(), pFile) == pixels.size();
+    fclose(pFile);
+    return ret;
+}
+
+} // namespace test
+} // namespace r3d
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    srand(uint32_t(std::hash<std::string>()(argv[0])) ^ uint32_t(time(nullptr)));
+
+    // 引数があれば名前が一致するテストだけを実行.
+    uint32_t runCount = 0;
+    for(auto& test : GetTestCases())
+    {
+        if (argc > 1 && strcmp(argv[1], test.Name) != 0)
+        { continue; }
+
+        auto failCount = g_FailCount;
+        test.Func();
+        runCount++;
+
+        printf("[%s] %s\n", (g_FailCount == failCount) ? "  OK  " : "FAILED", test.Name);
+    }
+
+    if (!g_TempDir.empty())
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(g_TempDir, ec);
+    }
+
+    printf("%u tests, %u failures\n", runCount, g_FailCount);
+    return (g_FailCount == 0 && runCount > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,75 @@
+﻿//-----------------------------------------------------------------------------
+// File : TestCommon.h
+// Desc : Minimal Unit Test Framework.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <string>
+
+
+//-----------------------------------------------------------------------------
+// Test Macros.
+//-----------------------------------------------------------------------------
+// テスト関数を定義して登録します.
+#define R3D_TEST(name) \
+    static void name(); \
+    static r3d::test::TestRegister name##_register(#name, name); \
+    static void name()
+
+// 条件が偽なら失敗を記録して続行します.
+#define R3D_CHECK(expr) \
+    r3d::test::Check((expr), #expr, __FILE__, __LINE__)
+
+// 条件が偽なら失敗を記録してテスト関数を抜けます.
+#define R3D_REQUIRE(expr) \
+    do { if (!r3d::test::Check((expr), #expr, __FILE__, __LINE__)) { return; } } while(0)
+
+
+namespace r3d {
+namespace test {
+
+///////////////////////////////////////////////////////////////////////////////
+// TestRegister structure
+///////////////////////////////////////////////////////////////////////////////
+struct TestRegister
+{
+    //-------------------------------------------------------------------------
+    //! @brief      テスト関数を登録します.
+    //-------------------------------------------------------------------------
+    TestRegister(const char* name, void (*func)());
+};
+
+//-----------------------------------------------------------------------------
+//! @brief      条件を検証します.
+//!
+//! @retval true    条件が真.
+//! @retval false   条件が偽. 失敗を記録します.
+//-----------------------------------------------------------------------------
+bool Check(bool condition, const char* expr, const char* file, int line);
+
+//-----------------------------------------------------------------------------
+//! @brief      テスト用の一時ファイルパスを取得します.
+//!
+//! @note       テストの実行ごとに異なるディレクトリを作成します.
+//! @param[in]      name        ファイル名.
+//-----------------------------------------------------------------------------
+std::string GetTempPath(const char* name);
+
+//-----------------------------------------------------------------------------
+//! @brief      RGBA8 の DDS ファイルを書き込みます.
+//!
+//! @param[in]      path        ファイルパス.
+//! @param[in]      width       横幅.
+//! @param[in]      height      縦幅.
+//! @retval true    書き込みに成功.
+//! @retval false   書き込みに失敗.
+//-----------------------------------------------------------------------------
+bool WriteDds(const std::string& path, uint32_t width, uint32_t height);
+
+} // namespace test
+} // namespace r3d
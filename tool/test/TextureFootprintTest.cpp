@@ -0,0 +1,230 @@
+﻿//-----------------------------------------------------------------------------
+// File : TextureFootprintTest.cpp
+// Desc : TextureFootprint Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <TextureFootprint.h>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+static const uint32_t DIMENSION_2D              = 2;
+static const uint32_t DIMENSION_3D              = 3;
+static const uint32_t FORMAT_R32G32B32A32_FLOAT = 2;
+static const uint32_t FORMAT_R8G8B8A8_UNORM     = 28;
+static const uint32_t FORMAT_R8G8_B8G8_UNORM    = 68;
+static const uint32_t FORMAT_BC1_UNORM          = 71;
+static const uint32_t FORMAT_BC7_UNORM          = 98;
+
+///////////////////////////////////////////////////////////////////////////////
+// Expected structure
+///////////////////////////////////////////////////////////////////////////////
+struct Expected
+{
+    uint64_t    Offset;
+    uint32_t    Width;
+    uint32_t    Height;
+    uint32_t    RowPitch;
+    uint32_t    RowCount;
+    uint32_t    RowSize;
+};
+
+//-----------------------------------------------------------------------------
+//      GetCopyableFootprints() の規則で手計算した値と比較します.
+//-----------------------------------------------------------------------------
+void CheckFootprints
+(
+    const std::vector<r3d::TextureFootprint>&   actual,
+    const Expected*                             expected,
+    size_t                                      count
+)
+{
+    R3D_REQUIRE(actual.size() == count);
+    for(size_t i=0; i<count; ++i)
+    {
+        R3D_CHECK(actual[i].Offset   == expected[i].Offset);
+        R3D_CHECK(actual[i].Width    == expected[i].Width);
+        R3D_CHECK(actual[i].Height   == expected[i].Height);
+        R3D_CHECK(actual[i].RowPitch == expected[i].RowPitch);
+        R3D_CHECK(actual[i].RowCount == expected[i].RowCount);
+        R3D_CHECK(actual[i].RowSize  == expected[i].RowSize);
+
+        R3D_CHECK(actual[i].Offset   % r3d::TEXTURE_DATA_PLACEMENT_ALIGNMENT == 0);
+        R3D_CHECK(actual[i].RowPitch % r3d::TEXTURE_DATA_PITCH_ALIGNMENT     == 0);
+    }
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      行ピッチは256バイトに揃えます.
+//-----------------------------------------------------------------------------
+R3D_TEST(RowPitchAlignment)
+{
+    std::vector<r3d::TextureFootprint> footprints;
+    uint64_t totalSize = 0;
+    R3D_REQUIRE(r3d::CalcTextureFootprints(DIMENSION_2D, 100, 60, 1, FORMAT_R8G8B8A8_UNORM, 1, 1, footprints, totalSize));
+
+    const Expected expected[] = {
+        { 0, 100, 60, 512, 60, 400 },
+    };
+    CheckFootprints(footprints, expected, 1);
+    R3D_CHECK(footprints[0].Depth == 1);
+
+    // 最終行はパディングを含めない.
+    R3D_CHECK(totalSize == 512 * 59 + 400);
+}
+
+//-----------------------------------------------------------------------------
+//      ミップは512バイト境界に配置し, 小さなミップも256バイトのピッチを持ちます.
+//-----------------------------------------------------------------------------
+R3D_TEST(MipTailPlacement)
+{
+    std::vector<r3d::TextureFootprint> footprints;
+    uint64_t totalSize = 0;
+    R3D_REQUIRE(r3d::CalcTextureFootprints(DIMENSION_2D, 256, 256, 1, FORMAT_R8G8B8A8_UNORM, 9, 1, footprints, totalSize));
+
+    const Expected expected[] = {
+        {      0, 256, 256, 1024, 256, 1024 },
+        { 262144, 128, 128,  512, 128,  512 },
+        { 327680,  64,  64,  256,  64,  256 },
+        { 344064,  32,  32,  256,  32,  128 },
+        { 352256,  16,  16,  256,  16,   64 },
+        { 356352,   8,   8,  256,   8,   32 },
+        { 358400,   4,   4,  256,   4,   16 },
+        { 359424,   2,   2,  256,   2,    8 },
+        { 359936,   1,   1,  256,   1,    4 },
+    };
+    CheckFootprints(footprints, expected, 9);
+    R3D_CHECK(totalSize == 359936 + 4);
+}
+
+//-----------------------------------------------------------------------------
+//      ブロック圧縮は4x4ブロックを1行として数えます.
+//-----------------------------------------------------------------------------
+R3D_TEST(BlockCompressedRows)
+{
+    std::vector<r3d::TextureFootprint> footprints;
+    uint64_t totalSize = 0;
+    R3D_REQUIRE(r3d::CalcTextureFootprints(DIMENSION_2D, 256, 256, 1, FORMAT_BC1_UNORM, 9, 1, footprints, totalSize));
+
+    // 4x4 未満のミップも1ブロック分の大きさを持ち, 末尾のミップは512バイト境界に寄せる.
+    const Expected expected[] = {
+        {     0, 256, 256, 512, 64, 512 },
+        { 32768, 128, 128, 256, 32, 256 },
+        { 40960,  64,  64, 256, 16, 128 },
+        { 45056,  32,  32, 256,  8,  64 },
+        { 47104,  16,  16, 256,  4,  32 },
+        { 48128,   8,   8, 256,  2,  16 },
+        { 48640,   4,   4, 256,  1,   8 },
+        { 49152,   4,   4, 256,  1,   8 },
+        { 49664,   4,   4, 256,  1,   8 },
+    };
+    CheckFootprints(footprints, expected, 9);
+    R3D_CHECK(totalSize == 49664 + 8);
+
+    // ブロック境界に揃わないサイズは切り上げる.
+    R3D_REQUIRE(r3d::CalcTextureFootprints(DIMENSION_2D, 10, 6, 1, FORMAT_BC7_UNORM, 2, 1, footprints, totalSize));
+
+    const Expected unaligned[] = {
+        {   0, 12, 8, 256, 2, 48 },
+        { 512,  8, 4, 256, 1, 32 },
+    };
+    CheckFootprints(footprints, unaligned, 2);
+    R3D_CHECK(totalSize == 512 + 32);
+
+    // 2x1 のパック形式は横2ピクセルを1ブロックとする.
+    R3D_REQUIRE(r3d::CalcTextureFootprints(DIMENSION_2D, 5, 3, 1, FORMAT_R8G8_B8G8_UNORM, 1, 1, footprints, totalSize));
+
+    const Expected packed[] = {
+        { 0, 6, 3, 256, 3, 12 },
+    };
+    CheckFootprints(footprints, packed, 1);
+}
+
+//-----------------------------------------------------------------------------
+//      サーフェイス毎にミップを並べます.
+//-----------------------------------------------------------------------------
+R3D_TEST(SurfaceOrder)
+{
+    std::vector<r3d::TextureFootprint> footprints;
+    uint64_t totalSize = 0;
+    R3D_REQUIRE(r3d::CalcTextureFootprints(DIMENSION_2D, 16, 16, 1, FORMAT_R8G8B8A8_UNORM, 5, 6, footprints, totalSize));
+    R3D_REQUIRE(footprints.size() == 30);
+
+    const Expected surface[] = {
+        {    0, 16, 16, 256, 16, 64 },
+        { 4096,  8,  8, 256,  8, 32 },
+        { 6144,  4,  4, 256,  4, 16 },
+        { 7168,  2,  2, 256,  2,  8 },
+        { 7680,  1,  1, 256,  1,  4 },
+    };
+
+    // 各サーフェイスは前のサーフェイスの最終ミップの後ろの512バイト境界から始まる.
+    for(auto i=0u; i<6; ++i)
+    {
+        std::vector<r3d::TextureFootprint> mips(footprints.begin() + i * 5, footprints.begin() + (i + 1) * 5);
+        for(auto& mip : mips)
+        { mip.Offset -= 8192 * i; }
+        CheckFootprints(mips, surface, 5);
+    }
+    R3D_CHECK(totalSize == 8192 * 5 + 7680 + 4);
+}
+
+//-----------------------------------------------------------------------------
+//      3Dテクスチャはスライス数分の行を持ちます.
+//-----------------------------------------------------------------------------
+R3D_TEST(VolumeSlices)
+{
+    std::vector<r3d::TextureFootprint> footprints;
+    uint64_t totalSize = 0;
+    R3D_REQUIRE(r3d::CalcTextureFootprints(DIMENSION_3D, 8, 8, 4, FORMAT_R8G8B8A8_UNORM, 4, 1, footprints, totalSize));
+
+    const Expected expected[] = {
+        {     0, 8, 8, 256, 8, 32 },
+        {  8192, 4, 4, 256, 4, 16 },
+        { 10240, 2, 2, 256, 2,  8 },
+        { 10752, 1, 1, 256, 1,  4 },
+    };
+    CheckFootprints(footprints, expected, 4);
+    R3D_CHECK(footprints[0].Depth == 4);
+    R3D_CHECK(footprints[1].Depth == 2);
+    R3D_CHECK(footprints[2].Depth == 1);
+    R3D_CHECK(footprints[3].Depth == 1);
+    R3D_CHECK(totalSize == 10752 + 4);
+
+    // 3D以外では奥行を無視する.
+    R3D_REQUIRE(r3d::CalcTextureFootprints(DIMENSION_2D, 8, 8, 4, FORMAT_R8G8B8A8_UNORM, 1, 1, footprints, totalSize));
+    R3D_CHECK(footprints[0].Depth == 1);
+    R3D_CHECK(totalSize == 256 * 7 + 32);
+}
+
+//-----------------------------------------------------------------------------
+//      不正な引数は失敗します.
+//-----------------------------------------------------------------------------
+R3D_TEST(RejectsInvalidArguments)
+{
+    std::vector<r3d::TextureFootprint> footprints;
+    uint64_t totalSize = 1;
+
+    R3D_CHECK(!r3d::CalcTextureFootprints(DIMENSION_2D, 16, 16, 1, 0, 1, 1, footprints, totalSize));
+    R3D_CHECK(!r3d::CalcTextureFootprints(DIMENSION_2D,  0, 16, 1, FORMAT_R8G8B8A8_UNORM, 1, 1, footprints, totalSize));
+    R3D_CHECK(!r3d::CalcTextureFootprints(DIMENSION_2D, 16,  0, 1, FORMAT_R8G8B8A8_UNORM, 1, 1, footprints, totalSize));
+    R3D_CHECK(!r3d::CalcTextureFootprints(DIMENSION_2D, 16, 16, 1, FORMAT_R8G8B8A8_UNORM, 0, 1, footprints, totalSize));
+    R3D_CHECK(!r3d::CalcTextureFootprints(DIMENSION_2D, 16, 16, 1, FORMAT_R8G8B8A8_UNORM, 1, 0, footprints, totalSize));
+    R3D_CHECK(footprints.empty());
+    R3D_CHECK(totalSize == 0);
+
+    // 行ピッチが32bitに収まらない.
+    R3D_CHECK(!r3d::CalcTextureFootprints(DIMENSION_2D, 1u << 28, 1, 1, FORMAT_R32G32B32A32_FLOAT, 1, 1, footprints, totalSize));
+}
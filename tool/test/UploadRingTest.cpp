@@ -0,0 +1,295 @@
+﻿//-----------------------------------------------------------------------------
+// File : UploadRingTest.cpp
+// Desc : UploadRing Unit Test.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include "TestCommon.h"
+#include <UploadRing.h>
+#include <deque>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+///////////////////////////////////////////////////////////////////////////////
+// Range structure
+///////////////////////////////////////////////////////////////////////////////
+struct Range
+{
+    uint64_t    Offset;
+    uint64_t    Size;
+    uint64_t    FenceValue;     //!< サブミット前は 0.
+};
+
+//-----------------------------------------------------------------------------
+//      UploadHeap::Alloc() と同じ手順で割り当てます.
+//-----------------------------------------------------------------------------
+bool AllocLikeHeap
+(
+    r3d::UploadRing&    ring,
+    uint64_t            size,
+    uint64_t            alignment,
+    uint64_t&           completedValue,
+    uint64_t&           offset
+)
+{
+    ring.Retire(completedValue);
+
+    if (ring.Alloc(size, alignment, offset))
+    { return true; }
+
+    uint64_t fenceValue = 0;
+    if (!ring.FindStallFence(size, alignment, fenceValue))
+    { return false; }
+
+    // フェンスを待った扱いにする.
+    if (completedValue < fenceValue)
+    { completedValue = fenceValue; }
+
+    ring.Stall(fenceValue);
+    return ring.Alloc(size, alignment, offset);
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      不正な容量を拒否します.
+//-----------------------------------------------------------------------------
+R3D_TEST(InitRejectsZeroCapacity)
+{
+    r3d::UploadRing ring;
+    R3D_CHECK(!ring.Init(0));
+    R3D_CHECK(ring.Init(1024));
+    R3D_CHECK(ring.GetCapacity() == 1024);
+    R3D_CHECK(ring.GetUsedSize() == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      アライメントの余りを詰め物として数えます.
+//-----------------------------------------------------------------------------
+R3D_TEST(AllocAlignsOffset)
+{
+    r3d::UploadRing ring;
+    R3D_REQUIRE(ring.Init(1024));
+
+    uint64_t a = 0, b = 0;
+    R3D_REQUIRE(ring.Alloc(10, 1, a));
+    R3D_REQUIRE(ring.Alloc(16, 256, b));
+
+    R3D_CHECK(a == 0);
+    R3D_CHECK(b == 256);
+    R3D_CHECK(ring.GetUsedSize() == 272);
+
+    auto& stats = ring.GetStats();
+    R3D_CHECK(stats.AllocCount == 2);
+    R3D_CHECK(stats.AllocSize == 26);
+    R3D_CHECK(stats.PaddingSize == 246);
+    R3D_CHECK(stats.WrapCount == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      末尾に収まらない要求は先頭に折り返します.
+//-----------------------------------------------------------------------------
+R3D_TEST(AllocWrapsAround)
+{
+    r3d::UploadRing ring;
+    R3D_REQUIRE(ring.Init(1024));
+
+    uint64_t offset = 0;
+    R3D_REQUIRE(ring.Alloc(600, 1, offset));
+    ring.Submit(1);
+    ring.Retire(1);
+    R3D_CHECK(ring.GetUsedSize() == 0);
+
+    R3D_REQUIRE(ring.Alloc(600, 1, offset));
+    R3D_CHECK(offset == 0);
+
+    auto& stats = ring.GetStats();
+    R3D_CHECK(stats.WrapCount == 1);
+    R3D_CHECK(stats.PaddingSize == 424);
+    R3D_CHECK(ring.GetUsedSize() == 1024);
+
+    // 折り返した後も末尾の続きに割り当てる.
+    ring.Submit(2);
+    ring.Retire(2);
+    R3D_REQUIRE(ring.Alloc(100, 1, offset));
+    R3D_CHECK(offset == 600);
+    R3D_CHECK(stats.WrapCount == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      完了したフェンスまでのサブミットだけを回収します.
+//-----------------------------------------------------------------------------
+R3D_TEST(RetireFollowsFence)
+{
+    r3d::UploadRing ring;
+    R3D_REQUIRE(ring.Init(1024));
+
+    uint64_t offset = 0;
+    for(auto fence=1u; fence<=3; ++fence)
+    {
+        R3D_REQUIRE(ring.Alloc(256, 1, offset));
+        ring.Submit(fence);
+    }
+
+    // 割り当てが無ければサブミットは記録しない.
+    ring.Submit(4);
+
+    ring.Retire(0);
+    R3D_CHECK(ring.GetUsedSize() == 768);
+    R3D_CHECK(ring.GetStats().RetireCount == 0);
+
+    ring.Retire(2);
+    R3D_CHECK(ring.GetUsedSize() == 256);
+    R3D_CHECK(ring.GetStats().RetireCount == 2);
+
+    ring.Retire(4);
+    R3D_CHECK(ring.GetUsedSize() == 0);
+    R3D_CHECK(ring.GetStats().RetireCount == 3);
+}
+
+//-----------------------------------------------------------------------------
+//      空きが無い場合と容量を超える場合を区別して数えます.
+//-----------------------------------------------------------------------------
+R3D_TEST(AllocFailureCounts)
+{
+    r3d::UploadRing ring;
+    R3D_REQUIRE(ring.Init(1024));
+
+    uint64_t offset = 0;
+    R3D_CHECK(!ring.Alloc(2048, 1, offset));
+    R3D_CHECK(ring.GetStats().OversizeCount == 1);
+
+    R3D_REQUIRE(ring.Alloc(600, 1, offset));
+    ring.Submit(1);
+    R3D_CHECK(!ring.Alloc(600, 1, offset));
+    R3D_CHECK(ring.GetStats().FullCount == 1);
+
+    ring.Retire(1);
+    R3D_CHECK(ring.Alloc(600, 1, offset));
+    R3D_CHECK(ring.GetStats().AllocCount == 2);
+}
+
+//-----------------------------------------------------------------------------
+//      空きを作るのに必要な最も古いフェンスを待ちます.
+//-----------------------------------------------------------------------------
+R3D_TEST(StallWaitsOldestSufficientFence)
+{
+    r3d::UploadRing ring;
+    R3D_REQUIRE(ring.Init(1024));
+
+    uint64_t offset = 0;
+    for(auto fence=1u; fence<=4; ++fence)
+    {
+        R3D_REQUIRE(ring.Alloc(256, 1, offset));
+        ring.Submit(fence);
+    }
+
+    // 512 byte 空けるには 2 つ目のサブミットまで待てばよい.
+    uint64_t fenceValue = 0;
+    R3D_REQUIRE(ring.FindStallFence(512, 1, fenceValue));
+    R3D_CHECK(fenceValue == 2);
+
+    // 容量を超える要求は待っても割り当てられない.
+    R3D_CHECK(!ring.FindStallFence(2048, 1, fenceValue));
+
+    ring.Stall(fenceValue);
+    R3D_CHECK(ring.GetStats().StallCount == 1);
+    R3D_CHECK(ring.GetStats().RetireCount == 2);
+    R3D_CHECK(ring.Alloc(512, 1, offset));
+    R3D_CHECK(offset == 0);
+}
+
+//-----------------------------------------------------------------------------
+//      サブミット前の割り当てがあると待っても空きを作れません.
+//-----------------------------------------------------------------------------
+R3D_TEST(StallBlockedByPendingAllocs)
+{
+    r3d::UploadRing ring;
+    R3D_REQUIRE(ring.Init(1024));
+
+    uint64_t offset = 0;
+    R3D_REQUIRE(ring.Alloc(512, 1, offset));
+    ring.Submit(1);
+    R3D_REQUIRE(ring.Alloc(512, 1, offset));
+
+    uint64_t fenceValue = 0;
+    R3D_CHECK(!ring.FindStallFence(768, 1, fenceValue));
+    R3D_CHECK(ring.FindStallFence(512, 1, fenceValue));
+    R3D_CHECK(fenceValue == 1);
+}
+
+//-----------------------------------------------------------------------------
+//      遅れて完了する GPU を模して生存中の領域が重ならないことを検証します.
+//-----------------------------------------------------------------------------
+R3D_TEST(RandomNoOverlap)
+{
+    static const uint64_t CAPACITY = 64 * 1024;
+    static const uint64_t LATENCY  = 3;
+
+    r3d::UploadRing ring;
+    R3D_REQUIRE(ring.Init(CAPACITY));
+
+    std::mt19937 rng(4321);
+    std::deque<Range> live;
+    uint64_t fence     = 0;
+    uint64_t completed = 0;
+    uint64_t stalls    = 0;
+
+    for(auto frame=0; frame<2000; ++frame)
+    {
+        auto count = 1 + rng() % 8;
+        for(auto i=0u; i<count; ++i)
+        {
+            auto size      = 1 + rng() % (CAPACITY / 8);
+            auto alignment = uint64_t(1) << (rng() % 10);
+            auto before    = completed;
+
+            uint64_t offset = 0;
+            if (!AllocLikeHeap(ring, size, alignment, completed, offset))
+            {
+                // サブミットして次のフレームで再挑戦.
+                break;
+            }
+
+            if (completed != before)
+            { stalls++; }
+
+            R3D_CHECK((offset & (alignment - 1)) == 0);
+            R3D_CHECK(offset + size <= CAPACITY);
+
+            // 回収済みの領域を捨てる.
+            while(!live.empty() && live.front().FenceValue != 0 && live.front().FenceValue <= completed)
+            { live.pop_front(); }
+
+            for(auto& range : live)
+            {
+                auto overlap = offset < range.Offset + range.Size && range.Offset < offset + size;
+                R3D_REQUIRE(!overlap);
+            }
+
+            live.push_back({offset, size, 0});
+        }
+
+        fence++;
+        ring.Submit(fence);
+        for(auto& range : live)
+        {
+            if (range.FenceValue == 0)
+            { range.FenceValue = fence; }
+        }
+
+        // GPU は LATENCY フレーム遅れて完了する.
+        if (fence > LATENCY && completed < fence - LATENCY)
+        { completed = fence - LATENCY; }
+    }
+
+    R3D_CHECK(ring.GetStats().StallCount == stalls);
+    R3D_CHECK(ring.GetUsedSize() <= CAPACITY);
+}
@@ -0,0 +1,255 @@
+﻿//-----------------------------------------------------------------------------
+// File : main.cpp
+// Desc : Upload Ring Benchmark.
+// Copyright(c) Project Asura. All right reserved.
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// Includes
+//-----------------------------------------------------------------------------
+#include <UploadRing.h>
+#include <Platform.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+namespace {
+
+//-----------------------------------------------------------------------------
+// Constant Values.
+//-----------------------------------------------------------------------------
+// テクスチャのコピー元のアライメント (D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT).
+static const uint64_t UPLOAD_ALIGNMENT  = 512;
+static const uint64_t MIN_UPLOAD_SIZE   = 4 * 1024;
+static const uint64_t MiB               = 1024 * 1024;
+
+///////////////////////////////////////////////////////////////////////////////
+// Option structure
+///////////////////////////////////////////////////////////////////////////////
+struct Option
+{
+    std::vector<uint64_t>   Capacities;                     //!< 容量[MiB].
+    uint32_t                FrameCount      = 600;
+    uint32_t                Latency         = 2;            //!< GPU が完了するまでのフレーム数.
+    uint64_t                FrameBytes      = 24 * MiB;     //!< 1フレームあたりのアップロード量.
+    uint64_t                MaxUploadSize   = 8 * MiB;
+    bool                    Copy            = true;
+    uint32_t                Seed            = 1234;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Result structure
+///////////////////////////////////////////////////////////////////////////////
+struct Result
+{
+    uint64_t    UploadCount = 0;
+    uint64_t    UploadBytes = 0;
+    uint64_t    SkipCount   = 0;    //!< 待っても割り当てられず次のフレームに回した数.
+    double      AllocNs     = 0.0;
+    double      TotalNs     = 0.0;
+};
+
+//-----------------------------------------------------------------------------
+//      経過時間[ns]を求めます.
+//-----------------------------------------------------------------------------
+double GetNanoSec(std::chrono::steady_clock::time_point begin)
+{
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+//-----------------------------------------------------------------------------
+//      1つの容量でベンチマークを行います.
+//-----------------------------------------------------------------------------
+bool Run(const Option& option, uint64_t capacity, const std::vector<uint8_t>& source, r3d::UploadRing& ring, Result& result)
+{
+    if (!ring.Init(capacity))
+    {
+        ELOGA("Error : UploadRing::Init() Failed.");
+        return false;
+    }
+
+    std::vector<uint8_t> heap(static_cast<size_t>(capacity));
+
+    std::mt19937 rng(option.Seed);
+    std::uniform_real_distribution<double> dist(
+        std::log(double(MIN_UPLOAD_SIZE)),
+        std::log(double(std::min(option.MaxUploadSize, capacity))));
+
+    uint64_t fence     = 0;
+    uint64_t completed = 0;
+    uint64_t carry     = 0;     // 前のフレームに収まらなかった要求.
+
+    auto totalBegin = std::chrono::steady_clock::now();
+    for(auto frame=0u; frame<option.FrameCount; ++frame)
+    {
+        uint64_t frameBytes = 0;
+        while(frameBytes < option.FrameBytes)
+        {
+            auto size = (carry != 0) ? carry : uint64_t(std::exp(dist(rng)));
+            carry = 0;
+
+            // UploadHeap::Alloc() と同じ手順.
+            auto begin = std::chrono::steady_clock::now();
+            ring.Retire(completed);
+
+            uint64_t offset = 0;
+            auto ret = ring.Alloc(size, UPLOAD_ALIGNMENT, offset);
+
+            uint64_t fenceValue = 0;
+            if (!ret && ring.FindStallFence(size, UPLOAD_ALIGNMENT, fenceValue))
+            {
+                if (completed < fenceValue)
+                { completed = fenceValue; }
+
+                ring.Stall(fenceValue);
+                ret = ring.Alloc(size, UPLOAD_ALIGNMENT, offset);
+            }
+            result.AllocNs += GetNanoSec(begin);
+
+            if (!ret)
+            {
+                // サブミットしてから次のフレームで割り当てる.
+                carry = size;
+                result.SkipCount++;
+                break;
+            }
+
+            if (option.Copy)
+            { memcpy(heap.data() + offset, source.data(), size_t(size)); }
+
+            result.UploadCount++;
+            result.UploadBytes += size;
+            frameBytes += size;
+        }
+
+        fence++;
+        ring.Submit(fence);
+
+        // GPU は Latency フレーム遅れて完了する.
+        if (fence > option.Latency && completed < fence - option.Latency)
+        { completed = fence - option.Latency; }
+    }
+    result.TotalNs = GetNanoSec(totalBegin);
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+//      使用方法を表示します.
+//-----------------------------------------------------------------------------
+void PrintUsage()
+{
+    printf("Usage : uploadbench [options]\n");
+    printf("Options :\n");
+    printf("    -c <MiB>                    : ring capacity, repeatable (default: 16 32 64 128).\n");
+    printf("    -f <count>                  : frame count (default: 600).\n");
+    printf("    -l <frames>                 : GPU latency in frames (default: 2).\n");
+    printf("    -b <MiB>                    : upload bytes per frame (default: 24).\n");
+    printf("    -s <KiB>                    : max upload size (default: 8192).\n");
+    printf("    -x <seed>                   : random seed (default: 1234).\n");
+    printf("    --no-copy                   : measure the allocator only.\n");
+    printf("    -h                          : show this message.\n");
+}
+
+//-----------------------------------------------------------------------------
+//      コマンドライン引数を解析します.
+//-----------------------------------------------------------------------------
+bool ParseArgs(int argc, char** argv, Option& option)
+{
+    for(auto i=1; i<argc; ++i)
+    {
+        auto arg = argv[i];
+        auto hasNext = (i + 1 < argc);
+
+        if (0 == strcmp(arg, "-h") || 0 == strcmp(arg, "--help"))
+        { return false; }
+        else if (0 == strcmp(arg, "-c") && hasNext)
+        { option.Capacities.push_back(uint64_t(strtoull(argv[++i], nullptr, 10)) * MiB); }
+        else if (0 == strcmp(arg, "-f") && hasNext)
+        { option.FrameCount = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-l") && hasNext)
+        { option.Latency = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "-b") && hasNext)
+        { option.FrameBytes = uint64_t(strtoull(argv[++i], nullptr, 10)) * MiB; }
+        else if (0 == strcmp(arg, "-s") && hasNext)
+        { option.MaxUploadSize = uint64_t(strtoull(argv[++i], nullptr, 10)) * 1024; }
+        else if (0 == strcmp(arg, "-x") && hasNext)
+        { option.Seed = uint32_t(strtoul(argv[++i], nullptr, 10)); }
+        else if (0 == strcmp(arg, "--no-copy"))
+        { option.Copy = false; }
+        else
+        {
+            ELOGA("Error : Unknown Option. option = %s", arg);
+            return false;
+        }
+    }
+
+    if (option.Capacities.empty())
+    { option.Capacities = { 16 * MiB, 32 * MiB, 64 * MiB, 128 * MiB }; }
+
+    for(auto capacity : option.Capacities)
+    {
+        if (capacity < MIN_UPLOAD_SIZE * 2)
+        { return false; }
+    }
+
+    return option.FrameCount > 0
+        && option.FrameBytes > 0
+        && option.MaxUploadSize > MIN_UPLOAD_SIZE;
+}
+
+} // namespace
+
+
+//-----------------------------------------------------------------------------
+//      メインエントリーポイントです.
+//-----------------------------------------------------------------------------
+int main(int argc, char** argv)
+{
+    Option option;
+    if (!ParseArgs(argc, argv, option))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint8_t> source(size_t(option.MaxUploadSize));
+    for(size_t i=0; i<source.size(); ++i)
+    { source[i] = uint8_t(i * 31); }
+
+    printf("%u frames, %.1f MiB per frame, latency %u frames, alignment %llu%s\n",
+        option.FrameCount, double(option.FrameBytes) / MiB, option.Latency,
+        (unsigned long long)UPLOAD_ALIGNMENT, option.Copy ? "" : ", no copy");
+    printf("    %-10s %10s %8s %8s %8s %8s %10s %10s\n",
+        "ring[MiB]", "uploads", "stalls", "wraps", "skips", "pad", "ns/alloc", "MB/s");
+
+    for(auto capacity : option.Capacities)
+    {
+        r3d::UploadRing ring;
+        Result result;
+        if (!Run(option, capacity, source, ring, result))
+        { return EXIT_FAILURE; }
+
+        auto& stats  = ring.GetStats();
+        auto padding = (stats.AllocSize > 0) ? double(stats.PaddingSize) / double(stats.AllocSize) : 0.0;
+        auto nsPer   = (stats.AllocCount > 0) ? result.AllocNs / double(stats.AllocCount) : 0.0;
+        auto mbps    = (result.TotalNs > 0.0) ? double(result.UploadBytes) * 1000.0 / result.TotalNs : 0.0;
+
+        printf("    %-10.0f %10llu %8llu %8llu %8llu %7.2f%% %10.1f %10.1f\n",
+            double(capacity) / MiB,
+            (unsigned long long)result.UploadCount,
+            (unsigned long long)stats.StallCount,
+            (unsigned long long)stats.WrapCount,
+            (unsigned long long)result.SkipCount,
+            padding * 100.0, nsPer, mbps);
+    }
+
+    return EXIT_SUCCESS;
+}